@@ -46,8 +46,7 @@
  * ============================================================================ */
 #include "rosetta_jit.h"             /* JIT compilation engine */
 #include "rosetta_context.h"         /* CPU context management */
-#include "rosetta_simd.h"            /* SIMD/FP instruction handling */
-#include "rosetta_simd_mem.h"        /* SIMD memory operations */
+#include "rosetta_string_simd.h"     /* SIMD string/memory kernels */
 
 /* ============================================================================
  * MEMORY MANAGEMENT
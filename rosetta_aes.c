@@ -0,0 +1,234 @@
+/* ============================================================================
+ * Rosetta Translator - Host AES Round Primitives
+ * ============================================================================
+ *
+ * Byte-at-a-time S-box implementation for every host, and an AES-NI kernel
+ * on x86_64 compiled with a target attribute so the rest of the file
+ * builds for the baseline ISA. The ARM64 steps map onto AES-NI with an
+ * all-zero round key: AESE is AESENCLAST(s ^ k, 0), AESMC is
+ * AESENC(AESDECLAST(s, 0), 0) since the byte substitution and the row
+ * rotation cancel out.
+ * ============================================================================ */
+
+#include "rosetta_aes.h"
+#include <errno.h>
+#include <pthread.h>
+#include <string.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define AESNI   __attribute__((target("aes,sse2")))
+#endif
+
+/* AES S-box */
+static const uint8_t aes_sbox[256] = {
+    0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+    0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+    0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+    0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+    0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0, 0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+    0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+    0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+    0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5, 0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+    0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+    0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+    0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c, 0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+    0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+    0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+    0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e, 0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+    0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+    0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16
+};
+
+/* AES Inverse S-box */
+static const uint8_t aes_inv_sbox[256] = {
+    0x52, 0x09, 0x6a, 0xd5, 0x30, 0x36, 0xa5, 0x38, 0xbf, 0x40, 0xa3, 0x9e, 0x81, 0xf3, 0xd7, 0xfb,
+    0x7c, 0xe3, 0x39, 0x82, 0x9b, 0x2f, 0xff, 0x87, 0x34, 0x8e, 0x43, 0x44, 0xc4, 0xde, 0xe9, 0xcb,
+    0x54, 0x7b, 0x94, 0x32, 0xa6, 0xc2, 0x23, 0x3d, 0xee, 0x4c, 0x95, 0x0b, 0x42, 0xfa, 0xc3, 0x4e,
+    0x08, 0x2e, 0xa1, 0x66, 0x28, 0xd9, 0x24, 0xb2, 0x76, 0x5b, 0xa2, 0x49, 0x6d, 0x8b, 0xd1, 0x25,
+    0x72, 0xf8, 0xf6, 0x64, 0x86, 0x68, 0x98, 0x16, 0xd4, 0xa4, 0x5c, 0xcc, 0x5d, 0x65, 0xb6, 0x92,
+    0x6c, 0x70, 0x48, 0x50, 0xfd, 0xed, 0xb9, 0xda, 0x5e, 0x15, 0x46, 0x57, 0xa7, 0x8d, 0x9d, 0x84,
+    0x90, 0xd8, 0xab, 0x00, 0x8c, 0xbc, 0xd3, 0x0a, 0xf7, 0xe4, 0x58, 0x05, 0xb8, 0xb3, 0x45, 0x06,
+    0xd0, 0x2c, 0x1e, 0x8f, 0xca, 0x3f, 0x0f, 0x02, 0xc1, 0xaf, 0xbd, 0x03, 0x01, 0x13, 0x8a, 0x6b,
+    0x3a, 0x91, 0x11, 0x41, 0x4f, 0x67, 0xdc, 0xea, 0x97, 0xf2, 0xcf, 0xce, 0xf0, 0xb4, 0xe6, 0x73,
+    0x96, 0xac, 0x74, 0x22, 0xe7, 0xad, 0x35, 0x85, 0xe2, 0xf9, 0x37, 0xe8, 0x1c, 0x75, 0xdf, 0x6e,
+    0x47, 0xf1, 0x1a, 0x71, 0x1d, 0x29, 0xc5, 0x89, 0x6f, 0xb7, 0x62, 0x0e, 0xaa, 0x18, 0xbe, 0x1b,
+    0xfc, 0x56, 0x3e, 0x4b, 0xc6, 0xd2, 0x79, 0x20, 0x9a, 0xdb, 0xc0, 0xfe, 0x78, 0xcd, 0x5a, 0xf4,
+    0x1f, 0xdd, 0xa8, 0x33, 0x88, 0x07, 0xc7, 0x31, 0xb1, 0x12, 0x10, 0x59, 0x27, 0x80, 0xec, 0x5f,
+    0x60, 0x51, 0x7f, 0xa9, 0x19, 0xb5, 0x4a, 0x0d, 0x2d, 0xe5, 0x7a, 0x9f, 0x93, 0xc9, 0x9c, 0xef,
+    0xa0, 0xe0, 0x3b, 0x4d, 0xae, 0x2a, 0xf5, 0xb0, 0xc8, 0xeb, 0xbb, 0x3c, 0x83, 0x53, 0x99, 0x61,
+    0x17, 0x2b, 0x04, 0x7e, 0xba, 0x77, 0xd6, 0x26, 0xe1, 0x69, 0x14, 0x63, 0x55, 0x21, 0x0c, 0x7d
+};
+
+static uint32_t g_hw_supported;
+static uint32_t g_hw;
+static pthread_once_t g_aes_once = PTHREAD_ONCE_INIT;
+
+/* ============================================================================
+ * Feature Selection
+ * ============================================================================ */
+
+static void aes_init_once(void)
+{
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("aes")) {
+        g_hw_supported |= ROS_AES_HW_AESNI;
+    }
+#endif
+    __atomic_store_n(&g_hw, g_hw_supported, __ATOMIC_RELEASE);
+}
+
+uint32_t rosetta_aes_hw_supported(void)
+{
+    pthread_once(&g_aes_once, aes_init_once);
+    return g_hw_supported;
+}
+
+uint32_t rosetta_aes_hw(void)
+{
+    pthread_once(&g_aes_once, aes_init_once);
+    return __atomic_load_n(&g_hw, __ATOMIC_ACQUIRE);
+}
+
+int rosetta_aes_set_hw(uint32_t hw)
+{
+    pthread_once(&g_aes_once, aes_init_once);
+    if (hw & ~g_hw_supported) {
+        return -ENOTSUP;
+    }
+    __atomic_store_n(&g_hw, hw, __ATOMIC_RELEASE);
+    return 0;
+}
+
+/* ============================================================================
+ * Table Implementation
+ * ============================================================================ */
+
+static uint8_t aes_xtime(uint8_t x)
+{
+    return (uint8_t)((x << 1) ^ ((x & 0x80) ? 0x1B : 0));
+}
+
+static uint8_t aes_mul(uint8_t x, uint8_t k)
+{
+    uint8_t r = 0;
+
+    for (; k; k >>= 1, x = aes_xtime(x)) {
+        if (k & 1) {
+            r ^= x;
+        }
+    }
+    return r;
+}
+
+/* SubBytes then ShiftRows: row r of column c comes from column c + r */
+static void aes_sub_shift(uint8_t *out, const uint8_t *s)
+{
+    for (int c = 0; c < 4; c++) {
+        for (int r = 0; r < 4; r++) {
+            out[4 * c + r] = aes_sbox[s[4 * ((c + r) & 3) + r]];
+        }
+    }
+}
+
+/* InvSubBytes then InvShiftRows: row r of column c comes from column c - r */
+static void aes_inv_sub_shift(uint8_t *out, const uint8_t *s)
+{
+    for (int c = 0; c < 4; c++) {
+        for (int r = 0; r < 4; r++) {
+            out[4 * c + r] = aes_inv_sbox[s[4 * ((c - r) & 3) + r]];
+        }
+    }
+}
+
+static void aes_mix(uint8_t *out, const uint8_t *s, int inverse)
+{
+    static const uint8_t fwd[4] = { 2, 3, 1, 1 };
+    static const uint8_t inv[4] = { 14, 11, 13, 9 };
+    const uint8_t *m = inverse ? inv : fwd;
+
+    for (int c = 0; c < 4; c++) {
+        const uint8_t *col = &s[4 * c];
+        for (int r = 0; r < 4; r++) {
+            out[4 * c + r] = aes_mul(col[0], m[(4 - r) & 3]) ^ aes_mul(col[1], m[(5 - r) & 3]) ^
+                             aes_mul(col[2], m[(6 - r) & 3]) ^ aes_mul(col[3], m[(7 - r) & 3]);
+        }
+    }
+}
+
+static void table_step(rosetta_aes_op_t op, uint8_t *out, const uint8_t *state,
+                       const uint8_t *key)
+{
+    uint8_t s[16], t[16], k[16] = { 0 };
+    int i;
+
+    /* out may alias either input */
+    memcpy(s, state, 16);
+    if (key != NULL) {
+        memcpy(k, key, 16);
+    }
+    if (op == ROS_AES_E || op == ROS_AES_D) {
+        for (i = 0; i < 16; i++) {
+            s[i] ^= k[i];
+        }
+    }
+
+    switch (op) {
+    case ROS_AES_E:       aes_sub_shift(out, s); return;
+    case ROS_AES_D:       aes_inv_sub_shift(out, s); return;
+    case ROS_AES_MC:      aes_mix(out, s, 0); return;
+    case ROS_AES_IMC:     aes_mix(out, s, 1); return;
+    case ROS_AES_ENC:     aes_sub_shift(t, s); aes_mix(out, t, 0); break;
+    case ROS_AES_ENCLAST: aes_sub_shift(out, s); break;
+    case ROS_AES_DEC:     aes_inv_sub_shift(t, s); aes_mix(out, t, 1); break;
+    default:              aes_inv_sub_shift(out, s); break;
+    }
+    for (i = 0; i < 16; i++) {
+        out[i] ^= k[i];
+    }
+}
+
+/* ============================================================================
+ * x86_64 Kernel
+ * ============================================================================ */
+
+#if defined(__x86_64__)
+
+static AESNI void aesni_step(rosetta_aes_op_t op, uint8_t *out, const uint8_t *state,
+                             const uint8_t *key)
+{
+    __m128i s = _mm_loadu_si128((const __m128i *)state);
+    __m128i k = key ? _mm_loadu_si128((const __m128i *)key) : _mm_setzero_si128();
+    __m128i z = _mm_setzero_si128();
+
+    switch (op) {
+    case ROS_AES_E:       s = _mm_aesenclast_si128(_mm_xor_si128(s, k), z); break;
+    case ROS_AES_D:       s = _mm_aesdeclast_si128(_mm_xor_si128(s, k), z); break;
+    case ROS_AES_MC:      s = _mm_aesenc_si128(_mm_aesdeclast_si128(s, z), z); break;
+    case ROS_AES_IMC:     s = _mm_aesimc_si128(s); break;
+    case ROS_AES_ENC:     s = _mm_aesenc_si128(s, k); break;
+    case ROS_AES_ENCLAST: s = _mm_aesenclast_si128(s, k); break;
+    case ROS_AES_DEC:     s = _mm_aesdec_si128(s, k); break;
+    default:              s = _mm_aesdeclast_si128(s, k); break;
+    }
+    _mm_storeu_si128((__m128i *)out, s);
+}
+
+#endif /* __x86_64__ */
+
+/* ============================================================================
+ * Public Entry Point
+ * ============================================================================ */
+
+void rosetta_aes_step(rosetta_aes_op_t op, uint8_t out[16], const uint8_t state[16],
+                      const uint8_t key[16])
+{
+#if defined(__x86_64__)
+    if (rosetta_aes_hw() & ROS_AES_HW_AESNI) {
+        aesni_step(op, out, state, key);
+        return;
+    }
+#endif
+    table_step(op, out, state, key);
+}
@@ -0,0 +1,74 @@
+/* ============================================================================
+ * Rosetta Translator - Host AES Round Primitives Header
+ * ============================================================================
+ *
+ * The ARM64 and x86_64 AES instructions split a round differently:
+ *
+ *   AESE  (ARM64)   ShiftRows(SubBytes(s ^ k))
+ *   AESMC (ARM64)   MixColumns(s)
+ *   AESENC (x86)    MixColumns(ShiftRows(SubBytes(s))) ^ k
+ *   AESENCLAST      ShiftRows(SubBytes(s)) ^ k
+ *
+ * and likewise AESD/AESIMC against AESDEC/AESDECLAST, so a guest pair
+ * AESE k0; AESMC equals AESENC(s ^ k0, 0) and the next round key can be
+ * folded into the x86 instruction. The IR optimizer does that
+ * re-association (ir_opt_aes_fuse()); this module executes single steps
+ * of either flavour for the interpreter path and for tests, with AES-NI
+ * when the host has it and S-box tables otherwise.
+ *
+ * State and round keys are 16 bytes in memory order, column-major as in
+ * FIPS-197, which is the layout both ISAs use for their vector registers.
+ * ============================================================================ */
+
+#ifndef ROSETTA_AES_H
+#define ROSETTA_AES_H
+
+#include <stdint.h>
+
+/* Single AES steps; IR_AES numbers its ir_aes_op_t the same way */
+typedef enum {
+    ROS_AES_E = 0,          /* ARM64 AESE */
+    ROS_AES_D,              /* ARM64 AESD */
+    ROS_AES_MC,             /* ARM64 AESMC, no key */
+    ROS_AES_IMC,            /* ARM64 AESIMC, no key */
+    ROS_AES_ENC,            /* x86 AESENC */
+    ROS_AES_ENCLAST,        /* x86 AESENCLAST */
+    ROS_AES_DEC,            /* x86 AESDEC */
+    ROS_AES_DECLAST,        /* x86 AESDECLAST */
+    ROS_AES_OP_COUNT
+} rosetta_aes_op_t;
+
+/* Host features rosetta_aes_hw() may report */
+#define ROS_AES_HW_AESNI        0x1     /* x86 AES-NI */
+
+/**
+ * rosetta_aes_hw_supported - Features this CPU has (ROS_AES_HW_*)
+ */
+uint32_t rosetta_aes_hw_supported(void);
+
+/**
+ * rosetta_aes_hw - Features currently in use (ROS_AES_HW_*)
+ */
+uint32_t rosetta_aes_hw(void);
+
+/**
+ * rosetta_aes_set_hw - Restrict the features in use
+ * @param hw ROS_AES_HW_* mask; 0 forces the table implementation
+ * @return 0 on success, -ENOTSUP if hw names a feature this CPU lacks
+ *
+ * Without AES-NI the IR x86_64 back-end declines blocks containing AES
+ * steps, leaving them to the interpreter.
+ */
+int rosetta_aes_set_hw(uint32_t hw);
+
+/**
+ * rosetta_aes_step - One AES instruction of either ISA
+ * @param op Step to perform
+ * @param out Result, may alias state
+ * @param state Input state
+ * @param key Round key, NULL for an all-zero key; ignored by MC/IMC
+ */
+void rosetta_aes_step(rosetta_aes_op_t op, uint8_t out[16], const uint8_t state[16],
+                      const uint8_t key[16]);
+
+#endif /* ROSETTA_AES_H */
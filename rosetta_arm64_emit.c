@@ -164,8 +164,11 @@ void emit_eor_reg(code_buffer_t *buf, uint8_t dst, uint8_t src1, uint8_t src2)
 
 void emit_mov_reg(code_buffer_t *buf, uint8_t dst, uint8_t src)
 {
-    /* MOV Xd, Xm (alias of ORR Xd, XZR, Xm) */
-    emit_orr_reg(buf, dst, 31, src);
+    /* MOV Xd, Xm (alias of ORR Xd, XZR, Xm): 10101010000mmmmm00000011111ddddd */
+    u32 insn = 0xAA0003E0;
+    insn |= (dst & 0x1F) << 0;
+    insn |= (src & 0x1F) << 16;
+    emit_arm64_insn(buf, insn);
 }
 
 /* ============================================================================
@@ -196,7 +199,7 @@ void emit_movz(code_buffer_t *buf, uint8_t dst, uint16_t imm, uint8_t shift)
 {
     /* MOVZ Xd, #imm16, LSL #shift: 110100101000000000000000000ddddd */
     u32 insn = 0xD2800000;
-    insn |= (imm & 0xFFFF);
+    insn |= (u32)(imm & 0xFFFF) << 5;
     insn |= (shift & 0x3) << 21;
     insn |= (dst & 0x1F) << 0;
     emit_arm64_insn(buf, insn);
@@ -206,7 +209,7 @@ void emit_movk(code_buffer_t *buf, uint8_t dst, uint16_t imm, uint8_t shift)
 {
     /* MOVK Xd, #imm16, LSL #shift: 111100101000000000000000000ddddd */
     u32 insn = 0xF2800000;
-    insn |= (imm & 0xFFFF);
+    insn |= (u32)(imm & 0xFFFF) << 5;
     insn |= (shift & 0x3) << 21;
     insn |= (dst & 0x1F) << 0;
     emit_arm64_insn(buf, insn);
@@ -216,7 +219,7 @@ void emit_movn(code_buffer_t *buf, uint8_t dst, uint16_t imm, uint8_t shift)
 {
     /* MOVN Xd, #imm16, LSL #shift: 100100101000000000000000000ddddd */
     u32 insn = 0x92800000;
-    insn |= (imm & 0xFFFF);
+    insn |= (u32)(imm & 0xFFFF) << 5;
     insn |= (shift & 0x3) << 21;
     insn |= (dst & 0x1F) << 0;
     emit_arm64_insn(buf, insn);
@@ -327,6 +330,14 @@ void emit_br(code_buffer_t *buf, uint8_t src)
     emit_arm64_insn(buf, insn);
 }
 
+void emit_blr(code_buffer_t *buf, uint8_t src)
+{
+    /* BLR Xm: 1101011000111111000000mmmmm00000 */
+    u32 insn = 0xD63F0000;
+    insn |= (src & 0x1F) << 5;
+    emit_arm64_insn(buf, insn);
+}
+
 void emit_ret(code_buffer_t *buf)
 {
     /* RET: 110101100010000000000011110000 */
@@ -437,19 +448,434 @@ void emit_stp(code_buffer_t *buf, uint8_t src1, uint8_t src2, uint8_t base)
     emit_arm64_insn(buf, insn);
 }
 
+void emit_ldr_uoff(code_buffer_t *buf, uint8_t dst, uint8_t base, uint32_t offset)
+{
+    /* LDR Xt, [Xn, #pimm]: 1111100101iiiiiiiiiiiinnnnnttttt (pimm = imm12 * 8) */
+    u32 insn = 0xF9400000;
+    insn |= (dst & 0x1F) << 0;
+    insn |= (base & 0x1F) << 5;
+    insn |= ((offset >> 3) & 0xFFF) << 10;
+    emit_arm64_insn(buf, insn);
+}
+
+void emit_str_uoff(code_buffer_t *buf, uint8_t src, uint8_t base, uint32_t offset)
+{
+    /* STR Xt, [Xn, #pimm]: 1111100100iiiiiiiiiiiinnnnnttttt (pimm = imm12 * 8) */
+    u32 insn = 0xF9000000;
+    insn |= (src & 0x1F) << 0;
+    insn |= (base & 0x1F) << 5;
+    insn |= ((offset >> 3) & 0xFFF) << 10;
+    emit_arm64_insn(buf, insn);
+}
+
+static void emit_ldst_pair(code_buffer_t *buf, u32 opc, uint8_t rt1, uint8_t rt2,
+                           uint8_t base, int32_t offset)
+{
+    /* LDP/STP Xt1, Xt2 family: imm7 is the byte offset divided by 8 */
+    u32 insn = opc;
+    insn |= (rt1 & 0x1F) << 0;
+    insn |= (base & 0x1F) << 5;
+    insn |= (rt2 & 0x1F) << 10;
+    insn |= ((u32)(offset >> 3) & 0x7F) << 15;
+    emit_arm64_insn(buf, insn);
+}
+
+void emit_ldp_off(code_buffer_t *buf, uint8_t dst1, uint8_t dst2, uint8_t base, int32_t offset)
+{
+    /* LDP Xt1, Xt2, [Xn, #imm] */
+    emit_ldst_pair(buf, 0xA9400000, dst1, dst2, base, offset);
+}
+
+void emit_stp_off(code_buffer_t *buf, uint8_t src1, uint8_t src2, uint8_t base, int32_t offset)
+{
+    /* STP Xt1, Xt2, [Xn, #imm] */
+    emit_ldst_pair(buf, 0xA9000000, src1, src2, base, offset);
+}
+
+void emit_stp_pre(code_buffer_t *buf, uint8_t src1, uint8_t src2, uint8_t base, int32_t offset)
+{
+    /* STP Xt1, Xt2, [Xn, #imm]! */
+    emit_ldst_pair(buf, 0xA9800000, src1, src2, base, offset);
+}
+
+void emit_ldp_post(code_buffer_t *buf, uint8_t dst1, uint8_t dst2, uint8_t base, int32_t offset)
+{
+    /* LDP Xt1, Xt2, [Xn], #imm */
+    emit_ldst_pair(buf, 0xA8C00000, dst1, dst2, base, offset);
+}
+
+void emit_ldp_q_off(code_buffer_t *buf, uint8_t dst1, uint8_t dst2, uint8_t base, int32_t offset)
+{
+    /* LDP Qt1, Qt2, [Xn, #imm]: imm7 is the byte offset divided by 16 */
+    emit_ldst_pair(buf, 0xAD400000, dst1, dst2, base, offset >> 1);
+}
+
+void emit_stp_q_off(code_buffer_t *buf, uint8_t src1, uint8_t src2, uint8_t base, int32_t offset)
+{
+    /* STP Qt1, Qt2, [Xn, #imm] */
+    emit_ldst_pair(buf, 0xAD000000, src1, src2, base, offset >> 1);
+}
+
+void emit_push_q0_q15(code_buffer_t *buf)
+{
+    int i;
+
+    /* AAPCS64 lets the callee clobber V0-V7 and the upper halves of V8-V15 */
+    emit_sub_imm(buf, 31, 31, 256);
+    for (i = 0; i < 16; i += 2) {
+        emit_stp_q_off(buf, (uint8_t)i, (uint8_t)(i + 1), 31, i * 16);
+    }
+}
+
+void emit_pop_q0_q15(code_buffer_t *buf)
+{
+    int i;
+
+    for (i = 0; i < 16; i += 2) {
+        emit_ldp_q_off(buf, (uint8_t)i, (uint8_t)(i + 1), 31, i * 16);
+    }
+    emit_add_imm(buf, 31, 31, 256);
+}
+
 /* ============================================================================
  * Address Calculation
  * ============================================================================ */
 
 void emit_adr(code_buffer_t *buf, uint8_t dst, int32_t imm21)
 {
-    /* ADR Xd, rel: 00010000iiiiiiiiiiiiiiiiiiiiiiiii */
+    /* ADR Xd, rel: 0ii10000iiiiiiiiiiiiiiiiiiiddddd (immlo in 30:29, immhi in 23:5) */
     u32 insn = 0x10000000;
     insn |= (dst & 0x1F) << 0;
-    insn |= (imm21 & 0x1FFFFF) << 5;
+    insn |= ((u32)imm21 & 0x3) << 29;
+    insn |= (((u32)imm21 >> 2) & 0x7FFFF) << 5;
     emit_arm64_insn(buf, insn);
 }
 
+void emit_adrp(code_buffer_t *buf, uint8_t dst, int32_t pages)
+{
+    /* ADRP Xd, rel: 1ii10000iiiiiiiiiiiiiiiiiiiddddd, rel in 4KB pages */
+    u32 insn = 0x90000000;
+    insn |= (dst & 0x1F) << 0;
+    insn |= ((u32)pages & 0x3) << 29;
+    insn |= (((u32)pages >> 2) & 0x7FFFF) << 5;
+    emit_arm64_insn(buf, insn);
+}
+
+/* ============================================================================
+ * Immediate Materialization
+ * ============================================================================ */
+
+int arm64_encode_bitmask_imm(uint64_t value, int is_64, uint32_t *enc)
+{
+    unsigned size = 64, ones, rot, immr;
+    uint64_t mask, elem, imms;
+
+    if (!is_64) {
+        value &= 0xFFFFFFFFULL;
+        value |= value << 32;
+    }
+    if (value == 0 || value == ~0ULL) {
+        return 0;
+    }
+
+    /* Smallest element the value repeats */
+    while (size > 2) {
+        unsigned half = size / 2;
+        uint64_t m = (1ULL << half) - 1;
+        if ((value & m) != ((value >> half) & m)) {
+            break;
+        }
+        size = half;
+    }
+    mask = size == 64 ? ~0ULL : (1ULL << size) - 1;
+    elem = value & mask;
+    ones = (unsigned)__builtin_popcountll(elem);
+
+    /* The element must be a rotated run of ones */
+    for (rot = 0; rot < size; rot++) {
+        uint64_t r = rot ? ((elem >> rot) | (elem << (size - rot))) & mask : elem;
+        if (r == (1ULL << ones) - 1) {
+            break;
+        }
+    }
+    if (rot == size) {
+        return 0;
+    }
+
+    immr = (size - rot) & (size - 1);
+    imms = (~(uint64_t)(size - 1) << 1) | (ones - 1);
+    *enc = (((uint32_t)((imms >> 6) & 1) ^ 1) << 22) | (immr << 16) |
+           ((uint32_t)(imms & 0x3F) << 10);
+    return 1;
+}
+
+/* MOVZ chain, or MOVN chain if more halfwords are all-ones */
+static int arm64_mov_wide_seq(uint64_t value, uint8_t dst, uint32_t *seq)
+{
+    int zeros = 0, ones = 0, n = 0, hw, use_movn;
+
+    for (hw = 0; hw < 4; hw++) {
+        uint16_t h = (uint16_t)(value >> (hw * 16));
+        zeros += (h == 0);
+        ones += (h == 0xFFFF);
+    }
+    use_movn = ones > zeros;
+
+    for (hw = 0; hw < 4; hw++) {
+        uint16_t h = (uint16_t)(value >> (hw * 16));
+
+        if (h == (use_movn ? 0xFFFF : 0)) {
+            continue;
+        }
+        if (n == 0) {
+            seq[n++] = (use_movn ? 0x92800000u : 0xD2800000u) | ((uint32_t)hw << 21) |
+                       ((uint32_t)(uint16_t)(use_movn ? ~h : h) << 5) | dst;
+        } else {
+            seq[n++] = 0xF2800000u | ((uint32_t)hw << 21) | ((uint32_t)h << 5) | dst;
+        }
+    }
+    if (n == 0) {
+        seq[n++] = (use_movn ? 0x92800000u : 0xD2800000u) | dst;
+    }
+    return n;
+}
+
+int arm64_mov_imm_seq(uint64_t value, uint8_t dst, uint32_t *seq)
+{
+    uint32_t enc;
+    int n, hw, other;
+
+    dst &= 0x1F;
+    n = arm64_mov_wide_seq(value, dst, seq);
+    if (n == 1) {
+        return n;
+    }
+
+    /* W forms zero the upper half */
+    if ((value >> 32) == 0) {
+        uint32_t inv = ~(uint32_t)value;
+
+        if (arm64_encode_bitmask_imm(value, 0, &enc)) {
+            seq[0] = 0x320003E0u | enc | dst;               /* ORR Wd, WZR, #imm */
+            return 1;
+        }
+        if ((inv >> 16) == 0 || (inv & 0xFFFF) == 0) {
+            hw = (inv >> 16) ? 1 : 0;
+            seq[0] = 0x12800000u | ((uint32_t)hw << 21) |  /* MOVN Wd, #imm16 */
+                     ((inv >> (hw * 16)) & 0xFFFF) << 5 | dst;
+            return 1;
+        }
+    }
+    if (arm64_encode_bitmask_imm(value, 1, &enc)) {
+        seq[0] = 0xB20003E0u | enc | dst;                   /* ORR Xd, XZR, #imm */
+        return 1;
+    }
+
+    /* ORR #bitmask with one halfword patched by MOVK */
+    if (n > 2) {
+        for (hw = 0; hw < 4; hw++) {
+            uint64_t keep = value & ~(0xFFFFULL << (hw * 16));
+            uint16_t h = (uint16_t)(value >> (hw * 16));
+
+            for (other = -2; other < 4; other++) {
+                uint64_t fill = other == -2 ? 0 : other == -1 ? 0xFFFF :
+                                (value >> (other * 16)) & 0xFFFF;
+
+                if (other == hw ||
+                    !arm64_encode_bitmask_imm(keep | (fill << (hw * 16)), 1, &enc)) {
+                    continue;
+                }
+                seq[0] = 0xB20003E0u | enc | dst;
+                seq[1] = 0xF2800000u | ((uint32_t)hw << 21) | ((uint32_t)h << 5) | dst;
+                return 2;
+            }
+        }
+    }
+    return n;
+}
+
+int emit_mov_imm64(code_buffer_t *buf, uint8_t dst, uint64_t value)
+{
+    uint32_t seq[4];
+    int n = arm64_mov_imm_seq(value, dst, seq);
+    int i;
+
+    for (i = 0; i < n; i++) {
+        emit_arm64_insn(buf, seq[i]);
+    }
+    return n;
+}
+
+void arm64_imm_init(arm64_imm_ctx_t *ic, code_buffer_t *buf, uint64_t code_base,
+                    uint32_t cacheable)
+{
+    memset(ic, 0, sizeof(*ic));
+    ic->buf = buf;
+    ic->code_base = code_base;
+    ic->cacheable = cacheable;
+}
+
+void arm64_imm_invalidate(arm64_imm_ctx_t *ic, uint8_t reg)
+{
+    if (reg == ARM64_IMM_ALL_REGS) {
+        ic->valid = 0;
+    } else if (reg < 32) {
+        ic->valid &= ~(1u << reg);
+    }
+}
+
+static void arm64_imm_record(arm64_imm_ctx_t *ic, uint8_t dst, uint64_t value, int insns)
+{
+    ic->insns += (uint32_t)insns;
+    arm64_imm_invalidate(ic, dst);
+    if (dst < 32 && (ic->cacheable & (1u << dst))) {
+        ic->valid |= 1u << dst;
+        ic->reg_value[dst] = value;
+    }
+}
+
+/* MOV or ADD/SUB #imm12 from a register already holding a nearby value */
+static int arm64_imm_from_cache(arm64_imm_ctx_t *ic, uint8_t dst, uint64_t value)
+{
+    int r;
+
+    for (r = 0; r < 32; r++) {
+        int64_t delta;
+
+        if (!(ic->valid & (1u << r))) {
+            continue;
+        }
+        delta = (int64_t)(value - ic->reg_value[r]);
+        if (delta == 0) {
+            emit_mov_reg(ic->buf, dst, (uint8_t)r);
+        } else if (delta > 0 && delta < 4096) {
+            emit_add_imm(ic->buf, dst, (uint8_t)r, (uint16_t)delta);
+        } else if (delta < 0 && delta > -4096) {
+            emit_sub_imm(ic->buf, dst, (uint8_t)r, (uint16_t)-delta);
+        } else {
+            continue;
+        }
+        return 1;
+    }
+    return 0;
+}
+
+/* ADR, or ADRP (+ ADD) if that beats the plain sequence; 0 if neither */
+static int arm64_imm_pc_relative(arm64_imm_ctx_t *ic, uint8_t dst, uint64_t value, int cost)
+{
+    uint64_t pc = ic->code_base + ic->buf->offset;
+    int64_t delta = (int64_t)(value - pc);
+    int64_t pages = (int64_t)((value >> 12) - (pc >> 12));
+    uint32_t lo12 = (uint32_t)(value & 0xFFF);
+
+    if (ic->code_base == 0) {
+        return 0;
+    }
+    if (delta >= -(1 << 20) && delta < (1 << 20)) {
+        emit_adr(ic->buf, dst, (int32_t)delta);
+        return 1;
+    }
+    if (pages >= -(1 << 20) && pages < (1 << 20) && (lo12 ? 2 : 1) < cost) {
+        emit_adrp(ic->buf, dst, (int32_t)pages);
+        if (lo12) {
+            emit_add_imm(ic->buf, dst, dst, (uint16_t)lo12);
+        }
+        return lo12 ? 2 : 1;
+    }
+    return 0;
+}
+
+/* LDR Xd, =value; patched by arm64_imm_flush_pool() */
+static int arm64_imm_literal(arm64_imm_ctx_t *ic, uint8_t dst, uint64_t value)
+{
+    int slot;
+
+    if (ic->fixup_count >= ARM64_IMM_FIXUP_MAX) {
+        return 0;
+    }
+    for (slot = 0; slot < ic->pool_count && ic->pool[slot] != value; slot++) {
+    }
+    if (slot == ic->pool_count) {
+        if (ic->pool_count >= ARM64_IMM_POOL_MAX) {
+            return 0;
+        }
+        ic->pool[ic->pool_count++] = value;
+    }
+    ic->fixup_at[ic->fixup_count] = ic->buf->offset;
+    ic->fixup_slot[ic->fixup_count++] = (uint8_t)slot;
+    emit_arm64_insn(ic->buf, 0x58000000u | (dst & 0x1F));
+    return 1;
+}
+
+void arm64_imm_materialize(arm64_imm_ctx_t *ic, uint8_t dst, uint64_t value)
+{
+    uint32_t seq[4];
+    int cost, n, i;
+
+    if ((ic->valid & (1u << (dst & 0x1F))) && ic->reg_value[dst & 0x1F] == value) {
+        ic->reused++;
+        return;
+    }
+
+    cost = arm64_mov_imm_seq(value, dst, seq);
+    if (cost > 1 && arm64_imm_from_cache(ic, dst, value)) {
+        ic->reused++;
+        arm64_imm_record(ic, dst, value, 1);
+        return;
+    }
+    if (cost > 1 && (n = arm64_imm_pc_relative(ic, dst, value, cost)) > 0) {
+        ic->pc_relative++;
+        arm64_imm_record(ic, dst, value, n);
+        return;
+    }
+    if (cost > 3 && arm64_imm_literal(ic, dst, value)) {
+        ic->pooled++;
+        arm64_imm_record(ic, dst, value, 1);
+        return;
+    }
+
+    for (i = 0; i < cost; i++) {
+        emit_arm64_insn(ic->buf, seq[i]);
+    }
+    arm64_imm_record(ic, dst, value, cost);
+}
+
+int arm64_imm_flush_pool(arm64_imm_ctx_t *ic)
+{
+    code_buffer_t *buf = ic->buf;
+    uint32_t base;
+    int i;
+
+    if (ic->pool_count == 0) {
+        return 0;
+    }
+    if (buf->offset & 7) {
+        emit_nop(buf);
+    }
+    base = buf->offset;
+    for (i = 0; i < ic->pool_count; i++) {
+        emit_word32_arm64(buf, (u32)ic->pool[i]);
+        emit_word32_arm64(buf, (u32)(ic->pool[i] >> 32));
+    }
+
+    for (i = 0; i < ic->fixup_count && !buf->error; i++) {
+        uint32_t at = ic->fixup_at[i];
+        int64_t words = ((int64_t)base + ic->fixup_slot[i] * 8 - at) / 4;
+        uint32_t insn;
+
+        if (words >= (1 << 18)) {
+            return -1;
+        }
+        memcpy(&insn, buf->buffer + at, 4);
+        insn |= ((uint32_t)words & 0x7FFFF) << 5;
+        memcpy(buf->buffer + at, &insn, 4);
+    }
+
+    ic->pool_count = 0;
+    ic->fixup_count = 0;
+    return 0;
+}
+
 /* ============================================================================
  * System Instructions
  * ============================================================================ */
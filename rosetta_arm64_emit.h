@@ -100,6 +100,7 @@ void emit_b(code_buffer_t *buf, int32_t imm26);
 void emit_bl(code_buffer_t *buf, int32_t imm26);
 void emit_bcond(code_buffer_t *buf, uint8_t cond, int32_t imm19);
 void emit_br(code_buffer_t *buf, uint8_t src);
+void emit_blr(code_buffer_t *buf, uint8_t src);
 void emit_ret(code_buffer_t *buf);
 void emit_cbnz(code_buffer_t *buf, uint8_t src, int32_t imm19);
 void emit_cbz(code_buffer_t *buf, uint8_t src, int32_t imm19);
@@ -117,11 +118,110 @@ void emit_str_reg(code_buffer_t *buf, uint8_t src, uint8_t base, uint8_t offset)
 void emit_ldp(code_buffer_t *buf, uint8_t dst1, uint8_t dst2, uint8_t base);
 void emit_stp(code_buffer_t *buf, uint8_t src1, uint8_t src2, uint8_t base);
 
+/* 64-bit forms with byte offsets (scaled by 8 in the encoding) */
+void emit_ldr_uoff(code_buffer_t *buf, uint8_t dst, uint8_t base, uint32_t offset);
+void emit_str_uoff(code_buffer_t *buf, uint8_t src, uint8_t base, uint32_t offset);
+void emit_ldp_off(code_buffer_t *buf, uint8_t dst1, uint8_t dst2, uint8_t base, int32_t offset);
+void emit_stp_off(code_buffer_t *buf, uint8_t src1, uint8_t src2, uint8_t base, int32_t offset);
+void emit_stp_pre(code_buffer_t *buf, uint8_t src1, uint8_t src2, uint8_t base, int32_t offset);
+void emit_ldp_post(code_buffer_t *buf, uint8_t dst1, uint8_t dst2, uint8_t base, int32_t offset);
+
+/* 128-bit Q register pairs, byte offsets (scaled by 16 in the encoding) */
+void emit_ldp_q_off(code_buffer_t *buf, uint8_t dst1, uint8_t dst2, uint8_t base, int32_t offset);
+void emit_stp_q_off(code_buffer_t *buf, uint8_t src1, uint8_t src2, uint8_t base, int32_t offset);
+
+/* Q0-Q15 (guest XMM0-15) to and from a 256-byte stack frame, around C calls */
+void emit_push_q0_q15(code_buffer_t *buf);
+void emit_pop_q0_q15(code_buffer_t *buf);
+
 /* ============================================================================
  * Address Calculation
  * ============================================================================ */
 
 void emit_adr(code_buffer_t *buf, uint8_t dst, int32_t imm21);
+void emit_adrp(code_buffer_t *buf, uint8_t dst, int32_t pages);
+
+/* ============================================================================
+ * Immediate Materialization
+ * ============================================================================ */
+
+#define ARM64_IMM_POOL_MAX      32      /* Literals per block */
+#define ARM64_IMM_FIXUP_MAX     64      /* LDR (literal) sites per block */
+
+/**
+ * Encode value as a logical (bitmask) immediate
+ * @param is_64 Encode for the X form; the W form uses the low 32 bits
+ * @param enc Receives N:immr:imms in instruction bits 22..10
+ * @return 1 if encodable, 0 otherwise
+ */
+int arm64_encode_bitmask_imm(uint64_t value, int is_64, uint32_t *enc);
+
+/**
+ * Shortest standalone sequence that puts value in dst: a MOVZ or MOVN
+ * chain, a single ORR #bitmask (X or W form), or ORR #bitmask + MOVK
+ * @param seq Receives up to 4 instruction words
+ * @return Number of instructions
+ */
+int arm64_mov_imm_seq(uint64_t value, uint8_t dst, uint32_t *seq);
+
+/**
+ * Emit the arm64_mov_imm_seq() sequence
+ * @return Number of instructions emitted
+ */
+int emit_mov_imm64(code_buffer_t *buf, uint8_t dst, uint64_t value);
+
+/**
+ * Per-block immediate synthesizer
+ *
+ * On top of emit_mov_imm64() it reuses constants already sitting in
+ * registers the caller marked cacheable (MOV or ADD/SUB #imm12 from
+ * them), forms addresses near the code with ADR/ADRP when code_base is
+ * known, and loads constants that would need four instructions from a
+ * literal pool placed after the block by arm64_imm_flush_pool().
+ *
+ * The caller must call arm64_imm_invalidate() whenever it writes a
+ * cacheable register itself, across calls, and at branch targets.
+ */
+typedef struct {
+    code_buffer_t *buf;
+    uint64_t code_base;                         /* Runtime address of buf->buffer[0], 0 if unknown */
+    uint32_t cacheable;                         /* Registers whose values may be reused */
+    uint32_t valid;                             /* Registers holding reg_value[] */
+    uint64_t reg_value[32];
+
+    uint64_t pool[ARM64_IMM_POOL_MAX];
+    uint32_t fixup_at[ARM64_IMM_FIXUP_MAX];     /* Offsets of LDR (literal) words */
+    uint8_t fixup_slot[ARM64_IMM_FIXUP_MAX];
+    uint8_t pool_count;
+    uint8_t fixup_count;
+
+    /* Statistics */
+    uint32_t insns;                             /* Instructions emitted for constants */
+    uint32_t reused;                            /* Served from a cached register */
+    uint32_t pc_relative;                       /* ADR/ADRP forms */
+    uint32_t pooled;                            /* LDR (literal) forms */
+} arm64_imm_ctx_t;
+
+void arm64_imm_init(arm64_imm_ctx_t *ic, code_buffer_t *buf, uint64_t code_base,
+                    uint32_t cacheable);
+
+/**
+ * Put value in dst using the cheapest available form
+ */
+void arm64_imm_materialize(arm64_imm_ctx_t *ic, uint8_t dst, uint64_t value);
+
+/**
+ * Forget the value cached in reg (ARM64_IMM_ALL_REGS forgets all)
+ */
+#define ARM64_IMM_ALL_REGS  0xFF
+void arm64_imm_invalidate(arm64_imm_ctx_t *ic, uint8_t reg);
+
+/**
+ * Emit the literal pool at the current offset and patch its loads; the
+ * caller places it where execution cannot fall into it
+ * @return 0 on success, -1 if a load cannot reach its literal
+ */
+int arm64_imm_flush_pool(arm64_imm_ctx_t *ic);
 
 /* ============================================================================
  * System Instructions
@@ -0,0 +1,240 @@
+/* ============================================================================
+ * Rosetta Translator - Per-Block Execution Profiling
+ * ============================================================================
+ *
+ * Counter sets are handed out from chunks that are never freed and found
+ * again through a small hash table keyed by guest pc. Creation happens at
+ * translation time under a mutex; the counters themselves are only written
+ * by translated code and read here without synchronization.
+ * ============================================================================ */
+
+#include "rosetta_block_profile.h"
+#include "rosetta_refactored_stats.h"
+#include "rosetta_arm64_emit.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* ============================================================================
+ * Profile State
+ * ============================================================================ */
+
+typedef struct profile_chunk {
+    struct profile_chunk *next;
+    uint32_t used;
+    rosetta_block_profile_t blocks[ROS_PROFILE_CHUNK];
+} profile_chunk_t;
+
+static pthread_mutex_t g_profile_lock = PTHREAD_MUTEX_INITIALIZER;
+static rosetta_block_profile_t *g_profile_hash[1u << ROS_PROFILE_HASH_BITS];
+static profile_chunk_t *g_chunks;
+static int g_profile_enabled;
+
+static uint32_t profile_hash(uint64_t guest_pc)
+{
+    return (uint32_t)((guest_pc * 0x9E3779B97F4A7C15ULL) >> (64 - ROS_PROFILE_HASH_BITS));
+}
+
+static uint64_t load_counter(const uint64_t *counter)
+{
+    return __atomic_load_n(counter, __ATOMIC_RELAXED);
+}
+
+/* ============================================================================
+ * Instrumentation
+ * ============================================================================ */
+
+void rosetta_profile_set_enabled(int enabled)
+{
+    __atomic_store_n(&g_profile_enabled, enabled != 0, __ATOMIC_RELAXED);
+}
+
+int rosetta_profile_enabled(void)
+{
+    return __atomic_load_n(&g_profile_enabled, __ATOMIC_RELAXED);
+}
+
+uint64_t *rosetta_profile_counters(uint64_t guest_pc, uint32_t guest_insns)
+{
+    uint32_t h = profile_hash(guest_pc);
+    rosetta_block_profile_t *p;
+
+    pthread_mutex_lock(&g_profile_lock);
+
+    /* A retranslated block keeps counting into the same set */
+    for (p = g_profile_hash[h]; p != NULL; p = p->next) {
+        if (p->guest_pc == guest_pc) {
+            p->guest_insns = guest_insns;
+            pthread_mutex_unlock(&g_profile_lock);
+            return p->counters;
+        }
+    }
+
+    if (!g_chunks || g_chunks->used == ROS_PROFILE_CHUNK) {
+        profile_chunk_t *chunk = calloc(1, sizeof(*chunk));
+        if (!chunk) {
+            pthread_mutex_unlock(&g_profile_lock);
+            return NULL;
+        }
+        chunk->next = g_chunks;
+        g_chunks = chunk;
+    }
+
+    p = &g_chunks->blocks[g_chunks->used++];
+    p->guest_pc = guest_pc;
+    p->guest_insns = guest_insns;
+    p->next = g_profile_hash[h];
+    g_profile_hash[h] = p;
+
+    pthread_mutex_unlock(&g_profile_lock);
+    return p->counters;
+}
+
+void rosetta_profile_instrument(ir_block_t *blk)
+{
+    blk->exec_counters = rosetta_profile_enabled() ?
+        rosetta_profile_counters(blk->guest_pc, blk->guest_insns) : NULL;
+}
+
+uint64_t *rosetta_profile_emit_entry(code_buffer_t *buf, uint64_t guest_pc)
+{
+    uint64_t *counters;
+
+    if (!rosetta_profile_enabled()) {
+        return NULL;
+    }
+    counters = rosetta_profile_counters(guest_pc, 0);
+    if (!counters) {
+        return NULL;
+    }
+
+    /* Same sequence as the IR back-end's entry count */
+    emit_mov_imm64(buf, 16, (uint64_t)(uintptr_t)&counters[IR_PROF_ENTRY]);
+    emit_ldr_uoff(buf, 17, 16, 0);
+    emit_add_imm(buf, 17, 17, 1);
+    emit_str_uoff(buf, 17, 16, 0);
+    return counters;
+}
+
+/* ============================================================================
+ * Reporting
+ * ============================================================================ */
+
+size_t rosetta_profile_hot_blocks(rosetta_block_profile_t *out, size_t count)
+{
+    size_t found = 0;
+
+    if (!out || count == 0) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&g_profile_lock);
+    for (profile_chunk_t *chunk = g_chunks; chunk != NULL; chunk = chunk->next) {
+        for (uint32_t i = 0; i < chunk->used; i++) {
+            rosetta_block_profile_t snap = chunk->blocks[i];
+            size_t at;
+
+            for (int s = 0; s < IR_PROF_SLOTS; s++) {
+                snap.counters[s] = load_counter(&chunk->blocks[i].counters[s]);
+            }
+            snap.next = NULL;
+
+            /* Insertion into the sorted top list */
+            at = found;
+            while (at > 0 && out[at - 1].counters[IR_PROF_ENTRY] <
+                                 snap.counters[IR_PROF_ENTRY]) {
+                at--;
+            }
+            if (at >= count) {
+                continue;
+            }
+            if (found < count) {
+                found++;
+            }
+            memmove(&out[at + 1], &out[at], (found - 1 - at) * sizeof(*out));
+            out[at] = snap;
+        }
+    }
+    pthread_mutex_unlock(&g_profile_lock);
+
+    return found;
+}
+
+void rosetta_profile_publish(void)
+{
+    pthread_mutex_lock(&g_profile_lock);
+    for (profile_chunk_t *chunk = g_chunks; chunk != NULL; chunk = chunk->next) {
+        for (uint32_t i = 0; i < chunk->used; i++) {
+            rosetta_block_profile_t *p = &chunk->blocks[i];
+            rosetta_stats_set_block_hits(p->guest_pc,
+                                         load_counter(&p->counters[IR_PROF_ENTRY]));
+        }
+    }
+    pthread_mutex_unlock(&g_profile_lock);
+}
+
+void rosetta_profile_dump(FILE *out, rosetta_elf_binary_t *binary, size_t count)
+{
+    rosetta_block_profile_t *hot;
+    uint64_t total = 0, insns = 0;
+    size_t n;
+
+    if (!out || count == 0) {
+        return;
+    }
+    hot = malloc(count * sizeof(*hot));
+    if (!hot) {
+        return;
+    }
+
+    pthread_mutex_lock(&g_profile_lock);
+    for (profile_chunk_t *chunk = g_chunks; chunk != NULL; chunk = chunk->next) {
+        for (uint32_t i = 0; i < chunk->used; i++) {
+            uint64_t entries = load_counter(&chunk->blocks[i].counters[IR_PROF_ENTRY]);
+            total += entries;
+            insns += entries * chunk->blocks[i].guest_insns;
+        }
+    }
+    pthread_mutex_unlock(&g_profile_lock);
+
+    n = rosetta_profile_hot_blocks(hot, count);
+
+    fprintf(out, "\n=== Block Profile ===\n");
+    fprintf(out, "Block entries: %llu, guest instructions: %llu\n\n",
+            (unsigned long long)total, (unsigned long long)insns);
+    fprintf(out, "  %-18s %12s %6s %12s %12s  %s\n",
+            "guest pc", "entries", "share", "taken", "fall-thru", "symbol");
+
+    for (size_t i = 0; i < n && hot[i].counters[IR_PROF_ENTRY] > 0; i++) {
+        const rosetta_block_profile_t *p = &hot[i];
+        uint64_t off = 0;
+        const char *sym = binary ? rosetta_elf_symbolize(binary, p->guest_pc, &off) : NULL;
+        double share = total ? 100.0 * (double)p->counters[IR_PROF_ENTRY] / (double)total : 0.0;
+
+        fprintf(out, "  0x%016llx %12llu %5.1f%% %12llu %12llu  ",
+                (unsigned long long)p->guest_pc,
+                (unsigned long long)p->counters[IR_PROF_ENTRY], share,
+                (unsigned long long)p->counters[IR_PROF_TAKEN],
+                (unsigned long long)p->counters[IR_PROF_FALLTHROUGH]);
+        if (sym) {
+            fprintf(out, "%s+0x%llx\n", sym, (unsigned long long)off);
+        } else {
+            fprintf(out, "?\n");
+        }
+    }
+
+    free(hot);
+}
+
+void rosetta_profile_reset(void)
+{
+    pthread_mutex_lock(&g_profile_lock);
+    for (profile_chunk_t *chunk = g_chunks; chunk != NULL; chunk = chunk->next) {
+        for (uint32_t i = 0; i < chunk->used; i++) {
+            for (int s = 0; s < IR_PROF_SLOTS; s++) {
+                __atomic_store_n(&chunk->blocks[i].counters[s], 0, __ATOMIC_RELAXED);
+            }
+        }
+    }
+    pthread_mutex_unlock(&g_profile_lock);
+}
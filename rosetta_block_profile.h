@@ -0,0 +1,124 @@
+/* ============================================================================
+ * Rosetta Translator - Per-Block Execution Profiling
+ * ============================================================================
+ *
+ * Optional instrumentation that counts how often each translated block runs.
+ * When enabled, rosetta_profile_instrument() hands a lowered block a set of
+ * IR_PROF_SLOTS counters and the back-ends emit an increment at the block
+ * entry and at each exit. The increments run inside the translated code, so
+ * blocks entered through a chain are counted as well as dispatcher entries.
+ *
+ * Counters are plain, non-atomic 64-bit words: blocks racing on another
+ * thread may lose an occasional increment, which is fine for a profile and
+ * keeps the instrumentation at three instructions. Counter storage is never
+ * freed, since translated code keeps its address baked in.
+ *
+ * Blocks the IR does not cover are translated instruction by instruction
+ * and only count their entries, through rosetta_profile_emit_entry(); their
+ * taken and fall-through counters stay zero.
+ *
+ * The runner enables profiling from config.profile or ROS_PROFILE_ENV and
+ * prints the hottest blocks when the guest exits.
+ * ============================================================================ */
+
+#ifndef ROSETTA_BLOCK_PROFILE_H
+#define ROSETTA_BLOCK_PROFILE_H
+
+#include "rosetta_ir.h"
+#include "rosetta_elf_loader.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/* ============================================================================
+ * Profile Types
+ * ============================================================================ */
+
+#define ROS_PROFILE_HASH_BITS   12
+#define ROS_PROFILE_CHUNK       256     /* Blocks per allocation */
+
+/* Environment variable enabling the profile: number of hot blocks to print */
+#define ROS_PROFILE_ENV         "ROSETTA_PROFILE"
+
+/**
+ * Execution counts for one translated guest block
+ */
+typedef struct rosetta_block_profile {
+    uint64_t counters[IR_PROF_SLOTS];   /* Bumped by the translated code */
+    uint64_t guest_pc;
+    uint32_t guest_insns;
+    struct rosetta_block_profile *next; /* Hash chain */
+} rosetta_block_profile_t;
+
+/* ============================================================================
+ * Instrumentation
+ * ============================================================================ */
+
+/**
+ * Enable or disable instrumentation of newly translated blocks
+ * @param enabled Non-zero to instrument; blocks already emitted keep counting
+ */
+void rosetta_profile_set_enabled(int enabled);
+
+/**
+ * @return Non-zero if new blocks are instrumented
+ */
+int rosetta_profile_enabled(void);
+
+/**
+ * Get the counters for the block at guest_pc, creating them on first use
+ * @param guest_pc Block start
+ * @param guest_insns Guest instructions in the block
+ * @return IR_PROF_SLOTS counters, or NULL if out of memory
+ */
+uint64_t *rosetta_profile_counters(uint64_t guest_pc, uint32_t guest_insns);
+
+/**
+ * Point blk->exec_counters at the block's counters when profiling is
+ * enabled; call between lowering and emission
+ */
+void rosetta_profile_instrument(ir_block_t *blk);
+
+/**
+ * Emit the entry count for a block translated outside the IR; clobbers
+ * X16 and X17. Call rosetta_profile_counters() again once the block's
+ * instruction count is known.
+ * @param buf ARM64 code buffer, at the block entry
+ * @param guest_pc Block start
+ * @return The block's counters, or NULL if profiling is disabled and
+ *         nothing was emitted
+ */
+uint64_t *rosetta_profile_emit_entry(code_buffer_t *buf, uint64_t guest_pc);
+
+/* ============================================================================
+ * Reporting
+ * ============================================================================ */
+
+/**
+ * Copy the most executed blocks, hottest first
+ * @param out Output array
+ * @param count Capacity of out
+ * @return Number of blocks copied
+ */
+size_t rosetta_profile_hot_blocks(rosetta_block_profile_t *out, size_t count);
+
+/**
+ * Copy entry counts into the statistics block table, so
+ * rosetta_stats_get_hot_blocks() ranks blocks by executions
+ */
+void rosetta_profile_publish(void);
+
+/**
+ * Print the hottest blocks with their share of all block entries
+ * @param out Output stream
+ * @param binary Guest binary for symbol names, may be NULL
+ * @param count Number of blocks to print
+ */
+void rosetta_profile_dump(FILE *out, rosetta_elf_binary_t *binary, size_t count);
+
+/**
+ * Zero all counters, keeping their storage
+ */
+void rosetta_profile_reset(void);
+
+#endif /* ROSETTA_BLOCK_PROFILE_H */
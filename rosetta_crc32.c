@@ -0,0 +1,282 @@
+/* ============================================================================
+ * Rosetta Translator - Host CRC32/CRC32C Implementation
+ * ============================================================================
+ *
+ * Slicing-by-8 tables for every host, plus SSE4.2 and PCLMULQDQ kernels on
+ * x86_64 compiled with target attributes so the rest of the file builds
+ * for the baseline ISA. The kernels are only called once
+ * __builtin_cpu_supports() has vouched for them.
+ * ============================================================================ */
+
+#include "rosetta_crc32.h"
+#include <errno.h>
+#include <pthread.h>
+#include <string.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define SSE42   __attribute__((target("sse4.2")))
+#define PCLMUL  __attribute__((target("pclmul,sse2")))
+#endif
+
+static const uint32_t g_poly_reflected[2] = {
+    [ROS_CRC32_IEEE]       = 0xEDB88320u,
+    [ROS_CRC32_CASTAGNOLI] = 0x82F63B78u,
+};
+
+static const rosetta_crc32_clmul_t g_clmul[2] = {
+    [ROS_CRC32_IEEE] = {
+        .k1 = 0xCCAA009Eull, .k2 = 0xB8BC6765ull,
+        .mu = 0x1F7011641ull, .p = 0x1DB710641ull,
+    },
+    [ROS_CRC32_CASTAGNOLI] = {
+        .k1 = 0x493C7D27ull, .k2 = 0xDD45AAB8ull,
+        .mu = 0x0DEA713F1ull, .p = 0x105EC76F1ull,
+    },
+};
+
+static uint32_t g_tables[2][8][256];
+static uint32_t g_hw_supported;
+static uint32_t g_hw;
+static pthread_once_t g_crc_once = PTHREAD_ONCE_INIT;
+
+/* ============================================================================
+ * Initialisation and Selection
+ * ============================================================================ */
+
+static void crc32_init_once(void)
+{
+    for (int poly = 0; poly < 2; poly++) {
+        uint32_t (*t)[256] = g_tables[poly];
+
+        for (uint32_t b = 0; b < 256; b++) {
+            uint32_t c = b;
+            for (int i = 0; i < 8; i++) {
+                c = (c >> 1) ^ ((c & 1) ? g_poly_reflected[poly] : 0);
+            }
+            t[0][b] = c;
+        }
+        for (int k = 1; k < 8; k++) {
+            for (uint32_t b = 0; b < 256; b++) {
+                t[k][b] = (t[k - 1][b] >> 8) ^ t[0][t[k - 1][b] & 0xFF];
+            }
+        }
+    }
+
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse4.2")) {
+        g_hw_supported |= ROS_CRC32_HW_SSE42;
+    }
+    if (__builtin_cpu_supports("pclmul")) {
+        g_hw_supported |= ROS_CRC32_HW_PCLMUL;
+    }
+#endif
+    __atomic_store_n(&g_hw, g_hw_supported, __ATOMIC_RELEASE);
+}
+
+void rosetta_crc32_init(void)
+{
+    pthread_once(&g_crc_once, crc32_init_once);
+}
+
+uint32_t rosetta_crc32_hw_supported(void)
+{
+    rosetta_crc32_init();
+    return g_hw_supported;
+}
+
+uint32_t rosetta_crc32_hw(void)
+{
+    rosetta_crc32_init();
+    return __atomic_load_n(&g_hw, __ATOMIC_ACQUIRE);
+}
+
+int rosetta_crc32_set_hw(uint32_t hw)
+{
+    rosetta_crc32_init();
+    if (hw & ~g_hw_supported) {
+        return -ENOTSUP;
+    }
+    __atomic_store_n(&g_hw, hw, __ATOMIC_RELEASE);
+    return 0;
+}
+
+const uint32_t (*rosetta_crc32_tables(rosetta_crc32_poly_t poly))[256]
+{
+    rosetta_crc32_init();
+    return (const uint32_t (*)[256])g_tables[poly & 1];
+}
+
+const rosetta_crc32_clmul_t *rosetta_crc32_clmul_consts(rosetta_crc32_poly_t poly)
+{
+    return &g_clmul[poly & 1];
+}
+
+/* ============================================================================
+ * Table Implementation
+ * ============================================================================ */
+
+static uint32_t table_step(const uint32_t (*t)[256], uint32_t crc,
+                           uint64_t data, unsigned bytes)
+{
+    uint64_t v;
+    uint32_t r;
+
+    if (bytes >= 8) {
+        v = crc ^ data;
+        return t[7][v & 0xFF] ^ t[6][(v >> 8) & 0xFF] ^
+               t[5][(v >> 16) & 0xFF] ^ t[4][(v >> 24) & 0xFF] ^
+               t[3][(v >> 32) & 0xFF] ^ t[2][(v >> 40) & 0xFF] ^
+               t[1][(v >> 48) & 0xFF] ^ t[0][v >> 56];
+    }
+
+    /* Bytes of crc above the data width just shift down */
+    v = crc ^ (data & ((1ull << (bytes * 8)) - 1));
+    r = bytes < 4 ? crc >> (bytes * 8) : 0;
+    for (unsigned k = 0; k < bytes; k++) {
+        r ^= t[bytes - 1 - k][(v >> (k * 8)) & 0xFF];
+    }
+    return r;
+}
+
+static uint32_t table_buf(const uint32_t (*t)[256], uint32_t crc,
+                          const uint8_t *p, size_t len)
+{
+    for (; len >= 8; p += 8, len -= 8) {
+        uint64_t w;
+        memcpy(&w, p, sizeof(w));
+        crc = table_step(t, crc, w, 8);
+    }
+    for (; len > 0; p++, len--) {
+        crc = (crc >> 8) ^ t[0][(crc ^ *p) & 0xFF];
+    }
+    return crc;
+}
+
+/* ============================================================================
+ * x86_64 Kernels
+ * ============================================================================ */
+
+#if defined(__x86_64__)
+
+static SSE42 uint32_t sse42_step(uint32_t crc, uint64_t data, unsigned bytes)
+{
+    switch (bytes) {
+    case 1:  return _mm_crc32_u8(crc, (uint8_t)data);
+    case 2:  return _mm_crc32_u16(crc, (uint16_t)data);
+    case 4:  return _mm_crc32_u32(crc, (uint32_t)data);
+    default: return (uint32_t)_mm_crc32_u64(crc, data);
+    }
+}
+
+static SSE42 uint32_t sse42_buf(uint32_t crc, const uint8_t *p, size_t len)
+{
+    uint64_t c = crc;
+
+    for (; len >= 8; p += 8, len -= 8) {
+        uint64_t w;
+        memcpy(&w, p, sizeof(w));
+        c = _mm_crc32_u64(c, w);
+    }
+    for (; len > 0; p++, len--) {
+        c = _mm_crc32_u8((uint32_t)c, *p);
+    }
+    return (uint32_t)c;
+}
+
+/* Low 64 bits of a carry-less product; callers keep it under 64 bits */
+static inline PCLMUL uint64_t clmul(uint64_t a, uint64_t b)
+{
+    return (uint64_t)_mm_cvtsi128_si64(
+        _mm_clmulepi64_si128(_mm_cvtsi64_si128((long long)a),
+                             _mm_cvtsi64_si128((long long)b), 0x00));
+}
+
+static inline PCLMUL uint32_t clmul_barrett32(const rosetta_crc32_clmul_t *k, uint32_t v)
+{
+    return (uint32_t)(clmul(clmul(v, k->mu) & 0xFFFFFFFFu, k->p) >> 32);
+}
+
+static inline PCLMUL uint32_t clmul_barrett64(const rosetta_crc32_clmul_t *k, uint64_t v)
+{
+    uint64_t t = clmul(clmul(v & 0xFFFFFFFFu, k->mu) & 0xFFFFFFFFu, k->p);
+    return clmul_barrett32(k, (uint32_t)((v ^ t) >> 32));
+}
+
+static inline PCLMUL uint64_t clmul_fold(const rosetta_crc32_clmul_t *k, uint64_t v)
+{
+    return clmul(v & 0xFFFFFFFFu, k->k1) ^ clmul(v >> 32, k->k2);
+}
+
+static PCLMUL uint32_t pclmul_step(const rosetta_crc32_clmul_t *k, uint32_t crc,
+                                   uint64_t data, unsigned bytes)
+{
+    if (bytes == 4) {
+        return clmul_barrett32(k, crc ^ (uint32_t)data);
+    }
+    return clmul_barrett64(k, crc ^ data);
+}
+
+static PCLMUL uint32_t pclmul_buf(const rosetta_crc32_clmul_t *k, const uint32_t (*t)[256],
+                                  uint32_t crc, const uint8_t *p, size_t len)
+{
+    if (len >= 16) {
+        uint64_t v, w;
+
+        memcpy(&w, p, sizeof(w));
+        v = crc ^ w;
+        for (p += 8, len -= 8; len >= 8; p += 8, len -= 8) {
+            memcpy(&w, p, sizeof(w));
+            v = clmul_fold(k, v) ^ w;
+        }
+        crc = clmul_barrett64(k, v);
+    }
+    return table_buf(t, crc, p, len);
+}
+
+#endif /* __x86_64__ */
+
+/* ============================================================================
+ * Public Entry Points
+ * ============================================================================ */
+
+uint32_t rosetta_crc32_step(rosetta_crc32_poly_t poly, uint32_t crc,
+                            uint64_t data, unsigned bytes)
+{
+    uint32_t hw = rosetta_crc32_hw();
+
+    poly &= 1;
+#if defined(__x86_64__)
+    if (poly == ROS_CRC32_CASTAGNOLI && (hw & ROS_CRC32_HW_SSE42)) {
+        return sse42_step(crc, data, bytes);
+    }
+    if ((hw & ROS_CRC32_HW_PCLMUL) && bytes >= 4) {
+        return pclmul_step(&g_clmul[poly], crc, data, bytes);
+    }
+#else
+    (void)hw;
+#endif
+    return table_step((const uint32_t (*)[256])g_tables[poly], crc, data, bytes);
+}
+
+uint32_t rosetta_crc32_buf(rosetta_crc32_poly_t poly, uint32_t crc,
+                           const void *buf, size_t len)
+{
+    const uint8_t *p = (const uint8_t *)buf;
+    uint32_t hw = rosetta_crc32_hw();
+
+    poly &= 1;
+#if defined(__x86_64__)
+    if (poly == ROS_CRC32_CASTAGNOLI && (hw & ROS_CRC32_HW_SSE42)) {
+        return sse42_buf(crc, p, len);
+    }
+    if (hw & ROS_CRC32_HW_PCLMUL) {
+        return pclmul_buf(&g_clmul[poly], (const uint32_t (*)[256])g_tables[poly],
+                          crc, p, len);
+    }
+#else
+    (void)hw;
+#endif
+    return table_buf((const uint32_t (*)[256])g_tables[poly], crc, p, len);
+}
@@ -0,0 +1,111 @@
+/* ============================================================================
+ * Rosetta Translator - Host CRC32/CRC32C Header
+ * ============================================================================
+ *
+ * CRC32 (IEEE 802.3, 0xEDB88320) and CRC32C (Castagnoli, 0x82F63B78) with
+ * the ARM64 CRC32 instruction semantics: bit-reflected, no pre- or
+ * post-inversion, 32-bit accumulator in, 32-bit CRC out.
+ *
+ * Three implementations are available and the best one the CPU supports is
+ * picked once, at rosetta_crc32_init() or on first use:
+ *   - SSE4.2 CRC32 instruction (CRC32C only, the x86 instruction is
+ *     hard-wired to the Castagnoli polynomial)
+ *   - PCLMULQDQ Barrett reduction and 64-bit folding (either polynomial)
+ *   - Slicing-by-8 tables (either polynomial, any host)
+ *
+ * The tables and the carry-less multiply constants are exported so the IR
+ * x86 back-end can emit the same sequences inline.
+ * ============================================================================ */
+
+#ifndef ROSETTA_CRC32_H
+#define ROSETTA_CRC32_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef enum {
+    ROS_CRC32_IEEE = 0,
+    ROS_CRC32_CASTAGNOLI = 1,
+} rosetta_crc32_poly_t;
+
+/* Host features rosetta_crc32_hw() may report */
+#define ROS_CRC32_HW_SSE42      0x1     /* x86 CRC32 instruction */
+#define ROS_CRC32_HW_PCLMUL     0x2     /* PCLMULQDQ */
+
+/**
+ * Carry-less multiply constants for one polynomial, all bit-reflected.
+ *
+ * Barrett: t = lo32(clmul(lo32(v), mu)); crc = clmul(t, p) >> 32.
+ * Fold:    v' = clmul(lo32(v), k1) ^ clmul(hi32(v), k2) is congruent to
+ *          v shifted past 64 more bits, so CRC32X(CRC32X(c, d0), d1) ==
+ *          CRC32X(0, fold(c ^ d0) ^ d1).
+ */
+typedef struct {
+    uint64_t k1;        /* x^95 mod P */
+    uint64_t k2;        /* x^63 mod P */
+    uint64_t mu;        /* floor(x^64 / P) */
+    uint64_t p;         /* P including the x^32 term */
+} rosetta_crc32_clmul_t;
+
+/**
+ * rosetta_crc32_init - Build the tables and pick the host implementation
+ *
+ * Idempotent; every entry point below also initialises on first use.
+ */
+void rosetta_crc32_init(void);
+
+/**
+ * rosetta_crc32_hw_supported - Features this CPU has (ROS_CRC32_HW_*)
+ */
+uint32_t rosetta_crc32_hw_supported(void);
+
+/**
+ * rosetta_crc32_hw - Features currently in use (ROS_CRC32_HW_*)
+ */
+uint32_t rosetta_crc32_hw(void);
+
+/**
+ * rosetta_crc32_set_hw - Restrict the features in use
+ * @param hw ROS_CRC32_HW_* mask; 0 forces the table implementation
+ * @return 0 on success, -ENOTSUP if hw names a feature this CPU lacks
+ *
+ * Affects both the host functions and code the IR back-end emits afterwards.
+ */
+int rosetta_crc32_set_hw(uint32_t hw);
+
+/**
+ * rosetta_crc32_tables - Slicing-by-8 tables for a polynomial
+ *
+ * Table k maps a byte b to the CRC of b followed by k zero bytes;
+ * table 0 is the classic byte-at-a-time table.
+ */
+const uint32_t (*rosetta_crc32_tables(rosetta_crc32_poly_t poly))[256];
+
+/**
+ * rosetta_crc32_clmul_consts - Carry-less multiply constants for a polynomial
+ */
+const rosetta_crc32_clmul_t *rosetta_crc32_clmul_consts(rosetta_crc32_poly_t poly);
+
+/**
+ * rosetta_crc32_step - One ARM64 CRC32{B,H,W,X} / CRC32C{B,H,W,X}
+ * @param poly Polynomial
+ * @param crc Accumulator (Wn)
+ * @param data Data (Wm/Xm); only the low @bytes bytes are used
+ * @param bytes 1, 2, 4 or 8
+ * @return Updated CRC
+ */
+uint32_t rosetta_crc32_step(rosetta_crc32_poly_t poly, uint32_t crc,
+                            uint64_t data, unsigned bytes);
+
+/**
+ * rosetta_crc32_buf - CRC of a buffer, as a run of CRC32 instructions would
+ * @param poly Polynomial
+ * @param crc Accumulator
+ * @param buf Data
+ * @param len Length in bytes
+ * @return Updated CRC
+ */
+uint32_t rosetta_crc32_buf(rosetta_crc32_poly_t poly, uint32_t crc,
+                           const void *buf, size_t len);
+
+#endif /* ROSETTA_CRC32_H */
@@ -7,6 +7,10 @@
  * ============================================================================ */
 
 #include "rosetta_crypto.h"
+#include "rosetta_aes.h"
+#include "rosetta_crc32.h"
+#include "rosetta_sha.h"
+#include "rosetta_pmull.h"
 #include "rosetta_jit_emit.h"
 #include "rosetta_refactored_vector.h"
 #include <stdio.h>
@@ -45,100 +49,52 @@ uint8_t crypto_gf2_mul3(uint8_t x)
  * AES Cryptographic Extensions
  * ============================================================================ */
 
-/* AES S-box */
-static const uint8_t aes_sbox[256] = {
-    0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
-    0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
-    0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
-    0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
-    0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0, 0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
-    0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
-    0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
-    0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5, 0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
-    0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
-    0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
-    0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c, 0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
-    0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
-    0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
-    0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e, 0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
-    0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
-    0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16
-};
-
-/* AES Inverse S-box */
-static const uint8_t aes_inv_sbox[256] = {
-    0x52, 0x09, 0x6a, 0xd5, 0x30, 0x36, 0xa5, 0x38, 0xbf, 0x40, 0xa3, 0x9e, 0x81, 0xf3, 0xd7, 0xfb,
-    0x7c, 0xe3, 0x39, 0x82, 0x9b, 0x2f, 0xff, 0x87, 0x34, 0x8e, 0x43, 0x44, 0xc4, 0xde, 0xe9, 0xcb,
-    0x54, 0x7b, 0x94, 0x32, 0xa6, 0xc2, 0x23, 0x3d, 0xee, 0x4c, 0x95, 0x0b, 0x42, 0xfa, 0xc3, 0x4e,
-    0x08, 0x2e, 0xa1, 0x66, 0x28, 0xd9, 0x24, 0xb2, 0x76, 0x5b, 0xa2, 0x49, 0x6d, 0x8b, 0xd1, 0x25,
-    0x72, 0xf8, 0xf6, 0x64, 0x86, 0x68, 0x98, 0x16, 0xd4, 0xa4, 0x5c, 0xcc, 0x5d, 0x65, 0xb6, 0x92,
-    0x6c, 0x70, 0x48, 0x50, 0xfd, 0xed, 0xb9, 0xda, 0x5e, 0x15, 0x46, 0x57, 0xa7, 0x8d, 0x9d, 0x84,
-    0x90, 0xd8, 0xab, 0x00, 0x8c, 0xbc, 0xd3, 0x0a, 0xf7, 0xe4, 0x58, 0x05, 0xb8, 0xb3, 0x45, 0x06,
-    0xd0, 0x2c, 0x1e, 0x8f, 0xca, 0x3f, 0x0f, 0x02, 0xc1, 0xaf, 0xbd, 0x03, 0x01, 0x13, 0x8a, 0x6b,
-    0x3a, 0x91, 0x11, 0x41, 0x4f, 0x67, 0xdc, 0xea, 0x97, 0xf2, 0xcf, 0xce, 0xf0, 0xb4, 0xe6, 0x73,
-    0x96, 0xac, 0x74, 0x22, 0xe7, 0xad, 0x35, 0x85, 0xe2, 0xf9, 0x37, 0xe8, 0x1c, 0x75, 0xdf, 0x6e,
-    0x47, 0xf1, 0x1a, 0x71, 0x1d, 0x29, 0xc5, 0x89, 0x6f, 0xb7, 0x62, 0x0e, 0xaa, 0x18, 0xbe, 0x1b,
-    0xfc, 0x56, 0x3e, 0x4b, 0xc6, 0xd2, 0x79, 0x20, 0x9a, 0xdb, 0xc0, 0xfe, 0x78, 0xcd, 0x5a, 0xf4,
-    0x1f, 0xdd, 0xa8, 0x33, 0x88, 0x07, 0xc7, 0x31, 0xb1, 0x12, 0x10, 0x59, 0x27, 0x80, 0xec, 0x5f,
-    0x60, 0x51, 0x7f, 0xa9, 0x19, 0xb5, 0x4a, 0x0d, 0x2d, 0xe5, 0x7a, 0x9f, 0x93, 0xc9, 0x9c, 0xef,
-    0xa0, 0xe0, 0x3b, 0x4d, 0xae, 0x2a, 0xf5, 0xb0, 0xc8, 0xeb, 0xbb, 0x3c, 0x83, 0x53, 0x99, 0x61,
-    0x17, 0x2b, 0x04, 0x7e, 0xba, 0x77, 0xd6, 0x26, 0xe1, 0x69, 0x14, 0x63, 0x55, 0x21, 0x0c, 0x7d
-};
-
-/**
- * translate_aese - Translate ARM64 AESE (AES round encryption)
- *
- * AESE performs one round of AES encryption.
- * It consists of ShiftRows followed by SubBytes.
+/*
+ * Vd = op(Vd or Vn, Vn) on the guest state, one instruction at a time
+ * outside translated code. The ARM64 steps do not match AES-NI one to one
+ * (see rosetta_aes.h); translated blocks get AESE/AESMC pairs fused into
+ * AESENC by ir_opt_aes_fuse(), this path runs one step at a time.
  */
-int translate_aese(ThreadState *state, const uint8_t *insn)
+static int crypto_aes_exec(ThreadState *state, const uint8_t *insn, rosetta_aes_op_t op)
 {
+    uint32_t enc;
+    uint8_t rd, rn;
+
     if (!state || !insn) {
         return -1;
     }
 
-    uint8_t rd = (insn[0] >> 0) & 0x1F;
-    uint8_t rm = (insn[2] >> 16) & 0x1F;
-
-    uint8_t xmm_rd = rd & 0x0F;
-    uint8_t xmm_rm = rm & 0x0F;
-
-    /* Use AESNI AESENC instruction if available */
-    /* 66 0F 38 DC /r - AESENC xmm1, xmm2/m128 */
-    jit_emit_byte(xmm_rd);
-    jit_emit_byte(0x66);
-    jit_emit_byte(0x0F);
-    jit_emit_byte(0x38);
-    jit_emit_byte(0xDC);
-    jit_emit_byte(0xC0 + xmm_rd + (xmm_rm << 3));
+    enc = (uint32_t)insn[0] | ((uint32_t)insn[1] << 8) |
+          ((uint32_t)insn[2] << 16) | ((uint32_t)insn[3] << 24);
+    rd = enc & 0x1F;
+    rn = (enc >> 5) & 0x1F;
 
+    if (op == ROS_AES_MC || op == ROS_AES_IMC) {
+        rosetta_aes_step(op, state->host.v[rd].u8, state->host.v[rn].u8, NULL);
+    } else {
+        rosetta_aes_step(op, state->host.v[rd].u8, state->host.v[rd].u8,
+                         state->host.v[rn].u8);
+    }
     return 0;
 }
 
+/**
+ * translate_aese - Translate ARM64 AESE (AES round encryption)
+ *
+ * AESE is AddRoundKey, SubBytes and ShiftRows; MixColumns is a separate
+ * AESMC.
+ */
+int translate_aese(ThreadState *state, const uint8_t *insn)
+{
+    return crypto_aes_exec(state, insn, ROS_AES_E);
+}
+
 /**
  * translate_aesd - Translate ARM64 AESD (AES round decryption)
  */
 int translate_aesd(ThreadState *state, const uint8_t *insn)
 {
-    if (!state || !insn) {
-        return -1;
-    }
-
-    uint8_t rd = (insn[0] >> 0) & 0x1F;
-    uint8_t rm = (insn[2] >> 16) & 0x1F;
-
-    uint8_t xmm_rd = rd & 0x0F;
-    uint8_t xmm_rm = rm & 0x0F;
-
-    /* AESNI AESDEC: 66 0F 38 DD /r */
-    jit_emit_byte(xmm_rd);
-    jit_emit_byte(0x66);
-    jit_emit_byte(0x0F);
-    jit_emit_byte(0x38);
-    jit_emit_byte(0xDD);
-    jit_emit_byte(0xC0 + xmm_rd + (xmm_rm << 3));
-
-    return 0;
+    return crypto_aes_exec(state, insn, ROS_AES_D);
 }
 
 /**
@@ -146,20 +102,7 @@ int translate_aesd(ThreadState *state, const uint8_t *insn)
  */
 int translate_aesmc(ThreadState *state, const uint8_t *insn)
 {
-    if (!state || !insn) {
-        return -1;
-    }
-
-    uint8_t rd = (insn[0] >> 0) & 0x1F;
-
-    uint8_t xmm_rd = rd & 0x0F;
-
-    /* AESNI AESIMC + AESMC combination */
-    /* For now, use software implementation */
-    /* This would call crypto_aes_mix_columns */
-    (void)xmm_rd;
-
-    return 0;
+    return crypto_aes_exec(state, insn, ROS_AES_MC);
 }
 
 /**
@@ -167,29 +110,53 @@ int translate_aesmc(ThreadState *state, const uint8_t *insn)
  */
 int translate_aesimc(ThreadState *state, const uint8_t *insn)
 {
-    if (!state || !insn) {
-        return -1;
-    }
+    return crypto_aes_exec(state, insn, ROS_AES_IMC);
+}
 
-    uint8_t rd = (insn[0] >> 0) & 0x1F;
+/* ============================================================================
+ * SHA Cryptographic Extensions
+ * ============================================================================ */
 
-    uint8_t xmm_rd = rd & 0x0F;
+/*
+ * Vd = op(Vd or Sn, Vn, Vm) on the guest state, one instruction at a time
+ * outside translated code. Translated blocks lower these to IR_SHA and
+ * keep the SHA-256 state packed for SHA256RNDS2 across rounds (see
+ * rosetta_sha.h); this path runs one step at a time.
+ */
+static int crypto_sha_exec(ThreadState *state, const uint8_t *insn, rosetta_sha_op_t op)
+{
+    uint32_t enc;
+    uint8_t rd, rn, rm;
+    const uint32_t *a;
 
-    /* AESNI AESIMC: 66 0F 38 DB /r */
-    jit_emit_byte(xmm_rd);
-    jit_emit_byte(0x66);
-    jit_emit_byte(0x0F);
-    jit_emit_byte(0x38);
-    jit_emit_byte(0xDB);
-    jit_emit_byte(0xC0 + xmm_rd);
+    if (!state || !insn) {
+        return -1;
+    }
 
+    enc = (uint32_t)insn[0] | ((uint32_t)insn[1] << 8) |
+          ((uint32_t)insn[2] << 16) | ((uint32_t)insn[3] << 24);
+    rd = enc & 0x1F;
+    rn = (enc >> 5) & 0x1F;
+    rm = (enc >> 16) & 0x1F;
+
+    /* SHA1C/P/M take e from Sn; only SHA1H ignores Vd */
+    a = op == ROS_SHA1H ? state->host.v[rn].u32 : state->host.v[rd].u32;
+    switch (op) {
+    case ROS_SHA1H:
+        rosetta_sha_step(op, state->host.v[rd].u32, a, NULL, NULL);
+        break;
+    case ROS_SHA1SU1:
+    case ROS_SHA256SU0:
+        rosetta_sha_step(op, state->host.v[rd].u32, a, state->host.v[rn].u32, NULL);
+        break;
+    default:
+        rosetta_sha_step(op, state->host.v[rd].u32, a, state->host.v[rn].u32,
+                         state->host.v[rm].u32);
+        break;
+    }
     return 0;
 }
 
-/* ============================================================================
- * SHA Cryptographic Extensions
- * ============================================================================ */
-
 /**
  * crypto_sha1_choose - SHA-1 Choose function
  * F(x,y,z) = (x AND y) OR (NOT x AND z)
@@ -220,27 +187,11 @@ uint32_t crypto_sha1_majority(uint32_t x, uint32_t y, uint32_t z)
 /**
  * translate_sha1c - Translate ARM64 SHA1C (SHA1 hash update choose)
  *
- * SHA1C performs: ABCDE += F(W, E) + K + rol32(D)
- * where F is the Choose function
+ * Four rounds with the Choose function; Vm already holds W + K.
  */
 int translate_sha1c(ThreadState *state, const uint8_t *insn)
 {
-    if (!state || !insn) {
-        return -1;
-    }
-
-    uint8_t qn = (insn[0] >> 0) & 0x1F;   /* Hash state (a, b, c, d) */
-    uint8_t rm = (insn[2] >> 16) & 0x1F;  /* Message schedule (w) */
-
-    uint8_t xmm_qn = qn & 0x0F;
-    uint8_t xmm_rm = rm & 0x0F;
-
-    /* Use SHA1MSG1/SHA256MSG1 instructions if available */
-    /* For now, call helper function */
-    (void)xmm_qn;
-    (void)xmm_rm;
-
-    return 0;
+    return crypto_sha_exec(state, insn, ROS_SHA1C);
 }
 
 /**
@@ -248,18 +199,7 @@ int translate_sha1c(ThreadState *state, const uint8_t *insn)
  */
 int translate_sha1p(ThreadState *state, const uint8_t *insn)
 {
-    if (!state || !insn) {
-        return -1;
-    }
-
-    uint8_t qn = (insn[0] >> 0) & 0x1F;
-    uint8_t rm = (insn[2] >> 16) & 0x1F;
-
-    /* SHA1P uses parity function */
-    (void)qn;
-    (void)rm;
-
-    return 0;
+    return crypto_sha_exec(state, insn, ROS_SHA1P);
 }
 
 /**
@@ -267,18 +207,7 @@ int translate_sha1p(ThreadState *state, const uint8_t *insn)
  */
 int translate_sha1m(ThreadState *state, const uint8_t *insn)
 {
-    if (!state || !insn) {
-        return -1;
-    }
-
-    uint8_t qn = (insn[0] >> 0) & 0x1F;
-    uint8_t rm = (insn[2] >> 16) & 0x1F;
-
-    /* SHA1M uses majority function */
-    (void)qn;
-    (void)rm;
-
-    return 0;
+    return crypto_sha_exec(state, insn, ROS_SHA1M);
 }
 
 /**
@@ -286,24 +215,7 @@ int translate_sha1m(ThreadState *state, const uint8_t *insn)
  */
 int translate_sha1h(ThreadState *state, const uint8_t *insn)
 {
-    if (!state || !insn) {
-        return -1;
-    }
-
-    uint8_t rd = (insn[0] >> 0) & 0x1F;
-
-    uint8_t xmm_rd = rd & 0x0F;
-
-    /* SHA1H: rol32 on element */
-    /* Use PSHUFD for rotation */
-    jit_emit_byte(xmm_rd);
-    jit_emit_byte(0x66);
-    jit_emit_byte(0x0F);
-    jit_emit_byte(0x70);
-    jit_emit_byte(0xC0 + xmm_rd);
-    jit_emit_byte(0x1B);  /* Rotation pattern */
-
-    return 0;
+    return crypto_sha_exec(state, insn, ROS_SHA1H);
 }
 
 /**
@@ -311,17 +223,7 @@ int translate_sha1h(ThreadState *state, const uint8_t *insn)
  */
 int translate_sha1su0(ThreadState *state, const uint8_t *insn)
 {
-    if (!state || !insn) {
-        return -1;
-    }
-
-    uint8_t qn = (insn[0] >> 0) & 0x1F;
-    uint8_t rm = (insn[2] >> 16) & 0x1F;
-
-    (void)qn;
-    (void)rm;
-
-    return 0;
+    return crypto_sha_exec(state, insn, ROS_SHA1SU0);
 }
 
 /**
@@ -329,17 +231,7 @@ int translate_sha1su0(ThreadState *state, const uint8_t *insn)
  */
 int translate_sha1su1(ThreadState *state, const uint8_t *insn)
 {
-    if (!state || !insn) {
-        return -1;
-    }
-
-    uint8_t qn = (insn[0] >> 0) & 0x1F;
-    uint8_t rm = (insn[2] >> 16) & 0x1F;
-
-    (void)qn;
-    (void)rm;
-
-    return 0;
+    return crypto_sha_exec(state, insn, ROS_SHA1SU1);
 }
 
 /**
@@ -393,17 +285,7 @@ uint32_t crypto_sha256_gamma1(uint32_t x)
  */
 int translate_sha256h(ThreadState *state, const uint8_t *insn)
 {
-    if (!state || !insn) {
-        return -1;
-    }
-
-    uint8_t qn = (insn[0] >> 0) & 0x1F;
-    uint8_t rm = (insn[2] >> 16) & 0x1F;
-
-    (void)qn;
-    (void)rm;
-
-    return 0;
+    return crypto_sha_exec(state, insn, ROS_SHA256H);
 }
 
 /**
@@ -411,17 +293,7 @@ int translate_sha256h(ThreadState *state, const uint8_t *insn)
  */
 int translate_sha256h2(ThreadState *state, const uint8_t *insn)
 {
-    if (!state || !insn) {
-        return -1;
-    }
-
-    uint8_t qn = (insn[0] >> 0) & 0x1F;
-    uint8_t rm = (insn[2] >> 16) & 0x1F;
-
-    (void)qn;
-    (void)rm;
-
-    return 0;
+    return crypto_sha_exec(state, insn, ROS_SHA256H2);
 }
 
 /**
@@ -429,17 +301,7 @@ int translate_sha256h2(ThreadState *state, const uint8_t *insn)
  */
 int translate_sha256su0(ThreadState *state, const uint8_t *insn)
 {
-    if (!state || !insn) {
-        return -1;
-    }
-
-    uint8_t qn = (insn[0] >> 0) & 0x1F;
-    uint8_t rm = (insn[2] >> 16) & 0x1F;
-
-    (void)qn;
-    (void)rm;
-
-    return 0;
+    return crypto_sha_exec(state, insn, ROS_SHA256SU0);
 }
 
 /**
@@ -447,39 +309,19 @@ int translate_sha256su0(ThreadState *state, const uint8_t *insn)
  */
 int translate_sha256su1(ThreadState *state, const uint8_t *insn)
 {
-    if (!state || !insn) {
-        return -1;
-    }
-
-    uint8_t qn = (insn[0] >> 0) & 0x1F;
-    uint8_t rm = (insn[2] >> 16) & 0x1F;
-
-    (void)qn;
-    (void)rm;
-
-    return 0;
+    return crypto_sha_exec(state, insn, ROS_SHA256SU1);
 }
 
 /* ============================================================================
  * CRC32 Extensions
  * ============================================================================ */
 
-/* CRC32 polynomial (standard) */
-#define CRC32_POLY  0xEDB88320
-
-/* CRC32C polynomial (Castagnoli) */
-#define CRC32C_POLY 0x82F63B78
-
 /**
  * crypto_crc32_update - Update CRC32 with a byte
  */
 uint32_t crypto_crc32_update(uint32_t crc, uint8_t byte)
 {
-    crc ^= byte;
-    for (int i = 0; i < 8; i++) {
-        crc = (crc >> 1) ^ ((crc & 1) ? CRC32_POLY : 0);
-    }
-    return crc;
+    return rosetta_crc32_step(ROS_CRC32_IEEE, crc, byte, 1);
 }
 
 /**
@@ -487,63 +329,56 @@ uint32_t crypto_crc32_update(uint32_t crc, uint8_t byte)
  */
 uint32_t crypto_crc32c_update(uint32_t crc, uint8_t byte)
 {
-    crc ^= byte;
-    for (int i = 0; i < 8; i++) {
-        crc = (crc >> 1) ^ ((crc & 1) ? CRC32C_POLY : 0);
-    }
-    return crc;
+    return rosetta_crc32_step(ROS_CRC32_CASTAGNOLI, crc, byte, 1);
 }
 
-/**
- * translate_crc32b - Translate ARM64 CRC32B (CRC32 byte)
+/*
+ * Wd = CRC(Wn, low bytes of Rm) on the guest state. Translated blocks get
+ * the same operation inline from the lowering ir_x86_register_crypto()
+ * installs; both go through the kernels rosetta_crc32.c picked for this
+ * host.
  */
-int translate_crc32b(ThreadState *state, const uint8_t *insn)
+static int crypto_crc32_exec(ThreadState *state, const uint8_t *insn,
+                             rosetta_crc32_poly_t poly, unsigned bytes)
 {
+    uint32_t enc;
+    uint8_t rd, rn, rm;
+    uint32_t crc;
+    uint64_t data;
+
     if (!state || !insn) {
         return -1;
     }
 
-    uint8_t rd = (insn[0] >> 0) & 0x1F;  /* Accumulator/result */
-    uint8_t rm = (insn[2] >> 16) & 0x1F; /* Source byte */
-
-    uint8_t x86_rd = map_arm64_to_x86_gpr(rd);
-    uint8_t x86_rm = map_arm64_to_x86_gpr(rm);
-
-    /* Use CRC32 instruction if available (SSE4.2) */
-    /* F2 0F 38 F0 /r - CRC32 r32, r/m8 */
-    jit_emit_byte(0xF2);
-    jit_emit_byte(0x0F);
-    jit_emit_byte(0x38);
-    jit_emit_byte(0xF0);
-    jit_emit_byte(0xC0 + x86_rd + (x86_rm << 3));
-
+    enc = (uint32_t)insn[0] | ((uint32_t)insn[1] << 8) |
+          ((uint32_t)insn[2] << 16) | ((uint32_t)insn[3] << 24);
+    rd = enc & 0x1F;
+    rn = (enc >> 5) & 0x1F;
+    rm = (enc >> 16) & 0x1F;
+
+    /* Register 31 is WZR/XZR here */
+    crc = (rn == 31) ? 0 : (uint32_t)state->host.x[rn];
+    data = (rm == 31) ? 0 : state->host.x[rm];
+    if (rd != 31) {
+        state->host.x[rd] = rosetta_crc32_step(poly, crc, data, bytes);
+    }
     return 0;
 }
 
+/**
+ * translate_crc32b - Translate ARM64 CRC32B (CRC32 byte)
+ */
+int translate_crc32b(ThreadState *state, const uint8_t *insn)
+{
+    return crypto_crc32_exec(state, insn, ROS_CRC32_IEEE, 1);
+}
+
 /**
  * translate_crc32h - Translate ARM64 CRC32H (CRC32 halfword)
  */
 int translate_crc32h(ThreadState *state, const uint8_t *insn)
 {
-    if (!state || !insn) {
-        return -1;
-    }
-
-    uint8_t rd = (insn[0] >> 0) & 0x1F;
-    uint8_t rm = (insn[2] >> 16) & 0x1F;
-
-    uint8_t x86_rd = map_arm64_to_x86_gpr(rd);
-    uint8_t x86_rm = map_arm64_to_x86_gpr(rm);
-
-    /* CRC32 r32, r/m16: F2 66 0F 38 F1 /r */
-    jit_emit_byte(0xF2);
-    jit_emit_byte(0x66);
-    jit_emit_byte(0x0F);
-    jit_emit_byte(0x38);
-    jit_emit_byte(0xF1);
-    jit_emit_byte(0xC0 + x86_rd + (x86_rm << 3));
-
-    return 0;
+    return crypto_crc32_exec(state, insn, ROS_CRC32_IEEE, 2);
 }
 
 /**
@@ -551,24 +386,7 @@ int translate_crc32h(ThreadState *state, const uint8_t *insn)
  */
 int translate_crc32w(ThreadState *state, const uint8_t *insn)
 {
-    if (!state || !insn) {
-        return -1;
-    }
-
-    uint8_t rd = (insn[0] >> 0) & 0x1F;
-    uint8_t rm = (insn[2] >> 16) & 0x1F;
-
-    uint8_t x86_rd = map_arm64_to_x86_gpr(rd);
-    uint8_t x86_rm = map_arm64_to_x86_gpr(rm);
-
-    /* CRC32 r32, r/m32: F2 0F 38 F1 /r */
-    jit_emit_byte(0xF2);
-    jit_emit_byte(0x0F);
-    jit_emit_byte(0x38);
-    jit_emit_byte(0xF1);
-    jit_emit_byte(0xC0 + x86_rd + (x86_rm << 3));
-
-    return 0;
+    return crypto_crc32_exec(state, insn, ROS_CRC32_IEEE, 4);
 }
 
 /**
@@ -576,25 +394,7 @@ int translate_crc32w(ThreadState *state, const uint8_t *insn)
  */
 int translate_crc32x(ThreadState *state, const uint8_t *insn)
 {
-    if (!state || !insn) {
-        return -1;
-    }
-
-    uint8_t rd = (insn[0] >> 0) & 0x1F;
-    uint8_t rm = (insn[2] >> 16) & 0x1F;
-
-    uint8_t x86_rd = map_arm64_to_x86_gpr(rd);
-    uint8_t x86_rm = map_arm64_to_x86_gpr(rm);
-
-    /* CRC32 r64, r/m64: F2 48 0F 38 F1 /r */
-    jit_emit_byte(0xF2);
-    jit_emit_byte(0x48);  /* REX.W */
-    jit_emit_byte(0x0F);
-    jit_emit_byte(0x38);
-    jit_emit_byte(0xF1);
-    jit_emit_byte(0xC0 + x86_rd + (x86_rm << 3));
-
-    return 0;
+    return crypto_crc32_exec(state, insn, ROS_CRC32_IEEE, 8);
 }
 
 /**
@@ -602,19 +402,7 @@ int translate_crc32x(ThreadState *state, const uint8_t *insn)
  */
 int translate_crc32cb(ThreadState *state, const uint8_t *insn)
 {
-    if (!state || !insn) {
-        return -1;
-    }
-
-    uint8_t rd = (insn[0] >> 0) & 0x1F;
-    uint8_t rm = (insn[2] >> 16) & 0x1F;
-
-    /* CRC32C requires software implementation on x86 */
-    /* or use VPCLMULQDQ on newer CPUs */
-    (void)rd;
-    (void)rm;
-
-    return 0;
+    return crypto_crc32_exec(state, insn, ROS_CRC32_CASTAGNOLI, 1);
 }
 
 /**
@@ -622,17 +410,7 @@ int translate_crc32cb(ThreadState *state, const uint8_t *insn)
  */
 int translate_crc32ch(ThreadState *state, const uint8_t *insn)
 {
-    if (!state || !insn) {
-        return -1;
-    }
-
-    uint8_t rd = (insn[0] >> 0) & 0x1F;
-    uint8_t rm = (insn[2] >> 16) & 0x1F;
-
-    (void)rd;
-    (void)rm;
-
-    return 0;
+    return crypto_crc32_exec(state, insn, ROS_CRC32_CASTAGNOLI, 2);
 }
 
 /**
@@ -640,17 +418,7 @@ int translate_crc32ch(ThreadState *state, const uint8_t *insn)
  */
 int translate_crc32cw(ThreadState *state, const uint8_t *insn)
 {
-    if (!state || !insn) {
-        return -1;
-    }
-
-    uint8_t rd = (insn[0] >> 0) & 0x1F;
-    uint8_t rm = (insn[2] >> 16) & 0x1F;
-
-    (void)rd;
-    (void)rm;
-
-    return 0;
+    return crypto_crc32_exec(state, insn, ROS_CRC32_CASTAGNOLI, 4);
 }
 
 /**
@@ -658,114 +426,94 @@ int translate_crc32cw(ThreadState *state, const uint8_t *insn)
  */
 int translate_crc32cx(ThreadState *state, const uint8_t *insn)
 {
-    if (!state || !insn) {
-        return -1;
-    }
-
-    uint8_t rd = (insn[0] >> 0) & 0x1F;
-    uint8_t rm = (insn[2] >> 16) & 0x1F;
-
-    (void)rd;
-    (void)rm;
-
-    return 0;
+    return crypto_crc32_exec(state, insn, ROS_CRC32_CASTAGNOLI, 8);
 }
 
 /* ============================================================================
  * Polynomial Multiplication
  * ============================================================================ */
 
-/**
- * translate_pmull - Translate ARM64 PMULL (polynomial multiply long)
+/*
+ * Vd = PMULL{,2}(Vn, Vm) on the guest state, 1Q or 8H by the size field.
+ * Translated blocks lower these to IR_PMULL, which the registered x86_64
+ * lowering emits as PCLMULQDQ for the 1Q form.
  */
-int translate_pmull(ThreadState *state, const uint8_t *insn)
+static int crypto_pmull_exec(ThreadState *state, const uint8_t *insn, int high)
 {
+    uint32_t enc;
+    uint8_t rd, rn, rm, size;
+    rosetta_pmull_op_t op;
+
     if (!state || !insn) {
         return -1;
     }
 
-    uint8_t rd = (insn[0] >> 0) & 0x1F;
-    uint8_t rn = (insn[1] >> 5) & 0x1F;
-    uint8_t rm = (insn[2] >> 16) & 0x1F;
-
-    uint8_t xmm_rd = rd & 0x0F;
-    uint8_t xmm_rn = rn & 0x0F;
-    uint8_t xmm_rm = rm & 0x0F;
-
-    /* Use PCLMULQDQ if available */
-    /* 66 0F 3A 44 /r imm8 - PCLMULQDQ xmm1, xmm2/m128, imm8 */
-    jit_emit_byte(xmm_rd);
-    jit_emit_byte(0x66);
-    jit_emit_byte(0x0F);
-    jit_emit_byte(0x3A);
-    jit_emit_byte(0x44);
-    jit_emit_byte(0xC0 + xmm_rn + (xmm_rm << 3));
-    jit_emit_byte(0x00);  /* Low 64-bit polynomial multiply */
-
+    enc = (uint32_t)insn[0] | ((uint32_t)insn[1] << 8) |
+          ((uint32_t)insn[2] << 16) | ((uint32_t)insn[3] << 24);
+    rd = enc & 0x1F;
+    rn = (enc >> 5) & 0x1F;
+    rm = (enc >> 16) & 0x1F;
+    size = (enc >> 22) & 3;
+
+    if (size == 3) {
+        op = high ? ROS_PMULL2_64 : ROS_PMULL_64;
+    } else if (size == 0) {
+        op = high ? ROS_PMULL2_8 : ROS_PMULL_8;
+    } else {
+        return -1;
+    }
+    rosetta_pmull_step(op, state->host.v[rd].u8, state->host.v[rn].u8, state->host.v[rm].u8);
     return 0;
 }
 
+/**
+ * translate_pmull - Translate ARM64 PMULL (polynomial multiply long)
+ */
+int translate_pmull(ThreadState *state, const uint8_t *insn)
+{
+    return crypto_pmull_exec(state, insn, 0);
+}
+
 /**
  * translate_pmull2 - Translate ARM64 PMULL2 (polynomial multiply long high)
  */
 int translate_pmull2(ThreadState *state, const uint8_t *insn)
 {
-    if (!state || !insn) {
-        return -1;
-    }
-
-    uint8_t rd = (insn[0] >> 0) & 0x1F;
-    uint8_t rn = (insn[1] >> 5) & 0x1F;
-    uint8_t rm = (insn[2] >> 16) & 0x1F;
-
-    uint8_t xmm_rd = rd & 0x0F;
-    uint8_t xmm_rn = rn & 0x0F;
-    uint8_t xmm_rm = rm & 0x0F;
-
-    /* Use PCLMULQDQ with high half selector */
-    jit_emit_byte(xmm_rd);
-    jit_emit_byte(0x66);
-    jit_emit_byte(0x0F);
-    jit_emit_byte(0x3A);
-    jit_emit_byte(0x44);
-    jit_emit_byte(0xC0 + xmm_rn + (xmm_rm << 3));
-    jit_emit_byte(0x11);  /* High 64-bit polynomial multiply */
-
-    return 0;
+    return crypto_pmull_exec(state, insn, 1);
 }
 
 /* ============================================================================
  * Crypto Helper Implementations
  * ============================================================================ */
 
-Vector128 crypto_aes_encrypt_round(Vector128 state, Vector128 round_key)
+static Vector128 crypto_aes_apply(rosetta_aes_op_t op, Vector128 state,
+                                  const Vector128 *round_key)
 {
     Vector128 result;
-    uint8_t *s = (uint8_t *)&state;
-    uint8_t *k = (uint8_t *)&round_key;
-    uint8_t *r = (uint8_t *)&result;
-
-    /* Apply S-box and XOR with round key */
-    for (int i = 0; i < 16; i++) {
-        r[i] = aes_sbox[s[i]] ^ k[i];
-    }
 
+    rosetta_aes_step(op, (uint8_t *)&result, (const uint8_t *)&state,
+                     (const uint8_t *)round_key);
     return result;
 }
 
-Vector128 crypto_aes_decrypt_round(Vector128 state, Vector128 round_key)
+Vector128 crypto_aes_encrypt_round(Vector128 state, Vector128 round_key)
 {
-    Vector128 result;
-    uint8_t *s = (uint8_t *)&state;
-    uint8_t *k = (uint8_t *)&round_key;
-    uint8_t *r = (uint8_t *)&result;
+    return crypto_aes_apply(ROS_AES_ENC, state, &round_key);
+}
 
-    /* Apply inverse S-box and XOR with round key */
-    for (int i = 0; i < 16; i++) {
-        r[i] = aes_inv_sbox[s[i]] ^ k[i];
-    }
+Vector128 crypto_aes_encrypt_last_round(Vector128 state, Vector128 round_key)
+{
+    return crypto_aes_apply(ROS_AES_ENCLAST, state, &round_key);
+}
 
-    return result;
+Vector128 crypto_aes_decrypt_round(Vector128 state, Vector128 round_key)
+{
+    return crypto_aes_apply(ROS_AES_DEC, state, &round_key);
+}
+
+Vector128 crypto_aes_decrypt_last_round(Vector128 state, Vector128 round_key)
+{
+    return crypto_aes_apply(ROS_AES_DECLAST, state, &round_key);
 }
 
 Vector128 crypto_aes_mix_columns(Vector128 state)
@@ -793,13 +541,5 @@ Vector128 crypto_aes_mix_columns(Vector128 state)
 
 Vector128 crypto_aes_inv_mix_columns(Vector128 state)
 {
-    /* Inverse MixColumns - similar but with different coefficients */
-    Vector128 result;
-    (void)state;
-
-    /* Placeholder - implementation similar to mix_columns */
-    result.lo = state.lo;
-    result.hi = state.hi;
-
-    return result;
+    return crypto_aes_apply(ROS_AES_IMC, state, NULL);
 }
@@ -17,6 +17,12 @@
  * AES Cryptographic Extensions
  * ============================================================================ */
 
+/*
+ * These execute one guest instruction on ThreadState.host.v[]. Translated
+ * blocks lower AESE/AESD/AESMC/AESIMC to IR_AES instead, where
+ * ir_opt_aes_fuse() turns each round pair into one AES-NI instruction.
+ */
+
 /**
  * translate_aese - Translate ARM64 AESE (AES round encryption)
  * @param state Thread state
@@ -53,6 +59,12 @@ int translate_aesimc(ThreadState *state, const uint8_t *insn);
  * SHA Cryptographic Extensions
  * ============================================================================ */
 
+/*
+ * These execute one guest instruction on ThreadState.host.v[]. Translated
+ * blocks lower them to IR_SHA, with SHA256H/SHA256H2 rewritten into
+ * SHA256RNDS2 steps on packed state (see rosetta_sha.h).
+ */
+
 /**
  * translate_sha1c - Translate ARM64 SHA1C (SHA1 hash update choose)
  * @param state Thread state
@@ -137,6 +149,9 @@ int translate_sha256su1(ThreadState *state, const uint8_t *insn);
  * CRC32 Extensions
  * ============================================================================ */
 
+/* These execute the instruction on ThreadState.host with the rosetta_crc32.h
+ * kernels; the IR x86_64 back-end emits the same operations inline. */
+
 /**
  * translate_crc32b - Translate ARM64 CRC32B (CRC32 byte)
  * @param state Thread state
@@ -205,6 +220,12 @@ int translate_crc32cx(ThreadState *state, const uint8_t *insn);
  * Polynomial Multiplication
  * ============================================================================ */
 
+/*
+ * 64 x 64 -> 128 (1Q) and 8 x 8 -> 16 (8H) forms, picked by the size
+ * field; PMULL2 takes the high halves. Translated blocks lower both to
+ * IR_PMULL (see rosetta_pmull.h).
+ */
+
 /**
  * translate_pmull - Translate ARM64 PMULL (polynomial multiply long)
  * @param state Thread state
@@ -226,21 +247,37 @@ int translate_pmull2(ThreadState *state, const uint8_t *insn);
  * ============================================================================ */
 
 /**
- * crypto_aes_encrypt_round - Perform AES encryption round
+ * crypto_aes_encrypt_round - Perform AES encryption round (x86 AESENC)
  * @param state Current state vector
  * @param round_key Round key vector
- * @return New state after AES round
+ * @return MixColumns(ShiftRows(SubBytes(state))) ^ round_key
  */
 Vector128 crypto_aes_encrypt_round(Vector128 state, Vector128 round_key);
 
 /**
- * crypto_aes_decrypt_round - Perform AES decryption round
+ * crypto_aes_encrypt_last_round - Final AES encryption round (x86 AESENCLAST)
  * @param state Current state vector
  * @param round_key Round key vector
- * @return New state after AES round
+ * @return ShiftRows(SubBytes(state)) ^ round_key
+ */
+Vector128 crypto_aes_encrypt_last_round(Vector128 state, Vector128 round_key);
+
+/**
+ * crypto_aes_decrypt_round - Perform AES decryption round (x86 AESDEC)
+ * @param state Current state vector
+ * @param round_key Round key vector
+ * @return InvMixColumns(InvSubBytes(InvShiftRows(state))) ^ round_key
  */
 Vector128 crypto_aes_decrypt_round(Vector128 state, Vector128 round_key);
 
+/**
+ * crypto_aes_decrypt_last_round - Final AES decryption round (x86 AESDECLAST)
+ * @param state Current state vector
+ * @param round_key Round key vector
+ * @return InvSubBytes(InvShiftRows(state)) ^ round_key
+ */
+Vector128 crypto_aes_decrypt_last_round(Vector128 state, Vector128 round_key);
+
 /**
  * crypto_aes_mix_columns - AES MixColumns transformation
  * @param state State vector
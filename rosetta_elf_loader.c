@@ -745,6 +745,64 @@ uint64_t rosetta_elf_lookup_symbol(rosetta_elf_binary_t *binary,
     return 0;
 }
 
+/**
+ * Search one symbol table for a sized symbol covering addr
+ */
+static const elf64_sym_t *find_covering_symbol(const elf64_sym_t *syms, uint32_t count,
+                                               const char *strtab, uint64_t strtab_size,
+                                               uint64_t addr)
+{
+    const elf64_sym_t *best = NULL;
+
+    for (uint32_t i = 0; i < count; i++) {
+        const elf64_sym_t *sym = &syms[i];
+        uint8_t type = sym->st_info & 0xF;
+
+        if (sym->st_name == 0 || sym->st_name >= strtab_size || sym->st_size == 0 ||
+            (type != STT_FUNC && type != STT_OBJECT)) {
+            continue;
+        }
+        if (addr >= sym->st_value && addr - sym->st_value < sym->st_size &&
+            (!best || sym->st_value > best->st_value)) {
+            best = sym;
+        }
+    }
+    return best;
+}
+
+/**
+ * Reverse of rosetta_elf_lookup_symbol(), for profiles and diagnostics
+ */
+const char *rosetta_elf_symbolize(rosetta_elf_binary_t *binary, uint64_t addr,
+                                  uint64_t *offset)
+{
+    const elf64_sym_t *sym = NULL;
+    const char *name = NULL;
+
+    if (!binary) {
+        return NULL;
+    }
+    if (binary->is_pie) {
+        addr -= binary->base_address;
+    }
+
+    /* The full symbol table also names static functions */
+    if (binary->symtab && binary->strtab) {
+        sym = find_covering_symbol(binary->symtab, binary->symtab_count,
+                                   binary->strtab, binary->strtab_size, addr);
+        name = sym ? binary->strtab + sym->st_name : NULL;
+    }
+    if (!sym && binary->dynsym && binary->dynstr) {
+        sym = find_covering_symbol(binary->dynsym, binary->dynsym_count,
+                                   binary->dynstr, binary->dynstr_size, addr);
+        name = sym ? binary->dynstr + sym->st_name : NULL;
+    }
+    if (sym && offset) {
+        *offset = addr - sym->st_value;
+    }
+    return name;
+}
+
 #if 0  /* Disabled for debugging - cache implementation has memory issues */
 /**
  * Optimized symbol lookup with hash table and LRU cache
@@ -449,6 +449,16 @@ rosetta_elf_section_t *rosetta_elf_get_section(rosetta_elf_binary_t *binary,
 uint64_t rosetta_elf_lookup_symbol(rosetta_elf_binary_t *binary,
                                    const char *name);
 
+/**
+ * Find the symbol covering an address
+ * @param binary Loaded binary
+ * @param addr Guest address (load bias applied for PIE)
+ * @param offset Set to addr minus the symbol start, may be NULL
+ * @return Symbol name, or NULL if no sized symbol covers addr
+ */
+const char *rosetta_elf_symbolize(rosetta_elf_binary_t *binary, uint64_t addr,
+                                  uint64_t *offset);
+
 /**
  * Map all loadable segments into memory
  * @param binary Loaded binary
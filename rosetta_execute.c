@@ -9,18 +9,24 @@
 #include "rosetta_execute.h"
 #include "rosetta_refactored.h"
 #include "rosetta_refactored_exec.h"
-#include "rosetta_x86_insns.h"
+#include "rosetta_x86_decode.h"
+#include "rosetta_perfmap.h"
+#include "rosetta_sampler.h"
+#include "rosetta_block_profile.h"
+#include "rosetta_mxcsr.h"
+#include "rosetta_translate_avx.h"
+#include "rosetta_translate_x87.h"
+#include "rosetta_translate_mxcsr.h"
+#include "rosetta_log.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <signal.h>
 #include <sys/mman.h>
 #include <unistd.h>
 #include <stdbool.h>
 
-/* Forward declarations for code buffer (to avoid header conflicts) */
-typedef struct code_buffer code_buffer_t;
-
 /* Forward declaration for TranslateResult */
 typedef struct {
     bool success;           /* Translation succeeded */
@@ -47,18 +53,18 @@ extern void rosetta_run(uint64_t guest_pc);
 extern TranslateResult dispatch_translate_insn(
     void *code_buf, const x86_insn_t *insn,
     uint8_t arm_rd, uint8_t arm_rm, uint64_t block_pc);
+extern void translate_special_syscall(void *code_buf, const x86_insn_t *insn,
+                                      int64_t known_nr);
+extern int64_t translate_special_track_syscall_nr(const x86_insn_t *insn,
+                                                  int64_t known_nr);
+extern int translate_special_vdso(void *code_buf, int func);
+extern int translate_string_emit(void *code_buf, const x86_insn_t *insn, uint64_t pc);
+extern int rosetta_vdso_lookup(uint64_t guest_pc);
 
 /* External ARM64 emit functions */
-extern void emit_byte(void *buf, uint8_t byte);
-extern void emit_word32(void *buf, uint32_t word);
-extern void emit_word64(void *buf, uint64_t word);
 extern void emit_nop(void *buf);
 extern void emit_ret(void *buf);
 
-/* External code buffer functions */
-extern int code_buffer_init(code_buffer_t *buf, u8 *buffer, u32 size);
-extern u32 code_buffer_get_size(code_buffer_t *buf);
-
 /* ============================================================================
  * Instruction Fetching
  * ============================================================================ */
@@ -230,39 +236,56 @@ static void *translate_block_with_memmgr(rosetta_memmgr_t *memmgr,
         return NULL;
     }
 
-    printf("[TRANS] ==================================================\n");
-    printf("[TRANS] Translating block at 0x%lx\n", guest_pc);
-    printf("[TRANS] ==================================================\n");
+    ROS_LOG_DEBUG("[TRANS] ==================================================\n");
+    ROS_LOG_DEBUG("[TRANS] Translating block at 0x%lx\n", guest_pc);
+    ROS_LOG_DEBUG("[TRANS] ==================================================\n");
 
     /* Check translation cache first */
     void *cached = refactored_translation_cache_lookup(guest_pc);
     if (cached) {
-        printf("[TRANS] ✅ Block found in cache: %p\n", cached);
+        ROS_LOG_DEBUG("[TRANS] Block found in cache: %p\n", cached);
         *out_size = 0;  /* Size unknown from cache */
         return cached;
     }
 
-    printf("[TRANS] 🔍 Block not in cache, translating...\n");
+    ROS_LOG_DEBUG("[TRANS] Block not in cache, translating...\n");
 
     /* Initialize code buffer for ARM64 emission */
     static uint8_t code_cache[65536];  /* 64KB code cache per block */
     static uint8_t code_buf_struct[4096];  /* Space for code_buffer struct */
     void *code_buf = code_buf_struct;
 
-    printf("[TRANS] 📝 Initializing code buffer: buffer=%p, size=%zu\n",
-           code_cache, sizeof(code_cache));
+    ROS_LOG_DEBUG("[TRANS] Initializing code buffer: buffer=%p, size=%zu\n",
+                  code_cache, sizeof(code_cache));
 
     code_buffer_init_arm64(code_buf, code_cache, sizeof(code_cache));
 
-    printf("[TRANS] ✅ Code buffer initialized\n");
+    ROS_LOG_DEBUG("[TRANS] Code buffer initialized\n");
 
     /* Translate up to 64 instructions or until branch */
     uint64_t current_pc = guest_pc;
     int insn_count = 0;
     int terminated = 0;
+    int64_t known_syscall_nr = -1;  /* Constant in RAX, if any */
     const int max_insns = 64;
+    translate_avx_state_t avx_state;
+    translate_x87_state_t x87_state;
+    translate_mxcsr_state_t mxcsr_state;
+
+    translate_avx_begin_block(&avx_state);
+    translate_x87_begin_block(&x87_state);
+    translate_mxcsr_begin_block(&mxcsr_state);
+
+    /* Calls into the guest vDSO become host intrinsics */
+    int vdso_func = rosetta_vdso_lookup(guest_pc);
+    if (vdso_func >= 0 && translate_special_vdso(code_buf, vdso_func)) {
+        terminated = 1;
+    }
+
+    /* Per-instruction blocks count entries only */
+    uint64_t *prof = terminated ? NULL : rosetta_profile_emit_entry(code_buf, guest_pc);
 
-    printf("[TRANS] 🔄 Starting translation loop (max %d instructions)\n", max_insns);
+    ROS_LOG_DEBUG("[TRANS] Starting translation loop (max %d instructions)\n", max_insns);
 
     while (insn_count < max_insns && !terminated) {
         /* Fetch x86_64 instruction from guest memory */
@@ -270,46 +293,95 @@ static void *translate_block_with_memmgr(rosetta_memmgr_t *memmgr,
         ssize_t fetched = rosetta_fetch_insn(memmgr, current_pc, insn_buf, sizeof(insn_buf));
 
         if (fetched <= 0) {
-            printf("[TRANS] ❌ Failed to fetch instruction at 0x%lx\n", current_pc);
+            ROS_LOG_WARN("[TRANS] Failed to fetch instruction at 0x%lx\n", current_pc);
             break;
         }
 
-        printf("[TRANS] [%d] 📥 Fetched %zd bytes at 0x%lx: ", insn_count, fetched, current_pc);
+        ROS_LOG_TRACE("[TRANS] [%d] Fetched %zd bytes at 0x%lx: ", insn_count, fetched, current_pc);
         for (int i = 0; i < fetched && i < 8; i++) {
-            printf("%02x ", insn_buf[i]);
+            ROS_LOG_TRACE("%02x ", insn_buf[i]);
         }
-        printf("\n");
+        ROS_LOG_TRACE("\n");
 
         /* Decode x86_64 instruction */
         x86_insn_t insn;
         int insn_len = decode_x86_insn(insn_buf, &insn);
 
         if (insn_len == 0) {
-            printf("[TRANS] ❌ Invalid instruction at 0x%lx, ending block\n", current_pc);
+            ROS_LOG_WARN("[TRANS] Invalid instruction at 0x%lx, ending block\n", current_pc);
             break;
         }
 
-        printf("[TRANS] [%d] 🔎 Decoded: len=%d opcode=0x%02x reg=%d rm=%d\n",
-               insn_count, insn_len, insn.opcode, insn.reg, insn.rm);
+        ROS_LOG_TRACE("[TRANS] [%d] Decoded: len=%d opcode=0x%02x reg=%d rm=%d\n",
+                      insn_count, insn_len, insn.opcode, insn.reg, insn.rm);
 
         /* Map x86_64 registers to ARM64 */
         uint8_t arm_rd = map_x86_to_arm(insn.reg);
         uint8_t arm_rm = map_x86_to_arm(insn.rm);
 
-        printf("[TRANS] [%d] 🔄 Register mapping: x86 reg=%d → ARM r%d, x86 rm=%d → ARM r%d\n",
-               insn_count, insn.reg, arm_rd, insn.rm, arm_rm);
+        ROS_LOG_TRACE("[TRANS] [%d] Register mapping: x86 reg=%d -> ARM r%d, x86 rm=%d -> ARM r%d\n",
+                      insn_count, insn.reg, arm_rd, insn.rm, arm_rm);
 
         /* Translate using dispatcher */
-        printf("[TRANS] [%d] ⚙️ Calling dispatcher...\n", insn_count);
-        TranslateResult result = dispatch_translate_insn(
-            code_buf, &insn, arm_rd, arm_rm, guest_pc);
+        ROS_LOG_TRACE("[TRANS] [%d] Calling dispatcher...\n", insn_count);
+        TranslateResult result;
+        if (insn.vex_prefix) {
+            translate_x87_flush(code_buf, &x87_state);     /* V16-V23 go back to the AVX cache */
+        }
+        if (translate_mxcsr_lower(code_buf, &mxcsr_state, &insn, current_pc) == 0) {
+            /* LDMXCSR/STMXCSR on FPCR/FPSR; other FP instructions emit nothing for MXCSR */
+            result.success = true;
+            result.is_block_end = false;
+            result.insn_length = insn.length;
+        } else if (x86_is_x87(&insn)) {
+            /* x87 stack cached in V16-V23 */
+            translate_avx_flush(code_buf, &avx_state);
+            if (!x87_state.accurate) {
+                translate_mxcsr_x87_enter(code_buf, &mxcsr_state);  /* FPCR from FCW, flags to FSW */
+            }
+            translate_x87_lower(code_buf, &x87_state, &insn, current_pc);
+            result.success = true;
+            result.is_block_end = false;
+            result.insn_length = insn.length;
+        } else if (translate_avx_lower(code_buf, &avx_state, &insn, current_pc) == 0) {
+            /* VEX forms, with YMM upper halves cached in V16-V27 */
+            result.success = true;
+            result.is_block_end = false;
+            result.insn_length = insn.length;
+        } else if (x86_is_syscall(&insn)) {
+            /* SYSCALL with a constant number calls its handler directly */
+            translate_avx_flush(code_buf, &avx_state);
+            translate_x87_flush(code_buf, &x87_state);
+            translate_mxcsr_flush(code_buf, &mxcsr_state);
+            translate_special_syscall(code_buf, &insn, known_syscall_nr);
+            result.success = true;
+            result.is_block_end = false;
+            result.insn_length = insn.length;
+        } else if (x86_is_movs(&insn) || x86_is_stos(&insn) || x86_is_lods(&insn) ||
+                   x86_is_cmps(&insn) || x86_is_scas(&insn)) {
+            /* MOVS/STOS/LODS/CMPS/SCAS call into C like SYSCALL */
+            translate_avx_flush(code_buf, &avx_state);
+            translate_x87_flush(code_buf, &x87_state);
+            translate_mxcsr_flush(code_buf, &mxcsr_state);
+            result.success = translate_string_emit(code_buf, &insn, current_pc) == 0;
+            result.is_block_end = false;
+            result.insn_length = insn.length;
+        } else {
+            if (x86_is_jcc(&insn) || x86_is_jmp(&insn) || x86_is_call(&insn) || x86_is_ret(&insn)) {
+                translate_avx_flush(code_buf, &avx_state);   /* Cached halves do not survive the exit */
+                translate_x87_flush(code_buf, &x87_state);
+                translate_mxcsr_flush(code_buf, &mxcsr_state);
+            }
+            result = dispatch_translate_insn(code_buf, &insn, arm_rd, arm_rm, guest_pc);
+        }
+        known_syscall_nr = translate_special_track_syscall_nr(&insn, known_syscall_nr);
 
-        printf("[TRANS] [%d] 📊 Dispatcher result: success=%d is_block_end=%d\n",
-               insn_count, result.success, result.is_block_end);
+        ROS_LOG_TRACE("[TRANS] [%d] Dispatcher result: success=%d is_block_end=%d\n",
+                      insn_count, result.success, result.is_block_end);
 
         if (!result.success) {
             /* Translation failed - emit NOP and continue */
-            printf("[TRANS] [%d] ⚠️ Translation failed, emitting NOP\n", insn_count);
+            ROS_LOG_TRACE("[TRANS] [%d] Translation failed, emitting NOP\n", insn_count);
             emit_nop(code_buf);
         }
 
@@ -320,54 +392,61 @@ static void *translate_block_with_memmgr(rosetta_memmgr_t *memmgr,
         insn_count++;
     }
 
-    printf("[TRANS] ==================================================\n");
-    printf("[TRANS] 📈 Translation complete: %d instructions\n", insn_count);
-    printf("[TRANS] 📍 Final PC: 0x%lx\n", current_pc);
-    printf("[TRANS] ==================================================\n");
+    ROS_LOG_DEBUG("[TRANS] ==================================================\n");
+    ROS_LOG_DEBUG("[TRANS] Translation complete: %d instructions\n", insn_count);
+    ROS_LOG_DEBUG("[TRANS] Final PC: 0x%lx\n", current_pc);
+    ROS_LOG_DEBUG("[TRANS] ==================================================\n");
+
+    if (prof) {
+        rosetta_profile_counters(guest_pc, (uint32_t)insn_count);
+    }
 
     /* Ensure block ends with RET if not already */
     if (!terminated) {
-        printf("[TRANS] ⚠️ Block not terminated, emitting RET\n");
+        ROS_LOG_WARN("[TRANS] Block not terminated, emitting RET\n");
+        translate_avx_flush(code_buf, &avx_state);
+        translate_x87_flush(code_buf, &x87_state);
+        translate_mxcsr_flush(code_buf, &mxcsr_state);
         emit_ret(code_buf);
     }
 
     /* Get code size */
     size_t code_size = code_buffer_get_size_arm64(code_buf);
 
-    printf("[TRANS] ==================================================\n");
-    printf("[TRANS] 📊 Generated ARM64 code:\n");
-    printf("[TRANS]   Size: %zu bytes\n", code_size);
+    ROS_LOG_DEBUG("[TRANS] ==================================================\n");
+    ROS_LOG_DEBUG("[TRANS] Generated ARM64 code:\n");
+    ROS_LOG_DEBUG("[TRANS]   Size: %zu bytes\n", code_size);
 
     if (code_size > 0) {
-        printf("[TRANS]   First bytes: ");
+        ROS_LOG_DEBUG("[TRANS]   First bytes: ");
         uint8_t *code_bytes = (uint8_t *)code_cache;
         size_t show_bytes = code_size < 16 ? code_size : 16;
         for (size_t i = 0; i < show_bytes; i++) {
-            printf("%02x ", code_bytes[i]);
+            ROS_LOG_DEBUG("%02x ", code_bytes[i]);
         }
         if (code_size > 16) {
-            printf("...");
+            ROS_LOG_DEBUG("...");
         }
-        printf("\n");
+        ROS_LOG_DEBUG("\n");
     } else {
-        printf("[TRANS]   ❌ WARNING: Code size is 0!\n");
+        ROS_LOG_WARN("[TRANS]   WARNING: Code size is 0!\n");
     }
 
-    printf("[TRANS] ==================================================\n");
+    ROS_LOG_DEBUG("[TRANS] ==================================================\n");
 
     /* Allocate permanent storage for translated code */
-    printf("[TRANS] 💾 Allocating permanent storage (%zu bytes)\n", code_size);
+    ROS_LOG_DEBUG("[TRANS] Allocating permanent storage (%zu bytes)\n", code_size);
 
     void *perm_code = refactored_code_cache_alloc(code_size);
     if (!perm_code) {
         /* Fallback to malloc */
-        printf("[TRANS] ⚠️ Code cache alloc failed, using malloc\n");
+        ROS_LOG_WARN("[TRANS] Code cache alloc failed, using malloc\n");
         perm_code = malloc(code_size);
     }
 
     if (perm_code) {
         /* Copy generated code to permanent storage */
-        printf("[TRANS] 📋 Copying code to %p\n", perm_code);
+        ROS_LOG_DEBUG("[TRANS] Copying code to %p\n", perm_code);
         memcpy(perm_code, code_cache, code_size);
 
         /* Make code executable */
@@ -376,28 +455,30 @@ static void *translate_block_with_memmgr(rosetta_memmgr_t *memmgr,
             void *aligned_ptr = (void *)(((uintptr_t)perm_code) & ~((uintptr_t)page_size - 1));
             size_t aligned_size = ((code_size + page_size - 1) & ~((uintptr_t)page_size - 1));
 
-            printf("[TRANS] 🔒 Setting memory protection: addr=%p size=%zu (RWX)\n",
-                   aligned_ptr, aligned_size);
+            ROS_LOG_DEBUG("[TRANS] Setting memory protection: addr=%p size=%zu (RWX)\n",
+                          aligned_ptr, aligned_size);
 
             if (mprotect(aligned_ptr, aligned_size, PROT_READ | PROT_WRITE | PROT_EXEC) != 0) {
                 perror("[TRANS] ❌ mprotect failed");
             } else {
-                printf("[TRANS] ✅ Memory protection set successfully\n");
+                ROS_LOG_DEBUG("[TRANS] Memory protection set successfully\n");
             }
         #endif
 
         /* Insert into translation cache */
-        printf("[TRANS] 💿 Inserting into translation cache: 0x%lx → %p\n",
-               guest_pc, perm_code);
+        ROS_LOG_DEBUG("[TRANS] Inserting into translation cache: 0x%lx -> %p\n",
+                      guest_pc, perm_code);
         refactored_translation_cache_insert(guest_pc, perm_code, code_size);
+        rosetta_perfmap_record_block(perm_code, (uint32_t)code_size, guest_pc);
+        rosetta_sampler_map_block((uint64_t)(uintptr_t)perm_code, (uint32_t)code_size, guest_pc, NULL);
 
-        printf("[TRANS] ✅ Translation complete: %p (%zu bytes)\n", perm_code, code_size);
+        ROS_LOG_DEBUG("[TRANS] Translation complete: %p (%zu bytes)\n", perm_code, code_size);
     } else {
-        printf("[TRANS] ❌ Failed to allocate permanent storage, using temp buffer\n");
+        ROS_LOG_WARN("[TRANS] Failed to allocate permanent storage, using temp buffer\n");
         perm_code = code_cache;
     }
 
-    printf("[TRANS] ==================================================\n");
+    ROS_LOG_DEBUG("[TRANS] ==================================================\n");
 
     *out_size = code_size;
     return perm_code;
@@ -500,7 +581,7 @@ int rosetta_execute_block(rosetta_exec_ctx_t *ctx, uint64_t block_start)
         return -1;
     }
 
-    printf("[EXEC] Executing block at 0x%lx\n", block_start);
+    ROS_LOG_DEBUG("[EXEC] Executing block at 0x%lx\n", block_start);
 
     /* Set guest PC to block start */
     ctx->state->guest.rip = block_start;
@@ -512,19 +593,29 @@ int rosetta_execute_block(rosetta_exec_ctx_t *ctx, uint64_t block_start)
     void *translated_code = translate_block_with_memmgr(ctx->memmgr, block_start, &code_size);
 
     if (!translated_code) {
-        fprintf(stderr, "[EXEC] Failed to translate block at 0x%lx\n", block_start);
+        ROS_LOG_ERROR("[EXEC] Failed to translate block at 0x%lx\n", block_start);
         return -1;
     }
 
-    printf("[EXEC] Translated code at %p (%zu bytes)\n", translated_code, code_size);
+    ROS_LOG_DEBUG("[EXEC] Translated code at %p (%zu bytes)\n", translated_code, code_size);
 
     /* Execute the translated ARM64 code */
-    printf("[EXEC] Executing translated code...\n");
+    ROS_LOG_DEBUG("[EXEC] Executing translated code...\n");
 
     typedef void (*translated_func_t)(void);
+    /* FPSR holds only the block's flags; they go to guest.mxcsr on return */
+    rosetta_mxcsr_resume(ctx->state);
     ((translated_func_t)translated_code)();
+    rosetta_mxcsr_read(ctx->state);
 
-    printf("[EXEC] Block execution complete\n");
+    /* String helpers that leave guest memory exit at the instruction with SIGSEGV pending */
+    if (ctx->state->pending_signals & (1u << (SIGSEGV - 1))) {
+        ctx->guest_pc = ctx->state->guest.rip;
+        ROS_LOG_ERROR("[EXEC] Guest fault at 0x%lx\n", ctx->guest_pc);
+        return -1;
+    }
+
+    ROS_LOG_DEBUG("[EXEC] Block execution complete\n");
 
     /* Update statistics */
     ctx->blocks_executed++;
@@ -549,7 +640,7 @@ int rosetta_execute(rosetta_exec_ctx_t *ctx, uint64_t entry_point)
         return -1;
     }
 
-    printf("[EXEC] Starting execution at 0x%lx\n", entry_point);
+    ROS_LOG_INFO("[EXEC] Starting execution at 0x%lx\n", entry_point);
 
     /* Set running state */
     ctx->is_running = 1;
@@ -557,6 +648,9 @@ int rosetta_execute(rosetta_exec_ctx_t *ctx, uint64_t entry_point)
     ctx->instructions_executed = 0;
     ctx->exit_code = 0;
 
+    /* FPCR carries the guest rounding mode from here on; FPSR collects its flags */
+    rosetta_mxcsr_enter(ctx->state);
+
     /* Main execution loop */
     const uint64_t max_insns = 100000;  /* Prevent infinite loops */
     int ret = 0;
@@ -565,33 +659,33 @@ int rosetta_execute(rosetta_exec_ctx_t *ctx, uint64_t entry_point)
         /* Execute a basic block */
         ret = rosetta_execute_block(ctx, ctx->guest_pc);
         if (ret < 0) {
-            fprintf(stderr, "[EXEC] Execution error at 0x%lx\n",
-                    ctx->guest_pc);
+            ROS_LOG_ERROR("[EXEC] Execution error at 0x%lx\n",
+                          ctx->guest_pc);
             ret = -1;
             break;
         }
 
         if (ret == 0) {
             /* No instructions executed - possibly hit invalid memory */
-            fprintf(stderr, "[EXEC] No instructions executed, stopping\n");
+            ROS_LOG_WARN("[EXEC] No instructions executed, stopping\n");
             break;
         }
 
         /* Check if we should continue */
         /* For now, just run a limited number of instructions */
         if (ctx->instructions_executed >= 100) {
-            printf("[EXEC] Reached instruction limit (100)\n");
+            ROS_LOG_INFO("[EXEC] Reached instruction limit (100)\n");
             break;
         }
     }
 
     ctx->is_running = 0;
 
-    printf("[EXEC] Execution complete:\n");
-    printf("[EXEC]   Instructions executed: %lu\n", ctx->instructions_executed);
-    printf("[EXEC]   Blocks executed: %lu\n", ctx->blocks_executed);
-    printf("[EXEC]   Final PC: 0x%lx\n", ctx->guest_pc);
-    printf("[EXEC]   Exit code: %d\n", ctx->exit_code);
+    ROS_LOG_INFO("[EXEC] Execution complete:\n");
+    ROS_LOG_INFO("[EXEC]   Instructions executed: %lu\n", ctx->instructions_executed);
+    ROS_LOG_INFO("[EXEC]   Blocks executed: %lu\n", ctx->blocks_executed);
+    ROS_LOG_INFO("[EXEC]   Final PC: 0x%lx\n", ctx->guest_pc);
+    ROS_LOG_INFO("[EXEC]   Exit code: %d\n", ctx->exit_code);
 
     return ret;
 }
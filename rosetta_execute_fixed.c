@@ -8,13 +8,24 @@
 #include "rosetta_execute.h"
 #include "rosetta_refactored.h"
 #include "rosetta_refactored_exec.h"
-#include "rosetta_x86_insns.h"
+#include "rosetta_x86_decode.h"
+#include "rosetta_perfmap.h"
+#include "rosetta_sampler.h"
+#include "rosetta_log.h"
 #include "rosetta_codegen.h"
 #include "rosetta_exec_context.h"
+#include "rosetta_ir.h"
+#include "rosetta_ir_opt.h"
+#include "rosetta_block_profile.h"
+#include "rosetta_mxcsr.h"
+#include "rosetta_translate_avx.h"
+#include "rosetta_translate_x87.h"
+#include "rosetta_translate_mxcsr.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <signal.h>
 #include <sys/mman.h>
 #include <unistd.h>
 #include <stdbool.h>
@@ -40,6 +51,14 @@ extern InsnCategory dispatch_classify_insn(const x86_insn_t *insn);
 extern TranslateResult dispatch_translate_insn(
     void *code_buf, const x86_insn_t *insn,
     uint8_t arm_rd, uint8_t arm_rm, uint64_t block_pc);
+extern void translate_special_syscall(void *code_buf, const x86_insn_t *insn,
+                                      int64_t known_nr);
+extern int64_t translate_special_track_syscall_nr(const x86_insn_t *insn,
+                                                  int64_t known_nr);
+extern int translate_special_vdso(void *code_buf, int func);
+extern int translate_string_emit(void *code_buf, const x86_insn_t *insn, uint64_t pc);
+extern int rosetta_vdso_lookup(uint64_t guest_pc);
+extern int dispatch_syscall_state(ThreadState *state);
 
 /* Forward declarations */
 extern void *refactored_translation_cache_lookup(uint64_t guest_pc);
@@ -57,6 +76,52 @@ static inline uint8_t map_x86_to_arm(uint8_t x86_reg)
  * ============================================================================
  */
 
+/* Guest bytes fetched for the IR front-end: enough for 64 instructions */
+#define IR_FETCH_BYTES  (64 * 15)
+
+/**
+ * Translate a block through the IR: lower, optimize, emit ARM64
+ * @return Guest instructions translated, or 0 if the IR does not cover the
+ *         first instruction or emission failed (code_buf is left unchanged)
+ *
+ * Lowering stops before the first instruction the IR front-end does not
+ * cover and exits to that pc, where the per-instruction path takes over.
+ * With profiling enabled the block bumps its counters.
+ */
+static int translate_block_ir(rosetta_memmgr_t *memmgr, uint64_t guest_pc,
+                              code_buffer_t *code_buf, int max_insns)
+{
+    static _Thread_local ir_block_t blk;
+    uint8_t code[IR_FETCH_BYTES];
+    uint32_t start = code_buf->offset;
+    ssize_t fetched;
+    int count;
+
+    /* Only lower what was fetched: at most one maximal instruction per 15 bytes */
+    fetched = rosetta_memmgr_read(memmgr, guest_pc, code, sizeof(code));
+    if (fetched < 15) {
+        return 0;
+    }
+    if (max_insns > fetched / 15) {
+        max_insns = (int)(fetched / 15);
+    }
+
+    ir_block_init(&blk, guest_pc);
+    blk.syscall_helper = (uint64_t)(uintptr_t)dispatch_syscall_state;
+    count = ir_x86_lower_block(&blk, code, guest_pc, max_insns);
+    if (count <= 0 || ir_optimize(&blk, IR_OPT_ALL, NULL) != 0) {
+        return 0;
+    }
+    rosetta_profile_instrument(&blk);
+
+    if (ir_emit_arm64(&blk, code_buf) != 0) {
+        code_buf->offset = start;
+        code_buf->error = false;
+        return 0;
+    }
+    return count;
+}
+
 /**
  * Translate a basic block using guest memory manager
  * This version properly uses code_buffer_t from rosetta_codegen.c
@@ -65,54 +130,80 @@ static void *translate_block_with_memmgr(rosetta_memmgr_t *memmgr,
                                           uint64_t guest_pc,
                                           size_t *out_size)
 {
-    fprintf(stderr, "[TRANS DEBUG] translate_block_with_memgr called: guest_pc=0x%lx\n", guest_pc);
+    ROS_LOG_TRACE("[TRANS DEBUG] translate_block_with_memgr called: guest_pc=0x%lx\n", guest_pc);
 
     if (!memmgr || !out_size) {
-        fprintf(stderr, "[TRANS DEBUG] NULL parameter!\n");
+        ROS_LOG_TRACE("[TRANS DEBUG] NULL parameter!\n");
         return NULL;
     }
 
-    fprintf(stderr, "[TRANS DEBUG] About to print translation header\n");
-    printf("[TRANS] ==================================================\n");
-    printf("[TRANS] Translating block at 0x%lx\n", guest_pc);
-    printf("[TRANS] ==================================================\n");
-    fprintf(stderr, "[TRANS DEBUG] Translation header printed\n");
+    ROS_LOG_TRACE("[TRANS DEBUG] About to print translation header\n");
+    ROS_LOG_DEBUG("[TRANS] ==================================================\n");
+    ROS_LOG_DEBUG("[TRANS] Translating block at 0x%lx\n", guest_pc);
+    ROS_LOG_DEBUG("[TRANS] ==================================================\n");
+    ROS_LOG_TRACE("[TRANS DEBUG] Translation header printed\n");
 
     /* Check translation cache first */
     void *cached = refactored_translation_cache_lookup(guest_pc);
     if (cached) {
-        printf("[TRANS] ✅ Block found in cache: %p\n", cached);
+        ROS_LOG_DEBUG("[TRANS] Block found in cache: %p\n", cached);
         *out_size = 0;
         return cached;
     }
 
-    printf("[TRANS] 🔍 Block not in cache, translating...\n");
+    ROS_LOG_DEBUG("[TRANS] Block not in cache, translating...\n");
 
     /* Initialize code buffer for ARM64 emission */
     static uint8_t code_cache[65536];  /* 64KB code cache per block */
     static code_buffer_t code_buf_struct;
     code_buffer_t *code_buf = &code_buf_struct;
 
-    printf("[TRANS] 📝 Initializing code buffer: buffer=%p, size=%d\n",
-           code_cache, (int)sizeof(code_cache));
+    ROS_LOG_DEBUG("[TRANS] Initializing code buffer: buffer=%p, size=%d\n",
+                  code_cache, (int)sizeof(code_cache));
 
     int init_result = code_buffer_init(code_buf, code_cache, sizeof(code_cache));
-    printf("[TRANS] 📊 code_buffer_init result: %d\n", init_result);
+    ROS_LOG_DEBUG("[TRANS] code_buffer_init result: %d\n", init_result);
 
     if (init_result != 0) {
-        printf("[TRANS] ❌ Failed to initialize code buffer (error=%d)\n", init_result);
+        ROS_LOG_WARN("[TRANS] Failed to initialize code buffer (error=%d)\n", init_result);
         return NULL;
     }
 
-    printf("[TRANS] ✅ Code buffer initialized (offset=%u)\n", code_buf->offset);
+    ROS_LOG_DEBUG("[TRANS] Code buffer initialized (offset=%u)\n", code_buf->offset);
 
     /* Translate up to 64 instructions or until branch */
     uint64_t current_pc = guest_pc;
     int insn_count = 0;
     int terminated = 0;
+    int64_t known_syscall_nr = -1;  /* Constant in RAX, if any */
     const int max_insns = 64;  /* Increased to test more translation */
+    translate_avx_state_t avx_state;
+    translate_x87_state_t x87_state;
+    translate_mxcsr_state_t mxcsr_state;
+
+    translate_avx_begin_block(&avx_state);
+    translate_x87_begin_block(&x87_state);
+    translate_mxcsr_begin_block(&mxcsr_state);
+
+    /* Calls into the guest vDSO become host intrinsics */
+    int vdso_func = rosetta_vdso_lookup(guest_pc);
+    if (vdso_func >= 0 && translate_special_vdso(code_buf, vdso_func)) {
+        terminated = 1;
+    }
+
+    /* Blocks the IR front-end covers go through lowering and the optimizer */
+    if (!terminated) {
+        insn_count = translate_block_ir(memmgr, guest_pc, code_buf, max_insns);
+        if (insn_count > 0) {
+            ROS_LOG_DEBUG("[TRANS] IR path: %d instructions\n", insn_count);
+            terminated = 1;
+        }
+    }
 
-    printf("[TRANS] 🔄 Starting translation loop (max %d instructions)\n", max_insns);
+    /* Per-instruction blocks count entries only */
+    uint64_t *prof = terminated ? NULL : rosetta_profile_emit_entry(code_buf, guest_pc);
+
+    ROS_LOG_DEBUG("[TRANS] Starting translation loop (max %d instructions)\n", max_insns);
 
     while (insn_count < max_insns && !terminated) {
         /* Fetch x86_64 instruction from guest memory */
@@ -120,50 +211,99 @@ static void *translate_block_with_memmgr(rosetta_memmgr_t *memmgr,
         ssize_t fetched = rosetta_fetch_insn(memmgr, current_pc, insn_buf, sizeof(insn_buf));
 
         if (fetched <= 0) {
-            printf("[TRANS] ❌ Failed to fetch instruction at 0x%lx\n", current_pc);
+            ROS_LOG_WARN("[TRANS] Failed to fetch instruction at 0x%lx\n", current_pc);
             break;
         }
 
-        printf("[TRANS] [%d] 📥 Fetched %zd bytes at 0x%lx: ", insn_count, fetched, current_pc);
+        ROS_LOG_TRACE("[TRANS] [%d] Fetched %zd bytes at 0x%lx: ", insn_count, fetched, current_pc);
         for (int i = 0; i < fetched && i < 8; i++) {
-            printf("%02x ", insn_buf[i]);
+            ROS_LOG_TRACE("%02x ", insn_buf[i]);
         }
-        printf("\n");
+        ROS_LOG_TRACE("\n");
 
         /* Decode x86_64 instruction */
         x86_insn_t insn;
         int insn_len = decode_x86_insn(insn_buf, &insn);
 
         if (insn_len == 0) {
-            printf("[TRANS] ❌ Invalid instruction at 0x%lx, ending block\n", current_pc);
+            ROS_LOG_WARN("[TRANS] Invalid instruction at 0x%lx, ending block\n", current_pc);
             break;
         }
 
-        printf("[TRANS] [%d] 🔎 Decoded: len=%d opcode=0x%02x reg=%d rm=%d\n",
-               insn_count, insn_len, insn.opcode, insn.reg, insn.rm);
+        ROS_LOG_TRACE("[TRANS] [%d] Decoded: len=%d opcode=0x%02x reg=%d rm=%d\n",
+                      insn_count, insn_len, insn.opcode, insn.reg, insn.rm);
 
         /* Map x86_64 registers to ARM64 */
         uint8_t arm_rd = map_x86_to_arm(insn.reg);
         uint8_t arm_rm = map_x86_to_arm(insn.rm);
 
-        printf("[TRANS] [%d] 🔄 Register mapping: x86 reg=%d → ARM r%d, x86 rm=%d → ARM r%d\n",
-               insn_count, insn.reg, arm_rd, insn.rm, arm_rm);
+        ROS_LOG_TRACE("[TRANS] [%d] Register mapping: x86 reg=%d -> ARM r%d, x86 rm=%d -> ARM r%d\n",
+                      insn_count, insn.reg, arm_rd, insn.rm, arm_rm);
 
         /* Translate using dispatcher */
-        printf("[TRANS] [%d] ⚙️ Calling dispatcher...\n", insn_count);
-        fprintf(stderr, "[TRANS DEBUG] Dispatching: opcode=0x%02x category=%d arm_rd=%d arm_rm=%d\n",
-                insn.opcode, dispatch_classify_insn(&insn), arm_rd, arm_rm);
+        ROS_LOG_TRACE("[TRANS] [%d] Calling dispatcher...\n", insn_count);
+        ROS_LOG_TRACE("[TRANS DEBUG] Dispatching: opcode=0x%02x category=%d arm_rd=%d arm_rm=%d\n",
+                      insn.opcode, dispatch_classify_insn(&insn), arm_rd, arm_rm);
 
-        TranslateResult result = dispatch_translate_insn(
-            code_buf, &insn, arm_rd, arm_rm, guest_pc);
+        TranslateResult result;
+        if (insn.vex_prefix) {
+            translate_x87_flush(code_buf, &x87_state);     /* V16-V23 go back to the AVX cache */
+        }
+        if (translate_mxcsr_lower(code_buf, &mxcsr_state, &insn, current_pc) == 0) {
+            /* LDMXCSR/STMXCSR on FPCR/FPSR; other FP instructions emit nothing for MXCSR */
+            result.success = true;
+            result.is_block_end = false;
+            result.insn_length = insn.length;
+        } else if (x86_is_x87(&insn)) {
+            /* x87 stack cached in V16-V23 */
+            translate_avx_flush(code_buf, &avx_state);
+            if (!x87_state.accurate) {
+                translate_mxcsr_x87_enter(code_buf, &mxcsr_state);  /* FPCR from FCW, flags to FSW */
+            }
+            translate_x87_lower(code_buf, &x87_state, &insn, current_pc);
+            result.success = true;
+            result.is_block_end = false;
+            result.insn_length = insn.length;
+        } else if (translate_avx_lower(code_buf, &avx_state, &insn, current_pc) == 0) {
+            /* VEX forms, with YMM upper halves cached in V16-V27 */
+            result.success = true;
+            result.is_block_end = false;
+            result.insn_length = insn.length;
+        } else if (x86_is_syscall(&insn)) {
+            /* SYSCALL with a constant number calls its handler directly */
+            translate_avx_flush(code_buf, &avx_state);
+            translate_x87_flush(code_buf, &x87_state);
+            translate_mxcsr_flush(code_buf, &mxcsr_state);
+            translate_special_syscall(code_buf, &insn, known_syscall_nr);
+            result.success = true;
+            result.is_block_end = false;
+            result.insn_length = insn.length;
+        } else if (x86_is_movs(&insn) || x86_is_stos(&insn) || x86_is_lods(&insn) ||
+                   x86_is_cmps(&insn) || x86_is_scas(&insn)) {
+            /* MOVS/STOS/LODS/CMPS/SCAS call into C like SYSCALL */
+            translate_avx_flush(code_buf, &avx_state);
+            translate_x87_flush(code_buf, &x87_state);
+            translate_mxcsr_flush(code_buf, &mxcsr_state);
+            result.success = translate_string_emit(code_buf, &insn, current_pc) == 0;
+            result.is_block_end = false;
+            result.insn_length = insn.length;
+        } else {
+            if (x86_is_jcc(&insn) || x86_is_jmp(&insn) || x86_is_call(&insn) || x86_is_ret(&insn)) {
+                translate_avx_flush(code_buf, &avx_state);   /* Cached halves do not survive the exit */
+                translate_x87_flush(code_buf, &x87_state);
+                translate_mxcsr_flush(code_buf, &mxcsr_state);
+            }
+            result = dispatch_translate_insn(code_buf, &insn, arm_rd, arm_rm, guest_pc);
+        }
+        known_syscall_nr = translate_special_track_syscall_nr(&insn, known_syscall_nr);
 
-        printf("[TRANS] [%d] 📊 Dispatcher result: success=%d is_block_end=%d\n",
-               insn_count, result.success, result.is_block_end);
-        fprintf(stderr, "[TRANS DEBUG] After dispatch: code_buf->offset=%u\n", code_buf->offset);
+        ROS_LOG_TRACE("[TRANS] [%d] Dispatcher result: success=%d is_block_end=%d\n",
+                      insn_count, result.success, result.is_block_end);
+        ROS_LOG_TRACE("[TRANS DEBUG] After dispatch: code_buf->offset=%u\n", code_buf->offset);
 
         if (!result.success) {
             /* Translation failed - emit NOP and continue */
-            printf("[TRANS] [%d] ⚠️ Translation failed, emitting NOP\n", insn_count);
+            ROS_LOG_TRACE("[TRANS] [%d] Translation failed, emitting NOP\n", insn_count);
             emit_nop(code_buf);
         }
 
@@ -174,14 +314,21 @@ static void *translate_block_with_memmgr(rosetta_memmgr_t *memmgr,
         insn_count++;
     }
 
-    printf("[TRANS] ==================================================\n");
-    printf("[TRANS] 📈 Translation complete: %d instructions\n", insn_count);
-    printf("[TRANS] 📍 Final PC: 0x%lx\n", current_pc);
-    printf("[TRANS] ==================================================\n");
+    ROS_LOG_DEBUG("[TRANS] ==================================================\n");
+    ROS_LOG_DEBUG("[TRANS] Translation complete: %d instructions\n", insn_count);
+    ROS_LOG_DEBUG("[TRANS] Final PC: 0x%lx\n", current_pc);
+    ROS_LOG_DEBUG("[TRANS] ==================================================\n");
+
+    if (prof) {
+        rosetta_profile_counters(guest_pc, (uint32_t)insn_count);
+    }
 
     /* Ensure block ends with RET if not already */
     if (!terminated) {
-        printf("[TRANS] ⚠️ Block not terminated, emitting RET\n");
+        ROS_LOG_WARN("[TRANS] Block not terminated, emitting RET\n");
+        translate_avx_flush(code_buf, &avx_state);
+        translate_x87_flush(code_buf, &x87_state);
+        translate_mxcsr_flush(code_buf, &mxcsr_state);
         emit_ret(code_buf);
     }
 
@@ -189,51 +336,50 @@ static void *translate_block_with_memmgr(rosetta_memmgr_t *memmgr,
     u32 code_size_u32 = code_buffer_get_size(code_buf);
     size_t code_size = code_size_u32;
 
-    fprintf(stderr, "[TRANS DEBUG] Code size: %u bytes\n", code_size_u32);
+    ROS_LOG_TRACE("[TRANS DEBUG] Code size: %u bytes\n", code_size_u32);
 
-    printf("[TRANS] ==================================================\n");
-    printf("[TRANS] 📊 Generated ARM64 code:\n");
-    printf("[TRANS]   Size: %u bytes (offset=%u)\n", code_size_u32, code_buf->offset);
+    ROS_LOG_DEBUG("[TRANS] ==================================================\n");
+    ROS_LOG_DEBUG("[TRANS] Generated ARM64 code:\n");
+    ROS_LOG_DEBUG("[TRANS]   Size: %u bytes (offset=%u)\n", code_size_u32, code_buf->offset);
 
     if (code_size > 0) {
-        printf("[TRANS]   First bytes: ");
+        ROS_LOG_DEBUG("[TRANS]   First bytes: ");
         u8 *code_bytes = (u8 *)code_cache;
         size_t show_bytes = code_size < 16 ? code_size : 16;
         for (size_t i = 0; i < show_bytes; i++) {
-            printf("%02x ", code_bytes[i]);
-            fprintf(stderr, "%02x ", code_bytes[i]);  /* Also print to stderr */
+            ROS_LOG_DEBUG("%02x ", code_bytes[i]);
         }
         if (code_size > 16) {
-            printf("...\n");
-            printf("[TRANS]   Full dump (all %u bytes):\n", code_size);
+            ROS_LOG_DEBUG("...\n");
+            ROS_LOG_TRACE("[TRANS]   Full dump (all %zu bytes):\n", code_size);
             for (size_t i = 0; i < code_size; i++) {
-                if (i % 16 == 0) printf("[TRANS]     %04zx: ", i);
-                printf("%02x ", code_bytes[i]);
-                if (i % 16 == 15 || i == code_size - 1) printf("\n");
+                if (i % 16 == 0) ROS_LOG_TRACE("[TRANS]     %04zx: ", i);
+                ROS_LOG_TRACE("%02x ", code_bytes[i]);
+                if (i % 16 == 15 || i == code_size - 1) ROS_LOG_TRACE("\n");
             }
         } else {
-            printf("\n");
+            ROS_LOG_DEBUG("\n");
         }
     } else {
-        printf("[TRANS]   ❌ WARNING: Code size is 0!\n");
+        ROS_LOG_WARN("[TRANS]   WARNING: Code size is 0!\n");
     }
 
-    printf("[TRANS] ==================================================\n");
-    fprintf(stderr, "[TRANS DEBUG] About to allocate permanent storage\n");
+    ROS_LOG_DEBUG("[TRANS] ==================================================\n");
+    ROS_LOG_TRACE("[TRANS DEBUG] About to allocate permanent storage\n");
 
     /* Allocate permanent storage for translated code */
-    printf("[TRANS] 💾 Allocating permanent storage (%u bytes)\n", code_size_u32);
+    ROS_LOG_DEBUG("[TRANS] Allocating permanent storage (%u bytes)\n", code_size_u32);
 
     void *perm_code = refactored_code_cache_alloc(code_size);
     if (!perm_code) {
         /* Fallback to malloc */
-        printf("[TRANS] ⚠️ Code cache alloc failed, using malloc\n");
+        ROS_LOG_WARN("[TRANS] Code cache alloc failed, using malloc\n");
         perm_code = malloc(code_size);
     }
 
     if (perm_code) {
         /* Copy generated code to permanent storage */
-        printf("[TRANS] 📋 Copying code to %p\n", perm_code);
+        ROS_LOG_DEBUG("[TRANS] Copying code to %p\n", perm_code);
         memcpy(perm_code, code_cache, code_size);
 
         /* Make code executable (W^X compliant: write first, then make executable) */
@@ -242,36 +388,38 @@ static void *translate_block_with_memmgr(rosetta_memmgr_t *memmgr,
             void *aligned_ptr = (void *)(((uintptr_t)perm_code) & ~((uintptr_t)page_size - 1));
             size_t aligned_size = ((code_size + page_size - 1) & ~((uintptr_t)page_size - 1));
 
-            fprintf(stderr, "[TRANS DEBUG] page_size=%ld aligned_ptr=%p aligned_size=%zu\n",
-                    page_size, aligned_ptr, aligned_size);
+            ROS_LOG_TRACE("[TRANS DEBUG] page_size=%ld aligned_ptr=%p aligned_size=%zu\n",
+                          page_size, aligned_ptr, aligned_size);
 
             /* Memory should already be RW from allocation, now make it RX for execution */
-            printf("[TRANS] 🔒 Setting memory protection: addr=%p size=%zu (RX)\n",
-                   aligned_ptr, aligned_size);
+            ROS_LOG_DEBUG("[TRANS] Setting memory protection: addr=%p size=%zu (RX)\n",
+                          aligned_ptr, aligned_size);
 
             int mprotect_result = mprotect(aligned_ptr, aligned_size, PROT_READ | PROT_EXEC);
-            fprintf(stderr, "[TRANS DEBUG] mprotect returned: %d\n", mprotect_result);
+            ROS_LOG_TRACE("[TRANS DEBUG] mprotect returned: %d\n", mprotect_result);
 
             if (mprotect_result != 0) {
                 perror("[TRANS] ❌ mprotect failed");
             } else {
-                printf("[TRANS] ✅ Memory protection set successfully\n");
-                fprintf(stderr, "[TRANS DEBUG] Memory protection set successfully\n");
+                ROS_LOG_DEBUG("[TRANS] Memory protection set successfully\n");
+                ROS_LOG_TRACE("[TRANS DEBUG] Memory protection set successfully\n");
             }
         #endif
 
         /* Insert into translation cache */
-        printf("[TRANS] 💿 Inserting into translation cache: 0x%lx → %p\n",
-               guest_pc, perm_code);
+        ROS_LOG_DEBUG("[TRANS] Inserting into translation cache: 0x%lx -> %p\n",
+                      guest_pc, perm_code);
         refactored_translation_cache_insert(guest_pc, perm_code, code_size_u32);
+        rosetta_perfmap_record_block(perm_code, code_size_u32, guest_pc);
+        rosetta_sampler_map_block((uint64_t)(uintptr_t)perm_code, code_size_u32, guest_pc, NULL);
 
-        printf("[TRANS] ✅ Translation complete: %p (%u bytes)\n", perm_code, code_size_u32);
+        ROS_LOG_DEBUG("[TRANS] Translation complete: %p (%u bytes)\n", perm_code, code_size_u32);
     } else {
-        printf("[TRANS] ❌ Failed to allocate permanent storage, using temp buffer\n");
+        ROS_LOG_WARN("[TRANS] Failed to allocate permanent storage, using temp buffer\n");
         perm_code = code_cache;
     }
 
-    printf("[TRANS] ==================================================\n");
+    ROS_LOG_DEBUG("[TRANS] ==================================================\n");
 
     *out_size = code_size;
     return perm_code;
@@ -466,247 +614,225 @@ void rosetta_exec_destroy(rosetta_exec_ctx_t *ctx)
  */
 int rosetta_execute_block(rosetta_exec_ctx_t *ctx, uint64_t block_start)
 {
-    fprintf(stderr, "[EXEC BLOCK DEBUG] rosetta_execute_block called: block_start=0x%lx\n", block_start);
+    ROS_LOG_TRACE("[EXEC BLOCK DEBUG] rosetta_execute_block called: block_start=0x%lx\n", block_start);
 
     if (!ctx || !ctx->state || !ctx->memmgr) {
-        fprintf(stderr, "[EXEC BLOCK DEBUG] NULL parameter\n");
+        ROS_LOG_TRACE("[EXEC BLOCK DEBUG] NULL parameter\n");
         return -1;
     }
 
-    fprintf(stderr, "[EXEC BLOCK DEBUG] About to print executing message\n");
-    printf("[EXEC] Executing block at 0x%lx\n", block_start);
-    fprintf(stderr, "[EXEC BLOCK DEBUG] Printed executing message\n");
+    ROS_LOG_TRACE("[EXEC BLOCK DEBUG] About to print executing message\n");
+    ROS_LOG_DEBUG("[EXEC] Executing block at 0x%lx\n", block_start);
+    ROS_LOG_TRACE("[EXEC BLOCK DEBUG] Printed executing message\n");
 
     /* Set guest PC to block start */
     ctx->state->guest.rip = block_start;
     ctx->state->current_pc = block_start;
     ctx->guest_pc = block_start;
 
-    fprintf(stderr, "[EXEC BLOCK DEBUG] PC set, about to call translate_block_with_memmgr\n");
+    ROS_LOG_TRACE("[EXEC BLOCK DEBUG] PC set, about to call translate_block_with_memmgr\n");
 
     /* Translate the block using memory manager */
     size_t code_size = 0;
     void *translated_code = translate_block_with_memmgr(ctx->memmgr, block_start, &code_size);
 
-    fprintf(stderr, "[EXEC BLOCK DEBUG] translate_block_with_memmgr returned: code=%p size=%zu\n",
-            translated_code, code_size);
+    ROS_LOG_TRACE("[EXEC BLOCK DEBUG] translate_block_with_memmgr returned: code=%p size=%zu\n",
+                  translated_code, code_size);
 
     if (!translated_code) {
-        fprintf(stderr, "[EXEC] Failed to translate block at 0x%lx\n", block_start);
+        ROS_LOG_ERROR("[EXEC] Failed to translate block at 0x%lx\n", block_start);
         return -1;
     }
 
-    printf("[EXEC] Translated code at %p (%zu bytes)\n", translated_code, code_size);
-    fprintf(stderr, "[EXEC BLOCK DEBUG] Code address: %p (alignment: %s)\n",
-            translated_code, ((uintptr_t)translated_code % 16 == 0) ? "OK" : "BAD");
+    ROS_LOG_DEBUG("[EXEC] Translated code at %p (%zu bytes)\n", translated_code, code_size);
+    ROS_LOG_TRACE("[EXEC BLOCK DEBUG] Code address: %p (alignment: %s)\n",
+                  translated_code, ((uintptr_t)translated_code % 16 == 0) ? "OK" : "BAD");
 
     if (code_size == 0) {
-        fprintf(stderr, "[EXEC] ❌ ERROR: Generated code size is 0!\n");
+        ROS_LOG_ERROR("[EXEC] ERROR: Generated code size is 0!\n");
         return -1;
     }
 
-    /* Disassemble first few instructions */
-    fprintf(stderr, "[EXEC DEBUG] About to disassemble instructions\n");
-    fflush(stderr);
-    printf("[EXEC]   ARM64 instructions (first 10):\n");
-    fflush(stdout);
-    uint32_t *insns = (uint32_t *)translated_code;
-    size_t num_insns = code_size / 4;
-    for (size_t i = 0; i < num_insns && i < 10; i++) {
-        /* Instructions are stored in memory in little-endian format */
-        /* When read as uint32_t on little-endian CPU, we get ARM manual notation */
-        uint32_t insn = insns[i];
-        printf("[EXEC]     [%2zu] %08x  ", i, insn);
-
-        /* Decode common instructions */
-        if (insn == 0xD503201F) {  // NOP
-            printf("NOP\n");
-            fflush(stdout);
-        } else if (insn == 0xD65F03C0) {  // RET
-            printf("RET\n");
-            fflush(stdout);
-        /* MOVZ - Move wide with zero */
-        } else if ((insn & 0xFFE00000) == 0xD2800000) {
-            uint8_t rd = insn & 0x1F;
-            uint16_t imm16 = (insn >> 5) & 0xFFFF;
-            uint8_t hw = (insn >> 21) & 0x3;
-            printf("MOVZ X%d, #0x%x (shift=%d)\n", rd, imm16, hw << 4);
-            fflush(stdout);
-        /* MOVK - Move wide with keep */
-        } else if ((insn & 0xFFE00000) == 0x72800000) {
-            uint8_t rd = insn & 0x1F;
-            uint16_t imm16 = (insn >> 5) & 0xFFFF;
-            uint8_t hw = (insn >> 21) & 0x3;
-            printf("MOVK X%d, #0x%x (shift=%d)\n", rd, imm16, hw << 4);
-            fflush(stdout);
-        /* LDR/STR - Load/Store register (unsigned offset) */
-        } else if ((insn & 0xFFC00000) == 0xF9400000) {
-            uint8_t rt = insn & 0x1F;
-            uint8_t rn = (insn >> 5) & 0x1F;
-            uint16_t offset = ((insn >> 10) & 0xFFF) << 3;
-            printf("LDR X%d, [X%d, #0x%x]\n", rt, rn, offset);
-            fflush(stdout);
-        } else if ((insn & 0xFFC00000) == 0xF9000000) {
-            uint8_t rt = insn & 0x1F;
-            uint8_t rn = (insn >> 5) & 0x1F;
-            uint16_t offset = ((insn >> 10) & 0xFFF) << 3;
-            printf("STR X%d, [X%d, #0x%x]\n", rt, rn, offset);
-            fflush(stdout);
-        } else if ((insn & 0xFFC00000) == 0xB9400000) {
-            uint8_t rt = insn & 0x1F;
-            uint8_t rn = (insn >> 5) & 0x1F;
-            uint16_t offset = ((insn >> 10) & 0xFFF) << 2;
-            printf("LDR W%d, [X%d, #0x%x]\n", rt, rn, offset);
-            fflush(stdout);
-        } else if ((insn & 0xFFC00000) == 0xB9000000) {
-            uint8_t rt = insn & 0x1F;
-            uint8_t rn = (insn >> 5) & 0x1F;
-            uint16_t offset = ((insn >> 10) & 0xFFF) << 2;
-            printf("STR W%d, [X%d, #0x%x]\n", rt, rn, offset);
-            fflush(stdout);
-        /* LDP/STP - Load/Store pair */
-        } else if ((insn & 0xFFC00000) == 0xA9400000) {
-            uint8_t rt = insn & 0x1F;
-            uint8_t rt2 = (insn >> 10) & 0x1F;
-            uint8_t rn = (insn >> 5) & 0x1F;
-            uint16_t offset = ((insn >> 15) & 0x7F) << 3;
-            printf("LDP X%d, X%d, [X%d, #0x%x]\n", rt, rt2, rn, offset);
-            fflush(stdout);
-        } else if ((insn & 0xFFC00000) == 0xA9000000) {
-            uint8_t rt = insn & 0x1F;
-            uint8_t rt2 = (insn >> 10) & 0x1F;
-            uint8_t rn = (insn >> 5) & 0x1F;
-            uint16_t offset = ((insn >> 15) & 0x7F) << 3;
-            printf("STP X%d, X%d, [X%d, #0x%x]\n", rt, rt2, rn, offset);
-            fflush(stdout);
-        } else if ((insn & 0x7FE00000) == 0xAA000000) {
-            uint8_t rd = insn & 0x1F;
-            uint8_t rm = (insn >> 16) & 0x1F;
-            uint8_t rn = (insn >> 5) & 0x1F;
-            if (rn == 31) {
-                printf("MOV X%d, X%d\n", rd, rm);
+    /* Disassemble first few instructions, trace builds only */
+    if (rosetta_log_enabled(ROS_LOG_LEVEL_TRACE)) {
+        ROS_LOG_TRACE("[EXEC DEBUG] About to disassemble instructions\n");
+        ROS_LOG_TRACE("[EXEC]   ARM64 instructions (first 10):\n");
+        uint32_t *insns = (uint32_t *)translated_code;
+        size_t num_insns = code_size / 4;
+        for (size_t i = 0; i < num_insns && i < 10; i++) {
+            /* Instructions are stored in memory in little-endian format */
+            /* When read as uint32_t on little-endian CPU, we get ARM manual notation */
+            uint32_t insn = insns[i];
+            ROS_LOG_TRACE("[EXEC]     [%2zu] %08x  ", i, insn);
+
+            /* Decode common instructions */
+            if (insn == 0xD503201F) {  // NOP
+                ROS_LOG_TRACE("NOP\n");
+            } else if (insn == 0xD65F03C0) {  // RET
+                ROS_LOG_TRACE("RET\n");
+            /* MOVZ - Move wide with zero */
+            } else if ((insn & 0xFFE00000) == 0xD2800000) {
+                uint8_t rd = insn & 0x1F;
+                uint16_t imm16 = (insn >> 5) & 0xFFFF;
+                uint8_t hw = (insn >> 21) & 0x3;
+                ROS_LOG_TRACE("MOVZ X%d, #0x%x (shift=%d)\n", rd, imm16, hw << 4);
+            /* MOVK - Move wide with keep */
+            } else if ((insn & 0xFFE00000) == 0x72800000) {
+                uint8_t rd = insn & 0x1F;
+                uint16_t imm16 = (insn >> 5) & 0xFFFF;
+                uint8_t hw = (insn >> 21) & 0x3;
+                ROS_LOG_TRACE("MOVK X%d, #0x%x (shift=%d)\n", rd, imm16, hw << 4);
+            /* LDR/STR - Load/Store register (unsigned offset) */
+            } else if ((insn & 0xFFC00000) == 0xF9400000) {
+                uint8_t rt = insn & 0x1F;
+                uint8_t rn = (insn >> 5) & 0x1F;
+                uint16_t offset = ((insn >> 10) & 0xFFF) << 3;
+                ROS_LOG_TRACE("LDR X%d, [X%d, #0x%x]\n", rt, rn, offset);
+            } else if ((insn & 0xFFC00000) == 0xF9000000) {
+                uint8_t rt = insn & 0x1F;
+                uint8_t rn = (insn >> 5) & 0x1F;
+                uint16_t offset = ((insn >> 10) & 0xFFF) << 3;
+                ROS_LOG_TRACE("STR X%d, [X%d, #0x%x]\n", rt, rn, offset);
+            } else if ((insn & 0xFFC00000) == 0xB9400000) {
+                uint8_t rt = insn & 0x1F;
+                uint8_t rn = (insn >> 5) & 0x1F;
+                uint16_t offset = ((insn >> 10) & 0xFFF) << 2;
+                ROS_LOG_TRACE("LDR W%d, [X%d, #0x%x]\n", rt, rn, offset);
+            } else if ((insn & 0xFFC00000) == 0xB9000000) {
+                uint8_t rt = insn & 0x1F;
+                uint8_t rn = (insn >> 5) & 0x1F;
+                uint16_t offset = ((insn >> 10) & 0xFFF) << 2;
+                ROS_LOG_TRACE("STR W%d, [X%d, #0x%x]\n", rt, rn, offset);
+            /* LDP/STP - Load/Store pair */
+            } else if ((insn & 0xFFC00000) == 0xA9400000) {
+                uint8_t rt = insn & 0x1F;
+                uint8_t rt2 = (insn >> 10) & 0x1F;
+                uint8_t rn = (insn >> 5) & 0x1F;
+                uint16_t offset = ((insn >> 15) & 0x7F) << 3;
+                ROS_LOG_TRACE("LDP X%d, X%d, [X%d, #0x%x]\n", rt, rt2, rn, offset);
+            } else if ((insn & 0xFFC00000) == 0xA9000000) {
+                uint8_t rt = insn & 0x1F;
+                uint8_t rt2 = (insn >> 10) & 0x1F;
+                uint8_t rn = (insn >> 5) & 0x1F;
+                uint16_t offset = ((insn >> 15) & 0x7F) << 3;
+                ROS_LOG_TRACE("STP X%d, X%d, [X%d, #0x%x]\n", rt, rt2, rn, offset);
+            } else if ((insn & 0x7FE00000) == 0xAA000000) {
+                uint8_t rd = insn & 0x1F;
+                uint8_t rm = (insn >> 16) & 0x1F;
+                uint8_t rn = (insn >> 5) & 0x1F;
+                if (rn == 31) {
+                    ROS_LOG_TRACE("MOV X%d, X%d\n", rd, rm);
+                } else {
+                    ROS_LOG_TRACE("ORR X%d, X%d, X%d\n", rd, rn, rm);
+                }
+            /* ORR with shift */
+            } else if ((insn & 0x7F800000) == 0x2A000000) {
+                uint8_t rd = insn & 0x1F;
+                uint8_t rm = (insn >> 16) & 0x1F;
+                uint8_t rn = (insn >> 5) & 0x1F;
+                uint8_t shift = (insn >> 22) & 0x3;
+                const char *shifts[] = {"LSL", "LSR", "ASR", "ROR"};
+                uint8_t shift_amount = (insn >> 10) & 0x3F;
+                ROS_LOG_TRACE("ORR X%d, X%d, X%d, %s #%d\n", rd, rn, rm, shifts[shift], shift_amount);
+            } else if ((insn & 0x7FE00000) == 0x0B000000) {
+                ROS_LOG_TRACE("ADD X%d, X%d, X%d\n", insn & 0x1F, (insn >> 5) & 0x1F, (insn >> 16) & 0x1F);
+            /* ADD/SUB immediate */
+            } else if ((insn & 0xFFC00000) == 0x91000000) {
+                uint8_t rd = insn & 0x1F;
+                uint8_t rn = (insn >> 5) & 0x1F;
+                uint16_t imm12 = ((insn >> 10) & 0xFFF);
+                const char *rd_name = (rd == 31) ? "SP" : "";
+                const char *rn_name = (rn == 31) ? "SP" : "";
+                ROS_LOG_TRACE("ADD %s%s%d, %s%s%d, #0x%x\n", rd_name, rd_name[0] ? "" : "X", rd, rn_name, rn_name[0] ? "" : "X", rn, imm12);
+            } else if ((insn & 0xFFC00000) == 0xD1000000) {
+                uint8_t rd = insn & 0x1F;
+                uint8_t rn = (insn >> 5) & 0x1F;
+                uint16_t imm12 = ((insn >> 10) & 0xFFF);
+                const char *rd_name = (rd == 31) ? "SP" : "";
+                const char *rn_name = (rn == 31) ? "SP" : "";
+                ROS_LOG_TRACE("SUB %s%s%d, %s%s%d, #0x%x\n", rd_name, rd_name[0] ? "" : "X", rd, rn_name, rn_name[0] ? "" : "X", rn, imm12);
+            /* ADDS/SUBS immediate (with flags) */
+            } else if ((insn & 0xFFC00000) == 0xB1000000) {
+                uint8_t rd = insn & 0x1F;
+                uint8_t rn = (insn >> 5) & 0x1F;
+                uint16_t imm12 = ((insn >> 10) & 0xFFF);
+                ROS_LOG_TRACE("ADDS X%d, X%d, #0x%x\n", rd, rn, imm12);
+            } else if ((insn & 0xFFC00000) == 0xF1000000) {
+                uint8_t rd = insn & 0x1F;
+                uint8_t rn = (insn >> 5) & 0x1F;
+                uint16_t imm12 = ((insn >> 10) & 0xFFF);
+                const char *rd_name = (rd == 31) ? "SP" : "";
+                const char *rn_name = (rn == 31) ? "SP" : "";
+                ROS_LOG_TRACE("SUBS %s%s%d, %s%s%d, #0x%x\n", rd_name, rd_name[0] ? "" : "X", rd, rn_name, rn_name[0] ? "" : "X", rn, imm12);
+            /* Load/Store register (unscaled offset) */
+            } else if ((insn & 0x3FE00000) == 0x38000000) {
+                uint8_t rt = insn & 0x1F;
+                uint8_t rn = (insn >> 5) & 0x1F;
+                uint8_t size = (insn >> 30) & 0x3;
+                int16_t offset = ((insn >> 12) & 0x1FF) | (((insn >> 26) & 1) << 8);
+                if (offset & (1 << 8)) offset |= ~((1 << 9) - 1);  // Sign extend
+                const char *regs[] = {"B", "H", "", "X"};
+                const char *reg = (size == 3) ? "X" : (size == 2) ? "W" : regs[size];
+                if (insn & (1 << 22)) {  // Load
+                    ROS_LOG_TRACE("LDR %s%d, [X%d, #%d]\n", reg, rt, rn, offset);
+                } else {  // Store
+                    ROS_LOG_TRACE("STR %s%d, [X%d, #%d]\n", reg, rt, rn, offset);
+                }
+            /* PC-relative addressing */
+            } else if ((insn & 0x9F000000) == 0x10000000) {
+                uint8_t rd = insn & 0x1F;
+                uint32_t immhi = ((insn >> 5) & 0x7FFFF) << 2;
+                uint32_t immlo = ((insn >> 29) & 0x3);
+                int32_t offset = (immhi | immlo);
+                if (offset & (1 << 20)) offset |= ~((1 << 21) - 1);  // Sign extend
+                if ((insn & (1 << 31)) == 0) {  // ADR
+                    ROS_LOG_TRACE("ADR X%d, +#0x%x\n", rd, offset);
+                } else {  // ADRP
+                    ROS_LOG_TRACE("ADRP X%d, +#0x%x\n", rd, offset);
+                }
+            } else if ((insn & 0xFFE00C00) == 0xF8000000) {
+                uint8_t rt = insn & 0x1F;
+                uint8_t rn = (insn >> 5) & 0x1F;
+                int16_t offset = ((insn >> 12) & 0x1FF) | (((insn >> 26) & 1) << 8);
+                if (offset & (1 << 8)) offset |= ~((1 << 9) - 1);  // Sign extend
+                if (insn & (1 << 22)) {  // Load
+                    ROS_LOG_TRACE("LDR X%d, [X%d, #%d]\n", rt, rn, offset);
+                } else {  // Store
+                    ROS_LOG_TRACE("STR X%d, [X%d, #%d]\n", rt, rn, offset);
+                }
+            } else if ((insn & 0xFFE00C00) == 0xF8400000) {
+                uint8_t rt = insn & 0x1F;
+                uint8_t rn = (insn >> 5) & 0x1F;
+                int16_t offset = ((insn >> 12) & 0x1FF) | (((insn >> 26) & 1) << 8);
+                if (offset & (1 << 8)) offset |= ~((1 << 9) - 1);  // Sign extend
+                if (insn & (1 << 22)) {  // Load
+                    ROS_LOG_TRACE("LDR W%d, [X%d, #%d]\n", rt, rn, offset);
+                } else {  // Store
+                    ROS_LOG_TRACE("STR W%d, [X%d, #%d]\n", rt, rn, offset);
+                }
+            /* Conditional branch */
+            } else if ((insn & 0xFF000010) == 0x54000000) {
+                uint8_t cond = (insn >> 4) & 0xF;
+                int32_t offset = ((insn >> 5) & 0x7FFFF) | (((insn >> 24) & 1) << 18);
+                if (offset & (1 << 18)) offset |= ~((1 << 19) - 1);  // Sign extend
+                const char *conds[] = {"EQ", "NE", "CS", "CC", "MI", "PL", "VS", "VC", "HI", "LS", "GE", "LT", "GT", "LE", "AL", "NV"};
+                ROS_LOG_TRACE("B.%s +0x%x\n", conds[cond], offset << 2);
             } else {
-                printf("ORR X%d, X%d, X%d\n", rd, rn, rm);
-            }
-            fflush(stdout);
-        /* ORR with shift */
-        } else if ((insn & 0x7F800000) == 0x2A000000) {
-            uint8_t rd = insn & 0x1F;
-            uint8_t rm = (insn >> 16) & 0x1F;
-            uint8_t rn = (insn >> 5) & 0x1F;
-            uint8_t shift = (insn >> 22) & 0x3;
-            const char *shifts[] = {"LSL", "LSR", "ASR", "ROR"};
-            uint8_t shift_amount = (insn >> 10) & 0x3F;
-            printf("ORR X%d, X%d, X%d, %s #%d\n", rd, rn, rm, shifts[shift], shift_amount);
-            fflush(stdout);
-        } else if ((insn & 0x7FE00000) == 0x0B000000) {
-            printf("ADD X%d, X%d, X%d\n", insn & 0x1F, (insn >> 5) & 0x1F, (insn >> 16) & 0x1F);
-            fflush(stdout);
-        /* ADD/SUB immediate */
-        } else if ((insn & 0xFFC00000) == 0x91000000) {
-            uint8_t rd = insn & 0x1F;
-            uint8_t rn = (insn >> 5) & 0x1F;
-            uint16_t imm12 = ((insn >> 10) & 0xFFF);
-            const char *rd_name = (rd == 31) ? "SP" : "";
-            const char *rn_name = (rn == 31) ? "SP" : "";
-            printf("ADD %s%s%d, %s%s%d, #0x%x\n", rd_name, rd_name[0] ? "" : "X", rd, rn_name, rn_name[0] ? "" : "X", rn, imm12);
-            fflush(stdout);
-        } else if ((insn & 0xFFC00000) == 0xD1000000) {
-            uint8_t rd = insn & 0x1F;
-            uint8_t rn = (insn >> 5) & 0x1F;
-            uint16_t imm12 = ((insn >> 10) & 0xFFF);
-            const char *rd_name = (rd == 31) ? "SP" : "";
-            const char *rn_name = (rn == 31) ? "SP" : "";
-            printf("SUB %s%s%d, %s%s%d, #0x%x\n", rd_name, rd_name[0] ? "" : "X", rd, rn_name, rn_name[0] ? "" : "X", rn, imm12);
-            fflush(stdout);
-        /* ADDS/SUBS immediate (with flags) */
-        } else if ((insn & 0xFFC00000) == 0xB1000000) {
-            uint8_t rd = insn & 0x1F;
-            uint8_t rn = (insn >> 5) & 0x1F;
-            uint16_t imm12 = ((insn >> 10) & 0xFFF);
-            printf("ADDS X%d, X%d, #0x%x\n", rd, rn, imm12);
-            fflush(stdout);
-        } else if ((insn & 0xFFC00000) == 0xF1000000) {
-            uint8_t rd = insn & 0x1F;
-            uint8_t rn = (insn >> 5) & 0x1F;
-            uint16_t imm12 = ((insn >> 10) & 0xFFF);
-            const char *rd_name = (rd == 31) ? "SP" : "";
-            const char *rn_name = (rn == 31) ? "SP" : "";
-            printf("SUBS %s%s%d, %s%s%d, #0x%x\n", rd_name, rd_name[0] ? "" : "X", rd, rn_name, rn_name[0] ? "" : "X", rn, imm12);
-            fflush(stdout);
-        /* Load/Store register (unscaled offset) */
-        } else if ((insn & 0x3FE00000) == 0x38000000) {
-            uint8_t rt = insn & 0x1F;
-            uint8_t rn = (insn >> 5) & 0x1F;
-            uint8_t size = (insn >> 30) & 0x3;
-            int16_t offset = ((insn >> 12) & 0x1FF) | (((insn >> 26) & 1) << 8);
-            if (offset & (1 << 8)) offset |= ~((1 << 9) - 1);  // Sign extend
-            const char *regs[] = {"B", "H", "", "X"};
-            const char *reg = (size == 3) ? "X" : (size == 2) ? "W" : regs[size];
-            if (insn & (1 << 22)) {  // Load
-                printf("LDR %s%d, [X%d, #%d]\n", reg, rt, rn, offset);
-            } else {  // Store
-                printf("STR %s%d, [X%d, #%d]\n", reg, rt, rn, offset);
+                ROS_LOG_TRACE("UNKNOWN (may cause segfault)\n");
+                ROS_LOG_WARN("[EXEC WARNING] Unknown instruction 0x%08x at offset %zu\n", insn, i*4);
             }
-            fflush(stdout);
-        /* PC-relative addressing */
-        } else if ((insn & 0x9F000000) == 0x10000000) {
-            uint8_t rd = insn & 0x1F;
-            uint32_t immhi = ((insn >> 5) & 0x7FFFF) << 2;
-            uint32_t immlo = ((insn >> 29) & 0x3);
-            int32_t offset = (immhi | immlo);
-            if (offset & (1 << 20)) offset |= ~((1 << 21) - 1);  // Sign extend
-            if ((insn & (1 << 31)) == 0) {  // ADR
-                printf("ADR X%d, +#0x%x\n", rd, offset);
-            } else {  // ADRP
-                printf("ADRP X%d, +#0x%x\n", rd, offset);
-            }
-            fflush(stdout);
-        } else if ((insn & 0xFFE00C00) == 0xF8000000) {
-            uint8_t rt = insn & 0x1F;
-            uint8_t rn = (insn >> 5) & 0x1F;
-            int16_t offset = ((insn >> 12) & 0x1FF) | (((insn >> 26) & 1) << 8);
-            if (offset & (1 << 8)) offset |= ~((1 << 9) - 1);  // Sign extend
-            if (insn & (1 << 22)) {  // Load
-                printf("LDR X%d, [X%d, #%d]\n", rt, rn, offset);
-            } else {  // Store
-                printf("STR X%d, [X%d, #%d]\n", rt, rn, offset);
-            }
-            fflush(stdout);
-        } else if ((insn & 0xFFE00C00) == 0xF8400000) {
-            uint8_t rt = insn & 0x1F;
-            uint8_t rn = (insn >> 5) & 0x1F;
-            int16_t offset = ((insn >> 12) & 0x1FF) | (((insn >> 26) & 1) << 8);
-            if (offset & (1 << 8)) offset |= ~((1 << 9) - 1);  // Sign extend
-            if (insn & (1 << 22)) {  // Load
-                printf("LDR W%d, [X%d, #%d]\n", rt, rn, offset);
-            } else {  // Store
-                printf("STR W%d, [X%d, #%d]\n", rt, rn, offset);
-            }
-            fflush(stdout);
-        /* Conditional branch */
-        } else if ((insn & 0xFF000010) == 0x54000000) {
-            uint8_t cond = (insn >> 4) & 0xF;
-            int32_t offset = ((insn >> 5) & 0x7FFFF) | (((insn >> 24) & 1) << 18);
-            if (offset & (1 << 18)) offset |= ~((1 << 19) - 1);  // Sign extend
-            const char *conds[] = {"EQ", "NE", "CS", "CC", "MI", "PL", "VS", "VC", "HI", "LS", "GE", "LT", "GT", "LE", "AL", "NV"};
-            printf("B.%s +0x%x\n", conds[cond], offset << 2);
-            fflush(stdout);
-        } else {
-            printf("UNKNOWN (may cause segfault)\n");
-            fprintf(stderr, "[EXEC WARNING] Unknown instruction 0x%08x at offset %zu\n", insn, i*4);
         }
     }
 
     /* Execute the translated ARM64 code */
-    fprintf(stderr, "[EXEC BLOCK DEBUG] About to execute translated code\n");
-    printf("[EXEC] ⚙️ Executing translated code...\n");
+    ROS_LOG_TRACE("[EXEC BLOCK DEBUG] About to execute translated code\n");
+    ROS_LOG_DEBUG("[EXEC] Executing translated code...\n");
 
     /* Set up execution context for translated code */
     /* Allocate on heap for stability */
     rosetta_exec_context_t *exec_ctx = calloc(1, sizeof(rosetta_exec_context_t));
     if (!exec_ctx) {
-        fprintf(stderr, "[EXEC] Failed to allocate execution context\n");
+        ROS_LOG_ERROR("[EXEC] Failed to allocate execution context\n");
         return -1;
     }
 
@@ -714,38 +840,53 @@ int rosetta_execute_block(rosetta_exec_ctx_t *ctx, uint64_t block_start)
     exec_ctx->guest_mem_size = ctx->memmgr->total_size;
     exec_ctx->state = ctx->state;
 
-    printf("[EXEC] 📋 Execution context setup:\n");
-    printf("[EXEC]   context ptr: %p\n", exec_ctx);
-    printf("[EXEC]   guest_mem_base: %p\n", exec_ctx->guest_mem_base);
-    printf("[EXEC]   guest_mem_size: 0x%lx\n", exec_ctx->guest_mem_size);
-    printf("[EXEC]   state: %p\n", exec_ctx->state);
+    ROS_LOG_DEBUG("[EXEC] Execution context setup:\n");
+    ROS_LOG_DEBUG("[EXEC]   context ptr: %p\n", exec_ctx);
+    ROS_LOG_DEBUG("[EXEC]   guest_mem_base: %p\n", exec_ctx->guest_mem_base);
+    ROS_LOG_DEBUG("[EXEC]   guest_mem_size: 0x%lx\n", exec_ctx->guest_mem_size);
+    ROS_LOG_DEBUG("[EXEC]   state: %p\n", exec_ctx->state);
 
     /* Call translated code with X18 pointing to execution context */
     /* X18 is reserved as platform register in ARM64 ABI */
-    printf("[EXEC] ⚙️ Calling translated code (X18 = %p)...\n", exec_ctx);
+    ROS_LOG_DEBUG("[EXEC] Calling translated code (X18 = %p)...\n", exec_ctx);
 
     /* Clear instruction cache - required before executing dynamically generated code on ARM64 */
-    fprintf(stderr, "[EXEC DEBUG] Clearing instruction cache for %p (%zu bytes)\n",
-            translated_code, code_size);
+    ROS_LOG_TRACE("[EXEC DEBUG] Clearing instruction cache for %p (%zu bytes)\n",
+                  translated_code, code_size);
     __builtin___clear_cache((char *)translated_code, (char *)translated_code + code_size);
-    fprintf(stderr, "[EXEC DEBUG] Instruction cache cleared\n");
+    ROS_LOG_TRACE("[EXEC DEBUG] Instruction cache cleared\n");
 
     typedef void (*translated_func_t)(void);
 
     /* Set X18 to point to execution context, then call translated code */
     /* Use inline assembly to set X18 before the call */
+    /* Guest registers live in X0-X15 and the block uses X16/X17 and LR */
+    /* FPSR holds only the block's flags; they go to guest.mxcsr on return */
+    rosetta_mxcsr_resume(ctx->state);
     __asm__ volatile(
         "mov x18, %0\n"       /* Set X18 to execution context */
         "blr %1\n"            /* Call translated code */
         :
         : "r"(exec_ctx), "r"(translated_code)
-        : "x18", "memory"
+        : "x0", "x1", "x2", "x3", "x4", "x5", "x6", "x7", "x8", "x9", "x10",
+          "x11", "x12", "x13", "x14", "x15", "x16", "x17", "x18", "x30",
+          "cc", "memory"
     );
+    rosetta_mxcsr_read(ctx->state);
 
     free(exec_ctx);
 
-    fprintf(stderr, "[EXEC BLOCK DEBUG] Executed translated code\n");
-    printf("[EXEC] ✅ Block execution complete\n");
+    /* IR blocks store their successor to guest.rip */
+    ctx->guest_pc = ctx->state->guest.rip;
+
+    /* String helpers that leave guest memory exit at the instruction with SIGSEGV pending */
+    if (ctx->state->pending_signals & (1u << (SIGSEGV - 1))) {
+        ROS_LOG_ERROR("[EXEC] Guest fault at 0x%lx\n", ctx->guest_pc);
+        return -1;
+    }
+
+    ROS_LOG_TRACE("[EXEC BLOCK DEBUG] Executed translated code\n");
+    ROS_LOG_DEBUG("[EXEC] Block execution complete\n");
 
     /* Update statistics */
     ctx->blocks_executed++;
@@ -765,19 +906,19 @@ int rosetta_execute_block(rosetta_exec_ctx_t *ctx, uint64_t block_start)
  */
 int rosetta_execute(rosetta_exec_ctx_t *ctx, uint64_t entry_point)
 {
-    fprintf(stderr, "[EXEC DEBUG] rosetta_execute called: ctx=%p entry_point=%lx\n", ctx, entry_point);
+    ROS_LOG_TRACE("[EXEC DEBUG] rosetta_execute called: ctx=%p entry_point=%lx\n", ctx, entry_point);
 
     if (!ctx || !ctx->state || !ctx->memmgr) {
-        fprintf(stderr, "[EXEC DEBUG] NULL parameter detected\n");
+        ROS_LOG_TRACE("[EXEC DEBUG] NULL parameter detected\n");
         return -1;
     }
 
-    fprintf(stderr, "[EXEC DEBUG] Parameters validated\n");
-    fprintf(stderr, "[EXEC DEBUG] About to print start message\n");
+    ROS_LOG_TRACE("[EXEC DEBUG] Parameters validated\n");
+    ROS_LOG_TRACE("[EXEC DEBUG] About to print start message\n");
 
-    printf("[EXEC] Starting execution at 0x%lx\n", entry_point);
+    ROS_LOG_INFO("[EXEC] Starting execution at 0x%lx\n", entry_point);
 
-    fprintf(stderr, "[EXEC DEBUG] Start message printed\n");
+    ROS_LOG_TRACE("[EXEC DEBUG] Start message printed\n");
 
     /* Set running state */
     ctx->is_running = 1;
@@ -785,52 +926,55 @@ int rosetta_execute(rosetta_exec_ctx_t *ctx, uint64_t entry_point)
     ctx->instructions_executed = 0;
     ctx->exit_code = 0;
 
-    fprintf(stderr, "[EXEC DEBUG] State initialized\n");
+    /* FPCR carries the guest rounding mode from here on; FPSR collects its flags */
+    rosetta_mxcsr_enter(ctx->state);
+
+    ROS_LOG_TRACE("[EXEC DEBUG] State initialized\n");
 
     /* Main execution loop */
     const uint64_t max_insns = 10000;  /* Increased for more comprehensive testing */
     int ret = 0;
 
-    fprintf(stderr, "[EXEC DEBUG] About to enter execution loop\n");
+    ROS_LOG_TRACE("[EXEC DEBUG] About to enter execution loop\n");
 
     while (ctx->is_running && ctx->instructions_executed < max_insns) {
-        fprintf(stderr, "[EXEC DEBUG] Loop iteration: is_running=%d insns_executed=%lu\n",
-                ctx->is_running, ctx->instructions_executed);
+        ROS_LOG_TRACE("[EXEC DEBUG] Loop iteration: is_running=%d insns_executed=%lu\n",
+                      ctx->is_running, ctx->instructions_executed);
 
         /* Execute a basic block */
-        fprintf(stderr, "[EXEC DEBUG] About to call rosetta_execute_block(pc=0x%lx)\n", ctx->guest_pc);
+        ROS_LOG_TRACE("[EXEC DEBUG] About to call rosetta_execute_block(pc=0x%lx)\n", ctx->guest_pc);
         ret = rosetta_execute_block(ctx, ctx->guest_pc);
-        fprintf(stderr, "[EXEC DEBUG] rosetta_execute_block returned: %d\n", ret);
+        ROS_LOG_TRACE("[EXEC DEBUG] rosetta_execute_block returned: %d\n", ret);
 
         if (ret < 0) {
-            fprintf(stderr, "[EXEC] Execution error at 0x%lx\n",
-                    ctx->guest_pc);
+            ROS_LOG_ERROR("[EXEC] Execution error at 0x%lx\n",
+                          ctx->guest_pc);
             ret = -1;
             break;
         }
 
         if (ret == 0) {
             /* No instructions executed - possibly hit invalid memory */
-            fprintf(stderr, "[EXEC] No instructions executed, stopping\n");
+            ROS_LOG_WARN("[EXEC] No instructions executed, stopping\n");
             break;
         }
 
         /* Check if we should continue */
         if (ctx->instructions_executed >= 1000) {
-            printf("[EXEC] Reached instruction limit (1000)\n");
+            ROS_LOG_INFO("[EXEC] Reached instruction limit (1000)\n");
             break;
         }
     }
 
-    fprintf(stderr, "[EXEC DEBUG] Exit execution loop\n");
+    ROS_LOG_TRACE("[EXEC DEBUG] Exit execution loop\n");
 
     ctx->is_running = 0;
 
-    printf("[EXEC] Execution complete:\n");
-    printf("[EXEC]   Instructions executed: %lu\n", ctx->instructions_executed);
-    printf("[EXEC]   Blocks executed: %lu\n", ctx->blocks_executed);
-    printf("[EXEC]   Final PC: 0x%lx\n", ctx->guest_pc);
-    printf("[EXEC]   Exit code: %d\n", ctx->exit_code);
+    ROS_LOG_INFO("[EXEC] Execution complete:\n");
+    ROS_LOG_INFO("[EXEC]   Instructions executed: %lu\n", ctx->instructions_executed);
+    ROS_LOG_INFO("[EXEC]   Blocks executed: %lu\n", ctx->blocks_executed);
+    ROS_LOG_INFO("[EXEC]   Final PC: 0x%lx\n", ctx->guest_pc);
+    ROS_LOG_INFO("[EXEC]   Exit code: %d\n", ctx->exit_code);
 
     return ret;
 }
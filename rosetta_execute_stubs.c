@@ -109,85 +109,4 @@ static size_t code_buffer_get_size_arm64(void *buf)
     return impl->size;
 }
 
-/* ============================================================================
- * SIMD Translation Stubs
- * ============================================================================
- *
- * Stub implementations for SIMD translation functions.
- * These are temporary placeholders until SIMD translation is implemented.
- * ============================================================================ */
-
-#include "rosetta_x86_insns.h"
-#include "rosetta_codegen.h"
-
-/* Stub macro for creating SIMD translation stubs */
-#define SIMD_STUB(name) \
-    void name(code_buffer_t *code_buf, const x86_insn_t *insn, uint8_t arm_rd, uint8_t arm_rm) { \
-        (void)code_buf; (void)insn; (void)arm_rd; (void)arm_rm; \
-    }
-
-/* Generate stubs for all SIMD functions */
-SIMD_STUB(translate_simd_mov)
-SIMD_STUB(translate_simd_movhl)
-SIMD_STUB(translate_simd_movdqa)
-SIMD_STUB(translate_simd_movq)
-SIMD_STUB(translate_simd_addps)
-SIMD_STUB(translate_simd_addpd)
-SIMD_STUB(translate_simd_addss)
-SIMD_STUB(translate_simd_addsd)
-SIMD_STUB(translate_simd_subps)
-SIMD_STUB(translate_simd_subpd)
-SIMD_STUB(translate_simd_subss)
-SIMD_STUB(translate_simd_subsd)
-SIMD_STUB(translate_simd_mulps)
-SIMD_STUB(translate_simd_mulpd)
-SIMD_STUB(translate_simd_mulss)
-SIMD_STUB(translate_simd_mulsd)
-SIMD_STUB(translate_simd_divps)
-SIMD_STUB(translate_simd_divpd)
-SIMD_STUB(translate_simd_divss)
-SIMD_STUB(translate_simd_divsd)
-SIMD_STUB(translate_simd_cmpps)
-SIMD_STUB(translate_simd_cmppd)
-SIMD_STUB(translate_simd_cmpss)
-SIMD_STUB(translate_simd_cmpsd)
-SIMD_STUB(translate_simd_comiss)
-SIMD_STUB(translate_simd_ucomiss)
-SIMD_STUB(translate_simd_and)
-SIMD_STUB(translate_simd_or)
-SIMD_STUB(translate_simd_xor)
-SIMD_STUB(translate_simd_pand)
-SIMD_STUB(translate_simd_por)
-SIMD_STUB(translate_simd_pxor)
-SIMD_STUB(translate_simd_pandn)
-SIMD_STUB(translate_simd_cvtps2pd)
-SIMD_STUB(translate_simd_cvtpd2ps)
-SIMD_STUB(translate_simd_cvtps2dq)
-SIMD_STUB(translate_simd_cvttps2dq)
-SIMD_STUB(translate_simd_cvtsd2ss)
-SIMD_STUB(translate_simd_cvtss2sd)
-SIMD_STUB(translate_simd_cvtdq2ps)
-SIMD_STUB(translate_simd_sqrtps)
-SIMD_STUB(translate_simd_sqrtpd)
-SIMD_STUB(translate_simd_sqrtss)
-SIMD_STUB(translate_simd_sqrtsd)
-SIMD_STUB(translate_simd_paddb)
-SIMD_STUB(translate_simd_paddw)
-SIMD_STUB(translate_simd_paddd)
-SIMD_STUB(translate_simd_paddq)
-SIMD_STUB(translate_simd_psubb)
-SIMD_STUB(translate_simd_psubw)
-SIMD_STUB(translate_simd_psubd)
-SIMD_STUB(translate_simd_psubq)
-SIMD_STUB(translate_simd_pshufd)
-SIMD_STUB(translate_simd_pshuflw)
-SIMD_STUB(translate_simd_pshufhw)
-SIMD_STUB(translate_simd_punpckldq)
-SIMD_STUB(translate_simd_punpckhdq)
-SIMD_STUB(translate_simd_andn)
-SIMD_STUB(translate_simd_pmovmskb)
-SIMD_STUB(translate_simd_movdqu)
-SIMD_STUB(translate_simd_movlps)
-SIMD_STUB(translate_simd_movhps)
-
 /* Emit function stubs removed - use rosetta_arm64_emit.c implementations */
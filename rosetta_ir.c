@@ -0,0 +1,549 @@
+/* ============================================================================
+ * Rosetta Translator - Intermediate Representation Core
+ * ============================================================================
+ *
+ * Block builder, analysis helpers, verifier and printer shared by the
+ * front-ends and back-ends.
+ * ============================================================================ */
+
+#include "rosetta_ir.h"
+#include <string.h>
+
+/* ============================================================================
+ * Builder
+ * ============================================================================ */
+
+void ir_block_init(ir_block_t *blk, uint64_t guest_pc)
+{
+    blk->count = 0;
+    blk->guest_insns = 0;
+    blk->guest_pc = guest_pc;
+    blk->next_pc = guest_pc;
+    blk->terminated = 0;
+    blk->flags_ref = IR_NONE;
+    blk->syscall_helper = 0;
+    blk->host_code_base = 0;
+    blk->exec_counters = NULL;
+}
+
+ir_ref_t ir_emit(ir_block_t *blk, ir_op_t op, uint8_t size, ir_ref_t a, ir_ref_t b,
+                 int64_t imm)
+{
+    ir_insn_t *insn;
+
+    if (blk->count >= IR_MAX_INSNS) {
+        return IR_NONE;
+    }
+
+    insn = &blk->insns[blk->count];
+    memset(insn, 0, sizeof(*insn));
+    insn->op = (uint8_t)op;
+    insn->size = size;
+    insn->a = a;
+    insn->b = b;
+    insn->index = IR_NONE;
+    insn->imm = imm;
+    return blk->count++;
+}
+
+ir_ref_t ir_const(ir_block_t *blk, int64_t value)
+{
+    return ir_emit(blk, IR_CONST, 8, IR_NONE, IR_NONE, value);
+}
+
+ir_ref_t ir_get_reg(ir_block_t *blk, uint16_t reg)
+{
+    ir_ref_t r = ir_emit(blk, IR_GET_REG, 8, IR_NONE, IR_NONE, 0);
+
+    if (r != IR_NONE) {
+        blk->insns[r].reg = reg;
+    }
+    return r;
+}
+
+ir_ref_t ir_set_reg(ir_block_t *blk, uint16_t reg, ir_ref_t value)
+{
+    ir_ref_t r = ir_emit(blk, IR_SET_REG, 8, value, IR_NONE, 0);
+
+    if (r != IR_NONE) {
+        blk->insns[r].reg = reg;
+    }
+    return r;
+}
+
+ir_ref_t ir_get_vreg(ir_block_t *blk, uint16_t reg)
+{
+    ir_ref_t r = ir_get_reg(blk, reg);
+
+    if (r != IR_NONE) {
+        blk->insns[r].size = 16;
+    }
+    return r;
+}
+
+ir_ref_t ir_set_vreg(ir_block_t *blk, uint16_t reg, ir_ref_t value)
+{
+    ir_ref_t r = ir_set_reg(blk, reg, value);
+
+    if (r != IR_NONE) {
+        blk->insns[r].size = 16;
+    }
+    return r;
+}
+
+ir_ref_t ir_sha(ir_block_t *blk, ir_sha_op_t op, ir_ref_t a, ir_ref_t b, ir_ref_t c)
+{
+    ir_ref_t r = ir_emit(blk, IR_SHA, 16, a, b, op);
+
+    if (r != IR_NONE) {
+        blk->insns[r].index = c;
+    }
+    return r;
+}
+
+ir_ref_t ir_load(ir_block_t *blk, uint8_t size, ir_ref_t addr, int64_t disp)
+{
+    return ir_emit(blk, IR_LOAD, size, addr, IR_NONE, disp);
+}
+
+ir_ref_t ir_store(ir_block_t *blk, uint8_t size, ir_ref_t addr, int64_t disp, ir_ref_t value)
+{
+    return ir_emit(blk, IR_STORE, size, addr, value, disp);
+}
+
+ir_ref_t ir_br(ir_block_t *blk, uint64_t target)
+{
+    return ir_emit(blk, IR_BR, 8, IR_NONE, IR_NONE, (int64_t)target);
+}
+
+ir_ref_t ir_brcond(ir_block_t *blk, ir_cond_t cond, ir_ref_t flags, uint64_t taken,
+                   uint64_t fallthrough)
+{
+    ir_ref_t r = ir_emit(blk, IR_BRCOND, 8, flags, IR_NONE, (int64_t)taken);
+
+    if (r != IR_NONE) {
+        blk->insns[r].cond = (uint8_t)cond;
+        blk->insns[r].imm2 = fallthrough;
+    }
+    return r;
+}
+
+ir_ref_t ir_br_ind(ir_block_t *blk, ir_ref_t target)
+{
+    return ir_emit(blk, IR_BR_IND, 8, target, IR_NONE, 0);
+}
+
+ir_ref_t ir_call(ir_block_t *blk, uint64_t fn)
+{
+    /* Helpers clobber host flags */
+    blk->flags_ref = IR_NONE;
+    return ir_emit(blk, IR_CALL, 8, IR_NONE, IR_NONE, (int64_t)fn);
+}
+
+void ir_set_flags(ir_block_t *blk, ir_ref_t ref)
+{
+    if (ref == IR_NONE) {
+        return;
+    }
+    if (blk->insns[ref].op != IR_CMP && blk->insns[ref].op != IR_TEST) {
+        blk->insns[ref].flags |= IR_F_FLAGS;
+    }
+    blk->flags_ref = ref;
+}
+
+/* ============================================================================
+ * Analysis
+ * ============================================================================ */
+
+int ir_op_has_value(ir_op_t op)
+{
+    switch (op) {
+    case IR_CONST: case IR_GET_REG:
+    case IR_ADD: case IR_SUB: case IR_AND: case IR_OR: case IR_XOR:
+    case IR_SHL: case IR_SHR: case IR_SAR: case IR_MUL:
+    case IR_NOT: case IR_NEG: case IR_ZEXT: case IR_SEXT: case IR_BSWAP:
+    case IR_CRC32: case IR_CRC32_FOLD: case IR_AES: case IR_SHA: case IR_PMULL:
+    case IR_LOAD: case IR_SETCC:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+int ir_op_is_exit(ir_op_t op)
+{
+    return op == IR_BR || op == IR_BRCOND || op == IR_BR_IND;
+}
+
+int ir_produces_flags(const ir_block_t *blk, ir_ref_t ref)
+{
+    const ir_insn_t *insn;
+
+    if (ref >= blk->count) {
+        return 0;
+    }
+    insn = &blk->insns[ref];
+    return insn->op == IR_CMP || insn->op == IR_TEST || (insn->flags & IR_F_FLAGS);
+}
+
+ir_flags_kind_t ir_flags_kind(const ir_block_t *blk, ir_ref_t producer)
+{
+    switch (blk->insns[producer].op) {
+    case IR_SUB: case IR_CMP: case IR_NEG:
+        return IR_FLAGS_SUB;
+    case IR_ADD:
+        return IR_FLAGS_ADD;
+    case IR_AND: case IR_OR: case IR_XOR: case IR_TEST:
+        return IR_FLAGS_LOGIC;
+    default:
+        return IR_FLAGS_OTHER;
+    }
+}
+
+int ir_cond_supported(ir_flags_kind_t kind, ir_cond_t cond)
+{
+    if (cond >= IR_COND_COUNT || cond == 10 || cond == 11) {
+        return 0;   /* Parity is not modelled */
+    }
+    if (kind == IR_FLAGS_OTHER) {
+        return 0;
+    }
+    if (kind == IR_FLAGS_ADD && (cond == IR_COND_BE || cond == IR_COND_A)) {
+        return 0;   /* Carry and zero have no single host condition after ADD */
+    }
+    return 1;
+}
+
+static void ir_note_use(ir_ref_t *last_use, ir_ref_t ref, ir_ref_t at)
+{
+    if (ref != IR_NONE) {
+        last_use[ref] = at;
+    }
+}
+
+void ir_compute_last_use(const ir_block_t *blk, ir_ref_t *last_use)
+{
+    ir_ref_t i;
+
+    for (i = 0; i < blk->count; i++) {
+        last_use[i] = IR_NONE;
+    }
+
+    for (i = 0; i < blk->count; i++) {
+        const ir_insn_t *insn = &blk->insns[i];
+
+        ir_note_use(last_use, insn->a, i);
+        ir_note_use(last_use, insn->b, i);
+        ir_note_use(last_use, insn->index, i);
+
+        if ((insn->op == IR_BRCOND || insn->op == IR_SETCC) && insn->a != IR_NONE) {
+            const ir_insn_t *prod = &blk->insns[insn->a];
+            ir_note_use(last_use, prod->a, i);
+            ir_note_use(last_use, prod->b, i);
+            ir_note_use(last_use, prod->index, i);
+        }
+    }
+}
+
+static int ir_valid_size(uint8_t size)
+{
+    return size == 1 || size == 2 || size == 4 || size == 8 || size == 16;
+}
+
+/* Inputs each IR_SHA step takes: a, then b, then index */
+static const uint8_t ir_sha_inputs[IR_SHA_COUNT] = {
+    3, 3, 3, 1, 3, 2, 3, 3, 2, 3, 2, 2, 3, 3, 2, 2
+};
+
+/* Vector values only flow between the ops that handle them */
+static int ir_valid_vector(const ir_block_t *blk, const ir_insn_t *insn)
+{
+    int vec = (insn->size == 16);
+    int index_vec = 0;
+
+    switch (insn->op) {
+    case IR_NOP: case IR_BRCOND: case IR_SETCC:
+        return 1;
+    case IR_LOAD: case IR_STORE:
+        /* Scalar address, value of the access size */
+        return blk->insns[insn->a].size != 16 &&
+               (insn->index == IR_NONE || blk->insns[insn->index].size != 16) &&
+               (insn->op == IR_LOAD || (blk->insns[insn->b].size == 16) == vec);
+    case IR_GET_REG: case IR_SET_REG: case IR_AND: case IR_OR: case IR_XOR:
+        break;
+    case IR_ADD: case IR_SUB:
+        if (vec && insn->imm != 1 && insn->imm != 2 && insn->imm != 4 && insn->imm != 8) {
+            return 0;
+        }
+        break;
+    case IR_BSWAP:
+        if (!vec || (insn->imm != 2 && insn->imm != 4 && insn->imm != 8)) {
+            return 0;
+        }
+        break;
+    case IR_SHA:
+        index_vec = 1;
+        /* fall through */
+    case IR_AES: case IR_PMULL:
+        if (!vec) {
+            return 0;
+        }
+        break;
+    default:
+        if (vec) {
+            return 0;
+        }
+        break;
+    }
+    if (vec && (insn->flags & IR_F_FLAGS)) {
+        return 0;
+    }
+    return (insn->a == IR_NONE || (blk->insns[insn->a].size == 16) == vec) &&
+           (insn->b == IR_NONE || (blk->insns[insn->b].size == 16) == vec) &&
+           (insn->index == IR_NONE || (blk->insns[insn->index].size == 16) == index_vec);
+}
+
+static int ir_valid_value(const ir_block_t *blk, ir_ref_t ref, ir_ref_t at)
+{
+    return ref < at && ir_op_has_value((ir_op_t)blk->insns[ref].op);
+}
+
+int ir_verify(const ir_block_t *blk)
+{
+    ir_ref_t last_call = IR_NONE;
+    ir_ref_t i;
+
+    if (blk->count > IR_MAX_INSNS) {
+        return -1;
+    }
+
+    for (i = 0; i < blk->count; i++) {
+        const ir_insn_t *insn = &blk->insns[i];
+        int bad = 0;
+
+        if (insn->op >= IR_OP_COUNT || !ir_valid_size(insn->size)) {
+            return -(int)(i + 1);
+        }
+
+        switch (insn->op) {
+        case IR_NOP: case IR_CONST: case IR_GET_REG: case IR_BR: case IR_CALL:
+            break;
+
+        case IR_SET_REG: case IR_NOT: case IR_NEG: case IR_ZEXT: case IR_SEXT:
+        case IR_BSWAP: case IR_LOAD: case IR_BR_IND:
+            bad = !ir_valid_value(blk, insn->a, i);
+            break;
+
+        case IR_SHL: case IR_SHR: case IR_SAR:
+            bad = !ir_valid_value(blk, insn->a, i) || insn->b >= i ||
+                  blk->insns[insn->b].op != IR_CONST;
+            break;
+
+        case IR_BRCOND: case IR_SETCC:
+            bad = insn->a >= i || !ir_produces_flags(blk, insn->a) ||
+                  !ir_cond_supported(ir_flags_kind(blk, insn->a), (ir_cond_t)insn->cond) ||
+                  (last_call != IR_NONE && insn->a < last_call);
+            break;
+
+        case IR_CRC32: case IR_CRC32_FOLD:
+            bad = !ir_valid_value(blk, insn->a, i) || !ir_valid_value(blk, insn->b, i) ||
+                  (insn->imm != IR_CRC_IEEE && insn->imm != IR_CRC_CASTAGNOLI) ||
+                  (insn->op == IR_CRC32_FOLD && insn->size != 8);
+            /* A remainder only feeds a 64-bit step of the same polynomial */
+            if (!bad && blk->insns[insn->a].op == IR_CRC32_FOLD) {
+                bad = insn->size != 8 || blk->insns[insn->a].imm != insn->imm;
+            }
+            break;
+
+        case IR_AES:
+            bad = !ir_valid_value(blk, insn->a, i) || insn->imm < 0 ||
+                  insn->imm >= IR_AES_COUNT ||
+                  (insn->b != IR_NONE && !ir_valid_value(blk, insn->b, i)) ||
+                  ((insn->imm == IR_AES_MC || insn->imm == IR_AES_IMC) && insn->b != IR_NONE);
+            break;
+
+        case IR_PMULL:
+            bad = !ir_valid_value(blk, insn->a, i) || !ir_valid_value(blk, insn->b, i) ||
+                  insn->imm < 0 || insn->imm >= IR_PMULL_COUNT;
+            break;
+
+        case IR_SHA:
+            bad = insn->imm < 0 || insn->imm >= IR_SHA_COUNT ||
+                  !ir_valid_value(blk, insn->a, i);
+            if (!bad) {
+                int n = ir_sha_inputs[insn->imm];
+                bad = (n >= 2) != (insn->b != IR_NONE) || (n >= 3) != (insn->index != IR_NONE) ||
+                      (n >= 2 && !ir_valid_value(blk, insn->b, i)) ||
+                      (n >= 3 && !ir_valid_value(blk, insn->index, i));
+            }
+            break;
+
+        default:
+            /* Two-operand ops and STORE/CMP/TEST */
+            bad = !ir_valid_value(blk, insn->a, i) || !ir_valid_value(blk, insn->b, i);
+            break;
+        }
+
+        if (!bad) {
+            bad = !ir_valid_vector(blk, insn);
+        }
+
+        /* Only memory accesses take an index, besides IR_SHA's third input */
+        if (!bad && insn->index != IR_NONE && insn->op != IR_SHA) {
+            bad = (insn->op != IR_LOAD && insn->op != IR_STORE) ||
+                  !ir_valid_value(blk, insn->index, i) || insn->shift > 3;
+        }
+
+        /* Values do not survive helper calls */
+        if (!bad && last_call != IR_NONE && insn->op != IR_BRCOND && insn->op != IR_SETCC) {
+            bad = (insn->a != IR_NONE && insn->a < last_call) ||
+                  (insn->b != IR_NONE && insn->b < last_call) ||
+                  (insn->index != IR_NONE && insn->index < last_call);
+        }
+        if (!bad && ir_op_is_exit((ir_op_t)insn->op) && i != blk->count - 1) {
+            bad = 1;
+        }
+        if (bad) {
+            return -(int)(i + 1);
+        }
+
+        if (insn->op == IR_CALL) {
+            last_call = i;
+        }
+    }
+
+    return 0;
+}
+
+/* ============================================================================
+ * Printer
+ * ============================================================================ */
+
+static const char *const ir_op_names[IR_OP_COUNT] = {
+    "nop", "const", "get_reg", "set_reg",
+    "add", "sub", "and", "or", "xor", "shl", "shr", "sar", "mul",
+    "not", "neg", "zext", "sext", "bswap", "crc32", "crc32_fold", "aes", "sha", "pmull",
+    "load", "store", "cmp", "test", "setcc",
+    "br", "brcond", "br_ind", "call"
+};
+
+static const char *const ir_aes_names[IR_AES_COUNT] = {
+    "aese", "aesd", "aesmc", "aesimc", "aesenc", "aesenclast", "aesdec", "aesdeclast"
+};
+
+static const char *const ir_sha_names[IR_SHA_COUNT] = {
+    "sha1c", "sha1p", "sha1m", "sha1h", "sha1su0", "sha1su1",
+    "sha256h", "sha256h2", "sha256su0", "sha256su1",
+    "sha256_abef", "sha256_cdgh", "sha256rnds2", "sha256rnds2_hi", "sha256_abcd", "sha256_efgh"
+};
+
+static const char *const ir_pmull_names[IR_PMULL_COUNT] = {
+    "pmull.1q", "pmull2.1q", "pmull.8h", "pmull2.8h"
+};
+
+static const char *const ir_cond_names[IR_COND_COUNT] = {
+    "o", "no", "b", "ae", "eq", "ne", "be", "a", "s", "ns", "?", "?", "l", "ge", "le", "g"
+};
+
+const char *ir_op_name(ir_op_t op)
+{
+    return op < IR_OP_COUNT ? ir_op_names[op] : "?";
+}
+
+void ir_print(const ir_block_t *blk, FILE *out)
+{
+    ir_ref_t i;
+
+    fprintf(out, "block %#llx (%u guest insns)\n",
+            (unsigned long long)blk->guest_pc, blk->guest_insns);
+
+    for (i = 0; i < blk->count; i++) {
+        const ir_insn_t *insn = &blk->insns[i];
+
+        if (ir_op_has_value((ir_op_t)insn->op)) {
+            fprintf(out, "  v%-3u = ", i);
+        } else {
+            fprintf(out, "  %-7s", ir_produces_flags(blk, i) ? "flags =" : "");
+        }
+        fprintf(out, "%s.%u", ir_op_name((ir_op_t)insn->op), insn->size * 8);
+        if (insn->flags & IR_F_FLAGS) {
+            fprintf(out, "!");
+        }
+
+        switch (insn->op) {
+        case IR_CONST:
+            fprintf(out, " %#llx", (unsigned long long)insn->imm);
+            break;
+        case IR_GET_REG:
+            fprintf(out, " r%u", insn->reg);
+            break;
+        case IR_SET_REG:
+            fprintf(out, " r%u, v%u", insn->reg, insn->a);
+            break;
+        case IR_LOAD:
+        case IR_STORE:
+            fprintf(out, " [v%u", insn->a);
+            if (insn->index != IR_NONE) {
+                fprintf(out, " + v%u<<%u", insn->index, insn->shift);
+            }
+            fprintf(out, "%+lld]", (long long)insn->imm);
+            if (insn->op == IR_STORE) {
+                fprintf(out, ", v%u", insn->b);
+            }
+            break;
+        case IR_SETCC:
+            fprintf(out, " %s v%u", ir_cond_names[insn->cond & 0xF], insn->a);
+            break;
+        case IR_BR:
+        case IR_CALL:
+            fprintf(out, " %#llx", (unsigned long long)insn->imm);
+            break;
+        case IR_BRCOND:
+            fprintf(out, " %s v%u, %#llx, %#llx", ir_cond_names[insn->cond & 0xF], insn->a,
+                    (unsigned long long)insn->imm, (unsigned long long)insn->imm2);
+            break;
+        case IR_ZEXT:
+        case IR_SEXT:
+        case IR_BSWAP:
+            fprintf(out, " v%u, %lld", insn->a, (long long)insn->imm);
+            break;
+        case IR_CRC32:
+        case IR_CRC32_FOLD:
+            fprintf(out, " v%u, v%u, %s", insn->a, insn->b,
+                    insn->imm == IR_CRC_CASTAGNOLI ? "castagnoli" : "ieee");
+            break;
+        case IR_AES:
+            fprintf(out, " %s v%u", ir_aes_names[insn->imm % IR_AES_COUNT], insn->a);
+            if (insn->imm != IR_AES_MC && insn->imm != IR_AES_IMC) {
+                if (insn->b != IR_NONE) {
+                    fprintf(out, ", v%u", insn->b);
+                } else {
+                    fprintf(out, ", 0");
+                }
+            }
+            break;
+        case IR_PMULL:
+            fprintf(out, " %s v%u, v%u", ir_pmull_names[insn->imm % IR_PMULL_COUNT],
+                    insn->a, insn->b);
+            break;
+        case IR_SHA:
+            fprintf(out, " %s v%u", ir_sha_names[insn->imm % IR_SHA_COUNT], insn->a);
+            if (insn->b != IR_NONE) {
+                fprintf(out, ", v%u", insn->b);
+            }
+            if (insn->index != IR_NONE) {
+                fprintf(out, ", v%u", insn->index);
+            }
+            break;
+        default:
+            if (insn->a != IR_NONE) {
+                fprintf(out, " v%u", insn->a);
+            }
+            if (insn->b != IR_NONE) {
+                fprintf(out, ", v%u", insn->b);
+            }
+            break;
+        }
+        fprintf(out, "\n");
+    }
+}
@@ -0,0 +1,398 @@
+/* ============================================================================
+ * Rosetta Translator - Architecture-Neutral Intermediate Representation
+ * ============================================================================
+ *
+ * A compact, block-local SSA-style IR that sits between the guest decoders
+ * and the host emitters. Front-ends lower one guest instruction at a time
+ * into an ir_block_t; back-ends lower the finished block to host code.
+ *
+ *   x86_64 bytes   --ir_x86_lower_block()-->   ir_block_t   --ir_emit_arm64()-->  ARM64
+ *   ARM64 words    --ir_arm64_lower_block()--> ir_block_t   --ir_emit_x86()---->  x86_64
+ *
+ * Every instruction defines at most one value, named by its index in the
+ * block (ir_ref_t). Guest registers are only touched through GET_REG and
+ * SET_REG, guest memory through LOAD and STORE, so passes written once
+ * against the IR apply to both translation directions. ir_optimize()
+ * (rosetta_ir_opt.h) runs them between lowering and emission.
+ *
+ * Flags are modelled as a value too: an ALU op carrying IR_F_FLAGS (or a
+ * CMP/TEST) is the flags producer, and BRCOND/SETCC name it in operand a.
+ * Condition codes use x86 semantics (carry = unsigned borrow after a
+ * subtract); each back-end maps them onto its own flag layout.
+ *
+ * Values of size 16 are 128-bit vectors. GET_REG/SET_REG of a vector
+ * register, LOAD/STORE, AND/OR/XOR, lane-wise ADD/SUB, BSWAP, AES, SHA and
+ * PMULL produce or take them.
+ * ============================================================================ */
+
+#ifndef ROSETTA_IR_H
+#define ROSETTA_IR_H
+
+#include "rosetta_types.h"
+#include "rosetta_emit_x86.h"
+#include <stdint.h>
+#include <stdio.h>
+
+/* ============================================================================
+ * IR Definitions
+ * ============================================================================ */
+
+#define IR_MAX_INSNS        512     /* Instructions per block */
+#define IR_NONE             0xFFFF  /* No value */
+
+typedef uint16_t ir_ref_t;
+
+typedef enum {
+    IR_NOP = 0,
+    IR_CONST,           /* imm */
+    IR_GET_REG,         /* reg */
+    IR_SET_REG,         /* reg = a */
+
+    /* Binary ALU: a op b, size 4 results are zero-extended; vector ADD and
+     * SUB work on lanes of imm bytes */
+    IR_ADD,
+    IR_SUB,
+    IR_AND,
+    IR_OR,
+    IR_XOR,
+    IR_SHL,             /* b must be a CONST */
+    IR_SHR,
+    IR_SAR,
+    IR_MUL,
+
+    /* Unary */
+    IR_NOT,
+    IR_NEG,
+    IR_ZEXT,            /* Zero-extend the low imm bytes of a */
+    IR_SEXT,            /* Sign-extend the low imm bytes of a */
+    IR_BSWAP,           /* Reverse the bytes of each imm-byte lane of vector a */
+
+    /* Bit-reflected CRC with no inversion (ARM64 CRC32*), imm is the
+     * ir_crc_poly_t; x86_64 back-end only */
+    IR_CRC32,           /* CRC of the low size bytes of b into the 32-bit CRC a */
+    IR_CRC32_FOLD,      /* IR_CRC32.64 left as an unreduced 64-bit remainder */
+
+    /* 128-bit AES step on state a with round key b (IR_NONE for zero),
+     * imm is the ir_aes_op_t; x86_64 back-end only */
+    IR_AES,
+
+    /* 128-bit SHA step on a, b and index (IR_NONE past the inputs the step
+     * takes), imm is the ir_sha_op_t; x86_64 back-end only */
+    IR_SHA,
+
+    /* 128-bit carry-less multiply of a by b, imm is the ir_pmull_op_t;
+     * x86_64 back-end only */
+    IR_PMULL,
+
+    /* Guest memory: address a + (index << shift) + imm, size bytes,
+     * loads zero-extend; index is IR_NONE unless folded by the optimizer */
+    IR_LOAD,
+    IR_STORE,           /* [address] = b */
+
+    /* Flags producers without a result */
+    IR_CMP,             /* a - b */
+    IR_TEST,            /* a & b */
+
+    IR_SETCC,           /* (cond on flags a) ? 1 : 0 */
+
+    /* Block exits */
+    IR_BR,              /* Continue at guest pc imm */
+    IR_BRCOND,          /* cond on flags a ? imm : imm2 */
+    IR_BR_IND,          /* Continue at guest pc in a */
+
+    /* Host helper fn(ThreadState *) with guest registers synced to state */
+    IR_CALL,            /* fn = imm */
+
+    IR_OP_COUNT
+} ir_op_t;
+
+/* Condition codes, x86 flag semantics */
+typedef enum {
+    IR_COND_O = 0,      /* Overflow */
+    IR_COND_NO,
+    IR_COND_B,          /* Unsigned below (carry / borrow) */
+    IR_COND_AE,
+    IR_COND_EQ,
+    IR_COND_NE,
+    IR_COND_BE,         /* Unsigned below or equal */
+    IR_COND_A,
+    IR_COND_S,          /* Negative */
+    IR_COND_NS,
+    IR_COND_L = 12,     /* Signed less */
+    IR_COND_GE,
+    IR_COND_LE,
+    IR_COND_G,
+    IR_COND_COUNT
+} ir_cond_t;
+
+/* IR_CRC32 polynomials, numbered as rosetta_crc32_poly_t */
+typedef enum {
+    IR_CRC_IEEE = 0,        /* 0xEDB88320 */
+    IR_CRC_CASTAGNOLI = 1,  /* 0x82F63B78 */
+} ir_crc_poly_t;
+
+/* IR_AES steps, numbered as rosetta_aes_op_t */
+typedef enum {
+    IR_AES_E = 0,       /* ARM64 AESE:  ShiftRows(SubBytes(a ^ b)) */
+    IR_AES_D,           /* ARM64 AESD:  InvShiftRows(InvSubBytes(a ^ b)) */
+    IR_AES_MC,          /* ARM64 AESMC: MixColumns(a), no key */
+    IR_AES_IMC,         /* ARM64 AESIMC */
+    IR_AES_ENC,         /* x86 AESENC:  MixColumns(ShiftRows(SubBytes(a))) ^ b */
+    IR_AES_ENCLAST,     /* x86 AESENCLAST: ShiftRows(SubBytes(a)) ^ b */
+    IR_AES_DEC,         /* x86 AESDEC */
+    IR_AES_DECLAST,     /* x86 AESDECLAST */
+    IR_AES_COUNT
+} ir_aes_op_t;
+
+/* IR_SHA steps, numbered as rosetta_sha_op_t; see rosetta_sha.h */
+typedef enum {
+    IR_SHA1C = 0,       /* ARM64 SHA1C: a = abcd, b = e, index = wk */
+    IR_SHA1P,
+    IR_SHA1M,
+    IR_SHA1H,           /* ARM64 SHA1H: a */
+    IR_SHA1SU0,         /* ARM64 SHA1SU0: a, b, index */
+    IR_SHA1SU1,         /* ARM64 SHA1SU1: a, b */
+    IR_SHA256H,         /* ARM64 SHA256H: a = abcd, b = efgh, index = wk */
+    IR_SHA256H2,        /* ARM64 SHA256H2: a = efgh, b = abcd, index = wk */
+    IR_SHA256SU0,       /* ARM64 SHA256SU0: a, b */
+    IR_SHA256SU1,       /* ARM64 SHA256SU1: a, b, index */
+    IR_SHA256_ABEF,     /* x86 state halves from a = abcd, b = efgh */
+    IR_SHA256_CDGH,
+    IR_SHA256_RNDS2,    /* x86 SHA256RNDS2: a = CDGH, b = ABEF, index = wk lanes 0-1 */
+    IR_SHA256_RNDS2_HI, /* The same with wk lanes 2-3 */
+    IR_SHA256_ABCD,     /* ARM64 state halves from a = ABEF, b = CDGH */
+    IR_SHA256_EFGH,
+    IR_SHA_COUNT
+} ir_sha_op_t;
+
+/* IR_PMULL steps, numbered as rosetta_pmull_op_t */
+typedef enum {
+    IR_PMULL_64 = 0,    /* Low 64-bit halves to 128 bits: PCLMULQDQ 0x00 */
+    IR_PMULL2_64,       /* High halves: PCLMULQDQ 0x11 */
+    IR_PMULL_8,         /* Bytes 0-7 to eight 16-bit products */
+    IR_PMULL2_8,        /* Bytes 8-15 */
+    IR_PMULL_COUNT
+} ir_pmull_op_t;
+
+/*
+ * The ARM64 front-end lowers SHA256H and SHA256H2 into the packed x86
+ * form (ABEF/CDGH, two RNDS2, then ABCD or EFGH) rather than as single
+ * steps, so ir_opt_sha_fuse() can share the rounds of an H/H2 pair and
+ * drop the repacking between one group of rounds and the next.
+ */
+
+/*
+ * An IR_CRC32 or IR_CRC32_FOLD whose operand a is an IR_CRC32_FOLD
+ * continues from that remainder rather than from a 32-bit CRC, so
+ * ir_opt_crc_fuse() can turn a run of CRC32X into one folded chain by
+ * changing ops in place. The IR_CRC32 at the end of the chain reduces.
+ */
+
+/* Instruction flags */
+#define IR_F_FLAGS      0x01    /* ALU op also produces flags */
+
+/**
+ * One IR instruction; its value is named by its index in the block
+ */
+typedef struct {
+    uint8_t  op;            /* ir_op_t */
+    uint8_t  size;          /* Operand width in bytes: 1, 2, 4, 8 or 16 */
+    uint8_t  cond;          /* ir_cond_t for BRCOND/SETCC */
+    uint8_t  flags;         /* IR_F_* */
+    uint8_t  shift;         /* LOAD/STORE index scale, 0-3 */
+    ir_ref_t a;             /* First operand */
+    ir_ref_t b;             /* Second operand */
+    ir_ref_t index;         /* LOAD/STORE index operand, IR_SHA third input */
+    uint16_t reg;           /* Guest register for GET_REG/SET_REG */
+    int64_t  imm;           /* Constant, displacement, target or helper */
+    uint64_t imm2;          /* Fall-through target for BRCOND */
+} ir_insn_t;
+
+/**
+ * One translation block
+ */
+typedef struct {
+    ir_insn_t insns[IR_MAX_INSNS];
+    uint16_t count;
+    uint16_t guest_insns;       /* Guest instructions lowered */
+    uint64_t guest_pc;          /* First guest instruction */
+    uint64_t next_pc;           /* Guest pc after the last lowered instruction */
+    int terminated;             /* Block ends in a branch */
+
+    /* Front-end state */
+    ir_ref_t flags_ref;         /* Current flags producer, IR_NONE if unknown */
+    uint64_t syscall_helper;    /* fn(ThreadState *) for SYSCALL/SVC, 0 = unsupported;
+                                 * kept across *_lower_block() */
+
+    /* Back-end state */
+    uint64_t host_code_base;    /* Runtime address of the ARM64 emit buffer, 0 if the
+                                 * code moves after emission; set after lowering */
+    uint64_t *exec_counters;    /* IR_PROF_SLOTS counters the emitted code bumps,
+                                 * NULL for none; set after lowering */
+} ir_block_t;
+
+/* exec_counters slots; increments are plain load/add/store, not atomic */
+#define IR_PROF_ENTRY       0   /* Block entered, from the dispatcher or a chain */
+#define IR_PROF_TAKEN       1   /* Left through BR, BR_IND or a taken BRCOND */
+#define IR_PROF_FALLTHROUGH 2   /* Left through the BRCOND fall-through */
+#define IR_PROF_SLOTS       3
+
+/* Guest register numbering for each front-end */
+#define IR_X86_NUM_REGS     16      /* x86 encoding order: RAX, RCX, RDX, RBX, RSP, ... */
+#define IR_ARM64_SP         31      /* X0-X30, then SP */
+#define IR_ARM64_NUM_REGS   32
+#define IR_ARM64_V0         32      /* V0-V31 follow, accessed at size 16 */
+#define IR_ARM64_NUM_VREGS  32
+
+/* ============================================================================
+ * Builder
+ * ============================================================================ */
+
+/**
+ * Reset a block for lowering from guest_pc
+ */
+void ir_block_init(ir_block_t *blk, uint64_t guest_pc);
+
+/**
+ * Append an instruction
+ * @return Its value, or IR_NONE if the block is full
+ */
+ir_ref_t ir_emit(ir_block_t *blk, ir_op_t op, uint8_t size, ir_ref_t a, ir_ref_t b,
+                 int64_t imm);
+
+ir_ref_t ir_const(ir_block_t *blk, int64_t value);
+ir_ref_t ir_get_reg(ir_block_t *blk, uint16_t reg);
+ir_ref_t ir_set_reg(ir_block_t *blk, uint16_t reg, ir_ref_t value);
+ir_ref_t ir_get_vreg(ir_block_t *blk, uint16_t reg);
+ir_ref_t ir_set_vreg(ir_block_t *blk, uint16_t reg, ir_ref_t value);
+ir_ref_t ir_sha(ir_block_t *blk, ir_sha_op_t op, ir_ref_t a, ir_ref_t b, ir_ref_t c);
+ir_ref_t ir_load(ir_block_t *blk, uint8_t size, ir_ref_t addr, int64_t disp);
+ir_ref_t ir_store(ir_block_t *blk, uint8_t size, ir_ref_t addr, int64_t disp, ir_ref_t value);
+ir_ref_t ir_br(ir_block_t *blk, uint64_t target);
+ir_ref_t ir_brcond(ir_block_t *blk, ir_cond_t cond, ir_ref_t flags, uint64_t taken,
+                   uint64_t fallthrough);
+ir_ref_t ir_br_ind(ir_block_t *blk, ir_ref_t target);
+ir_ref_t ir_call(ir_block_t *blk, uint64_t fn);
+
+/**
+ * Make op set flags and record it as the current flags producer
+ */
+void ir_set_flags(ir_block_t *blk, ir_ref_t ref);
+
+/* ============================================================================
+ * Analysis
+ * ============================================================================ */
+
+/**
+ * True if op defines a value other instructions may use
+ */
+int ir_op_has_value(ir_op_t op);
+
+/**
+ * True if op ends the block
+ */
+int ir_op_is_exit(ir_op_t op);
+
+/**
+ * True if ref produces flags (CMP, TEST or an op with IR_F_FLAGS)
+ */
+int ir_produces_flags(const ir_block_t *blk, ir_ref_t ref);
+
+/**
+ * Flag producer kind, used by back-ends to map ir_cond_t
+ */
+typedef enum {
+    IR_FLAGS_SUB = 0,   /* SUB, CMP, NEG: carry is a borrow */
+    IR_FLAGS_ADD,       /* ADD: carry out */
+    IR_FLAGS_LOGIC,     /* AND, OR, XOR, TEST: carry and overflow clear */
+    IR_FLAGS_OTHER
+} ir_flags_kind_t;
+
+ir_flags_kind_t ir_flags_kind(const ir_block_t *blk, ir_ref_t producer);
+
+/**
+ * True if cond can be evaluated on the flags of this producer kind
+ * (BE/A need a subtract or logic producer)
+ */
+int ir_cond_supported(ir_flags_kind_t kind, ir_cond_t cond);
+
+/**
+ * Index of the last instruction that uses each value (IR_NONE if unused).
+ * A flags consumer also counts as a use of its producer's operands, so
+ * back-ends can re-create clobbered flags.
+ */
+void ir_compute_last_use(const ir_block_t *blk, ir_ref_t *last_use);
+
+/**
+ * Check operand references, sizes and flags wiring
+ * @return 0 if valid, or -(index + 1) of the first bad instruction
+ */
+int ir_verify(const ir_block_t *blk);
+
+/**
+ * Print a block, one instruction per line
+ */
+void ir_print(const ir_block_t *blk, FILE *out);
+
+const char *ir_op_name(ir_op_t op);
+
+/* ============================================================================
+ * Front-ends
+ * ============================================================================ */
+
+/**
+ * Lower one x86_64 instruction
+ * @return Instruction length, or -1 if unsupported (block left unchanged)
+ */
+int ir_x86_lower_insn(ir_block_t *blk, const uint8_t *code, uint64_t pc);
+
+/**
+ * Lower x86_64 instructions until a branch, an unsupported instruction or
+ * max_insns; an open block gets a BR to the next guest pc
+ * @return Number of guest instructions lowered
+ */
+int ir_x86_lower_block(ir_block_t *blk, const uint8_t *code, uint64_t pc, int max_insns);
+
+/**
+ * Lower one ARM64 instruction
+ * @return 0, or -1 if unsupported (block left unchanged)
+ */
+int ir_arm64_lower_insn(ir_block_t *blk, uint32_t encoding, uint64_t pc);
+
+/**
+ * Lower ARM64 instructions, same termination rules as ir_x86_lower_block()
+ */
+int ir_arm64_lower_block(ir_block_t *blk, const uint32_t *code, uint64_t pc,
+                         int max_insns);
+
+/* ============================================================================
+ * Back-ends
+ * ============================================================================ */
+
+/**
+ * Emit ARM64 code for an x86_64-guest block
+ *
+ * Guest register N lives in XN, X18 holds the rosetta_exec_context_t and
+ * X16/X17 are scratch. Temporaries use X19-X26, saved on entry and
+ * restored at each exit. Exits store the next pc to ThreadState.guest.rip
+ * and return to the dispatcher.
+ *
+ * @return 0 on success, -1 if the block cannot be emitted
+ */
+int ir_emit_arm64(const ir_block_t *blk, code_buffer_t *buf);
+
+/**
+ * Emit x86_64 code for an ARM64-guest block
+ *
+ * The block is called as fn(ThreadState *) and keeps the pointer in RBX.
+ * Guest registers live in ThreadState.host and are cached in callee-saved
+ * registers chosen by ra_linear_scan(), vector registers in XMM12-XMM15.
+ * Exits write them back, store the next pc to ThreadState.host.pc and
+ * return. CRC32, AES, SHA and PMULL steps need the lowerings from
+ * ir_x86_register_crypto() (rosetta_ir_to_x86.h).
+ *
+ * @return 0 on success, -1 if the block cannot be emitted
+ */
+int ir_emit_x86(const ir_block_t *blk, code_buf_t *buf);
+
+#endif /* ROSETTA_IR_H */
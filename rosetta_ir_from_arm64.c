@@ -0,0 +1,474 @@
+/* ============================================================================
+ * Rosetta Translator - ARM64 to IR Front-end
+ * ============================================================================
+ *
+ * Lowers the ARM64 integer core (ADD/SUB immediate and shifted register,
+ * logical shifted register, move wide, MUL, CRC32/CRC32C, unsigned-offset
+ * loads/stores, branches and SVC) into the IR, plus the 128-bit SIMD that
+ * crypto loops need: LDR/STR Qt, AND/ORR/EOR, ADD/SUB and REV16/32/64 on
+ * full vectors, AESE/AESD/AESMC/AESIMC, the SHA-1/SHA-256 instructions
+ * and PMULL/PMULL2. Field extraction uses the helpers from
+ * rosetta_arm64_decode.h.
+ *
+ * Guest registers are numbered X0-X30 with SP as 31, then V0-V31 from
+ * IR_ARM64_V0; XZR reads become a constant zero and XZR writes are
+ * dropped. NZCV maps onto the x86-style IR conditions through the kind of
+ * the flags producer.
+ * ============================================================================ */
+
+#include "rosetta_ir.h"
+#include "rosetta_arm64_decode.h"
+
+/* IR instructions one ARM64 instruction may need at most */
+#define IR_ARM64_MAX_EXPANSION  16
+
+/* ============================================================================
+ * Operand Helpers
+ * ============================================================================ */
+
+/* Read Xn; register 31 is SP or XZR depending on the encoding */
+static ir_ref_t a64_reg(ir_block_t *blk, uint8_t r, int is_sp)
+{
+    if (r == 31 && !is_sp) {
+        return ir_const(blk, 0);
+    }
+    return ir_get_reg(blk, r);
+}
+
+/* Write Xd; XZR writes are discarded */
+static void a64_set(ir_block_t *blk, uint8_t r, int is_sp, ir_ref_t value)
+{
+    if (r == 31 && !is_sp) {
+        return;
+    }
+    ir_set_reg(blk, r, value);
+}
+
+/* Rm shifted by imm6 (LSL, LSR, ASR); ROR is not supported */
+static ir_ref_t a64_shifted(ir_block_t *blk, uint32_t enc, uint8_t size)
+{
+    static const ir_op_t shifts[3] = { IR_SHL, IR_SHR, IR_SAR };
+    uint8_t shift = (enc >> 22) & 3;
+    uint8_t amount = (enc >> 10) & 0x3F;
+    ir_ref_t v = a64_reg(blk, arm64_get_rm(enc), 0);
+
+    if (shift == 3 || (size == 4 && amount > 31)) {
+        return IR_NONE;
+    }
+    if (amount == 0) {
+        return v;
+    }
+    return ir_emit(blk, shifts[shift], size, v, ir_const(blk, amount), 0);
+}
+
+/* Map an ARM64 condition onto the IR for the current flags producer */
+static int a64_cond(const ir_block_t *blk, uint8_t cond, ir_cond_t *out)
+{
+    static const int8_t simple[16] = {
+        IR_COND_EQ, IR_COND_NE, -1, -1, IR_COND_S, IR_COND_NS, IR_COND_O, IR_COND_NO,
+        -1, -1, IR_COND_GE, IR_COND_L, IR_COND_G, IR_COND_LE, -1, -1
+    };
+    ir_flags_kind_t kind;
+
+    if (blk->flags_ref == IR_NONE) {
+        return -1;
+    }
+    kind = ir_flags_kind(blk, blk->flags_ref);
+
+    if (simple[cond] >= 0) {
+        *out = (ir_cond_t)simple[cond];
+    } else if (kind == IR_FLAGS_SUB) {
+        /* ARM64 carry after a subtract is NOT borrow */
+        static const ir_cond_t sub_map[4] = { IR_COND_AE, IR_COND_B, IR_COND_A, IR_COND_BE };
+        *out = sub_map[(cond - COND_CS) & 3];
+        if (cond > COND_LS) {
+            return -1;
+        }
+    } else if (cond == COND_CS) {
+        *out = IR_COND_B;           /* Carry out (always clear after logic ops) */
+    } else if (cond == COND_CC) {
+        *out = IR_COND_AE;
+    } else {
+        return -1;                  /* HI/LS without a subtract */
+    }
+
+    return ir_cond_supported(kind, *out) ? 0 : -1;
+}
+
+/* ============================================================================
+ * Instruction Lowering
+ * ============================================================================ */
+
+static int a64_lower(ir_block_t *blk, uint32_t enc, uint64_t pc)
+{
+    uint8_t sf = (uint8_t)(enc >> 31);
+    uint8_t size = sf ? 8 : 4;
+    uint8_t rd = arm64_get_rd(enc);
+    uint8_t rn = arm64_get_rn(enc);
+    ir_ref_t a, b, v;
+
+    /* ADD/ADDS/SUB/SUBS (immediate) */
+    if ((enc & 0x1F000000) == 0x11000000) {
+        int is_sub = (enc >> 30) & 1;
+        int set_flags = (enc >> 29) & 1;
+        int64_t imm = arm64_get_imm12(enc);
+
+        if ((enc >> 23) & 1) {
+            return -1;
+        }
+        if ((enc >> 22) & 1) {
+            imm <<= 12;
+        }
+        v = ir_emit(blk, is_sub ? IR_SUB : IR_ADD, size, a64_reg(blk, rn, 1),
+                    ir_const(blk, imm), 0);
+        if (set_flags) {
+            ir_set_flags(blk, v);
+        }
+        a64_set(blk, rd, !set_flags, v);
+        return 0;
+    }
+
+    /* ADD/ADDS/SUB/SUBS (shifted register) */
+    if ((enc & 0x1F200000) == 0x0B000000) {
+        int is_sub = (enc >> 30) & 1;
+        int set_flags = (enc >> 29) & 1;
+
+        b = a64_shifted(blk, enc, size);
+        if (b == IR_NONE) {
+            return -1;
+        }
+        v = ir_emit(blk, is_sub ? IR_SUB : IR_ADD, size, a64_reg(blk, rn, 0), b, 0);
+        if (set_flags) {
+            ir_set_flags(blk, v);
+        }
+        a64_set(blk, rd, 0, v);
+        return 0;
+    }
+
+    /* AND/ORR/EOR/ANDS (shifted register), N inverts Rm */
+    if ((enc & 0x1F000000) == 0x0A000000) {
+        static const ir_op_t ops[4] = { IR_AND, IR_OR, IR_XOR, IR_AND };
+        uint8_t opc = (enc >> 29) & 3;
+
+        b = a64_shifted(blk, enc, size);
+        if (b == IR_NONE) {
+            return -1;
+        }
+        if ((enc >> 21) & 1) {
+            b = ir_emit(blk, IR_NOT, size, b, IR_NONE, 0);
+        }
+        if (opc == 1 && rn == 31) {
+            v = (size == 4) ? ir_emit(blk, IR_ZEXT, 8, b, IR_NONE, 4) : b;   /* MOV */
+        } else {
+            v = ir_emit(blk, ops[opc], size, a64_reg(blk, rn, 0), b, 0);
+        }
+        if (opc == 3) {
+            ir_set_flags(blk, v);
+        }
+        a64_set(blk, rd, 0, v);
+        return 0;
+    }
+
+    /* MOVN/MOVZ/MOVK */
+    if ((enc & 0x1F800000) == 0x12800000) {
+        uint8_t opc = (enc >> 29) & 3;
+        uint8_t shift = (uint8_t)(arm64_get_hw(enc) * 16);
+        uint64_t imm = (uint64_t)arm64_get_imm16(enc) << shift;
+        uint64_t mask = sf ? ~0ULL : 0xFFFFFFFFULL;
+
+        if (opc == 1 || (!sf && shift >= 32)) {
+            return -1;
+        }
+        if (opc == 3) {
+            v = ir_emit(blk, IR_AND, size, a64_reg(blk, rd, 0),
+                        ir_const(blk, (int64_t)~(0xFFFFULL << shift)), 0);
+            v = ir_emit(blk, IR_OR, size, v, ir_const(blk, (int64_t)imm), 0);
+        } else {
+            v = ir_const(blk, (int64_t)((opc == 0 ? ~imm : imm) & mask));
+        }
+        a64_set(blk, rd, 0, v);
+        return 0;
+    }
+
+    /* MADD (MUL when Ra is XZR) */
+    if ((enc & 0x7FE08000) == 0x1B000000) {
+        uint8_t ra = (enc >> 10) & 0x1F;
+
+        v = ir_emit(blk, IR_MUL, size, a64_reg(blk, rn, 0),
+                    a64_reg(blk, arm64_get_rm(enc), 0), 0);
+        if (ra != 31) {
+            v = ir_emit(blk, IR_ADD, size, a64_reg(blk, ra, 0), v, 0);
+        }
+        a64_set(blk, rd, 0, v);
+        return 0;
+    }
+
+    /* CRC32{B,H,W,X}, CRC32C{B,H,W,X}: Wd = crc(Wn, Rm) */
+    if ((enc & 0x7FE0E000) == 0x1AC04000) {
+        uint8_t sz = (enc >> 10) & 3;
+
+        if ((enc >> 31) != (sz == 3)) {
+            return -1;
+        }
+        v = ir_emit(blk, IR_CRC32, (uint8_t)(1u << sz), a64_reg(blk, rn, 0),
+                    a64_reg(blk, arm64_get_rm(enc), 0),
+                    ((enc >> 12) & 1) ? IR_CRC_CASTAGNOLI : IR_CRC_IEEE);
+        a64_set(blk, rd, 0, v);
+        return 0;
+    }
+
+    /* AESE, AESD: Vd = op(Vd ^ Vn); AESMC, AESIMC: Vd = op(Vn) */
+    if ((enc & 0xFFFFCC00) == 0x4E284800) {
+        static const ir_aes_op_t ops[4] = { IR_AES_E, IR_AES_D, IR_AES_MC, IR_AES_IMC };
+        ir_aes_op_t op = ops[(enc >> 12) & 3];
+
+        if (op == IR_AES_E || op == IR_AES_D) {
+            v = ir_emit(blk, IR_AES, 16, ir_get_vreg(blk, IR_ARM64_V0 + rd),
+                        ir_get_vreg(blk, IR_ARM64_V0 + rn), op);
+        } else {
+            v = ir_emit(blk, IR_AES, 16, ir_get_vreg(blk, IR_ARM64_V0 + rn), IR_NONE, op);
+        }
+        ir_set_vreg(blk, IR_ARM64_V0 + rd, v);
+        return 0;
+    }
+
+    /* SHA1C/P/M, SHA1SU0, SHA256H/H2, SHA256SU1 */
+    if ((enc & 0xFFE08C00) == 0x5E000000 && ((enc >> 12) & 7) != 7) {
+        static const ir_sha_op_t ops[7] = {
+            IR_SHA1C, IR_SHA1P, IR_SHA1M, IR_SHA1SU0, IR_SHA256H, IR_SHA256H2, IR_SHA256SU1
+        };
+        ir_sha_op_t op = ops[(enc >> 12) & 7];
+        ir_ref_t d = ir_get_vreg(blk, IR_ARM64_V0 + rd);
+        ir_ref_t n = ir_get_vreg(blk, IR_ARM64_V0 + rn);
+        ir_ref_t m = ir_get_vreg(blk, IR_ARM64_V0 + arm64_get_rm(enc));
+
+        if (op == IR_SHA256H || op == IR_SHA256H2) {
+            ir_ref_t abcd = (op == IR_SHA256H) ? d : n;
+            ir_ref_t efgh = (op == IR_SHA256H) ? n : d;
+
+            a = ir_sha(blk, IR_SHA256_ABEF, abcd, efgh, IR_NONE);
+            b = ir_sha(blk, IR_SHA256_CDGH, abcd, efgh, IR_NONE);
+            b = ir_sha(blk, IR_SHA256_RNDS2, b, a, m);
+            a = ir_sha(blk, IR_SHA256_RNDS2_HI, a, b, m);
+            v = ir_sha(blk, op == IR_SHA256H ? IR_SHA256_ABCD : IR_SHA256_EFGH, a, b, IR_NONE);
+        } else {
+            v = ir_sha(blk, op, d, n, m);
+        }
+        ir_set_vreg(blk, IR_ARM64_V0 + rd, v);
+        return 0;
+    }
+
+    /* PMULL/PMULL2 Vd.1Q or Vd.8H; Q picks the source halves */
+    if ((enc & 0xBF20FC00) == 0x0E20E000 &&
+        (((enc >> 22) & 3) == 0 || ((enc >> 22) & 3) == 3)) {
+        ir_pmull_op_t op = ((enc >> 22) & 3) ? IR_PMULL_64 : IR_PMULL_8;
+
+        if ((enc >> 30) & 1) {
+            op = op == IR_PMULL_64 ? IR_PMULL2_64 : IR_PMULL2_8;
+        }
+        v = ir_emit(blk, IR_PMULL, 16, ir_get_vreg(blk, IR_ARM64_V0 + rn),
+                    ir_get_vreg(blk, IR_ARM64_V0 + arm64_get_rm(enc)), op);
+        ir_set_vreg(blk, IR_ARM64_V0 + rd, v);
+        return 0;
+    }
+
+    /* SHA1H Sd, Sn; SHA1SU1, SHA256SU0 Vd, Vn */
+    if ((enc & 0xFFFFCC00) == 0x5E280800 && ((enc >> 12) & 3) != 3) {
+        static const ir_sha_op_t ops[3] = { IR_SHA1H, IR_SHA1SU1, IR_SHA256SU0 };
+        ir_sha_op_t op = ops[(enc >> 12) & 3];
+
+        if (op == IR_SHA1H) {
+            v = ir_sha(blk, op, ir_get_vreg(blk, IR_ARM64_V0 + rn), IR_NONE, IR_NONE);
+        } else {
+            v = ir_sha(blk, op, ir_get_vreg(blk, IR_ARM64_V0 + rd),
+                       ir_get_vreg(blk, IR_ARM64_V0 + rn), IR_NONE);
+        }
+        ir_set_vreg(blk, IR_ARM64_V0 + rd, v);
+        return 0;
+    }
+
+    /* AND, ORR and EOR Vd.16B, Vn.16B, Vm.16B; ORR with Vn == Vm is MOV */
+    if ((enc & 0xFFE0FC00) == 0x4E201C00 || (enc & 0xFFE0FC00) == 0x4EA01C00 ||
+        (enc & 0xFFE0FC00) == 0x6E201C00) {
+        ir_op_t op = (enc >> 29) & 1 ? IR_XOR : ((enc >> 23) & 1) ? IR_OR : IR_AND;
+        uint8_t rm = arm64_get_rm(enc);
+
+        v = ir_get_vreg(blk, IR_ARM64_V0 + rn);
+        if (op == IR_XOR || rm != rn) {
+            v = ir_emit(blk, op, 16, v, ir_get_vreg(blk, IR_ARM64_V0 + rm), 0);
+        }
+        ir_set_vreg(blk, IR_ARM64_V0 + rd, v);
+        return 0;
+    }
+
+    /* ADD, SUB Vd.<T>, Vn.<T>, Vm.<T> on full vectors */
+    if ((enc & 0xDF20FC00) == 0x4E208400) {
+        v = ir_emit(blk, ((enc >> 29) & 1) ? IR_SUB : IR_ADD, 16,
+                    ir_get_vreg(blk, IR_ARM64_V0 + rn),
+                    ir_get_vreg(blk, IR_ARM64_V0 + arm64_get_rm(enc)),
+                    1 << ((enc >> 22) & 3));
+        ir_set_vreg(blk, IR_ARM64_V0 + rd, v);
+        return 0;
+    }
+
+    /* REV64, REV32, REV16 Vd.16B, Vn.16B */
+    if ((enc & 0xFFFFFC00) == 0x4E200800 || (enc & 0xFFFFFC00) == 0x6E200800 ||
+        (enc & 0xFFFFFC00) == 0x4E201800) {
+        int64_t lane = ((enc >> 12) & 1) ? 2 : ((enc >> 29) & 1) ? 4 : 8;
+
+        v = ir_emit(blk, IR_BSWAP, 16, ir_get_vreg(blk, IR_ARM64_V0 + rn), IR_NONE, lane);
+        ir_set_vreg(blk, IR_ARM64_V0 + rd, v);
+        return 0;
+    }
+
+    /* LDR/STR Qt (unsigned offset) */
+    if ((enc & 0xFF800000) == 0x3D800000) {
+        int64_t off = (int64_t)arm64_get_imm12(enc) * 16;
+
+        a = a64_reg(blk, rn, 1);
+        if ((enc >> 22) & 1) {
+            ir_set_vreg(blk, IR_ARM64_V0 + rd, ir_load(blk, 16, a, off));
+        } else {
+            ir_store(blk, 16, a, off, ir_get_vreg(blk, IR_ARM64_V0 + rd));
+        }
+        return 0;
+    }
+
+    /* LDR/STR (unsigned offset), LDRSW */
+    if ((enc & 0x3B000000) == 0x39000000 && !((enc >> 26) & 1)) {
+        uint8_t bytes = (uint8_t)(1u << (enc >> 30));
+        uint8_t opc = (enc >> 22) & 3;
+        int64_t off = (int64_t)arm64_get_imm12(enc) * bytes;
+
+        a = a64_reg(blk, rn, 1);
+        if (opc == 0) {
+            ir_store(blk, bytes, a, off, a64_reg(blk, rd, 0));
+        } else if (opc == 1) {
+            a64_set(blk, rd, 0, ir_load(blk, bytes, a, off));
+        } else if (opc == 2 && bytes == 4) {
+            v = ir_load(blk, 4, a, off);
+            a64_set(blk, rd, 0, ir_emit(blk, IR_SEXT, 8, v, IR_NONE, 4));
+        } else {
+            return -1;
+        }
+        return 0;
+    }
+
+    /* B/BL */
+    if ((enc & 0x7C000000) == 0x14000000) {
+        if (enc >> 31) {
+            ir_set_reg(blk, 30, ir_const(blk, (int64_t)(pc + 4)));
+        }
+        ir_br(blk, pc + (int64_t)arm64_get_imm26(enc) * 4);
+        blk->terminated = 1;
+        return 0;
+    }
+
+    /* B.cond */
+    if ((enc & 0xFF000010) == 0x54000000) {
+        uint8_t cond = arm64_get_cond(enc);
+        uint64_t target = pc + (int64_t)arm64_get_imm19(enc) * 4;
+        ir_cond_t c;
+
+        if (cond >= COND_AL) {
+            ir_br(blk, target);
+        } else if (a64_cond(blk, cond, &c) == 0) {
+            ir_brcond(blk, c, blk->flags_ref, target, pc + 4);
+        } else {
+            return -1;
+        }
+        blk->terminated = 1;
+        return 0;
+    }
+
+    /* CBZ/CBNZ and TBZ/TBNZ: the test is not a guest flags producer */
+    if ((enc & 0x7E000000) == 0x34000000 || (enc & 0x7E000000) == 0x36000000) {
+        int is_tb = (enc >> 25) & 1;
+        int nonzero = (enc >> 24) & 1;
+        uint64_t target;
+
+        v = a64_reg(blk, rd, 0);
+        if (is_tb) {
+            uint8_t bit = arm64_get_test_bit(enc);
+            a = ir_emit(blk, IR_TEST, 8, v, ir_const(blk, (int64_t)(1ULL << bit)), 0);
+            target = pc + (int64_t)arm64_get_imm14(enc) * 4;
+        } else {
+            a = ir_emit(blk, IR_TEST, size, v, v, 0);
+            target = pc + (int64_t)arm64_get_imm19(enc) * 4;
+        }
+        ir_brcond(blk, nonzero ? IR_COND_NE : IR_COND_EQ, a, target, pc + 4);
+        blk->terminated = 1;
+        return 0;
+    }
+
+    /* BR/BLR/RET */
+    if ((enc & 0xFF9FFC1F) == 0xD61F0000) {
+        uint8_t kind = (enc >> 21) & 3;     /* 0 BR, 1 BLR, 2 RET */
+
+        v = ir_get_reg(blk, rn);
+        if (kind == 1) {
+            ir_set_reg(blk, 30, ir_const(blk, (int64_t)(pc + 4)));
+        }
+        ir_br_ind(blk, v);
+        blk->terminated = 1;
+        return 0;
+    }
+
+    /* SVC #0: flags pending in this block must reach state first */
+    if ((enc & 0xFFE0001F) == 0xD4000001) {
+        if (blk->syscall_helper == 0 || blk->flags_ref != IR_NONE) {
+            return -1;
+        }
+        ir_call(blk, blk->syscall_helper);
+        return 0;
+    }
+
+    /* NOP */
+    if (enc == 0xD503201F) {
+        return 0;
+    }
+
+    return -1;
+}
+
+int ir_arm64_lower_insn(ir_block_t *blk, uint32_t encoding, uint64_t pc)
+{
+    uint16_t count = blk->count;
+    ir_ref_t flags = blk->flags_ref;
+
+    if (blk->terminated || blk->count + IR_ARM64_MAX_EXPANSION >= IR_MAX_INSNS) {
+        return -1;
+    }
+
+    if (a64_lower(blk, encoding, pc) != 0) {
+        blk->count = count;
+        blk->flags_ref = flags;
+        blk->terminated = 0;
+        return -1;
+    }
+
+    blk->guest_insns++;
+    blk->next_pc = pc + 4;
+    return 0;
+}
+
+int ir_arm64_lower_block(ir_block_t *blk, const uint32_t *code, uint64_t pc,
+                         int max_insns)
+{
+    uint64_t helper = blk->syscall_helper;
+
+    ir_block_init(blk, pc);
+    blk->syscall_helper = helper;
+
+    while (!blk->terminated && blk->guest_insns < max_insns) {
+        if (ir_arm64_lower_insn(blk, code[blk->guest_insns], blk->next_pc) < 0) {
+            break;
+        }
+    }
+
+    if (!blk->terminated) {
+        ir_br(blk, blk->next_pc);
+        blk->terminated = 1;
+    }
+    return blk->guest_insns;
+}
@@ -0,0 +1,588 @@
+/* ============================================================================
+ * Rosetta Translator - x86_64 to IR Front-end
+ * ============================================================================
+ *
+ * Lowers the integer core of x86_64 (MOV/LEA/ALU/shifts, PUSH/POP, direct
+ * and indirect control flow, SYSCALL) into the IR. Operands are decoded
+ * here from the instruction bytes since the IR needs the full SIB address
+ * form, which x86_insn_t does not keep.
+ *
+ * Anything else (8/16-bit operations, prefixes other than REX, flags
+ * consumers whose producer is not in the block) is reported unsupported,
+ * so the caller can fall back to the direct translators.
+ * ============================================================================ */
+
+#include "rosetta_ir.h"
+#include <string.h>
+
+#define X86_REG_RSP     4
+
+/* IR instructions one x86 instruction may need at most */
+#define IR_X86_MAX_EXPANSION    24
+
+/* Decoded r/m operand */
+typedef struct {
+    uint8_t mod;
+    uint8_t reg;            /* ModRM.reg, REX.R extended */
+    uint8_t rm;             /* Register operand when mod == 3 */
+    int8_t base;            /* -1 if none */
+    int8_t index;           /* -1 if none */
+    uint8_t scale;          /* log2 */
+    int rip_rel;
+    int32_t disp;
+} x86_modrm_t;
+
+/* ============================================================================
+ * Operand Decoding
+ * ============================================================================ */
+
+static const uint8_t *x86_parse_modrm(const uint8_t *p, uint8_t rex, x86_modrm_t *m)
+{
+    uint8_t modrm = *p++;
+
+    memset(m, 0, sizeof(*m));
+    m->mod = modrm >> 6;
+    m->reg = (uint8_t)(((modrm >> 3) & 7) | ((rex & 0x04) << 1));
+    m->rm = (uint8_t)((modrm & 7) | ((rex & 0x01) << 3));
+    m->base = -1;
+    m->index = -1;
+
+    if (m->mod == 3) {
+        return p;
+    }
+
+    if ((modrm & 7) == 4) {
+        uint8_t sib = *p++;
+        uint8_t idx = (uint8_t)(((sib >> 3) & 7) | ((rex & 0x02) << 2));
+
+        m->scale = sib >> 6;
+        if (idx != X86_REG_RSP) {
+            m->index = (int8_t)idx;
+        }
+        if ((sib & 7) == 5 && m->mod == 0) {
+            m->disp = (int32_t)(p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24));
+            return p + 4;
+        }
+        m->base = (int8_t)((sib & 7) | ((rex & 0x01) << 3));
+    } else if ((modrm & 7) == 5 && m->mod == 0) {
+        m->rip_rel = 1;
+        m->disp = (int32_t)(p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24));
+        return p + 4;
+    } else {
+        m->base = (int8_t)m->rm;
+    }
+
+    if (m->mod == 1) {
+        m->disp = (int8_t)*p++;
+    } else if (m->mod == 2) {
+        m->disp = (int32_t)(p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24));
+        p += 4;
+    }
+    return p;
+}
+
+static int32_t x86_imm32(const uint8_t *p)
+{
+    return (int32_t)(p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24));
+}
+
+/**
+ * Address of a memory operand without its displacement
+ * @param disp Receives the displacement to fold into LOAD/STORE
+ */
+static ir_ref_t x86_addr(ir_block_t *blk, const x86_modrm_t *m, uint64_t next_pc,
+                         int64_t *disp)
+{
+    ir_ref_t addr = IR_NONE;
+
+    *disp = m->disp;
+
+    if (m->rip_rel) {
+        *disp = 0;
+        return ir_const(blk, (int64_t)(next_pc + (int64_t)m->disp));
+    }
+
+    if (m->base >= 0) {
+        addr = ir_get_reg(blk, (uint16_t)m->base);
+    }
+    if (m->index >= 0) {
+        ir_ref_t idx = ir_get_reg(blk, (uint16_t)m->index);
+
+        if (m->scale) {
+            idx = ir_emit(blk, IR_SHL, 8, idx, ir_const(blk, m->scale), 0);
+        }
+        addr = (addr == IR_NONE) ? idx : ir_emit(blk, IR_ADD, 8, addr, idx, 0);
+    }
+    if (addr == IR_NONE) {
+        addr = ir_const(blk, m->disp);
+        *disp = 0;
+    }
+    return addr;
+}
+
+/* Read the r/m operand (register or memory) at size */
+static ir_ref_t x86_read_rm(ir_block_t *blk, const x86_modrm_t *m, uint8_t size,
+                            uint64_t next_pc)
+{
+    int64_t disp;
+    ir_ref_t addr;
+
+    if (m->mod == 3) {
+        return ir_get_reg(blk, m->rm);
+    }
+    addr = x86_addr(blk, m, next_pc, &disp);
+    return ir_load(blk, size, addr, disp);
+}
+
+/* Write value to the r/m operand; 32-bit register writes zero-extend */
+static void x86_write_rm(ir_block_t *blk, const x86_modrm_t *m, uint8_t size,
+                         uint64_t next_pc, ir_ref_t value)
+{
+    int64_t disp;
+    ir_ref_t addr;
+
+    if (m->mod == 3) {
+        ir_set_reg(blk, m->rm, value);
+        return;
+    }
+    addr = x86_addr(blk, m, next_pc, &disp);
+    ir_store(blk, size, addr, disp, value);
+}
+
+/* ============================================================================
+ * Instruction Lowering
+ * ============================================================================ */
+
+/* Group-1 ALU index (ADD, OR, ADC, SBB, AND, SUB, XOR, CMP) to IR op */
+static const ir_op_t x86_alu_ops[8] = {
+    IR_ADD, IR_OR, IR_NOP, IR_NOP, IR_AND, IR_SUB, IR_XOR, IR_CMP
+};
+
+/* dst = dst op src at size, with x86 flags */
+static void x86_alu(ir_block_t *blk, ir_op_t op, uint8_t size, ir_ref_t dst, ir_ref_t src,
+                    const x86_modrm_t *m, int dst_is_reg, uint8_t reg, uint64_t next_pc)
+{
+    ir_ref_t r = ir_emit(blk, op, size, dst, src, 0);
+
+    ir_set_flags(blk, r);
+    if (op == IR_CMP) {
+        return;
+    }
+    if (dst_is_reg) {
+        ir_set_reg(blk, reg, r);
+    } else {
+        x86_write_rm(blk, m, size, next_pc, r);
+    }
+}
+
+static void x86_push(ir_block_t *blk, ir_ref_t value)
+{
+    ir_ref_t sp = ir_emit(blk, IR_SUB, 8, ir_get_reg(blk, X86_REG_RSP), ir_const(blk, 8), 0);
+
+    ir_store(blk, 8, sp, 0, value);
+    ir_set_reg(blk, X86_REG_RSP, sp);
+}
+
+static ir_ref_t x86_pop(ir_block_t *blk, int64_t extra)
+{
+    ir_ref_t sp = ir_get_reg(blk, X86_REG_RSP);
+    ir_ref_t value = ir_load(blk, 8, sp, 0);
+
+    ir_set_reg(blk, X86_REG_RSP, ir_emit(blk, IR_ADD, 8, sp, ir_const(blk, 8 + extra), 0));
+    return value;
+}
+
+/* Byte registers 4-7 are AH-BH without REX */
+static int x86_byte_reg_ok(uint8_t rex, uint8_t reg)
+{
+    return rex != 0 || reg < 4;
+}
+
+static int x86_jcc(ir_block_t *blk, uint8_t cc, uint64_t target, uint64_t next_pc)
+{
+    ir_ref_t flags = blk->flags_ref;
+
+    if (flags == IR_NONE || !ir_cond_supported(ir_flags_kind(blk, flags), (ir_cond_t)cc)) {
+        return -1;
+    }
+    ir_brcond(blk, (ir_cond_t)cc, flags, target, next_pc);
+    blk->terminated = 1;
+    return 0;
+}
+
+static int x86_lower(ir_block_t *blk, const uint8_t *code, uint64_t pc, int *len)
+{
+    const uint8_t *p = code;
+    x86_modrm_t m;
+    uint8_t rex = 0, op, size;
+    uint64_t next;
+    ir_ref_t v;
+    int64_t imm;
+
+    /* Null segment overrides are harmless in 64-bit mode */
+    while (*p == 0x2E || *p == 0x3E || *p == 0x26 || *p == 0x36) {
+        p++;
+    }
+    if ((*p & 0xF0) == 0x40) {
+        rex = *p++;
+    }
+    size = (rex & 0x08) ? 8 : 4;
+    op = *p++;
+
+#define X86_END(extra)  (*len = (int)(p - code) + (extra), next = pc + (uint64_t)*len)
+
+    /* ALU r/m, r (x1) / r, r/m (x3) / eAX, imm32 (x5) */
+    if (op < 0x40 && (op & 7) <= 5 && (op & 1) && x86_alu_ops[op >> 3] != IR_NOP) {
+        ir_op_t alu = x86_alu_ops[op >> 3];
+
+        if ((op & 7) == 5) {
+            X86_END(4);
+            x86_alu(blk, alu, size, ir_get_reg(blk, 0), ir_const(blk, x86_imm32(p)),
+                    NULL, 1, 0, next);
+            return 0;
+        }
+        p = x86_parse_modrm(p, rex, &m);
+        X86_END(0);
+        if ((op & 7) == 1) {
+            x86_alu(blk, alu, size, x86_read_rm(blk, &m, size, next),
+                    ir_get_reg(blk, m.reg), &m, 0, 0, next);
+        } else {
+            x86_alu(blk, alu, size, ir_get_reg(blk, m.reg),
+                    x86_read_rm(blk, &m, size, next), &m, 1, m.reg, next);
+        }
+        return 0;
+    }
+
+    switch (op) {
+    case 0x81:
+    case 0x83:
+        p = x86_parse_modrm(p, rex, &m);
+        if (x86_alu_ops[m.reg & 7] == IR_NOP) {
+            return -1;
+        }
+        imm = (op == 0x81) ? x86_imm32(p) : (int8_t)*p;
+        X86_END(op == 0x81 ? 4 : 1);
+        x86_alu(blk, x86_alu_ops[m.reg & 7], size, x86_read_rm(blk, &m, size, next),
+                ir_const(blk, imm), &m, 0, 0, next);
+        return 0;
+
+    case 0x85:      /* TEST r/m, r */
+        p = x86_parse_modrm(p, rex, &m);
+        X86_END(0);
+        v = ir_emit(blk, IR_TEST, size, x86_read_rm(blk, &m, size, next),
+                    ir_get_reg(blk, m.reg), 0);
+        ir_set_flags(blk, v);
+        return 0;
+
+    case 0xA9:      /* TEST eAX, imm32 */
+        X86_END(4);
+        v = ir_emit(blk, IR_TEST, size, ir_get_reg(blk, 0), ir_const(blk, x86_imm32(p)), 0);
+        ir_set_flags(blk, v);
+        return 0;
+
+    case 0x89:      /* MOV r/m, r */
+        p = x86_parse_modrm(p, rex, &m);
+        X86_END(0);
+        v = ir_get_reg(blk, m.reg);
+        if (size == 4 && m.mod == 3) {
+            v = ir_emit(blk, IR_ZEXT, 8, v, IR_NONE, 4);
+        }
+        x86_write_rm(blk, &m, size, next, v);
+        return 0;
+
+    case 0x8B:      /* MOV r, r/m */
+        p = x86_parse_modrm(p, rex, &m);
+        X86_END(0);
+        v = x86_read_rm(blk, &m, size, next);
+        if (size == 4 && m.mod == 3) {
+            v = ir_emit(blk, IR_ZEXT, 8, v, IR_NONE, 4);
+        }
+        ir_set_reg(blk, m.reg, v);
+        return 0;
+
+    case 0x8D:      /* LEA */
+        p = x86_parse_modrm(p, rex, &m);
+        if (m.mod == 3) {
+            return -1;
+        }
+        X86_END(0);
+        v = x86_addr(blk, &m, next, &imm);
+        if (imm != 0) {
+            v = ir_emit(blk, IR_ADD, 8, v, ir_const(blk, imm), 0);
+        }
+        if (size == 4) {
+            v = ir_emit(blk, IR_ZEXT, 8, v, IR_NONE, 4);
+        }
+        ir_set_reg(blk, m.reg, v);
+        return 0;
+
+    case 0x63:      /* MOVSXD r64, r/m32 */
+        if (size != 8) {
+            return -1;
+        }
+        p = x86_parse_modrm(p, rex, &m);
+        X86_END(0);
+        v = x86_read_rm(blk, &m, 4, next);
+        ir_set_reg(blk, m.reg, ir_emit(blk, IR_SEXT, 8, v, IR_NONE, 4));
+        return 0;
+
+    case 0xC7:      /* MOV r/m, imm32 */
+        p = x86_parse_modrm(p, rex, &m);
+        if ((m.reg & 7) != 0) {
+            return -1;
+        }
+        imm = x86_imm32(p);
+        X86_END(4);
+        x86_write_rm(blk, &m, size, next,
+                     ir_const(blk, size == 8 ? imm : (int64_t)(uint32_t)imm));
+        return 0;
+
+    case 0xC1:      /* SHL/SHR/SAR r/m, imm8 */
+    case 0xD1:      /* ... by 1 */
+    {
+        static const ir_op_t shifts[8] = {
+            IR_NOP, IR_NOP, IR_NOP, IR_NOP, IR_SHL, IR_SHR, IR_NOP, IR_SAR
+        };
+        uint8_t count;
+
+        p = x86_parse_modrm(p, rex, &m);
+        if (shifts[m.reg & 7] == IR_NOP) {
+            return -1;
+        }
+        count = (uint8_t)((op == 0xC1 ? *p : 1) & (size == 8 ? 63 : 31));
+        X86_END(op == 0xC1 ? 1 : 0);
+        if (count == 0) {
+            return 0;
+        }
+        v = x86_read_rm(blk, &m, size, next);
+        x86_write_rm(blk, &m, size, next,
+                     ir_emit(blk, shifts[m.reg & 7], size, v, ir_const(blk, count), 0));
+        blk->flags_ref = IR_NONE;   /* Shift flags are not modelled */
+        return 0;
+    }
+
+    case 0xF7:
+        p = x86_parse_modrm(p, rex, &m);
+        switch (m.reg & 7) {
+        case 0:     /* TEST r/m, imm32 */
+            imm = x86_imm32(p);
+            X86_END(4);
+            v = ir_emit(blk, IR_TEST, size, x86_read_rm(blk, &m, size, next),
+                        ir_const(blk, imm), 0);
+            ir_set_flags(blk, v);
+            return 0;
+        case 2:     /* NOT: flags unchanged */
+            X86_END(0);
+            v = ir_emit(blk, IR_NOT, size, x86_read_rm(blk, &m, size, next), IR_NONE, 0);
+            x86_write_rm(blk, &m, size, next, v);
+            return 0;
+        case 3:     /* NEG */
+            X86_END(0);
+            v = ir_emit(blk, IR_NEG, size, x86_read_rm(blk, &m, size, next), IR_NONE, 0);
+            ir_set_flags(blk, v);
+            x86_write_rm(blk, &m, size, next, v);
+            return 0;
+        default:
+            return -1;
+        }
+
+    case 0xFF:
+        p = x86_parse_modrm(p, rex, &m);
+        X86_END(0);
+        if ((m.reg & 7) == 2 || (m.reg & 7) == 4) {
+            v = x86_read_rm(blk, &m, 8, next);
+            if ((m.reg & 7) == 2) {
+                x86_push(blk, ir_const(blk, (int64_t)next));
+            }
+            ir_br_ind(blk, v);
+            blk->terminated = 1;
+            return 0;
+        }
+        if ((m.reg & 7) == 6) {
+            x86_push(blk, x86_read_rm(blk, &m, 8, next));
+            return 0;
+        }
+        return -1;
+
+    case 0x90:
+        X86_END(0);
+        return 0;
+
+    case 0xB8: case 0xB9: case 0xBA: case 0xBB:
+    case 0xBC: case 0xBD: case 0xBE: case 0xBF:
+        if (size == 8) {
+            memcpy(&imm, p, 8);
+            X86_END(8);
+        } else {
+            imm = (int64_t)(uint32_t)x86_imm32(p);
+            X86_END(4);
+        }
+        ir_set_reg(blk, (uint16_t)((op & 7) | ((rex & 0x01) << 3)), ir_const(blk, imm));
+        return 0;
+
+    case 0x50: case 0x51: case 0x52: case 0x53:
+    case 0x54: case 0x55: case 0x56: case 0x57:
+        X86_END(0);
+        x86_push(blk, ir_get_reg(blk, (uint16_t)((op & 7) | ((rex & 0x01) << 3))));
+        return 0;
+
+    case 0x58: case 0x59: case 0x5A: case 0x5B:
+    case 0x5C: case 0x5D: case 0x5E: case 0x5F:
+        X86_END(0);
+        v = x86_pop(blk, 0);
+        ir_set_reg(blk, (uint16_t)((op & 7) | ((rex & 0x01) << 3)), v);
+        return 0;
+
+    case 0xE8:      /* CALL rel32 */
+        X86_END(4);
+        x86_push(blk, ir_const(blk, (int64_t)next));
+        ir_br(blk, next + (int64_t)x86_imm32(p));
+        blk->terminated = 1;
+        return 0;
+
+    case 0xE9:      /* JMP rel32 */
+        X86_END(4);
+        ir_br(blk, next + (int64_t)x86_imm32(p));
+        blk->terminated = 1;
+        return 0;
+
+    case 0xEB:      /* JMP rel8 */
+        X86_END(1);
+        ir_br(blk, next + (int8_t)*p);
+        blk->terminated = 1;
+        return 0;
+
+    case 0xC3:      /* RET */
+    case 0xC2:      /* RET imm16 */
+        X86_END(op == 0xC2 ? 2 : 0);
+        v = x86_pop(blk, op == 0xC2 ? (int64_t)(p[0] | (p[1] << 8)) : 0);
+        ir_br_ind(blk, v);
+        blk->terminated = 1;
+        return 0;
+
+    case 0x0F:
+        break;
+
+    default:
+        if (op >= 0x70 && op <= 0x7F) {
+            X86_END(1);
+            return x86_jcc(blk, op & 0xF, next + (int8_t)*p, next);
+        }
+        return -1;
+    }
+
+    /* Two-byte opcodes */
+    op = *p++;
+
+    if (op >= 0x80 && op <= 0x8F) {
+        X86_END(4);
+        return x86_jcc(blk, op & 0xF, next + (int64_t)x86_imm32(p), next);
+    }
+
+    switch (op) {
+    case 0x05:      /* SYSCALL */
+        if (blk->syscall_helper == 0) {
+            return -1;
+        }
+        X86_END(0);
+        ir_call(blk, blk->syscall_helper);
+        return 0;
+
+    case 0x1F:      /* NOP r/m */
+        p = x86_parse_modrm(p, rex, &m);
+        X86_END(0);
+        return 0;
+
+    case 0xAF:      /* IMUL r, r/m */
+        p = x86_parse_modrm(p, rex, &m);
+        X86_END(0);
+        v = ir_emit(blk, IR_MUL, size, ir_get_reg(blk, m.reg),
+                    x86_read_rm(blk, &m, size, next), 0);
+        ir_set_reg(blk, m.reg, v);
+        blk->flags_ref = IR_NONE;
+        return 0;
+
+    case 0xB6: case 0xB7:   /* MOVZX */
+    case 0xBE: case 0xBF:   /* MOVSX */
+    {
+        uint8_t from = (op & 1) ? 2 : 1;
+
+        p = x86_parse_modrm(p, rex, &m);
+        if (m.mod == 3 && from == 1 && !x86_byte_reg_ok(rex, m.rm)) {
+            return -1;
+        }
+        X86_END(0);
+        v = x86_read_rm(blk, &m, from, next);
+        v = ir_emit(blk, (op & 8) ? IR_SEXT : IR_ZEXT, 8, v, IR_NONE, from);
+        if (size == 4 && (op & 8)) {
+            v = ir_emit(blk, IR_ZEXT, 8, v, IR_NONE, 4);
+        }
+        ir_set_reg(blk, m.reg, v);
+        return 0;
+    }
+
+    default:
+        if (op >= 0x90 && op <= 0x9F) {     /* SETcc r8 */
+            ir_ref_t flags = blk->flags_ref;
+
+            p = x86_parse_modrm(p, rex, &m);
+            if (m.mod != 3 || !x86_byte_reg_ok(rex, m.rm) || flags == IR_NONE ||
+                !ir_cond_supported(ir_flags_kind(blk, flags), (ir_cond_t)(op & 0xF))) {
+                return -1;
+            }
+            X86_END(0);
+            v = ir_emit(blk, IR_SETCC, 8, flags, IR_NONE, 0);
+            blk->insns[v].cond = op & 0xF;
+            v = ir_emit(blk, IR_OR, 8,
+                        ir_emit(blk, IR_AND, 8, ir_get_reg(blk, m.rm),
+                                ir_const(blk, ~(int64_t)0xFF), 0), v, 0);
+            ir_set_reg(blk, m.rm, v);
+            return 0;
+        }
+        return -1;
+    }
+
+#undef X86_END
+}
+
+int ir_x86_lower_insn(ir_block_t *blk, const uint8_t *code, uint64_t pc)
+{
+    uint16_t count = blk->count;
+    ir_ref_t flags = blk->flags_ref;
+    int len = 0;
+
+    if (blk->terminated || blk->count + IR_X86_MAX_EXPANSION >= IR_MAX_INSNS) {
+        return -1;
+    }
+
+    if (x86_lower(blk, code, pc, &len) != 0) {
+        blk->count = count;
+        blk->flags_ref = flags;
+        blk->terminated = 0;
+        return -1;
+    }
+
+    blk->guest_insns++;
+    blk->next_pc = pc + (uint64_t)len;
+    return len;
+}
+
+int ir_x86_lower_block(ir_block_t *blk, const uint8_t *code, uint64_t pc, int max_insns)
+{
+    uint64_t helper = blk->syscall_helper;
+
+    ir_block_init(blk, pc);
+    blk->syscall_helper = helper;
+
+    while (!blk->terminated && blk->guest_insns < max_insns) {
+        if (ir_x86_lower_insn(blk, code + (blk->next_pc - pc), blk->next_pc) < 0) {
+            break;
+        }
+    }
+
+    if (!blk->terminated) {
+        ir_br(blk, blk->next_pc);
+        blk->terminated = 1;
+    }
+    return blk->guest_insns;
+}
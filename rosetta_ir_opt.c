@@ -0,0 +1,784 @@
+/* ============================================================================
+ * Rosetta Translator - IR Optimizer
+ * ============================================================================
+ *
+ * All passes walk one block in order. A pass that makes an instruction
+ * redundant turns it into a NOP and forwards its value: later operands
+ * naming it are rewritten to the replacement as the walk reaches them.
+ * Flags operands of BRCOND/SETCC are never forwarded, and flags producers
+ * are never folded away.
+ * ============================================================================ */
+
+#include "rosetta_ir_opt.h"
+#include <string.h>
+
+#define OPT_MAX_GUEST_REGS  64      /* ARM64 X0-X30, SP, V0-V31 */
+#define OPT_MAX_MEM_ENTRIES 16
+
+/* ============================================================================
+ * Helpers
+ * ============================================================================ */
+
+static void opt_fwd_init(ir_ref_t *fwd, uint16_t count)
+{
+    uint16_t i;
+
+    for (i = 0; i < count; i++) {
+        fwd[i] = IR_NONE;
+    }
+}
+
+static ir_ref_t opt_resolve(const ir_ref_t *fwd, ir_ref_t v)
+{
+    return (v != IR_NONE && fwd[v] != IR_NONE) ? fwd[v] : v;
+}
+
+/* Rewrite value operands through the forwarding map */
+static void opt_rewrite(ir_insn_t *insn, const ir_ref_t *fwd)
+{
+    if (insn->op != IR_BRCOND && insn->op != IR_SETCC) {
+        insn->a = opt_resolve(fwd, insn->a);
+    }
+    insn->b = opt_resolve(fwd, insn->b);
+    insn->index = opt_resolve(fwd, insn->index);
+}
+
+/* Replace instruction i by value v */
+static void opt_forward(ir_block_t *blk, ir_ref_t *fwd, ir_ref_t i, ir_ref_t v)
+{
+    fwd[i] = v;
+    blk->insns[i].op = IR_NOP;
+}
+
+static int opt_const(const ir_block_t *blk, ir_ref_t v, int64_t *k)
+{
+    if (v == IR_NONE || blk->insns[v].op != IR_CONST) {
+        return 0;
+    }
+    *k = blk->insns[v].imm;
+    return 1;
+}
+
+/* Plain 64-bit op whose result only matters as a value */
+static const ir_insn_t *opt_plain(const ir_block_t *blk, ir_ref_t v, ir_op_t op)
+{
+    const ir_insn_t *insn;
+
+    if (v == IR_NONE) {
+        return NULL;
+    }
+    insn = &blk->insns[v];
+    return (insn->op == op && insn->size == 8 && !(insn->flags & IR_F_FLAGS)) ? insn : NULL;
+}
+
+static uint64_t opt_trunc(uint64_t v, unsigned bytes)
+{
+    return bytes >= 8 ? v : v & ((1ULL << (bytes * 8)) - 1);
+}
+
+static int64_t opt_sext(uint64_t v, unsigned bytes)
+{
+    unsigned shift = 64 - bytes * 8;
+    return bytes >= 8 ? (int64_t)v : (int64_t)(v << shift) >> shift;
+}
+
+static void opt_make_const(ir_insn_t *insn, uint64_t value)
+{
+    insn->op = IR_CONST;
+    insn->size = 8;
+    insn->flags = 0;
+    insn->a = IR_NONE;
+    insn->b = IR_NONE;
+    insn->index = IR_NONE;
+    insn->imm = (int64_t)value;
+}
+
+/* ============================================================================
+ * Constant Propagation
+ * ============================================================================ */
+
+/* Fold op over constants; returns 0 if op is not foldable */
+static int opt_fold(const ir_insn_t *insn, uint64_t x, uint64_t y, uint64_t *out)
+{
+    unsigned bits = insn->size * 8u;
+    unsigned s = (unsigned)(y & (bits - 1));
+    uint64_t r;
+
+    switch (insn->op) {
+    case IR_ADD: r = x + y; break;
+    case IR_SUB: r = x - y; break;
+    case IR_AND: r = x & y; break;
+    case IR_OR:  r = x | y; break;
+    case IR_XOR: r = x ^ y; break;
+    case IR_MUL: r = x * y; break;
+    case IR_SHL: r = x << s; break;
+    case IR_SHR: r = opt_trunc(x, insn->size) >> s; break;
+    case IR_SAR: r = (uint64_t)(opt_sext(x, insn->size) >> s); break;
+    case IR_NOT: r = ~x; break;
+    case IR_NEG: r = (uint64_t)0 - x; break;
+    default:     return 0;
+    }
+    *out = opt_trunc(r, insn->size);
+    return 1;
+}
+
+void ir_opt_const_prop(ir_block_t *blk, ir_opt_stats_t *stats)
+{
+    ir_ref_t fwd[IR_MAX_INSNS];
+    uint16_t uses[IR_MAX_INSNS];
+    ir_ref_t i;
+
+    opt_fwd_init(fwd, blk->count);
+    memset(uses, 0, sizeof(uses));
+    for (i = 0; i < blk->count; i++) {
+        const ir_insn_t *insn = &blk->insns[i];
+        if (insn->a != IR_NONE) {
+            uses[insn->a]++;
+        }
+        if (insn->b != IR_NONE) {
+            uses[insn->b]++;
+        }
+        if (insn->index != IR_NONE) {
+            uses[insn->index]++;
+        }
+    }
+
+    for (i = 0; i < blk->count; i++) {
+        ir_insn_t *insn = &blk->insns[i];
+        const ir_insn_t *inner;
+        int64_t ka = 0, kb = 0, k = 0;
+        int ca, cb;
+        uint64_t r;
+
+        opt_rewrite(insn, fwd);
+        if ((insn->flags & IR_F_FLAGS) || insn->size < 4) {
+            continue;
+        }
+        ca = opt_const(blk, insn->a, &ka);
+        cb = opt_const(blk, insn->b, &kb);
+
+        switch (insn->op) {
+        case IR_ADD: case IR_SUB: case IR_AND: case IR_OR: case IR_XOR:
+        case IR_MUL: case IR_SHL: case IR_SHR: case IR_SAR:
+            if (ca && cb && opt_fold(insn, (uint64_t)ka, (uint64_t)kb, &r)) {
+                opt_make_const(insn, r);
+                stats->consts_folded++;
+                break;
+            }
+            /* Identities; 32-bit ops also clear the upper half, so 64-bit only */
+            if (!cb || insn->size != 8) {
+                break;
+            }
+            /* (x + k1) + k2 -> x + (k1 + k2), reusing k2 if nothing else reads it */
+            if (insn->op == IR_ADD && uses[insn->b] == 1 &&
+                (inner = opt_plain(blk, insn->a, IR_ADD)) != NULL &&
+                opt_const(blk, inner->b, &k)) {
+                kb += k;
+                blk->insns[insn->b].imm = kb;
+                insn->a = inner->a;
+                stats->consts_folded++;
+            }
+            if ((kb == 0 && insn->op != IR_AND && insn->op != IR_MUL) ||
+                (kb == -1 && insn->op == IR_AND) || (kb == 1 && insn->op == IR_MUL)) {
+                opt_forward(blk, fwd, i, insn->a);
+                stats->consts_folded++;
+            } else if (kb == 0) {
+                opt_make_const(insn, 0);
+                stats->consts_folded++;
+            }
+            break;
+
+        case IR_NOT: case IR_NEG:
+            if (ca && opt_fold(insn, (uint64_t)ka, 0, &r)) {
+                opt_make_const(insn, r);
+                stats->consts_folded++;
+            }
+            break;
+
+        case IR_ZEXT: case IR_SEXT:
+            if (ca) {
+                opt_make_const(insn, insn->op == IR_ZEXT ?
+                               opt_trunc((uint64_t)ka, (unsigned)insn->imm) :
+                               (uint64_t)opt_sext((uint64_t)ka, (unsigned)insn->imm));
+                stats->consts_folded++;
+            } else if (insn->imm >= 8) {
+                opt_forward(blk, fwd, i, insn->a);
+                stats->consts_folded++;
+            }
+            break;
+
+        default:
+            break;
+        }
+    }
+}
+
+/* ============================================================================
+ * Copy Propagation and Redundant Loads
+ * ============================================================================ */
+
+void ir_opt_copy_prop(ir_block_t *blk, ir_opt_stats_t *stats)
+{
+    ir_ref_t fwd[IR_MAX_INSNS];
+    ir_ref_t written[OPT_MAX_GUEST_REGS];
+    ir_ref_t i;
+    int r;
+
+    opt_fwd_init(fwd, blk->count);
+    for (r = 0; r < OPT_MAX_GUEST_REGS; r++) {
+        written[r] = IR_NONE;
+    }
+
+    for (i = 0; i < blk->count; i++) {
+        ir_insn_t *insn = &blk->insns[i];
+
+        opt_rewrite(insn, fwd);
+        if (insn->op == IR_CALL) {
+            for (r = 0; r < OPT_MAX_GUEST_REGS; r++) {
+                written[r] = IR_NONE;
+            }
+        } else if (insn->reg < OPT_MAX_GUEST_REGS && insn->op == IR_SET_REG) {
+            written[insn->reg] = insn->a;
+        } else if (insn->reg < OPT_MAX_GUEST_REGS && insn->op == IR_GET_REG &&
+                   written[insn->reg] != IR_NONE) {
+            opt_forward(blk, fwd, i, written[insn->reg]);
+            stats->copies_propagated++;
+        }
+    }
+}
+
+typedef struct {
+    ir_ref_t a, index;
+    uint8_t shift, size;
+    int64_t disp;
+    ir_ref_t value;
+} opt_mem_entry_t;
+
+static int opt_same_addr(const opt_mem_entry_t *e, const ir_insn_t *insn)
+{
+    return e->a == insn->a && e->index == insn->index && e->shift == insn->shift &&
+           e->disp == insn->imm && e->size == insn->size;
+}
+
+void ir_opt_load_elim(ir_block_t *blk, ir_opt_stats_t *stats)
+{
+    ir_ref_t fwd[IR_MAX_INSNS];
+    ir_ref_t read[OPT_MAX_GUEST_REGS];
+    opt_mem_entry_t mem[OPT_MAX_MEM_ENTRIES];
+    int nmem = 0;
+    ir_ref_t i;
+    int r, j;
+
+    opt_fwd_init(fwd, blk->count);
+    for (r = 0; r < OPT_MAX_GUEST_REGS; r++) {
+        read[r] = IR_NONE;
+    }
+
+    for (i = 0; i < blk->count; i++) {
+        ir_insn_t *insn = &blk->insns[i];
+
+        opt_rewrite(insn, fwd);
+        switch (insn->op) {
+        case IR_CALL:
+            for (r = 0; r < OPT_MAX_GUEST_REGS; r++) {
+                read[r] = IR_NONE;
+            }
+            nmem = 0;
+            break;
+
+        case IR_GET_REG:
+            if (insn->reg >= OPT_MAX_GUEST_REGS) {
+                break;
+            }
+            if (read[insn->reg] != IR_NONE) {
+                opt_forward(blk, fwd, i, read[insn->reg]);
+                stats->loads_eliminated++;
+            } else {
+                read[insn->reg] = i;
+            }
+            break;
+
+        case IR_SET_REG:
+            if (insn->reg < OPT_MAX_GUEST_REGS) {
+                read[insn->reg] = IR_NONE;
+            }
+            break;
+
+        case IR_LOAD:
+            for (j = 0; j < nmem; j++) {
+                if (opt_same_addr(&mem[j], insn)) {
+                    break;
+                }
+            }
+            if (j < nmem) {
+                opt_forward(blk, fwd, i, mem[j].value);
+                stats->loads_eliminated++;
+            } else if (nmem < OPT_MAX_MEM_ENTRIES) {
+                opt_mem_entry_t e = { insn->a, insn->index, insn->shift, insn->size,
+                                      insn->imm, i };
+                mem[nmem++] = e;
+            }
+            break;
+
+        case IR_STORE:
+            /* Any store may alias; only a full-width store forwards its value,
+             * since loads zero-extend */
+            nmem = 0;
+            if (insn->size == 8) {
+                opt_mem_entry_t e = { insn->a, insn->index, insn->shift, insn->size,
+                                      insn->imm, insn->b };
+                mem[nmem++] = e;
+            }
+            break;
+
+        default:
+            break;
+        }
+    }
+}
+
+/* ============================================================================
+ * Dead Stores and Dead Code
+ * ============================================================================ */
+
+void ir_opt_dead_store(ir_block_t *blk, ir_opt_stats_t *stats)
+{
+    uint8_t needed[OPT_MAX_GUEST_REGS];
+    int i;
+
+    /* Every guest register is visible to the dispatcher at the exit */
+    memset(needed, 1, sizeof(needed));
+
+    for (i = (int)blk->count - 1; i >= 0; i--) {
+        ir_insn_t *insn = &blk->insns[i];
+
+        if (insn->op == IR_CALL) {
+            memset(needed, 1, sizeof(needed));
+        } else if (insn->op == IR_GET_REG && insn->reg < OPT_MAX_GUEST_REGS) {
+            needed[insn->reg] = 1;
+        } else if (insn->op == IR_SET_REG && insn->reg < OPT_MAX_GUEST_REGS) {
+            if (!needed[insn->reg]) {
+                insn->op = IR_NOP;
+                stats->dead_stores++;
+            }
+            needed[insn->reg] = 0;
+        }
+    }
+}
+
+void ir_opt_dce(ir_block_t *blk, ir_opt_stats_t *stats)
+{
+    uint8_t live[IR_MAX_INSNS];
+    int i;
+
+    memset(live, 0, sizeof(live));
+
+    for (i = (int)blk->count - 1; i >= 0; i--) {
+        ir_insn_t *insn = &blk->insns[i];
+        int essential;
+
+        switch (insn->op) {
+        case IR_NOP:
+            continue;
+        case IR_SET_REG: case IR_STORE: case IR_CALL: case IR_LOAD:
+        case IR_BR: case IR_BRCOND: case IR_BR_IND:
+            /* Loads stay: removing one would hide a guest fault */
+            essential = 1;
+            break;
+        default:
+            essential = live[i] || (ir_ref_t)i == blk->flags_ref;
+            break;
+        }
+
+        if (!essential) {
+            insn->op = IR_NOP;
+            stats->dead_insns++;
+            continue;
+        }
+        if (insn->a != IR_NONE) {
+            live[insn->a] = 1;
+        }
+        if (insn->b != IR_NONE) {
+            live[insn->b] = 1;
+        }
+        if (insn->index != IR_NONE) {
+            live[insn->index] = 1;
+        }
+    }
+}
+
+/* ============================================================================
+ * Address-Mode Folding
+ * ============================================================================ */
+
+void ir_opt_addr_fold(ir_block_t *blk, ir_opt_stats_t *stats)
+{
+    ir_ref_t i;
+
+    for (i = 0; i < blk->count; i++) {
+        ir_insn_t *insn = &blk->insns[i];
+        const ir_insn_t *add;
+
+        if (insn->op != IR_LOAD && insn->op != IR_STORE) {
+            continue;
+        }
+
+        while ((add = opt_plain(blk, insn->a, IR_ADD)) != NULL) {
+            const ir_insn_t *shl;
+            ir_ref_t base, idx;
+            int64_t k;
+
+            /* [x + k + disp] -> [x + (disp + k)] */
+            base = IR_NONE;
+            if (opt_const(blk, add->b, &k)) {
+                base = add->a;
+            } else if (opt_const(blk, add->a, &k)) {
+                base = add->b;
+            }
+            if (base != IR_NONE) {
+                int64_t disp = insn->imm + k;
+                if (disp < INT32_MIN || disp > INT32_MAX) {
+                    break;
+                }
+                insn->a = base;
+                insn->imm = disp;
+                stats->addrs_folded++;
+                continue;
+            }
+
+            /* [x + (y << s)] -> base x, index y, shift s */
+            if (insn->index != IR_NONE) {
+                break;
+            }
+            base = add->a;
+            idx = add->b;
+            if (opt_plain(blk, base, IR_SHL) && !opt_plain(blk, idx, IR_SHL)) {
+                base = add->b;
+                idx = add->a;
+            }
+            insn->a = base;
+            insn->index = idx;
+            insn->shift = 0;
+            if ((shl = opt_plain(blk, idx, IR_SHL)) != NULL &&
+                opt_const(blk, shl->b, &k) && k >= 0 && k <= 3) {
+                insn->index = shl->a;
+                insn->shift = (uint8_t)k;
+            }
+            stats->addrs_folded++;
+        }
+    }
+}
+
+/* ============================================================================
+ * CRC Fusion
+ * ============================================================================ */
+
+/*
+ * A CRC32X whose result only feeds the accumulator of the next CRC32X
+ * becomes an IR_CRC32_FOLD: the chain carries an unreduced 64-bit
+ * remainder and only its last step pays for the Barrett reduction.
+ * CRC32C is left alone; x86 hosts run each step as one instruction.
+ */
+void ir_opt_crc_fuse(ir_block_t *blk, ir_opt_stats_t *stats)
+{
+    uint16_t uses[IR_MAX_INSNS];
+    ir_ref_t i;
+
+    memset(uses, 0, sizeof(uses));
+    for (i = 0; i < blk->count; i++) {
+        const ir_insn_t *insn = &blk->insns[i];
+
+        if (insn->op == IR_NOP) {
+            continue;
+        }
+        if (insn->a != IR_NONE) {
+            uses[insn->a]++;
+        }
+        if (insn->b != IR_NONE) {
+            uses[insn->b]++;
+        }
+        if (insn->index != IR_NONE) {
+            uses[insn->index]++;
+        }
+    }
+
+    for (i = 0; i < blk->count; i++) {
+        const ir_insn_t *insn = &blk->insns[i];
+        ir_insn_t *prev;
+
+        if (insn->op != IR_CRC32 || insn->size != 8 || insn->imm != IR_CRC_IEEE) {
+            continue;
+        }
+        prev = &blk->insns[insn->a];
+        if (prev->op == IR_CRC32 && prev->size == 8 && prev->imm == IR_CRC_IEEE &&
+            uses[insn->a] == 1) {
+            prev->op = IR_CRC32_FOLD;
+            stats->crcs_fused++;
+        }
+    }
+}
+
+/* ============================================================================
+ * AES Round Fusion
+ * ============================================================================ */
+
+/* Guest round and mix steps and the host rounds they fuse into */
+typedef struct {
+    ir_aes_op_t round, mix, full, last;
+} opt_aes_dir_t;
+
+static const opt_aes_dir_t opt_aes_dirs[2] = {
+    { IR_AES_E, IR_AES_MC, IR_AES_ENC, IR_AES_ENCLAST },
+    { IR_AES_D, IR_AES_IMC, IR_AES_DEC, IR_AES_DECLAST },
+};
+
+static int opt_is_aes(const ir_block_t *blk, ir_ref_t v, ir_aes_op_t op, ir_ref_t a)
+{
+    return v != IR_NONE && blk->insns[v].op == IR_AES && blk->insns[v].imm == op &&
+           blk->insns[v].a == a;
+}
+
+/*
+ * ARM64 splits an AES round as AESE k (AddRoundKey, SubBytes, ShiftRows)
+ * then AESMC; AESENC k is SubBytes, ShiftRows, MixColumns, AddRoundKey.
+ * Moving each key to the round before maps
+ *
+ *   AESE k0; AESMC; AESE k1; AESMC; ... AESE kn-1; EOR kn
+ *
+ * onto XOR k0; AESENC k1; ... AESENC kn-1; AESENCLAST kn, one host
+ * instruction per guest pair, and AESD/AESIMC onto AESDEC the same way.
+ * Each link must be the only use of the one before. The first AESE
+ * becomes the XOR, later AESE slots the AESENCs and AESMC slots NOPs; a
+ * chain not closed by an EOR ends at its last AESMC, which becomes an
+ * AESENC with a zero key.
+ */
+void ir_opt_aes_fuse(ir_block_t *blk, ir_opt_stats_t *stats)
+{
+    uint16_t uses[IR_MAX_INSNS];
+    ir_ref_t user[IR_MAX_INSNS];
+    ir_ref_t i;
+
+    memset(uses, 0, sizeof(uses));
+    for (i = 0; i < blk->count; i++) {
+        const ir_insn_t *insn = &blk->insns[i];
+        ir_ref_t ops[3] = { insn->a, insn->b, insn->index };
+        int k;
+
+        if (insn->op == IR_NOP) {
+            continue;
+        }
+        for (k = 0; k < 3; k++) {
+            if (ops[k] != IR_NONE) {
+                uses[ops[k]]++;
+                user[ops[k]] = i;
+            }
+        }
+    }
+
+    for (i = 0; i < blk->count; i++) {
+        ir_insn_t *head = &blk->insns[i];
+        const opt_aes_dir_t *d;
+        ir_ref_t t, mix;
+
+        if (head->op != IR_AES || head->b == IR_NONE ||
+            (head->imm != IR_AES_E && head->imm != IR_AES_D)) {
+            continue;
+        }
+        d = &opt_aes_dirs[head->imm == IR_AES_D];
+        mix = user[i];
+        if (uses[i] != 1 || !opt_is_aes(blk, mix, d->mix, i)) {
+            continue;
+        }
+
+        /* t names the slot holding the state with the next key applied */
+        head->op = IR_XOR;
+        head->imm = 0;
+        t = i;
+        for (;;) {
+            ir_insn_t *m = &blk->insns[mix];
+            ir_ref_t rnd = uses[mix] == 1 ? user[mix] : IR_NONE;
+            ir_ref_t next;
+            ir_insn_t *r, *x;
+
+            stats->aes_rounds_fused++;
+            if (!opt_is_aes(blk, rnd, d->round, mix) || uses[rnd] != 1) {
+                m->imm = d->full;
+                m->a = t;
+                break;
+            }
+            r = &blk->insns[rnd];
+            next = user[rnd];
+            x = &blk->insns[next];
+            if (opt_is_aes(blk, next, d->mix, rnd)) {
+                r->imm = d->full;
+                r->a = t;
+                m->op = IR_NOP;
+                t = rnd;
+                mix = next;
+                continue;
+            }
+            if (x->op == IR_XOR && x->size == 16) {
+                x->op = IR_AES;
+                x->imm = d->last;
+                x->b = (x->a == rnd) ? x->b : x->a;
+                x->a = rnd;
+                r->imm = d->full;
+                r->a = t;
+                m->op = IR_NOP;
+            } else {
+                m->imm = d->full;
+                m->a = t;
+            }
+            break;
+        }
+    }
+}
+
+/* ============================================================================
+ * SHA-256 Round Sharing
+ * ============================================================================ */
+
+/*
+ * The front-end lowers SHA256H and SHA256H2 to the same packed rounds,
+ * differing only in which half they unpack (rosetta_ir.h). A guest round
+ * group is
+ *
+ *   MOV v2, v0; SHA256H q0, q1, wk; SHA256H2 q1, q2, wk
+ *
+ * so once copy propagation has run both instructions pack the same
+ * inputs and run the same rounds: repeated steps are forwarded to the
+ * first. The next group then packs the two halves it just unpacked,
+ * which is forwarded to the packed state, leaving two SHA256RNDS2 per
+ * four rounds and the unpacking only where a guest register needs it.
+ */
+void ir_opt_sha_fuse(ir_block_t *blk, ir_opt_stats_t *stats)
+{
+    ir_ref_t fwd[IR_MAX_INSNS];
+    ir_ref_t seen[IR_MAX_INSNS];
+    uint16_t nseen = 0;
+    ir_ref_t i;
+
+    opt_fwd_init(fwd, blk->count);
+
+    for (i = 0; i < blk->count; i++) {
+        ir_insn_t *insn = &blk->insns[i];
+        uint16_t j;
+
+        opt_rewrite(insn, fwd);
+        if (insn->op != IR_SHA) {
+            continue;
+        }
+
+        /* ABEF(ABCD(x, y), EFGH(x, y)) is x, CDGH of the same is y */
+        if (insn->imm == IR_SHA256_ABEF || insn->imm == IR_SHA256_CDGH) {
+            const ir_insn_t *lo = &blk->insns[insn->a];
+            const ir_insn_t *hi = &blk->insns[insn->b];
+
+            if (lo->op == IR_SHA && lo->imm == IR_SHA256_ABCD &&
+                hi->op == IR_SHA && hi->imm == IR_SHA256_EFGH &&
+                lo->a == hi->a && lo->b == hi->b) {
+                opt_forward(blk, fwd, i, insn->imm == IR_SHA256_ABEF ? lo->a : lo->b);
+                stats->sha_steps_merged++;
+                continue;
+            }
+        }
+
+        for (j = 0; j < nseen; j++) {
+            const ir_insn_t *prev = &blk->insns[seen[j]];
+
+            if (prev->imm == insn->imm && prev->a == insn->a && prev->b == insn->b &&
+                prev->index == insn->index) {
+                break;
+            }
+        }
+        if (j < nseen) {
+            opt_forward(blk, fwd, i, seen[j]);
+            stats->sha_steps_merged++;
+        } else {
+            seen[nseen++] = i;
+        }
+    }
+}
+
+/* ============================================================================
+ * Compaction and Driver
+ * ============================================================================ */
+
+void ir_opt_compact(ir_block_t *blk)
+{
+    ir_ref_t map[IR_MAX_INSNS];
+    ir_ref_t i, n = 0;
+
+    for (i = 0; i < blk->count; i++) {
+        ir_insn_t insn = blk->insns[i];
+
+        if (insn.op == IR_NOP) {
+            map[i] = IR_NONE;
+            continue;
+        }
+        map[i] = n;
+        if (insn.a != IR_NONE) {
+            insn.a = map[insn.a];
+        }
+        if (insn.b != IR_NONE) {
+            insn.b = map[insn.b];
+        }
+        if (insn.index != IR_NONE) {
+            insn.index = map[insn.index];
+        }
+        blk->insns[n++] = insn;
+    }
+
+    if (blk->flags_ref != IR_NONE) {
+        blk->flags_ref = map[blk->flags_ref];
+    }
+    blk->count = n;
+}
+
+int ir_optimize(ir_block_t *blk, uint32_t passes, ir_opt_stats_t *stats)
+{
+    ir_opt_stats_t local;
+
+    if (stats == NULL) {
+        memset(&local, 0, sizeof(local));
+        stats = &local;
+    }
+    if (ir_verify(blk) != 0) {
+        return -1;
+    }
+    stats->insns_in += blk->count;
+
+    /* Forwarding first exposes constants; folding exposes dead code */
+    if (passes & IR_OPT_COPY_PROP) {
+        ir_opt_copy_prop(blk, stats);
+    }
+    if (passes & IR_OPT_LOAD_ELIM) {
+        ir_opt_load_elim(blk, stats);
+    }
+    if (passes & IR_OPT_CONST_PROP) {
+        ir_opt_const_prop(blk, stats);
+    }
+    if (passes & IR_OPT_ADDR_FOLD) {
+        ir_opt_addr_fold(blk, stats);
+    }
+    if (passes & IR_OPT_DEAD_STORE) {
+        ir_opt_dead_store(blk, stats);
+    }
+    /* Needs the intermediate guest register writes gone */
+    if (passes & IR_OPT_CRC_FUSE) {
+        ir_opt_crc_fuse(blk, stats);
+    }
+    if (passes & IR_OPT_AES_FUSE) {
+        ir_opt_aes_fuse(blk, stats);
+    }
+    if (passes & IR_OPT_SHA_FUSE) {
+        ir_opt_sha_fuse(blk, stats);
+    }
+    if (passes & IR_OPT_DCE) {
+        ir_opt_dce(blk, stats);
+    }
+    ir_opt_compact(blk);
+
+    stats->insns_out += blk->count;
+    return ir_verify(blk) == 0 ? 0 : -1;
+}
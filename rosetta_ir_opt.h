@@ -0,0 +1,87 @@
+/* ============================================================================
+ * Rosetta Translator - IR Optimizer
+ * ============================================================================
+ *
+ * Block-local passes run between lowering and emission:
+ *
+ * - Constant propagation and folding
+ * - Copy propagation (guest register writes forwarded to later reads)
+ * - Redundant load elimination (repeated guest register and memory reads)
+ * - Dead store elimination to guest registers
+ * - Address-mode folding (base + index << scale + disp into LOAD/STORE)
+ * - CRC32X fusion (runs of 64-bit IEEE CRC steps folded, reduced once)
+ * - AES round fusion (AESE/AESMC pairs re-keyed into AESENC, likewise AESD)
+ * - SHA-256 round sharing (SHA256H/H2 pairs run once, state kept packed)
+ * - Dead code elimination
+ *
+ * Passes replace instructions with NOPs; ir_optimize() then compacts the
+ * block so the back-ends never see them and emitted code shrinks.
+ * ============================================================================ */
+
+#ifndef ROSETTA_IR_OPT_H
+#define ROSETTA_IR_OPT_H
+
+#include "rosetta_ir.h"
+#include <stdint.h>
+
+/* ============================================================================
+ * Pass Selection
+ * ============================================================================ */
+
+#define IR_OPT_CONST_PROP   0x0001  /* Constant propagation and folding */
+#define IR_OPT_COPY_PROP    0x0002  /* Copy propagation */
+#define IR_OPT_LOAD_ELIM    0x0004  /* Redundant load elimination */
+#define IR_OPT_DEAD_STORE   0x0008  /* Dead guest register stores */
+#define IR_OPT_ADDR_FOLD    0x0010  /* Address-mode folding */
+#define IR_OPT_DCE          0x0020  /* Dead code elimination */
+#define IR_OPT_CRC_FUSE     0x0040  /* CRC32X fusion */
+#define IR_OPT_AES_FUSE     0x0080  /* AES round fusion */
+#define IR_OPT_SHA_FUSE     0x0100  /* SHA-256 round sharing */
+#define IR_OPT_ALL          0x01FF
+
+/**
+ * Per-pass counters; passes add to them, so one struct can accumulate
+ * over many blocks
+ */
+typedef struct {
+    uint32_t consts_folded;     /* Instructions folded to constants or operands */
+    uint32_t copies_propagated; /* Guest register reads replaced by the written value */
+    uint32_t loads_eliminated;  /* Guest register and memory reads reused */
+    uint32_t dead_stores;       /* Guest register writes removed */
+    uint32_t addrs_folded;      /* Address computations folded into LOAD/STORE */
+    uint32_t dead_insns;        /* Unused instructions removed */
+    uint32_t crcs_fused;        /* CRC32X steps turned into folds */
+    uint32_t aes_rounds_fused;  /* AESE/AESMC or AESD/AESIMC pairs made one round */
+    uint32_t sha_steps_merged;  /* SHA steps repeated or undoing a repack, removed */
+    uint32_t insns_in;          /* Block sizes before and after */
+    uint32_t insns_out;
+} ir_opt_stats_t;
+
+/* ============================================================================
+ * Passes
+ * ============================================================================ */
+
+void ir_opt_const_prop(ir_block_t *blk, ir_opt_stats_t *stats);
+void ir_opt_copy_prop(ir_block_t *blk, ir_opt_stats_t *stats);
+void ir_opt_load_elim(ir_block_t *blk, ir_opt_stats_t *stats);
+void ir_opt_dead_store(ir_block_t *blk, ir_opt_stats_t *stats);
+void ir_opt_addr_fold(ir_block_t *blk, ir_opt_stats_t *stats);
+void ir_opt_crc_fuse(ir_block_t *blk, ir_opt_stats_t *stats);
+void ir_opt_aes_fuse(ir_block_t *blk, ir_opt_stats_t *stats);
+void ir_opt_sha_fuse(ir_block_t *blk, ir_opt_stats_t *stats);
+void ir_opt_dce(ir_block_t *blk, ir_opt_stats_t *stats);
+
+/**
+ * Remove NOPs and renumber value references
+ */
+void ir_opt_compact(ir_block_t *blk);
+
+/**
+ * Run the selected passes, then compact the block
+ * @param passes IR_OPT_* mask
+ * @param stats Counters to add to, may be NULL
+ * @return 0, or -1 if the block does not verify before or after
+ */
+int ir_optimize(ir_block_t *blk, uint32_t passes, ir_opt_stats_t *stats);
+
+#endif /* ROSETTA_IR_OPT_H */
@@ -0,0 +1,686 @@
+/* ============================================================================
+ * Rosetta Translator - IR to ARM64 Back-end
+ * ============================================================================
+ *
+ * Emits ARM64 for blocks lowered from x86_64. Guest registers stay pinned
+ * to X0-X15, so GET_REG is free and SET_REG is a move at most; values that
+ * must outlive a write to their home register are moved to a temporary
+ * first. Results feeding straight into a SET_REG are computed in place.
+ *
+ * Temporaries come from X19-X26. The block saves the ones it uses on entry
+ * and restores them at every exit. Guest memory is reached through the
+ * guest_mem_base in the rosetta_exec_context_t held in X18.
+ *
+ * Constants go through the immediate synthesizer in rosetta_arm64_emit.c;
+ * X17 is its cacheable scratch, and long constants land in a literal pool
+ * after the last exit.
+ *
+ * With blk->exec_counters set, the entry and each exit bump their counter
+ * with an LDR/ADD/STR through X16 and X17.
+ * ============================================================================ */
+
+#include "rosetta_ir.h"
+#include "rosetta_arm64_emit.h"
+#include "rosetta_exec_context.h"
+#include "rosetta_translate_mxcsr.h"
+#include <stddef.h>
+#include <string.h>
+
+#define A64_NOREG       0xFF
+#define A64_XZR         31
+#define A64_SCRATCH0    16
+#define A64_SCRATCH1    17
+#define A64_CTX         18
+#define A64_LR          30
+#define A64_TEMP_BASE   19
+#define A64_NUM_TEMPS   8       /* X19-X26 */
+
+#define A64_SF(size)    ((size) == 8 ? 0x80000000u : 0u)
+
+typedef struct {
+    const ir_block_t *blk;
+    code_buffer_t *buf;
+    ir_ref_t last_use[IR_MAX_INSNS];
+    uint8_t loc[IR_MAX_INSNS];          /* Host register holding each value */
+    uint8_t inline_const[IR_MAX_INSNS]; /* CONST encoded at each use */
+    uint8_t temp_busy;                  /* Bitmask over X19-X26 */
+    uint8_t temps_used;                 /* High-water mark */
+    uint8_t temps_saved;                /* Saved by the prologue (even) */
+    ir_ref_t flags_live;                /* Producer currently in NZCV */
+    arm64_imm_ctx_t imm;                /* Constant synthesizer state */
+    int error;
+} a64_ctx_t;
+
+/* x86 encoding order -> ThreadState.guest.r slot */
+static const uint8_t a64_guest_slot[16] = {
+    X86_RAX, X86_RCX, X86_RDX, X86_RBX, X86_RSP, X86_RBP, X86_RSI, X86_RDI,
+    X86_R8,  X86_R9,  X86_R10, X86_R11, X86_R12, X86_R13, X86_R14, X86_R15
+};
+
+/* ============================================================================
+ * Encoding Helpers
+ * ============================================================================ */
+
+static void a64_rrr(a64_ctx_t *c, uint32_t base, uint8_t size, uint8_t rd, uint8_t rn,
+                    uint8_t rm)
+{
+    emit_arm64_insn(c->buf, base | A64_SF(size) | ((uint32_t)rm << 16) |
+                    ((uint32_t)rn << 5) | rd);
+}
+
+static void a64_rri(a64_ctx_t *c, uint32_t base, uint8_t size, uint8_t rd, uint8_t rn,
+                    uint32_t imm12)
+{
+    emit_arm64_insn(c->buf, base | A64_SF(size) | (imm12 << 10) | ((uint32_t)rn << 5) | rd);
+}
+
+/* UBFM/SBFM with N tied to sf */
+static void a64_bfm(a64_ctx_t *c, int is_signed, uint8_t size, uint8_t rd, uint8_t rn,
+                    uint8_t immr, uint8_t imms)
+{
+    uint32_t insn = is_signed ? 0x13000000 : 0x53000000;
+
+    if (size == 8) {
+        insn |= 0x80400000;
+    }
+    emit_arm64_insn(c->buf, insn | ((uint32_t)immr << 16) | ((uint32_t)imms << 10) |
+                    ((uint32_t)rn << 5) | rd);
+}
+
+static void a64_mov_imm(a64_ctx_t *c, uint8_t rd, uint64_t value)
+{
+    arm64_imm_materialize(&c->imm, rd, value);
+}
+
+/* AND/ORR/EOR/ANDS with a bitmask immediate */
+static void a64_logical_imm(a64_ctx_t *c, uint32_t base, uint8_t size, uint8_t rd, uint8_t rn,
+                            uint64_t imm)
+{
+    uint32_t enc = 0;
+
+    arm64_encode_bitmask_imm(imm, size == 8, &enc);
+    emit_arm64_insn(c->buf, base | A64_SF(size) | enc | ((uint32_t)rn << 5) | rd);
+}
+
+/* rd = rn + imm for any imm, through the add/sub immediate forms when possible */
+static void a64_add_imm(a64_ctx_t *c, uint8_t rd, uint8_t rn, int64_t imm)
+{
+    if (imm >= 0 && imm < 4096) {
+        a64_rri(c, 0x11000000, 8, rd, rn, (uint32_t)imm);
+    } else if (imm < 0 && imm > -4096) {
+        a64_rri(c, 0x51000000, 8, rd, rn, (uint32_t)-imm);
+    } else {
+        a64_mov_imm(c, rd, (uint64_t)imm);
+        a64_rrr(c, 0x0B000000, 8, rd, rd, rn);
+    }
+    arm64_imm_invalidate(&c->imm, rd);
+}
+
+/* ============================================================================
+ * Value Locations
+ * ============================================================================ */
+
+static uint8_t a64_alloc(a64_ctx_t *c)
+{
+    int t;
+
+    for (t = 0; t < A64_NUM_TEMPS; t++) {
+        if (!(c->temp_busy & (1u << t))) {
+            c->temp_busy |= (uint8_t)(1u << t);
+            if (t + 1 > c->temps_used) {
+                c->temps_used = (uint8_t)(t + 1);
+            }
+            return (uint8_t)(A64_TEMP_BASE + t);
+        }
+    }
+    c->error = 1;
+    return A64_SCRATCH1;
+}
+
+static void a64_release(a64_ctx_t *c, ir_ref_t v, ir_ref_t at)
+{
+    uint8_t r;
+
+    if (v == IR_NONE || c->last_use[v] != at) {
+        return;
+    }
+    r = c->loc[v];
+    if (r >= A64_TEMP_BASE && r < A64_TEMP_BASE + A64_NUM_TEMPS) {
+        c->temp_busy &= (uint8_t)~(1u << (r - A64_TEMP_BASE));
+    }
+}
+
+/* Move values still needed after 'at' out of a guest home register */
+static void a64_evict(a64_ctx_t *c, uint8_t home, ir_ref_t at)
+{
+    ir_ref_t v;
+
+    for (v = 0; v < at; v++) {
+        if (c->loc[v] == home && c->last_use[v] != IR_NONE && c->last_use[v] > at) {
+            uint8_t t = a64_alloc(c);
+            a64_rrr(c, 0x2A0003E0, 8, t, 0, home);      /* MOV Xt, Xhome */
+            c->loc[v] = t;
+        }
+    }
+}
+
+/* Register for operand v; inline constants only reach here as zero */
+static uint8_t a64_reg(a64_ctx_t *c, ir_ref_t v)
+{
+    if (c->inline_const[v]) {
+        if (c->blk->insns[v].imm == 0) {
+            return A64_XZR;
+        }
+        a64_mov_imm(c, A64_SCRATCH1, (uint64_t)c->blk->insns[v].imm);
+        return A64_SCRATCH1;
+    }
+    return c->loc[v];
+}
+
+/* Destination for value i: its guest home if the next insn just stores it */
+static uint8_t a64_dst(a64_ctx_t *c, ir_ref_t i)
+{
+    const ir_block_t *blk = c->blk;
+
+    if (i + 1 < blk->count && blk->insns[i + 1].op == IR_SET_REG &&
+        blk->insns[i + 1].a == i && c->last_use[i] == i + 1 &&
+        blk->insns[i + 1].reg < IR_X86_NUM_REGS) {
+        uint8_t home = (uint8_t)blk->insns[i + 1].reg;
+        a64_evict(c, home, i);
+        return home;
+    }
+    return a64_alloc(c);
+}
+
+/* A CONST can be folded into every use as an immediate or XZR */
+static int a64_const_inlinable(const ir_block_t *blk, ir_ref_t v)
+{
+    int64_t k = blk->insns[v].imm;
+    uint32_t enc;
+    ir_ref_t i;
+
+    for (i = v + 1; i < blk->count; i++) {
+        const ir_insn_t *u = &blk->insns[i];
+
+        if ((u->a == v && u->op != IR_BRCOND && u->op != IR_SETCC) || u->index == v) {
+            return 0;
+        }
+        if (u->b != v) {
+            continue;
+        }
+        switch (u->op) {
+        case IR_SHL: case IR_SHR: case IR_SAR:
+            break;
+        case IR_ADD: case IR_SUB: case IR_CMP:
+            if (k <= -4096 || k >= 4096) {
+                return 0;
+            }
+            break;
+        case IR_AND: case IR_OR: case IR_XOR: case IR_TEST:
+            if (k != 0 && !arm64_encode_bitmask_imm((uint64_t)k, u->size == 8, &enc)) {
+                return 0;
+            }
+            break;
+        default:
+            if (k != 0) {
+                return 0;
+            }
+            break;
+        }
+    }
+    return 1;
+}
+
+/* ============================================================================
+ * ALU and Flags
+ * ============================================================================ */
+
+/* ARM64 condition for an IR condition after a producer of this kind */
+static uint8_t a64_cond(ir_flags_kind_t kind, ir_cond_t cond)
+{
+    static const uint8_t sub_map[IR_COND_COUNT] = {
+        COND_VS, COND_VC, COND_CC, COND_CS, COND_EQ, COND_NE, COND_LS, COND_HI,
+        COND_MI, COND_PL, COND_AL, COND_AL, COND_LT, COND_GE, COND_LE, COND_GT
+    };
+
+    if (kind == IR_FLAGS_SUB) {
+        return sub_map[cond];
+    }
+    switch (cond) {
+    case IR_COND_B:  return COND_CS;
+    case IR_COND_AE: return COND_CC;
+    case IR_COND_BE: return COND_EQ;    /* Logic ops clear carry */
+    case IR_COND_A:  return COND_NE;
+    default:         return sub_map[cond];
+    }
+}
+
+/* rd = a op b (or flags only when rd is XZR and set_flags) */
+static void a64_binop(a64_ctx_t *c, const ir_insn_t *insn, uint8_t rd, int set_flags)
+{
+    const ir_block_t *blk = c->blk;
+    uint8_t size = insn->size;
+    uint8_t ra = c->loc[insn->a];
+    ir_ref_t b = insn->b;
+    ir_op_t op = (ir_op_t)insn->op;
+
+    if (op == IR_ADD || op == IR_SUB || op == IR_CMP) {
+        int is_sub = (op != IR_ADD);
+
+        if (c->inline_const[b] && blk->insns[b].imm != 0) {
+            int64_t k = blk->insns[b].imm;
+            if (k < 0) {
+                k = -k;
+                is_sub = !is_sub;
+            }
+            a64_rri(c, (is_sub ? 0x51000000 : 0x11000000) | (set_flags ? 0x20000000 : 0),
+                    size, rd, ra, (uint32_t)k);
+        } else {
+            a64_rrr(c, (is_sub ? 0x4B000000 : 0x0B000000) | (set_flags ? 0x20000000 : 0),
+                    size, rd, ra, a64_reg(c, b));
+        }
+        return;
+    }
+
+    switch (op) {
+    case IR_AND:
+    case IR_TEST:
+        if (c->inline_const[b] && blk->insns[b].imm != 0) {
+            a64_logical_imm(c, set_flags ? 0x72000000 : 0x12000000, size, rd, ra,
+                            (uint64_t)blk->insns[b].imm);
+            return;
+        }
+        a64_rrr(c, set_flags ? 0x6A000000 : 0x0A000000, size, rd, ra, a64_reg(c, b));
+        return;
+    case IR_OR:
+    case IR_XOR:
+        if (rd == A64_XZR) {
+            rd = A64_SCRATCH0;
+        }
+        if (c->inline_const[b] && blk->insns[b].imm != 0) {
+            a64_logical_imm(c, op == IR_OR ? 0x32000000 : 0x52000000, size, rd, ra,
+                            (uint64_t)blk->insns[b].imm);
+        } else {
+            a64_rrr(c, op == IR_OR ? 0x2A000000 : 0x4A000000, size, rd, ra, a64_reg(c, b));
+        }
+        if (set_flags) {
+            a64_rrr(c, 0x6A000000, size, A64_XZR, rd, rd);     /* TST */
+        }
+        return;
+    case IR_MUL:
+        a64_rrr(c, 0x1B007C00, size, rd, ra, a64_reg(c, b));
+        return;
+    case IR_SHL:
+    case IR_SHR:
+    case IR_SAR:
+    {
+        uint8_t bits = (uint8_t)(size * 8);
+        uint8_t s = (uint8_t)(blk->insns[b].imm & (bits - 1));
+
+        if (op == IR_SHL) {
+            a64_bfm(c, 0, size, rd, ra, (uint8_t)((bits - s) & (bits - 1)),
+                    (uint8_t)(bits - 1 - s));
+        } else {
+            a64_bfm(c, op == IR_SAR, size, rd, ra, s, (uint8_t)(bits - 1));
+        }
+        return;
+    }
+    case IR_NEG:
+        a64_rrr(c, set_flags ? 0x6B000000 : 0x4B000000, size, rd, A64_XZR, ra);
+        return;
+    default:
+        c->error = 1;
+        return;
+    }
+}
+
+/* Make NZCV hold the flags of producer p, recomputing if clobbered */
+static void a64_flags(a64_ctx_t *c, ir_ref_t p)
+{
+    if (c->flags_live != p) {
+        a64_binop(c, &c->blk->insns[p], A64_XZR, 1);
+        c->flags_live = p;
+    }
+}
+
+/* ============================================================================
+ * Memory, Calls and Exits
+ * ============================================================================ */
+
+static void a64_mem(a64_ctx_t *c, const ir_insn_t *insn, uint8_t rt, int is_store)
+{
+    static const uint32_t ldr_reg[4] = { 0x38606800, 0x78606800, 0xB8606800, 0xF8606800 };
+    static const uint32_t str_reg[4] = { 0x38206800, 0x78206800, 0xB8206800, 0xF8206800 };
+    uint8_t sz = (uint8_t)(insn->size == 1 ? 0 : insn->size == 2 ? 1 : insn->size == 4 ? 2 : 3);
+    uint8_t addr = c->loc[insn->a];
+    uint8_t base = A64_SCRATCH0;
+    uint32_t scaled = 0;
+
+    /* X16 = guest_mem_base */
+    emit_ldr_uoff(c->buf, A64_SCRATCH0, A64_CTX,
+                  (uint32_t)offsetof(rosetta_exec_context_t, guest_mem_base));
+
+    if (insn->index != IR_NONE) {
+        uint8_t index = c->loc[insn->index];
+
+        if (insn->imm == 0 && (insn->shift == 0 || insn->shift == sz)) {
+            /* LDR Xt, [X17, Xm, LSL #s] with X17 = host address of the base */
+            a64_rrr(c, 0x0B000000, 8, A64_SCRATCH1, A64_SCRATCH0, addr);
+            arm64_imm_invalidate(&c->imm, A64_SCRATCH1);
+            base = A64_SCRATCH1;
+            addr = index;
+            scaled = insn->shift ? 0x1000 : 0;
+        } else {
+            a64_rrr(c, 0x0B000000 | ((uint32_t)insn->shift << 10), 8, A64_SCRATCH1, addr, index);
+            arm64_imm_invalidate(&c->imm, A64_SCRATCH1);
+            if (insn->imm != 0) {
+                a64_add_imm(c, A64_SCRATCH1, A64_SCRATCH1, insn->imm);
+            }
+            addr = A64_SCRATCH1;
+        }
+    } else if (insn->imm != 0) {
+        a64_add_imm(c, A64_SCRATCH1, addr, insn->imm);
+        addr = A64_SCRATCH1;
+    }
+    emit_arm64_insn(c->buf, (is_store ? str_reg[sz] : ldr_reg[sz]) | scaled |
+                    ((uint32_t)addr << 16) | ((uint32_t)base << 5) | rt);
+}
+
+static void a64_guest_regs(a64_ctx_t *c, int store)
+{
+    uint8_t host_of_slot[16];
+    int i;
+
+    for (i = 0; i < 16; i++) {
+        host_of_slot[a64_guest_slot[i]] = (uint8_t)i;
+    }
+    for (i = 0; i < 16; i += 2) {
+        int32_t off = (int32_t)offsetof(ThreadState, guest.r) + i * 8;
+        if (store) {
+            emit_stp_off(c->buf, host_of_slot[i], host_of_slot[i + 1], A64_SCRATCH0, off);
+        } else {
+            emit_ldp_off(c->buf, host_of_slot[i], host_of_slot[i + 1], A64_SCRATCH0, off);
+        }
+    }
+}
+
+static void a64_call(a64_ctx_t *c, uint64_t fn)
+{
+    const uint32_t state_off = (uint32_t)offsetof(rosetta_exec_context_t, state);
+
+    emit_stp_pre(c->buf, A64_CTX, A64_LR, 31, -16);
+    emit_push_q0_q15(c->buf);                   /* Guest XMM0-15 */
+    emit_ldr_uoff(c->buf, A64_SCRATCH0, A64_CTX, state_off);
+    a64_guest_regs(c, 1);
+    translate_mxcsr_emit_leave(c->buf, A64_SCRATCH0, 0, 1);
+
+    emit_mov_reg(c->buf, 0, A64_SCRATCH0);
+    a64_mov_imm(c, A64_SCRATCH1, fn);
+    emit_blr(c->buf, A64_SCRATCH1);
+    translate_mxcsr_emit_resume(c->buf);
+
+    emit_pop_q0_q15(c->buf);
+    emit_ldp_post(c->buf, A64_CTX, A64_LR, 31, 16);
+    emit_ldr_uoff(c->buf, A64_SCRATCH0, A64_CTX, state_off);
+    a64_guest_regs(c, 0);
+    c->flags_live = IR_NONE;
+    arm64_imm_invalidate(&c->imm, ARM64_IMM_ALL_REGS);
+}
+
+/* Non-atomic increment of a profiling counter; clobbers X16 and X17 */
+static void a64_count(a64_ctx_t *c, int slot)
+{
+    if (!c->blk->exec_counters) {
+        return;
+    }
+    a64_mov_imm(c, A64_SCRATCH0, (uint64_t)(uintptr_t)c->blk->exec_counters);
+    emit_ldr_uoff(c->buf, A64_SCRATCH1, A64_SCRATCH0, (uint32_t)slot * 8);
+    emit_add_imm(c->buf, A64_SCRATCH1, A64_SCRATCH1, 1);
+    emit_str_uoff(c->buf, A64_SCRATCH1, A64_SCRATCH0, (uint32_t)slot * 8);
+    arm64_imm_invalidate(&c->imm, A64_SCRATCH1);
+}
+
+/* Store the next guest pc, restore temporaries and return to the dispatcher */
+static void a64_exit(a64_ctx_t *c, uint8_t pc_reg, int slot)
+{
+    int t;
+
+    emit_ldr_uoff(c->buf, A64_SCRATCH0, A64_CTX,
+                  (uint32_t)offsetof(rosetta_exec_context_t, state));
+    emit_str_uoff(c->buf, pc_reg, A64_SCRATCH0, (uint32_t)offsetof(ThreadState, guest.rip));
+    a64_count(c, slot);
+    for (t = c->temps_saved - 2; t >= 0; t -= 2) {
+        emit_ldp_post(c->buf, (uint8_t)(A64_TEMP_BASE + t), (uint8_t)(A64_TEMP_BASE + t + 1),
+                      31, 16);
+    }
+    emit_ret(c->buf);
+}
+
+static void a64_exit_imm(a64_ctx_t *c, uint64_t target, int slot)
+{
+    a64_mov_imm(c, A64_SCRATCH1, target);
+    a64_exit(c, A64_SCRATCH1, slot);
+}
+
+/* ============================================================================
+ * Block Emission
+ * ============================================================================ */
+
+static void a64_insn(a64_ctx_t *c, ir_ref_t i)
+{
+    const ir_insn_t *insn = &c->blk->insns[i];
+    uint8_t rd;
+
+    switch (insn->op) {
+    case IR_NOP:
+        break;
+
+    case IR_CONST:
+        if (!c->inline_const[i] && c->last_use[i] != IR_NONE) {
+            c->loc[i] = a64_dst(c, i);
+            a64_mov_imm(c, c->loc[i], (uint64_t)insn->imm);
+        }
+        break;
+
+    case IR_GET_REG:
+        if (insn->reg >= IR_X86_NUM_REGS) {
+            c->error = 1;
+            break;
+        }
+        c->loc[i] = (uint8_t)insn->reg;
+        break;
+
+    case IR_SET_REG:
+        if (insn->reg >= IR_X86_NUM_REGS) {
+            c->error = 1;
+            break;
+        }
+        a64_evict(c, (uint8_t)insn->reg, i);
+        rd = a64_reg(c, insn->a);
+        if (rd != insn->reg) {
+            a64_rrr(c, 0x2A0003E0, 8, (uint8_t)insn->reg, 0, rd);
+        }
+        break;
+
+    case IR_ADD: case IR_SUB: case IR_AND: case IR_OR: case IR_XOR:
+    case IR_SHL: case IR_SHR: case IR_SAR: case IR_MUL: case IR_NEG:
+        if (insn->size < 4) {
+            c->error = 1;
+            break;
+        }
+        rd = a64_dst(c, i);
+        a64_binop(c, insn, rd, insn->flags & IR_F_FLAGS);
+        c->loc[i] = rd;
+        if (insn->flags & IR_F_FLAGS) {
+            c->flags_live = i;
+        }
+        break;
+
+    case IR_NOT:
+        if (insn->size < 4) {
+            c->error = 1;
+            break;
+        }
+        rd = a64_dst(c, i);
+        a64_rrr(c, 0x2A200000, insn->size, rd, A64_XZR, c->loc[insn->a]);  /* ORN */
+        c->loc[i] = rd;
+        break;
+
+    case IR_ZEXT:
+    case IR_SEXT:
+    {
+        static const uint8_t imms[5] = { 0, 7, 15, 0, 31 };
+        uint8_t from = (uint8_t)insn->imm;
+        uint8_t src = c->loc[insn->a];
+
+        rd = a64_dst(c, i);
+        if (from >= 8) {
+            a64_rrr(c, 0x2A0003E0, 8, rd, 0, src);
+        } else if (insn->op == IR_ZEXT && from == 4) {
+            a64_rrr(c, 0x2A0003E0, 4, rd, 0, src);              /* MOV Wd, Wn */
+        } else if (from == 1 || from == 2 || from == 4) {
+            a64_bfm(c, insn->op == IR_SEXT, insn->op == IR_SEXT ? 8 : 4, rd, src, 0,
+                    imms[from]);
+        } else {
+            c->error = 1;
+        }
+        c->loc[i] = rd;
+        break;
+    }
+
+    case IR_LOAD:
+        rd = a64_dst(c, i);
+        a64_mem(c, insn, rd, 0);
+        c->loc[i] = rd;
+        break;
+
+    case IR_STORE:
+        a64_mem(c, insn, a64_reg(c, insn->b), 1);
+        break;
+
+    case IR_CMP:
+    case IR_TEST:
+        a64_binop(c, insn, A64_XZR, 1);
+        c->flags_live = i;
+        break;
+
+    case IR_SETCC:
+        a64_flags(c, insn->a);
+        rd = a64_dst(c, i);
+        emit_arm64_insn(c->buf, 0x9A9F07E0 |
+                        ((uint32_t)(a64_cond(ir_flags_kind(c->blk, insn->a),
+                                             (ir_cond_t)insn->cond) ^ 1) << 12) | rd);
+        c->loc[i] = rd;
+        break;
+
+    case IR_CALL:
+        a64_call(c, (uint64_t)insn->imm);
+        break;
+
+    case IR_BR:
+        a64_exit_imm(c, (uint64_t)insn->imm, IR_PROF_TAKEN);
+        break;
+
+    case IR_BR_IND:
+        a64_exit(c, c->loc[insn->a], IR_PROF_TAKEN);
+        break;
+
+    case IR_BRCOND:
+    {
+        uint8_t cond = a64_cond(ir_flags_kind(c->blk, insn->a), (ir_cond_t)insn->cond);
+        uint32_t at, cached = c->imm.valid;
+        uint64_t scratch = c->imm.reg_value[A64_SCRATCH1];
+
+        a64_flags(c, insn->a);
+        at = c->buf->offset;
+        emit_arm64_insn(c->buf, 0x54000000 | (cond ^ 1));      /* B.!cond fall-through */
+        a64_exit_imm(c, (uint64_t)insn->imm, IR_PROF_TAKEN);
+        if (!c->buf->error) {
+            uint32_t word = 0x54000000 | (((c->buf->offset - at) >> 2) & 0x7FFFF) << 5 |
+                            (cond ^ 1);
+            memcpy(c->buf->buffer + at, &word, 4);
+        }
+        /* The fall-through path sees the registers as they were at the branch */
+        c->imm.valid = cached;
+        c->imm.reg_value[A64_SCRATCH1] = scratch;
+        a64_exit_imm(c, insn->imm2, IR_PROF_FALLTHROUGH);
+        break;
+    }
+
+    default:
+        c->error = 1;
+        break;
+    }
+
+    /* Free temporaries whose last use was this instruction */
+    a64_release(c, insn->a, i);
+    a64_release(c, insn->b, i);
+    a64_release(c, insn->index, i);
+    if ((insn->op == IR_BRCOND || insn->op == IR_SETCC) && insn->a != IR_NONE) {
+        a64_release(c, c->blk->insns[insn->a].a, i);
+        a64_release(c, c->blk->insns[insn->a].b, i);
+    }
+    if (ir_op_has_value((ir_op_t)insn->op) && c->last_use[i] == IR_NONE) {
+        c->last_use[i] = i;
+        a64_release(c, i, i);
+    }
+}
+
+static int a64_emit_body(a64_ctx_t *c)
+{
+    ir_ref_t i;
+    int t;
+
+    c->temp_busy = 0;
+    c->temps_used = 0;
+    c->flags_live = IR_NONE;
+    c->error = 0;
+    ir_compute_last_use(c->blk, c->last_use);
+    memset(c->loc, A64_NOREG, sizeof(c->loc));
+    arm64_imm_init(&c->imm, c->buf, c->blk->host_code_base, 1u << A64_SCRATCH1);
+
+    for (t = 0; t < c->temps_saved; t += 2) {
+        emit_stp_pre(c->buf, (uint8_t)(A64_TEMP_BASE + t), (uint8_t)(A64_TEMP_BASE + t + 1),
+                     31, -16);
+    }
+    a64_count(c, IR_PROF_ENTRY);
+    for (i = 0; i < c->blk->count && !c->error; i++) {
+        a64_insn(c, i);
+    }
+    if (arm64_imm_flush_pool(&c->imm) != 0) {
+        c->error = 1;
+    }
+    return c->error ? -1 : 0;
+}
+
+int ir_emit_arm64(const ir_block_t *blk, code_buffer_t *buf)
+{
+    static _Thread_local a64_ctx_t ctx;
+    code_buffer_t sizing;
+    ir_ref_t i;
+
+    if (ir_verify(blk) != 0 || blk->count == 0 ||
+        !ir_op_is_exit((ir_op_t)blk->insns[blk->count - 1].op)) {
+        return -1;
+    }
+
+    ctx.blk = blk;
+    for (i = 0; i < blk->count; i++) {
+        ctx.inline_const[i] = blk->insns[i].op == IR_CONST && a64_const_inlinable(blk, i);
+    }
+
+    /* Sizing pass: find how many temporaries the prologue must save */
+    memset(&sizing, 0, sizeof(sizing));
+    ctx.buf = &sizing;
+    ctx.temps_saved = 0;
+    if (a64_emit_body(&ctx) != 0) {
+        return -1;
+    }
+
+    ctx.buf = buf;
+    ctx.temps_saved = (uint8_t)((ctx.temps_used + 1) & ~1);
+    if (a64_emit_body(&ctx) != 0 || buf->error) {
+        return -1;
+    }
+    return 0;
+}
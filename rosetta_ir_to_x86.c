@@ -0,0 +1,1077 @@
+/* ============================================================================
+ * Rosetta Translator - IR to x86_64 Back-end
+ * ============================================================================
+ *
+ * Emits x86_64 for blocks lowered from ARM64. The block runs as
+ * fn(ThreadState *) with the state pointer in RBX. Guest registers are
+ * assigned to RBP and R12-R15 by the linear-scan allocator: each is loaded
+ * on its first read and written back to ThreadState.host only at exits and
+ * around helper calls. Registers the allocator spills are accessed in
+ * ThreadState directly. Guest addresses are identity-mapped, as on the
+ * direct ARM64 -> x86_64 path.
+ *
+ * Flags live in EFLAGS. The IR uses x86 condition numbering, so BRCOND and
+ * SETCC map straight onto Jcc/SETcc. Exits write the guest NZCV back to
+ * host.pstate when the block left a flags producer behind.
+ *
+ * With blk->exec_counters set, the entry and each exit bump their counter
+ * through R11 after the guest flags have been written back.
+ *
+ * Vector values live in XMM3-XMM11 and guest vector registers are
+ * allocated to XMM12-XMM15 the same way; a block that needs more vector
+ * values is emitted again with XMM3-XMM15 for values and no vector
+ * caching. XMM registers are caller-saved, so a helper call also drops
+ * cached vectors and they are reloaded on their next read. Vector
+ * registers the allocator spills are accessed in ThreadState.host.v at
+ * each GET_REG/SET_REG. XMM0-XMM2 are scratch. Ops without a lowering
+ * here (CRC32, AES, SHA, PMULL) go to the one registered with
+ * ir_x86_set_lowering(), see rosetta_ir_to_x86.h.
+ *
+ * The encoders here are local because they need REX prefixes for R8-R15
+ * and for the low byte of RSI/RDI, which the shared x86 emitter omits.
+ * ============================================================================ */
+
+#include "rosetta_ir_to_x86.h"
+#include <stddef.h>
+#include <string.h>
+
+#define X64_NUM_TEMPS   7
+
+/* Caller-saved registers handed out to IR values */
+static const uint8_t x64_temps[X64_NUM_TEMPS] = { 0, 1, 2, 6, 7, 8, 9 };
+
+/* XMM registers handed out to vector values; XMM0-XMM2 are scratch */
+#define X64_XMM_FIRST   3
+#define X64_XMM_COUNT   13
+
+/* Callee-saved registers for guest registers, so they survive helper calls */
+#define X64_NUM_GUEST   5
+static const uint8_t x64_guest_pool[X64_NUM_GUEST] = { 5, 12, 13, 14, 15 };
+
+/* XMM registers for guest vector registers, taken from the top of the values' */
+#define X64_NUM_GUEST_VEC   4
+static const uint8_t x64_guest_xmm_pool[X64_NUM_GUEST_VEC] = { 12, 13, 14, 15 };
+
+/* Lowerings registered for the ops below without a case in x64_insn() */
+static x64_lower_fn x64_lowerings[IR_OP_COUNT];
+
+/* ============================================================================
+ * Encoding Helpers
+ * ============================================================================ */
+
+void x64_byte(x64_ctx_t *c, uint8_t b)
+{
+    code_buf_emit_byte(c->buf, b);
+}
+
+static void x64_imm32(x64_ctx_t *c, int32_t v)
+{
+    code_buf_emit_word32(c->buf, (uint32_t)v);
+}
+
+static int x64_fits32(int64_t v)
+{
+    return v >= INT32_MIN && v <= INT32_MAX;
+}
+
+/* REX when needed; force for byte access to SPL/BPL/SIL/DIL */
+static void x64_rex(x64_ctx_t *c, int w, uint8_t reg, uint8_t index, uint8_t base, int force)
+{
+    uint8_t rex = (uint8_t)(0x40 | (w ? 8 : 0) | ((reg >> 3) << 2) | ((index >> 3) << 1) |
+                            (base >> 3));
+    if (rex != 0x40 || force) {
+        x64_byte(c, rex);
+    }
+}
+
+/* opcode with ModRM register-direct form: reg field and rm field */
+void x64_rr(x64_ctx_t *c, int w, const uint8_t *op, int oplen, uint8_t reg, uint8_t rm,
+            int byte_regs)
+{
+    int i;
+
+    x64_rex(c, w, reg, 0, rm, byte_regs && (reg >= 4 || rm >= 4));
+    for (i = 0; i < oplen; i++) {
+        x64_byte(c, op[i]);
+    }
+    x64_byte(c, (uint8_t)(0xC0 | ((reg & 7) << 3) | (rm & 7)));
+}
+
+static x64_mem_t x64_at(uint8_t base, int32_t disp)
+{
+    x64_mem_t m = { base, X64_NOREG, 0, disp };
+    return m;
+}
+
+/* opcode with a memory operand */
+void x64_rm(x64_ctx_t *c, int w, const uint8_t *op, int oplen, uint8_t reg, x64_mem_t m,
+            int byte_reg)
+{
+    int32_t disp = m.disp;
+    uint8_t mod = (disp == 0 && (m.base & 7) != 5) ? 0 : (disp >= -128 && disp <= 127) ? 1 : 2;
+    uint8_t index = (m.index == X64_NOREG) ? 0 : m.index;
+    int i;
+
+    x64_rex(c, w, reg, index, m.base, byte_reg && reg >= 4);
+    for (i = 0; i < oplen; i++) {
+        x64_byte(c, op[i]);
+    }
+    if (m.index != X64_NOREG) {
+        x64_byte(c, (uint8_t)((mod << 6) | ((reg & 7) << 3) | 4));
+        x64_byte(c, (uint8_t)((m.shift << 6) | ((index & 7) << 3) | (m.base & 7)));
+    } else {
+        x64_byte(c, (uint8_t)((mod << 6) | ((reg & 7) << 3) | (m.base & 7)));
+        if ((m.base & 7) == 4) {
+            x64_byte(c, 0x24);                          /* SIB: base only */
+        }
+    }
+    if (mod == 1) {
+        x64_byte(c, (uint8_t)disp);
+    } else if (mod == 2) {
+        x64_imm32(c, disp);
+    }
+}
+
+void x64_mov_rr(x64_ctx_t *c, int w, uint8_t dst, uint8_t src)
+{
+    static const uint8_t op = 0x89;
+    x64_rr(c, w, &op, 1, src, dst, 0);
+}
+
+void x64_mov_imm(x64_ctx_t *c, uint8_t dst, int64_t v)
+{
+    if ((uint64_t)v <= 0xFFFFFFFFu) {
+        x64_rex(c, 0, 0, 0, dst, 0);
+        x64_byte(c, (uint8_t)(0xB8 + (dst & 7)));       /* MOV r32, imm32 */
+        x64_imm32(c, (int32_t)v);
+    } else if (x64_fits32(v)) {
+        static const uint8_t op = 0xC7;
+        x64_rr(c, 1, &op, 1, 0, dst, 0);                /* MOV r/m64, simm32 */
+        x64_imm32(c, (int32_t)v);
+    } else {
+        x64_rex(c, 1, 0, 0, dst, 0);
+        x64_byte(c, (uint8_t)(0xB8 + (dst & 7)));       /* MOVABS */
+        code_buf_emit_word64(c->buf, (uint64_t)v);
+    }
+}
+
+static void x64_load(x64_ctx_t *c, uint8_t size, uint8_t dst, x64_mem_t m)
+{
+    static const uint8_t mov[1] = { 0x8B };
+    static const uint8_t movzx8[2] = { 0x0F, 0xB6 };
+    static const uint8_t movzx16[2] = { 0x0F, 0xB7 };
+
+    switch (size) {
+    case 1:  x64_rm(c, 0, movzx8, 2, dst, m, 0); break;
+    case 2:  x64_rm(c, 0, movzx16, 2, dst, m, 0); break;
+    case 4:  x64_rm(c, 0, mov, 1, dst, m, 0); break;
+    default: x64_rm(c, 1, mov, 1, dst, m, 0); break;
+    }
+}
+
+static void x64_store(x64_ctx_t *c, uint8_t size, uint8_t src, x64_mem_t m)
+{
+    static const uint8_t mov8[1] = { 0x88 };
+    static const uint8_t mov[1] = { 0x89 };
+
+    switch (size) {
+    case 1:  x64_rm(c, 0, mov8, 1, src, m, 1); break;
+    case 2:  x64_byte(c, 0x66); x64_rm(c, 0, mov, 1, src, m, 0); break;
+    case 4:  x64_rm(c, 0, mov, 1, src, m, 0); break;
+    default: x64_rm(c, 1, mov, 1, src, m, 0); break;
+    }
+}
+
+/* ============================================================================
+ * Guest State and Value Locations
+ * ============================================================================ */
+
+static int32_t x64_guest_off(uint16_t reg)
+{
+    return ra_spill_slot(RA_CLASS_GPR, (uint8_t)reg);
+}
+
+/* Host register caching a guest register, X64_NOREG if it is spilled */
+static uint8_t x64_cached(const x64_ctx_t *c, uint16_t reg)
+{
+    uint8_t h = c->ra.host_of[reg];
+    return h == RA_SPILLED ? X64_NOREG : h;
+}
+
+/* XMM register caching a guest vector register, X64_NOREG if it is spilled */
+static uint8_t x64_vcached(const x64_ctx_t *c, uint16_t reg)
+{
+    uint8_t h = c->vra.host_of[reg - IR_ARM64_V0];
+    return h == RA_SPILLED ? X64_NOREG : h;
+}
+
+static int32_t x64_vguest_off(uint16_t reg)
+{
+    return ra_spill_slot(RA_CLASS_VEC, (uint8_t)(reg - IR_ARM64_V0));
+}
+
+static int x64_is_temp(uint8_t r)
+{
+    int t;
+
+    for (t = 0; t < X64_NUM_TEMPS; t++) {
+        if (x64_temps[t] == r) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+uint8_t x64_alloc(x64_ctx_t *c)
+{
+    int t;
+
+    for (t = 0; t < X64_NUM_TEMPS; t++) {
+        if (!(c->temp_busy & (1u << t))) {
+            c->temp_busy |= (uint8_t)(1u << t);
+            return x64_temps[t];
+        }
+    }
+    c->error = 1;
+    return X64_R11;
+}
+
+void x64_free(x64_ctx_t *c, uint8_t r)
+{
+    int t;
+
+    for (t = 0; t < X64_NUM_TEMPS; t++) {
+        if (x64_temps[t] == r) {
+            c->temp_busy &= (uint8_t)~(1u << t);
+        }
+    }
+}
+
+uint8_t x64_xmm_alloc(x64_ctx_t *c)
+{
+    int t;
+
+    for (t = 0; t < c->xmm_count; t++) {
+        if (!(c->xmm_busy & (1u << t))) {
+            c->xmm_busy |= (uint16_t)(1u << t);
+            return (uint8_t)(X64_XMM_FIRST + t);
+        }
+    }
+    c->error = 1;
+    c->xmm_short = 1;
+    return X64_XMM_FIRST;
+}
+
+static int x64_is_vec(const x64_ctx_t *c, ir_ref_t v)
+{
+    return c->blk->insns[v].size == 16;
+}
+
+/* Is r an XMM register handed out to vector values? */
+static int x64_is_vtemp(const x64_ctx_t *c, uint8_t r)
+{
+    return r >= X64_XMM_FIRST && r < X64_XMM_FIRST + c->xmm_count;
+}
+
+static void x64_release(x64_ctx_t *c, ir_ref_t v, ir_ref_t at)
+{
+    if (v == IR_NONE || c->last_use[v] != at || c->loc[v] == X64_NOREG) {
+        return;
+    }
+    if (x64_is_vec(c, v)) {
+        if (x64_is_vtemp(c, c->loc[v])) {
+            c->xmm_busy &= (uint16_t)~(1u << (c->loc[v] - X64_XMM_FIRST));
+        }
+    } else {
+        x64_free(c, c->loc[v]);
+    }
+    c->loc[v] = X64_NOREG;
+}
+
+uint8_t x64_alloc(x64_ctx_t *c);
+
+/* Move values still needed after 'at' out of a guest register's host register */
+static void x64_evict(x64_ctx_t *c, uint8_t host, ir_ref_t at)
+{
+    ir_ref_t v;
+
+    for (v = 0; v < at; v++) {
+        if (c->loc[v] == host && !x64_is_vec(c, v) &&
+            c->last_use[v] != IR_NONE && c->last_use[v] > at) {
+            uint8_t t = x64_alloc(c);
+            x64_mov_rr(c, 1, t, host);
+            c->loc[v] = t;
+        }
+    }
+}
+
+/* The same for vector values in a guest vector register's XMM register */
+static void x64_evict_vec(x64_ctx_t *c, uint8_t host, ir_ref_t at)
+{
+    ir_ref_t v;
+
+    for (v = 0; v < at; v++) {
+        if (c->loc[v] == host && x64_is_vec(c, v) &&
+            c->last_use[v] != IR_NONE && c->last_use[v] > at) {
+            uint8_t t = x64_xmm_alloc(c);
+            x64_movdqa(c, t, host);
+            c->loc[v] = t;
+        }
+    }
+}
+
+static void x64_movdqu(x64_ctx_t *c, int store, uint8_t xmm, x64_mem_t m);
+
+/* Store dirty cached guest registers back to ThreadState; exits keep the
+ * dirty set since a conditional exit emits a second path after this one */
+static void x64_writeback(x64_ctx_t *c, int clean)
+{
+    int i;
+
+    for (i = 0; i < c->ra.count; i++) {
+        const ra_interval_t *iv = &c->ra.intervals[i];
+        if (iv->host != RA_SPILLED && (c->dirty & (1u << iv->guest))) {
+            x64_store(c, 8, iv->host, x64_at(X64_RBX, x64_guest_off(iv->guest)));
+        }
+    }
+    for (i = 0; i < c->vra.count; i++) {
+        const ra_interval_t *iv = &c->vra.intervals[i];
+        if (iv->host != RA_SPILLED && (c->vdirty & (1u << iv->guest))) {
+            x64_movdqu(c, 1, iv->host, x64_at(X64_RBX, ra_spill_slot(RA_CLASS_VEC, iv->guest)));
+        }
+    }
+    if (clean) {
+        c->dirty = 0;
+        c->vdirty = 0;
+    }
+}
+
+/* Register for operand v, materializing inline constants into R10 */
+uint8_t x64_reg(x64_ctx_t *c, ir_ref_t v)
+{
+    if (c->inline_const[v]) {
+        x64_mov_imm(c, X64_R10, c->blk->insns[v].imm);
+        return X64_R10;
+    }
+    return c->loc[v];
+}
+
+/* Result register for i: the guest register it is stored to next, or
+ * operand a's temporary if this is its last use */
+uint8_t x64_dst(x64_ctx_t *c, ir_ref_t i, ir_ref_t a, int w)
+{
+    const ir_block_t *blk = c->blk;
+    ir_ref_t b = blk->insns[i].b;
+    uint8_t r;
+
+    if (i + 1 < blk->count && blk->insns[i + 1].op == IR_SET_REG &&
+        blk->insns[i + 1].a == i && c->last_use[i] == i + 1 &&
+        blk->insns[i + 1].reg < IR_ARM64_NUM_REGS &&
+        (r = x64_cached(c, blk->insns[i + 1].reg)) != X64_NOREG &&
+        (b == IR_NONE || c->inline_const[b] || c->loc[b] != r || c->last_use[b] > i)) {
+        x64_evict(c, r, i);
+        if (a != IR_NONE && x64_reg(c, a) != r) {
+            x64_mov_rr(c, w, r, x64_reg(c, a));
+        }
+        return r;
+    }
+
+    if (a != IR_NONE && !c->inline_const[a] && c->last_use[a] == i &&
+        x64_is_temp(c->loc[a]) && b != a) {
+        r = c->loc[a];
+        c->loc[a] = X64_NOREG;
+        return r;
+    }
+    r = x64_alloc(c);
+    if (a != IR_NONE) {
+        x64_mov_rr(c, w, r, x64_reg(c, a));
+    }
+    return r;
+}
+
+/* A CONST can be encoded as an imm32 at every use */
+static int x64_const_inlinable(const ir_block_t *blk, ir_ref_t v)
+{
+    ir_ref_t i;
+
+    if (!x64_fits32(blk->insns[v].imm)) {
+        return 0;
+    }
+    for (i = v + 1; i < blk->count; i++) {
+        const ir_insn_t *u = &blk->insns[i];
+
+        if (u->op == IR_BRCOND || u->op == IR_SETCC) {
+            continue;
+        }
+        if (u->a == v || u->index == v) {
+            return 0;
+        }
+        if (u->b == v) {
+            switch (u->op) {
+            case IR_ADD: case IR_SUB: case IR_AND: case IR_OR: case IR_XOR:
+            case IR_CMP: case IR_TEST: case IR_SHL: case IR_SHR: case IR_SAR:
+                break;
+            default:
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+/* ============================================================================
+ * ALU and Flags
+ * ============================================================================ */
+
+/* dst op= b for the two-operand ALU forms */
+static void x64_alu(x64_ctx_t *c, ir_op_t op, uint8_t size, uint8_t dst, ir_ref_t b)
+{
+    static const uint8_t rr_op[IR_OP_COUNT] = {
+        [IR_ADD] = 0x01, [IR_SUB] = 0x29, [IR_AND] = 0x21, [IR_OR] = 0x09,
+        [IR_XOR] = 0x31, [IR_CMP] = 0x39, [IR_TEST] = 0x85
+    };
+    static const uint8_t imm_ext[IR_OP_COUNT] = {
+        [IR_ADD] = 0, [IR_SUB] = 5, [IR_AND] = 4, [IR_OR] = 1, [IR_XOR] = 6, [IR_CMP] = 7
+    };
+    static const uint8_t shift_ext[IR_OP_COUNT] = {
+        [IR_SHL] = 4, [IR_SHR] = 5, [IR_SAR] = 7
+    };
+    int w = (size == 8);
+
+    if (op == IR_SHL || op == IR_SHR || op == IR_SAR) {
+        static const uint8_t opc = 0xC1;
+        x64_rr(c, w, &opc, 1, shift_ext[op], dst, 0);
+        x64_byte(c, (uint8_t)(c->blk->insns[b].imm & (size * 8 - 1)));
+        return;
+    }
+    if (op == IR_MUL) {
+        static const uint8_t imul[2] = { 0x0F, 0xAF };
+        x64_rr(c, w, imul, 2, dst, x64_reg(c, b), 0);
+        return;
+    }
+
+    if (c->inline_const[b]) {
+        int32_t k = (int32_t)c->blk->insns[b].imm;
+
+        if (op == IR_TEST) {
+            static const uint8_t opc = 0xF7;
+            x64_rr(c, w, &opc, 1, 0, dst, 0);
+            x64_imm32(c, k);
+        } else if (k >= -128 && k <= 127) {
+            static const uint8_t opc = 0x83;
+            x64_rr(c, w, &opc, 1, imm_ext[op], dst, 0);
+            x64_byte(c, (uint8_t)k);
+        } else {
+            static const uint8_t opc = 0x81;
+            x64_rr(c, w, &opc, 1, imm_ext[op], dst, 0);
+            x64_imm32(c, k);
+        }
+        return;
+    }
+    x64_rr(c, w, &rr_op[op], 1, x64_reg(c, b), dst, 0);
+}
+
+/* Make EFLAGS hold the flags of producer p, recomputing into R11 if clobbered */
+static void x64_flags(x64_ctx_t *c, ir_ref_t p)
+{
+    const ir_insn_t *insn = &c->blk->insns[p];
+    int w = (insn->size == 8);
+
+    if (c->flags_live == p) {
+        return;
+    }
+    switch (insn->op) {
+    case IR_CMP:
+    case IR_SUB:
+        x64_alu(c, IR_CMP, insn->size, c->loc[insn->a], insn->b);
+        break;
+    case IR_TEST:
+    case IR_AND:
+        x64_alu(c, IR_TEST, insn->size, c->loc[insn->a], insn->b);
+        break;
+    case IR_NEG:
+    {
+        static const uint8_t opc = 0xF7;
+        x64_mov_rr(c, w, X64_R11, c->loc[insn->a]);
+        x64_rr(c, w, &opc, 1, 3, X64_R11, 0);
+        break;
+    }
+    default:
+        x64_mov_rr(c, w, X64_R11, c->loc[insn->a]);
+        x64_alu(c, (ir_op_t)insn->op, insn->size, X64_R11, insn->b);
+        break;
+    }
+    c->flags_live = p;
+}
+
+/* ============================================================================
+ * Exits
+ * ============================================================================ */
+
+static void x64_setcc(x64_ctx_t *c, uint8_t cc, uint8_t dst)
+{
+    uint8_t setcc[2] = { 0x0F, (uint8_t)(0x90 + cc) };
+    static const uint8_t movzx8[2] = { 0x0F, 0xB6 };
+
+    x64_rr(c, 0, setcc, 2, 0, dst, 1);
+    x64_rr(c, 0, movzx8, 2, dst, dst, 1);
+}
+
+/* host.pstate = NZCV of the live flags, without disturbing EFLAGS until done */
+static void x64_write_nzcv(x64_ctx_t *c, ir_ref_t p)
+{
+    static const uint8_t lea[3] = { 0x4F, 0x8D, 0x14 };    /* lea r10, [r11 + r10*2] */
+    uint8_t cc[4] = { IR_COND_S, IR_COND_EQ, IR_COND_B, IR_COND_O };
+    int i;
+
+    /* ARM64 carry after a subtract is the inverse of the x86 borrow */
+    if (ir_flags_kind(c->blk, p) == IR_FLAGS_SUB) {
+        cc[2] = IR_COND_AE;
+    }
+
+    x64_setcc(c, cc[0], X64_R10);
+    for (i = 1; i < 4; i++) {
+        x64_setcc(c, cc[i], X64_R11);
+        code_buf_emit_byte(c->buf, lea[0]);
+        code_buf_emit_byte(c->buf, lea[1]);
+        code_buf_emit_byte(c->buf, lea[2]);
+        code_buf_emit_byte(c->buf, 0x53);
+    }
+
+    {
+        static const uint8_t shl = 0xC1;
+        x64_rr(c, 0, &shl, 1, 4, X64_R10, 0);
+        x64_byte(c, 28);
+    }
+    x64_store(c, 8, X64_R10, x64_at(X64_RBX, (int32_t)offsetof(ThreadState, host.pstate)));
+}
+
+static void x64_prologue(x64_ctx_t *c)
+{
+    int i, pushes = 0;
+
+    x64_byte(c, 0x53);                                  /* push rbx */
+    for (i = 0; i < X64_NUM_GUEST; i++) {
+        if (c->ra.pool_used & (1u << i)) {
+            x64_rex(c, 0, 0, 0, x64_guest_pool[i], 0);
+            x64_byte(c, (uint8_t)(0x50 + (x64_guest_pool[i] & 7)));
+            pushes++;
+        }
+    }
+    c->frame_pad = pushes & 1;
+    if (c->frame_pad) {
+        static const uint8_t sub[4] = { 0x48, 0x83, 0xEC, 0x08 };  /* sub rsp, 8 */
+        for (i = 0; i < 4; i++) {
+            x64_byte(c, sub[i]);
+        }
+    }
+    x64_mov_rr(c, 1, X64_RBX, X64_RDI);
+}
+
+/* Non-atomic increment of a profiling counter; clobbers R11 and EFLAGS */
+static void x64_count(x64_ctx_t *c, int slot)
+{
+    static const uint8_t add[1] = { 0x83 };
+
+    if (!c->blk->exec_counters) {
+        return;
+    }
+    x64_mov_imm(c, X64_R11, (int64_t)(uintptr_t)c->blk->exec_counters);
+    x64_rm(c, 1, add, 1, 0, x64_at(X64_R11, slot * 8), 0);  /* add qword [r11+d], 1 */
+    x64_byte(c, 1);
+}
+
+static void x64_epilogue(x64_ctx_t *c)
+{
+    int i;
+
+    if (c->frame_pad) {
+        static const uint8_t lea[5] = { 0x48, 0x8D, 0x64, 0x24, 0x08 };  /* lea rsp, [rsp+8] */
+        for (i = 0; i < 5; i++) {
+            x64_byte(c, lea[i]);
+        }
+    }
+    for (i = X64_NUM_GUEST - 1; i >= 0; i--) {
+        if (c->ra.pool_used & (1u << i)) {
+            x64_rex(c, 0, 0, 0, x64_guest_pool[i], 0);
+            x64_byte(c, (uint8_t)(0x58 + (x64_guest_pool[i] & 7)));
+        }
+    }
+    x64_byte(c, 0x5B);                                  /* pop rbx */
+    x64_byte(c, 0xC3);                                  /* ret */
+}
+
+/* Store the next guest pc, write back guest registers and return; EFLAGS
+ * must hold the block's flags when write_flags is set */
+static void x64_exit(x64_ctx_t *c, uint8_t pc_reg, uint64_t target, int write_flags, int slot)
+{
+    if (pc_reg == X64_NOREG) {
+        pc_reg = X64_R11;
+        x64_mov_imm(c, pc_reg, (int64_t)target);
+    }
+    x64_store(c, 8, pc_reg, x64_at(X64_RBX, (int32_t)offsetof(ThreadState, host.pc)));
+    x64_writeback(c, 0);
+    if (write_flags && c->blk->flags_ref != IR_NONE) {
+        x64_write_nzcv(c, c->blk->flags_ref);
+    }
+    x64_count(c, slot);
+    x64_epilogue(c);
+}
+
+/* ============================================================================
+ * Vector Values
+ * ============================================================================ */
+
+/* 66-prefixed SSE op, register-direct */
+void x64_sse(x64_ctx_t *c, int w, const uint8_t *op, int oplen, uint8_t reg, uint8_t rm)
+{
+    x64_byte(c, 0x66);
+    x64_rr(c, w, op, oplen, reg, rm, 0);
+}
+
+static void x64_movdqu(x64_ctx_t *c, int store, uint8_t xmm, x64_mem_t m)
+{
+    static const uint8_t load[2] = { 0x0F, 0x6F }, st[2] = { 0x0F, 0x7F };
+
+    x64_byte(c, 0xF3);
+    x64_rm(c, 0, store ? st : load, 2, xmm, m, 0);
+}
+
+/* 66 0F opc, two-operand SSE2 integer ops */
+void x64_sse2(x64_ctx_t *c, uint8_t opc, uint8_t dst, uint8_t src)
+{
+    uint8_t op[2] = { 0x0F, opc };
+    x64_sse(c, 0, op, 2, dst, src);
+}
+
+void x64_movdqa(x64_ctx_t *c, uint8_t dst, uint8_t src)
+{
+    x64_sse2(c, 0x6F, dst, src);
+}
+
+/* PSHUFD (66), PSHUFHW (F3) or PSHUFLW (F2) */
+void x64_pshuf(x64_ctx_t *c, uint8_t prefix, uint8_t dst, uint8_t src, uint8_t imm)
+{
+    static const uint8_t op[2] = { 0x0F, 0x70 };
+
+    x64_byte(c, prefix);
+    x64_rr(c, 0, op, 2, dst, src, 0);
+    x64_byte(c, imm);
+}
+
+/* Shift group 66 0F opc /ext ib (PSRLW, PSLLW, PSLLDQ, ...) */
+void x64_sse_shift(x64_ctx_t *c, uint8_t opc, uint8_t ext, uint8_t xmm, uint8_t imm)
+{
+    x64_sse2(c, opc, ext, xmm);
+    x64_byte(c, imm);
+}
+
+/* Vector result register for i, reusing a's if this is its last use */
+uint8_t x64_vdst(x64_ctx_t *c, ir_ref_t i, ir_ref_t a)
+{
+    static const uint8_t movdqa[2] = { 0x0F, 0x6F };
+    uint8_t r;
+
+    if (c->last_use[a] == i && c->blk->insns[i].b != a && c->blk->insns[i].index != a &&
+        x64_is_vtemp(c, c->loc[a])) {
+        r = c->loc[a];
+        c->loc[a] = X64_NOREG;
+        return r;
+    }
+    r = x64_xmm_alloc(c);
+    x64_sse(c, 0, movdqa, 2, r, c->loc[a]);
+    return r;
+}
+
+/* PSHUFB-free byte reversal within 2, 4 or 8-byte lanes */
+static void x64_vbswap(x64_ctx_t *c, uint8_t rd, int lane)
+{
+    x64_movdqa(c, X64_XMM0, rd);
+    x64_sse_shift(c, 0x71, 2, X64_XMM0, 8);                     /* psrlw */
+    x64_sse_shift(c, 0x71, 6, rd, 8);                           /* psllw */
+    x64_sse2(c, 0xEB, rd, X64_XMM0);                            /* por */
+    if (lane >= 4) {
+        uint8_t order = lane == 4 ? 0xB1 : 0x1B;
+        x64_pshuf(c, 0xF2, rd, rd, order);
+        x64_pshuf(c, 0xF3, rd, rd, order);
+    }
+}
+
+/* ============================================================================
+ * Block Emission
+ * ============================================================================ */
+
+static void x64_insn(x64_ctx_t *c, ir_ref_t i)
+{
+    const ir_insn_t *insn = &c->blk->insns[i];
+    int w = (insn->size == 8);
+    uint8_t rd;
+
+    switch (insn->op) {
+    case IR_NOP:
+        break;
+
+    case IR_CONST:
+        if (!c->inline_const[i] && c->last_use[i] != IR_NONE) {
+            c->loc[i] = x64_alloc(c);
+            x64_mov_imm(c, c->loc[i], insn->imm);
+        }
+        break;
+
+    case IR_GET_REG:
+        if (insn->size == 16) {
+            if (insn->reg < IR_ARM64_V0 || insn->reg >= IR_ARM64_V0 + IR_ARM64_NUM_VREGS) {
+                c->error = 1;
+                break;
+            }
+            rd = x64_vcached(c, insn->reg);
+            if (rd != X64_NOREG) {
+                if (!(c->vloaded & (1u << (insn->reg - IR_ARM64_V0)))) {
+                    x64_movdqu(c, 0, rd, x64_at(X64_RBX, x64_vguest_off(insn->reg)));
+                    c->vloaded |= 1u << (insn->reg - IR_ARM64_V0);
+                }
+                c->loc[i] = rd;
+            } else if (c->last_use[i] != IR_NONE) {
+                c->loc[i] = x64_xmm_alloc(c);
+                x64_movdqu(c, 0, c->loc[i], x64_at(X64_RBX, x64_vguest_off(insn->reg)));
+            }
+            break;
+        }
+        if (insn->reg >= IR_ARM64_NUM_REGS) {
+            c->error = 1;
+            break;
+        }
+        rd = x64_cached(c, insn->reg);
+        if (rd != X64_NOREG) {
+            if (!(c->loaded & (1u << insn->reg))) {
+                x64_load(c, 8, rd, x64_at(X64_RBX, x64_guest_off(insn->reg)));
+                c->loaded |= 1u << insn->reg;
+            }
+            c->loc[i] = rd;
+        } else if (c->last_use[i] != IR_NONE) {
+            c->loc[i] = x64_alloc(c);
+            x64_load(c, 8, c->loc[i], x64_at(X64_RBX, x64_guest_off(insn->reg)));
+        }
+        break;
+
+    case IR_SET_REG:
+        if (insn->size == 16) {
+            if (insn->reg < IR_ARM64_V0 || insn->reg >= IR_ARM64_V0 + IR_ARM64_NUM_VREGS) {
+                c->error = 1;
+                break;
+            }
+            rd = x64_vcached(c, insn->reg);
+            if (rd != X64_NOREG) {
+                x64_evict_vec(c, rd, i);
+                if (c->loc[insn->a] != rd) {
+                    x64_movdqa(c, rd, c->loc[insn->a]);
+                }
+                c->vloaded |= 1u << (insn->reg - IR_ARM64_V0);
+                c->vdirty |= 1u << (insn->reg - IR_ARM64_V0);
+            } else {
+                x64_movdqu(c, 1, c->loc[insn->a], x64_at(X64_RBX, x64_vguest_off(insn->reg)));
+            }
+            break;
+        }
+        if (insn->reg >= IR_ARM64_NUM_REGS) {
+            c->error = 1;
+            break;
+        }
+        rd = x64_cached(c, insn->reg);
+        if (rd != X64_NOREG) {
+            uint8_t src;
+
+            x64_evict(c, rd, i);
+            src = x64_reg(c, insn->a);
+            if (src != rd) {
+                x64_mov_rr(c, 1, rd, src);
+            }
+            c->loaded |= 1u << insn->reg;
+            c->dirty |= 1u << insn->reg;
+        } else {
+            x64_store(c, 8, x64_reg(c, insn->a), x64_at(X64_RBX, x64_guest_off(insn->reg)));
+        }
+        break;
+
+    case IR_ADD: case IR_SUB: case IR_AND: case IR_OR: case IR_XOR:
+    case IR_SHL: case IR_SHR: case IR_SAR: case IR_MUL:
+        if (insn->size == 16) {
+            static const uint8_t padd[4] = { 0xFC, 0xFD, 0xFE, 0xD4 };
+            static const uint8_t psub[4] = { 0xF8, 0xF9, 0xFA, 0xFB };
+            int lane = insn->imm == 8 ? 3 : insn->imm == 4 ? 2 : insn->imm == 2 ? 1 : 0;
+            uint8_t opc;
+
+            switch (insn->op) {
+            case IR_ADD: opc = padd[lane]; break;
+            case IR_SUB: opc = psub[lane]; break;
+            case IR_AND: opc = 0xDB; break;
+            case IR_OR:  opc = 0xEB; break;
+            case IR_XOR: opc = 0xEF; break;
+            default:     c->error = 1; return;
+            }
+            rd = x64_vdst(c, i, insn->a);
+            x64_sse2(c, opc, rd, c->loc[insn->b]);
+            c->loc[i] = rd;
+            break;
+        }
+        if (insn->size < 4) {
+            c->error = 1;
+            break;
+        }
+        rd = x64_dst(c, i, insn->a, w);
+        x64_alu(c, (ir_op_t)insn->op, insn->size, rd, insn->b);
+        c->loc[i] = rd;
+        c->flags_live = (insn->flags & IR_F_FLAGS) ? i : IR_NONE;
+        break;
+
+    case IR_NOT:
+    case IR_NEG:
+    {
+        static const uint8_t opc = 0xF7;
+
+        if (insn->size < 4) {
+            c->error = 1;
+            break;
+        }
+        rd = x64_dst(c, i, insn->a, w);
+        x64_rr(c, w, &opc, 1, insn->op == IR_NOT ? 2 : 3, rd, 0);
+        c->loc[i] = rd;
+        if (insn->op == IR_NEG) {
+            c->flags_live = (insn->flags & IR_F_FLAGS) ? i : IR_NONE;
+        }
+        break;
+    }
+
+    case IR_ZEXT:
+    case IR_SEXT:
+    {
+        static const uint8_t movzx8[2] = { 0x0F, 0xB6 }, movzx16[2] = { 0x0F, 0xB7 };
+        static const uint8_t movsx8[2] = { 0x0F, 0xBE }, movsx16[2] = { 0x0F, 0xBF };
+        static const uint8_t movsxd = 0x63;
+        uint8_t src = x64_reg(c, insn->a);
+        int sx = (insn->op == IR_SEXT);
+
+        rd = x64_alloc(c);
+        switch (insn->imm) {
+        case 1:  x64_rr(c, sx, sx ? movsx8 : movzx8, 2, rd, src, 1); break;
+        case 2:  x64_rr(c, sx, sx ? movsx16 : movzx16, 2, rd, src, 0); break;
+        case 4:
+            if (sx) {
+                x64_rr(c, 1, &movsxd, 1, rd, src, 0);
+            } else {
+                x64_mov_rr(c, 0, rd, src);
+            }
+            break;
+        default: x64_mov_rr(c, 1, rd, src); break;
+        }
+        c->loc[i] = rd;
+        break;
+    }
+
+    case IR_BSWAP:
+        rd = x64_vdst(c, i, insn->a);
+        x64_vbswap(c, rd, (int)insn->imm);
+        c->loc[i] = rd;
+        break;
+
+    case IR_LOAD:
+    case IR_STORE:
+    {
+        x64_mem_t m = x64_at(c->loc[insn->a], (int32_t)insn->imm);
+
+        if (insn->index != IR_NONE) {
+            m.index = c->loc[insn->index];
+            m.shift = insn->shift;
+        }
+        if (!x64_fits32(insn->imm)) {
+            /* Fold any index with LEA, then use the displacement as the index */
+            m.disp = 0;
+            if (m.index != X64_NOREG) {
+                static const uint8_t lea = 0x8D;
+                x64_rm(c, 1, &lea, 1, X64_R11, m, 0);
+                m = x64_at(X64_R11, 0);
+            }
+            x64_mov_imm(c, X64_R10, insn->imm);
+            m.index = X64_R10;
+            m.shift = 0;
+        }
+        if (insn->size == 16) {
+            if (insn->op == IR_LOAD) {
+                c->loc[i] = x64_xmm_alloc(c);
+                x64_movdqu(c, 0, c->loc[i], m);
+            } else {
+                x64_movdqu(c, 1, c->loc[insn->b], m);
+            }
+        } else if (insn->op == IR_LOAD) {
+            rd = x64_alloc(c);
+            x64_load(c, insn->size, rd, m);
+            c->loc[i] = rd;
+        } else {
+            x64_store(c, insn->size, x64_reg(c, insn->b), m);
+        }
+        break;
+    }
+
+    case IR_CMP:
+    case IR_TEST:
+        x64_alu(c, (ir_op_t)insn->op, insn->size, c->loc[insn->a], insn->b);
+        c->flags_live = i;
+        break;
+
+    case IR_SETCC:
+        x64_flags(c, insn->a);
+        rd = x64_alloc(c);
+        x64_setcc(c, insn->cond, rd);
+        c->loc[i] = rd;
+        break;
+
+    case IR_CALL:
+        /* The helper sees and may change guest state: sync, then reload lazily */
+        x64_writeback(c, 1);
+        c->loaded = 0;
+        c->vloaded = 0;                                 /* XMM registers are caller-saved */
+        x64_mov_rr(c, 1, X64_RDI, X64_RBX);
+        x64_mov_imm(c, X64_RAX, insn->imm);
+        x64_byte(c, 0xFF);
+        x64_byte(c, 0xD0);                              /* call rax */
+        c->flags_live = IR_NONE;
+        break;
+
+    case IR_BR:
+        if (c->blk->flags_ref != IR_NONE) {
+            x64_flags(c, c->blk->flags_ref);
+        }
+        x64_exit(c, X64_NOREG, (uint64_t)insn->imm, 1, IR_PROF_TAKEN);
+        break;
+
+    case IR_BR_IND:
+        if (c->blk->flags_ref != IR_NONE) {
+            x64_flags(c, c->blk->flags_ref);
+        }
+        x64_exit(c, c->loc[insn->a], 0, 1, IR_PROF_TAKEN);
+        break;
+
+    case IR_BRCOND:
+    {
+        int own_flags = (c->blk->flags_ref == insn->a);
+        size_t at;
+
+        /* Guest flags from another producer are written back up front */
+        if (!own_flags && c->blk->flags_ref != IR_NONE) {
+            x64_flags(c, c->blk->flags_ref);
+            x64_write_nzcv(c, c->blk->flags_ref);
+            c->flags_live = IR_NONE;
+        }
+        x64_flags(c, insn->a);
+        x64_byte(c, 0x0F);
+        x64_byte(c, (uint8_t)(0x80 + (insn->cond ^ 1)));      /* j!cc fall-through */
+        at = c->buf->offset;
+        x64_imm32(c, 0);
+        x64_exit(c, X64_NOREG, (uint64_t)insn->imm, own_flags, IR_PROF_TAKEN);
+        if (c->buf->offset <= c->buf->size) {
+            int32_t rel = (int32_t)(c->buf->offset - (at + 4));
+            memcpy(c->buf->buffer + at, &rel, 4);
+        }
+        x64_exit(c, X64_NOREG, insn->imm2, own_flags, IR_PROF_FALLTHROUGH);
+        break;
+    }
+
+    default:
+        if (x64_lowerings[insn->op]) {
+            x64_lowerings[insn->op](c, i);
+        } else {
+            c->error = 1;
+        }
+        break;
+    }
+
+    x64_release(c, insn->a, i);
+    x64_release(c, insn->b, i);
+    x64_release(c, insn->index, i);
+    if ((insn->op == IR_BRCOND || insn->op == IR_SETCC) && insn->a != IR_NONE) {
+        x64_release(c, c->blk->insns[insn->a].a, i);
+        x64_release(c, c->blk->insns[insn->a].b, i);
+    }
+    if (ir_op_has_value((ir_op_t)insn->op) && c->last_use[i] == IR_NONE) {
+        c->last_use[i] = i;
+        x64_release(c, i, i);
+    }
+}
+
+int ir_x86_set_lowering(ir_op_t op, x64_lower_fn fn)
+{
+    if ((unsigned)op >= IR_OP_COUNT) {
+        return -1;
+    }
+    x64_lowerings[op] = fn;
+    return 0;
+}
+
+/* One emission attempt with nvec XMM registers set aside for guest vectors */
+static int x64_emit_block(x64_ctx_t *c, const ir_block_t *blk, code_buf_t *buf, int nvec)
+{
+    ir_ref_t i;
+
+    c->blk = blk;
+    c->buf = buf;
+    c->temp_busy = 0;
+    c->xmm_busy = 0;
+    c->xmm_count = (uint8_t)(X64_XMM_COUNT - nvec);
+    c->xmm_short = 0;
+    c->flags_live = IR_NONE;
+    c->error = 0;
+    ir_compute_last_use(blk, c->last_use);
+    memset(c->loc, X64_NOREG, sizeof(c->loc));
+
+    /* The exit re-creates the guest flags, so keep their inputs alive */
+    if (blk->flags_ref != IR_NONE) {
+        const ir_insn_t *p = &blk->insns[blk->flags_ref];
+        if (p->a != IR_NONE) {
+            c->last_use[p->a] = (ir_ref_t)(blk->count - 1);
+        }
+        if (p->b != IR_NONE) {
+            c->last_use[p->b] = (ir_ref_t)(blk->count - 1);
+        }
+    }
+    for (i = 0; i < blk->count; i++) {
+        c->inline_const[i] = blk->insns[i].op == IR_CONST && x64_const_inlinable(blk, i);
+    }
+
+    ra_linear_scan(blk, x64_guest_pool, X64_NUM_GUEST, &c->ra);
+    ra_linear_scan_class(blk, RA_CLASS_VEC, x64_guest_xmm_pool, nvec, &c->vra);
+    c->loaded = 0;
+    c->dirty = 0;
+    c->vloaded = 0;
+    c->vdirty = 0;
+    x64_prologue(c);
+    x64_count(c, IR_PROF_ENTRY);
+
+    for (i = 0; i < blk->count && !c->error; i++) {
+        x64_insn(c, i);
+    }
+    if (c->error || buf->offset >= buf->size) {
+        return -1;
+    }
+    return 0;
+}
+
+int ir_emit_x86(const ir_block_t *blk, code_buf_t *buf)
+{
+    static _Thread_local x64_ctx_t ctx;
+    size_t start = buf->offset;
+
+    if (ir_verify(blk) != 0 || blk->count == 0 ||
+        !ir_op_is_exit((ir_op_t)blk->insns[blk->count - 1].op)) {
+        return -1;
+    }
+
+    if (x64_emit_block(&ctx, blk, buf, X64_NUM_GUEST_VEC) == 0) {
+        return 0;
+    }
+    if (!ctx.xmm_short) {
+        return -1;
+    }
+    /* Too many vector values live at once: give the guest XMMs back to them */
+    buf->offset = start;
+    return x64_emit_block(&ctx, blk, buf, 0);
+}
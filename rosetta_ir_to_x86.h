@@ -0,0 +1,141 @@
+/* ============================================================================
+ * Rosetta Translator - IR to x86_64 Back-end Lowerings
+ * ============================================================================
+ *
+ * This header exposes the emission state and encoders of ir_emit_x86() to
+ * lowerings kept outside the back-end. An op with no built-in lowering is
+ * emitted by the function registered for it with ir_x86_set_lowering();
+ * without one, ir_emit_x86() declines the block. The crypto lowerings
+ * (rosetta_ir_to_x86_crypto.c) register this way, so the back-end links
+ * without the crypto modules.
+ * ============================================================================ */
+
+#ifndef ROSETTA_IR_TO_X86_H
+#define ROSETTA_IR_TO_X86_H
+
+#include "rosetta_ir.h"
+#include "rosetta_regalloc.h"
+
+/* ============================================================================
+ * Registers
+ * ============================================================================ */
+
+#define X64_NOREG       0xFF
+#define X64_RAX         0
+#define X64_RBX         3       /* ThreadState pointer */
+#define X64_RDI         7
+#define X64_R10         10      /* Scratch */
+#define X64_R11         11      /* Scratch */
+
+/* Scratch vector registers; values are allocated from XMM3 up */
+#define X64_XMM0        0
+#define X64_XMM1        1
+#define X64_XMM2        2
+
+/* ============================================================================
+ * Emission State
+ * ============================================================================ */
+
+typedef struct {
+    const ir_block_t *blk;
+    code_buf_t *buf;
+    ir_ref_t last_use[IR_MAX_INSNS];
+    uint8_t loc[IR_MAX_INSNS];
+    uint8_t inline_const[IR_MAX_INSNS];
+    uint8_t temp_busy;          /* Bitmask over the value temporaries */
+    uint16_t xmm_busy;          /* Bitmask over the vector value registers */
+    uint8_t xmm_count;          /* Of them, from XMM3 (the rest hold guest vectors) */
+    uint8_t xmm_short;          /* Ran out of them */
+    ir_ref_t flags_live;        /* Producer currently in EFLAGS */
+    ra_alloc_t ra;              /* Guest register assignment */
+    uint32_t loaded;            /* Cached guest registers holding their value */
+    uint32_t dirty;             /* Cached guest registers not yet written back */
+    ra_alloc_t vra;             /* Guest vector register assignment */
+    uint32_t vloaded;           /* The same for vector registers */
+    uint32_t vdirty;
+    int frame_pad;              /* 8 bytes of padding keep calls aligned */
+    int error;
+} x64_ctx_t;
+
+/* [base + (index << shift) + disp], index X64_NOREG if absent */
+typedef struct {
+    uint8_t base;
+    uint8_t index;
+    uint8_t shift;
+    int32_t disp;
+} x64_mem_t;
+
+/* ============================================================================
+ * Lowering Hooks
+ * ============================================================================ */
+
+/*
+ * Emits instruction i and sets c->loc[i] to its result. Operands are
+ * released by the caller after it returns. A lowering that clobbers EFLAGS
+ * sets c->flags_live to IR_NONE; one that cannot emit i sets c->error.
+ */
+typedef void (*x64_lower_fn)(x64_ctx_t *c, ir_ref_t i);
+
+/**
+ * ir_x86_set_lowering - Register the lowering of an op
+ *
+ * The lowering is used only for ops the back-end has no case for. Meant
+ * to be called at start-up, before blocks are emitted.
+ *
+ * @param fn Lowering, or NULL to decline blocks using the op again
+ * @return 0 on success, -1 if the op cannot be registered
+ */
+int ir_x86_set_lowering(ir_op_t op, x64_lower_fn fn);
+
+/**
+ * ir_x86_register_crypto - Register the CRC32, AES, SHA and PMULL lowerings
+ *
+ * Defined in rosetta_ir_to_x86_crypto.c, which links the crypto modules.
+ */
+void ir_x86_register_crypto(void);
+
+/* ============================================================================
+ * Encoders and Value Locations
+ * ============================================================================ */
+
+void x64_byte(x64_ctx_t *c, uint8_t b);
+
+/* opcode with ModRM register-direct form; byte_regs forces REX for SPL-DIL */
+void x64_rr(x64_ctx_t *c, int w, const uint8_t *op, int oplen, uint8_t reg, uint8_t rm,
+            int byte_regs);
+
+/* opcode with a memory operand */
+void x64_rm(x64_ctx_t *c, int w, const uint8_t *op, int oplen, uint8_t reg, x64_mem_t m,
+            int byte_reg);
+
+void x64_mov_rr(x64_ctx_t *c, int w, uint8_t dst, uint8_t src);
+void x64_mov_imm(x64_ctx_t *c, uint8_t dst, int64_t v);
+
+/* Value temporaries; X64_R11 and c->error if none is free */
+uint8_t x64_alloc(x64_ctx_t *c);
+void x64_free(x64_ctx_t *c, uint8_t r);
+uint8_t x64_xmm_alloc(x64_ctx_t *c);
+
+/* Register for operand v, materializing inline constants into R10 */
+uint8_t x64_reg(x64_ctx_t *c, ir_ref_t v);
+
+/* Result register for i, holding a copy of operand a unless a is IR_NONE */
+uint8_t x64_dst(x64_ctx_t *c, ir_ref_t i, ir_ref_t a, int w);
+
+/* 66-prefixed SSE op, register-direct */
+void x64_sse(x64_ctx_t *c, int w, const uint8_t *op, int oplen, uint8_t reg, uint8_t rm);
+
+/* 66 0F opc, two-operand SSE2 integer ops */
+void x64_sse2(x64_ctx_t *c, uint8_t opc, uint8_t dst, uint8_t src);
+void x64_movdqa(x64_ctx_t *c, uint8_t dst, uint8_t src);
+
+/* PSHUFD (66), PSHUFHW (F3) or PSHUFLW (F2) */
+void x64_pshuf(x64_ctx_t *c, uint8_t prefix, uint8_t dst, uint8_t src, uint8_t imm);
+
+/* Shift group 66 0F opc /ext ib (PSRLW, PSLLW, PSLLDQ, ...) */
+void x64_sse_shift(x64_ctx_t *c, uint8_t opc, uint8_t ext, uint8_t xmm, uint8_t imm);
+
+/* Vector result register for i, holding a copy of operand a */
+uint8_t x64_vdst(x64_ctx_t *c, ir_ref_t i, ir_ref_t a);
+
+#endif /* ROSETTA_IR_TO_X86_H */
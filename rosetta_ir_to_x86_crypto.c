@@ -0,0 +1,451 @@
+/* ============================================================================
+ * Rosetta Translator - IR to x86_64 Crypto Lowerings
+ * ============================================================================
+ *
+ * Lowerings of IR_CRC32/IR_CRC32_FOLD, IR_AES, IR_SHA and IR_PMULL for the
+ * x86_64 back-end, registered by ir_x86_register_crypto(). Until then the
+ * back-end declines blocks using these ops, so it links without the crypto
+ * modules.
+ *
+ * CRC32C steps use the SSE4.2 CRC32 instruction. CRC32 steps, and CRC32C
+ * on hosts without SSE4.2, reduce with PCLMULQDQ or index the slicing-by-8
+ * tables from rosetta_crc32.c, whichever rosetta_crc32_hw() allows when the
+ * block is emitted. Both clobber XMM0-XMM2.
+ *
+ * AES steps need AES-NI and take their zero round key from XMM0; ARM64
+ * steps left unfused by the optimizer cost an extra instruction or two
+ * each. SHA steps need SHA-NI and reshuffle lanes around it as
+ * rosetta_sha.c describes; SHA256RNDS2 takes its W+K from XMM0. 64-bit
+ * PMULL is one PCLMULQDQ, the 8-bit form a bit-sliced SSE2 sequence.
+ * ============================================================================ */
+
+#include "rosetta_ir_to_x86.h"
+#include "rosetta_crc32.h"
+#include "rosetta_aes.h"
+#include "rosetta_sha.h"
+#include "rosetta_pmull.h"
+
+/* ============================================================================
+ * CRC32
+ * ============================================================================ */
+
+static void x64_movq_to_xmm(x64_ctx_t *c, uint8_t xmm, uint8_t gpr)
+{
+    static const uint8_t op[2] = { 0x0F, 0x6E };
+    x64_sse(c, 1, op, 2, xmm, gpr);
+}
+
+/* MOVQ r64, xmm, or MOVD r32, xmm (zero-extending) when w is clear */
+static void x64_movq_from_xmm(x64_ctx_t *c, int w, uint8_t gpr, uint8_t xmm)
+{
+    static const uint8_t op[2] = { 0x0F, 0x7E };
+    x64_sse(c, w, op, 2, xmm, gpr);
+}
+
+static void x64_clmul(x64_ctx_t *c, uint8_t dst, uint8_t src)
+{
+    static const uint8_t op[3] = { 0x0F, 0x3A, 0x44 };
+    x64_sse(c, 0, op, 3, dst, src);
+    x64_byte(c, 0x00);                                  /* low qwords */
+}
+
+static void x64_xmm_imm(x64_ctx_t *c, uint8_t xmm, uint64_t v)
+{
+    x64_mov_imm(c, X64_R11, (int64_t)v);
+    x64_movq_to_xmm(c, xmm, X64_R11);
+}
+
+static void x64_shr_imm(x64_ctx_t *c, int w, uint8_t r, uint8_t n)
+{
+    static const uint8_t op = 0xC1;
+    x64_rr(c, w, &op, 1, 5, r, 0);
+    x64_byte(c, n);
+}
+
+static void x64_xor_rr(x64_ctx_t *c, int w, uint8_t dst, uint8_t src)
+{
+    static const uint8_t op = 0x31;
+    x64_rr(c, w, &op, 1, src, dst, 0);
+}
+
+/*
+ * dst = CRC of the low n bytes of R10 into crc (X64_NOREG for 0), one
+ * slicing-by-8 table per byte; clobbers R10 and R11
+ */
+static void x64_crc_table(x64_ctx_t *c, int poly, uint8_t dst, uint8_t crc, int n)
+{
+    static const uint8_t movzx8[2] = { 0x0F, 0xB6 };
+    static const uint8_t xor_rm = 0x33;
+    uint8_t idx = x64_alloc(c);
+    int k;
+
+    x64_mov_imm(c, X64_R11, (int64_t)(uintptr_t)rosetta_crc32_tables((rosetta_crc32_poly_t)poly));
+    if (n < 4 && crc != X64_NOREG) {
+        /* CRC bytes above the data width shift down untouched */
+        if (dst != crc) {
+            x64_mov_rr(c, 0, dst, crc);
+        }
+        x64_shr_imm(c, 0, dst, (uint8_t)(n * 8));
+    } else {
+        x64_xor_rr(c, 0, dst, dst);
+    }
+    for (k = 0; k < n; k++) {
+        x64_mem_t m = { X64_R11, idx, 2, (n - 1 - k) * 1024 };
+
+        x64_rr(c, 0, movzx8, 2, idx, X64_R10, 1);
+        x64_rm(c, 0, &xor_rm, 1, dst, m, 0);
+        if (k + 1 < n) {
+            x64_shr_imm(c, 1, X64_R10, 8);
+        }
+    }
+    x64_free(c, idx);
+}
+
+/* R10 = remainder R10 carried past 64 more bits, still congruent mod P */
+static void x64_crc_fold(x64_ctx_t *c, int poly, uint32_t hw)
+{
+    const rosetta_crc32_clmul_t *k = rosetta_crc32_clmul_consts((rosetta_crc32_poly_t)poly);
+
+    if (hw & ROS_CRC32_HW_PCLMUL) {
+        x64_mov_rr(c, 0, X64_R11, X64_R10);
+        x64_movq_to_xmm(c, X64_XMM0, X64_R11);
+        x64_shr_imm(c, 1, X64_R10, 32);
+        x64_movq_to_xmm(c, X64_XMM1, X64_R10);
+        x64_xmm_imm(c, X64_XMM2, k->k1);
+        x64_clmul(c, X64_XMM0, X64_XMM2);
+        x64_xmm_imm(c, X64_XMM2, k->k2);
+        x64_clmul(c, X64_XMM1, X64_XMM2);
+        {
+            static const uint8_t pxor[2] = { 0x0F, 0xEF };
+            x64_sse(c, 0, pxor, 2, X64_XMM0, X64_XMM1);
+        }
+        x64_movq_from_xmm(c, 1, X64_R10, X64_XMM0);
+    } else {
+        /* Reducing is a valid fold, just a longer one */
+        uint8_t t = x64_alloc(c);
+        x64_crc_table(c, poly, t, X64_NOREG, 8);
+        x64_mov_rr(c, 0, X64_R10, t);
+        x64_free(c, t);
+    }
+}
+
+/* R10 = (R10 ^ clmul(lo32(clmul(lo32(R10), mu)), p)) >> 32 with XMM1 = mu,
+ * XMM2 = p; one round reduces 32 bits */
+static void x64_crc_barrett(x64_ctx_t *c)
+{
+    x64_mov_rr(c, 0, X64_R11, X64_R10);
+    x64_movq_to_xmm(c, X64_XMM0, X64_R11);
+    x64_clmul(c, X64_XMM0, X64_XMM1);
+    x64_movq_from_xmm(c, 0, X64_R11, X64_XMM0);
+    x64_movq_to_xmm(c, X64_XMM0, X64_R11);
+    x64_clmul(c, X64_XMM0, X64_XMM2);
+    x64_movq_from_xmm(c, 1, X64_R11, X64_XMM0);
+    x64_xor_rr(c, 1, X64_R10, X64_R11);
+    x64_shr_imm(c, 1, X64_R10, 32);
+}
+
+static void x64_crc32(x64_ctx_t *c, ir_ref_t i)
+{
+    const ir_insn_t *insn = &c->blk->insns[i];
+    int poly = (int)insn->imm;
+    int n = insn->size;
+    int chained = c->blk->insns[insn->a].op == IR_CRC32_FOLD;
+    uint32_t hw = rosetta_crc32_hw();
+    uint8_t acc = x64_reg(c, insn->a);
+    uint8_t rd;
+
+    if (insn->op == IR_CRC32 && poly == IR_CRC_CASTAGNOLI && !chained &&
+        (hw & ROS_CRC32_HW_SSE42)) {
+        static const uint8_t crc8[3] = { 0x0F, 0x38, 0xF0 };
+        static const uint8_t crc[3] = { 0x0F, 0x38, 0xF1 };
+
+        rd = x64_dst(c, i, insn->a, 0);
+        if (n == 2) {
+            x64_byte(c, 0x66);
+        }
+        x64_byte(c, 0xF2);
+        x64_rr(c, n == 8, n == 1 ? crc8 : crc, 3, rd, x64_reg(c, insn->b), n == 1);
+        c->loc[i] = rd;
+        c->flags_live = IR_NONE;
+        return;
+    }
+
+    /* R10 = remainder ^ data */
+    if (chained) {
+        x64_mov_rr(c, 1, X64_R10, acc);
+        x64_crc_fold(c, poly, hw);
+    } else {
+        x64_mov_rr(c, 0, X64_R10, acc);
+    }
+    x64_xor_rr(c, n == 8, X64_R10, x64_reg(c, insn->b));
+
+    if (insn->op == IR_CRC32_FOLD) {
+        rd = x64_dst(c, i, IR_NONE, 1);
+        x64_mov_rr(c, 1, rd, X64_R10);
+    } else if ((hw & ROS_CRC32_HW_PCLMUL) && n >= 4) {
+        const rosetta_crc32_clmul_t *k = rosetta_crc32_clmul_consts((rosetta_crc32_poly_t)poly);
+
+        x64_xmm_imm(c, X64_XMM1, k->mu);
+        x64_xmm_imm(c, X64_XMM2, k->p);
+        if (n == 8) {
+            x64_crc_barrett(c);
+        }
+        x64_crc_barrett(c);
+        rd = x64_dst(c, i, IR_NONE, 0);
+        x64_mov_rr(c, 0, rd, X64_R10);
+    } else {
+        rd = x64_dst(c, i, IR_NONE, 0);
+        x64_crc_table(c, poly, rd, chained ? X64_NOREG : acc, n);
+    }
+    c->loc[i] = rd;
+    c->flags_live = IR_NONE;
+}
+
+/* ============================================================================
+ * AES, SHA and PMULL
+ * ============================================================================ */
+
+static void x64_pxor(x64_ctx_t *c, uint8_t dst, uint8_t src)
+{
+    static const uint8_t op[2] = { 0x0F, 0xEF };
+    x64_sse(c, 0, op, 2, dst, src);
+}
+
+/* AESENC, AESENCLAST, AESDEC, AESDECLAST (DC-DF) or AESIMC (DB) */
+static void x64_aesni(x64_ctx_t *c, uint8_t opc, uint8_t dst, uint8_t src)
+{
+    uint8_t op[3] = { 0x0F, 0x38, opc };
+    x64_sse(c, 0, op, 3, dst, src);
+}
+
+static void x64_aes(x64_ctx_t *c, ir_ref_t i)
+{
+    const ir_insn_t *insn = &c->blk->insns[i];
+    uint8_t rd, key = X64_XMM0;
+
+    if (!(rosetta_aes_hw() & ROS_AES_HW_AESNI)) {
+        c->error = 1;
+        return;
+    }
+    rd = x64_vdst(c, i, insn->a);
+    if (insn->b != IR_NONE) {
+        key = c->loc[insn->b];
+    }
+    if (insn->imm != IR_AES_IMC && (insn->b == IR_NONE || insn->imm <= IR_AES_D)) {
+        x64_pxor(c, X64_XMM0, X64_XMM0);
+    }
+
+    switch (insn->imm) {
+    case IR_AES_E:
+    case IR_AES_D:
+        if (insn->b != IR_NONE) {
+            x64_pxor(c, rd, key);
+        }
+        x64_aesni(c, insn->imm == IR_AES_E ? 0xDD : 0xDF, rd, X64_XMM0);
+        break;
+    case IR_AES_MC:
+        /* The inverse substitution and row shift cancel against AESENC's */
+        x64_aesni(c, 0xDF, rd, X64_XMM0);
+        x64_aesni(c, 0xDC, rd, X64_XMM0);
+        break;
+    case IR_AES_IMC:
+        x64_aesni(c, 0xDB, rd, rd);
+        break;
+    default:
+        x64_aesni(c, (uint8_t)(0xDC + (insn->imm - IR_AES_ENC)), rd, key);
+        break;
+    }
+    c->loc[i] = rd;
+}
+
+/* SHA-NI, no mandatory prefix: 0F 38 opc, or 0F 3A opc ib for SHA1RNDS4 */
+static void x64_shani(x64_ctx_t *c, uint8_t opc, uint8_t dst, uint8_t src)
+{
+    uint8_t op[3] = { 0x0F, 0x38, opc };
+    x64_rr(c, 0, op, 3, dst, src, 0);
+}
+
+/* dst = PSHUFD(PUNPCK{L,H}DQ(x, y), 0x72): packs ABEF/CDGH from abcd and
+ * efgh, and unpacks them again */
+static void x64_sha256_repack(x64_ctx_t *c, uint8_t dst, uint8_t x, uint8_t y, int high)
+{
+    x64_movdqa(c, dst, x);
+    x64_sse2(c, high ? 0x6A : 0x62, dst, y);
+    x64_pshuf(c, 0x66, dst, dst, 0x72);
+}
+
+static void x64_sha(x64_ctx_t *c, ir_ref_t i)
+{
+    static const uint8_t movd_to[2] = { 0x0F, 0x6E }, movd_from[2] = { 0x0F, 0x7E };
+    static const uint32_t sha1_k[3] = { 0x5A827999u, 0x6ED9EBA1u, 0x8F1BBCDCu };
+    const ir_insn_t *insn = &c->blk->insns[i];
+    uint8_t ra = c->loc[insn->a];
+    uint8_t rb = insn->b != IR_NONE ? c->loc[insn->b] : X64_NOREG;
+    uint8_t rc = insn->index != IR_NONE ? c->loc[insn->index] : X64_NOREG;
+    uint8_t rd;
+
+    if (!(rosetta_sha_hw() & ROS_SHA_HW_SHANI)) {
+        c->error = 1;
+        return;
+    }
+
+    switch (insn->imm) {
+    case IR_SHA1C:
+    case IR_SHA1P:
+    case IR_SHA1M:
+    {
+        static const uint8_t rnds4[3] = { 0x0F, 0x3A, 0xCC };
+
+        /* XMM1 = reversed wk - K + (e << 96) */
+        x64_pshuf(c, 0x66, X64_XMM1, rc, 0x1B);
+        x64_mov_imm(c, X64_R11, sha1_k[insn->imm]);
+        x64_sse(c, 0, movd_to, 2, X64_XMM0, X64_R11);
+        x64_pshuf(c, 0x66, X64_XMM0, X64_XMM0, 0x00);
+        x64_sse2(c, 0xFA, X64_XMM1, X64_XMM0);                  /* psubd */
+        x64_sse(c, 0, movd_from, 2, rb, X64_R11);
+        x64_sse(c, 0, movd_to, 2, X64_XMM0, X64_R11);
+        x64_sse_shift(c, 0x73, 7, X64_XMM0, 12);                 /* pslldq */
+        x64_sse2(c, 0xFE, X64_XMM1, X64_XMM0);                  /* paddd */
+        rd = x64_xmm_alloc(c);
+        x64_pshuf(c, 0x66, rd, ra, 0x1B);
+        x64_rr(c, 0, rnds4, 3, rd, X64_XMM1, 0);
+        x64_byte(c, (uint8_t)insn->imm);
+        x64_pshuf(c, 0x66, rd, rd, 0x1B);
+        break;
+    }
+    case IR_SHA1H:
+    {
+        static const uint8_t rol = 0xC1;
+
+        x64_sse(c, 0, movd_from, 2, ra, X64_R11);
+        x64_rr(c, 0, &rol, 1, 0, X64_R11, 0);
+        x64_byte(c, 30);
+        rd = x64_xmm_alloc(c);
+        x64_sse(c, 0, movd_to, 2, rd, X64_R11);
+        break;
+    }
+    case IR_SHA1SU0:
+        x64_movdqa(c, X64_XMM1, ra);
+        x64_sse2(c, 0xC6, X64_XMM1, rb);                        /* shufpd */
+        x64_byte(c, 1);
+        rd = x64_vdst(c, i, insn->a);
+        x64_pxor(c, rd, X64_XMM1);
+        x64_pxor(c, rd, rc);
+        break;
+    case IR_SHA1SU1:
+        x64_pshuf(c, 0x66, X64_XMM1, ra, 0x1B);
+        x64_pshuf(c, 0x66, X64_XMM2, rb, 0x1B);
+        x64_shani(c, 0xCA, X64_XMM1, X64_XMM2);                 /* sha1msg2 */
+        rd = x64_xmm_alloc(c);
+        x64_pshuf(c, 0x66, rd, X64_XMM1, 0x1B);
+        break;
+    case IR_SHA256H:
+    case IR_SHA256H2:
+    {
+        uint8_t abcd = insn->imm == IR_SHA256H ? ra : rb;
+        uint8_t efgh = insn->imm == IR_SHA256H ? rb : ra;
+
+        x64_sha256_repack(c, X64_XMM1, efgh, abcd, 0);
+        x64_sha256_repack(c, X64_XMM2, efgh, abcd, 1);
+        x64_movdqa(c, X64_XMM0, rc);
+        x64_shani(c, 0xCB, X64_XMM2, X64_XMM1);
+        x64_pshuf(c, 0x66, X64_XMM0, rc, 0x0E);
+        x64_shani(c, 0xCB, X64_XMM1, X64_XMM2);
+        rd = x64_xmm_alloc(c);
+        x64_sha256_repack(c, rd, X64_XMM1, X64_XMM2, insn->imm == IR_SHA256H);
+        break;
+    }
+    case IR_SHA256SU0:
+        rd = x64_vdst(c, i, insn->a);
+        x64_shani(c, 0xCC, rd, rb);                             /* sha256msg1 */
+        break;
+    case IR_SHA256SU1:
+    {
+        static const uint8_t palignr[3] = { 0x0F, 0x3A, 0x0F };
+
+        x64_movdqa(c, X64_XMM1, rc);
+        x64_sse(c, 0, palignr, 3, X64_XMM1, rb);
+        x64_byte(c, 4);
+        rd = x64_vdst(c, i, insn->a);
+        x64_sse2(c, 0xFE, rd, X64_XMM1);
+        x64_shani(c, 0xCD, rd, rc);                             /* sha256msg2 */
+        break;
+    }
+    case IR_SHA256_RNDS2:
+    case IR_SHA256_RNDS2_HI:
+        if (insn->imm == IR_SHA256_RNDS2) {
+            x64_movdqa(c, X64_XMM0, rc);
+        } else {
+            x64_pshuf(c, 0x66, X64_XMM0, rc, 0x0E);
+        }
+        rd = x64_vdst(c, i, insn->a);
+        x64_shani(c, 0xCB, rd, rb);                             /* sha256rnds2 */
+        break;
+    default:
+        /* Packing interleaves efgh with abcd, unpacking ABEF with CDGH */
+        rd = x64_xmm_alloc(c);
+        if (insn->imm == IR_SHA256_ABEF || insn->imm == IR_SHA256_CDGH) {
+            x64_sha256_repack(c, rd, rb, ra, insn->imm == IR_SHA256_CDGH);
+        } else {
+            x64_sha256_repack(c, rd, ra, rb, insn->imm == IR_SHA256_ABCD);
+        }
+        break;
+    }
+    c->loc[i] = rd;
+}
+
+static void x64_pmull(x64_ctx_t *c, ir_ref_t i)
+{
+    static const uint8_t pclmulqdq[3] = { 0x0F, 0x3A, 0x44 };
+    const ir_insn_t *insn = &c->blk->insns[i];
+    uint8_t rb = c->loc[insn->b];
+    uint8_t rd;
+    int high = insn->imm == IR_PMULL2_64 || insn->imm == IR_PMULL2_8;
+    int bit;
+
+    if (insn->imm == IR_PMULL_64 || insn->imm == IR_PMULL2_64) {
+        if (!(rosetta_pmull_hw() & ROS_PMULL_HW_PCLMUL)) {
+            c->error = 1;
+            return;
+        }
+        rd = x64_vdst(c, i, insn->a);
+        x64_sse(c, 0, pclmulqdq, 3, rd, rb);
+        x64_byte(c, high ? 0x11 : 0x00);
+        c->loc[i] = rd;
+        return;
+    }
+
+    /* Bytes widened to words in XMM1 (a) and XMM2 (b); for each bit of a,
+     * XOR in b shifted by it where the bit is set */
+    x64_pxor(c, X64_XMM0, X64_XMM0);
+    x64_movdqa(c, X64_XMM1, c->loc[insn->a]);
+    x64_sse2(c, high ? 0x68 : 0x60, X64_XMM1, X64_XMM0);        /* punpck{h,l}bw */
+    x64_movdqa(c, X64_XMM2, rb);
+    x64_sse2(c, high ? 0x68 : 0x60, X64_XMM2, X64_XMM0);
+    rd = x64_xmm_alloc(c);
+    x64_pxor(c, rd, rd);
+    for (bit = 0; bit < 8; bit++) {
+        x64_movdqa(c, X64_XMM0, X64_XMM1);
+        x64_sse_shift(c, 0x71, 6, X64_XMM0, (uint8_t)(15 - bit));  /* psllw */
+        x64_sse_shift(c, 0x71, 4, X64_XMM0, 15);                   /* psraw */
+        x64_sse2(c, 0xDB, X64_XMM0, X64_XMM2);                     /* pand */
+        x64_pxor(c, rd, X64_XMM0);
+        if (bit < 7) {
+            x64_sse_shift(c, 0x71, 6, X64_XMM2, 1);
+        }
+    }
+    c->loc[i] = rd;
+}
+
+/* ============================================================================
+ * Registration
+ * ============================================================================ */
+
+void ir_x86_register_crypto(void)
+{
+    ir_x86_set_lowering(IR_CRC32, x64_crc32);
+    ir_x86_set_lowering(IR_CRC32_FOLD, x64_crc32);
+    ir_x86_set_lowering(IR_AES, x64_aes);
+    ir_x86_set_lowering(IR_SHA, x64_sha);
+    ir_x86_set_lowering(IR_PMULL, x64_pmull);
+}
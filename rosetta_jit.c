@@ -53,7 +53,13 @@
 #include "rosetta_jit.h"
 #include "rosetta_arm64_decode.h"
 #include "rosetta_arm64_emit.h"
+#include "rosetta_ir.h"
+#include "rosetta_ir_opt.h"
+#include "rosetta_block_profile.h"
+#include "rosetta_ir_to_x86.h"
 #include "rosetta_hash.h"
+#include "rosetta_perfmap.h"
+#include "rosetta_sampler.h"
 #include <string.h>
 #include <stdlib.h>
 #include <sys/mman.h>
@@ -127,6 +133,9 @@ int jit_init(jit_context_t *ctx, u32 cache_size)
     ctx->cache_hits = 0;
     ctx->cache_misses = 0;
 
+    /* Let translate_block_ir() emit the crypto ops */
+    ir_x86_register_crypto();
+
     /* Set flags */
     ctx->initialized = true;
     ctx->hot_path = false;
@@ -232,6 +241,10 @@ int translation_insert(jit_context_t *ctx, u64 guest, u64 host, size_t size)
     ctx->cache_insert_index++;
     ctx->blocks_translated++;
 
+    /* Let the sampling profiler and host perf attribute host pcs in this block */
+    rosetta_sampler_map_block(host, (u32)size, guest, NULL);
+    rosetta_perfmap_record_block((const void *)(uintptr_t)host, (u32)size, guest);
+
     return ROSETTA_OK;
 }
 
@@ -487,17 +500,48 @@ void code_cache_reset(jit_context_t *ctx)
 {
     if (!ctx || !ctx->initialized) return;
     ctx->code_cache_offset = 0;
+    rosetta_sampler_unmap_all();
 }
 
 /* ============================================================================
  * Translation Entry Points
  * ============================================================================ */
 
+/**
+ * Translate a block through the IR: lower, optimize, emit x86_64
+ * @return Size of the block emitted at the code cache offset, or 0 if the
+ *         IR does not cover the first instruction or emission failed
+ *
+ * The block runs as fn(ThreadState *) and stores its successor to
+ * ThreadState.host.pc. With profiling enabled it also bumps its counters.
+ */
+static u32 translate_block_ir(jit_context_t *ctx, u64 guest_pc, int max_insns)
+{
+    static _Thread_local ir_block_t blk;
+    code_buf_t buf;
+
+    ir_block_init(&blk, guest_pc);
+    if (ir_arm64_lower_block(&blk, (const uint32_t *)(uintptr_t)guest_pc, guest_pc,
+                             max_insns) <= 0 ||
+        ir_optimize(&blk, IR_OPT_ALL, NULL) != 0) {
+        return 0;
+    }
+    rosetta_profile_instrument(&blk);
+
+    code_buf_init(&buf, ctx->code_cache + ctx->code_cache_offset,
+                  ctx->code_cache_size - ctx->code_cache_offset);
+    if (ir_emit_x86(&blk, &buf) != 0) {
+        return 0;
+    }
+    return (u32)buf.offset;
+}
+
 /**
  * Translate ARM64 basic block to x86_64
  *
- * Main translation entry point. Decodes ARM64 instructions
- * and emits equivalent x86_64 machine code.
+ * Main translation entry point. Blocks the IR front-end covers go through
+ * lowering, the optimizer and the IR back-end; the rest are decoded and
+ * emitted instruction by instruction.
  */
 void *translate_block(jit_context_t *ctx, u64 guest_pc)
 {
@@ -509,6 +553,8 @@ void *translate_block(jit_context_t *ctx, u64 guest_pc)
     int is_terminator = 0;
     int max_insns = 64;  /* Max instructions per block */
     int insn_count = 0;
+    u64 known_imm[32];   /* Constants built by MOVZ/MOVK chains */
+    u32 known_regs = 0;
 
     if (!ctx || !ctx->initialized) return NULL;
 
@@ -518,8 +564,18 @@ void *translate_block(jit_context_t *ctx, u64 guest_pc)
         return cached;
     }
 
-    /* Initialize code buffer at current code cache position */
     ctx->current_guest_pc = guest_pc;
+
+    code_size = translate_block_ir(ctx, guest_pc, max_insns);
+    if (code_size > 0) {
+        code_start = ctx->code_cache + ctx->code_cache_offset;
+        code_cache_mark_executable(ctx, ctx->code_cache_offset, code_size);
+        ctx->code_cache_offset += code_size;
+        translation_insert(ctx, guest_pc, (u64)(uintptr_t)code_start, code_size);
+        return code_start;
+    }
+
+    /* Initialize code buffer at current code cache position */
     code_buffer_init(&ctx->emit_buf,
                      ctx->code_cache + ctx->code_cache_offset,
                      ctx->code_cache_size - ctx->code_cache_offset);
@@ -544,6 +600,9 @@ void *translate_block(jit_context_t *ctx, u64 guest_pc)
         insn_encoding = *insn_ptr++;
         insn_count++;
 
+        /* Anything else may write Rd; only a MOVZ/MOVK chain keeps it known */
+        known_regs &= ~(1u << arm64_get_rd(insn_encoding));
+
         /* Dispatch based on instruction type */
         if (arm64_is_add(insn_encoding) || arm64_is_sub(insn_encoding)) {
             /* ADD/SUB: Translate to x86 ADD/SUB */
@@ -602,11 +661,17 @@ void *translate_block(jit_context_t *ctx, u64 guest_pc)
             u8 rn = arm64_get_rn(insn_encoding);
             emit_mov_mem_reg(&ctx->emit_buf, rn, rd, 0);
         } else if (arm64_is_movz(insn_encoding) || arm64_is_movk(insn_encoding)) {
-            /* MOVZ/MOVK: Translate to x86 MOV imm64 */
+            /* MOVZ/MOVK: Translate to x86 MOV imm64 of the value built so far */
             u8 rd = arm64_get_rd(insn_encoding);
             u16 imm16 = arm64_get_imm16(insn_encoding);
             u8 hw = arm64_get_hw(insn_encoding);
             u64 imm = (u64)imm16 << (hw * 16);
+
+            if (arm64_is_movk(insn_encoding) && (known_regs & (1u << rd))) {
+                imm |= known_imm[rd] & ~(0xFFFFULL << (hw * 16));
+            }
+            known_imm[rd] = imm;
+            known_regs |= 1u << rd;
             emit_mov_reg_imm64(&ctx->emit_buf, rd, imm);
         } else if (arm64_is_b(insn_encoding)) {
             /* B: Unconditional branch - emit JMP */
@@ -681,13 +746,13 @@ void *translate_block_fast(jit_context_t *ctx, u64 guest_pc)
  */
 u64 jit_execute(jit_context_t *ctx, u64 guest_pc, ThreadState *state)
 {
-    void (*host_func)(void);
+    void (*host_func)(ThreadState *);
     u64 next_pc;
 
-    if (!ctx || !ctx->initialized) return 0;
+    if (!ctx || !ctx->initialized || !state) return 0;
 
     /* Look up or translate */
-    host_func = (void (*)(void))translate_block(ctx, guest_pc);
+    host_func = (void (*)(ThreadState *))translate_block(ctx, guest_pc);
     if (!host_func) {
         return 0;  /* Translation failed */
     }
@@ -705,12 +770,11 @@ u64 jit_execute(jit_context_t *ctx, u64 guest_pc, ThreadState *state)
     /* The translated code will use the register mapping established
      * during translation (ARM64 Xn -> x86_64 Rn) */
 
-    /* Execute the translated block */
-    host_func();
-
-    /* Return next PC - in a full implementation, this would be
-     * determined by the block's exit condition (fall-through, branch, etc.) */
-    next_pc = guest_pc + 4;  /* Default: next instruction (ARM64 instructions are 4 bytes) */
+    /* Execute the translated block. IR blocks store their successor to
+     * host.pc; direct blocks leave the default, the next instruction. */
+    state->host.pc = guest_pc + 4;
+    host_func(state);
+    next_pc = state->host.pc;
 
     return next_pc;
 }
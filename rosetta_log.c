@@ -0,0 +1,173 @@
+/* ============================================================================
+ * Rosetta Translator - Leveled Logging
+ * ============================================================================
+ *
+ * Each thread formats into its own heap buffer, found through a
+ * _Thread_local pointer and registered with a pthread key so the buffer is
+ * written out when the thread exits. The main thread's buffer is written by
+ * an atexit handler, since key destructors do not run for it.
+ * ============================================================================ */
+
+#include "rosetta_log.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* ============================================================================
+ * Logger State
+ * ============================================================================ */
+
+typedef struct {
+    size_t len;
+    char buf[ROS_LOG_BUFFER_SIZE];
+} log_sink_t;
+
+int rosetta_log_threshold = ROS_LOG_LEVEL_WARN;
+
+static int g_log_fd = STDERR_FILENO;
+static pthread_once_t g_log_once = PTHREAD_ONCE_INIT;
+static pthread_key_t g_log_key;
+static _Thread_local log_sink_t *t_log_sink;
+
+static void log_write_out(log_sink_t *s)
+{
+    size_t done = 0;
+    int fd = __atomic_load_n(&g_log_fd, __ATOMIC_RELAXED);
+
+    while (done < s->len) {
+        ssize_t n = write(fd, s->buf + done, s->len - done);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;                      /* Nowhere to log to */
+        }
+        done += (size_t)n;
+    }
+    s->len = 0;
+}
+
+static void log_thread_exit(void *arg)
+{
+    log_sink_t *s = arg;
+
+    log_write_out(s);
+    t_log_sink = NULL;
+    free(s);
+}
+
+static void log_process_exit(void)
+{
+    rosetta_log_flush();
+}
+
+static void log_once(void)
+{
+    pthread_key_create(&g_log_key, log_thread_exit);
+    atexit(log_process_exit);
+}
+
+static log_sink_t *log_sink(void)
+{
+    log_sink_t *s = t_log_sink;
+
+    if (s) {
+        return s;
+    }
+    pthread_once(&g_log_once, log_once);
+    s = malloc(sizeof(*s));
+    if (!s) {
+        return NULL;
+    }
+    s->len = 0;
+    pthread_setspecific(g_log_key, s);
+    t_log_sink = s;
+    return s;
+}
+
+/* ============================================================================
+ * Logging API
+ * ============================================================================ */
+
+void rosetta_log_init(void)
+{
+    const char *env = getenv(ROS_LOG_ENV);
+
+    if (env && *env) {
+        rosetta_log_set_level(atoi(env));
+    }
+}
+
+void rosetta_log_set_level(int level)
+{
+    if (level < ROS_LOG_LEVEL_NONE) {
+        level = ROS_LOG_LEVEL_NONE;
+    } else if (level > ROS_LOG_LEVEL_TRACE) {
+        level = ROS_LOG_LEVEL_TRACE;
+    }
+    __atomic_store_n(&rosetta_log_threshold, level, __ATOMIC_RELAXED);
+}
+
+int rosetta_log_get_level(void)
+{
+    return __atomic_load_n(&rosetta_log_threshold, __ATOMIC_RELAXED);
+}
+
+void rosetta_log_set_fd(int fd)
+{
+    rosetta_log_flush();
+    __atomic_store_n(&g_log_fd, fd, __ATOMIC_RELAXED);
+}
+
+void rosetta_log_write(int level, const char *fmt, ...)
+{
+    log_sink_t *s = log_sink();
+    size_t room;
+    va_list ap;
+    int n;
+
+    if (!s) {
+        va_start(ap, fmt);
+        vfprintf(stderr, fmt, ap);
+        va_end(ap);
+        return;
+    }
+
+    room = sizeof(s->buf) - s->len;
+    va_start(ap, fmt);
+    n = vsnprintf(s->buf + s->len, room, fmt, ap);
+    va_end(ap);
+    if (n < 0) {
+        return;
+    }
+
+    if ((size_t)n >= room) {
+        /* Did not fit: write out what is buffered and format again */
+        log_write_out(s);
+        va_start(ap, fmt);
+        n = vsnprintf(s->buf, sizeof(s->buf), fmt, ap);
+        va_end(ap);
+        if (n < 0) {
+            return;
+        }
+        if ((size_t)n >= sizeof(s->buf)) {
+            n = (int)sizeof(s->buf) - 1;        /* Truncated */
+        }
+    }
+    s->len += (size_t)n;
+
+    if (level <= ROS_LOG_LEVEL_WARN) {
+        log_write_out(s);
+    }
+}
+
+void rosetta_log_flush(void)
+{
+    if (t_log_sink) {
+        log_write_out(t_log_sink);
+    }
+}
@@ -0,0 +1,102 @@
+/* ============================================================================
+ * Rosetta Translator - Leveled Logging
+ * ============================================================================
+ *
+ * Diagnostic output for the translation and execution paths. Messages above
+ * ROSETTA_LOG_MAX_LEVEL are removed at compile time; the rest are filtered
+ * against one cached runtime level before any argument is evaluated.
+ *
+ * Output is collected in a per-thread buffer and written to the log fd
+ * (stderr by default) when it fills, on rosetta_log_flush(), at thread exit
+ * and at process exit. Warnings and errors are written at once. The logger
+ * adds no prefix or newline, so one line may be built from several calls.
+ * ============================================================================ */
+
+#ifndef ROSETTA_LOG_H
+#define ROSETTA_LOG_H
+
+/* ============================================================================
+ * Log Levels
+ * ============================================================================ */
+
+#define ROS_LOG_LEVEL_NONE      0
+#define ROS_LOG_LEVEL_ERROR     1
+#define ROS_LOG_LEVEL_WARN      2
+#define ROS_LOG_LEVEL_INFO      3
+#define ROS_LOG_LEVEL_DEBUG     4       /* Per block */
+#define ROS_LOG_LEVEL_TRACE     5       /* Per instruction */
+
+/* Most verbose level compiled in; build with -DROSETTA_LOG_MAX_LEVEL=5 for all */
+#ifndef ROSETTA_LOG_MAX_LEVEL
+#define ROSETTA_LOG_MAX_LEVEL   ROS_LOG_LEVEL_INFO
+#endif
+
+#define ROS_LOG_BUFFER_SIZE     8192    /* Per-thread sink */
+
+/* Environment variable setting the runtime level at rosetta_log_init() */
+#define ROS_LOG_ENV             "ROSETTA_LOG_LEVEL"
+
+/* ============================================================================
+ * Logging API
+ * ============================================================================ */
+
+/* Runtime level; read through rosetta_log_enabled() */
+extern int rosetta_log_threshold;
+
+/**
+ * Check whether a level is logged, before formatting anything
+ */
+static inline int rosetta_log_enabled(int level)
+{
+    return level <= ROSETTA_LOG_MAX_LEVEL &&
+           level <= __atomic_load_n(&rosetta_log_threshold, __ATOMIC_RELAXED);
+}
+
+/**
+ * Set the runtime level from ROS_LOG_ENV, if set
+ */
+void rosetta_log_init(void);
+
+/**
+ * Set the runtime level
+ * @param level ROS_LOG_LEVEL_*
+ */
+void rosetta_log_set_level(int level);
+
+int rosetta_log_get_level(void);
+
+/**
+ * Send output to another fd, flushing the caller's buffer first
+ * @param fd Open file descriptor, owned by the caller
+ */
+void rosetta_log_set_fd(int fd);
+
+/**
+ * Append a message to the calling thread's buffer; use the macros instead
+ */
+void rosetta_log_write(int level, const char *fmt, ...)
+    __attribute__((format(printf, 2, 3)));
+
+/**
+ * Write out the calling thread's buffer
+ */
+void rosetta_log_flush(void);
+
+/* ============================================================================
+ * Logging Macros
+ * ============================================================================ */
+
+#define ROS_LOG(level, ...) \
+    do { \
+        if (rosetta_log_enabled(level)) { \
+            rosetta_log_write(level, __VA_ARGS__); \
+        } \
+    } while (0)
+
+#define ROS_LOG_ERROR(...)  ROS_LOG(ROS_LOG_LEVEL_ERROR, __VA_ARGS__)
+#define ROS_LOG_WARN(...)   ROS_LOG(ROS_LOG_LEVEL_WARN, __VA_ARGS__)
+#define ROS_LOG_INFO(...)   ROS_LOG(ROS_LOG_LEVEL_INFO, __VA_ARGS__)
+#define ROS_LOG_DEBUG(...)  ROS_LOG(ROS_LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define ROS_LOG_TRACE(...)  ROS_LOG(ROS_LOG_LEVEL_TRACE, __VA_ARGS__)
+
+#endif /* ROSETTA_LOG_H */
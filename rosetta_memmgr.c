@@ -7,6 +7,7 @@
  */
 
 #include "rosetta_memmgr.h"
+#include "rosetta_log.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -31,7 +32,7 @@ rosetta_memmgr_t *rosetta_memmgr_create(size_t size)
     /* Allocate memory manager structure */
     rosetta_memmgr_t *mgr = calloc(1, sizeof(rosetta_memmgr_t));
     if (!mgr) {
-        fprintf(stderr, "Failed to allocate memory manager\n");
+        ROS_LOG_ERROR("Failed to allocate memory manager\n");
         return NULL;
     }
 
@@ -42,7 +43,7 @@ rosetta_memmgr_t *rosetta_memmgr_create(size_t size)
                            -1, 0);
 
     if (host_mem == MAP_FAILED) {
-        fprintf(stderr, "Failed to allocate guest memory: %s\n", strerror(errno));
+        ROS_LOG_ERROR("Failed to allocate guest memory: %s\n", strerror(errno));
         free(mgr);
         return NULL;
     }
@@ -56,10 +57,10 @@ rosetta_memmgr_t *rosetta_memmgr_create(size_t size)
     mgr->num_mappings = 0;
     mgr->num_faults = 0;
 
-    printf("[MEMMGR] Created guest memory:\n");
-    printf("[MEMMGR]   Host:  %p\n", host_mem);
-    printf("[MEMMGR]   Guest: 0x0 (flat address space)\n");
-    printf("[MEMMGR]   Size:  %zu MB\n", size / (1024 * 1024));
+    ROS_LOG_DEBUG("[MEMMGR] Created guest memory:\n");
+    ROS_LOG_DEBUG("[MEMMGR]   Host:  %p\n", host_mem);
+    ROS_LOG_DEBUG("[MEMMGR]   Guest: 0x0 (flat address space)\n");
+    ROS_LOG_DEBUG("[MEMMGR]   Size:  %zu MB\n", size / (1024 * 1024));
 
     return mgr;
 }
@@ -86,7 +87,7 @@ void rosetta_memmgr_destroy(rosetta_memmgr_t *mgr)
         munmap(mgr->host_base, mgr->total_size);
     }
 
-    printf("[MEMMGR] Destroyed guest memory manager\n");
+    ROS_LOG_DEBUG("[MEMMGR] Destroyed guest memory manager\n");
     free(mgr);
 }
 
@@ -143,12 +144,11 @@ static inline void *guest_to_host_offset(rosetta_memmgr_t *mgr,
                                           uint64_t guest_addr)
 {
     /* Check if address is within guest memory range */
-    if (guest_addr >= mgr->total_size) {
+    if (guest_addr - mgr->guest_base >= mgr->total_size) {
         return NULL;
     }
 
-    /* Calculate offset (guest_base is 0, so guest_addr is the offset) */
-    return (char *)mgr->host_base + guest_addr;
+    return (char *)mgr->host_base + (guest_addr - mgr->guest_base);
 }
 
 /**
@@ -175,13 +175,13 @@ uint64_t rosetta_memmgr_alloc(rosetta_memmgr_t *mgr,
     /* Check if address is within guest memory range */
     void *host_addr = guest_to_host_offset(mgr, guest_addr);
     if (!host_addr) {
-        fprintf(stderr, "[MEMMGR] Invalid guest address: 0x%lx\n", guest_addr);
+        ROS_LOG_ERROR("[MEMMGR] Invalid guest address: 0x%lx\n", guest_addr);
         return 0;
     }
 
     /* Check for enough space */
     if (guest_addr + size > mgr->guest_base + mgr->total_size) {
-        fprintf(stderr, "[MEMMGR] Not enough memory\n");
+        ROS_LOG_ERROR("[MEMMGR] Not enough memory\n");
         return 0;
     }
 
@@ -192,13 +192,13 @@ uint64_t rosetta_memmgr_alloc(rosetta_memmgr_t *mgr,
         return 0;
     }
 
-    printf("[MEMMGR] Allocated: 0x%lx-0x%lx %c%c%c [%s]\n",
-           guest_addr,
-           guest_addr + size - 1,
-           (prot & ROSETTA_PROT_READ) ? 'R' : '-',
-           (prot & ROSETTA_PROT_WRITE) ? 'W' : '-',
-           (prot & ROSETTA_PROT_EXEC) ? 'X' : '-',
-           region->name);
+    ROS_LOG_DEBUG("[MEMMGR] Allocated: 0x%lx-0x%lx %c%c%c [%s]\n",
+                  guest_addr,
+                  guest_addr + size - 1,
+                  (prot & ROSETTA_PROT_READ) ? 'R' : '-',
+                  (prot & ROSETTA_PROT_WRITE) ? 'W' : '-',
+                  (prot & ROSETTA_PROT_EXEC) ? 'X' : '-',
+                  region->name);
 
     return guest_addr;
 }
@@ -223,13 +223,13 @@ uint64_t rosetta_memmgr_map_segment(rosetta_memmgr_t *mgr,
     /* Check if address is within guest memory range */
     void *target_host = guest_to_host_offset(mgr, guest_addr);
     if (!target_host) {
-        fprintf(stderr, "[MEMMGR] Invalid guest address: 0x%lx\n", guest_addr);
+        ROS_LOG_ERROR("[MEMMGR] Invalid guest address: 0x%lx\n", guest_addr);
         return 0;
     }
 
     /* Check for enough space */
     if (guest_addr + map_size > mgr->guest_base + mgr->total_size) {
-        fprintf(stderr, "[MEMMGR] Not enough memory for segment\n");
+        ROS_LOG_ERROR("[MEMMGR] Not enough memory for segment\n");
         return 0;
     }
 
@@ -245,32 +245,32 @@ uint64_t rosetta_memmgr_map_segment(rosetta_memmgr_t *mgr,
     rosetta_mem_region_t *region = add_region(mgr, guest_addr, target_host,
                                                 map_size, prot, name);
     if (!region) {
-        fprintf(stderr, "[MEMMGR] Failed to add region\n");
+        ROS_LOG_ERROR("[MEMMGR] Failed to add region\n");
         return 0;
     }
 
     /* Debug: Check region name before printing */
     if (!region->name) {
-        fprintf(stderr, "[MEMMGR] ERROR: region->name is NULL!\n");
+        ROS_LOG_ERROR("[MEMMGR] ERROR: region->name is NULL!\n");
         return 0;
     }
 
     /* Simplified printf to debug */
-    fprintf(stderr, "[MEMMGR DEBUG] About to print segment info\n");
-    fprintf(stderr, "[MEMMGR DEBUG] guest_addr=%lx map_size=%zu size=%zu\n",
-            guest_addr, map_size, size);
-    fprintf(stderr, "[MEMMGR DEBUG] region->name=%s\n", region->name);
-
-    printf("[MEMMGR] Mapped: 0x%lx-0x%lx %c%c%c [%s] (%zu bytes)\n",
-           guest_addr,
-           guest_addr + map_size - 1,
-           (prot & ROSETTA_PROT_READ) ? 'R' : '-',
-           (prot & ROSETTA_PROT_WRITE) ? 'W' : '-',
-           (prot & ROSETTA_PROT_EXEC) ? 'X' : '-',
-           region->name ? region->name : "(null)",
-           size);
-
-    fprintf(stderr, "[MEMMGR DEBUG] Printed successfully\n");
+    ROS_LOG_TRACE("[MEMMGR DEBUG] About to print segment info\n");
+    ROS_LOG_TRACE("[MEMMGR DEBUG] guest_addr=%lx map_size=%zu size=%zu\n",
+                  guest_addr, map_size, size);
+    ROS_LOG_TRACE("[MEMMGR DEBUG] region->name=%s\n", region->name);
+
+    ROS_LOG_DEBUG("[MEMMGR] Mapped: 0x%lx-0x%lx %c%c%c [%s] (%zu bytes)\n",
+                  guest_addr,
+                  guest_addr + map_size - 1,
+                  (prot & ROSETTA_PROT_READ) ? 'R' : '-',
+                  (prot & ROSETTA_PROT_WRITE) ? 'W' : '-',
+                  (prot & ROSETTA_PROT_EXEC) ? 'X' : '-',
+                  region->name ? region->name : "(null)",
+                  size);
+
+    ROS_LOG_TRACE("[MEMMGR DEBUG] Printed successfully\n");
 
     return guest_addr;
 }
@@ -289,13 +289,52 @@ void *rosetta_memmgr_guest_to_host(rosetta_memmgr_t *mgr,
         return NULL;
     }
 
-    /* Quick bounds check */
-    if (guest_addr >= mgr->total_size) {
+    return guest_to_host_offset(mgr, guest_addr);
+}
+
+/**
+ * Translate a whole guest range to host
+ */
+void *rosetta_memmgr_guest_range(rosetta_memmgr_t *mgr,
+                                  uint64_t guest_addr,
+                                  size_t size)
+{
+    uint64_t offset;
+
+    if (!mgr) {
+        return NULL;
+    }
+
+    /* One check covers the range; the wrap-around of guest_addr below
+     * guest_base lands far above total_size */
+    offset = guest_addr - mgr->guest_base;
+    if (offset >= mgr->total_size || size > mgr->total_size - offset) {
         return NULL;
     }
 
-    /* Calculate offset (guest_base is 0, so guest_addr is the offset) */
-    return (char *)mgr->host_base + guest_addr;
+    return (char *)mgr->host_base + offset;
+}
+
+/**
+ * Translate host address inside guest memory back to guest
+ */
+int rosetta_memmgr_host_to_guest(rosetta_memmgr_t *mgr,
+                                  const void *host_addr,
+                                  uint64_t *guest_addr)
+{
+    uintptr_t offset;
+
+    if (!mgr) {
+        return -1;
+    }
+
+    offset = (uintptr_t)host_addr - (uintptr_t)mgr->host_base;
+    if (offset >= mgr->total_size) {
+        return -1;
+    }
+
+    *guest_addr = mgr->guest_base + offset;
+    return 0;
 }
 
 /* ============================================================================
@@ -317,13 +356,13 @@ ssize_t rosetta_memmgr_read(rosetta_memmgr_t *mgr,
     /* Translate address */
     void *host_addr = rosetta_memmgr_guest_to_host(mgr, guest_addr);
     if (!host_addr) {
-        fprintf(stderr, "[MEMMGR] Invalid read address: 0x%lx\n", guest_addr);
+        ROS_LOG_ERROR("[MEMMGR] Invalid read address: 0x%lx\n", guest_addr);
         return -1;
     }
 
     /* Check bounds */
     if (guest_addr + size > mgr->total_size) {
-        fprintf(stderr, "[MEMMGR] Read out of bounds\n");
+        ROS_LOG_ERROR("[MEMMGR] Read out of bounds\n");
         return -1;
     }
 
@@ -347,13 +386,13 @@ ssize_t rosetta_memmgr_write(rosetta_memmgr_t *mgr,
     /* Translate address */
     void *host_addr = rosetta_memmgr_guest_to_host(mgr, guest_addr);
     if (!host_addr) {
-        fprintf(stderr, "[MEMMGR] Invalid write address: 0x%lx\n", guest_addr);
+        ROS_LOG_ERROR("[MEMMGR] Invalid write address: 0x%lx\n", guest_addr);
         return -1;
     }
 
     /* Check bounds */
     if (guest_addr + size > mgr->total_size) {
-        fprintf(stderr, "[MEMMGR] Write out of bounds\n");
+        ROS_LOG_ERROR("[MEMMGR] Write out of bounds\n");
         return -1;
     }
 
@@ -121,6 +121,28 @@ uint64_t rosetta_memmgr_map_segment(rosetta_memmgr_t *mgr,
 void *rosetta_memmgr_guest_to_host(rosetta_memmgr_t *mgr,
                                     uint64_t guest_addr);
 
+/**
+ * Translate a guest address range to host, validating all of it
+ * @param mgr Memory manager
+ * @param guest_addr First guest byte
+ * @param size Range length in bytes
+ * @return Host address of guest_addr, or NULL if any byte is outside guest memory
+ */
+void *rosetta_memmgr_guest_range(rosetta_memmgr_t *mgr,
+                                  uint64_t guest_addr,
+                                  size_t size);
+
+/**
+ * Translate host address inside guest memory back to guest
+ * @param mgr Memory manager
+ * @param host_addr Host address
+ * @param guest_addr Output: guest virtual address
+ * @return 0 on success, -1 if host_addr is not guest memory
+ */
+int rosetta_memmgr_host_to_guest(rosetta_memmgr_t *mgr,
+                                  const void *host_addr,
+                                  uint64_t *guest_addr);
+
 /**
  * Read from guest memory
  * @param mgr Memory manager
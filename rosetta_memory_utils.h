@@ -26,15 +26,6 @@
  */
 void *rosetta_memcpy_aligned(void *dest, const void *src, size_t n);
 
-/**
- * SIMD-optimized memset
- * @param s Memory region
- * @param c Value to set
- * @param n Number of bytes
- * @return Pointer to memory region
- */
-void *rosetta_memset_simd(void *s, int c, size_t n);
-
 /**
  * SIMD-optimized memory search for null bytes
  * @param ptr Pointer to memory to search
@@ -51,14 +42,7 @@ void *rosetta_memchr_simd_nul(const void *ptr, long len);
  */
 void *rosetta_memchr_simd_unaligned_nul(const void *ptr, long len);
 
-/**
- * SIMD-optimized memory compare
- * @param s1 First memory region
- * @param s2 Second memory region
- * @param n Number of bytes to compare
- * @return Difference between first differing bytes, or 0 if equal
- */
-int rosetta_memcmp_simd(const void *s1, const void *s2, size_t n);
+/* rosetta_memset_simd() and rosetta_memcmp_simd() live in rosetta_string_simd.h */
 
 /* ============================================================================
  * Standard Memory Operations (Session 14)
@@ -0,0 +1,87 @@
+/* ============================================================================
+ * Rosetta MXCSR Emulation
+ * ============================================================================
+ *
+ * Conversions between the guest MXCSR and the host FPCR/FPSR, and the
+ * runtime side of the lazy flag scheme described in rosetta_mxcsr.h.
+ * Translated LDMXCSR/STMXCSR do the same inline
+ * (rosetta_translate_mxcsr.c).
+ * ============================================================================ */
+
+#include "rosetta_mxcsr.h"
+
+/* FP register access - defined in rosetta_refactored_helpers.c */
+extern uint32_t read_fpsr(void);
+extern uint32_t read_fpcr(void);
+extern void write_fpsr(uint32_t val);
+extern void write_fpcr(uint32_t val);
+
+/* ============================================================================
+ * Conversions
+ * ============================================================================ */
+
+uint32_t rosetta_mxcsr_to_fpcr(uint32_t mxcsr)
+{
+    uint32_t rc = (mxcsr >> MXCSR_RC_SHIFT) & 3;
+    uint32_t fpcr;
+
+    /* Down and up swap places: MXCSR 1 is RM (2), 2 is RP (1) */
+    fpcr = (((rc & 1) << 1) | (rc >> 1)) << FPCR_RMODE_SHIFT;
+    if (mxcsr & (MXCSR_FZ | MXCSR_DAZ)) {
+        fpcr |= FPCR_FZ;
+    }
+    return fpcr;
+}
+
+uint32_t rosetta_mxcsr_flags_from_fpsr(uint32_t fpsr)
+{
+    /* IOC is IE; DZC, OFC, UFC and IXC are ZE, OE, UE and PE one bit up */
+    return (fpsr & FPSR_IOC) | ((fpsr & (FPSR_DZC | FPSR_OFC | FPSR_UFC | FPSR_IXC)) << 1);
+}
+
+/* ============================================================================
+ * Guest State
+ * ============================================================================ */
+
+void rosetta_mxcsr_reset(x86_context_t *guest)
+{
+    guest->mxcsr = MXCSR_DEFAULT;
+}
+
+void rosetta_mxcsr_enter(ThreadState *state)
+{
+    uint32_t fpcr = read_fpcr();
+
+    fpcr = (fpcr & ~FPCR_MXCSR_BITS) | rosetta_mxcsr_to_fpcr(state->guest.mxcsr);
+    state->host.fpcr = fpcr;
+    state->host.fpsr = 0;
+    write_fpcr(fpcr);
+    write_fpsr(0);
+}
+
+uint32_t rosetta_mxcsr_read(ThreadState *state)
+{
+    state->host.fpsr = read_fpsr();
+    state->guest.mxcsr |= rosetta_mxcsr_flags_from_fpsr(state->host.fpsr);
+    return state->guest.mxcsr;
+}
+
+void rosetta_mxcsr_resume(ThreadState *state)
+{
+    state->host.fpsr = 0;
+    write_fpsr(0);
+}
+
+void rosetta_mxcsr_write(ThreadState *state, uint32_t mxcsr)
+{
+    uint32_t fpcr = read_fpcr();
+    uint32_t want = (fpcr & ~FPCR_MXCSR_BITS) | rosetta_mxcsr_to_fpcr(mxcsr);
+
+    state->guest.mxcsr = mxcsr;
+    if (want != fpcr) {
+        write_fpcr(want);
+    }
+    state->host.fpcr = want;
+    state->host.fpsr = 0;
+    write_fpsr(0);
+}
@@ -0,0 +1,104 @@
+/* ============================================================================
+ * Rosetta MXCSR Emulation Header
+ * ============================================================================
+ *
+ * The guest MXCSR lives in ThreadState.guest.mxcsr and is carried by the
+ * host FP registers while translated code runs:
+ *
+ * - Control: FPCR mirrors the rounding control and FZ/DAZ, so SSE
+ *   arithmetic rounds the way the guest selected. FPCR is written on
+ *   entry and by LDMXCSR, and only when the value changes.
+ * - Flags: FPSR accumulates the flags raised since the last LDMXCSR.
+ *   They are folded into guest.mxcsr when the guest reads MXCSR
+ *   (STMXCSR, or rosetta_mxcsr_read() for signal frames and FXSAVE),
+ *   never per instruction.
+ *
+ * Fast-mode x87 code swaps this for FPCR rounding as the x87 control word
+ * selects (FZ clear) and folds its FPSR flags into the status word; see
+ * rosetta_translate_mxcsr.h.
+ *
+ * Known differences: DE (denormal operand) is never raised, FZ and DAZ
+ * both select FPCR.FZ (flush inputs and outputs), and unmasked exceptions
+ * behave as masked. Fast-mode x87 ignores the control word's precision
+ * control: every result is rounded to double, with a double's exponent
+ * range, whether PC selects single, double or extended precision.
+ * ============================================================================ */
+
+#ifndef ROSETTA_MXCSR_H
+#define ROSETTA_MXCSR_H
+
+#include "rosetta_types.h"
+
+/* ============================================================================
+ * MXCSR and FPCR/FPSR Bits
+ * ============================================================================ */
+
+#define MXCSR_IE            0x0001  /* Invalid operation */
+#define MXCSR_DE            0x0002  /* Denormal operand */
+#define MXCSR_ZE            0x0004  /* Zero divide */
+#define MXCSR_OE            0x0008  /* Overflow */
+#define MXCSR_UE            0x0010  /* Underflow */
+#define MXCSR_PE            0x0020  /* Precision */
+#define MXCSR_FLAGS         0x003F
+#define MXCSR_DAZ           0x0040  /* Denormals are zero */
+#define MXCSR_MASKS         0x1F80  /* Exception masks, bits 7-12 */
+#define MXCSR_RC_SHIFT      13      /* 0: nearest, 1: down, 2: up, 3: toward zero */
+#define MXCSR_FZ            0x8000  /* Flush to zero */
+#define MXCSR_DEFAULT       0x1F80  /* All masked, round to nearest */
+
+#define FPCR_RMODE_SHIFT    22      /* 0: RN, 1: RP, 2: RM, 3: RZ */
+#define FPCR_FZ             (1u << 24)
+#define FPCR_MXCSR_BITS     ((3u << FPCR_RMODE_SHIFT) | FPCR_FZ)
+
+#define FPSR_IOC            0x01    /* Cumulative flags, in MXCSR order from IOC */
+#define FPSR_DZC            0x02
+#define FPSR_OFC            0x04
+#define FPSR_UFC            0x08
+#define FPSR_IXC            0x10
+#define FPSR_IDC            0x80    /* Input denormal (flushed), not DE */
+
+/* ============================================================================
+ * Conversions
+ * ============================================================================ */
+
+/**
+ * FPCR RMode and FZ for an MXCSR value (other FPCR bits are zero)
+ */
+uint32_t rosetta_mxcsr_to_fpcr(uint32_t mxcsr);
+
+/**
+ * MXCSR exception flags for the FPSR cumulative flags
+ */
+uint32_t rosetta_mxcsr_flags_from_fpsr(uint32_t fpsr);
+
+/* ============================================================================
+ * Guest State
+ * ============================================================================ */
+
+/**
+ * Put the guest MXCSR in its reset state
+ */
+void rosetta_mxcsr_reset(x86_context_t *guest);
+
+/**
+ * Load FPCR and FPSR for guest.mxcsr before running translated code
+ */
+void rosetta_mxcsr_enter(ThreadState *state);
+
+/**
+ * Current guest MXCSR, with the flags pending in FPSR folded in
+ */
+uint32_t rosetta_mxcsr_read(ThreadState *state);
+
+/**
+ * Clear FPSR before running translated code again after C code ran; the
+ * guest flags must have been folded by rosetta_mxcsr_read()
+ */
+void rosetta_mxcsr_resume(ThreadState *state);
+
+/**
+ * Set the guest MXCSR (LDMXCSR, FXRSTOR, signal return)
+ */
+void rosetta_mxcsr_write(ThreadState *state, uint32_t mxcsr);
+
+#endif /* ROSETTA_MXCSR_H */
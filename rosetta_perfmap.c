@@ -0,0 +1,262 @@
+/* ============================================================================
+ * Rosetta Translator - Linux perf Integration
+ * ============================================================================
+ *
+ * The jitdump layout follows tools/perf/Documentation/jitdump-specification
+ * in the Linux tree: a file header, then one JIT_CODE_LOAD record (with the
+ * code bytes) per block and a JIT_CODE_CLOSE record at the end. perf only
+ * picks the file up if the process maps it executable, which is done once
+ * at open. Record timestamps use CLOCK_MONOTONIC, hence perf record -k 1.
+ * ============================================================================ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE                     /* syscall() */
+#endif
+
+#include "rosetta_perfmap.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+/* ============================================================================
+ * jitdump Format
+ * ============================================================================ */
+
+#define JITDUMP_MAGIC           0x4A695444  /* "JiTD" */
+#define JITDUMP_VERSION         1
+#define JIT_CODE_LOAD           0
+#define JIT_CODE_CLOSE          3
+
+#define ELF_MACH_AARCH64        183
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t total_size;
+    uint32_t elf_mach;
+    uint32_t pad1;
+    uint32_t pid;
+    uint64_t timestamp;
+    uint64_t flags;
+} jitdump_header_t;
+
+typedef struct {
+    uint32_t id;
+    uint32_t total_size;
+    uint64_t timestamp;
+} jitdump_record_t;
+
+typedef struct {
+    jitdump_record_t rec;
+    uint32_t pid;
+    uint32_t tid;
+    uint64_t vma;
+    uint64_t code_addr;
+    uint64_t code_size;
+    uint64_t code_index;
+    /* Followed by the NUL-terminated name and the code bytes */
+} jitdump_code_load_t;
+
+/* ============================================================================
+ * Perf Map State
+ * ============================================================================ */
+
+static pthread_mutex_t g_perf_lock = PTHREAD_MUTEX_INITIALIZER;
+static rosetta_elf_binary_t *g_perf_binary;
+static FILE *g_perf_map;
+static FILE *g_jitdump;
+static void *g_jitdump_marker;
+static size_t g_jitdump_marker_size;
+static uint64_t g_code_index;
+static int g_perf_flags;
+
+static uint64_t perf_timestamp(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static uint32_t perf_tid(void)
+{
+#if defined(__linux__) && defined(SYS_gettid)
+    return (uint32_t)syscall(SYS_gettid);
+#else
+    return (uint32_t)getpid();
+#endif
+}
+
+static uint32_t perf_host_mach(void)
+{
+#if defined(__aarch64__)
+    return ELF_MACH_AARCH64;
+#else
+    return EM_X86_64;
+#endif
+}
+
+static int jitdump_open(const char *path)
+{
+    jitdump_header_t hdr;
+    long page = sysconf(_SC_PAGESIZE);
+
+    g_jitdump = fopen(path, "w+");
+    if (!g_jitdump) {
+        return -errno;
+    }
+
+    /* perf finds the dump through this executable mapping */
+    g_jitdump_marker_size = page > 0 ? (size_t)page : 4096;
+    g_jitdump_marker = mmap(NULL, g_jitdump_marker_size, PROT_READ | PROT_EXEC,
+                            MAP_PRIVATE, fileno(g_jitdump), 0);
+    if (g_jitdump_marker == MAP_FAILED) {
+        int err = errno;
+        g_jitdump_marker = NULL;
+        fclose(g_jitdump);
+        g_jitdump = NULL;
+        return -err;
+    }
+
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = JITDUMP_MAGIC;
+    hdr.version = JITDUMP_VERSION;
+    hdr.total_size = sizeof(hdr);
+    hdr.elf_mach = perf_host_mach();
+    hdr.pid = (uint32_t)getpid();
+    hdr.timestamp = perf_timestamp();
+    fwrite(&hdr, sizeof(hdr), 1, g_jitdump);
+    fflush(g_jitdump);
+    return 0;
+}
+
+static void jitdump_close(void)
+{
+    jitdump_record_t rec;
+
+    if (!g_jitdump) {
+        return;
+    }
+    rec.id = JIT_CODE_CLOSE;
+    rec.total_size = sizeof(rec);
+    rec.timestamp = perf_timestamp();
+    fwrite(&rec, sizeof(rec), 1, g_jitdump);
+
+    munmap(g_jitdump_marker, g_jitdump_marker_size);
+    g_jitdump_marker = NULL;
+    fclose(g_jitdump);
+    g_jitdump = NULL;
+}
+
+/* ============================================================================
+ * Perf Map API
+ * ============================================================================ */
+
+int rosetta_perfmap_open(rosetta_elf_binary_t *binary, int flags)
+{
+    char path[64];
+    int ret = 0;
+
+    pthread_mutex_lock(&g_perf_lock);
+    if (g_perf_flags) {
+        g_perf_binary = binary;
+        pthread_mutex_unlock(&g_perf_lock);
+        return 0;
+    }
+    g_perf_binary = binary;
+
+    if (flags & ROS_PERFMAP_MAP) {
+        snprintf(path, sizeof(path), "/tmp/perf-%d.map", (int)getpid());
+        g_perf_map = fopen(path, "w");
+        if (!g_perf_map) {
+            ret = -errno;
+            goto out;
+        }
+        g_perf_flags |= ROS_PERFMAP_MAP;
+    }
+
+    if (flags & ROS_PERFMAP_JITDUMP) {
+        snprintf(path, sizeof(path), "/tmp/jit-%d.dump", (int)getpid());
+        ret = jitdump_open(path);
+        if (ret != 0) {
+            goto out;
+        }
+        g_perf_flags |= ROS_PERFMAP_JITDUMP;
+    }
+
+out:
+    pthread_mutex_unlock(&g_perf_lock);
+    return ret;
+}
+
+void rosetta_perfmap_record_block(const void *host_code, uint32_t host_size,
+                                  uint64_t guest_pc)
+{
+    char name[256];
+    const char *sym;
+    uint64_t off = 0;
+
+    if (!__atomic_load_n(&g_perf_flags, __ATOMIC_RELAXED) || !host_code || host_size == 0) {
+        return;
+    }
+
+    pthread_mutex_lock(&g_perf_lock);
+
+    sym = g_perf_binary ? rosetta_elf_symbolize(g_perf_binary, guest_pc, &off) : NULL;
+    if (sym) {
+        snprintf(name, sizeof(name), "guest:%s+0x%llx", sym, (unsigned long long)off);
+    } else {
+        snprintf(name, sizeof(name), "guest:0x%llx", (unsigned long long)guest_pc);
+    }
+
+    if (g_perf_map) {
+        fprintf(g_perf_map, "%llx %x %s\n",
+                (unsigned long long)(uintptr_t)host_code, host_size, name);
+        fflush(g_perf_map);
+    }
+
+    if (g_jitdump) {
+        jitdump_code_load_t load;
+        size_t name_len = strlen(name) + 1;
+
+        load.rec.id = JIT_CODE_LOAD;
+        load.rec.total_size = (uint32_t)(sizeof(load) + name_len + host_size);
+        load.rec.timestamp = perf_timestamp();
+        load.pid = (uint32_t)getpid();
+        load.tid = perf_tid();
+        load.vma = (uint64_t)(uintptr_t)host_code;
+        load.code_addr = load.vma;
+        load.code_size = host_size;
+        load.code_index = g_code_index++;
+
+        fwrite(&load, sizeof(load), 1, g_jitdump);
+        fwrite(name, name_len, 1, g_jitdump);
+        fwrite(host_code, host_size, 1, g_jitdump);
+        fflush(g_jitdump);
+    }
+
+    pthread_mutex_unlock(&g_perf_lock);
+}
+
+void rosetta_perfmap_close(void)
+{
+    pthread_mutex_lock(&g_perf_lock);
+    if (g_perf_map) {
+        fclose(g_perf_map);
+        g_perf_map = NULL;
+    }
+    jitdump_close();
+    g_perf_binary = NULL;
+    __atomic_store_n(&g_perf_flags, 0, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&g_perf_lock);
+}
+
+int rosetta_perfmap_flags(void)
+{
+    return __atomic_load_n(&g_perf_flags, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,66 @@
+/* ============================================================================
+ * Rosetta Translator - Linux perf Integration
+ * ============================================================================
+ *
+ * Describes translated blocks to host perf so samples in the code cache are
+ * attributed to guest functions instead of one anonymous region.
+ *
+ * Two outputs are supported:
+ *   /tmp/perf-<pid>.map   Text map read by perf report directly
+ *   /tmp/jit-<pid>.dump   jitdump with code bytes, merged by perf inject --jit
+ *
+ * Usage with jitdump:
+ *   perf record -k 1 -g ./rosetta ...
+ *   perf inject --jit -i perf.data -o perf.jit.data
+ *   perf report -i perf.jit.data
+ * ============================================================================ */
+
+#ifndef ROSETTA_PERFMAP_H
+#define ROSETTA_PERFMAP_H
+
+#include "rosetta_elf_loader.h"
+#include <stdint.h>
+
+/* ============================================================================
+ * Configuration
+ * ============================================================================ */
+
+#define ROS_PERFMAP_MAP         0x1     /* Write /tmp/perf-<pid>.map */
+#define ROS_PERFMAP_JITDUMP     0x2     /* Write /tmp/jit-<pid>.dump */
+
+/* Environment variable selecting the outputs: "1" map, "2" jitdump, "3" both */
+#define ROS_PERFMAP_ENV         "ROSETTA_PERF_MAP"
+
+/* ============================================================================
+ * Perf Map API
+ * ============================================================================ */
+
+/**
+ * Open the perf outputs for this process
+ * @param binary Guest binary used to name blocks, may be NULL
+ * @param flags ROS_PERFMAP_* outputs to write
+ * @return 0 on success, -errno on failure
+ */
+int rosetta_perfmap_open(rosetta_elf_binary_t *binary, int flags);
+
+/**
+ * Describe one block placed in the code cache; a no-op when closed
+ * @param host_code Start of the host code, final and executable
+ * @param host_size Host code bytes
+ * @param guest_pc Guest pc the block translates
+ */
+void rosetta_perfmap_record_block(const void *host_code, uint32_t host_size,
+                                  uint64_t guest_pc);
+
+/**
+ * Flush and close the outputs; call before the guest binary is unloaded
+ */
+void rosetta_perfmap_close(void);
+
+/**
+ * Get the outputs currently open
+ * @return ROS_PERFMAP_* flags, 0 when closed
+ */
+int rosetta_perfmap_flags(void);
+
+#endif /* ROSETTA_PERFMAP_H */
@@ -0,0 +1,206 @@
+/* ============================================================================
+ * Rosetta Translator - Host Polynomial Multiply Primitives
+ * ============================================================================
+ *
+ * Table implementations for every host: the 64-bit form walks a four bits
+ * at a time against the sixteen multiples of b, the 8-bit form looks up
+ * each nibble of a in a 16 x 256 product table. On x86_64 the 64-bit form
+ * is one PCLMULQDQ, and the 8-bit form is bit-sliced across eight 16-bit
+ * lanes with SSE2, which has no per-lane table lookup that could index by
+ * both operands.
+ * ============================================================================ */
+
+#include "rosetta_pmull.h"
+#include <errno.h>
+#include <pthread.h>
+#include <string.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define PCLMUL  __attribute__((target("pclmul,sse2")))
+#endif
+
+/* clmul(i, j) for a nibble i and a byte j */
+static uint16_t g_nibble_products[16][256];
+
+static uint32_t g_hw_supported;
+static uint32_t g_hw;
+static pthread_once_t g_pmull_once = PTHREAD_ONCE_INIT;
+
+/* ============================================================================
+ * Feature Selection
+ * ============================================================================ */
+
+static void pmull_init_once(void)
+{
+    int i, j, k;
+
+    for (i = 0; i < 16; i++) {
+        for (j = 0; j < 256; j++) {
+            uint16_t p = 0;
+
+            for (k = 0; k < 4; k++) {
+                if (i & (1 << k)) {
+                    p ^= (uint16_t)(j << k);
+                }
+            }
+            g_nibble_products[i][j] = p;
+        }
+    }
+
+#if defined(__x86_64__)
+    g_hw_supported |= ROS_PMULL_HW_SSE2;
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("pclmul")) {
+        g_hw_supported |= ROS_PMULL_HW_PCLMUL;
+    }
+#endif
+    __atomic_store_n(&g_hw, g_hw_supported, __ATOMIC_RELEASE);
+}
+
+uint32_t rosetta_pmull_hw_supported(void)
+{
+    pthread_once(&g_pmull_once, pmull_init_once);
+    return g_hw_supported;
+}
+
+uint32_t rosetta_pmull_hw(void)
+{
+    pthread_once(&g_pmull_once, pmull_init_once);
+    return __atomic_load_n(&g_hw, __ATOMIC_ACQUIRE);
+}
+
+int rosetta_pmull_set_hw(uint32_t hw)
+{
+    pthread_once(&g_pmull_once, pmull_init_once);
+    if (hw & ~g_hw_supported) {
+        return -ENOTSUP;
+    }
+    __atomic_store_n(&g_hw, hw, __ATOMIC_RELEASE);
+    return 0;
+}
+
+/* ============================================================================
+ * Table Implementation
+ * ============================================================================ */
+
+static uint64_t load64(const uint8_t *p)
+{
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return v;
+}
+
+/* 128-bit a * b, four bits of a per step */
+static void table_mul64(uint8_t *out, uint64_t a, uint64_t b)
+{
+    uint64_t lo[16], hi[16];
+    uint64_t rlo = 0, rhi = 0;
+    int i;
+
+    lo[0] = hi[0] = 0;
+    lo[1] = b;
+    hi[1] = 0;
+    for (i = 2; i < 16; i += 2) {
+        lo[i] = lo[i / 2] << 1;
+        hi[i] = (hi[i / 2] << 1) | (lo[i / 2] >> 63);
+        lo[i + 1] = lo[i] ^ b;
+        hi[i + 1] = hi[i];
+    }
+    for (i = 60; i >= 0; i -= 4) {
+        unsigned n = (unsigned)(a >> i) & 15;
+
+        rhi = (rhi << 4) | (rlo >> 60);
+        rlo <<= 4;
+        rlo ^= lo[n];
+        rhi ^= hi[n];
+    }
+    memcpy(out, &rlo, 8);
+    memcpy(out + 8, &rhi, 8);
+}
+
+static void table_step(rosetta_pmull_op_t op, uint8_t *out, const uint8_t *a,
+                       const uint8_t *b)
+{
+    int half = (op == ROS_PMULL2_64 || op == ROS_PMULL2_8) ? 8 : 0;
+
+    if (op == ROS_PMULL_64 || op == ROS_PMULL2_64) {
+        table_mul64(out, load64(a + half), load64(b + half));
+    } else {
+        uint16_t p[8];
+        int i;
+
+        for (i = 0; i < 8; i++) {
+            uint8_t x = a[half + i], y = b[half + i];
+            p[i] = g_nibble_products[x & 15][y] ^ (uint16_t)(g_nibble_products[x >> 4][y] << 4);
+        }
+        memcpy(out, p, 16);
+    }
+}
+
+/* ============================================================================
+ * x86_64 Kernels
+ * ============================================================================ */
+
+#if defined(__x86_64__)
+
+static PCLMUL void pclmul_step(rosetta_pmull_op_t op, uint8_t *out, const uint8_t *a,
+                               const uint8_t *b)
+{
+    __m128i x = _mm_loadu_si128((const __m128i *)a);
+    __m128i y = _mm_loadu_si128((const __m128i *)b);
+
+    x = op == ROS_PMULL_64 ? _mm_clmulepi64_si128(x, y, 0x00)
+                           : _mm_clmulepi64_si128(x, y, 0x11);
+    _mm_storeu_si128((__m128i *)out, x);
+}
+
+/* Eight 8 x 8 products: for each bit i of a, XOR in b << i where it is set */
+static void sse2_step8(rosetta_pmull_op_t op, uint8_t *out, const uint8_t *a,
+                       const uint8_t *b)
+{
+    __m128i z = _mm_setzero_si128();
+    __m128i x = _mm_loadu_si128((const __m128i *)a);
+    __m128i y = _mm_loadu_si128((const __m128i *)b);
+    __m128i r = z;
+
+    if (op == ROS_PMULL2_8) {
+        x = _mm_unpackhi_epi8(x, z);
+        y = _mm_unpackhi_epi8(y, z);
+    } else {
+        x = _mm_unpacklo_epi8(x, z);
+        y = _mm_unpacklo_epi8(y, z);
+    }
+#define PMULL_BIT(i) \
+    r = _mm_xor_si128(r, _mm_and_si128(_mm_srai_epi16(_mm_slli_epi16(x, 15 - (i)), 15), \
+                                       _mm_slli_epi16(y, (i))))
+    PMULL_BIT(0); PMULL_BIT(1); PMULL_BIT(2); PMULL_BIT(3);
+    PMULL_BIT(4); PMULL_BIT(5); PMULL_BIT(6); PMULL_BIT(7);
+#undef PMULL_BIT
+    _mm_storeu_si128((__m128i *)out, r);
+}
+
+#endif /* __x86_64__ */
+
+/* ============================================================================
+ * Public Entry Point
+ * ============================================================================ */
+
+void rosetta_pmull_step(rosetta_pmull_op_t op, uint8_t out[16], const uint8_t a[16],
+                        const uint8_t b[16])
+{
+    uint32_t hw = rosetta_pmull_hw();
+
+#if defined(__x86_64__)
+    if ((op == ROS_PMULL_64 || op == ROS_PMULL2_64) && (hw & ROS_PMULL_HW_PCLMUL)) {
+        pclmul_step(op, out, a, b);
+        return;
+    }
+    if ((op == ROS_PMULL_8 || op == ROS_PMULL2_8) && (hw & ROS_PMULL_HW_SSE2)) {
+        sse2_step8(op, out, a, b);
+        return;
+    }
+#endif
+    (void)hw;
+    table_step(op, out, a, b);
+}
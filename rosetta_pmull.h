@@ -0,0 +1,71 @@
+/* ============================================================================
+ * Rosetta Translator - Host Polynomial Multiply Primitives Header
+ * ============================================================================
+ *
+ * ARM64 PMULL/PMULL2 multiply polynomials over GF(2) without carries, in
+ * two element sizes:
+ *
+ *   PMULL  Vd.1Q, Vn.1D, Vm.1D   64 x 64 -> 128 on the low halves, the
+ *                                GHASH and CRC folding workhorse;
+ *                                PCLMULQDQ with selector 0x00
+ *   PMULL2 Vd.1Q, Vn.2D, Vm.2D   the same on the high halves, selector 0x11
+ *   PMULL  Vd.8H, Vn.8B, Vm.8B   eight 8 x 8 -> 16 products, no x86
+ *   PMULL2 Vd.8H, Vn.16B, Vm.16B counterpart
+ *
+ * This module runs single steps for the interpreter path and for tests:
+ * PCLMULQDQ or a four-bit windowed table for the 64-bit form, and an SSE2
+ * bit-sliced kernel or a nibble product table for the 8-bit form. The IR
+ * x86_64 back-end emits the same sequences inline.
+ *
+ * Vectors are 16 bytes in memory order, as in vec128_t.u8.
+ * ============================================================================ */
+
+#ifndef ROSETTA_PMULL_H
+#define ROSETTA_PMULL_H
+
+#include <stdint.h>
+
+/* Single PMULL steps; IR_PMULL numbers its ir_pmull_op_t the same way */
+typedef enum {
+    ROS_PMULL_64 = 0,       /* PMULL Vd.1Q: low 64-bit halves */
+    ROS_PMULL2_64,          /* PMULL2 Vd.1Q: high 64-bit halves */
+    ROS_PMULL_8,            /* PMULL Vd.8H: bytes 0-7 */
+    ROS_PMULL2_8,           /* PMULL2 Vd.8H: bytes 8-15 */
+    ROS_PMULL_OP_COUNT
+} rosetta_pmull_op_t;
+
+/* Host features rosetta_pmull_hw() may report */
+#define ROS_PMULL_HW_SSE2       0x1     /* Bit-sliced 8-bit form */
+#define ROS_PMULL_HW_PCLMUL     0x2     /* PCLMULQDQ for the 64-bit form */
+
+/**
+ * rosetta_pmull_hw_supported - Features this CPU has (ROS_PMULL_HW_*)
+ */
+uint32_t rosetta_pmull_hw_supported(void);
+
+/**
+ * rosetta_pmull_hw - Features currently in use (ROS_PMULL_HW_*)
+ */
+uint32_t rosetta_pmull_hw(void);
+
+/**
+ * rosetta_pmull_set_hw - Restrict the features in use
+ * @param hw ROS_PMULL_HW_* mask; 0 forces the table implementation
+ * @return 0 on success, -ENOTSUP if hw names a feature this CPU lacks
+ *
+ * Without PCLMULQDQ the IR x86_64 back-end declines blocks containing the
+ * 64-bit form, leaving them to the interpreter.
+ */
+int rosetta_pmull_set_hw(uint32_t hw);
+
+/**
+ * rosetta_pmull_step - One PMULL or PMULL2
+ * @param op Step to perform
+ * @param out 128-bit product(s), may alias either input
+ * @param a First operand (Vn)
+ * @param b Second operand (Vm)
+ */
+void rosetta_pmull_step(rosetta_pmull_op_t op, uint8_t out[16], const uint8_t a[16],
+                        const uint8_t b[16]);
+
+#endif /* ROSETTA_PMULL_H */
@@ -7,6 +7,7 @@
  * ============================================================================ */
 
 #include "rosetta_procfs.h"
+#include "rosetta_vdso.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -328,25 +329,31 @@ int rosetta_proc_generate_auxv(char *buf, size_t size)
         return -1;
     }
 
-    /* Fake auxiliary vector - minimal set for compatibility */
-    unsigned long auxv[] = {
-        6,   /* AT_PAGESZ */
-        16,  /* AT_CLKTCK */
-        17,  /* AT_PHDR */
-        3,   /* AT_PHENT */
-        4,   /* AT_PHNUM */
-        5,   /* AT_BASE */
-        9,   /* AT_ENTRY */
-        0    /* AT_NULL */
+    /* Auxiliary vector as (type, value) pairs, terminated by AT_NULL */
+    unsigned long auxv[][2] = {
+        {AT_SYSINFO_EHDR, (unsigned long)rosetta_vdso_base()},
+        {6,  4096},  /* AT_PAGESZ */
+        {16, 0},     /* AT_HWCAP */
+        {17, 100},   /* AT_CLKTCK */
+        {3,  0},     /* AT_PHDR */
+        {4,  0},     /* AT_PHENT */
+        {5,  0},     /* AT_PHNUM */
+        {7,  0},     /* AT_BASE */
+        {9,  0},     /* AT_ENTRY */
+        {0,  0}      /* AT_NULL */
     };
 
     int offset = 0;
     for (int i = 0; i < (int)(sizeof(auxv)/sizeof(auxv[0])); i++) {
+        /* No vDSO mapped: omit AT_SYSINFO_EHDR entirely */
+        if (auxv[i][0] == AT_SYSINFO_EHDR && auxv[i][1] == 0) {
+            continue;
+        }
         if (offset + 16 > (int)size) {
             break;
         }
-        memcpy(buf + offset, &auxv[i], 8);
-        offset += 8;
+        memcpy(buf + offset, auxv[i], 16);
+        offset += 16;
     }
 
     return offset;
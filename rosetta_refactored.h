@@ -564,7 +564,6 @@ void execute_translated(ThreadState *state, void *block);
 
 /* Memory operations (SIMD-optimized) */
 void *rosetta_memchr_simd(const void *ptr, int c, size_t n);
-void *rosetta_memchr_simd_unaligned(const void *ptr, int c, size_t n);
 int   rosetta_strcmp_simd(const char *s1, const char *s2);
 int   rosetta_strncmp_simd(const char *s1, const char *s2, size_t n);
 int   rosetta_memcmp_simd(const void *s1, const void *s2, size_t n);
@@ -13,7 +13,10 @@
 #include <string.h>
 #include <stdarg.h>
 #include <time.h>
-#include <sys/time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
 
 /* ============================================================================
  * Debug State
@@ -28,10 +31,31 @@ static bool g_debug_initialized = false;
  * Trace Buffer
  * ============================================================================ */
 
-static rosetta_trace_entry_t g_trace_buffer[ROS_TRACE_BUFFER_SIZE];
-static uint32_t g_trace_head = 0;
-static uint32_t g_trace_count = 0;
+/* One per recording thread; head is written by the owner, tail by the writer */
+typedef struct trace_ring {
+    uint64_t head __attribute__((aligned(64)));
+    uint64_t tail __attribute__((aligned(64)));
+    uint64_t dropped;
+    struct trace_ring *next;
+    uint16_t thread;
+    rosetta_trace_entry_t entries[ROS_TRACE_BUFFER_SIZE] __attribute__((aligned(64)));
+} trace_ring_t;
+
+static trace_ring_t *g_trace_rings = NULL;      /* Never freed, threads keep pointers */
+static uint16_t g_trace_threads = 0;
+static _Thread_local trace_ring_t *t_trace_ring = NULL;
 static bool g_trace_initialized = false;
+static uint64_t g_trace_ticks_per_sec = 1000000000ULL;
+static uint64_t g_trace_start_ticks = 0;
+
+/* Streaming state; the staging buffer is guarded by g_trace_io_lock */
+static pthread_mutex_t g_trace_io_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t g_trace_writer;
+static bool g_trace_streaming = false;
+static bool g_trace_stop = false;
+static int g_trace_fd = -1;
+static uint8_t *g_trace_staging = NULL;
+static size_t g_trace_staged = 0;
 
 /* ============================================================================
  * Debug Subsystem Functions
@@ -489,8 +513,195 @@ void rosetta_debug_hexdump_line(const uint8_t *data, size_t offset)
  * Trace Buffer Functions
  * ============================================================================ */
 
+_Static_assert(sizeof(rosetta_trace_entry_t) == 32, "trace record layout changed");
+_Static_assert(ROS_TRACE_WRITE_SIZE % ROS_TRACE_BLOCK == 0, "staging not block aligned");
+
+/* Raw clock: the cycle counter where user space can read it */
+static inline uint64_t trace_ticks(void)
+{
+#if defined(__x86_64__)
+    unsigned int lo, hi;
+    __asm__ volatile("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+#elif defined(__aarch64__)
+    uint64_t cnt;
+    __asm__ volatile("mrs %0, cntvct_el0" : "=r"(cnt));
+    return cnt;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+#if defined(__x86_64__)
+static uint64_t trace_raw_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+#endif
+
+/* Ticks per second of trace_ticks() */
+static uint64_t trace_calibrate(void)
+{
+#if defined(__x86_64__)
+    uint64_t t0 = trace_ticks(), n0 = trace_raw_ns(), n1;
+
+    do {
+        n1 = trace_raw_ns();
+    } while (n1 - n0 < 2000000);        /* 2 ms against the raw clock */
+    return (trace_ticks() - t0) * 1000000000ULL / (n1 - n0);
+#elif defined(__aarch64__)
+    uint64_t freq;
+    __asm__ volatile("mrs %0, cntfrq_el0" : "=r"(freq));
+    return freq;
+#else
+    return 1000000000ULL;
+#endif
+}
+
+/* Give the calling thread its ring */
+static trace_ring_t *trace_ring_attach(void)
+{
+    trace_ring_t *r = aligned_alloc(64, sizeof(*r));
+
+    if (!r) {
+        return NULL;
+    }
+    memset(r, 0, sizeof(*r));
+    r->thread = __atomic_fetch_add(&g_trace_threads, 1, __ATOMIC_RELAXED);
+    r->next = __atomic_load_n(&g_trace_rings, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&g_trace_rings, &r->next, r, true,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+    }
+    t_trace_ring = r;
+    return r;
+}
+
+static void trace_reset_rings(void)
+{
+    for (trace_ring_t *r = __atomic_load_n(&g_trace_rings, __ATOMIC_ACQUIRE); r; r = r->next) {
+        __atomic_store_n(&r->head, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&r->tail, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&r->dropped, 0, __ATOMIC_RELAXED);
+    }
+}
+
+/* Write out the staging buffer, padding a partial block with ROS_TRACE_PAD */
+static int trace_write_staged(void)
+{
+    size_t len = (g_trace_staged + ROS_TRACE_BLOCK - 1) & ~(size_t)(ROS_TRACE_BLOCK - 1);
+    size_t done = 0;
+
+    if (g_trace_staged == 0) {
+        return 0;
+    }
+    memset(g_trace_staging + g_trace_staged, 0, len - g_trace_staged);
+    g_trace_staged = 0;
+
+    while (done < len) {
+        ssize_t n = write(g_trace_fd, g_trace_staging + done, len - done);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -errno;
+        }
+        done += (size_t)n;
+    }
+    return 0;
+}
+
+/* Move all published records to the file; caller holds g_trace_io_lock */
+static size_t trace_drain(bool partial)
+{
+    size_t moved = 0;
+
+    for (trace_ring_t *r = __atomic_load_n(&g_trace_rings, __ATOMIC_ACQUIRE); r; r = r->next) {
+        uint64_t head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+        uint64_t tail = __atomic_load_n(&r->tail, __ATOMIC_RELAXED);
+
+        while (tail != head) {
+            size_t idx = tail & (ROS_TRACE_BUFFER_SIZE - 1);
+            size_t n = head - tail;
+            size_t room = (ROS_TRACE_WRITE_SIZE - g_trace_staged) / sizeof(rosetta_trace_entry_t);
+
+            if (n > room) {
+                n = room;
+            }
+            if (n > ROS_TRACE_BUFFER_SIZE - idx) {
+                n = ROS_TRACE_BUFFER_SIZE - idx;
+            }
+            memcpy(g_trace_staging + g_trace_staged, &r->entries[idx],
+                   n * sizeof(rosetta_trace_entry_t));
+            g_trace_staged += n * sizeof(rosetta_trace_entry_t);
+            tail += n;
+            moved += n;
+
+            /* Slots are free again once copied out */
+            __atomic_store_n(&r->tail, tail, __ATOMIC_RELEASE);
+            if (g_trace_staged == ROS_TRACE_WRITE_SIZE) {
+                trace_write_staged();
+            }
+        }
+    }
+
+    if (partial) {
+        trace_write_staged();
+    }
+    return moved;
+}
+
+static void *trace_writer_main(void *arg)
+{
+    struct timespec idle = { 0, 1000000 };     /* 1 ms */
+
+    (void)arg;
+    while (!__atomic_load_n(&g_trace_stop, __ATOMIC_ACQUIRE)) {
+        size_t moved;
+
+        pthread_mutex_lock(&g_trace_io_lock);
+        moved = trace_drain(false);
+        pthread_mutex_unlock(&g_trace_io_lock);
+
+        if (moved == 0) {
+            nanosleep(&idle, NULL);
+        }
+    }
+    return NULL;
+}
+
+static const char *trace_type_name(uint8_t type)
+{
+    switch (type) {
+        case ROS_TRACE_BLOCK_ENTRY: return "BLOCK+ ";
+        case ROS_TRACE_BLOCK_EXIT:  return "BLOCK- ";
+        case ROS_TRACE_INSN:        return "INSN   ";
+        case ROS_TRACE_SYSCALL:     return "SYSCALL";
+        case ROS_TRACE_EXCEPTION:   return "EXCEPT ";
+        case ROS_TRACE_INTERRUPT:   return "INT    ";
+        default:                    return "UNKNOWN";
+    }
+}
+
+static void trace_print_entry(FILE *out, const rosetta_trace_entry_t *entry,
+                              uint64_t start_ticks, uint64_t ticks_per_sec)
+{
+    double us = (double)(int64_t)(entry->timestamp - start_ticks) * 1e6 /
+                (double)ticks_per_sec;
+
+    fprintf(out, "[%14.3f us] T%-3u %s guest=0x%016llx host=0x%016llx data=0x%08x\n",
+            us, entry->thread, trace_type_name(entry->event_type),
+            (unsigned long long)entry->guest_pc,
+            (unsigned long long)entry->host_pc,
+            entry->data);
+}
+
 /**
  * rosetta_trace_init - Initialize trace buffer
+ * Rings are reset, so no thread may be recording.
  * Returns: 0 on success, -1 on error
  */
 int rosetta_trace_init(void)
@@ -499,20 +710,105 @@ int rosetta_trace_init(void)
         rosetta_trace_cleanup();
     }
 
-    memset(g_trace_buffer, 0, sizeof(g_trace_buffer));
-    g_trace_head = 0;
-    g_trace_count = 0;
-    g_trace_initialized = true;
+    trace_reset_rings();
+    g_trace_ticks_per_sec = trace_calibrate();
+    g_trace_start_ticks = trace_ticks();
+    __atomic_store_n(&g_trace_initialized, true, __ATOMIC_RELEASE);
 
     return 0;
 }
 
+/**
+ * rosetta_trace_open - Initialize tracing and stream events to a file
+ * @path: Output file
+ * Returns: 0 on success, -errno on error
+ */
+int rosetta_trace_open(const char *path)
+{
+    rosetta_trace_file_header_t *hdr;
+    int flags = O_WRONLY | O_CREAT | O_TRUNC;
+    int ret;
+
+    if (!path) {
+        return -EINVAL;
+    }
+    if (g_trace_initialized) {
+        rosetta_trace_cleanup();
+    }
+
+    /* O_DIRECT keeps trace output out of the page cache; tmpfs refuses it */
+    g_trace_fd = -1;
+#ifdef O_DIRECT
+    g_trace_fd = open(path, flags | O_DIRECT, 0644);
+#endif
+    if (g_trace_fd < 0) {
+        g_trace_fd = open(path, flags, 0644);
+        if (g_trace_fd < 0) {
+            return -errno;
+        }
+    }
+
+    g_trace_staging = aligned_alloc(ROS_TRACE_BLOCK, ROS_TRACE_WRITE_SIZE);
+    if (!g_trace_staging) {
+        close(g_trace_fd);
+        g_trace_fd = -1;
+        return -ENOMEM;
+    }
+
+    trace_reset_rings();
+    g_trace_ticks_per_sec = trace_calibrate();
+    g_trace_start_ticks = trace_ticks();
+
+    memset(g_trace_staging, 0, ROS_TRACE_BLOCK);
+    hdr = (rosetta_trace_file_header_t *)g_trace_staging;
+    hdr->magic = ROS_TRACE_MAGIC;
+    hdr->version = ROS_TRACE_VERSION;
+    hdr->record_size = sizeof(rosetta_trace_entry_t);
+    hdr->data_offset = ROS_TRACE_BLOCK;
+    hdr->ticks_per_sec = g_trace_ticks_per_sec;
+    hdr->start_ticks = g_trace_start_ticks;
+    g_trace_staged = ROS_TRACE_BLOCK;
+
+    ret = trace_write_staged();
+    if (ret == 0) {
+        g_trace_stop = false;
+        g_trace_streaming = true;
+        ret = -pthread_create(&g_trace_writer, NULL, trace_writer_main, NULL);
+    }
+    if (ret != 0) {
+        g_trace_streaming = false;
+        free(g_trace_staging);
+        g_trace_staging = NULL;
+        close(g_trace_fd);
+        g_trace_fd = -1;
+        return ret;
+    }
+
+    __atomic_store_n(&g_trace_initialized, true, __ATOMIC_RELEASE);
+    return 0;
+}
+
 /**
  * rosetta_trace_cleanup - Cleanup trace buffer
  */
 void rosetta_trace_cleanup(void)
 {
-    g_trace_initialized = false;
+    __atomic_store_n(&g_trace_initialized, false, __ATOMIC_RELEASE);
+
+    if (g_trace_streaming) {
+        __atomic_store_n(&g_trace_stop, true, __ATOMIC_RELEASE);
+        pthread_join(g_trace_writer, NULL);
+
+        pthread_mutex_lock(&g_trace_io_lock);
+        trace_drain(true);
+        close(g_trace_fd);
+        g_trace_fd = -1;
+        free(g_trace_staging);
+        g_trace_staging = NULL;
+        pthread_mutex_unlock(&g_trace_io_lock);
+
+        __atomic_store_n(&g_trace_streaming, false, __ATOMIC_RELAXED);
+    }
 }
 
 /**
@@ -525,29 +821,38 @@ void rosetta_trace_cleanup(void)
 void rosetta_trace_record(uint8_t type, uint64_t guest_pc,
                           uint64_t host_pc, uint64_t data)
 {
+    trace_ring_t *r = t_trace_ring;
     rosetta_trace_entry_t *entry;
+    uint64_t head, tail;
 
-    if (!g_trace_initialized) {
+    if (!__atomic_load_n(&g_trace_initialized, __ATOMIC_RELAXED)) {
+        return;
+    }
+    if (!r && !(r = trace_ring_attach())) {
         return;
     }
 
-    entry = &g_trace_buffer[g_trace_head];
-
-    /* Get timestamp */
-    struct timeval tv;
-    gettimeofday(&tv, NULL);
-    entry->timestamp = (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+    head = __atomic_load_n(&r->head, __ATOMIC_RELAXED);
+    tail = __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+    if (head - tail >= ROS_TRACE_BUFFER_SIZE) {
+        if (__atomic_load_n(&g_trace_streaming, __ATOMIC_RELAXED)) {
+            __atomic_store_n(&r->dropped, r->dropped + 1, __ATOMIC_RELAXED);
+            return;
+        }
+        /* Memory only: keep the most recent events */
+        __atomic_store_n(&r->tail, tail + 1, __ATOMIC_RELEASE);
+    }
 
+    entry = &r->entries[head & (ROS_TRACE_BUFFER_SIZE - 1)];
+    entry->timestamp = trace_ticks();
     entry->guest_pc = guest_pc;
     entry->host_pc = host_pc;
-    entry->arm64_insn = (uint32_t)data;
+    entry->data = (uint32_t)data;
     entry->event_type = type;
     entry->flags = 0;
+    entry->thread = r->thread;
 
-    g_trace_head = (g_trace_head + 1) % ROS_TRACE_BUFFER_SIZE;
-    if (g_trace_count < ROS_TRACE_BUFFER_SIZE) {
-        g_trace_count++;
-    }
+    __atomic_store_n(&r->head, head + 1, __ATOMIC_RELEASE);
 }
 
 /**
@@ -555,8 +860,26 @@ void rosetta_trace_record(uint8_t type, uint64_t guest_pc,
  */
 void rosetta_trace_flush(void)
 {
-    /* Trace is kept in memory; flush would write to file */
-    /* Implementation depends on output configuration */
+    if (!__atomic_load_n(&g_trace_streaming, __ATOMIC_RELAXED)) {
+        return;
+    }
+
+    pthread_mutex_lock(&g_trace_io_lock);
+    trace_drain(true);
+    pthread_mutex_unlock(&g_trace_io_lock);
+}
+
+/**
+ * rosetta_trace_dropped - Events lost to full rings
+ */
+uint64_t rosetta_trace_dropped(void)
+{
+    uint64_t total = 0;
+
+    for (trace_ring_t *r = __atomic_load_n(&g_trace_rings, __ATOMIC_ACQUIRE); r; r = r->next) {
+        total += __atomic_load_n(&r->dropped, __ATOMIC_RELAXED);
+    }
+    return total;
 }
 
 /**
@@ -564,49 +887,106 @@ void rosetta_trace_flush(void)
  */
 void rosetta_trace_dump(void)
 {
-    uint32_t i, count;
-    uint32_t start;
+    trace_ring_t *r;
+    uint64_t count = 0;
+
+    for (r = __atomic_load_n(&g_trace_rings, __ATOMIC_ACQUIRE); r; r = r->next) {
+        count += __atomic_load_n(&r->head, __ATOMIC_ACQUIRE) - r->tail;
+    }
 
-    if (!g_trace_initialized || g_trace_count == 0) {
+    if (!g_trace_initialized || count == 0) {
         printf("Trace buffer is empty\n");
         return;
     }
 
-    printf("=== TRACE BUFFER (%u entries) ===\n", g_trace_count);
+    printf("=== TRACE BUFFER (%llu entries) ===\n", (unsigned long long)count);
+
+    for (r = __atomic_load_n(&g_trace_rings, __ATOMIC_ACQUIRE); r; r = r->next) {
+        uint64_t head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+
+        for (uint64_t i = r->tail; i != head; i++) {
+            trace_print_entry(stdout, &r->entries[i & (ROS_TRACE_BUFFER_SIZE - 1)],
+                              g_trace_start_ticks, g_trace_ticks_per_sec);
+        }
+    }
+
+    printf("================================\n");
+}
+
+/* Decoded record with its position in the file, for a stable sort */
+typedef struct {
+    rosetta_trace_entry_t entry;
+    size_t seq;
+} trace_decoded_t;
+
+static int trace_decoded_cmp(const void *a, const void *b)
+{
+    const trace_decoded_t *x = a, *y = b;
 
-    /* Determine start position */
-    if (g_trace_count < ROS_TRACE_BUFFER_SIZE) {
-        start = 0;
-        count = g_trace_count;
-    } else {
-        start = g_trace_head;
-        count = ROS_TRACE_BUFFER_SIZE;
+    if (x->entry.timestamp != y->entry.timestamp) {
+        return x->entry.timestamp < y->entry.timestamp ? -1 : 1;
     }
+    return x->seq < y->seq ? -1 : x->seq > y->seq;
+}
 
-    for (i = 0; i < count; i++) {
-        uint32_t idx = (start + i) % ROS_TRACE_BUFFER_SIZE;
-        rosetta_trace_entry_t *entry = &g_trace_buffer[idx];
+/**
+ * rosetta_trace_decode - Decode a trace file to text
+ * @path: Trace file
+ * @out: Output stream
+ * Returns: Number of events, or -errno on error
+ */
+long rosetta_trace_decode(const char *path, FILE *out)
+{
+    rosetta_trace_file_header_t hdr;
+    rosetta_trace_entry_t rec;
+    trace_decoded_t *events = NULL;
+    size_t count = 0, cap = 0;
+    FILE *in;
+
+    if (!path || !out) {
+        return -EINVAL;
+    }
+    in = fopen(path, "rb");
+    if (!in) {
+        return -errno;
+    }
+
+    if (fread(&hdr, sizeof(hdr), 1, in) != 1 || hdr.magic != ROS_TRACE_MAGIC ||
+        hdr.version != ROS_TRACE_VERSION || hdr.record_size != sizeof(rec) ||
+        hdr.ticks_per_sec == 0 || fseek(in, (long)hdr.data_offset, SEEK_SET) != 0) {
+        fclose(in);
+        return -EINVAL;
+    }
 
-        const char *type_str;
-        switch (entry->event_type) {
-            case ROS_TRACE_BLOCK_ENTRY: type_str = "BLOCK+"; break;
-            case ROS_TRACE_BLOCK_EXIT:  type_str = "BLOCK-"; break;
-            case ROS_TRACE_INSN:        type_str = "INSN  "; break;
-            case ROS_TRACE_SYSCALL:     type_str = "SYSCALL"; break;
-            case ROS_TRACE_EXCEPTION:   type_str = "EXCEPT "; break;
-            case ROS_TRACE_INTERRUPT:   type_str = "INT    "; break;
-            default:                    type_str = "UNKNOWN"; break;
+    while (fread(&rec, sizeof(rec), 1, in) == 1) {
+        if (rec.event_type == ROS_TRACE_PAD) {
+            continue;
         }
+        if (count == cap) {
+            trace_decoded_t *grown;
+            cap = cap ? cap * 2 : 4096;
+            grown = realloc(events, cap * sizeof(*events));
+            if (!grown) {
+                free(events);
+                fclose(in);
+                return -ENOMEM;
+            }
+            events = grown;
+        }
+        events[count].entry = rec;
+        events[count].seq = count;
+        count++;
+    }
+    fclose(in);
 
-        printf("[%010llu] %s guest=0x%016llx host=0x%016llx insn=0x%08x\n",
-               (unsigned long long)entry->timestamp,
-               type_str,
-               (unsigned long long)entry->guest_pc,
-               (unsigned long long)entry->host_pc,
-               entry->arm64_insn);
+    /* Rings are drained one after another; restore global time order */
+    qsort(events, count, sizeof(*events), trace_decoded_cmp);
+    for (size_t i = 0; i < count; i++) {
+        trace_print_entry(out, &events[i].entry, hdr.start_ticks, hdr.ticks_per_sec);
     }
 
-    printf("================================\n");
+    free(events);
+    return (long)count;
 }
 
 /* ============================================================================
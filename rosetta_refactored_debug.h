@@ -12,6 +12,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stdio.h>
 #include "rosetta_types.h"
 
 /* ============================================================================
@@ -214,17 +215,37 @@ void rosetta_debug_hexdump_line(const uint8_t *data, size_t offset);
  * Trace Buffer
  * ============================================================================ */
 
-/* Trace buffer entry */
+/*
+ * Each thread records into its own single-producer ring; timestamps are raw
+ * cycle counter ticks. rosetta_trace_open() adds a writer thread that
+ * streams the rings to a file in ROS_TRACE_BLOCK units, which
+ * rosetta_trace_decode() turns back into text. Without a file the rings keep
+ * the most recent events for rosetta_trace_dump().
+ */
+
+/* Trace record, also the on-disk format */
 typedef struct {
-    uint64_t timestamp;
+    uint64_t timestamp;             /* Clock ticks, see ticks_per_sec */
     uint64_t guest_pc;
     uint64_t host_pc;
-    uint32_t arm64_insn;
-    uint8_t event_type;
+    uint32_t data;                  /* Event data, e.g. an ARM64 instruction */
+    uint8_t event_type;             /* ROS_TRACE_*, ROS_TRACE_PAD in padding */
     uint8_t flags;
+    uint16_t thread;                /* Recording thread, in ring order */
 } rosetta_trace_entry_t;
 
+/* Trace file header, alone in the first ROS_TRACE_BLOCK of the file */
+typedef struct {
+    uint32_t magic;                 /* ROS_TRACE_MAGIC */
+    uint32_t version;
+    uint32_t record_size;           /* sizeof(rosetta_trace_entry_t) */
+    uint32_t data_offset;           /* First record */
+    uint64_t ticks_per_sec;
+    uint64_t start_ticks;           /* Clock at rosetta_trace_open() */
+} rosetta_trace_file_header_t;
+
 /* Trace event types */
+#define ROS_TRACE_PAD           0x00
 #define ROS_TRACE_BLOCK_ENTRY   0x01
 #define ROS_TRACE_BLOCK_EXIT    0x02
 #define ROS_TRACE_INSN          0x03
@@ -233,21 +254,32 @@ typedef struct {
 #define ROS_TRACE_INTERRUPT     0x06
 
 /* Trace buffer configuration */
-#define ROS_TRACE_BUFFER_SIZE   4096
+#define ROS_TRACE_BUFFER_SIZE   4096        /* Records per thread, power of two */
+#define ROS_TRACE_BLOCK         4096        /* File write alignment (O_DIRECT) */
+#define ROS_TRACE_WRITE_SIZE    65536       /* Writer staging buffer */
+#define ROS_TRACE_MAGIC         0x43525452  /* "RTRC" */
+#define ROS_TRACE_VERSION       1
 
 /**
- * Initialize trace buffer
+ * Initialize trace buffer, in memory only
  * Returns: 0 on success, -1 on error
  */
 int rosetta_trace_init(void);
 
 /**
- * Cleanup trace buffer
+ * Initialize tracing and stream events to a file
+ * @path: Output file, truncated
+ * Returns: 0 on success, -errno on error
+ */
+int rosetta_trace_open(const char *path);
+
+/**
+ * Cleanup trace buffer, writing out any buffered events
  */
 void rosetta_trace_cleanup(void);
 
 /**
- * Record trace event
+ * Record trace event; lock-free, drops the event if the ring is full
  * @type: Event type
  * @guest_pc: Guest PC
  * @host_pc: Host PC (if applicable)
@@ -258,14 +290,29 @@ void rosetta_trace_record(uint8_t type, uint64_t guest_pc,
 
 /**
  * Flush trace buffer to output
+ * Writes every event recorded so far before returning
  */
 void rosetta_trace_flush(void);
 
+/**
+ * Get the number of events dropped because a ring was full
+ */
+uint64_t rosetta_trace_dropped(void);
+
 /**
  * Dump trace buffer contents
+ * Prints events not yet written out; call while threads are not recording
  */
 void rosetta_trace_dump(void);
 
+/**
+ * Decode a trace file to text, merged across threads by time
+ * @path: Trace file
+ * @out: Output stream
+ * Returns: Number of events, or -errno on error
+ */
+long rosetta_trace_decode(const char *path, FILE *out);
+
 /* ============================================================================
  * Disassembly Support
  * ============================================================================ */
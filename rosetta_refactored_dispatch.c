@@ -37,52 +37,52 @@ int rosetta_decode_and_dispatch(uint32_t encoding, code_buf_t *code_buf,
 
     /* 1. ALU instructions (most common) */
     if (translate_alu_dispatch(encoding, code_buf, state->host.x, &state->host.pstate) == 0) {
-        rosetta_stats_record_alu("unknown");
+        rosetta_stats_record_alu(ROS_STAT_INSNS_ALU);
         return 0;
     }
 
     /* 2. Compare instructions */
     if (translate_compare_dispatch(encoding, code_buf, state->host.x,
                                    &state->host.pstate) == 0) {
-        rosetta_stats_record_alu("compare");
+        rosetta_stats_record_insn(ROS_STAT_INSNS_COMPARE);
         return 0;
     }
 
     /* 3. MOV instructions */
     if (translate_mov_dispatch(encoding, code_buf, state->host.x) == 0) {
-        rosetta_stats_record_alu("mov");
+        rosetta_stats_record_insn(ROS_STAT_INSNS_MOV);
         return 0;
     }
 
     /* 4. Conditional instructions (CSEL, CSET, etc.) */
     if (translate_cond_dispatch(encoding, code_buf, state->host.x,
                                 (uint32_t *)&state->host.pstate) == 0) {
-        rosetta_stats_record_alu("conditional");
+        rosetta_stats_record_alu(ROS_STAT_INSNS_ALU);
         return 0;
     }
 
     /* 4b. Bitfield instructions (BFI, UBFX, SBFX, etc.) */
     if (translate_bitfield_dispatch(encoding, code_buf, state->host.x) == 0) {
-        rosetta_stats_record_alu("bitfield");
+        rosetta_stats_record_alu(ROS_STAT_INSNS_ALU);
         return 0;
     }
 
     /* 5. Memory instructions */
     if (translate_mem_dispatch(encoding, code_buf, state->host.x) == 0) {
-        rosetta_stats_record_mem("unknown");
+        rosetta_stats_record_mem(ROS_STAT_INSNS_MEM);
         return 0;
     }
 
     /* 6. Branch instructions */
     if (translate_branch_dispatch(encoding, code_buf, state->host.x,
                                   pc, terminated) == 0) {
-        rosetta_stats_record_branch("unknown");
+        rosetta_stats_record_branch(ROS_STAT_INSNS_BRANCH);
         return 0;
     }
 
     /* 7. System instructions */
     if (translate_system_dispatch(encoding, code_buf, state->host.x) == 0) {
-        rosetta_stats_record_insn("SYSTEM");
+        rosetta_stats_record_insn(ROS_STAT_INSNS_SYSTEM);
         *terminated = 1;
         return 0;
     }
@@ -90,14 +90,14 @@ int rosetta_decode_and_dispatch(uint32_t encoding, code_buf_t *code_buf,
     /* 8. NEON/SIMD instructions */
     if (translate_neon_dispatch(encoding, code_buf, (Vector128 *)state->host.v,
                                 state->host.x) == 0) {
-        rosetta_stats_record_insn("NEON");
+        rosetta_stats_record_insn(ROS_STAT_INSNS_NEON);
         return 0;
     }
 
     /* 9. Floating-Point instructions */
     if (translate_fp_dispatch(encoding, code_buf, (Vector128 *)state->host.v,
                               state->host.x, (uint32_t *)&state->host.pstate) == 0) {
-        rosetta_stats_record_insn("FP");
+        rosetta_stats_record_insn(ROS_STAT_INSNS_FP);
         return 0;
     }
 
@@ -385,16 +385,14 @@ void write_fpsr(uint32_t val)
 
 void set_fp_registers(uint64_t fpcr_value, uint64_t fpsr_value)
 {
-    /* Set FPCr and FPSr values */
-    /* This would typically be done via assembly instructions */
-    (void)fpcr_value;
-    (void)fpsr_value;
+    write_fpcr((uint32_t)fpcr_value);
+    write_fpsr((uint32_t)fpsr_value);
 }
 
 void clear_fp_registers(void)
 {
-    /* Clear floating point control and status registers */
-    /* This would typically be done via assembly instructions */
+    write_fpcr(0);
+    write_fpsr(0);
 }
 
 Vector128 fp_noop(void)
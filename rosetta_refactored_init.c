@@ -9,6 +9,8 @@
 #include "rosetta_refactored_init.h"
 #include "rosetta_refactored.h"
 #include "rosetta_trans_cache.h"
+#include "rosetta_x87.h"
+#include "rosetta_mxcsr.h"
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -70,6 +72,12 @@ int rosetta_init(void)
     g_thread_state.host.fpsr = 0;
     g_thread_state.host.fpcr = 0;
 
+    /* x87 registers empty, control word at its FNINIT value */
+    rosetta_x87_reset(&g_thread_state.guest);
+
+    /* MXCSR all masked, round to nearest */
+    rosetta_mxcsr_reset(&g_thread_state.guest);
+
     /* Initialize translation cache */
     if (refactored_translation_cache_init() != 0) {
         return -1;
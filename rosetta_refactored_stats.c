@@ -12,20 +12,40 @@
 #include <string.h>
 #include <time.h>
 #include <sys/time.h>
+#include <pthread.h>
 
 /* ============================================================================
  * Statistics State
  * ============================================================================ */
 
-static rosetta_stats_t g_stats;
+_Static_assert(sizeof(rosetta_stats_t) == ROS_STAT_COUNT * sizeof(uint64_t),
+               "rosetta_stat_id_t must mirror rosetta_stats_t");
+
+#ifndef ROSETTA_STATS_DISABLED
+_Thread_local rosetta_stats_shard_t *rosetta_stats_tls_shard;
+#endif
+
+/* Used by threads whose shard allocation failed; counts may race */
+static rosetta_stats_shard_t g_fallback_shard = { .in_use = 1 };
+
+/*
+ * Every shard ever attached. Shards outlive their threads so counts stay;
+ * an exited thread's shard is handed to the next new thread, which keeps
+ * adding to it, so the list is bounded by the peak number of threads.
+ */
+static rosetta_stats_shard_t *g_shards = &g_fallback_shard;
+
+/* Serializes readers, resets and the block table, never the counters */
+static pthread_mutex_t g_stats_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Shard totals at the last reset; reads report the difference */
+static rosetta_stats_shard_t g_baseline;
+
+/* Block table, appended once per translated block */
 static rosetta_block_stats_t g_block_stats[ROS_STATS_MAX_BLOCKS];
 static size_t g_block_count = 0;
 static bool g_stats_initialized = false;
 
-/* Histogram data */
-static uint32_t g_insn_size_hist[ROS_STATS_HIST_BUCKETS];
-static uint32_t g_block_size_hist[ROS_STATS_HIST_BUCKETS];
-
 /* Timing */
 static uint64_t g_start_time_us = 0;
 
@@ -40,6 +60,134 @@ static uint64_t get_time_us(void)
     return (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec;
 }
 
+static void sum_array(uint64_t *dst, const uint64_t *src, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        dst[i] += __atomic_load_n(&src[i], __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * Sum all shards into sum (raw totals, baseline not applied)
+ */
+static void shards_sum(rosetta_stats_shard_t *sum)
+{
+    memset(sum, 0, sizeof(*sum));
+
+    for (rosetta_stats_shard_t *s = __atomic_load_n(&g_shards, __ATOMIC_ACQUIRE);
+         s != NULL; s = s->next) {
+        sum_array(sum->counters, s->counters, ROS_STAT_COUNT);
+        sum_array(sum->local, s->local, ROS_LOCAL_COUNT);
+        sum_array(sum->insn_size_hist, s->insn_size_hist, ROS_STATS_HIST_BUCKETS);
+        sum_array(sum->block_size_hist, s->block_size_hist, ROS_STATS_HIST_BUCKETS);
+    }
+}
+
+static void sub_array(uint64_t *dst, const uint64_t *base, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        dst[i] -= base[i];
+    }
+}
+
+/**
+ * Current totals since the last reset
+ */
+static void stats_snapshot(rosetta_stats_shard_t *snap)
+{
+    pthread_mutex_lock(&g_stats_lock);
+    shards_sum(snap);
+    sub_array(snap->counters, g_baseline.counters, ROS_STAT_COUNT);
+    sub_array(snap->local, g_baseline.local, ROS_LOCAL_COUNT);
+    sub_array(snap->insn_size_hist, g_baseline.insn_size_hist, ROS_STATS_HIST_BUCKETS);
+    sub_array(snap->block_size_hist, g_baseline.block_size_hist, ROS_STATS_HIST_BUCKETS);
+    pthread_mutex_unlock(&g_stats_lock);
+
+    /* Translated code is never freed, so the peak is the running total */
+    snap->counters[ROS_STAT_CODE_SIZE_PEAK] = snap->counters[ROS_STAT_CODE_SIZE_TOTAL];
+}
+
+#ifndef ROSETTA_STATS_DISABLED
+
+/* Releases a thread's shard when the thread exits */
+static pthread_key_t g_shard_key;
+static pthread_once_t g_shard_key_once = PTHREAD_ONCE_INIT;
+static bool g_shard_key_ok;
+
+static void shard_push(rosetta_stats_shard_t *s)
+{
+    rosetta_stats_shard_t *head = __atomic_load_n(&g_shards, __ATOMIC_RELAXED);
+
+    do {
+        s->next = head;
+    } while (!__atomic_compare_exchange_n(&g_shards, &head, s, true,
+                                          __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+static void shard_release(void *p)
+{
+    rosetta_stats_shard_t *s = p;
+
+    /* Recordings from later TLS destructors go to the fallback shard */
+    rosetta_stats_tls_shard = &g_fallback_shard;
+    __atomic_store_n(&s->in_use, 0, __ATOMIC_RELEASE);
+}
+
+static void shard_key_create(void)
+{
+    g_shard_key_ok = pthread_key_create(&g_shard_key, shard_release) == 0;
+}
+
+/* Claim a shard released by an exited thread */
+static rosetta_stats_shard_t *shard_reuse(void)
+{
+    for (rosetta_stats_shard_t *s = __atomic_load_n(&g_shards, __ATOMIC_ACQUIRE);
+         s != NULL; s = s->next) {
+        uint32_t expected = 0;
+
+        if (__atomic_load_n(&s->in_use, __ATOMIC_RELAXED) == 0 &&
+            __atomic_compare_exchange_n(&s->in_use, &expected, 1, false,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            return s;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * rosetta_stats_shard_attach - Claim this thread's shard
+ * Returns: The shard
+ */
+rosetta_stats_shard_t *rosetta_stats_shard_attach(void)
+{
+    rosetta_stats_shard_t *s;
+
+    pthread_once(&g_shard_key_once, shard_key_create);
+
+    /* Without the key a shard would never be released, so do not take one */
+    s = g_shard_key_ok ? shard_reuse() : NULL;
+    if (!s && g_shard_key_ok) {
+        s = aligned_alloc(_Alignof(rosetta_stats_shard_t), sizeof(rosetta_stats_shard_t));
+        if (s) {
+            memset(s, 0, sizeof(*s));
+            s->in_use = 1;
+            shard_push(s);
+        }
+    }
+    if (!s || pthread_setspecific(g_shard_key, s) != 0) {
+        if (s) {
+            __atomic_store_n(&s->in_use, 0, __ATOMIC_RELEASE);
+        }
+        rosetta_stats_tls_shard = &g_fallback_shard;
+        return &g_fallback_shard;
+    }
+
+    rosetta_stats_tls_shard = s;
+    return s;
+}
+
+#endif
+
 /* ============================================================================
  * Statistics API Implementation
  * ============================================================================ */
@@ -54,13 +202,7 @@ int rosetta_stats_init(void)
         rosetta_stats_cleanup();
     }
 
-    memset(&g_stats, 0, sizeof(g_stats));
-    memset(g_block_stats, 0, sizeof(g_block_stats));
-    memset(g_insn_size_hist, 0, sizeof(g_insn_size_hist));
-    memset(g_block_size_hist, 0, sizeof(g_block_size_hist));
-
-    g_block_count = 0;
-    g_start_time_us = get_time_us();
+    rosetta_stats_reset();
     g_stats_initialized = true;
 
     return 0;
@@ -76,25 +218,31 @@ void rosetta_stats_cleanup(void)
 
 /**
  * rosetta_stats_reset - Reset all statistics
+ *
+ * Shards are owned by their threads, so the current totals become the new
+ * baseline instead of being cleared.
  */
 void rosetta_stats_reset(void)
 {
-    memset(&g_stats, 0, sizeof(g_stats));
+    pthread_mutex_lock(&g_stats_lock);
+    shards_sum(&g_baseline);
     memset(g_block_stats, 0, sizeof(g_block_stats));
-    memset(g_insn_size_hist, 0, sizeof(g_insn_size_hist));
-    memset(g_block_size_hist, 0, sizeof(g_block_size_hist));
     g_block_count = 0;
     g_start_time_us = get_time_us();
+    pthread_mutex_unlock(&g_stats_lock);
 }
 
 /**
- * rosetta_stats_get - Get current statistics
+ * rosetta_stats_get - Get current statistics, summed over all threads
  * @stats: Pointer to statistics structure
  */
 void rosetta_stats_get(rosetta_stats_t *stats)
 {
+    rosetta_stats_shard_t snap;
+
     if (stats) {
-        *stats = g_stats;
+        stats_snapshot(&snap);
+        memcpy(stats, snap.counters, sizeof(*stats));
     }
 }
 
@@ -104,104 +252,110 @@ void rosetta_stats_get(rosetta_stats_t *stats)
  */
 void rosetta_stats_print(bool verbose)
 {
+    rosetta_stats_t st;
+
+    rosetta_stats_get(&st);
+
     printf("\n");
     printf("=== Rosetta Translation Statistics ===\n\n");
 
     /* Block statistics */
     printf("Block Translation:\n");
-    printf("  Blocks translated:  %llu\n", (unsigned long long)g_stats.blocks_translated);
-    printf("  Blocks cached:      %llu\n", (unsigned long long)g_stats.blocks_cached);
-    printf("  Blocks evicted:     %llu\n", (unsigned long long)g_stats.blocks_evicted);
+    printf("  Blocks translated:  %llu\n", (unsigned long long)st.blocks_translated);
+    printf("  Blocks cached:      %llu\n", (unsigned long long)st.blocks_cached);
+    printf("  Blocks evicted:     %llu\n", (unsigned long long)st.blocks_evicted);
     printf("\n");
 
     /* Cache statistics */
     printf("Cache Statistics:\n");
-    printf("  Cache lookups:      %llu\n", (unsigned long long)g_stats.cache_lookups);
-    printf("  Cache hits:         %llu\n", (unsigned long long)g_stats.cache_hits);
-    printf("  Cache misses:       %llu\n", (unsigned long long)g_stats.cache_misses);
-    printf("  Cache inserts:      %llu\n", (unsigned long long)g_stats.cache_inserts);
-    printf("  Cache flushes:      %llu\n", (unsigned long long)g_stats.cache_flushes);
-
-    if (g_stats.cache_lookups > 0) {
-        double hit_rate = (double)g_stats.cache_hits / g_stats.cache_lookups * 100.0;
+    printf("  Cache lookups:      %llu\n", (unsigned long long)st.cache_lookups);
+    printf("  Cache hits:         %llu\n", (unsigned long long)st.cache_hits);
+    printf("  Cache misses:       %llu\n", (unsigned long long)st.cache_misses);
+    printf("  Cache inserts:      %llu\n", (unsigned long long)st.cache_inserts);
+    printf("  Cache flushes:      %llu\n", (unsigned long long)st.cache_flushes);
+
+    if (st.cache_lookups > 0) {
+        double hit_rate = (double)st.cache_hits / st.cache_lookups * 100.0;
         printf("  Hit rate:           %.2f%%\n", hit_rate);
     }
     printf("\n");
 
     /* Instruction statistics */
     printf("Instruction Statistics:\n");
-    printf("  Total instructions: %llu\n", (unsigned long long)g_stats.insns_total);
+    printf("  Total instructions: %llu\n", (unsigned long long)st.insns_total);
 
     if (verbose) {
-        printf("\n  ALU Instructions:   %llu\n", (unsigned long long)g_stats.insns_alu);
+        printf("\n  ALU Instructions:   %llu\n", (unsigned long long)st.insns_alu);
         printf("    ADD/SUB:          %llu\n",
-               (unsigned long long)(g_stats.insns_alu_add + g_stats.insns_alu_sub));
+               (unsigned long long)(st.insns_alu_add + st.insns_alu_sub));
         printf("    AND/ORR/EOR:      %llu\n",
-               (unsigned long long)(g_stats.insns_alu_and + g_stats.insns_alu_orr + g_stats.insns_alu_eor));
-        printf("    MVN:              %llu\n", (unsigned long long)g_stats.insns_alu_mvn);
-        printf("    MUL:              %llu\n", (unsigned long long)g_stats.insns_alu_mul);
-        printf("    DIV:              %llu\n", (unsigned long long)g_stats.insns_alu_div);
-        printf("    Shift:            %llu\n", (unsigned long long)g_stats.insns_alu_shift);
-
-        printf("\n  Memory Instructions: %llu\n", (unsigned long long)g_stats.insns_mem);
-        printf("    LDR:              %llu\n", (unsigned long long)g_stats.insns_mem_ldr);
-        printf("    STR:              %llu\n", (unsigned long long)g_stats.insns_mem_str);
-        printf("    LDP:              %llu\n", (unsigned long long)g_stats.insns_mem_ldp);
-        printf("    STP:              %llu\n", (unsigned long long)g_stats.insns_mem_stp);
-
-        printf("\n  Branch Instructions: %llu\n", (unsigned long long)g_stats.insns_branch);
-        printf("    B (unconditional): %llu\n", (unsigned long long)g_stats.insns_branch_b);
-        printf("    BL (with link):   %llu\n", (unsigned long long)g_stats.insns_branch_bl);
-        printf("    BR (register):    %llu\n", (unsigned long long)g_stats.insns_branch_br);
-        printf("    RET (return):     %llu\n", (unsigned long long)g_stats.insns_branch_ret);
-        printf("    B.cond (conditional): %llu\n", (unsigned long long)g_stats.insns_branch_cond);
+               (unsigned long long)(st.insns_alu_and + st.insns_alu_orr + st.insns_alu_eor));
+        printf("    MVN:              %llu\n", (unsigned long long)st.insns_alu_mvn);
+        printf("    MUL:              %llu\n", (unsigned long long)st.insns_alu_mul);
+        printf("    DIV:              %llu\n", (unsigned long long)st.insns_alu_div);
+        printf("    Shift:            %llu\n", (unsigned long long)st.insns_alu_shift);
+
+        printf("\n  Memory Instructions: %llu\n", (unsigned long long)st.insns_mem);
+        printf("    LDR:              %llu\n", (unsigned long long)st.insns_mem_ldr);
+        printf("    STR:              %llu\n", (unsigned long long)st.insns_mem_str);
+        printf("    LDP:              %llu\n", (unsigned long long)st.insns_mem_ldp);
+        printf("    STP:              %llu\n", (unsigned long long)st.insns_mem_stp);
+
+        printf("\n  Branch Instructions: %llu\n", (unsigned long long)st.insns_branch);
+        printf("    B (unconditional): %llu\n", (unsigned long long)st.insns_branch_b);
+        printf("    BL (with link):   %llu\n", (unsigned long long)st.insns_branch_bl);
+        printf("    BR (register):    %llu\n", (unsigned long long)st.insns_branch_br);
+        printf("    RET (return):     %llu\n", (unsigned long long)st.insns_branch_ret);
+        printf("    B.cond (conditional): %llu\n", (unsigned long long)st.insns_branch_cond);
         printf("    CBZ/CBNZ:         %llu\n",
-               (unsigned long long)(g_stats.insns_branch_cbz + g_stats.insns_branch_cbnz));
-
-        printf("\n  MOV Instructions:   %llu\n", (unsigned long long)g_stats.insns_mov);
-        printf("  Compare:            %llu\n", (unsigned long long)g_stats.insns_compare);
-        printf("  System:             %llu\n", (unsigned long long)g_stats.insns_system);
-        printf("  NEON/SIMD:          %llu\n", (unsigned long long)g_stats.insns_neon);
-        printf("  Unknown:            %llu\n", (unsigned long long)g_stats.insns_unknown);
+               (unsigned long long)(st.insns_branch_cbz + st.insns_branch_cbnz));
+
+        printf("\n  MOV Instructions:   %llu\n", (unsigned long long)st.insns_mov);
+        printf("  Compare:            %llu\n", (unsigned long long)st.insns_compare);
+        printf("  System:             %llu\n", (unsigned long long)st.insns_system);
+        printf("  NEON/SIMD:          %llu\n", (unsigned long long)st.insns_neon);
+        printf("  Floating-point:     %llu\n", (unsigned long long)st.insns_fp);
+        printf("  Unknown:            %llu\n", (unsigned long long)st.insns_unknown);
     }
     printf("\n");
 
     /* Code size statistics */
     printf("Code Size Statistics:\n");
-    printf("  Total code size:    %llu bytes\n", (unsigned long long)g_stats.code_size_total);
-    printf("  ARM64 input:        %llu bytes\n", (unsigned long long)g_stats.code_size_arm64);
-    printf("  x86_64 output:      %llu bytes\n", (unsigned long long)g_stats.code_size_x86);
-    printf("  Peak memory:        %llu bytes\n", (unsigned long long)g_stats.code_size_peak);
+    printf("  Total code size:    %llu bytes\n", (unsigned long long)st.code_size_total);
+    printf("  ARM64 input:        %llu bytes\n", (unsigned long long)st.code_size_arm64);
+    printf("  x86_64 output:      %llu bytes\n", (unsigned long long)st.code_size_x86);
+    printf("  Peak memory:        %llu bytes\n", (unsigned long long)st.code_size_peak);
 
-    if (g_stats.code_size_arm64 > 0) {
-        double expansion = (double)g_stats.code_size_x86 / g_stats.code_size_arm64;
+    if (st.code_size_arm64 > 0) {
+        double expansion = (double)st.code_size_x86 / st.code_size_arm64;
         printf("  Expansion ratio:    %.2fx\n", expansion);
     }
     printf("\n");
 
     /* Performance statistics */
     printf("Performance Statistics:\n");
-    printf("  Guest cycles:       %llu\n", (unsigned long long)g_stats.cycles_guest);
-    printf("  Host cycles:        %llu\n", (unsigned long long)g_stats.cycles_host);
-    printf("  Translation time:   %llu us\n", (unsigned long long)g_stats.translations_time_us);
-    printf("  Execution time:     %llu us\n", (unsigned long long)g_stats.execution_time_us);
+    printf("  Guest cycles:       %llu\n", (unsigned long long)st.cycles_guest);
+    printf("  Host cycles:        %llu\n", (unsigned long long)st.cycles_host);
+    printf("  Translation time:   %llu us\n", (unsigned long long)st.translations_time_us);
+    printf("  Execution time:     %llu us\n", (unsigned long long)st.execution_time_us);
 
-    if (g_stats.translations_time_us > 0) {
-        double tput = (double)g_stats.insns_total / (g_stats.translations_time_us / 1000000.0);
+    if (st.translations_time_us > 0) {
+        double tput = (double)st.insns_total / (st.translations_time_us / 1000000.0);
         printf("  Translation throughput: %.0f insns/sec\n", tput);
     }
     printf("\n");
 
     /* Error statistics */
     printf("Error Statistics:\n");
-    printf("  Translation errors: %llu\n", (unsigned long long)g_stats.errors_translation);
-    printf("  Execution errors:   %llu\n", (unsigned long long)g_stats.errors_execution);
-    printf("  Memory errors:      %llu\n", (unsigned long long)g_stats.errors_memory);
+    printf("  Translation errors: %llu\n", (unsigned long long)st.errors_translation);
+    printf("  Execution errors:   %llu\n", (unsigned long long)st.errors_execution);
+    printf("  Memory errors:      %llu\n", (unsigned long long)st.errors_memory);
     printf("\n");
 
     /* Block statistics */
-    if (verbose && g_block_count > 0) {
-        printf("Tracked Blocks: %zu\n", g_block_count);
+    size_t block_count = rosetta_stats_get_block_count();
+    if (verbose && block_count > 0) {
+        printf("Tracked Blocks: %zu\n", block_count);
 
         /* Find and print hottest blocks */
         printf("\nTop 5 Hottest Blocks:\n");
@@ -227,8 +381,12 @@ void rosetta_stats_print(bool verbose)
  */
 int rosetta_stats_export_json(char *buf, size_t buf_size)
 {
-    double hit_rate = g_stats.cache_lookups > 0 ?
-        (double)g_stats.cache_hits / g_stats.cache_lookups * 100.0 : 0.0;
+    rosetta_stats_t st;
+
+    rosetta_stats_get(&st);
+
+    double hit_rate = st.cache_lookups > 0 ?
+        (double)st.cache_hits / st.cache_lookups * 100.0 : 0.0;
 
     return snprintf(buf, buf_size,
         "{"
@@ -245,24 +403,26 @@ int rosetta_stats_export_json(char *buf, size_t buf_size)
         "\"expansion_ratio\":%.2f,"
         "\"errors_total\":%llu"
         "}",
-        (unsigned long long)g_stats.blocks_translated,
-        (unsigned long long)g_stats.cache_lookups,
-        (unsigned long long)g_stats.cache_hits,
-        (unsigned long long)g_stats.cache_misses,
+        (unsigned long long)st.blocks_translated,
+        (unsigned long long)st.cache_lookups,
+        (unsigned long long)st.cache_hits,
+        (unsigned long long)st.cache_misses,
         hit_rate,
-        (unsigned long long)g_stats.insns_total,
-        (unsigned long long)g_stats.insns_alu,
-        (unsigned long long)g_stats.insns_mem,
-        (unsigned long long)g_stats.insns_branch,
-        (unsigned long long)g_stats.code_size_total,
-        g_stats.code_size_arm64 > 0 ? (double)g_stats.code_size_x86 / g_stats.code_size_arm64 : 0.0,
-        (unsigned long long)(g_stats.errors_translation + g_stats.errors_execution + g_stats.errors_memory));
+        (unsigned long long)st.insns_total,
+        (unsigned long long)st.insns_alu,
+        (unsigned long long)st.insns_mem,
+        (unsigned long long)st.insns_branch,
+        (unsigned long long)st.code_size_total,
+        st.code_size_arm64 > 0 ? (double)st.code_size_x86 / st.code_size_arm64 : 0.0,
+        (unsigned long long)(st.errors_translation + st.errors_execution + st.errors_memory));
 }
 
 /* ============================================================================
  * Statistics Recording Implementation
  * ============================================================================ */
 
+#ifndef ROSETTA_STATS_DISABLED
+
 /**
  * rosetta_stats_record_block - Record block translation
  */
@@ -270,17 +430,23 @@ void rosetta_stats_record_block(uint64_t guest_pc, uint64_t host_pc,
                                  uint32_t arm64_size, uint32_t x86_size,
                                  int insn_count)
 {
-    g_stats.blocks_translated++;
-    g_stats.blocks_cached++;
-    g_stats.code_size_total += x86_size;
-    g_stats.code_size_arm64 += arm64_size;
-    g_stats.code_size_x86 += x86_size;
-
-    if (g_stats.code_size_total > g_stats.code_size_peak) {
-        g_stats.code_size_peak = g_stats.code_size_total;
+    rosetta_stats_shard_t *s = rosetta_stats_shard();
+
+    rosetta_stats_bump(&s->counters[ROS_STAT_BLOCKS_TRANSLATED], 1);
+    rosetta_stats_bump(&s->counters[ROS_STAT_BLOCKS_CACHED], 1);
+    rosetta_stats_bump(&s->counters[ROS_STAT_CODE_SIZE_TOTAL], x86_size);
+    rosetta_stats_bump(&s->counters[ROS_STAT_CODE_SIZE_ARM64], arm64_size);
+    rosetta_stats_bump(&s->counters[ROS_STAT_CODE_SIZE_X86], x86_size);
+
+    /* Update histograms */
+    if (insn_count > 0 && insn_count <= ROS_STATS_HIST_BUCKETS) {
+        rosetta_stats_bump(&s->block_size_hist[insn_count - 1], 1);
+    } else if (insn_count > ROS_STATS_HIST_BUCKETS) {
+        rosetta_stats_bump(&s->block_size_hist[ROS_STATS_HIST_BUCKETS - 1], 1);
     }
 
     /* Record block statistics */
+    pthread_mutex_lock(&g_stats_lock);
     if (g_block_count < ROS_STATS_MAX_BLOCKS) {
         rosetta_block_stats_t *bs = &g_block_stats[g_block_count++];
         bs->guest_pc = guest_pc;
@@ -291,192 +457,75 @@ void rosetta_stats_record_block(uint64_t guest_pc, uint64_t host_pc,
         bs->flags = ROS_BLOCK_VALID | ROS_BLOCK_CACHED;
         bs->hit_count = 0;
     }
-
-    /* Update histograms */
-    if (insn_count > 0 && insn_count <= ROS_STATS_HIST_BUCKETS) {
-        g_block_size_hist[insn_count - 1]++;
-    } else if (insn_count > ROS_STATS_HIST_BUCKETS) {
-        g_block_size_hist[ROS_STATS_HIST_BUCKETS - 1]++;
-    }
-}
-
-/**
- * rosetta_stats_record_cache_hit - Record cache hit
- */
-void rosetta_stats_record_cache_hit(void)
-{
-    g_stats.cache_lookups++;
-    g_stats.cache_hits++;
-}
-
-/**
- * rosetta_stats_record_cache_miss - Record cache miss
- */
-void rosetta_stats_record_cache_miss(void)
-{
-    g_stats.cache_lookups++;
-    g_stats.cache_misses++;
-}
-
-/**
- * rosetta_stats_record_insn - Record instruction translation
- * @type: Instruction type
- */
-void rosetta_stats_record_insn(const char *type)
-{
-    g_stats.insns_total++;
-
-    if (strcmp(type, "ALU") == 0) {
-        g_stats.insns_alu++;
-    } else if (strcmp(type, "MEM") == 0) {
-        g_stats.insns_mem++;
-    } else if (strcmp(type, "BRANCH") == 0) {
-        g_stats.insns_branch++;
-    } else if (strcmp(type, "MOV") == 0) {
-        g_stats.insns_mov++;
-    } else if (strcmp(type, "COMPARE") == 0) {
-        g_stats.insns_compare++;
-    } else if (strcmp(type, "SYSTEM") == 0) {
-        g_stats.insns_system++;
-    } else if (strcmp(type, "NEON") == 0) {
-        g_stats.insns_neon++;
-    } else {
-        g_stats.insns_unknown++;
-    }
+    pthread_mutex_unlock(&g_stats_lock);
 }
 
-/**
- * rosetta_stats_record_alu - Record ALU instruction
- * @subtype: ALU subtype
- */
-void rosetta_stats_record_alu(const char *subtype)
-{
-    g_stats.insns_alu++;
-
-    if (strcmp(subtype, "add") == 0) {
-        g_stats.insns_alu_add++;
-    } else if (strcmp(subtype, "sub") == 0) {
-        g_stats.insns_alu_sub++;
-    } else if (strcmp(subtype, "and") == 0) {
-        g_stats.insns_alu_and++;
-    } else if (strcmp(subtype, "orr") == 0) {
-        g_stats.insns_alu_orr++;
-    } else if (strcmp(subtype, "eor") == 0) {
-        g_stats.insns_alu_eor++;
-    } else if (strcmp(subtype, "mvn") == 0) {
-        g_stats.insns_alu_mvn++;
-    } else if (strcmp(subtype, "mul") == 0) {
-        g_stats.insns_alu_mul++;
-    } else if (strcmp(subtype, "div") == 0) {
-        g_stats.insns_alu_div++;
-    } else if (strcmp(subtype, "shift") == 0) {
-        g_stats.insns_alu_shift++;
-    }
-}
+#endif /* ROSETTA_STATS_DISABLED */
 
-/**
- * rosetta_stats_record_mem - Record memory instruction
- * @subtype: Memory subtype
- */
-void rosetta_stats_record_mem(const char *subtype)
-{
-    g_stats.insns_mem++;
-
-    if (strcmp(subtype, "ldr") == 0) {
-        g_stats.insns_mem_ldr++;
-    } else if (strcmp(subtype, "str") == 0) {
-        g_stats.insns_mem_str++;
-    } else if (strcmp(subtype, "ldp") == 0) {
-        g_stats.insns_mem_ldp++;
-    } else if (strcmp(subtype, "stp") == 0) {
-        g_stats.insns_mem_stp++;
-    }
-}
+/* ============================================================================
+ * Block Statistics Implementation
+ * ============================================================================ */
 
 /**
- * rosetta_stats_record_branch - Record branch instruction
- * @subtype: Branch subtype
+ * rosetta_stats_get_block - Get block statistics
+ * @index: Block index
+ * @stats: Output structure
+ * Returns: 0 on success, -1 on error
  */
-void rosetta_stats_record_branch(const char *subtype)
+int rosetta_stats_get_block(size_t index, rosetta_block_stats_t *stats)
 {
-    g_stats.insns_branch++;
-
-    if (strcmp(subtype, "b") == 0) {
-        g_stats.insns_branch_b++;
-    } else if (strcmp(subtype, "bl") == 0) {
-        g_stats.insns_branch_bl++;
-    } else if (strcmp(subtype, "br") == 0) {
-        g_stats.insns_branch_br++;
-    } else if (strcmp(subtype, "ret") == 0) {
-        g_stats.insns_branch_ret++;
-    } else if (strcmp(subtype, "cond") == 0) {
-        g_stats.insns_branch_cond++;
-    } else if (strcmp(subtype, "cbz") == 0) {
-        g_stats.insns_branch_cbz++;
-    } else if (strcmp(subtype, "cbnz") == 0) {
-        g_stats.insns_branch_cbnz++;
-    }
-}
+    int ret = -1;
 
-/**
- * rosetta_stats_record_error - Record error
- * @error_code: Error code
- */
-void rosetta_stats_record_error(const char *error_code)
-{
-    if (strcmp(error_code, "translation") == 0) {
-        g_stats.errors_translation++;
-    } else if (strcmp(error_code, "execution") == 0) {
-        g_stats.errors_execution++;
-    } else if (strcmp(error_code, "memory") == 0) {
-        g_stats.errors_memory++;
+    pthread_mutex_lock(&g_stats_lock);
+    if (index < g_block_count && stats) {
+        *stats = g_block_stats[index];
+        ret = 0;
     }
+    pthread_mutex_unlock(&g_stats_lock);
+    return ret;
 }
 
 /**
- * rosetta_stats_record_execution_time - Record execution time
- * @time_us: Time in microseconds
+ * rosetta_stats_get_block_count - Get number of tracked blocks
+ * Returns: Block count
  */
-void rosetta_stats_record_execution_time(uint64_t time_us)
+size_t rosetta_stats_get_block_count(void)
 {
-    g_stats.execution_time_us += time_us;
+    pthread_mutex_lock(&g_stats_lock);
+    size_t n = g_block_count;
+    pthread_mutex_unlock(&g_stats_lock);
+    return n;
 }
 
 /**
- * rosetta_stats_record_translation_time - Record translation time
- * @time_us: Time in microseconds
+ * rosetta_stats_set_block_hits - Set block execution count
+ * @guest_pc: Guest PC
+ * @hits: Executions
  */
-void rosetta_stats_record_translation_time(uint64_t time_us)
+void rosetta_stats_set_block_hits(uint64_t guest_pc, uint64_t hits)
 {
-    g_stats.translations_time_us += time_us;
-}
+    uint32_t h = hits > UINT32_MAX ? UINT32_MAX : (uint32_t)hits;
 
-/* ============================================================================
- * Block Statistics Implementation
- * ============================================================================ */
-
-/**
- * rosetta_stats_get_block - Get block statistics
- * @index: Block index
- * @stats: Output structure
- * Returns: 0 on success, -1 on error
- */
-int rosetta_stats_get_block(size_t index, rosetta_block_stats_t *stats)
-{
-    if (index >= g_block_count || !stats) {
-        return -1;
+    pthread_mutex_lock(&g_stats_lock);
+    for (size_t i = 0; i < g_block_count; i++) {
+        if (g_block_stats[i].guest_pc == guest_pc) {
+            g_block_stats[i].hit_count = h;
+        }
     }
-    *stats = g_block_stats[index];
-    return 0;
+    pthread_mutex_unlock(&g_stats_lock);
 }
 
 /**
- * rosetta_stats_get_block_count - Get number of tracked blocks
- * Returns: Block count
+ * Copy the block table for sorting
+ * Returns: Number of blocks copied
  */
-size_t rosetta_stats_get_block_count(void)
+static size_t copy_blocks(rosetta_block_stats_t *temp)
 {
-    return g_block_count;
+    pthread_mutex_lock(&g_stats_lock);
+    size_t n = g_block_count;
+    memcpy(temp, g_block_stats, n * sizeof(*temp));
+    pthread_mutex_unlock(&g_stats_lock);
+    return n;
 }
 
 /**
@@ -487,17 +536,18 @@ size_t rosetta_stats_get_block_count(void)
  */
 size_t rosetta_stats_get_hot_blocks(rosetta_block_stats_t *blocks, size_t count)
 {
-    if (!blocks || count == 0 || g_block_count == 0) {
+    rosetta_block_stats_t temp[ROS_STATS_MAX_BLOCKS];
+
+    if (!blocks || count == 0) {
         return 0;
     }
 
-    /* Simple bubble sort to find top N */
-    rosetta_block_stats_t temp[ROS_STATS_MAX_BLOCKS];
-    memcpy(temp, g_block_stats, sizeof(g_block_stats));
+    /* Simple selection sort to find top N */
+    size_t n = copy_blocks(temp);
 
-    for (size_t i = 0; i < g_block_count && i < count; i++) {
+    for (size_t i = 0; i < n && i < count; i++) {
         size_t max_idx = i;
-        for (size_t j = i + 1; j < g_block_count; j++) {
+        for (size_t j = i + 1; j < n; j++) {
             if (temp[j].hit_count > temp[max_idx].hit_count) {
                 max_idx = j;
             }
@@ -510,7 +560,7 @@ size_t rosetta_stats_get_hot_blocks(rosetta_block_stats_t *blocks, size_t count)
         blocks[i] = temp[i];
     }
 
-    return (count < g_block_count) ? count : g_block_count;
+    return (count < n) ? count : n;
 }
 
 /**
@@ -521,16 +571,17 @@ size_t rosetta_stats_get_hot_blocks(rosetta_block_stats_t *blocks, size_t count)
  */
 size_t rosetta_stats_get_cold_blocks(rosetta_block_stats_t *blocks, size_t count)
 {
-    if (!blocks || count == 0 || g_block_count == 0) {
+    rosetta_block_stats_t temp[ROS_STATS_MAX_BLOCKS];
+
+    if (!blocks || count == 0) {
         return 0;
     }
 
-    rosetta_block_stats_t temp[ROS_STATS_MAX_BLOCKS];
-    memcpy(temp, g_block_stats, sizeof(g_block_stats));
+    size_t n = copy_blocks(temp);
 
-    for (size_t i = 0; i < g_block_count && i < count; i++) {
+    for (size_t i = 0; i < n && i < count; i++) {
         size_t min_idx = i;
-        for (size_t j = i + 1; j < g_block_count; j++) {
+        for (size_t j = i + 1; j < n; j++) {
             if (temp[j].hit_count < temp[min_idx].hit_count) {
                 min_idx = j;
             }
@@ -543,13 +594,22 @@ size_t rosetta_stats_get_cold_blocks(rosetta_block_stats_t *blocks, size_t count
         blocks[i] = temp[i];
     }
 
-    return (count < g_block_count) ? count : g_block_count;
+    return (count < n) ? count : n;
 }
 
 /* ============================================================================
  * Histogram and Profiling Implementation
  * ============================================================================ */
 
+static void copy_hist(uint32_t *hist, size_t count, const uint64_t *src)
+{
+    size_t copy = (count < ROS_STATS_HIST_BUCKETS) ? count : ROS_STATS_HIST_BUCKETS;
+
+    for (size_t i = 0; i < copy; i++) {
+        hist[i] = (uint32_t)src[i];
+    }
+}
+
 /**
  * rosetta_stats_get_insn_size_histogram - Get instruction size histogram
  * @hist: Output array
@@ -557,12 +617,14 @@ size_t rosetta_stats_get_cold_blocks(rosetta_block_stats_t *blocks, size_t count
  */
 void rosetta_stats_get_insn_size_histogram(uint32_t *hist, size_t count)
 {
+    rosetta_stats_shard_t snap;
+
     if (!hist || count == 0) {
         return;
     }
 
-    size_t copy = (count < ROS_STATS_HIST_BUCKETS) ? count : ROS_STATS_HIST_BUCKETS;
-    memcpy(hist, g_insn_size_hist, copy * sizeof(uint32_t));
+    stats_snapshot(&snap);
+    copy_hist(hist, count, snap.insn_size_hist);
 }
 
 /**
@@ -572,12 +634,14 @@ void rosetta_stats_get_insn_size_histogram(uint32_t *hist, size_t count)
  */
 void rosetta_stats_get_block_size_histogram(uint32_t *hist, size_t count)
 {
+    rosetta_stats_shard_t snap;
+
     if (!hist || count == 0) {
         return;
     }
 
-    size_t copy = (count < ROS_STATS_HIST_BUCKETS) ? count : ROS_STATS_HIST_BUCKETS;
-    memcpy(hist, g_block_size_hist, copy * sizeof(uint32_t));
+    stats_snapshot(&snap);
+    copy_hist(hist, count, snap.block_size_hist);
 }
 
 /**
@@ -586,10 +650,13 @@ void rosetta_stats_get_block_size_histogram(uint32_t *hist, size_t count)
  */
 double rosetta_stats_get_cache_hit_rate(void)
 {
-    if (g_stats.cache_lookups == 0) {
+    rosetta_stats_t st;
+
+    rosetta_stats_get(&st);
+    if (st.cache_lookups == 0) {
         return 0.0;
     }
-    return (double)g_stats.cache_hits / g_stats.cache_lookups * 100.0;
+    return (double)st.cache_hits / st.cache_lookups * 100.0;
 }
 
 /**
@@ -598,10 +665,13 @@ double rosetta_stats_get_cache_hit_rate(void)
  */
 double rosetta_stats_get_avg_block_size(void)
 {
-    if (g_stats.blocks_translated == 0) {
+    rosetta_stats_t st;
+
+    rosetta_stats_get(&st);
+    if (st.blocks_translated == 0) {
         return 0.0;
     }
-    return (double)g_stats.insns_total / g_stats.blocks_translated;
+    return (double)st.insns_total / st.blocks_translated;
 }
 
 /**
@@ -610,26 +680,19 @@ double rosetta_stats_get_avg_block_size(void)
  */
 double rosetta_stats_get_expansion_ratio(void)
 {
-    if (g_stats.code_size_arm64 == 0) {
+    rosetta_stats_t st;
+
+    rosetta_stats_get(&st);
+    if (st.code_size_arm64 == 0) {
         return 0.0;
     }
-    return (double)g_stats.code_size_x86 / g_stats.code_size_arm64;
+    return (double)st.code_size_x86 / st.code_size_arm64;
 }
 
 /* ============================================================================
  * Local Statistics Wrappers (for backward compatibility)
  * ============================================================================ */
 
-/* Local statistics state */
-static uint64_t g_local_stats_translations = 0;
-static uint64_t g_local_stats_cache_hits = 0;
-static uint64_t g_local_stats_cache_misses = 0;
-static uint64_t g_local_stats_total_insns = 0;
-static uint64_t g_local_stats_alu = 0;
-static uint64_t g_local_stats_mem = 0;
-static uint64_t g_local_stats_branch = 0;
-static uint64_t g_local_stats_system = 0;
-
 /**
  * rosetta_stats_get_local - Get local statistics
  * @translations: Output translations count
@@ -646,14 +709,17 @@ void rosetta_stats_get_local(uint64_t *translations, uint64_t *cache_hits,
                               uint64_t *alu, uint64_t *mem,
                               uint64_t *branch, uint64_t *system)
 {
-    if (translations) *translations = g_local_stats_translations;
-    if (cache_hits) *cache_hits = g_local_stats_cache_hits;
-    if (cache_misses) *cache_misses = g_local_stats_cache_misses;
-    if (total_insns) *total_insns = g_local_stats_total_insns;
-    if (alu) *alu = g_local_stats_alu;
-    if (mem) *mem = g_local_stats_mem;
-    if (branch) *branch = g_local_stats_branch;
-    if (system) *system = g_local_stats_system;
+    rosetta_stats_shard_t snap;
+
+    stats_snapshot(&snap);
+    if (translations) *translations = snap.local[ROS_LOCAL_TRANSLATIONS];
+    if (cache_hits) *cache_hits = snap.local[ROS_LOCAL_CACHE_HITS];
+    if (cache_misses) *cache_misses = snap.local[ROS_LOCAL_CACHE_MISSES];
+    if (total_insns) *total_insns = snap.local[ROS_LOCAL_INSNS_TOTAL];
+    if (alu) *alu = snap.local[ROS_LOCAL_ALU];
+    if (mem) *mem = snap.local[ROS_LOCAL_MEM];
+    if (branch) *branch = snap.local[ROS_LOCAL_BRANCH];
+    if (system) *system = snap.local[ROS_LOCAL_SYSTEM];
 }
 
 /**
@@ -661,55 +727,10 @@ void rosetta_stats_get_local(uint64_t *translations, uint64_t *cache_hits,
  */
 void rosetta_stats_reset_local(void)
 {
-    g_local_stats_translations = 0;
-    g_local_stats_cache_hits = 0;
-    g_local_stats_cache_misses = 0;
-    g_local_stats_total_insns = 0;
-    g_local_stats_alu = 0;
-    g_local_stats_mem = 0;
-    g_local_stats_branch = 0;
-    g_local_stats_system = 0;
-}
-
-/**
- * rosetta_stats_record_local_translation - Record local translation
- */
-void rosetta_stats_record_local_translation(void)
-{
-    g_local_stats_translations++;
-}
+    rosetta_stats_shard_t sum;
 
-/**
- * rosetta_stats_record_local_cache_hit - Record local cache hit
- */
-void rosetta_stats_record_local_cache_hit(void)
-{
-    g_local_stats_cache_hits++;
-}
-
-/**
- * rosetta_stats_record_local_cache_miss - Record local cache miss
- */
-void rosetta_stats_record_local_cache_miss(void)
-{
-    g_local_stats_cache_misses++;
-}
-
-/**
- * rosetta_stats_record_local_insn - Record local instruction
- * @type: Instruction type
- */
-void rosetta_stats_record_local_insn(const char *type)
-{
-    g_local_stats_total_insns++;
-
-    if (strcmp(type, "ALU") == 0) {
-        g_local_stats_alu++;
-    } else if (strcmp(type, "MEM") == 0) {
-        g_local_stats_mem++;
-    } else if (strcmp(type, "BRANCH") == 0) {
-        g_local_stats_branch++;
-    } else if (strcmp(type, "SYSTEM") == 0) {
-        g_local_stats_system++;
-    }
+    pthread_mutex_lock(&g_stats_lock);
+    shards_sum(&sum);
+    memcpy(g_baseline.local, sum.local, sizeof(g_baseline.local));
+    pthread_mutex_unlock(&g_stats_lock);
 }
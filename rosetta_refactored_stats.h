@@ -4,6 +4,13 @@
  *
  * This module provides statistics collection and reporting for the
  * Rosetta translation layer.
+ *
+ * Counters are keyed by rosetta_stat_id_t and live in per-thread shards,
+ * one cache line aligned block per thread, so recording is a plain
+ * load/add/store on memory no other thread writes. Readers sum all shards.
+ *
+ * Build with -DROSETTA_STATS_DISABLED to compile every recording call to
+ * nothing; the query functions then report zeros.
  * ============================================================================ */
 
 #ifndef ROSETTA_REFACTORED_STATS_H
@@ -60,6 +67,7 @@ typedef struct {
     uint64_t insns_compare;
     uint64_t insns_system;
     uint64_t insns_neon;
+    uint64_t insns_fp;
     uint64_t insns_unknown;
 
     /* Code size statistics */
@@ -88,7 +96,7 @@ typedef struct {
     uint32_t x86_size;
     uint8_t insn_count;
     uint8_t flags;
-    uint16_t hit_count;
+    uint32_t hit_count;         /* Executions, fed by block profiling */
 } rosetta_block_stats_t;
 
 /* Block statistics flags */
@@ -101,6 +109,95 @@ typedef struct {
 #define ROS_STATS_MAX_BLOCKS  1024
 #define ROS_STATS_HISTORY_SIZE 256
 
+/* Instruction size histogram buckets */
+#define ROS_STATS_HIST_BUCKETS  16
+
+/* Counter ids, one per rosetta_stats_t field and in the same order */
+typedef enum {
+    ROS_STAT_BLOCKS_TRANSLATED = 0,
+    ROS_STAT_BLOCKS_CACHED,
+    ROS_STAT_BLOCKS_EVICTED,
+
+    ROS_STAT_CACHE_LOOKUPS,
+    ROS_STAT_CACHE_HITS,
+    ROS_STAT_CACHE_MISSES,
+    ROS_STAT_CACHE_INSERTS,
+    ROS_STAT_CACHE_FLUSHES,
+
+    ROS_STAT_INSNS_TOTAL,
+    ROS_STAT_INSNS_ALU,
+    ROS_STAT_INSNS_ALU_ADD,
+    ROS_STAT_INSNS_ALU_SUB,
+    ROS_STAT_INSNS_ALU_AND,
+    ROS_STAT_INSNS_ALU_ORR,
+    ROS_STAT_INSNS_ALU_EOR,
+    ROS_STAT_INSNS_ALU_MVN,
+    ROS_STAT_INSNS_ALU_MUL,
+    ROS_STAT_INSNS_ALU_DIV,
+    ROS_STAT_INSNS_ALU_SHIFT,
+    ROS_STAT_INSNS_MEM,
+    ROS_STAT_INSNS_MEM_LDR,
+    ROS_STAT_INSNS_MEM_STR,
+    ROS_STAT_INSNS_MEM_LDP,
+    ROS_STAT_INSNS_MEM_STP,
+    ROS_STAT_INSNS_BRANCH,
+    ROS_STAT_INSNS_BRANCH_B,
+    ROS_STAT_INSNS_BRANCH_BL,
+    ROS_STAT_INSNS_BRANCH_BR,
+    ROS_STAT_INSNS_BRANCH_RET,
+    ROS_STAT_INSNS_BRANCH_COND,
+    ROS_STAT_INSNS_BRANCH_CBZ,
+    ROS_STAT_INSNS_BRANCH_CBNZ,
+    ROS_STAT_INSNS_MOV,
+    ROS_STAT_INSNS_COMPARE,
+    ROS_STAT_INSNS_SYSTEM,
+    ROS_STAT_INSNS_NEON,
+    ROS_STAT_INSNS_FP,
+    ROS_STAT_INSNS_UNKNOWN,
+
+    ROS_STAT_CODE_SIZE_TOTAL,
+    ROS_STAT_CODE_SIZE_ARM64,
+    ROS_STAT_CODE_SIZE_X86,
+    ROS_STAT_CODE_SIZE_PEAK,        /* Derived on read */
+
+    ROS_STAT_CYCLES_GUEST,
+    ROS_STAT_CYCLES_HOST,
+    ROS_STAT_TRANSLATION_TIME_US,
+    ROS_STAT_EXECUTION_TIME_US,
+
+    ROS_STAT_ERRORS_TRANSLATION,
+    ROS_STAT_ERRORS_EXECUTION,
+    ROS_STAT_ERRORS_MEMORY,
+
+    ROS_STAT_COUNT
+} rosetta_stat_id_t;
+
+/* Counters kept only for the local statistics wrappers */
+typedef enum {
+    ROS_LOCAL_TRANSLATIONS = 0,
+    ROS_LOCAL_CACHE_HITS,
+    ROS_LOCAL_CACHE_MISSES,
+    ROS_LOCAL_INSNS_TOTAL,
+    ROS_LOCAL_ALU,
+    ROS_LOCAL_MEM,
+    ROS_LOCAL_BRANCH,
+    ROS_LOCAL_SYSTEM,
+    ROS_LOCAL_COUNT
+} rosetta_local_stat_id_t;
+
+/**
+ * One thread's counters. Only the owning thread writes a shard; readers
+ * load it concurrently, so every access is a relaxed atomic.
+ */
+typedef struct rosetta_stats_shard {
+    uint64_t counters[ROS_STAT_COUNT];
+    uint64_t local[ROS_LOCAL_COUNT];
+    uint64_t insn_size_hist[ROS_STATS_HIST_BUCKETS];
+    uint64_t block_size_hist[ROS_STATS_HIST_BUCKETS];
+    struct rosetta_stats_shard *next;   /* All shards, newest first */
+    uint32_t in_use;                    /* Owned by a live thread */
+} __attribute__((aligned(64))) rosetta_stats_shard_t;
+
 /* ============================================================================
  * Statistics API
  * ============================================================================ */
@@ -145,69 +242,180 @@ int rosetta_stats_export_json(char *buf, size_t buf_size);
  * Statistics Recording
  * ============================================================================ */
 
+#ifndef ROSETTA_STATS_DISABLED
+
+/* This thread's shard, NULL until its first recording */
+extern _Thread_local rosetta_stats_shard_t *rosetta_stats_tls_shard;
+
 /**
- * Record block translation
- * @guest_pc: Guest PC
- * @host_pc: Host PC
- * @arm64_size: ARM64 block size
- * @x86_size: x86_64 block size
- * @insn_count: Number of instructions
+ * Claim a shard for the calling thread, reusing one left by an exited
+ * thread if possible; the shard is released again at thread exit
+ * Returns: The shard (a shared fallback if allocation fails)
  */
-void rosetta_stats_record_block(uint64_t guest_pc, uint64_t host_pc,
-                                 uint32_t arm64_size, uint32_t x86_size,
-                                 int insn_count);
+rosetta_stats_shard_t *rosetta_stats_shard_attach(void);
+
+static inline rosetta_stats_shard_t *rosetta_stats_shard(void)
+{
+    rosetta_stats_shard_t *s = rosetta_stats_tls_shard;
+    return __builtin_expect(s != NULL, 1) ? s : rosetta_stats_shard_attach();
+}
+
+/* Single-writer increment: no lock prefix, but never torn for readers */
+static inline void rosetta_stats_bump(uint64_t *counter, uint64_t n)
+{
+    __atomic_store_n(counter, __atomic_load_n(counter, __ATOMIC_RELAXED) + n,
+                     __ATOMIC_RELAXED);
+}
+
+/**
+ * Add n to a counter
+ * @id: Counter
+ * @n: Amount
+ */
+static inline void rosetta_stats_add(rosetta_stat_id_t id, uint64_t n)
+{
+    rosetta_stats_bump(&rosetta_stats_shard()->counters[id], n);
+}
+
+static inline void rosetta_stats_inc(rosetta_stat_id_t id)
+{
+    rosetta_stats_add(id, 1);
+}
 
 /**
  * Record cache hit
  */
-void rosetta_stats_record_cache_hit(void);
+static inline void rosetta_stats_record_cache_hit(void)
+{
+    rosetta_stats_shard_t *s = rosetta_stats_shard();
+    rosetta_stats_bump(&s->counters[ROS_STAT_CACHE_LOOKUPS], 1);
+    rosetta_stats_bump(&s->counters[ROS_STAT_CACHE_HITS], 1);
+}
 
 /**
  * Record cache miss
  */
-void rosetta_stats_record_cache_miss(void);
+static inline void rosetta_stats_record_cache_miss(void)
+{
+    rosetta_stats_shard_t *s = rosetta_stats_shard();
+    rosetta_stats_bump(&s->counters[ROS_STAT_CACHE_LOOKUPS], 1);
+    rosetta_stats_bump(&s->counters[ROS_STAT_CACHE_MISSES], 1);
+}
 
 /**
  * Record instruction translation
- * @type: Instruction type (ALU, MEM, BRANCH, etc.)
+ * @kind: Class counter (ROS_STAT_INSNS_ALU, _MEM, _BRANCH, _MOV, _COMPARE,
+ *        _SYSTEM, _NEON, _FP or _UNKNOWN)
+ */
+static inline void rosetta_stats_record_insn(rosetta_stat_id_t kind)
+{
+    rosetta_stats_shard_t *s = rosetta_stats_shard();
+    rosetta_stats_bump(&s->counters[ROS_STAT_INSNS_TOTAL], 1);
+    rosetta_stats_bump(&s->counters[kind], 1);
+}
+
+/**
+ * Record a translated instruction with its subtype
+ * @kind: Class counter
+ * @subtype: Subtype counter, e.g. ROS_STAT_INSNS_ALU_ADD, or kind if none
  */
-void rosetta_stats_record_insn(const char *type);
+static inline void rosetta_stats_record_insn_sub(rosetta_stat_id_t kind,
+                                                 rosetta_stat_id_t subtype)
+{
+    rosetta_stats_shard_t *s = rosetta_stats_shard();
+    rosetta_stats_bump(&s->counters[ROS_STAT_INSNS_TOTAL], 1);
+    rosetta_stats_bump(&s->counters[kind], 1);
+    if (subtype != kind) {
+        rosetta_stats_bump(&s->counters[subtype], 1);
+    }
+}
 
 /**
  * Record ALU instruction
- * @subtype: ALU subtype (add, sub, etc.)
+ * @subtype: ALU subtype (ROS_STAT_INSNS_ALU_ADD, ...) or ROS_STAT_INSNS_ALU
  */
-void rosetta_stats_record_alu(const char *subtype);
+static inline void rosetta_stats_record_alu(rosetta_stat_id_t subtype)
+{
+    rosetta_stats_record_insn_sub(ROS_STAT_INSNS_ALU, subtype);
+}
 
 /**
  * Record memory instruction
- * @subtype: Memory subtype (ldr, str, etc.)
+ * @subtype: Memory subtype (ROS_STAT_INSNS_MEM_LDR, ...) or ROS_STAT_INSNS_MEM
  */
-void rosetta_stats_record_mem(const char *subtype);
+static inline void rosetta_stats_record_mem(rosetta_stat_id_t subtype)
+{
+    rosetta_stats_record_insn_sub(ROS_STAT_INSNS_MEM, subtype);
+}
 
 /**
  * Record branch instruction
- * @subtype: Branch subtype (b, bl, ret, etc.)
+ * @subtype: Branch subtype (ROS_STAT_INSNS_BRANCH_B, ...) or ROS_STAT_INSNS_BRANCH
  */
-void rosetta_stats_record_branch(const char *subtype);
+static inline void rosetta_stats_record_branch(rosetta_stat_id_t subtype)
+{
+    rosetta_stats_record_insn_sub(ROS_STAT_INSNS_BRANCH, subtype);
+}
 
 /**
- * Record translation error
- * @error_code: Error code
+ * Record error
+ * @error: ROS_STAT_ERRORS_TRANSLATION, _EXECUTION or _MEMORY
  */
-void rosetta_stats_record_error(const char *error_code);
+static inline void rosetta_stats_record_error(rosetta_stat_id_t error)
+{
+    rosetta_stats_inc(error);
+}
 
 /**
  * Record execution time
  * @time_us: Execution time in microseconds
  */
-void rosetta_stats_record_execution_time(uint64_t time_us);
+static inline void rosetta_stats_record_execution_time(uint64_t time_us)
+{
+    rosetta_stats_add(ROS_STAT_EXECUTION_TIME_US, time_us);
+}
 
 /**
  * Record translation time
  * @time_us: Translation time in microseconds
  */
-void rosetta_stats_record_translation_time(uint64_t time_us);
+static inline void rosetta_stats_record_translation_time(uint64_t time_us)
+{
+    rosetta_stats_add(ROS_STAT_TRANSLATION_TIME_US, time_us);
+}
+
+/**
+ * Record block translation
+ * @guest_pc: Guest PC
+ * @host_pc: Host PC
+ * @arm64_size: ARM64 block size
+ * @x86_size: x86_64 block size
+ * @insn_count: Number of instructions
+ */
+void rosetta_stats_record_block(uint64_t guest_pc, uint64_t host_pc,
+                                 uint32_t arm64_size, uint32_t x86_size,
+                                 int insn_count);
+
+#else /* ROSETTA_STATS_DISABLED */
+
+static inline void rosetta_stats_add(rosetta_stat_id_t id, uint64_t n) { }
+static inline void rosetta_stats_inc(rosetta_stat_id_t id) { }
+static inline void rosetta_stats_record_cache_hit(void) { }
+static inline void rosetta_stats_record_cache_miss(void) { }
+static inline void rosetta_stats_record_insn(rosetta_stat_id_t kind) { }
+static inline void rosetta_stats_record_insn_sub(rosetta_stat_id_t kind,
+                                                 rosetta_stat_id_t subtype) { }
+static inline void rosetta_stats_record_alu(rosetta_stat_id_t subtype) { }
+static inline void rosetta_stats_record_mem(rosetta_stat_id_t subtype) { }
+static inline void rosetta_stats_record_branch(rosetta_stat_id_t subtype) { }
+static inline void rosetta_stats_record_error(rosetta_stat_id_t error) { }
+static inline void rosetta_stats_record_execution_time(uint64_t time_us) { }
+static inline void rosetta_stats_record_translation_time(uint64_t time_us) { }
+static inline void rosetta_stats_record_block(uint64_t guest_pc, uint64_t host_pc,
+                                              uint32_t arm64_size, uint32_t x86_size,
+                                              int insn_count) { }
+
+#endif /* ROSETTA_STATS_DISABLED */
 
 /* ============================================================================
  * Block Statistics
@@ -227,6 +435,13 @@ int rosetta_stats_get_block(size_t index, rosetta_block_stats_t *stats);
  */
 size_t rosetta_stats_get_block_count(void);
 
+/**
+ * Set the execution count of every tracked block starting at guest_pc
+ * @guest_pc: Guest PC
+ * @hits: Executions (saturated to 32 bits)
+ */
+void rosetta_stats_set_block_hits(uint64_t guest_pc, uint64_t hits);
+
 /**
  * Find hottest blocks
  * @blocks: Output array
@@ -247,9 +462,6 @@ size_t rosetta_stats_get_cold_blocks(rosetta_block_stats_t *blocks, size_t count
  * Histogram and Profiling
  * ============================================================================ */
 
-/* Instruction size histogram buckets */
-#define ROS_STATS_HIST_BUCKETS  16
-
 /**
  * Get instruction size histogram
  * @hist: Output histogram array
@@ -307,25 +519,57 @@ void rosetta_stats_get_local(uint64_t *translations, uint64_t *cache_hits,
  */
 void rosetta_stats_reset_local(void);
 
+#ifndef ROSETTA_STATS_DISABLED
+
 /**
  * Record local translation
  */
-void rosetta_stats_record_local_translation(void);
+static inline void rosetta_stats_record_local_translation(void)
+{
+    rosetta_stats_bump(&rosetta_stats_shard()->local[ROS_LOCAL_TRANSLATIONS], 1);
+}
 
 /**
  * Record local cache hit
  */
-void rosetta_stats_record_local_cache_hit(void);
+static inline void rosetta_stats_record_local_cache_hit(void)
+{
+    rosetta_stats_bump(&rosetta_stats_shard()->local[ROS_LOCAL_CACHE_HITS], 1);
+}
 
 /**
  * Record local cache miss
  */
-void rosetta_stats_record_local_cache_miss(void);
+static inline void rosetta_stats_record_local_cache_miss(void)
+{
+    rosetta_stats_bump(&rosetta_stats_shard()->local[ROS_LOCAL_CACHE_MISSES], 1);
+}
 
 /**
  * Record local instruction
- * @type: Instruction type (ALU, MEM, BRANCH, SYSTEM)
+ * @kind: ROS_STAT_INSNS_ALU, _MEM, _BRANCH or _SYSTEM; others only count
+ *        towards the total
  */
-void rosetta_stats_record_local_insn(const char *type);
+static inline void rosetta_stats_record_local_insn(rosetta_stat_id_t kind)
+{
+    rosetta_stats_shard_t *s = rosetta_stats_shard();
+    rosetta_stats_bump(&s->local[ROS_LOCAL_INSNS_TOTAL], 1);
+    switch (kind) {
+    case ROS_STAT_INSNS_ALU:    rosetta_stats_bump(&s->local[ROS_LOCAL_ALU], 1); break;
+    case ROS_STAT_INSNS_MEM:    rosetta_stats_bump(&s->local[ROS_LOCAL_MEM], 1); break;
+    case ROS_STAT_INSNS_BRANCH: rosetta_stats_bump(&s->local[ROS_LOCAL_BRANCH], 1); break;
+    case ROS_STAT_INSNS_SYSTEM: rosetta_stats_bump(&s->local[ROS_LOCAL_SYSTEM], 1); break;
+    default: break;
+    }
+}
+
+#else /* ROSETTA_STATS_DISABLED */
+
+static inline void rosetta_stats_record_local_translation(void) { }
+static inline void rosetta_stats_record_local_cache_hit(void) { }
+static inline void rosetta_stats_record_local_cache_miss(void) { }
+static inline void rosetta_stats_record_local_insn(rosetta_stat_id_t kind) { }
+
+#endif /* ROSETTA_STATS_DISABLED */
 
 #endif /* ROSETTA_REFACTORED_STATS_H */
@@ -12,29 +12,22 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
 #include <unistd.h>
 #include <sys/mman.h>
+#include <sys/syscall.h>
 
 /* ============================================================================
  * Syscall Table
+ * ============================================================================
+ *
+ * Registered handlers live in the dense dispatch table owned by
+ * rosetta_syscalls.c, so translated code, dispatch_syscall() and this
+ * API all resolve a syscall number through the same single index.
  * ============================================================================ */
 
-/* Maximum syscall number we track */
-#define MAX_SYSCALL_NUMBER 500
-
-/* Syscall table */
-static ros_syscall_desc_t g_syscall_table[MAX_SYSCALL_NUMBER];
 static bool g_syscall_initialized = false;
 
-/* ============================================================================
- * Forward Declarations - Wrapper functions around rosetta_syscalls.c
- * ============================================================================ */
-
-extern int64_t translate_syscall(int number, uint64_t arg1, uint64_t arg2,
-                                  uint64_t arg3, uint64_t arg4,
-                                  uint64_t arg5, uint64_t arg6);
-extern void syscall_entry(void);
-
 /* ============================================================================
  * Syscall Initialization
  * ============================================================================ */
@@ -48,8 +41,8 @@ int rosetta_syscall_init(void)
         rosetta_syscall_cleanup();
     }
 
-    /* Initialize syscall table */
-    memset(g_syscall_table, 0, sizeof(g_syscall_table));
+    /* Build the dense dispatch table */
+    init_syscall_table();
 
     g_syscall_initialized = true;
     return 0;
@@ -60,11 +53,20 @@ int rosetta_syscall_init(void)
  */
 void rosetta_syscall_cleanup(void)
 {
+    int i;
+
     if (!g_syscall_initialized) {
         return;
     }
 
-    memset(g_syscall_table, 0, sizeof(g_syscall_table));
+    /* Drop runtime registrations, keep the built-in handlers */
+    for (i = 0; i < X86_64_SYSCALL_MAX; i++) {
+        const syscall_desc_t *desc = syscall_lookup(i);
+        if (desc != NULL && desc->raw_handler != NULL) {
+            syscall_register_raw(i, NULL, NULL);
+        }
+    }
+
     g_syscall_initialized = false;
 }
 
@@ -79,17 +81,40 @@ int64_t rosetta_syscall(int number, uint64_t arg1, uint64_t arg2,
                         uint64_t arg3, uint64_t arg4,
                         uint64_t arg5, uint64_t arg6)
 {
-    if (number < 0 || number >= MAX_SYSCALL_NUMBER) {
+    const syscall_desc_t *desc = syscall_lookup(number);
+
+    if (desc == NULL) {
         return ROS_SYSCALL_UNIMPLEMENTED;
     }
 
     /* Check if we have a registered handler */
-    if (g_syscall_table[number].handler != NULL) {
-        return g_syscall_table[number].handler(arg1, arg2, arg3, arg4, arg5, arg6);
+    if (desc->raw_handler != NULL) {
+        return desc->raw_handler(arg1, arg2, arg3, arg4, arg5, arg6);
     }
 
-    /* Use the underlying translation layer */
-    return translate_syscall(number, arg1, arg2, arg3, arg4, arg5, arg6);
+    /* Passthrough-safe syscalls go straight to the host kernel */
+    if ((desc->flags & SYSCALL_FLAG_PASSTHROUGH) && desc->arm64_nr >= 0) {
+        long ret = syscall(desc->arm64_nr, arg1, arg2, arg3, arg4, arg5, arg6);
+        return (ret == -1) ? -errno : ret;
+    }
+
+    /* Built-in handlers read their arguments from guest registers */
+    if (desc->handler != NULL) {
+        ThreadState st;
+
+        memset(&st, 0, sizeof(st));
+        st.guest.r[X86_RDI] = arg1;
+        st.guest.r[X86_RSI] = arg2;
+        st.guest.r[X86_RDX] = arg3;
+        st.guest.r[X86_R10] = arg4;
+        st.guest.r[X86_R8]  = arg5;
+        st.guest.r[X86_R9]  = arg6;
+
+        desc->handler(&st);
+        return st.syscall_result;
+    }
+
+    return ROS_SYSCALL_UNIMPLEMENTED;
 }
 
 /**
@@ -110,25 +135,22 @@ int64_t rosetta_syscall_execute(int number, uint64_t *args)
  */
 int rosetta_handle_syscall(int number, void *state)
 {
-    (void)state;  /* State is accessed via rosetta_get_reg() */
+    ThreadState *st = (ThreadState *)state;
 
-    if (number < 0 || number >= MAX_SYSCALL_NUMBER) {
-        return ROS_SYSCALL_UNIMPLEMENTED;
+    if (st == NULL) {
+        return ROS_SYSCALL_ERROR;
     }
 
-    /* Get arguments from guest registers (ARM64 convention: X0-X5) */
-    uint64_t arg1 = rosetta_get_reg(0);
-    uint64_t arg2 = rosetta_get_reg(1);
-    uint64_t arg3 = rosetta_get_reg(2);
-    uint64_t arg4 = rosetta_get_reg(3);
-    uint64_t arg5 = rosetta_get_reg(4);
-    uint64_t arg6 = rosetta_get_reg(5);
+    if (syscall_lookup(number) == NULL) {
+        st->guest.r[X86_RAX] = (uint64_t)(int64_t)-ENOSYS;
+        return ROS_SYSCALL_UNIMPLEMENTED;
+    }
 
-    /* Execute syscall */
-    int64_t result = rosetta_syscall(number, arg1, arg2, arg3, arg4, arg5, arg6);
+    /* Arguments are read from guest registers by the handler */
+    dispatch_syscall(st, number);
 
-    /* Set result in X0 */
-    rosetta_set_reg(0, (uint64_t)result);
+    /* Set result in RAX */
+    st->guest.r[X86_RAX] = (uint64_t)st->syscall_result;
 
     return ROS_SYSCALL_SUCCESS;
 }
@@ -143,19 +165,11 @@ int rosetta_handle_syscall(int number, void *state)
 int rosetta_register_syscall(int number, const char *name,
                               ros_syscall_handler_t handler)
 {
-    if (number < 0 || number >= MAX_SYSCALL_NUMBER) {
-        return -1;
-    }
-
     if (!g_syscall_initialized) {
         rosetta_syscall_init();
     }
 
-    g_syscall_table[number].number = number;
-    g_syscall_table[number].name = name;
-    g_syscall_table[number].handler = handler;
-
-    return 0;
+    return syscall_register_raw(number, name, handler);
 }
 
 /**
@@ -163,12 +177,7 @@ int rosetta_register_syscall(int number, const char *name,
  */
 int rosetta_unregister_syscall(int number)
 {
-    if (number < 0 || number >= MAX_SYSCALL_NUMBER) {
-        return -1;
-    }
-
-    memset(&g_syscall_table[number], 0, sizeof(ros_syscall_desc_t));
-    return 0;
+    return syscall_register_raw(number, NULL, NULL);
 }
 
 /* ============================================================================
@@ -180,12 +189,10 @@ int rosetta_unregister_syscall(int number)
  */
 const char *rosetta_syscall_get_name(int number)
 {
-    if (number < 0 || number >= MAX_SYSCALL_NUMBER) {
-        return "unknown";
-    }
+    const syscall_desc_t *desc = syscall_lookup(number);
 
-    if (g_syscall_table[number].name != NULL) {
-        return g_syscall_table[number].name;
+    if (desc != NULL && desc->name != NULL) {
+        return desc->name;
     }
 
     return "unknown";
@@ -196,12 +203,7 @@ const char *rosetta_syscall_get_name(int number)
  */
 bool rosetta_syscall_is_implemented(int number)
 {
-    if (number < 0 || number >= MAX_SYSCALL_NUMBER) {
-        return false;
-    }
-
-    return (g_syscall_table[number].handler != NULL) ||
-           (translate_syscall(number, 0, 0, 0, 0, 0, 0) != ROS_SYSCALL_UNIMPLEMENTED);
+    return syscall_lookup(number) != NULL;
 }
 
 /**
@@ -212,8 +214,8 @@ int rosetta_syscall_count(void)
     int count = 0;
     int i;
 
-    for (i = 0; i < MAX_SYSCALL_NUMBER; i++) {
-        if (g_syscall_table[i].handler != NULL) {
+    for (i = 0; i < X86_64_SYSCALL_MAX; i++) {
+        if (syscall_lookup(i) != NULL) {
             count++;
         }
     }
@@ -230,7 +232,7 @@ int rosetta_syscall_count(void)
  */
 void rosetta_sys_exit(int status)
 {
-    rosetta_syscall(93, (uint64_t)status, 0, 0, 0, 0, 0);  /* ARM64 SYS_EXIT = 93 */
+    rosetta_syscall(X86_64_SYS_EXIT, (uint64_t)status, 0, 0, 0, 0, 0);
     _exit(status);  /* Should not return */
 }
 
@@ -239,7 +241,7 @@ void rosetta_sys_exit(int status)
  */
 ssize_t rosetta_sys_read(int fd, void *buf, size_t count)
 {
-    int64_t result = rosetta_syscall(63, (uint64_t)fd, (uint64_t)buf,
+    int64_t result = rosetta_syscall(X86_64_SYS_READ, (uint64_t)fd, (uint64_t)buf,
                                       (uint64_t)count, 0, 0, 0);
     return (ssize_t)result;
 }
@@ -249,7 +251,7 @@ ssize_t rosetta_sys_read(int fd, void *buf, size_t count)
  */
 ssize_t rosetta_sys_write(int fd, const void *buf, size_t count)
 {
-    int64_t result = rosetta_syscall(64, (uint64_t)fd, (uint64_t)buf,
+    int64_t result = rosetta_syscall(X86_64_SYS_WRITE, (uint64_t)fd, (uint64_t)buf,
                                       (uint64_t)count, 0, 0, 0);
     return (ssize_t)result;
 }
@@ -259,7 +261,7 @@ ssize_t rosetta_sys_write(int fd, const void *buf, size_t count)
  */
 int rosetta_sys_open(const char *pathname, int flags, uint32_t mode)
 {
-    int64_t result = rosetta_syscall(56, (uint64_t)pathname, (uint64_t)flags,
+    int64_t result = rosetta_syscall(X86_64_SYS_OPEN, (uint64_t)pathname, (uint64_t)flags,
                                       (uint64_t)mode, 0, 0, 0);
     return (int)result;
 }
@@ -269,7 +271,7 @@ int rosetta_sys_open(const char *pathname, int flags, uint32_t mode)
  */
 int rosetta_sys_close(int fd)
 {
-    int64_t result = rosetta_syscall(57, (uint64_t)fd, 0, 0, 0, 0, 0);
+    int64_t result = rosetta_syscall(X86_64_SYS_CLOSE, (uint64_t)fd, 0, 0, 0, 0, 0);
     return (int)result;
 }
 
@@ -279,7 +281,7 @@ int rosetta_sys_close(int fd)
 void *rosetta_sys_mmap(void *addr, size_t length, int prot,
                        int flags, int fd, int64_t offset)
 {
-    int64_t result = rosetta_syscall(222, (uint64_t)addr, (uint64_t)length,
+    int64_t result = rosetta_syscall(X86_64_SYS_MMAP, (uint64_t)addr, (uint64_t)length,
                                       (uint64_t)prot, (uint64_t)flags,
                                       (uint64_t)fd, (uint64_t)offset);
 
@@ -295,7 +297,7 @@ void *rosetta_sys_mmap(void *addr, size_t length, int prot,
  */
 int rosetta_sys_munmap(void *addr, size_t length)
 {
-    int64_t result = rosetta_syscall(215, (uint64_t)addr, (uint64_t)length,
+    int64_t result = rosetta_syscall(X86_64_SYS_MUNMAP, (uint64_t)addr, (uint64_t)length,
                                       0, 0, 0, 0);
     return (int)result;
 }
@@ -305,6 +307,6 @@ int rosetta_sys_munmap(void *addr, size_t length)
  */
 void *rosetta_sys_brk(void *addr)
 {
-    int64_t result = rosetta_syscall(214, (uint64_t)addr, 0, 0, 0, 0, 0);
+    int64_t result = rosetta_syscall(X86_64_SYS_BRK, (uint64_t)addr, 0, 0, 0, 0, 0);
     return (void *)(uintptr_t)result;
 }
@@ -13,6 +13,7 @@
 #include <stdbool.h>
 #include <stddef.h>
 #include <sys/types.h>
+#include "rosetta_syscalls.h"
 
 /* ============================================================================
  * Syscall Configuration
@@ -30,10 +31,8 @@
  * Syscall Handler Types
  * ============================================================================ */
 
-/* Syscall handler function type */
-typedef int64_t (*ros_syscall_handler_t)(uint64_t arg1, uint64_t arg2,
-                                          uint64_t arg3, uint64_t arg4,
-                                          uint64_t arg5, uint64_t arg6);
+/* Syscall handler function type (shared with the dispatch table) */
+typedef syscall_raw_handler_t ros_syscall_handler_t;
 
 /* Syscall descriptor */
 typedef struct {
@@ -63,7 +62,7 @@ void rosetta_syscall_cleanup(void);
 
 /**
  * rosetta_syscall - Execute a syscall
- * @number: Syscall number (ARM64 convention)
+ * @number: Syscall number (x86_64 guest convention)
  * @arg1-arg6: Syscall arguments
  * Returns: Syscall result
  */
@@ -93,7 +92,7 @@ int rosetta_handle_syscall(int number, void *state);
 
 /**
  * rosetta_register_syscall - Register a syscall handler
- * @number: Syscall number
+ * @number: Syscall number (x86_64 guest convention)
  * @name: Syscall name
  * @handler: Handler function
  * Returns: 0 on success, -1 on error
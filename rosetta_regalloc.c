@@ -0,0 +1,187 @@
+/* ============================================================================
+ * Rosetta Translator - Guest Register Allocator
+ * ============================================================================
+ *
+ * Linear scan over the guest register intervals of one IR block, after
+ * Poletto and Sarkar: intervals are visited in start order, registers of
+ * expired intervals are returned to the pool, and on pressure the interval
+ * with the furthest end is spilled.
+ * ============================================================================ */
+
+#include "rosetta_regalloc.h"
+#include <stddef.h>
+#include <string.h>
+
+/* ============================================================================
+ * Intervals
+ * ============================================================================ */
+
+/* Guest register number of a GET_REG/SET_REG in class cls, or -1 */
+static int ra_guest_of(const ir_insn_t *insn, ra_class_t cls)
+{
+    if (insn->op != IR_GET_REG && insn->op != IR_SET_REG) {
+        return -1;
+    }
+    if (cls == RA_CLASS_VEC) {
+        return insn->size == 16 && insn->reg >= IR_ARM64_V0 &&
+               insn->reg < IR_ARM64_V0 + RA_MAX_GUEST ? insn->reg - IR_ARM64_V0 : -1;
+    }
+    return insn->size != 16 && insn->reg < RA_MAX_GUEST ? insn->reg : -1;
+}
+
+static void ra_build_intervals(const ir_block_t *blk, ra_class_t cls, ra_alloc_t *ra)
+{
+    ir_ref_t last_use[IR_MAX_INSNS];
+    uint8_t index_of[RA_MAX_GUEST];
+    uint16_t i;
+
+    memset(index_of, 0xFF, sizeof(index_of));
+    ra->count = 0;
+    ir_compute_last_use(blk, last_use);
+
+    for (i = 0; i < blk->count; i++) {
+        const ir_insn_t *insn = &blk->insns[i];
+        int guest = ra_guest_of(insn, cls);
+        ra_interval_t *iv;
+
+        if (guest < 0) {
+            continue;
+        }
+        if (index_of[guest] == 0xFF) {
+            index_of[guest] = ra->count;
+            iv = &ra->intervals[ra->count++];
+            iv->start = i;
+            iv->end = i;
+            iv->guest = (uint8_t)guest;
+            iv->host = RA_SPILLED;
+            iv->read_first = (insn->op == IR_GET_REG);
+            iv->written = 0;
+        }
+        iv = &ra->intervals[index_of[guest]];
+        if (i > iv->end) {
+            iv->end = i;
+        }
+        iv->written |= (insn->op == IR_SET_REG);
+
+        /* A value read from the host register pins it until its last use */
+        if (insn->op == IR_GET_REG && last_use[i] != IR_NONE && last_use[i] > iv->end) {
+            iv->end = last_use[i];
+        }
+    }
+
+    /* Written registers stay in their host register until the exit stores them */
+    for (i = 0; i < ra->count; i++) {
+        if (ra->intervals[i].written && blk->count > 0) {
+            ra->intervals[i].end = (uint16_t)(blk->count - 1);
+        }
+    }
+}
+
+/* ============================================================================
+ * Linear Scan
+ * ============================================================================ */
+
+int ra_linear_scan(const ir_block_t *blk, const uint8_t *pool, int pool_size,
+                   ra_alloc_t *out)
+{
+    return ra_linear_scan_class(blk, RA_CLASS_GPR, pool, pool_size, out);
+}
+
+int ra_linear_scan_class(const ir_block_t *blk, ra_class_t cls, const uint8_t *pool,
+                         int pool_size, ra_alloc_t *out)
+{
+    uint8_t active[RA_MAX_POOL];    /* Interval indices, sorted by end */
+    uint8_t pool_slot[RA_MAX_GUEST];
+    uint32_t busy = 0;
+    int nactive = 0;
+    int i, j;
+
+    if (blk == NULL || out == NULL || (unsigned)cls >= RA_CLASS_COUNT ||
+        pool_size < 0 || pool_size > RA_MAX_POOL ||
+        (pool_size > 0 && pool == NULL)) {
+        return -1;
+    }
+
+    memset(out, 0, sizeof(*out));
+    ra_build_intervals(blk, cls, out);
+
+    /* Intervals are created in start order already */
+    for (i = 0; i < out->count; i++) {
+        ra_interval_t *cur = &out->intervals[i];
+        int slot = -1;
+
+        /* Expire intervals that ended before this one starts */
+        for (j = 0; j < nactive; ) {
+            ra_interval_t *old = &out->intervals[active[j]];
+            if (old->end < cur->start) {
+                busy &= ~(1u << pool_slot[active[j]]);
+                memmove(&active[j], &active[j + 1], (size_t)(nactive - j - 1));
+                nactive--;
+            } else {
+                j++;
+            }
+        }
+
+        for (j = 0; j < pool_size; j++) {
+            if (!(busy & (1u << j))) {
+                slot = j;
+                break;
+            }
+        }
+
+        if (slot < 0) {
+            /* Spill whichever of the active set and cur lives longest */
+            ra_interval_t *last = nactive ? &out->intervals[active[nactive - 1]] : NULL;
+
+            out->spills++;
+            if (last == NULL || last->end <= cur->end) {
+                cur->host = RA_SPILLED;
+                continue;
+            }
+            slot = pool_slot[active[nactive - 1]];
+            last->host = RA_SPILLED;
+            nactive--;
+        }
+
+        busy |= 1u << slot;
+        out->pool_used |= 1u << slot;
+        pool_slot[i] = (uint8_t)slot;
+        cur->host = pool[slot];
+
+        /* Insert keeping active sorted by end */
+        for (j = nactive; j > 0 && out->intervals[active[j - 1]].end > cur->end; j--) {
+            active[j] = active[j - 1];
+        }
+        active[j] = (uint8_t)i;
+        nactive++;
+    }
+
+    memset(out->host_of, RA_SPILLED, sizeof(out->host_of));
+    for (i = 0; i < out->count; i++) {
+        out->host_of[out->intervals[i].guest] = out->intervals[i].host;
+    }
+    return 0;
+}
+
+int32_t ra_spill_slot(ra_class_t cls, uint8_t guest)
+{
+    if (cls == RA_CLASS_VEC) {
+        return (int32_t)(offsetof(ThreadState, host.v) + (size_t)guest * sizeof(vec128_t));
+    }
+    if (guest == IR_ARM64_SP) {
+        return (int32_t)offsetof(ThreadState, host.sp);
+    }
+    return (int32_t)(offsetof(ThreadState, host.x) + (size_t)guest * 8);
+}
+
+const ra_interval_t *ra_interval(const ra_alloc_t *ra, uint8_t guest)
+{
+    int i;
+
+    for (i = 0; i < ra->count; i++) {
+        if (ra->intervals[i].guest == guest) {
+            return &ra->intervals[i];
+        }
+    }
+    return NULL;
+}
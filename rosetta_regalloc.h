@@ -0,0 +1,90 @@
+/* ============================================================================
+ * Rosetta Translator - Guest Register Allocator
+ * ============================================================================
+ *
+ * Per-block linear-scan allocation of guest registers onto host registers.
+ * Each guest register touched by a block gets one live interval, from its
+ * first access to its last one (or to the block exit if the block writes
+ * it). Intervals are assigned host registers from a caller-supplied pool;
+ * when the pool runs out the interval ending furthest away is spilled and
+ * lives in its arm64_context_t slot in ThreadState for the whole block.
+ *
+ * Back-ends load a register at the start of its interval, keep it in the
+ * host register and write it back only at block exits and around helper
+ * calls, instead of going through memory on every access.
+ *
+ * GPRs (X0-X30, SP) and vector registers (V0-V31, the 16-byte
+ * GET_REG/SET_REG of IR_ARM64_V0 + n) are allocated separately, each
+ * from its own pool.
+ * ============================================================================ */
+
+#ifndef ROSETTA_REGALLOC_H
+#define ROSETTA_REGALLOC_H
+
+#include "rosetta_ir.h"
+#include <stdint.h>
+
+#define RA_MAX_GUEST        32      /* Guest registers per class */
+#define RA_MAX_POOL         16      /* Host registers per pool */
+#define RA_SPILLED          0xFF    /* Interval lives in its ThreadState slot */
+
+/**
+ * Register classes
+ */
+typedef enum {
+    RA_CLASS_GPR = 0,       /* X0-X30, SP -> arm64_context_t.x[] / .sp */
+    RA_CLASS_VEC,           /* V0-V31 -> arm64_context_t.v[] */
+    RA_CLASS_COUNT
+} ra_class_t;
+
+/**
+ * Live interval of one guest register within a block
+ */
+typedef struct {
+    uint16_t start;             /* First IR instruction accessing it */
+    uint16_t end;               /* Last instruction it must stay live to */
+    uint8_t guest;              /* Guest register number */
+    uint8_t host;               /* Assigned host register or RA_SPILLED */
+    uint8_t read_first;         /* First access reads: load on entry */
+    uint8_t written;            /* Block writes it: store at exits */
+} ra_interval_t;
+
+/**
+ * Allocation for one block
+ */
+typedef struct {
+    ra_interval_t intervals[RA_MAX_GUEST];
+    uint8_t count;
+    uint8_t host_of[RA_MAX_GUEST];  /* Guest register -> host or RA_SPILLED */
+    uint8_t spills;                 /* Intervals left in memory */
+    uint32_t pool_used;             /* Bitmask of pool entries handed out */
+} ra_alloc_t;
+
+/**
+ * Allocate the guest GPRs accessed by blk's GET_REG/SET_REG
+ * @param pool Host registers available for guest values
+ * @param pool_size Entries in pool (at most RA_MAX_POOL)
+ * @return 0 on success, -1 on bad arguments
+ */
+int ra_linear_scan(const ir_block_t *blk, const uint8_t *pool, int pool_size,
+                   ra_alloc_t *out);
+
+/**
+ * Allocate the guest registers of one class; intervals and host_of are
+ * indexed by the register number within the class (Vn is n)
+ * @return 0 on success, -1 on bad arguments
+ */
+int ra_linear_scan_class(const ir_block_t *blk, ra_class_t cls, const uint8_t *pool,
+                         int pool_size, ra_alloc_t *out);
+
+/**
+ * Offset of a guest register's spill slot in ThreadState
+ */
+int32_t ra_spill_slot(ra_class_t cls, uint8_t guest);
+
+/**
+ * Interval for a guest register, or NULL if the block never touches it
+ */
+const ra_interval_t *ra_interval(const ra_alloc_t *ra, uint8_t guest);
+
+#endif /* ROSETTA_REGALLOC_H */
@@ -11,6 +11,15 @@
 #include "rosetta_refactored_exception.h"
 #include "rosetta_refactored_signal.h"
 #include "rosetta_execute.h"
+#include "rosetta_perfmap.h"
+#include "rosetta_block_profile.h"
+#include "rosetta_sampler.h"
+#include "rosetta_log.h"
+#include "rosetta_string_simd.h"
+#include "rosetta_vdso.h"
+#include "rosetta_x87.h"
+#include "rosetta_mxcsr.h"
+#include "rosetta_trans_string.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -61,6 +70,9 @@ rosetta_runner_config_t rosetta_runner_default_config(void)
     config.debug = 0;             /* Default: no debug output */
     config.trace_syscalls = 0;    /* Default: no syscall tracing */
     config.dump_blocks = 0;        /* Default: no block dumping */
+    config.perf_map = 0;           /* Default: no perf map */
+    config.profile = 0;            /* Default: no block profile */
+    config.sampler = 0;            /* Default: no sampling */
     config.max_instructions = 0;   /* Default: unlimited execution */
     config.translator_path = NULL; /* Use built-in translator */
     config.interpreter_path = NULL; /* Auto-detect if needed */
@@ -68,6 +80,62 @@ rosetta_runner_config_t rosetta_runner_default_config(void)
     return config;
 }
 
+/* ============================================================================
+ * Exit Reports
+ * ============================================================================ */
+
+/* Runner whose reports are still to be written */
+static rosetta_runner_t *g_report_runner = NULL;
+
+/**
+ * Stop the sampler and write its folded stacks to ROS_SAMPLER_PATH
+ */
+static void runner_write_samples(rosetta_runner_t *runner)
+{
+    char path[64];
+    FILE *out;
+    int lines;
+
+    rosetta_sampler_stop();
+
+    snprintf(path, sizeof(path), ROS_SAMPLER_PATH, (int)getpid());
+    out = fopen(path, "w");
+    if (!out) {
+        fprintf(stderr, "Failed to write samples to %s: %s\n", path, strerror(errno));
+        return;
+    }
+    lines = rosetta_sampler_write_folded(out, runner->binary);
+    fclose(out);
+    fprintf(stderr, "[ROSETTA] %d sampled stacks written to %s\n", lines, path);
+}
+
+/**
+ * Write the profiles the config asked for; runs once, when the guest
+ * exits or the runner is destroyed, whichever comes first
+ */
+static void runner_write_reports(void)
+{
+    rosetta_runner_t *runner = g_report_runner;
+
+    if (!runner) {
+        return;
+    }
+    g_report_runner = NULL;
+
+    if (runner->config.profile) {
+        rosetta_profile_dump(stderr, runner->binary, (size_t)runner->config.profile);
+    }
+    if (runner->config.sampler) {
+        runner_write_samples(runner);
+    }
+}
+
+static void runner_exit_hook(int status)
+{
+    (void)status;
+    runner_write_reports();
+}
+
 /* ============================================================================
  * Runner Creation and Destruction
  * ============================================================================ */
@@ -90,6 +158,19 @@ rosetta_runner_t *rosetta_runner_create(const rosetta_runner_config_t *config)
         runner->config = rosetta_runner_default_config();
     }
 
+    /* Translation/execution log level; ROSETTA_LOG_LEVEL overrides */
+    if (runner->config.debug) {
+        rosetta_log_set_level(ROS_LOG_LEVEL_DEBUG);
+    } else if (runner->config.verbose) {
+        rosetta_log_set_level(ROS_LOG_LEVEL_INFO);
+    }
+    rosetta_log_init();
+
+    /* Pick string kernels now rather than on the first guest string op */
+    rosetta_string_simd_init();
+    ROS_LOG_DEBUG("String kernels: %s\n",
+                  rosetta_string_simd_name(rosetta_string_simd_active()));
+
     /* Initialize state */
     runner->binary = NULL;
     runner->translation_cache = NULL;
@@ -116,6 +197,13 @@ void rosetta_runner_destroy(rosetta_runner_t *runner)
         return;
     }
 
+    /* Reports and perf name blocks from the binary's symbols, so finish them first */
+    if (g_report_runner == runner) {
+        runner_write_reports();
+        syscall_set_exit_hook(NULL);
+    }
+    rosetta_perfmap_close();
+
     /* Unload binary if loaded */
     if (runner->binary) {
         rosetta_elf_unload(runner->binary);
@@ -130,6 +218,8 @@ void rosetta_runner_destroy(rosetta_runner_t *runner)
 
     /* Clean up memory manager */
     if (runner->memmgr) {
+        syscall_set_guest_memory(NULL);
+        translate_string_set_guest_memory(NULL);
         rosetta_memmgr_destroy(runner->memmgr);
         runner->memmgr = NULL;
     }
@@ -200,6 +290,33 @@ int rosetta_runner_load_binary(rosetta_runner_t *runner, const char *filename)
         rosetta_elf_print_info(runner->binary);
     }
 
+    /* Describe translated code to host perf */
+    if (runner->config.perf_map) {
+        result = rosetta_perfmap_open(runner->binary, runner->config.perf_map);
+        if (result != 0) {
+            fprintf(stderr, "Failed to open perf map: %s\n", strerror(-result));
+        }
+    }
+
+    /* Count block executions; the hottest are printed when the guest exits */
+    if (runner->config.profile) {
+        rosetta_profile_set_enabled(1);
+    }
+
+    /* Sample the host pc; folded stacks are written when the guest exits */
+    if (runner->config.sampler) {
+        result = rosetta_sampler_start(runner->config.sampler);
+        if (result != 0) {
+            fprintf(stderr, "Failed to start sampler: %s\n", strerror(-result));
+            runner->config.sampler = 0;
+        }
+    }
+
+    if (runner->config.profile || runner->config.sampler) {
+        g_report_runner = runner;
+        syscall_set_exit_hook(runner_exit_hook);
+    }
+
     return 0;
 }
 
@@ -237,6 +354,10 @@ int rosetta_runner_prepare(rosetta_runner_t *runner)
         return -1;
     }
 
+    /* Guest syscall and string operands are guest addresses in this address space */
+    syscall_set_guest_memory(runner->memmgr);
+    translate_string_set_guest_memory(runner->memmgr);
+
     /* Initialize translation subsystem */
     if (runner->config.verbose) {
         printf("[ROSETTA] Initializing translation subsystem\n");
@@ -372,6 +493,8 @@ int rosetta_runner_execute(rosetta_runner_t *runner, int argc, char **argv, char
 
     memset(&state->guest, 0, sizeof(state->guest));
     memset(&state->host, 0, sizeof(state->host));
+    rosetta_x87_reset(&state->guest);
+    rosetta_mxcsr_reset(&state->guest);
 
     if (runner->config.verbose) {
         printf("[ROSETTA]   Registers cleared\n");
@@ -417,6 +540,16 @@ int rosetta_runner_execute(rosetta_runner_t *runner, int argc, char **argv, char
         printf("[ROSETTA]   Stack allocated: top=0x%lx\n", stack_top);
     }
 
+    /* Map the synthetic vDSO (advertised as AT_SYSINFO_EHDR) */
+    uint64_t vdso_base = rosetta_vdso_map(runner->memmgr);
+    if (runner->config.verbose) {
+        if (vdso_base != 0) {
+            printf("[ROSETTA]   vDSO mapped at 0x%lx\n", vdso_base);
+        } else {
+            printf("[ROSETTA]   vDSO not mapped, time calls will use SYSCALL\n");
+        }
+    }
+
     /* NOTE: Full argc/argv setup requires writing to guest memory
      * For now, we just set up the stack pointer
      * A full implementation would:
@@ -542,6 +675,15 @@ int rosetta_run(const char *filename, char **argv)
     if (getenv("ROSETTA_DEBUG")) {
         config.debug = atoi(getenv("ROSETTA_DEBUG"));
     }
+    if (getenv(ROS_PERFMAP_ENV)) {
+        config.perf_map = atoi(getenv(ROS_PERFMAP_ENV));
+    }
+    if (getenv(ROS_PROFILE_ENV)) {
+        config.profile = atoi(getenv(ROS_PROFILE_ENV));
+    }
+    if (getenv(ROS_SAMPLER_ENV)) {
+        config.sampler = atoi(getenv(ROS_SAMPLER_ENV));
+    }
 
     rosetta_runner_t *runner = rosetta_runner_create(&config);
     if (!runner) {
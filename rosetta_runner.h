@@ -30,6 +30,9 @@ typedef struct {
     int debug;                /* Debug output flag */
     int trace_syscalls;        /* Trace syscall execution */
     int dump_blocks;          /* Dump translated blocks */
+    int perf_map;             /* ROS_PERFMAP_* outputs for host perf */
+    int profile;              /* Hot blocks printed at exit (0 = no profiling) */
+    int sampler;              /* SIGPROF samples per second (0 = no sampling) */
     uint64_t max_instructions; /* Max instructions to execute (0 = unlimited) */
     char *translator_path;    /* Path to translator binary */
     char *interpreter_path;   /* Path to dynamic linker (if needed) */
@@ -0,0 +1,346 @@
+/* ============================================================================
+ * Rosetta Translator - Sampling Profiler
+ * ============================================================================
+ *
+ * The host-range index is an array sorted by host address. The code cache
+ * hands out addresses in increasing order, so a new block is normally
+ * appended in place and published by bumping the count. An out-of-order
+ * block or a full array gets a fresh sorted copy published through the map
+ * pointer; the old copy is retired rather than freed, since a handler on
+ * another thread may still be searching it.
+ *
+ * The handler only does atomic loads, a binary search and atomic updates
+ * of the sample table, all of which are async-signal-safe.
+ * ============================================================================ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE                     /* REG_RIP */
+#endif
+
+#include "rosetta_sampler.h"
+#include "rosetta_refactored_signal.h"
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <ucontext.h>
+
+/* ============================================================================
+ * Sampler State
+ * ============================================================================ */
+
+#define SAMPLER_MAP_MIN     1024
+
+typedef struct sampler_map {
+    uint32_t count;                     /* Published ranges */
+    uint32_t capacity;
+    struct sampler_map *retired;        /* Older maps, freed once idle */
+    rosetta_sampler_range_t ranges[];
+} sampler_map_t;
+
+typedef struct {
+    uint64_t key;                       /* guest_pc + 1, 0 if free */
+    uint64_t count;
+} sampler_slot_t;
+
+static pthread_mutex_t g_map_lock = PTHREAD_MUTEX_INITIALIZER;
+static sampler_map_t *g_map;
+static sampler_slot_t g_slots[ROS_SAMPLER_SLOTS];
+static rosetta_sampler_stats_t g_totals;
+static int g_running;
+
+static sampler_map_t *map_alloc(uint32_t capacity)
+{
+    sampler_map_t *m = malloc(sizeof(*m) + capacity * sizeof(rosetta_sampler_range_t));
+
+    if (m) {
+        m->count = 0;
+        m->capacity = capacity;
+        m->retired = NULL;
+    }
+    return m;
+}
+
+/* Free retired maps; only safe while no handler can run */
+static void map_free_retired(sampler_map_t *m)
+{
+    sampler_map_t *r = m ? m->retired : NULL;
+
+    while (r) {
+        sampler_map_t *next = r->retired;
+        free(r);
+        r = next;
+    }
+    if (m) {
+        m->retired = NULL;
+    }
+}
+
+/* ============================================================================
+ * Code Map
+ * ============================================================================ */
+
+int rosetta_sampler_map_block(uint64_t host_start, uint32_t host_size, uint64_t guest_pc,
+                              const struct translation_block *block)
+{
+    rosetta_sampler_range_t r = { host_start, host_start + host_size, guest_pc, block };
+    sampler_map_t *m, *copy;
+    uint32_t n, at;
+
+    pthread_mutex_lock(&g_map_lock);
+    m = g_map;
+    n = m ? m->count : 0;
+
+    /* Common case: the block lies above everything mapped so far */
+    if (m && n < m->capacity && (n == 0 || m->ranges[n - 1].host_end <= host_start)) {
+        m->ranges[n] = r;
+        __atomic_store_n(&m->count, n + 1, __ATOMIC_RELEASE);
+        pthread_mutex_unlock(&g_map_lock);
+        return 0;
+    }
+
+    copy = map_alloc(!m ? SAMPLER_MAP_MIN : n < m->capacity ? m->capacity : m->capacity * 2);
+    if (!copy) {
+        pthread_mutex_unlock(&g_map_lock);
+        return -ENOMEM;
+    }
+
+    /* Insert sorted; a range starting at the same address replaces the old one */
+    for (at = 0; at < n && m->ranges[at].host_start < host_start; at++) {
+    }
+    if (n) {
+        memcpy(copy->ranges, m->ranges, at * sizeof(r));
+    }
+    copy->ranges[at] = r;
+    if (at < n && m->ranges[at].host_start == host_start) {
+        memcpy(&copy->ranges[at + 1], &m->ranges[at + 1], (n - at - 1) * sizeof(r));
+        copy->count = n;
+    } else {
+        if (n) {
+            memcpy(&copy->ranges[at + 1], &m->ranges[at], (n - at) * sizeof(r));
+        }
+        copy->count = n + 1;
+    }
+
+    copy->retired = m;
+    __atomic_store_n(&g_map, copy, __ATOMIC_RELEASE);
+    if (!__atomic_load_n(&g_running, __ATOMIC_ACQUIRE)) {
+        map_free_retired(copy);
+    }
+    pthread_mutex_unlock(&g_map_lock);
+    return 0;
+}
+
+void rosetta_sampler_unmap_all(void)
+{
+    pthread_mutex_lock(&g_map_lock);
+    if (g_map) {
+        sampler_map_t *empty = map_alloc(g_map->capacity);
+        if (empty) {
+            empty->retired = g_map;
+            __atomic_store_n(&g_map, empty, __ATOMIC_RELEASE);
+        } else {
+            __atomic_store_n(&g_map->count, 0, __ATOMIC_RELEASE);
+        }
+        if (!__atomic_load_n(&g_running, __ATOMIC_ACQUIRE)) {
+            map_free_retired(g_map);
+        }
+    }
+    pthread_mutex_unlock(&g_map_lock);
+}
+
+int rosetta_sampler_lookup(uint64_t host_pc, rosetta_sampler_range_t *out)
+{
+    sampler_map_t *m = __atomic_load_n(&g_map, __ATOMIC_ACQUIRE);
+    uint32_t lo = 0, hi;
+
+    if (!m) {
+        return 0;
+    }
+    hi = __atomic_load_n(&m->count, __ATOMIC_ACQUIRE);
+
+    /* Last range starting at or below host_pc */
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (m->ranges[mid].host_start <= host_pc) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo == 0 || host_pc >= m->ranges[lo - 1].host_end) {
+        return 0;
+    }
+    if (out) {
+        *out = m->ranges[lo - 1];
+    }
+    return 1;
+}
+
+/* ============================================================================
+ * Sampling
+ * ============================================================================ */
+
+void rosetta_sampler_record(uint64_t host_pc)
+{
+    rosetta_sampler_range_t r;
+    uint64_t key;
+    uint32_t i, probe;
+
+    __atomic_fetch_add(&g_totals.samples, 1, __ATOMIC_RELAXED);
+    if (!rosetta_sampler_lookup(host_pc, &r)) {
+        __atomic_fetch_add(&g_totals.outside, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    key = r.guest_pc + 1;
+    i = (uint32_t)((key * 0x9E3779B97F4A7C15ULL) >> 52) & (ROS_SAMPLER_SLOTS - 1);
+    for (probe = 0; probe < ROS_SAMPLER_SLOTS; probe++, i = (i + 1) & (ROS_SAMPLER_SLOTS - 1)) {
+        uint64_t cur = __atomic_load_n(&g_slots[i].key, __ATOMIC_RELAXED);
+
+        if (cur == 0 &&
+            !__atomic_compare_exchange_n(&g_slots[i].key, &cur, key, false,
+                                         __ATOMIC_RELAXED, __ATOMIC_RELAXED) &&
+            cur != key) {
+            continue;                   /* Lost the slot to another block */
+        }
+        if (cur == 0 || cur == key) {
+            __atomic_fetch_add(&g_slots[i].count, 1, __ATOMIC_RELAXED);
+            __atomic_fetch_add(&g_totals.in_cache, 1, __ATOMIC_RELAXED);
+            return;
+        }
+    }
+    __atomic_fetch_add(&g_totals.dropped, 1, __ATOMIC_RELAXED);
+}
+
+/* Interrupted host pc from a signal context */
+static uint64_t sampler_context_pc(void *context)
+{
+    ucontext_t *uc = (ucontext_t *)context;
+
+#if defined(__APPLE__) && defined(__x86_64__)
+    return uc->uc_mcontext->__ss.__rip;
+#elif defined(__APPLE__) && defined(__aarch64__)
+    return uc->uc_mcontext->__ss.__pc;
+#elif defined(__x86_64__)
+    return (uint64_t)uc->uc_mcontext.gregs[REG_RIP];
+#elif defined(__aarch64__)
+    return uc->uc_mcontext.pc;
+#else
+    (void)uc;
+    return 0;
+#endif
+}
+
+static void sampler_handler(int sig, siginfo_t *info, void *context)
+{
+    int saved_errno = errno;
+
+    (void)sig;
+    (void)info;
+    rosetta_sampler_record(sampler_context_pc(context));
+    errno = saved_errno;
+}
+
+int rosetta_sampler_start(int hz)
+{
+    struct itimerval it;
+
+    if (hz <= 0) {
+        hz = ROS_SAMPLER_DEFAULT_HZ;
+    }
+
+    __atomic_store_n(&g_running, 1, __ATOMIC_RELEASE);
+    if (rosetta_install_siginfo_handler(SIGPROF, sampler_handler) != 0) {
+        __atomic_store_n(&g_running, 0, __ATOMIC_RELEASE);
+        return -errno;
+    }
+
+    it.it_interval.tv_sec = 0;
+    it.it_interval.tv_usec = hz >= 1000000 ? 1 : 1000000 / hz;
+    it.it_value = it.it_interval;
+    if (setitimer(ITIMER_PROF, &it, NULL) != 0) {
+        int err = errno;
+        rosetta_install_signal_handler(SIGPROF, SIG_IGN);
+        __atomic_store_n(&g_running, 0, __ATOMIC_RELEASE);
+        return -err;
+    }
+    return 0;
+}
+
+void rosetta_sampler_stop(void)
+{
+    struct itimerval it;
+
+    memset(&it, 0, sizeof(it));
+    setitimer(ITIMER_PROF, &it, NULL);
+
+    /* A tick already in flight must not fall back to the default action */
+    rosetta_install_signal_handler(SIGPROF, SIG_IGN);
+    __atomic_store_n(&g_running, 0, __ATOMIC_RELEASE);
+
+    pthread_mutex_lock(&g_map_lock);
+    map_free_retired(g_map);
+    pthread_mutex_unlock(&g_map_lock);
+}
+
+void rosetta_sampler_reset(void)
+{
+    for (uint32_t i = 0; i < ROS_SAMPLER_SLOTS; i++) {
+        __atomic_store_n(&g_slots[i].count, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&g_slots[i].key, 0, __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&g_totals.samples, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&g_totals.in_cache, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&g_totals.outside, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&g_totals.dropped, 0, __ATOMIC_RELAXED);
+}
+
+void rosetta_sampler_get_stats(rosetta_sampler_stats_t *stats)
+{
+    if (!stats) {
+        return;
+    }
+    stats->samples = __atomic_load_n(&g_totals.samples, __ATOMIC_RELAXED);
+    stats->in_cache = __atomic_load_n(&g_totals.in_cache, __ATOMIC_RELAXED);
+    stats->outside = __atomic_load_n(&g_totals.outside, __ATOMIC_RELAXED);
+    stats->dropped = __atomic_load_n(&g_totals.dropped, __ATOMIC_RELAXED);
+}
+
+/* ============================================================================
+ * Output
+ * ============================================================================ */
+
+int rosetta_sampler_write_folded(FILE *out, rosetta_elf_binary_t *binary)
+{
+    uint64_t outside;
+    int lines = 0;
+
+    if (!out) {
+        return 0;
+    }
+
+    for (uint32_t i = 0; i < ROS_SAMPLER_SLOTS; i++) {
+        uint64_t key = __atomic_load_n(&g_slots[i].key, __ATOMIC_RELAXED);
+        uint64_t count = __atomic_load_n(&g_slots[i].count, __ATOMIC_RELAXED);
+        const char *sym;
+        uint64_t off = 0;
+
+        if (key == 0 || count == 0) {
+            continue;
+        }
+        sym = binary ? rosetta_elf_symbolize(binary, key - 1, &off) : NULL;
+        fprintf(out, "guest;%s;0x%llx %llu\n", sym ? sym : "[unknown]",
+                (unsigned long long)(key - 1), (unsigned long long)count);
+        lines++;
+    }
+
+    outside = __atomic_load_n(&g_totals.outside, __ATOMIC_RELAXED);
+    if (outside) {
+        fprintf(out, "rosetta %llu\n", (unsigned long long)outside);
+        lines++;
+    }
+    return lines;
+}
@@ -0,0 +1,129 @@
+/* ============================================================================
+ * Rosetta Translator - Sampling Profiler
+ * ============================================================================
+ *
+ * A perf-style sampler for translated code. An ITIMER_PROF timer delivers
+ * SIGPROF at a fixed rate of consumed CPU time; the handler reads the
+ * interrupted host pc from the signal context and, if it lies in the code
+ * cache, finds the translated block through a sorted host-range index.
+ * Samples are counted per guest block in a fixed table, so the handler
+ * never allocates or locks.
+ *
+ * The result is written as folded stacks ("frame;frame count" per line),
+ * the input format of flamegraph.pl and speedscope.
+ * Guest frames are symbolized through the ELF loader.
+ *
+ * The runner starts the sampler from config.sampler or ROS_SAMPLER_ENV and
+ * writes ROS_SAMPLER_PATH when the guest exits.
+ * ============================================================================ */
+
+#ifndef ROSETTA_SAMPLER_H
+#define ROSETTA_SAMPLER_H
+
+#include "rosetta_elf_loader.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+struct translation_block;
+
+/* ============================================================================
+ * Sampler Configuration
+ * ============================================================================ */
+
+#define ROS_SAMPLER_DEFAULT_HZ  997     /* Prime, avoids lockstep with periodic work */
+#define ROS_SAMPLER_SLOTS       4096    /* Distinct guest blocks sampled */
+
+/* Environment variable starting the sampler from the runner: rate in Hz */
+#define ROS_SAMPLER_ENV         "ROSETTA_SAMPLE"
+
+/* Folded stacks the runner writes at exit, formatted with the pid */
+#define ROS_SAMPLER_PATH        "/tmp/rosetta-%d.folded"
+
+/**
+ * One translated block in the host-range index
+ */
+typedef struct {
+    uint64_t host_start;
+    uint64_t host_end;                  /* Exclusive */
+    uint64_t guest_pc;
+    const struct translation_block *block;  /* NULL if not tracked */
+} rosetta_sampler_range_t;
+
+/**
+ * Sample totals
+ */
+typedef struct {
+    uint64_t samples;                   /* All SIGPROF ticks seen */
+    uint64_t in_cache;                  /* Attributed to a translated block */
+    uint64_t outside;                   /* Translator, runtime or libc */
+    uint64_t dropped;                   /* Block table full */
+} rosetta_sampler_stats_t;
+
+/* ============================================================================
+ * Code Map
+ * ============================================================================ */
+
+/**
+ * Register a translated block; call once its code is in place
+ * @param host_start Start of the host code
+ * @param host_size Host code bytes
+ * @param guest_pc Guest pc the block translates
+ * @param block TranslationBlock describing it, or NULL
+ * @return 0 on success, -ENOMEM
+ */
+int rosetta_sampler_map_block(uint64_t host_start, uint32_t host_size, uint64_t guest_pc,
+                              const struct translation_block *block);
+
+/**
+ * Forget all blocks, e.g. when the code cache is reset
+ */
+void rosetta_sampler_unmap_all(void);
+
+/**
+ * Find the block containing a host pc; async-signal-safe
+ * @param host_pc Host address
+ * @param out Set to the block's range if found, may be NULL
+ * @return 1 if host_pc is translated code, 0 otherwise
+ */
+int rosetta_sampler_lookup(uint64_t host_pc, rosetta_sampler_range_t *out);
+
+/* ============================================================================
+ * Sampling
+ * ============================================================================ */
+
+/**
+ * Install the SIGPROF handler and start the profiling timer
+ * @param hz Samples per second of CPU time, 0 for ROS_SAMPLER_DEFAULT_HZ
+ * @return 0 on success, -errno on failure
+ */
+int rosetta_sampler_start(int hz);
+
+/**
+ * Stop the timer and ignore further SIGPROF
+ */
+void rosetta_sampler_stop(void);
+
+/**
+ * Record one sample at host_pc; the signal handler's entry point, exposed
+ * for callers that sample by other means
+ */
+void rosetta_sampler_record(uint64_t host_pc);
+
+/**
+ * Clear collected samples, keeping the code map
+ */
+void rosetta_sampler_reset(void);
+
+void rosetta_sampler_get_stats(rosetta_sampler_stats_t *stats);
+
+/**
+ * Write the profile as folded stacks: "guest;symbol;0xpc count" for
+ * translated code and "rosetta count" for everything else
+ * @param out Output stream
+ * @param binary Guest binary for symbol names, may be NULL
+ * @return Number of lines written
+ */
+int rosetta_sampler_write_folded(FILE *out, rosetta_elf_binary_t *binary);
+
+#endif /* ROSETTA_SAMPLER_H */
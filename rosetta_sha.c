@@ -0,0 +1,376 @@
+/* ============================================================================
+ * Rosetta Translator - Host SHA-1/SHA-256 Step Primitives
+ * ============================================================================
+ *
+ * Scalar code for every host, an SSE2 message schedule, and a SHA-NI
+ * kernel on x86_64 compiled with a target attribute so the rest of the
+ * file builds for the baseline ISA. Mapping the ARM64 steps onto SHA-NI:
+ *
+ *   SHA1C/P/M  reverse abcd and wk, subtract the K SHA1RNDS4 adds itself,
+ *              add E into lane 3, SHA1RNDS4, reverse back
+ *   SHA1SU1    SHA1MSG2 on reversed operands
+ *   SHA256H/H2 pack into ABEF/CDGH, SHA256RNDS2 twice, unpack one half
+ *   SHA256SU0  SHA256MSG1 as is
+ *   SHA256SU1  SHA256MSG2 after adding the W[9..12] window SU1 takes
+ *              from Vn:Vm
+ *
+ * SHA1SU0 has no SHA-NI counterpart in ARM lane order; SHA1H is a rotate.
+ * ============================================================================ */
+
+#include "rosetta_sha.h"
+#include <errno.h>
+#include <pthread.h>
+#include <string.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define SHANI   __attribute__((target("sha,ssse3")))
+#endif
+
+/* SHA-1 round constants for SHA1RNDS4 functions 0-2 (C, P, M) */
+static const uint32_t sha1_k[3] = { 0x5A827999u, 0x6ED9EBA1u, 0x8F1BBCDCu };
+
+static uint32_t g_hw_supported;
+static uint32_t g_hw;
+static pthread_once_t g_sha_once = PTHREAD_ONCE_INIT;
+
+/* ============================================================================
+ * Feature Selection
+ * ============================================================================ */
+
+static void sha_init_once(void)
+{
+#if defined(__x86_64__)
+    g_hw_supported |= ROS_SHA_HW_SSE2;
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sha") && __builtin_cpu_supports("ssse3")) {
+        g_hw_supported |= ROS_SHA_HW_SHANI;
+    }
+#endif
+    __atomic_store_n(&g_hw, g_hw_supported, __ATOMIC_RELEASE);
+}
+
+uint32_t rosetta_sha_hw_supported(void)
+{
+    pthread_once(&g_sha_once, sha_init_once);
+    return g_hw_supported;
+}
+
+uint32_t rosetta_sha_hw(void)
+{
+    pthread_once(&g_sha_once, sha_init_once);
+    return __atomic_load_n(&g_hw, __ATOMIC_ACQUIRE);
+}
+
+int rosetta_sha_set_hw(uint32_t hw)
+{
+    pthread_once(&g_sha_once, sha_init_once);
+    if (hw & ~g_hw_supported) {
+        return -ENOTSUP;
+    }
+    __atomic_store_n(&g_hw, hw, __ATOMIC_RELEASE);
+    return 0;
+}
+
+/* ============================================================================
+ * Scalar Implementation
+ * ============================================================================ */
+
+static uint32_t rol32(uint32_t x, unsigned n)
+{
+    return (x << n) | (x >> (32 - n));
+}
+
+static uint32_t ror32(uint32_t x, unsigned n)
+{
+    return (x >> n) | (x << (32 - n));
+}
+
+/* Rounds on s = a..h with one W+K word each */
+static void sha256_rounds(uint32_t *s, const uint32_t *wk, int n)
+{
+    int i;
+
+    for (i = 0; i < n; i++) {
+        uint32_t ch = (s[4] & s[5]) ^ (~s[4] & s[6]);
+        uint32_t maj = (s[0] & s[1]) ^ (s[0] & s[2]) ^ (s[1] & s[2]);
+        uint32_t t1 = s[7] + (ror32(s[4], 6) ^ ror32(s[4], 11) ^ ror32(s[4], 25)) + ch + wk[i];
+        uint32_t t2 = (ror32(s[0], 2) ^ ror32(s[0], 13) ^ ror32(s[0], 22)) + maj;
+
+        memmove(s + 1, s, 7 * sizeof(*s));
+        s[4] += t1;
+        s[0] = t1 + t2;
+    }
+}
+
+static uint32_t sha256_s0(uint32_t x)
+{
+    return ror32(x, 7) ^ ror32(x, 18) ^ (x >> 3);
+}
+
+static uint32_t sha256_s1(uint32_t x)
+{
+    return ror32(x, 17) ^ ror32(x, 19) ^ (x >> 10);
+}
+
+static void scalar_step(rosetta_sha_op_t op, uint32_t *out, const uint32_t *x,
+                        const uint32_t *y, const uint32_t *w)
+{
+    uint32_t r[4], s[8];
+    int i;
+
+    switch (op) {
+    case ROS_SHA1C:
+    case ROS_SHA1P:
+    case ROS_SHA1M:
+    {
+        uint32_t e = y[0];
+
+        memcpy(r, x, sizeof(r));
+        for (i = 0; i < 4; i++) {
+            uint32_t f = op == ROS_SHA1C ? (r[1] & r[2]) | (~r[1] & r[3]) :
+                         op == ROS_SHA1P ? r[1] ^ r[2] ^ r[3] :
+                         (r[1] & r[2]) | (r[1] & r[3]) | (r[2] & r[3]);
+            uint32_t t = e + rol32(r[0], 5) + f + w[i];
+
+            e = r[3];
+            r[3] = r[2];
+            r[2] = rol32(r[1], 30);
+            r[1] = r[0];
+            r[0] = t;
+        }
+        break;
+    }
+    case ROS_SHA1H:
+        r[0] = rol32(x[0], 30);
+        r[1] = r[2] = r[3] = 0;
+        break;
+    case ROS_SHA1SU0:
+        r[0] = x[2] ^ x[0] ^ w[0];
+        r[1] = x[3] ^ x[1] ^ w[1];
+        r[2] = y[0] ^ x[2] ^ w[2];
+        r[3] = y[1] ^ x[3] ^ w[3];
+        break;
+    case ROS_SHA1SU1:
+    {
+        uint32_t t[4] = { x[0] ^ y[1], x[1] ^ y[2], x[2] ^ y[3], x[3] };
+
+        for (i = 0; i < 4; i++) {
+            r[i] = rol32(t[i], 1);
+        }
+        r[3] ^= rol32(t[0], 2);
+        break;
+    }
+    case ROS_SHA256H:
+    case ROS_SHA256H2:
+    {
+        const uint32_t *abcd = op == ROS_SHA256H ? x : y;
+        const uint32_t *efgh = op == ROS_SHA256H ? y : x;
+
+        memcpy(s, abcd, 4 * sizeof(*s));
+        memcpy(s + 4, efgh, 4 * sizeof(*s));
+        sha256_rounds(s, w, 4);
+        memcpy(r, op == ROS_SHA256H ? s : s + 4, sizeof(r));
+        break;
+    }
+    case ROS_SHA256SU0:
+    {
+        uint32_t t[4] = { x[1], x[2], x[3], y[0] };
+
+        for (i = 0; i < 4; i++) {
+            r[i] = x[i] + sha256_s0(t[i]);
+        }
+        break;
+    }
+    case ROS_SHA256SU1:
+        r[0] = x[0] + y[1] + sha256_s1(w[2]);
+        r[1] = x[1] + y[2] + sha256_s1(w[3]);
+        r[2] = x[2] + y[3] + sha256_s1(r[0]);
+        r[3] = x[3] + w[0] + sha256_s1(r[1]);
+        break;
+    case ROS_SHA256_ABEF:
+        r[0] = y[1]; r[1] = y[0]; r[2] = x[1]; r[3] = x[0];
+        break;
+    case ROS_SHA256_CDGH:
+        r[0] = y[3]; r[1] = y[2]; r[2] = x[3]; r[3] = x[2];
+        break;
+    case ROS_SHA256_RNDS2:
+    case ROS_SHA256_RNDS2_HI:
+        /* x is CDGH, y is ABEF, both with A/C in lane 3 */
+        s[0] = y[3]; s[1] = y[2]; s[2] = x[3]; s[3] = x[2];
+        s[4] = y[1]; s[5] = y[0]; s[6] = x[1]; s[7] = x[0];
+        sha256_rounds(s, op == ROS_SHA256_RNDS2 ? w : w + 2, 2);
+        r[0] = s[5]; r[1] = s[4]; r[2] = s[1]; r[3] = s[0];
+        break;
+    case ROS_SHA256_ABCD:
+        r[0] = x[3]; r[1] = x[2]; r[2] = y[3]; r[3] = y[2];
+        break;
+    default:
+        r[0] = x[1]; r[1] = x[0]; r[2] = y[1]; r[3] = y[0];
+        break;
+    }
+    memcpy(out, r, sizeof(r));
+}
+
+/* ============================================================================
+ * x86_64 Kernels
+ * ============================================================================ */
+
+#if defined(__x86_64__)
+
+static inline __m128i rol32x4(__m128i v, int n)
+{
+    return _mm_or_si128(_mm_slli_epi32(v, n), _mm_srli_epi32(v, 32 - n));
+}
+
+static inline __m128i ror32x4(__m128i v, int n)
+{
+    return _mm_or_si128(_mm_srli_epi32(v, n), _mm_slli_epi32(v, 32 - n));
+}
+
+/* ARM SHA1SU0: [x2, x3, y0, y1] ^ x ^ w */
+static inline __m128i sse2_sha1su0(__m128i x, __m128i y, __m128i w)
+{
+    __m128i t = _mm_castpd_si128(_mm_shuffle_pd(_mm_castsi128_pd(x), _mm_castsi128_pd(y), 1));
+    return _mm_xor_si128(_mm_xor_si128(t, x), w);
+}
+
+/* Pack or unpack SHA-256 state halves: both directions are one interleave
+ * and the same lane shuffle */
+static inline __m128i sha256_repack(__m128i lo_or_hi)
+{
+    return _mm_shuffle_epi32(lo_or_hi, 0x72);
+}
+
+/* Returns 0 for steps this kernel does not cover */
+static int sse2_step(rosetta_sha_op_t op, uint32_t *out, const uint32_t *a,
+                     const uint32_t *b, const uint32_t *c)
+{
+    __m128i x = _mm_loadu_si128((const __m128i *)a);
+    __m128i y = b ? _mm_loadu_si128((const __m128i *)b) : _mm_setzero_si128();
+    __m128i w = c ? _mm_loadu_si128((const __m128i *)c) : _mm_setzero_si128();
+    __m128i r, t, s;
+
+    switch (op) {
+    case ROS_SHA1SU0:
+        r = sse2_sha1su0(x, y, w);
+        break;
+    case ROS_SHA1SU1:
+        /* Lane 3 also takes lane 0 rotated once more */
+        t = _mm_xor_si128(x, _mm_srli_si128(y, 4));
+        r = rol32x4(t, 1);
+        r = _mm_xor_si128(r, rol32x4(_mm_slli_si128(r, 12), 1));
+        break;
+    case ROS_SHA256SU0:
+        t = _mm_or_si128(_mm_srli_si128(x, 4), _mm_slli_si128(y, 12));
+        s = _mm_xor_si128(_mm_xor_si128(ror32x4(t, 7), ror32x4(t, 18)), _mm_srli_epi32(t, 3));
+        r = _mm_add_epi32(x, s);
+        break;
+    case ROS_SHA256SU1:
+        /* Lanes 0-1 from w, then lanes 2-3 from those; s1(0) is 0 */
+        r = _mm_add_epi32(x, _mm_or_si128(_mm_srli_si128(y, 4), _mm_slli_si128(w, 12)));
+        t = _mm_srli_si128(w, 8);
+        s = _mm_xor_si128(_mm_xor_si128(ror32x4(t, 17), ror32x4(t, 19)), _mm_srli_epi32(t, 10));
+        r = _mm_add_epi32(r, s);
+        t = _mm_slli_si128(r, 8);
+        s = _mm_xor_si128(_mm_xor_si128(ror32x4(t, 17), ror32x4(t, 19)), _mm_srli_epi32(t, 10));
+        r = _mm_add_epi32(r, s);
+        break;
+    default:
+        return 0;
+    }
+    _mm_storeu_si128((__m128i *)out, r);
+    return 1;
+}
+
+static SHANI __m128i shani_sha256_rounds4(__m128i abcd, __m128i efgh, __m128i wk, int upper)
+{
+    __m128i abef = sha256_repack(_mm_unpacklo_epi32(efgh, abcd));
+    __m128i cdgh = sha256_repack(_mm_unpackhi_epi32(efgh, abcd));
+
+    cdgh = _mm_sha256rnds2_epu32(cdgh, abef, wk);
+    abef = _mm_sha256rnds2_epu32(abef, cdgh, _mm_shuffle_epi32(wk, 0x0E));
+    return sha256_repack(upper ? _mm_unpackhi_epi32(abef, cdgh) : _mm_unpacklo_epi32(abef, cdgh));
+}
+
+/* Returns 0 for steps this kernel does not cover */
+static SHANI int shani_step(rosetta_sha_op_t op, uint32_t *out, const uint32_t *a,
+                            const uint32_t *b, const uint32_t *c)
+{
+    __m128i x = _mm_loadu_si128((const __m128i *)a);
+    __m128i y = b ? _mm_loadu_si128((const __m128i *)b) : _mm_setzero_si128();
+    __m128i w = c ? _mm_loadu_si128((const __m128i *)c) : _mm_setzero_si128();
+    __m128i r;
+
+    switch (op) {
+    case ROS_SHA1C:
+    case ROS_SHA1P:
+    case ROS_SHA1M:
+        w = _mm_sub_epi32(_mm_shuffle_epi32(w, 0x1B), _mm_set1_epi32((int)sha1_k[op]));
+        w = _mm_add_epi32(w, _mm_slli_si128(_mm_cvtsi32_si128(_mm_cvtsi128_si32(y)), 12));
+        r = _mm_shuffle_epi32(x, 0x1B);
+        switch (op) {
+        case ROS_SHA1C: r = _mm_sha1rnds4_epu32(r, w, 0); break;
+        case ROS_SHA1P: r = _mm_sha1rnds4_epu32(r, w, 1); break;
+        default:        r = _mm_sha1rnds4_epu32(r, w, 2); break;
+        }
+        r = _mm_shuffle_epi32(r, 0x1B);
+        break;
+    case ROS_SHA1SU0:
+        r = sse2_sha1su0(x, y, w);
+        break;
+    case ROS_SHA1SU1:
+        r = _mm_shuffle_epi32(_mm_sha1msg2_epu32(_mm_shuffle_epi32(x, 0x1B),
+                                                 _mm_shuffle_epi32(y, 0x1B)), 0x1B);
+        break;
+    case ROS_SHA256H:
+        r = shani_sha256_rounds4(x, y, w, 1);
+        break;
+    case ROS_SHA256H2:
+        r = shani_sha256_rounds4(y, x, w, 0);
+        break;
+    case ROS_SHA256SU0:
+        r = _mm_sha256msg1_epu32(x, y);
+        break;
+    case ROS_SHA256SU1:
+        r = _mm_sha256msg2_epu32(_mm_add_epi32(x, _mm_alignr_epi8(w, y, 4)), w);
+        break;
+    case ROS_SHA256_ABEF:   r = sha256_repack(_mm_unpacklo_epi32(y, x)); break;
+    case ROS_SHA256_CDGH:   r = sha256_repack(_mm_unpackhi_epi32(y, x)); break;
+    case ROS_SHA256_RNDS2:  r = _mm_sha256rnds2_epu32(x, y, w); break;
+    case ROS_SHA256_RNDS2_HI:
+        r = _mm_sha256rnds2_epu32(x, y, _mm_shuffle_epi32(w, 0x0E));
+        break;
+    case ROS_SHA256_ABCD:   r = sha256_repack(_mm_unpackhi_epi32(x, y)); break;
+    case ROS_SHA256_EFGH:   r = sha256_repack(_mm_unpacklo_epi32(x, y)); break;
+    default:
+        return 0;
+    }
+    _mm_storeu_si128((__m128i *)out, r);
+    return 1;
+}
+
+#endif /* __x86_64__ */
+
+/* ============================================================================
+ * Public Entry Point
+ * ============================================================================ */
+
+void rosetta_sha_step(rosetta_sha_op_t op, uint32_t out[4], const uint32_t a[4],
+                      const uint32_t b[4], const uint32_t c[4])
+{
+    static const uint32_t zero[4];
+    uint32_t hw = rosetta_sha_hw();
+
+#if defined(__x86_64__)
+    if ((hw & ROS_SHA_HW_SHANI) && shani_step(op, out, a, b, c)) {
+        return;
+    }
+    if ((hw & ROS_SHA_HW_SSE2) && sse2_step(op, out, a, b, c)) {
+        return;
+    }
+#else
+    (void)hw;
+#endif
+    scalar_step(op, out, a, b ? b : zero, c ? c : zero);
+}
@@ -0,0 +1,89 @@
+/* ============================================================================
+ * Rosetta Translator - Host SHA-1/SHA-256 Step Primitives Header
+ * ============================================================================
+ *
+ * ARM64 and x86_64 both have SHA instructions, but they cut the work up
+ * differently:
+ *
+ *   SHA256H/SHA256H2 (ARM64)  four rounds; abcd and efgh in two registers,
+ *                             one instruction per half of the result
+ *   SHA256RNDS2 (x86)         two rounds; state packed as ABEF and CDGH,
+ *                             W+K implicitly in XMM0
+ *   SHA1C/P/M (ARM64)         four rounds, E in its own register, K
+ *                             already added to W, a in lane 0
+ *   SHA1RNDS4 (x86)           four rounds, E pre-added to W0, K chosen by
+ *                             an immediate, A in lane 3
+ *
+ * The message schedule steps differ only in lane order. This module runs
+ * single steps of the ARM64 instructions for the interpreter path and for
+ * tests, plus the ABEF/CDGH packing and two-round steps the IR lowers
+ * SHA256H/SHA256H2 into, so the x86 back-end can keep the state packed
+ * across a run of rounds. Each step uses SHA-NI when the host has it; the
+ * message schedule steps fall back to SSE2 and everything else to scalar
+ * code.
+ *
+ * Vectors are four 32-bit lanes, lane 0 lowest, as in vec128_t.u32.
+ * ============================================================================ */
+
+#ifndef ROSETTA_SHA_H
+#define ROSETTA_SHA_H
+
+#include <stdint.h>
+
+/* Single SHA steps; IR_SHA numbers its ir_sha_op_t the same way */
+typedef enum {
+    ROS_SHA1C = 0,          /* SHA1C Qd, Sn, Vm: a = abcd, b = e (lane 0), c = wk */
+    ROS_SHA1P,              /* SHA1P */
+    ROS_SHA1M,              /* SHA1M */
+    ROS_SHA1H,              /* SHA1H Sd, Sn: a = Sn */
+    ROS_SHA1SU0,            /* SHA1SU0 Vd, Vn, Vm: a, b, c */
+    ROS_SHA1SU1,            /* SHA1SU1 Vd, Vn: a, b */
+    ROS_SHA256H,            /* SHA256H Qd, Qn, Vm: a = abcd, b = efgh, c = wk */
+    ROS_SHA256H2,           /* SHA256H2 Qd, Qn, Vm: a = efgh, b = abcd, c = wk */
+    ROS_SHA256SU0,          /* SHA256SU0 Vd, Vn: a, b */
+    ROS_SHA256SU1,          /* SHA256SU1 Vd, Vn, Vm: a, b, c */
+    ROS_SHA256_ABEF,        /* Pack a = abcd, b = efgh as x86 ABEF */
+    ROS_SHA256_CDGH,        /* Pack a = abcd, b = efgh as x86 CDGH */
+    ROS_SHA256_RNDS2,       /* x86 SHA256RNDS2: a = CDGH, b = ABEF, c = wk lanes 0-1 */
+    ROS_SHA256_RNDS2_HI,    /* The same with wk lanes 2-3 */
+    ROS_SHA256_ABCD,        /* Unpack a = ABEF, b = CDGH into abcd */
+    ROS_SHA256_EFGH,        /* Unpack into efgh */
+    ROS_SHA_OP_COUNT
+} rosetta_sha_op_t;
+
+/* Host features rosetta_sha_hw() may report */
+#define ROS_SHA_HW_SSE2         0x1     /* Vector message schedule */
+#define ROS_SHA_HW_SHANI        0x2     /* x86 SHA extensions */
+
+/**
+ * rosetta_sha_hw_supported - Features this CPU has (ROS_SHA_HW_*)
+ */
+uint32_t rosetta_sha_hw_supported(void);
+
+/**
+ * rosetta_sha_hw - Features currently in use (ROS_SHA_HW_*)
+ */
+uint32_t rosetta_sha_hw(void);
+
+/**
+ * rosetta_sha_set_hw - Restrict the features in use
+ * @param hw ROS_SHA_HW_* mask; 0 forces the scalar implementation
+ * @return 0 on success, -ENOTSUP if hw names a feature this CPU lacks
+ *
+ * Without SHA-NI the IR x86_64 back-end declines blocks containing SHA
+ * steps, leaving them to the interpreter.
+ */
+int rosetta_sha_set_hw(uint32_t hw);
+
+/**
+ * rosetta_sha_step - One SHA step
+ * @param op Step to perform
+ * @param out Result, may alias any input
+ * @param a First input
+ * @param b Second input, NULL if op takes one
+ * @param c Third input, NULL if op takes two or fewer
+ */
+void rosetta_sha_step(rosetta_sha_op_t op, uint32_t out[4], const uint32_t a[4],
+                      const uint32_t b[4], const uint32_t c[4]);
+
+#endif /* ROSETTA_SHA_H */
@@ -2,258 +2,383 @@
  * Rosetta Translator - SIMD String Utilities Implementation
  * ============================================================================
  *
- * This module implements SIMD-optimized string and memory operations
- * for high-performance string processing.
+ * Kernel selection, the scalar fallback kernels and the functions built on
+ * top of the kernels. The SSE2/AVX2 kernels live in rosetta_string_simd_x86.c
+ * and the NEON kernels in rosetta_string_simd_neon.c.
  * ============================================================================ */
 
-#include "rosetta_string_simd.h"
-#include "rosetta_refactored_vector.h"
+#include "rosetta_string_simd_impl.h"
+#include <errno.h>
 #include <string.h>
 
+#if defined(__aarch64__) && defined(__linux__)
+#include <sys/auxv.h>
+#ifndef HWCAP_ASIMD
+#define HWCAP_ASIMD             (1 << 1)
+#endif
+#endif
+
 /* ============================================================================
- * SIMD Helper Functions
+ * Scalar Kernels
  * ============================================================================ */
 
-/**
- * simd_has_zero_byte - Check if any byte in vector is zero
- *
- * Uses the classic SWAR (SIMD Within A Register) technique:
- * (x - 0x01010101...) & ~x & 0x80808080... is non-zero iff any byte of x is zero.
- */
-int simd_has_zero_byte(Vector128 v)
-{
-    uint64_t lo = v.lo;
-    uint64_t hi = v.hi;
+#define ONES    0x0101010101010101ULL
+#define HIGHS   0x8080808080808080ULL
 
-    uint64_t lo_mask = ((lo - 0x0101010101010101ULL) & ~lo & 0x8080808080808080ULL);
-    uint64_t hi_mask = ((hi - 0x0101010101010101ULL) & ~hi & 0x8080808080808080ULL);
+/* Non-zero iff some byte of w is zero */
+static inline uint64_t word_has_zero(uint64_t w)
+{
+    return (w - ONES) & ~w & HIGHS;
+}
 
-    return (lo_mask | hi_mask) != 0;
+static inline uint64_t word_load(const uint8_t *p)
+{
+    uint64_t w;
+    memcpy(&w, p, sizeof(w));
+    return w;
 }
 
-/**
- * simd_has_byte - Check if any byte in vector matches value
- */
-int simd_has_byte(Vector128 v, uint8_t c)
+static inline void word_store(uint8_t *p, uint64_t w)
 {
-    /* Broadcast c to all bytes */
-    Vector128 broadcast = simd_broadcast_byte(c);
+    memcpy(p, &w, sizeof(w));
+}
 
-    /* XOR: matching bytes become zero */
-    Vector128 diff = v128_xor(v, broadcast);
+void *rosetta_string_small_memcpy(void *dest, const void *src, size_t n)
+{
+    uint8_t *d = (uint8_t *)dest;
+    const uint8_t *s = (const uint8_t *)src;
 
-    /* Check if any byte is zero (meaning match found) */
-    return simd_has_zero_byte(diff);
+    if (n >= 8) {
+        for (size_t i = 0; i + 8 < n; i += 8) {
+            word_store(d + i, word_load(s + i));
+        }
+        word_store(d + n - 8, word_load(s + n - 8));
+    } else if (n >= 4) {
+        uint32_t a, b;
+        memcpy(&a, s, 4);
+        memcpy(&b, s + n - 4, 4);
+        memcpy(d, &a, 4);
+        memcpy(d + n - 4, &b, 4);
+    } else if (n >= 2) {
+        uint16_t a, b;
+        memcpy(&a, s, 2);
+        memcpy(&b, s + n - 2, 2);
+        memcpy(d, &a, 2);
+        memcpy(d + n - 2, &b, 2);
+    } else if (n == 1) {
+        d[0] = s[0];
+    }
+    return dest;
 }
 
-/**
- * simd_byte_mask - Convert vector comparison to byte mask
- */
-uint16_t simd_byte_mask(Vector128 v)
+void *rosetta_string_small_memset(void *dest, int c, size_t n)
 {
-    /* Extract most significant bit of each byte */
-    uint16_t mask = 0;
+    uint8_t *d = (uint8_t *)dest;
+    uint64_t w = (uint8_t)c * ONES;
 
-    for (int i = 0; i < 16; i++) {
-        uint8_t byte = v128_extract_byte(v, i);
-        if (byte & 0x80) {
-            mask |= (1 << i);
+    if (n >= 8) {
+        for (size_t i = 0; i + 8 < n; i += 8) {
+            word_store(d + i, w);
         }
+        word_store(d + n - 8, w);
+    } else if (n >= 4) {
+        memcpy(d, &w, 4);
+        memcpy(d + n - 4, &w, 4);
+    } else if (n >= 2) {
+        memcpy(d, &w, 2);
+        memcpy(d + n - 2, &w, 2);
+    } else if (n == 1) {
+        d[0] = (uint8_t)c;
     }
+    return dest;
+}
+
+static size_t scalar_strlen(const char *s)
+{
+    const uint8_t *p = (const uint8_t *)s;
 
-    return mask;
+    /* Aligned words never cross into the next page */
+    for (; (uintptr_t)p & 7; p++) {
+        if (*p == 0) {
+            return (size_t)(p - (const uint8_t *)s);
+        }
+    }
+    while (!word_has_zero(word_load(p))) {
+        p += 8;
+    }
+    while (*p) {
+        p++;
+    }
+    return (size_t)(p - (const uint8_t *)s);
 }
 
-/**
- * simd_find_first_nonzero - Find index of first non-zero byte
- */
-int simd_find_first_nonzero(Vector128 v)
+static int scalar_strcmp(const char *s1, const char *s2)
 {
-    uint64_t lo = v.lo;
-    uint64_t hi = v.hi;
+    const uint8_t *p1 = (const uint8_t *)s1;
+    const uint8_t *p2 = (const uint8_t *)s2;
 
-    if (lo != 0) {
-        /* Find first non-zero byte in low 64 bits */
-        for (int i = 0; i < 8; i++) {
-            if ((lo >> (i * 8)) & 0xFF) {
-                return i;
+    /* Word steps only when both sides can be aligned together */
+    if ((((uintptr_t)p1 ^ (uintptr_t)p2) & 7) == 0) {
+        for (; (uintptr_t)p1 & 7; p1++, p2++) {
+            if (*p1 != *p2 || *p1 == 0) {
+                return (int)*p1 - (int)*p2;
+            }
+        }
+        for (;;) {
+            uint64_t w = word_load(p1);
+            if (w != word_load(p2) || word_has_zero(w)) {
+                break;
             }
+            p1 += 8;
+            p2 += 8;
         }
     }
+    while (*p1 == *p2 && *p1 != 0) {
+        p1++;
+        p2++;
+    }
+    return (int)*p1 - (int)*p2;
+}
 
-    if (hi != 0) {
-        /* Find first non-zero byte in high 64 bits */
-        for (int i = 0; i < 8; i++) {
-            if ((hi >> (i * 8)) & 0xFF) {
-                return i + 8;
-            }
+static void *scalar_memchr(const void *ptr, int c, size_t n)
+{
+    const uint8_t *p = (const uint8_t *)ptr;
+    const uint8_t *end = p + n;
+    uint64_t pattern = (uint8_t)c * ONES;
+
+    while (p + 8 <= end) {
+        if (word_has_zero(word_load(p) ^ pattern)) {
+            break;
         }
+        p += 8;
     }
+    for (; p < end; p++) {
+        if (*p == (uint8_t)c) {
+            return (void *)p;
+        }
+    }
+    return NULL;
+}
 
-    return 16;  /* All bytes are zero */
+static int scalar_memcmp(const void *s1, const void *s2, size_t n)
+{
+    const uint8_t *p1 = (const uint8_t *)s1;
+    const uint8_t *p2 = (const uint8_t *)s2;
+    size_t i = 0;
+
+    while (i + 8 <= n && word_load(p1 + i) == word_load(p2 + i)) {
+        i += 8;
+    }
+    for (; i < n; i++) {
+        if (p1[i] != p2[i]) {
+            return (int)p1[i] - (int)p2[i];
+        }
+    }
+    return 0;
 }
 
-/**
- * simd_broadcast_byte - Create vector with all bytes set to same value
- */
-Vector128 simd_broadcast_byte(uint8_t c)
+static void *scalar_memcpy(void *dest, const void *src, size_t n)
 {
-    return v128_dup(c);
+    return rosetta_string_small_memcpy(dest, src, n);
 }
 
+static void *scalar_memset(void *dest, int c, size_t n)
+{
+    return rosetta_string_small_memset(dest, c, n);
+}
+
+const rosetta_string_kernels_t rosetta_string_kernels_scalar = {
+    .strlen_fn = scalar_strlen,
+    .strcmp_fn = scalar_strcmp,
+    .memchr_fn = scalar_memchr,
+    .memcmp_fn = scalar_memcmp,
+    .memcpy_fn = scalar_memcpy,
+    .memset_fn = scalar_memset,
+};
+
 /* ============================================================================
- * String Length
+ * Kernel Selection
  * ============================================================================ */
 
-/**
- * rosetta_strlen_simd - Calculate string length using SIMD
- *
- * Processes 16 bytes at a time to find the null terminator.
- * Much faster than byte-by-byte for long strings.
- */
-size_t rosetta_strlen_simd(const char *s)
-{
-    const uint8_t *p = (const uint8_t *)s;
+static const rosetta_string_kernels_t rosetta_string_kernels_resolve;
 
-    /* Align to 16-byte boundary first */
-    while ((uintptr_t)p & 0x0F) {
-        if (*p == '\0') {
-            return p - (const uint8_t *)s;
-        }
-        p++;
-    }
+static const rosetta_string_kernels_t *g_kernels = &rosetta_string_kernels_resolve;
+static rosetta_string_impl_t g_active = ROS_STRING_SCALAR;
 
-    /* Process 16 bytes at a time */
-    while (1) {
-        Vector128 v = v128_load(p);
+static const char *const g_impl_names[ROS_STRING_IMPL_COUNT] = {
+    "scalar", "sse2", "avx2", "neon"
+};
 
-        if (simd_has_zero_byte(v)) {
-            /* Null byte found in this block - find exact position */
-            for (int i = 0; i < 16; i++) {
-                if (v128_extract_byte(v, i) == 0) {
-                    return (p - (const uint8_t *)s) + i;
-                }
-            }
-        }
+static const rosetta_string_kernels_t *impl_table(rosetta_string_impl_t impl)
+{
+    switch (impl) {
+        case ROS_STRING_SCALAR:
+            return &rosetta_string_kernels_scalar;
+#if defined(__x86_64__)
+        case ROS_STRING_SSE2:
+            return &rosetta_string_kernels_sse2;
+        case ROS_STRING_AVX2:
+            return &rosetta_string_kernels_avx2;
+#endif
+#if defined(__aarch64__)
+        case ROS_STRING_NEON:
+            return &rosetta_string_kernels_neon;
+#endif
+        default:
+            return NULL;
+    }
+}
 
-        p += 16;
+int rosetta_string_simd_supported(rosetta_string_impl_t impl)
+{
+    if (!impl_table(impl)) {
+        return 0;
+    }
+    switch (impl) {
+#if defined(__x86_64__)
+        case ROS_STRING_AVX2:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2");
+#endif
+#if defined(__aarch64__) && defined(__linux__)
+        case ROS_STRING_NEON:
+            return (getauxval(AT_HWCAP) & HWCAP_ASIMD) != 0;
+#endif
+        default:
+            return 1;
     }
 }
 
-/**
- * simd_strlen_loop - Main loop for SIMD string length
- */
-size_t simd_strlen_loop(const uint8_t *p)
+int rosetta_string_simd_select(rosetta_string_impl_t impl)
 {
-    size_t len = 0;
+    if (impl < 0 || impl >= ROS_STRING_IMPL_COUNT || !rosetta_string_simd_supported(impl)) {
+        return -ENOTSUP;
+    }
+    __atomic_store_n(&g_active, impl, __ATOMIC_RELAXED);
+    __atomic_store_n(&g_kernels, impl_table(impl), __ATOMIC_RELEASE);
+    return 0;
+}
 
-    while (1) {
-        Vector128 v = v128_load(p + len);
+void rosetta_string_simd_init(void)
+{
+    static const rosetta_string_impl_t preference[] = {
+        ROS_STRING_AVX2, ROS_STRING_NEON, ROS_STRING_SSE2, ROS_STRING_SCALAR
+    };
 
-        if (simd_has_zero_byte(v)) {
-            break;
+    if (__atomic_load_n(&g_kernels, __ATOMIC_ACQUIRE) != &rosetta_string_kernels_resolve) {
+        return;
+    }
+    for (size_t i = 0; i < sizeof(preference) / sizeof(preference[0]); i++) {
+        if (rosetta_string_simd_select(preference[i]) == 0) {
+            return;
         }
+    }
+}
 
-        len += 16;
+const char *rosetta_string_simd_name(rosetta_string_impl_t impl)
+{
+    if (impl < 0 || impl >= ROS_STRING_IMPL_COUNT) {
+        return "unknown";
     }
+    return g_impl_names[impl];
+}
 
-    return len;
+rosetta_string_impl_t rosetta_string_simd_active(void)
+{
+    rosetta_string_simd_init();
+    return __atomic_load_n(&g_active, __ATOMIC_RELAXED);
 }
 
-/* ============================================================================
- * String Comparison
- * ============================================================================ */
+static inline const rosetta_string_kernels_t *kernels(void)
+{
+    return __atomic_load_n(&g_kernels, __ATOMIC_ACQUIRE);
+}
 
-/**
- * rosetta_strcmp_simd - Compare two strings using SIMD
- */
-int rosetta_strcmp_simd(const char *s1, const char *s2)
+/* First-call entries: pick the kernels, then forward */
+
+static size_t resolve_strlen(const char *s)
 {
-    const uint8_t *p1 = (const uint8_t *)s1;
-    const uint8_t *p2 = (const uint8_t *)s2;
+    rosetta_string_simd_init();
+    return kernels()->strlen_fn(s);
+}
 
-    /* Handle aligned case - process 16 bytes at a time */
-    while (1) {
-        Vector128 v1 = v128_load(p1);
-        Vector128 v2 = v128_load(p2);
-
-        /* Check for differences */
-        Vector128 diff = v128_xor(v1, v2);
-
-        if (diff.lo != 0 || diff.hi != 0) {
-            /* Found difference - find first differing byte */
-            for (int i = 0; i < 16; i++) {
-                uint8_t b1 = v128_extract_byte(v1, i);
-                uint8_t b2 = v128_extract_byte(v2, i);
-                if (b1 != b2) {
-                    return (int)b1 - (int)b2;
-                }
-                if (b1 == '\0') {
-                    return 0;  /* Both strings end here */
-                }
-            }
-        }
+static int resolve_strcmp(const char *s1, const char *s2)
+{
+    rosetta_string_simd_init();
+    return kernels()->strcmp_fn(s1, s2);
+}
 
-        /* Check for null terminator (strings are equal so far) */
-        if (simd_has_zero_byte(v1)) {
-            return 0;  /* Strings are equal */
-        }
+static void *resolve_memchr(const void *ptr, int c, size_t n)
+{
+    rosetta_string_simd_init();
+    return kernels()->memchr_fn(ptr, c, n);
+}
 
-        p1 += 16;
-        p2 += 16;
-    }
+static int resolve_memcmp(const void *s1, const void *s2, size_t n)
+{
+    rosetta_string_simd_init();
+    return kernels()->memcmp_fn(s1, s2, n);
 }
 
-/**
- * simd_strcmp_loop - Main loop for SIMD string comparison
- */
-int simd_strcmp_loop(const uint8_t *p1, const uint8_t *p2)
+static void *resolve_memcpy(void *dest, const void *src, size_t n)
 {
-    while (1) {
-        Vector128 v1 = v128_load(p1);
-        Vector128 v2 = v128_load(p2);
+    rosetta_string_simd_init();
+    return kernels()->memcpy_fn(dest, src, n);
+}
 
-        Vector128 diff = v128_xor(v1, v2);
+static void *resolve_memset(void *dest, int c, size_t n)
+{
+    rosetta_string_simd_init();
+    return kernels()->memset_fn(dest, c, n);
+}
 
-        if (diff.lo != 0 || diff.hi != 0) {
-            return -1;  /* Different */
-        }
+static const rosetta_string_kernels_t rosetta_string_kernels_resolve = {
+    .strlen_fn = resolve_strlen,
+    .strcmp_fn = resolve_strcmp,
+    .memchr_fn = resolve_memchr,
+    .memcmp_fn = resolve_memcmp,
+    .memcpy_fn = resolve_memcpy,
+    .memset_fn = resolve_memset,
+};
 
-        if (simd_has_zero_byte(v1)) {
-            return 0;  /* Equal and terminated */
-        }
+/* ============================================================================
+ * String Length and Comparison
+ * ============================================================================ */
 
-        p1 += 16;
-        p2 += 16;
-    }
+/**
+ * rosetta_strlen_simd - Calculate string length using SIMD
+ */
+size_t rosetta_strlen_simd(const char *s)
+{
+    return kernels()->strlen_fn(s);
+}
+
+/**
+ * rosetta_strcmp_simd - Compare two strings using SIMD
+ */
+int rosetta_strcmp_simd(const char *s1, const char *s2)
+{
+    return kernels()->strcmp_fn(s1, s2);
 }
 
 /**
  * rosetta_strncmp_simd - Compare up to n bytes of two strings
+ *
+ * Byte-wise: neither string may be readable past its terminator.
  */
 int rosetta_strncmp_simd(const char *s1, const char *s2, size_t n)
 {
-    if (n == 0) {
-        return 0;
-    }
-
     const uint8_t *p1 = (const uint8_t *)s1;
     const uint8_t *p2 = (const uint8_t *)s2;
-    const uint8_t *end1 = p1 + n;
 
-    while (p1 < end1) {
-        uint8_t b1 = *p1++;
-        uint8_t b2 = *p2++;
-
-        if (b1 != b2) {
-            return (int)b1 - (int)b2;
+    for (; n > 0; n--, p1++, p2++) {
+        if (*p1 != *p2) {
+            return (int)*p1 - (int)*p2;
         }
-
-        if (b1 == '\0') {
+        if (*p1 == '\0') {
             return 0;
         }
     }
-
     return 0;
 }
 
@@ -266,61 +391,7 @@ int rosetta_strncmp_simd(const char *s1, const char *s2, size_t n)
  */
 void *rosetta_memchr_simd(const void *ptr, int c, size_t n)
 {
-    const uint8_t *p = (const uint8_t *)ptr;
-    const uint8_t *end = p + n;
-
-    /* Broadcast search byte to all positions */
-    Vector128 target = simd_broadcast_byte((uint8_t)c);
-
-    /* Align to 16-byte boundary */
-    while ((uintptr_t)p & 0x0F && p < end) {
-        if (*p == (uint8_t)c) {
-            return (void *)p;
-        }
-        p++;
-    }
-
-    /* Process 16 bytes at a time */
-    while (p + 16 <= end) {
-        Vector128 v = v128_load(p);
-
-        /* Compare: result has 0xFF where bytes match */
-        Vector128 cmp = v128_eq(v, target);
-
-        if (cmp.lo != 0 || cmp.hi != 0) {
-            /* Match found - find exact position */
-            for (int i = 0; i < 16; i++) {
-                if (v128_extract_byte(cmp, i) != 0) {
-                    return (void *)(p + i);
-                }
-            }
-        }
-
-        p += 16;
-    }
-
-    /* Handle remaining bytes */
-    while (p < end) {
-        if (*p == (uint8_t)c) {
-            return (void *)p;
-        }
-        p++;
-    }
-
-    return NULL;  /* Not found */
-}
-
-/**
- * rosetta_memchr_simd_variant - Variant with long length parameter
- */
-void *rosetta_memchr_simd_variant(const void *ptr, int c, long len)
-{
-    if (len < 0) {
-        /* Unlimited length - search until found or alignment boundary */
-        return rosetta_memchr_simd(ptr, c, 4096);  /* Reasonable limit */
-    }
-
-    return rosetta_memchr_simd(ptr, c, (size_t)len);
+    return kernels()->memchr_fn(ptr, c, n);
 }
 
 /* ============================================================================
@@ -332,79 +403,51 @@ void *rosetta_memchr_simd_variant(const void *ptr, int c, long len)
  */
 void *rosetta_memcpy_simd(void *dest, const void *src, size_t n)
 {
-    uint8_t *d = (uint8_t *)dest;
-    const uint8_t *s = (const uint8_t *)src;
-
-    /* Handle small copies with regular memcpy */
-    if (n < 64) {
-        memcpy(d, s, n);
-        return dest;
-    }
-
-    /* Align to 16-byte boundary */
-    while ((uintptr_t)s & 0x0F && n > 0) {
-        *d++ = *s++;
-        n--;
-    }
-
-    /* Copy 16 bytes at a time using SIMD */
-    while (n >= 16) {
-        Vector128 v = v128_load(s);
-        v128_store(v, d);
-        s += 16;
-        d += 16;
-        n -= 16;
-    }
-
-    /* Handle remaining bytes */
-    if (n > 0) {
-        memcpy(d, s, n);
-    }
-
-    return dest;
-}
-
-/**
- * simd_memcpy_loop - Main loop for SIMD memcpy
- */
-void *simd_memcpy_loop(void *dest, const void *src, size_t count)
-{
-    uint8_t *d = (uint8_t *)dest;
-    const uint8_t *s = (const uint8_t *)src;
-
-    for (size_t i = 0; i < count; i++) {
-        Vector128 v = v128_load(s + i * 16);
-        v128_store(v, d + i * 16);
-    }
-
-    return d + count * 16;
+    return kernels()->memcpy_fn(dest, src, n);
 }
 
 /**
  * rosetta_memmove_simd - Move memory with overlap handling
+ *
+ * Overlapping moves are split into chunks no longer than the distance
+ * between the buffers, copied in the safe order, so each chunk is a plain
+ * non-overlapping copy.
  */
 void *rosetta_memmove_simd(void *dest, const void *src, size_t n)
 {
     uint8_t *d = (uint8_t *)dest;
     const uint8_t *s = (const uint8_t *)src;
+    size_t dist, chunk;
 
-    if (s == d) {
+    if (d == s || n == 0) {
         return dest;
     }
+    if (d + n <= s || s + n <= d) {
+        return kernels()->memcpy_fn(d, s, n);
+    }
 
-    /* Check for overlap: if dest is after src and overlaps, copy backwards */
-    if (d > s && d < s + n) {
-        /* Copy backwards */
-        s += n;
-        d += n;
-        while (n-- > 0) {
-            *--d = *--s;
+    dist = d > s ? (size_t)(d - s) : (size_t)(s - d);
+    if (dist < 16) {
+        /* Too close for whole vectors: fall back to byte order */
+        if (d < s) {
+            for (size_t i = 0; i < n; i++) d[i] = s[i];
+        } else {
+            for (size_t i = n; i-- > 0;) d[i] = s[i];
         }
-    } else {
-        /* No overlap or dest before src - copy forwards */
-        memcpy(d, s, n);
+        return dest;
     }
 
+    if (d < s) {
+        for (size_t off = 0; off < n; off += chunk) {
+            chunk = n - off < dist ? n - off : dist;
+            kernels()->memcpy_fn(d + off, s + off, chunk);
+        }
+    } else {
+        for (size_t left = n; left > 0; left -= chunk) {
+            chunk = left < dist ? left : dist;
+            kernels()->memcpy_fn(d + left - chunk, s + left - chunk, chunk);
+        }
+    }
     return dest;
 }
 
@@ -417,44 +460,7 @@ void *rosetta_memmove_simd(void *dest, const void *src, size_t n)
  */
 void *rosetta_memset_simd(void *dest, int c, size_t n)
 {
-    uint8_t *d = (uint8_t *)dest;
-
-    /* Create broadcast vector */
-    Vector128 v = simd_broadcast_byte((uint8_t)c);
-
-    /* Align to 16-byte boundary */
-    while ((uintptr_t)d & 0x0F && n > 0) {
-        *d++ = (uint8_t)c;
-        n--;
-    }
-
-    /* Set 16 bytes at a time */
-    while (n >= 16) {
-        v128_store(v, d);
-        d += 16;
-        n -= 16;
-    }
-
-    /* Handle remaining bytes */
-    if (n > 0) {
-        memset(d, c, n);
-    }
-
-    return dest;
-}
-
-/**
- * simd_memset_loop - Main loop for SIMD memset
- */
-void *simd_memset_loop(void *dest, Vector128 v, size_t count)
-{
-    uint8_t *d = (uint8_t *)dest;
-
-    for (size_t i = 0; i < count; i++) {
-        v128_store(v, d + i * 16);
-    }
-
-    return d + count * 16;
+    return kernels()->memset_fn(dest, c, n);
 }
 
 /* ============================================================================
@@ -466,52 +472,8 @@ void *simd_memset_loop(void *dest, Vector128 v, size_t count)
  */
 char *rosetta_strchr_simd(const char *s, int c)
 {
-    const uint8_t *p = (const uint8_t *)s;
-
-    /* Broadcast search character */
-    Vector128 target = simd_broadcast_byte((uint8_t)c);
-
-    /* Align to 16-byte boundary */
-    while ((uintptr_t)p & 0x0F) {
-        if (*p == (uint8_t)c) {
-            return (char *)p;
-        }
-        if (*p == '\0') {
-            return NULL;
-        }
-        p++;
-    }
-
-    /* Process 16 bytes at a time */
-    while (1) {
-        Vector128 v = v128_load(p);
-
-        /* Check for null terminator */
-        if (simd_has_zero_byte(v)) {
-            /* String ends in this block - search remainder linearly */
-            for (int i = 0; i < 16; i++) {
-                if (v128_extract_byte(v, i) == 0) {
-                    return NULL;  /* Reached end without finding character */
-                }
-                if (v128_extract_byte(v, i) == (uint8_t)c) {
-                    return (char *)(p + i);
-                }
-            }
-        }
-
-        /* Check for target character */
-        Vector128 cmp = v128_eq(v, target);
-        if (cmp.lo != 0 || cmp.hi != 0) {
-            /* Found - get exact position */
-            for (int i = 0; i < 16; i++) {
-                if (v128_extract_byte(cmp, i) != 0) {
-                    return (char *)(p + i);
-                }
-            }
-        }
-
-        p += 16;
-    }
+    /* Searching the terminator too makes strchr(s, 0) work */
+    return kernels()->memchr_fn(s, c, kernels()->strlen_fn(s) + 1);
 }
 
 /**
@@ -519,15 +481,18 @@ char *rosetta_strchr_simd(const char *s, int c)
  */
 char *rosetta_strrchr_simd(const char *s, int c)
 {
+    size_t len = kernels()->strlen_fn(s) + 1;
     const char *last = NULL;
     const char *p = s;
+    const char *hit;
 
-    /* Find all occurrences, return the last one */
-    while ((p = rosetta_strchr_simd(p, c)) != NULL) {
-        last = p;
-        p++;  /* Continue search from next position */
+    while ((hit = kernels()->memchr_fn(p, c, len - (size_t)(p - s))) != NULL) {
+        last = hit;
+        p = hit + 1;
+        if ((size_t)(p - s) == len) {
+            break;
+        }
     }
-
     return (char *)last;
 }
 
@@ -536,29 +501,31 @@ char *rosetta_strrchr_simd(const char *s, int c)
  */
 char *rosetta_strstr_simd(const char *haystack, const char *needle)
 {
-    size_t needle_len = rosetta_strlen_simd(needle);
+    size_t needle_len = kernels()->strlen_fn(needle);
+    size_t hay_len;
+    const char *p = haystack;
+    const char *end;
 
     if (needle_len == 0) {
         return (char *)haystack;  /* Empty needle matches at start */
     }
 
-    if (needle_len == 1) {
-        return rosetta_strchr_simd(haystack, needle[0]);
+    hay_len = kernels()->strlen_fn(haystack);
+    if (hay_len < needle_len) {
+        return NULL;
     }
+    end = haystack + hay_len - needle_len + 1;  /* Last possible start + 1 */
 
-    const char *p = haystack;
-
-    while (*p) {
-        /* Quick check: first character match */
-        if (*p == needle[0]) {
-            /* Check full match */
-            if (rosetta_memcmp_simd(p, needle, needle_len) == 0) {
-                return (char *)p;
-            }
+    while (p < end) {
+        p = kernels()->memchr_fn(p, (uint8_t)needle[0], (size_t)(end - p));
+        if (!p) {
+            return NULL;
+        }
+        if (kernels()->memcmp_fn(p + 1, needle + 1, needle_len - 1) == 0) {
+            return (char *)p;
         }
         p++;
     }
-
     return NULL;  /* Not found */
 }
 
@@ -571,37 +538,8 @@ char *rosetta_strstr_simd(const char *haystack, const char *needle)
  */
 char *rosetta_strcpy_simd(char *dest, const char *src)
 {
-    const uint8_t *s = (const uint8_t *)src;
-    uint8_t *d = (uint8_t *)dest;
-
-    /* Align to 16-byte boundary */
-    while ((uintptr_t)s & 0x0F) {
-        *d++ = *s;
-        if (*s == '\0') {
-            return dest;
-        }
-        s++;
-    }
-
-    /* Copy 16 bytes at a time */
-    while (1) {
-        Vector128 v = v128_load(s);
-
-        if (simd_has_zero_byte(v)) {
-            /* Null byte found - copy byte by byte to end */
-            for (int i = 0; i < 16; i++) {
-                uint8_t byte = v128_extract_byte(v, i);
-                *d++ = byte;
-                if (byte == '\0') {
-                    return dest;
-                }
-            }
-        }
-
-        v128_store(v, d);
-        s += 16;
-        d += 16;
-    }
+    kernels()->memcpy_fn(dest, src, kernels()->strlen_fn(src) + 1);
+    return dest;
 }
 
 /**
@@ -609,24 +547,14 @@ char *rosetta_strcpy_simd(char *dest, const char *src)
  */
 char *rosetta_strncpy_simd(char *dest, const char *src, size_t n)
 {
-    if (n == 0) {
-        return dest;
-    }
-
-    const uint8_t *s = (const uint8_t *)src;
-    uint8_t *d = (uint8_t *)dest;
-    size_t copied = 0;
+    size_t len = 0;
 
-    while (copied < n) {
-        if (*s == '\0') {
-            /* Pad with zeros */
-            memset(d, 0, n - copied);
-            break;
-        }
-        *d++ = *s++;
-        copied++;
+    /* Bounded scan: src need not be readable past its terminator or n */
+    while (len < n && src[len] != '\0') {
+        len++;
     }
-
+    kernels()->memcpy_fn(dest, src, len);
+    kernels()->memset_fn(dest + len, 0, n - len);
     return dest;
 }
 
@@ -639,39 +567,5 @@ char *rosetta_strncpy_simd(char *dest, const char *src, size_t n)
  */
 int rosetta_memcmp_simd(const void *s1, const void *s2, size_t n)
 {
-    const uint8_t *p1 = (const uint8_t *)s1;
-    const uint8_t *p2 = (const uint8_t *)s2;
-
-    /* Compare 16 bytes at a time */
-    while (n >= 16) {
-        Vector128 v1 = v128_load(p1);
-        Vector128 v2 = v128_load(p2);
-
-        Vector128 diff = v128_xor(v1, v2);
-        if (diff.lo != 0 || diff.hi != 0) {
-            /* Find first difference */
-            for (int i = 0; i < 16; i++) {
-                uint8_t b1 = v128_extract_byte(v1, i);
-                uint8_t b2 = v128_extract_byte(v2, i);
-                if (b1 != b2) {
-                    return (int)b1 - (int)b2;
-                }
-            }
-        }
-
-        p1 += 16;
-        p2 += 16;
-        n -= 16;
-    }
-
-    /* Handle remaining bytes */
-    while (n-- > 0) {
-        if (*p1 != *p2) {
-            return (int)*p1 - (int)*p2;
-        }
-        p1++;
-        p2++;
-    }
-
-    return 0;  /* Equal */
+    return kernels()->memcmp_fn(s1, s2, n);
 }
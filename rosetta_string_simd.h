@@ -2,8 +2,12 @@
  * Rosetta Translator - SIMD String Utilities Header
  * ============================================================================
  *
- * This module provides SIMD-optimized string and memory operations
- * for high-performance string processing.
+ * One string/memory kernel library for guest string intrinsics and the
+ * runtime's own string work. The core kernels (strlen, strcmp, memchr,
+ * memcmp, memcpy, memset) have SSE2 and AVX2 versions on x86_64 hosts,
+ * NEON on ARM64 hosts and a word-at-a-time scalar fallback; the best one
+ * the CPU supports is picked once, at rosetta_string_simd_init() or on
+ * first use. The remaining functions are built on those kernels.
  * ============================================================================ */
 
 #ifndef ROSETTA_STRING_SIMD_H
@@ -11,7 +15,47 @@
 
 #include <stdint.h>
 #include <stddef.h>
-#include "rosetta_refactored_vector.h"
+
+/* ============================================================================
+ * Kernel Selection
+ * ============================================================================ */
+
+typedef enum {
+    ROS_STRING_SCALAR = 0,
+    ROS_STRING_SSE2,
+    ROS_STRING_AVX2,
+    ROS_STRING_NEON,
+    ROS_STRING_IMPL_COUNT
+} rosetta_string_impl_t;
+
+/**
+ * rosetta_string_simd_init - Pick the best kernels for this CPU
+ *
+ * Idempotent; the kernels also resolve themselves on first call.
+ */
+void rosetta_string_simd_init(void);
+
+/**
+ * rosetta_string_simd_select - Force one implementation
+ * @param impl Implementation to use
+ * @return 0 on success, -ENOTSUP if this host cannot run it
+ */
+int rosetta_string_simd_select(rosetta_string_impl_t impl);
+
+/**
+ * rosetta_string_simd_supported - Check whether an implementation can run here
+ */
+int rosetta_string_simd_supported(rosetta_string_impl_t impl);
+
+/**
+ * rosetta_string_simd_name - Name of an implementation ("avx2", ...)
+ */
+const char *rosetta_string_simd_name(rosetta_string_impl_t impl);
+
+/**
+ * rosetta_string_simd_active - Implementation currently in use
+ */
+rosetta_string_impl_t rosetta_string_simd_active(void);
 
 /* ============================================================================
  * String Length and Comparison
@@ -21,9 +65,6 @@
  * rosetta_strlen_simd - Calculate string length using SIMD
  * @param s Input null-terminated string
  * @return Length of string (not including null terminator)
- *
- * Processes 16 bytes at a time using SIMD parallel comparison
- * to find the null terminator efficiently.
  */
 size_t rosetta_strlen_simd(const char *s);
 
@@ -32,8 +73,6 @@ size_t rosetta_strlen_simd(const char *s);
  * @param s1 First string
  * @param s2 Second string
  * @return 0 if equal, negative if s1 < s2, positive if s1 > s2
- *
- * Uses SIMD parallel byte comparison for faster string comparison.
  */
 int rosetta_strcmp_simd(const char *s1, const char *s2);
 
@@ -68,25 +107,13 @@ char *rosetta_strncpy_simd(char *dest, const char *src, size_t n);
  * ============================================================================ */
 
 /**
- * rosetta_memchr_simd_search - Find byte in memory using SIMD
+ * rosetta_memchr_simd - Find byte in memory using SIMD
  * @param ptr Pointer to memory
  * @param c Byte value to search for
  * @param n Number of bytes to search
  * @return Pointer to first occurrence, or NULL if not found
- *
- * Uses SIMD parallel comparison to search for a byte value
- * much faster than byte-by-byte comparison.
- */
-void *rosetta_memchr_simd_search(const void *ptr, int c, size_t n);
-
-/**
- * rosetta_memchr_simd_variant - Variant with long length parameter
- * @param ptr Pointer to memory
- * @param c Byte value to search for
- * @param len Number of bytes to search (negative = unlimited)
- * @return Pointer to first occurrence, or NULL if not found
  */
-void *rosetta_memchr_simd_variant(const void *ptr, int c, long len);
+void *rosetta_memchr_simd(const void *ptr, int c, size_t n);
 
 /* ============================================================================
  * Memory Comparison
@@ -112,8 +139,7 @@ int rosetta_memcmp_simd(const void *s1, const void *s2, size_t n);
  * @param n Number of bytes to copy
  * @return Pointer to destination buffer
  *
- * Uses SIMD load/store for high-bandwidth memory copying.
- * Optimized for aligned, large copies.
+ * The ranges must not overlap.
  */
 void *rosetta_memcpy_simd(void *dest, const void *src, size_t n);
 
@@ -134,8 +160,6 @@ void *rosetta_memmove_simd(void *dest, const void *src, size_t n);
  * @param c Byte value to set
  * @param n Number of bytes to set
  * @return Pointer to destination buffer
- *
- * Uses SIMD broadcast and store for fast initialization.
  */
 void *rosetta_memset_simd(void *dest, int c, size_t n);
 
@@ -167,81 +191,4 @@ char *rosetta_strchr_simd(const char *s, int c);
  */
 char *rosetta_strrchr_simd(const char *s, int c);
 
-/* ============================================================================
- * SIMD Helper Functions
- * ============================================================================ */
-
-/**
- * simd_has_zero_byte - Check if any byte in vector is zero
- * @param v Input vector
- * @return Non-zero if any byte is zero
- */
-int simd_has_zero_byte(Vector128 v);
-
-/**
- * simd_has_byte - Check if any byte in vector matches value
- * @param v Input vector
- * @param c Byte value to match
- * @return Non-zero if any byte matches
- */
-int simd_has_byte(Vector128 v, uint8_t c);
-
-/**
- * simd_byte_mask - Convert vector comparison to byte mask
- * @param v Input vector with comparison results
- * @return Byte mask (16 bits, one per byte)
- */
-uint16_t simd_byte_mask(Vector128 v);
-
-/**
- * simd_find_first_nonzero - Find index of first non-zero byte
- * @param v Input vector
- * @return Index of first non-zero byte (0-15), or 16 if all zero
- */
-int simd_find_first_nonzero(Vector128 v);
-
-/**
- * simd_broadcast_byte - Create vector with all bytes set to same value
- * @param c Byte value to broadcast
- * @return Vector with all 16 bytes set to c
- */
-Vector128 simd_broadcast_byte(uint8_t c);
-
-/* ============================================================================
- * Advanced SIMD String Operations
- * ============================================================================ */
-
-/**
- * simd_strcmp_loop - Main loop for SIMD string comparison
- * @param p1 Pointer to first string
- * @param p2 Pointer to second string
- * @return 0 if equal up to first difference or null, non-zero otherwise
- */
-int simd_strcmp_loop(const uint8_t *p1, const uint8_t *p2);
-
-/**
- * simd_strlen_loop - Main loop for SIMD string length
- * @param p Pointer to string
- * @return Length accumulated from processed blocks
- */
-size_t simd_strlen_loop(const uint8_t *p);
-
-/**
- * simd_memset_loop - Main loop for SIMD memset
- * @param dest Destination pointer
- * @param v Vector value to store
- * @param count Number of vectors to write
- * @return Final destination pointer
- */
-void *simd_memset_loop(void *dest, Vector128 v, size_t count);
-
-/**
- * simd_memcpy_loop - Main loop for SIMD memcpy
- * @param dest Destination pointer
- * @param src Source pointer
- * @param count Number of vectors to copy
- * @return Final destination pointer
- */
-void *simd_memcpy_loop(void *dest, const void *src, size_t count);
-
 #endif /* ROSETTA_STRING_SIMD_H */
@@ -0,0 +1,46 @@
+/* ============================================================================
+ * Rosetta Translator - SIMD String Kernel Tables
+ * ============================================================================
+ *
+ * Internal to the string kernel library. Each implementation fills one
+ * table; rosetta_string_simd.c picks a table and routes the public
+ * functions through it. Kernels that need a wider ISA than the file is
+ * compiled for carry their own target attributes, so no special flags are
+ * needed to build them.
+ * ============================================================================ */
+
+#ifndef ROSETTA_STRING_SIMD_IMPL_H
+#define ROSETTA_STRING_SIMD_IMPL_H
+
+#include "rosetta_string_simd.h"
+
+/* Largest vector any kernel loads; strcmp/strlen never read past the page
+ * holding the terminator, which relies on this dividing the page size */
+#define ROS_STRING_MAX_VEC      32
+#define ROS_STRING_PAGE_SIZE    4096
+
+typedef struct {
+    size_t (*strlen_fn)(const char *s);
+    int    (*strcmp_fn)(const char *s1, const char *s2);
+    void  *(*memchr_fn)(const void *ptr, int c, size_t n);
+    int    (*memcmp_fn)(const void *s1, const void *s2, size_t n);
+    void  *(*memcpy_fn)(void *dest, const void *src, size_t n);
+    void  *(*memset_fn)(void *dest, int c, size_t n);
+} rosetta_string_kernels_t;
+
+extern const rosetta_string_kernels_t rosetta_string_kernels_scalar;
+
+#if defined(__x86_64__)
+extern const rosetta_string_kernels_t rosetta_string_kernels_sse2;
+extern const rosetta_string_kernels_t rosetta_string_kernels_avx2;
+#endif
+
+#if defined(__aarch64__)
+extern const rosetta_string_kernels_t rosetta_string_kernels_neon;
+#endif
+
+/* Shared by the vector kernels for their sub-vector heads and tails */
+void *rosetta_string_small_memcpy(void *dest, const void *src, size_t n);
+void *rosetta_string_small_memset(void *dest, int c, size_t n);
+
+#endif /* ROSETTA_STRING_SIMD_IMPL_H */
@@ -0,0 +1,208 @@
+/* ============================================================================
+ * Rosetta Translator - NEON String Kernels
+ * ============================================================================
+ *
+ * ARM64 hosts only. Byte-compare results are narrowed to a 64-bit mask
+ * with four bits per byte (SHRN #4), so the first hit is ctz(mask) / 4.
+ * strlen and strcmp follow the same page rules as the x86 kernels: aligned
+ * loads for strlen, a page-end check before each unaligned strcmp load.
+ * ============================================================================ */
+
+#include "rosetta_string_simd_impl.h"
+
+#if defined(__aarch64__)
+
+#include <arm_neon.h>
+
+static inline uint64_t neon_mask(uint8x16_t cmp)
+{
+    return vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(cmp), 4)), 0);
+}
+
+static inline int near_page_end(const void *p)
+{
+    return ((uintptr_t)p & (ROS_STRING_PAGE_SIZE - 1)) > ROS_STRING_PAGE_SIZE - 16;
+}
+
+static size_t neon_strlen(const char *s)
+{
+    uintptr_t off = (uintptr_t)s & 15;
+    const uint8_t *p = (const uint8_t *)s - off;
+    uint64_t mask;
+
+    mask = neon_mask(vceqzq_u8(vld1q_u8(p))) >> (off * 4);
+    if (mask) {
+        return (size_t)(__builtin_ctzll(mask) >> 2);
+    }
+    for (;;) {
+        p += 16;
+        mask = neon_mask(vceqzq_u8(vld1q_u8(p)));
+        if (mask) {
+            return (size_t)(p - (const uint8_t *)s) + (size_t)(__builtin_ctzll(mask) >> 2);
+        }
+    }
+}
+
+static int neon_strcmp(const char *s1, const char *s2)
+{
+    const uint8_t *p1 = (const uint8_t *)s1;
+    const uint8_t *p2 = (const uint8_t *)s2;
+
+    for (;;) {
+        if (near_page_end(p1) || near_page_end(p2)) {
+            for (int i = 0; i < 16; i++, p1++, p2++) {
+                if (*p1 != *p2 || *p1 == 0) {
+                    return (int)*p1 - (int)*p2;
+                }
+            }
+            continue;
+        }
+
+        uint8x16_t a = vld1q_u8(p1);
+        uint8x16_t b = vld1q_u8(p2);
+        /* Lanes that differ or hold the terminator */
+        uint8x16_t stop = vorrq_u8(vmvnq_u8(vceqq_u8(a, b)), vceqzq_u8(a));
+        uint64_t mask = neon_mask(stop);
+        if (mask) {
+            unsigned i = (unsigned)(__builtin_ctzll(mask) >> 2);
+            return (int)p1[i] - (int)p2[i];
+        }
+        p1 += 16;
+        p2 += 16;
+    }
+}
+
+static void *neon_memchr(const void *ptr, int c, size_t n)
+{
+    const uint8_t *p = (const uint8_t *)ptr;
+    const uint8_t *end = p + n;
+    const uint8x16_t needle = vdupq_n_u8((uint8_t)c);
+    uint64_t mask;
+
+    if (n < 16) {
+        for (; p < end; p++) {
+            if (*p == (uint8_t)c) {
+                return (void *)p;
+            }
+        }
+        return NULL;
+    }
+
+    for (; p + 64 <= end; p += 64) {
+        uint8x16_t c0 = vceqq_u8(vld1q_u8(p), needle);
+        uint8x16_t c1 = vceqq_u8(vld1q_u8(p + 16), needle);
+        uint8x16_t c2 = vceqq_u8(vld1q_u8(p + 32), needle);
+        uint8x16_t c3 = vceqq_u8(vld1q_u8(p + 48), needle);
+
+        if (vmaxvq_u8(vorrq_u8(vorrq_u8(c0, c1), vorrq_u8(c2, c3)))) {
+            if ((mask = neon_mask(c0)) != 0) return (void *)(p + (__builtin_ctzll(mask) >> 2));
+            if ((mask = neon_mask(c1)) != 0) return (void *)(p + 16 + (__builtin_ctzll(mask) >> 2));
+            if ((mask = neon_mask(c2)) != 0) return (void *)(p + 32 + (__builtin_ctzll(mask) >> 2));
+            mask = neon_mask(c3);
+            return (void *)(p + 48 + (__builtin_ctzll(mask) >> 2));
+        }
+    }
+    for (; p + 16 <= end; p += 16) {
+        mask = neon_mask(vceqq_u8(vld1q_u8(p), needle));
+        if (mask) {
+            return (void *)(p + (__builtin_ctzll(mask) >> 2));
+        }
+    }
+    if (p < end) {
+        /* Last vector overlaps bytes already known not to match */
+        p = end - 16;
+        mask = neon_mask(vceqq_u8(vld1q_u8(p), needle));
+        if (mask) {
+            return (void *)(p + (__builtin_ctzll(mask) >> 2));
+        }
+    }
+    return NULL;
+}
+
+static int neon_memcmp(const void *s1, const void *s2, size_t n)
+{
+    const uint8_t *p1 = (const uint8_t *)s1;
+    const uint8_t *p2 = (const uint8_t *)s2;
+    size_t i = 0;
+    uint64_t mask;
+
+    if (n < 16) {
+        for (; i < n; i++) {
+            if (p1[i] != p2[i]) {
+                return (int)p1[i] - (int)p2[i];
+            }
+        }
+        return 0;
+    }
+
+    for (;;) {
+        if (i + 16 > n) {
+            i = n - 16;         /* Overlapping tail; the prefix is equal */
+        }
+        mask = neon_mask(vmvnq_u8(vceqq_u8(vld1q_u8(p1 + i), vld1q_u8(p2 + i))));
+        if (mask) {
+            i += (size_t)(__builtin_ctzll(mask) >> 2);
+            return (int)p1[i] - (int)p2[i];
+        }
+        i += 16;
+        if (i >= n) {
+            return 0;
+        }
+    }
+}
+
+static void *neon_memcpy(void *dest, const void *src, size_t n)
+{
+    uint8_t *d = (uint8_t *)dest;
+    const uint8_t *s = (const uint8_t *)src;
+    uint8x16_t tail;
+
+    if (n < 16) {
+        return rosetta_string_small_memcpy(dest, src, n);
+    }
+
+    tail = vld1q_u8(s + n - 16);
+    for (size_t i = 0; i + 64 <= n - 16; i += 64) {
+        uint8x16x4_t v = vld1q_u8_x4(s + i);
+        vst1q_u8_x4(d + i, v);
+    }
+    for (size_t i = (n - 16) & ~(size_t)63; i < n - 16; i += 16) {
+        vst1q_u8(d + i, vld1q_u8(s + i));
+    }
+    vst1q_u8(d + n - 16, tail);
+    return dest;
+}
+
+static void *neon_memset(void *dest, int c, size_t n)
+{
+    uint8_t *d = (uint8_t *)dest;
+    const uint8x16_t v = vdupq_n_u8((uint8_t)c);
+    size_t i;
+
+    if (n < 16) {
+        return rosetta_string_small_memset(dest, c, n);
+    }
+
+    for (i = 0; i + 64 <= n; i += 64) {
+        vst1q_u8(d + i, v);
+        vst1q_u8(d + i + 16, v);
+        vst1q_u8(d + i + 32, v);
+        vst1q_u8(d + i + 48, v);
+    }
+    for (; i + 16 <= n; i += 16) {
+        vst1q_u8(d + i, v);
+    }
+    vst1q_u8(d + n - 16, v);
+    return dest;
+}
+
+const rosetta_string_kernels_t rosetta_string_kernels_neon = {
+    .strlen_fn = neon_strlen,
+    .strcmp_fn = neon_strcmp,
+    .memchr_fn = neon_memchr,
+    .memcmp_fn = neon_memcmp,
+    .memcpy_fn = neon_memcpy,
+    .memset_fn = neon_memset,
+};
+
+#endif /* __aarch64__ */
@@ -0,0 +1,435 @@
+/* ============================================================================
+ * Rosetta Translator - SSE2/AVX2 String Kernels
+ * ============================================================================
+ *
+ * x86_64 hosts only. SSE2 is part of the x86_64 baseline; the AVX2 kernels
+ * are compiled with a target attribute and only installed when cpuid says
+ * the CPU and OS support them.
+ *
+ * strlen and strcmp do not know their length up front. strlen only issues
+ * aligned loads, which cannot cross a page; strcmp checks that neither
+ * pointer is within one vector of a page end before an unaligned load and
+ * steps byte-wise across the boundary otherwise.
+ *
+ * Short inputs in the AVX2 kernels hand off to the SSE2 ones. GCC may hoist
+ * ymm setup above that branch, so the hand-off clears the upper halves
+ * first to avoid the AVX-to-SSE transition penalty.
+ * ============================================================================ */
+
+#include "rosetta_string_simd_impl.h"
+
+#if defined(__x86_64__)
+
+#include <immintrin.h>
+
+#define AVX2 __attribute__((target("avx2")))
+
+static inline int near_page_end(const void *p, size_t width)
+{
+    return ((uintptr_t)p & (ROS_STRING_PAGE_SIZE - 1)) > ROS_STRING_PAGE_SIZE - width;
+}
+
+/* Compare up to limit bytes one at a time; *done is set when a result is known */
+static inline int strcmp_bytes(const uint8_t **p1, const uint8_t **p2, size_t limit, int *done)
+{
+    const uint8_t *a = *p1, *b = *p2;
+
+    for (size_t i = 0; i < limit; i++) {
+        if (a[i] != b[i] || a[i] == 0) {
+            *done = 1;
+            return (int)a[i] - (int)b[i];
+        }
+    }
+    *p1 = a + limit;
+    *p2 = b + limit;
+    *done = 0;
+    return 0;
+}
+
+/* ============================================================================
+ * SSE2 Kernels
+ * ============================================================================ */
+
+static size_t sse2_strlen(const char *s)
+{
+    const __m128i zero = _mm_setzero_si128();
+    uintptr_t off = (uintptr_t)s & 15;
+    const __m128i *p = (const __m128i *)(s - off);
+    unsigned mask;
+
+    /* First aligned block, ignoring bytes before s */
+    mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128(p), zero)) >> off;
+    if (mask) {
+        return (size_t)__builtin_ctz(mask);
+    }
+    for (;;) {
+        p++;
+        mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128(p), zero));
+        if (mask) {
+            return (size_t)((const char *)p - s) + (size_t)__builtin_ctz(mask);
+        }
+    }
+}
+
+static int sse2_strcmp(const char *s1, const char *s2)
+{
+    const uint8_t *p1 = (const uint8_t *)s1;
+    const uint8_t *p2 = (const uint8_t *)s2;
+    const __m128i zero = _mm_setzero_si128();
+    int done, ret;
+
+    for (;;) {
+        if (near_page_end(p1, 16) || near_page_end(p2, 16)) {
+            ret = strcmp_bytes(&p1, &p2, 16, &done);
+            if (done) {
+                return ret;
+            }
+            continue;
+        }
+
+        __m128i a = _mm_loadu_si128((const __m128i *)p1);
+        __m128i b = _mm_loadu_si128((const __m128i *)p2);
+        unsigned mask = ((unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(a, b)) ^ 0xFFFFu) |
+                        (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(a, zero));
+        if (mask) {
+            unsigned i = (unsigned)__builtin_ctz(mask);
+            return (int)p1[i] - (int)p2[i];
+        }
+        p1 += 16;
+        p2 += 16;
+    }
+}
+
+static void *sse2_memchr(const void *ptr, int c, size_t n)
+{
+    const uint8_t *p = (const uint8_t *)ptr;
+    const uint8_t *end = p + n;
+    const __m128i needle = _mm_set1_epi8((char)c);
+    unsigned mask;
+
+    if (n < 16) {
+        for (; p < end; p++) {
+            if (*p == (uint8_t)c) {
+                return (void *)p;
+            }
+        }
+        return NULL;
+    }
+
+    for (; p + 64 <= end; p += 64) {
+        __m128i c0 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)p), needle);
+        __m128i c1 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(p + 16)), needle);
+        __m128i c2 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(p + 32)), needle);
+        __m128i c3 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(p + 48)), needle);
+        __m128i any = _mm_or_si128(_mm_or_si128(c0, c1), _mm_or_si128(c2, c3));
+
+        if (_mm_movemask_epi8(any)) {
+            uint64_t m = (uint64_t)(unsigned)_mm_movemask_epi8(c0) |
+                         (uint64_t)(unsigned)_mm_movemask_epi8(c1) << 16 |
+                         (uint64_t)(unsigned)_mm_movemask_epi8(c2) << 32 |
+                         (uint64_t)(unsigned)_mm_movemask_epi8(c3) << 48;
+            return (void *)(p + __builtin_ctzll(m));
+        }
+    }
+    for (; p + 16 <= end; p += 16) {
+        mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)p), needle));
+        if (mask) {
+            return (void *)(p + __builtin_ctz(mask));
+        }
+    }
+    if (p < end) {
+        /* Last vector overlaps bytes already known not to match */
+        p = end - 16;
+        mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)p), needle));
+        if (mask) {
+            return (void *)(p + __builtin_ctz(mask));
+        }
+    }
+    return NULL;
+}
+
+static int sse2_memcmp(const void *s1, const void *s2, size_t n)
+{
+    const uint8_t *p1 = (const uint8_t *)s1;
+    const uint8_t *p2 = (const uint8_t *)s2;
+    size_t i = 0;
+    unsigned mask;
+
+    if (n < 16) {
+        for (; i < n; i++) {
+            if (p1[i] != p2[i]) {
+                return (int)p1[i] - (int)p2[i];
+            }
+        }
+        return 0;
+    }
+
+    for (;;) {
+        if (i + 16 > n) {
+            i = n - 16;         /* Overlapping tail; the prefix is equal */
+        }
+        mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(
+                   _mm_loadu_si128((const __m128i *)(p1 + i)),
+                   _mm_loadu_si128((const __m128i *)(p2 + i)))) ^ 0xFFFFu;
+        if (mask) {
+            i += (size_t)__builtin_ctz(mask);
+            return (int)p1[i] - (int)p2[i];
+        }
+        i += 16;
+        if (i >= n) {
+            return 0;
+        }
+    }
+}
+
+static void *sse2_memcpy(void *dest, const void *src, size_t n)
+{
+    uint8_t *d = (uint8_t *)dest;
+    const uint8_t *s = (const uint8_t *)src;
+    __m128i tail;
+
+    if (n < 16) {
+        return rosetta_string_small_memcpy(dest, src, n);
+    }
+
+    tail = _mm_loadu_si128((const __m128i *)(s + n - 16));
+    for (size_t i = 0; i + 64 <= n - 16; i += 64) {
+        __m128i v0 = _mm_loadu_si128((const __m128i *)(s + i));
+        __m128i v1 = _mm_loadu_si128((const __m128i *)(s + i + 16));
+        __m128i v2 = _mm_loadu_si128((const __m128i *)(s + i + 32));
+        __m128i v3 = _mm_loadu_si128((const __m128i *)(s + i + 48));
+        _mm_storeu_si128((__m128i *)(d + i), v0);
+        _mm_storeu_si128((__m128i *)(d + i + 16), v1);
+        _mm_storeu_si128((__m128i *)(d + i + 32), v2);
+        _mm_storeu_si128((__m128i *)(d + i + 48), v3);
+    }
+    for (size_t i = (n - 16) & ~(size_t)63; i < n - 16; i += 16) {
+        _mm_storeu_si128((__m128i *)(d + i), _mm_loadu_si128((const __m128i *)(s + i)));
+    }
+    _mm_storeu_si128((__m128i *)(d + n - 16), tail);
+    return dest;
+}
+
+static void *sse2_memset(void *dest, int c, size_t n)
+{
+    uint8_t *d = (uint8_t *)dest;
+    const __m128i v = _mm_set1_epi8((char)c);
+    size_t i;
+
+    if (n < 16) {
+        return rosetta_string_small_memset(dest, c, n);
+    }
+
+    for (i = 0; i + 64 <= n; i += 64) {
+        _mm_storeu_si128((__m128i *)(d + i), v);
+        _mm_storeu_si128((__m128i *)(d + i + 16), v);
+        _mm_storeu_si128((__m128i *)(d + i + 32), v);
+        _mm_storeu_si128((__m128i *)(d + i + 48), v);
+    }
+    for (; i + 16 <= n; i += 16) {
+        _mm_storeu_si128((__m128i *)(d + i), v);
+    }
+    _mm_storeu_si128((__m128i *)(d + n - 16), v);
+    return dest;
+}
+
+const rosetta_string_kernels_t rosetta_string_kernels_sse2 = {
+    .strlen_fn = sse2_strlen,
+    .strcmp_fn = sse2_strcmp,
+    .memchr_fn = sse2_memchr,
+    .memcmp_fn = sse2_memcmp,
+    .memcpy_fn = sse2_memcpy,
+    .memset_fn = sse2_memset,
+};
+
+/* ============================================================================
+ * AVX2 Kernels
+ * ============================================================================ */
+
+AVX2 static size_t avx2_strlen(const char *s)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    uintptr_t off = (uintptr_t)s & 31;
+    const __m256i *p = (const __m256i *)(s - off);
+    uint32_t mask;
+
+    mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_load_si256(p), zero)) >> off;
+    if (mask) {
+        return (size_t)__builtin_ctz(mask);
+    }
+    for (;;) {
+        p++;
+        mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_load_si256(p), zero));
+        if (mask) {
+            return (size_t)((const char *)p - s) + (size_t)__builtin_ctz(mask);
+        }
+    }
+}
+
+AVX2 static int avx2_strcmp(const char *s1, const char *s2)
+{
+    const uint8_t *p1 = (const uint8_t *)s1;
+    const uint8_t *p2 = (const uint8_t *)s2;
+    const __m256i zero = _mm256_setzero_si256();
+    int done, ret;
+
+    for (;;) {
+        if (near_page_end(p1, 32) || near_page_end(p2, 32)) {
+            ret = strcmp_bytes(&p1, &p2, 32, &done);
+            if (done) {
+                return ret;
+            }
+            continue;
+        }
+
+        __m256i a = _mm256_loadu_si256((const __m256i *)p1);
+        __m256i b = _mm256_loadu_si256((const __m256i *)p2);
+        uint32_t mask = ~(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b)) |
+                        (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, zero));
+        if (mask) {
+            unsigned i = (unsigned)__builtin_ctz(mask);
+            return (int)p1[i] - (int)p2[i];
+        }
+        p1 += 32;
+        p2 += 32;
+    }
+}
+
+AVX2 static void *avx2_memchr(const void *ptr, int c, size_t n)
+{
+    const uint8_t *p = (const uint8_t *)ptr;
+    const uint8_t *end = p + n;
+    const __m256i needle = _mm256_set1_epi8((char)c);
+    uint32_t mask;
+
+    if (n < 32) {
+        _mm256_zeroupper();
+        return sse2_memchr(ptr, c, n);
+    }
+
+    for (; p + 128 <= end; p += 128) {
+        __m256i c0 = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)p), needle);
+        __m256i c1 = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(p + 32)), needle);
+        __m256i c2 = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(p + 64)), needle);
+        __m256i c3 = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(p + 96)), needle);
+        __m256i any = _mm256_or_si256(_mm256_or_si256(c0, c1), _mm256_or_si256(c2, c3));
+
+        if (_mm256_movemask_epi8(any)) {
+            uint64_t lo = (uint64_t)(uint32_t)_mm256_movemask_epi8(c0) |
+                          (uint64_t)(uint32_t)_mm256_movemask_epi8(c1) << 32;
+            uint64_t hi = (uint64_t)(uint32_t)_mm256_movemask_epi8(c2) |
+                          (uint64_t)(uint32_t)_mm256_movemask_epi8(c3) << 32;
+            return (void *)(lo ? p + __builtin_ctzll(lo) : p + 64 + __builtin_ctzll(hi));
+        }
+    }
+    for (; p + 32 <= end; p += 32) {
+        mask = (uint32_t)_mm256_movemask_epi8(
+                   _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)p), needle));
+        if (mask) {
+            return (void *)(p + __builtin_ctz(mask));
+        }
+    }
+    if (p < end) {
+        p = end - 32;
+        mask = (uint32_t)_mm256_movemask_epi8(
+                   _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)p), needle));
+        if (mask) {
+            return (void *)(p + __builtin_ctz(mask));
+        }
+    }
+    return NULL;
+}
+
+AVX2 static int avx2_memcmp(const void *s1, const void *s2, size_t n)
+{
+    const uint8_t *p1 = (const uint8_t *)s1;
+    const uint8_t *p2 = (const uint8_t *)s2;
+    size_t i = 0;
+    uint32_t mask;
+
+    if (n < 32) {
+        _mm256_zeroupper();
+        return sse2_memcmp(s1, s2, n);
+    }
+
+    for (;;) {
+        if (i + 32 > n) {
+            i = n - 32;
+        }
+        mask = ~(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(
+                   _mm256_loadu_si256((const __m256i *)(p1 + i)),
+                   _mm256_loadu_si256((const __m256i *)(p2 + i))));
+        if (mask) {
+            i += (size_t)__builtin_ctz(mask);
+            return (int)p1[i] - (int)p2[i];
+        }
+        i += 32;
+        if (i >= n) {
+            return 0;
+        }
+    }
+}
+
+AVX2 static void *avx2_memcpy(void *dest, const void *src, size_t n)
+{
+    uint8_t *d = (uint8_t *)dest;
+    const uint8_t *s = (const uint8_t *)src;
+    __m256i tail;
+
+    if (n < 32) {
+        _mm256_zeroupper();
+        return sse2_memcpy(dest, src, n);
+    }
+
+    tail = _mm256_loadu_si256((const __m256i *)(s + n - 32));
+    for (size_t i = 0; i + 128 <= n - 32; i += 128) {
+        __m256i v0 = _mm256_loadu_si256((const __m256i *)(s + i));
+        __m256i v1 = _mm256_loadu_si256((const __m256i *)(s + i + 32));
+        __m256i v2 = _mm256_loadu_si256((const __m256i *)(s + i + 64));
+        __m256i v3 = _mm256_loadu_si256((const __m256i *)(s + i + 96));
+        _mm256_storeu_si256((__m256i *)(d + i), v0);
+        _mm256_storeu_si256((__m256i *)(d + i + 32), v1);
+        _mm256_storeu_si256((__m256i *)(d + i + 64), v2);
+        _mm256_storeu_si256((__m256i *)(d + i + 96), v3);
+    }
+    for (size_t i = (n - 32) & ~(size_t)127; i < n - 32; i += 32) {
+        _mm256_storeu_si256((__m256i *)(d + i), _mm256_loadu_si256((const __m256i *)(s + i)));
+    }
+    _mm256_storeu_si256((__m256i *)(d + n - 32), tail);
+    return dest;
+}
+
+AVX2 static void *avx2_memset(void *dest, int c, size_t n)
+{
+    uint8_t *d = (uint8_t *)dest;
+    const __m256i v = _mm256_set1_epi8((char)c);
+    size_t i;
+
+    if (n < 32) {
+        _mm256_zeroupper();
+        return sse2_memset(dest, c, n);
+    }
+
+    for (i = 0; i + 128 <= n; i += 128) {
+        _mm256_storeu_si256((__m256i *)(d + i), v);
+        _mm256_storeu_si256((__m256i *)(d + i + 32), v);
+        _mm256_storeu_si256((__m256i *)(d + i + 64), v);
+        _mm256_storeu_si256((__m256i *)(d + i + 96), v);
+    }
+    for (; i + 32 <= n; i += 32) {
+        _mm256_storeu_si256((__m256i *)(d + i), v);
+    }
+    _mm256_storeu_si256((__m256i *)(d + n - 32), v);
+    return dest;
+}
+
+const rosetta_string_kernels_t rosetta_string_kernels_avx2 = {
+    .strlen_fn = avx2_strlen,
+    .strcmp_fn = avx2_strcmp,
+    .memchr_fn = avx2_memchr,
+    .memcmp_fn = avx2_memcmp,
+    .memcpy_fn = avx2_memcpy,
+    .memset_fn = avx2_memset,
+};
+
+#endif /* __x86_64__ */
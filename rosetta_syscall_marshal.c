@@ -0,0 +1,215 @@
+/* ============================================================================
+ * Rosetta Translator - Syscall Structure Marshalling
+ * ============================================================================
+ *
+ * Guest <-> host conversion of the structures the syscall handlers pass
+ * through. pollfd and fd_set share one layout on all Linux targets and are
+ * never converted.
+ * ============================================================================ */
+
+#include "rosetta_syscall_marshal.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* ============================================================================
+ * Per-thread Scratch Buffers
+ * ============================================================================ */
+
+typedef struct {
+    void *buf;
+    size_t size;
+} marshal_scratch_t;
+
+static _Thread_local marshal_scratch_t tls_scratch[ROSETTA_SCRATCH_COUNT];
+
+void *rosetta_marshal_scratch(rosetta_scratch_slot_t slot, size_t size)
+{
+    marshal_scratch_t *s;
+
+    if ((unsigned)slot >= ROSETTA_SCRATCH_COUNT) {
+        return NULL;
+    }
+
+    s = &tls_scratch[slot];
+    if (size > s->size) {
+        /* Grow geometrically; buffers are never shrunk */
+        size_t new_size = s->size ? s->size : 256;
+        void *p;
+
+        while (new_size < size) {
+            new_size *= 2;
+        }
+        p = realloc(s->buf, new_size);
+        if (p == NULL) {
+            return NULL;
+        }
+        s->buf = p;
+        s->size = new_size;
+    }
+
+    return s->buf;
+}
+
+void rosetta_marshal_thread_cleanup(void)
+{
+    int i;
+
+    for (i = 0; i < ROSETTA_SCRATCH_COUNT; i++) {
+        free(tls_scratch[i].buf);
+        tls_scratch[i].buf = NULL;
+        tls_scratch[i].size = 0;
+    }
+}
+
+/* ============================================================================
+ * epoll
+ * ============================================================================ */
+
+#ifdef __linux__
+
+struct epoll_event *rosetta_marshal_epoll_event_in(const void *guest,
+                                                   struct epoll_event *host)
+{
+    const x86_64_epoll_event_t *g = (const x86_64_epoll_event_t *)guest;
+
+    if (ROSETTA_MARSHAL_EPOLL_IDENTITY || g == NULL) {
+        return (struct epoll_event *)guest;
+    }
+
+    host->events = g->events;
+    host->data.u64 = g->data;
+    return host;
+}
+
+struct epoll_event *rosetta_marshal_epoll_events_buf(void *guest, int maxevents)
+{
+    if (ROSETTA_MARSHAL_EPOLL_IDENTITY || maxevents <= 0) {
+        return (struct epoll_event *)guest;
+    }
+
+    return (struct epoll_event *)rosetta_marshal_scratch(
+        ROSETTA_SCRATCH_EVENTS, (size_t)maxevents * sizeof(struct epoll_event));
+}
+
+void rosetta_marshal_epoll_events_out(void *guest, const struct epoll_event *host,
+                                      int count)
+{
+    x86_64_epoll_event_t *g = (x86_64_epoll_event_t *)guest;
+    int i;
+
+    if ((const void *)host == guest) {
+        return;
+    }
+
+    for (i = 0; i < count; i++) {
+        g[i].events = host[i].events;
+        g[i].data = host[i].data.u64;
+    }
+}
+
+#endif /* __linux__ */
+
+/* ============================================================================
+ * stat
+ * ============================================================================ */
+
+struct stat *rosetta_marshal_stat_buf(void *guest)
+{
+    if (ROSETTA_MARSHAL_STAT_IDENTITY || guest == NULL) {
+        return (struct stat *)guest;    /* NULL makes the host call fail with EFAULT */
+    }
+
+    return (struct stat *)rosetta_marshal_scratch(ROSETTA_SCRATCH_MISC,
+                                                  sizeof(struct stat));
+}
+
+void rosetta_marshal_stat_out(void *guest, const struct stat *host)
+{
+    x86_64_stat_t *g = (x86_64_stat_t *)guest;
+
+    if ((const void *)host == guest || host == NULL || guest == NULL) {
+        return;
+    }
+
+    memset(g, 0, sizeof(*g));
+    g->st_dev = host->st_dev;
+    g->st_ino = host->st_ino;
+    g->st_nlink = host->st_nlink;
+    g->st_mode = host->st_mode;
+    g->st_uid = host->st_uid;
+    g->st_gid = host->st_gid;
+    g->st_rdev = host->st_rdev;
+    g->st_size = host->st_size;
+    g->st_blksize = host->st_blksize;
+    g->st_blocks = host->st_blocks;
+    g->st_atime_sec = host->st_atim.tv_sec;
+    g->st_atime_nsec = host->st_atim.tv_nsec;
+    g->st_mtime_sec = host->st_mtim.tv_sec;
+    g->st_mtime_nsec = host->st_mtim.tv_nsec;
+    g->st_ctime_sec = host->st_ctim.tv_sec;
+    g->st_ctime_nsec = host->st_ctim.tv_nsec;
+}
+
+/* ============================================================================
+ * sigaction
+ * ============================================================================ */
+
+void rosetta_marshal_sigaction_in(const void *guest, struct sigaction *host)
+{
+    const x86_64_sigaction_t *g = (const x86_64_sigaction_t *)guest;
+    int sig;
+
+    memset(host, 0, sizeof(*host));
+    host->sa_handler = (void (*)(int))(uintptr_t)g->handler;
+    /* The host libc supplies its own restorer (SA_RESTORER = 0x04000000) */
+    host->sa_flags = (int)(g->flags & ~0x04000000ULL);
+    sigemptyset(&host->sa_mask);
+    for (sig = 1; sig <= 64; sig++) {
+        if (g->mask & (1ULL << (sig - 1))) {
+            sigaddset(&host->sa_mask, sig);
+        }
+    }
+}
+
+void rosetta_marshal_sigaction_out(void *guest, const struct sigaction *host)
+{
+    x86_64_sigaction_t *g = (x86_64_sigaction_t *)guest;
+    int sig;
+
+    g->handler = (uint64_t)(uintptr_t)host->sa_handler;
+    g->flags = (uint64_t)(uint32_t)host->sa_flags;
+    g->restorer = 0;
+    g->mask = 0;
+    for (sig = 1; sig <= 64; sig++) {
+        if (sigismember(&host->sa_mask, sig) == 1) {
+            g->mask |= 1ULL << (sig - 1);
+        }
+    }
+}
+
+/* ============================================================================
+ * iovec
+ * ============================================================================ */
+
+struct iovec *rosetta_marshal_iovec_in(const void *guest, int iovcnt)
+{
+    const x86_64_iovec_t *g = (const x86_64_iovec_t *)guest;
+    struct iovec *host;
+    int i;
+
+    if (ROSETTA_MARSHAL_IOVEC_IDENTITY || iovcnt <= 0) {
+        return (struct iovec *)guest;
+    }
+
+    host = (struct iovec *)rosetta_marshal_scratch(ROSETTA_SCRATCH_IOVEC,
+                                                   (size_t)iovcnt * sizeof(struct iovec));
+    if (host == NULL) {
+        return NULL;
+    }
+
+    for (i = 0; i < iovcnt; i++) {
+        host[i].iov_base = (void *)(uintptr_t)g[i].iov_base;
+        host[i].iov_len = (size_t)g[i].iov_len;
+    }
+    return host;
+}
@@ -0,0 +1,187 @@
+/* ============================================================================
+ * Rosetta Translator - Syscall Structure Marshalling Header
+ * ============================================================================
+ *
+ * Converts syscall structures between the x86_64 guest layout and the host
+ * layout. When both layouts are identical the guest buffer is handed to the
+ * host directly (zero-copy); otherwise the data is staged in per-thread
+ * scratch buffers that grow on demand and are reused, so steady-state event
+ * loops never allocate.
+ * ============================================================================ */
+
+#ifndef ROSETTA_SYSCALL_MARSHAL_H
+#define ROSETTA_SYSCALL_MARSHAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif
+
+/* ============================================================================
+ * x86_64 Guest Layouts (Linux kernel ABI)
+ * ============================================================================ */
+
+/* struct epoll_event - packed on x86_64 only (12 bytes) */
+typedef struct __attribute__((packed)) {
+    uint32_t events;
+    uint64_t data;
+} x86_64_epoll_event_t;
+
+/* struct stat - x86_64 kernel layout (144 bytes) */
+typedef struct {
+    uint64_t st_dev;
+    uint64_t st_ino;
+    uint64_t st_nlink;
+    uint32_t st_mode;
+    uint32_t st_uid;
+    uint32_t st_gid;
+    uint32_t __pad0;
+    uint64_t st_rdev;
+    int64_t  st_size;
+    int64_t  st_blksize;
+    int64_t  st_blocks;
+    uint64_t st_atime_sec;
+    uint64_t st_atime_nsec;
+    uint64_t st_mtime_sec;
+    uint64_t st_mtime_nsec;
+    uint64_t st_ctime_sec;
+    uint64_t st_ctime_nsec;
+    int64_t  __unused[3];
+} x86_64_stat_t;
+
+/* struct sigaction - x86_64 rt_sigaction kernel layout */
+typedef struct {
+    uint64_t handler;               /* Field names avoid the libc sa_* macros */
+    uint64_t flags;
+    uint64_t restorer;
+    uint64_t mask;                  /* sigsetsize == 8 */
+} x86_64_sigaction_t;
+
+/* struct iovec - same on every LP64 target */
+typedef struct {
+    uint64_t iov_base;
+    uint64_t iov_len;
+} x86_64_iovec_t;
+
+/* Layouts that need no conversion on this host */
+#if defined(__x86_64__)
+#define ROSETTA_MARSHAL_EPOLL_IDENTITY  1
+#define ROSETTA_MARSHAL_STAT_IDENTITY   1
+#else
+#define ROSETTA_MARSHAL_EPOLL_IDENTITY  0
+#define ROSETTA_MARSHAL_STAT_IDENTITY   0
+#endif
+#define ROSETTA_MARSHAL_IOVEC_IDENTITY  (sizeof(struct iovec) == sizeof(x86_64_iovec_t))
+
+/* ============================================================================
+ * Per-thread Scratch Buffers
+ * ============================================================================ */
+
+/* Independent scratch slots so one syscall can stage several structures */
+typedef enum {
+    ROSETTA_SCRATCH_EVENTS = 0,     /* epoll_event arrays */
+    ROSETTA_SCRATCH_IOVEC,          /* iovec arrays */
+    ROSETTA_SCRATCH_MISC,           /* Single structures */
+    ROSETTA_SCRATCH_ARGV,           /* execve argv vector */
+    ROSETTA_SCRATCH_ENVP,           /* execve envp vector */
+    ROSETTA_SCRATCH_COUNT
+} rosetta_scratch_slot_t;
+
+/**
+ * Get a per-thread scratch buffer of at least size bytes
+ * @param slot Scratch slot
+ * @param size Required size
+ * @return Buffer (valid until the next call for the same slot), or NULL
+ */
+void *rosetta_marshal_scratch(rosetta_scratch_slot_t slot, size_t size);
+
+/**
+ * Release the calling thread's scratch buffers
+ */
+void rosetta_marshal_thread_cleanup(void);
+
+/* ============================================================================
+ * epoll
+ * ============================================================================ */
+
+#ifdef __linux__
+/**
+ * Convert one guest epoll_event for epoll_ctl
+ * @param guest Guest event (may be NULL for EPOLL_CTL_DEL)
+ * @param host Host event storage
+ * @return Pointer to pass to the host (guest pointer when layouts match)
+ */
+struct epoll_event *rosetta_marshal_epoll_event_in(const void *guest,
+                                                   struct epoll_event *host);
+
+/**
+ * Get the host buffer to receive epoll_wait results
+ * @param guest Guest event array
+ * @param maxevents Capacity of the guest array
+ * @return Host event array (guest array when layouts match), or NULL
+ */
+struct epoll_event *rosetta_marshal_epoll_events_buf(void *guest, int maxevents);
+
+/**
+ * Copy epoll_wait results back to the guest array
+ * @param guest Guest event array
+ * @param host Host array from rosetta_marshal_epoll_events_buf()
+ * @param count Number of ready events
+ */
+void rosetta_marshal_epoll_events_out(void *guest, const struct epoll_event *host,
+                                      int count);
+#endif
+
+/* ============================================================================
+ * stat
+ * ============================================================================ */
+
+/**
+ * Get the host struct stat to pass to stat()/fstat()/...
+ * @param guest Guest x86_64_stat_t buffer
+ * @return Host buffer (guest buffer when layouts match)
+ */
+struct stat *rosetta_marshal_stat_buf(void *guest);
+
+/**
+ * Copy a host struct stat back to the guest layout
+ * @param guest Guest x86_64_stat_t buffer
+ * @param host Host buffer from rosetta_marshal_stat_buf()
+ */
+void rosetta_marshal_stat_out(void *guest, const struct stat *host);
+
+/* ============================================================================
+ * sigaction
+ * ============================================================================ */
+
+/**
+ * Convert a guest rt_sigaction structure to the host libc layout
+ * @param guest Guest x86_64_sigaction_t
+ * @param host Output host sigaction
+ */
+void rosetta_marshal_sigaction_in(const void *guest, struct sigaction *host);
+
+/**
+ * Convert a host sigaction to the guest rt_sigaction layout
+ * @param guest Output guest x86_64_sigaction_t
+ * @param host Host sigaction
+ */
+void rosetta_marshal_sigaction_out(void *guest, const struct sigaction *host);
+
+/* ============================================================================
+ * iovec
+ * ============================================================================ */
+
+/**
+ * Get a host iovec array for a guest iovec array
+ * @param guest Guest x86_64_iovec_t array
+ * @param iovcnt Number of entries
+ * @return Host iovec array (guest array when layouts match), or NULL
+ */
+struct iovec *rosetta_marshal_iovec_in(const void *guest, int iovcnt);
+
+#endif /* ROSETTA_SYSCALL_MARSHAL_H */
@@ -0,0 +1,448 @@
+/* ============================================================================
+ * Rosetta Translator - io_uring Syscall Backend
+ * ============================================================================
+ *
+ * Per-thread io_uring used for batches when the backend is enabled. The ring is driven with raw io_uring_setup/io_uring_enter so no
+ * liburing dependency is needed. Anything that cannot go through the ring
+ * is issued as the equivalent plain syscall.
+ * ============================================================================ */
+
+#include "rosetta_syscall_uring.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include <sys/socket.h>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#define ROSETTA_HAVE_URING 1
+#endif
+
+/* ============================================================================
+ * Backend State
+ * ============================================================================ */
+
+typedef enum {
+    URING_STATE_NONE = 0,           /* Ring not yet set up */
+    URING_STATE_READY,              /* Ring usable */
+    URING_STATE_UNAVAILABLE         /* Setup failed - plain syscalls only */
+} uring_state_t;
+
+typedef struct {
+    uring_state_t state;
+    rosetta_uring_stats_t stats;
+#ifdef ROSETTA_HAVE_URING
+    int ring_fd;
+    unsigned sq_entries;
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void *sq_map;
+    size_t sq_map_size;
+    void *cq_map;
+    size_t cq_map_size;
+    size_t sqes_size;
+    uint64_t next_tag;              /* user_data of the next SQE, never reused */
+#endif
+} uring_thread_t;
+
+/* -1: not yet decided, 0: disabled, 1: enabled */
+static int g_uring_enabled = -1;
+
+static _Thread_local uring_thread_t tls_uring;
+
+/* ============================================================================
+ * Plain Syscall Fallback
+ * ============================================================================ */
+
+static int64_t uring_perform_plain(rosetta_uring_op_t *op)
+{
+    ssize_t ret;
+
+    switch (op->opcode) {
+        case ROSETTA_URING_OP_READ:
+            ret = (op->offset == ROSETTA_URING_CUR_POS)
+                ? read(op->fd, op->buf, op->len)
+                : pread(op->fd, op->buf, op->len, (off_t)op->offset);
+            break;
+        case ROSETTA_URING_OP_WRITE:
+            ret = (op->offset == ROSETTA_URING_CUR_POS)
+                ? write(op->fd, op->buf, op->len)
+                : pwrite(op->fd, op->buf, op->len, (off_t)op->offset);
+            break;
+        case ROSETTA_URING_OP_READV:
+            ret = readv(op->fd, (const struct iovec *)op->buf, (int)op->len);
+            break;
+        case ROSETTA_URING_OP_WRITEV:
+            ret = writev(op->fd, (const struct iovec *)op->buf, (int)op->len);
+            break;
+        case ROSETTA_URING_OP_SEND:
+            ret = send(op->fd, op->buf, op->len, op->flags);
+            break;
+        case ROSETTA_URING_OP_RECV:
+            ret = recv(op->fd, op->buf, op->len, op->flags);
+            break;
+        default:
+            errno = EINVAL;
+            ret = -1;
+            break;
+    }
+
+    op->result = (ret < 0) ? -errno : (int64_t)ret;
+    tls_uring.stats.fallbacks++;
+    return op->result;
+}
+
+/* ============================================================================
+ * Ring Setup
+ * ============================================================================ */
+
+#ifdef ROSETTA_HAVE_URING
+
+static int uring_setup(uring_thread_t *u)
+{
+    struct io_uring_params p;
+    void *sq_map;
+    void *cq_map;
+    void *sqes;
+    size_t sq_size, cq_size;
+    int fd;
+
+    memset(&p, 0, sizeof(p));
+    fd = (int)syscall(__NR_io_uring_setup, ROSETTA_URING_DEPTH, &p);
+    if (fd < 0) {
+        return -1;
+    }
+
+    sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+
+    /* Newer kernels map both rings with one mmap */
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        if (cq_size > sq_size) {
+            sq_size = cq_size;
+        }
+        cq_size = sq_size;
+    }
+
+    sq_map = mmap(NULL, sq_size, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (sq_map == MAP_FAILED) {
+        close(fd);
+        return -1;
+    }
+
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        cq_map = sq_map;
+    } else {
+        cq_map = mmap(NULL, cq_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (cq_map == MAP_FAILED) {
+            munmap(sq_map, sq_size);
+            close(fd);
+            return -1;
+        }
+    }
+
+    sqes = mmap(NULL, p.sq_entries * sizeof(struct io_uring_sqe),
+                PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        if (cq_map != sq_map) {
+            munmap(cq_map, cq_size);
+        }
+        munmap(sq_map, sq_size);
+        close(fd);
+        return -1;
+    }
+
+    u->ring_fd = fd;
+    u->sq_entries = p.sq_entries;
+    u->sq_head = (unsigned *)((char *)sq_map + p.sq_off.head);
+    u->sq_tail = (unsigned *)((char *)sq_map + p.sq_off.tail);
+    u->sq_mask = (unsigned *)((char *)sq_map + p.sq_off.ring_mask);
+    u->sq_array = (unsigned *)((char *)sq_map + p.sq_off.array);
+    u->cq_head = (unsigned *)((char *)cq_map + p.cq_off.head);
+    u->cq_tail = (unsigned *)((char *)cq_map + p.cq_off.tail);
+    u->cq_mask = (unsigned *)((char *)cq_map + p.cq_off.ring_mask);
+    u->cqes = (struct io_uring_cqe *)((char *)cq_map + p.cq_off.cqes);
+    u->sqes = (struct io_uring_sqe *)sqes;
+    u->sq_map = sq_map;
+    u->sq_map_size = sq_size;
+    u->cq_map = cq_map;
+    u->cq_map_size = cq_size;
+    u->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+
+    return 0;
+}
+
+static void uring_fill_sqe(struct io_uring_sqe *sqe, const rosetta_uring_op_t *op,
+                           uint64_t user_data)
+{
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->fd = op->fd;
+    sqe->addr = (uint64_t)(uintptr_t)op->buf;
+    sqe->len = op->len;
+    sqe->off = (uint64_t)op->offset;    /* -1 selects the file position */
+    sqe->user_data = user_data;
+
+    switch (op->opcode) {
+        case ROSETTA_URING_OP_READ:   sqe->opcode = IORING_OP_READ;   break;
+        case ROSETTA_URING_OP_WRITE:  sqe->opcode = IORING_OP_WRITE;  break;
+        case ROSETTA_URING_OP_READV:  sqe->opcode = IORING_OP_READV;  break;
+        case ROSETTA_URING_OP_WRITEV: sqe->opcode = IORING_OP_WRITEV; break;
+        case ROSETTA_URING_OP_SEND:
+            sqe->opcode = IORING_OP_SEND;
+            sqe->msg_flags = (uint32_t)op->flags;
+            sqe->off = 0;
+            break;
+        case ROSETTA_URING_OP_RECV:
+            sqe->opcode = IORING_OP_RECV;
+            sqe->msg_flags = (uint32_t)op->flags;
+            sqe->off = 0;
+            break;
+        default:
+            sqe->opcode = IORING_OP_NOP;
+            break;
+    }
+}
+
+static int uring_is_write(const rosetta_uring_op_t *op)
+{
+    return op->opcode == ROSETTA_URING_OP_WRITE || op->opcode == ROSETTA_URING_OP_WRITEV ||
+           op->opcode == ROSETTA_URING_OP_SEND;
+}
+
+/**
+ * Must b complete after a? Ops on one fd are ordered when either uses
+ * the stream position or either writes: a pread after a pwrite to the
+ * same offset must see the new data, whatever offsets they name.
+ */
+static int uring_is_ordered(const rosetta_uring_op_t *a, const rosetta_uring_op_t *b)
+{
+    return a->fd == b->fd &&
+           (a->offset == ROSETTA_URING_CUR_POS || b->offset == ROSETTA_URING_CUR_POS ||
+            a->opcode >= ROSETTA_URING_OP_READV || b->opcode >= ROSETTA_URING_OP_READV ||
+            uring_is_write(a) || uring_is_write(b));
+}
+
+/**
+ * Submit ops[0..count) as one io_uring_enter and reap every completion
+ * @return count, or -EINTR if a signal interrupted the wait
+ *
+ * Each SQE is tagged with a per-thread sequence number, so completions of
+ * an interrupted batch that arrive later are recognised and dropped
+ * instead of being credited to a later batch.
+ */
+static int uring_submit_chunk(uring_thread_t *u, rosetta_uring_op_t *ops, int count)
+{
+    unsigned tail = *u->sq_tail;
+    unsigned mask = *u->sq_mask;
+    uint64_t base = u->next_tag;
+    unsigned to_submit = (unsigned)count;
+    int completed = 0;
+    int err = 0;
+    int i;
+
+    for (i = 0; i < count; i++) {
+        unsigned idx = tail & mask;
+        struct io_uring_sqe *sqe = &u->sqes[idx];
+
+        uring_fill_sqe(sqe, &ops[i], base + (uint64_t)i);
+
+        /* Keep stream-ordered ops on the same fd in submission order */
+        if (i + 1 < count && uring_is_ordered(&ops[i], &ops[i + 1])) {
+            sqe->flags |= IOSQE_IO_LINK;
+        }
+
+        u->sq_array[idx] = idx;
+        ops[i].result = -ECANCELED;
+        tail++;
+    }
+    u->next_tag = base + (uint64_t)count;
+    __atomic_store_n(u->sq_tail, tail, __ATOMIC_RELEASE);
+
+    /* Submit everything and wait for all of it in a single enter */
+    while (completed < count) {
+        unsigned head, cq_tail;
+        long ret = syscall(__NR_io_uring_enter, u->ring_fd, to_submit,
+                           (unsigned)(count - completed),
+                           IORING_ENTER_GETEVENTS, NULL, 0);
+        if (ret < 0) {
+            err = -errno;
+            break;
+        }
+        to_submit -= (unsigned)ret < to_submit ? (unsigned)ret : to_submit;
+
+        head = *u->cq_head;
+        cq_tail = __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE);
+        while (head != cq_tail) {
+            struct io_uring_cqe *cqe = &u->cqes[head & *u->cq_mask];
+            if (cqe->user_data >= base && cqe->user_data - base < (uint64_t)count) {
+                ops[cqe->user_data - base].result = cqe->res;
+                completed++;
+            }
+            head++;
+        }
+        __atomic_store_n(u->cq_head, head, __ATOMIC_RELEASE);
+    }
+    u->stats.batches++;
+
+    if (err != 0) {
+        /* Take back the SQEs the kernel has not consumed: those ops never
+         * started. The ones in flight cannot be recalled; their results are
+         * lost and their late completions are dropped by tag. */
+        unsigned sq_head = __atomic_load_n(u->sq_head, __ATOMIC_ACQUIRE);
+        int started = count - (int)(tail - sq_head);
+
+        __atomic_store_n(u->sq_tail, sq_head, __ATOMIC_RELEASE);
+        for (i = 0; i < count; i++) {
+            if (ops[i].result != -ECANCELED) {
+                u->stats.ops++;
+            } else if (i < started || err == -EINTR) {
+                ops[i].result = err;
+            } else {
+                uring_perform_plain(&ops[i]);
+            }
+        }
+        /* Deliver the signal; the guest restarts or sees EINTR */
+        return err == -EINTR ? -EINTR : count;
+    }
+
+    /* Broken links and unsupported opcodes are retried in order */
+    for (i = 0; i < count; i++) {
+        if (ops[i].result == -ECANCELED || ops[i].result == -EINVAL ||
+            ops[i].result == -EOPNOTSUPP) {
+            uring_perform_plain(&ops[i]);
+        } else {
+            u->stats.ops++;
+        }
+    }
+
+    return count;
+}
+
+#endif /* ROSETTA_HAVE_URING */
+
+/* ============================================================================
+ * Backend Control
+ * ============================================================================ */
+
+void rosetta_uring_set_enabled(bool enable)
+{
+    g_uring_enabled = enable ? 1 : 0;
+}
+
+bool rosetta_uring_enabled(void)
+{
+    if (g_uring_enabled < 0) {
+        const char *env = getenv(ROSETTA_URING_ENV);
+        g_uring_enabled = (env != NULL && atoi(env) != 0) ? 1 : 0;
+    }
+    return g_uring_enabled == 1;
+}
+
+bool rosetta_uring_available(void)
+{
+    uring_thread_t *u = &tls_uring;
+
+    if (u->state == URING_STATE_NONE) {
+#ifdef ROSETTA_HAVE_URING
+        u->state = (uring_setup(u) == 0) ? URING_STATE_READY : URING_STATE_UNAVAILABLE;
+#else
+        u->state = URING_STATE_UNAVAILABLE;
+#endif
+    }
+
+    return u->state == URING_STATE_READY;
+}
+
+void rosetta_uring_thread_cleanup(void)
+{
+    uring_thread_t *u = &tls_uring;
+
+#ifdef ROSETTA_HAVE_URING
+    if (u->state == URING_STATE_READY) {
+        munmap(u->sqes, u->sqes_size);
+        if (u->cq_map != u->sq_map) {
+            munmap(u->cq_map, u->cq_map_size);
+        }
+        munmap(u->sq_map, u->sq_map_size);
+        close(u->ring_fd);
+    }
+#endif
+
+    memset(u, 0, sizeof(*u));
+}
+
+void rosetta_uring_get_stats(rosetta_uring_stats_t *stats)
+{
+    if (stats) {
+        *stats = tls_uring.stats;
+    }
+}
+
+/* ============================================================================
+ * Submission
+ * ============================================================================ */
+
+int rosetta_uring_submit(rosetta_uring_op_t *ops, int count)
+{
+    int i;
+
+    if (ops == NULL || count < 0) {
+        return -EINVAL;
+    }
+
+    /* A lone operation costs one io_uring_enter either way, so it is
+     * cheaper as the plain syscall */
+    if (count < 2 || !rosetta_uring_enabled() || !rosetta_uring_available()) {
+        for (i = 0; i < count; i++) {
+            uring_perform_plain(&ops[i]);
+        }
+        return count;
+    }
+
+#ifdef ROSETTA_HAVE_URING
+    {
+        uring_thread_t *u = &tls_uring;
+        int start = 0;
+
+        /* Split where a stream-ordered op is not adjacent to its predecessor,
+         * since only adjacent SQEs can be linked. */
+        for (i = 1; i <= count; i++) {
+            int split = (i == count) || (i - start >= (int)u->sq_entries);
+            int j;
+
+            for (j = start; !split && j < i - 1; j++) {
+                if (uring_is_ordered(&ops[j], &ops[i])) {
+                    split = 1;
+                }
+            }
+
+            if (split) {
+                if (uring_submit_chunk(u, &ops[start], i - start) == -EINTR) {
+                    for (j = i; j < count; j++) {
+                        ops[j].result = -EINTR;
+                    }
+                    return -EINTR;
+                }
+                start = i;
+            }
+        }
+    }
+#endif
+
+    return count;
+}
+
@@ -0,0 +1,122 @@
+/* ============================================================================
+ * Rosetta Translator - io_uring Syscall Backend Header
+ * ============================================================================
+ *
+ * Opt-in backend that submits a batch of read/write-style operations
+ * through a per-thread io_uring with a single io_uring_enter(). The guest
+ * syscall handlers do not use it: a dispatcher exit carries one syscall,
+ * and one operation through the ring costs more than the plain syscall,
+ * so guest I/O is always passthrough. rosetta_uring_submit() uses the
+ * ring only when the backend is enabled and the batch has two or more
+ * operations. When io_uring is unavailable (non-Linux host, old kernel,
+ * seccomp) it falls back to plain syscalls.
+ * ============================================================================ */
+
+#ifndef ROSETTA_SYSCALL_URING_H
+#define ROSETTA_SYSCALL_URING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/* ============================================================================
+ * Configuration
+ * ============================================================================ */
+
+/* Submission queue depth of each per-thread ring */
+#define ROSETTA_URING_DEPTH         64
+
+/* Maximum operations in one batch (one io_uring_enter) */
+#define ROSETTA_URING_MAX_BATCH     ROSETTA_URING_DEPTH
+
+/* Environment variable that opts in at startup ("1" enables) */
+#define ROSETTA_URING_ENV           "ROSETTA_IO_URING"
+
+/* ============================================================================
+ * Operation Descriptor
+ * ============================================================================ */
+
+typedef enum {
+    ROSETTA_URING_OP_READ = 0,      /* read / pread64 */
+    ROSETTA_URING_OP_WRITE,         /* write / pwrite64 */
+    ROSETTA_URING_OP_READV,         /* readv */
+    ROSETTA_URING_OP_WRITEV,        /* writev */
+    ROSETTA_URING_OP_SEND,          /* sendto without destination */
+    ROSETTA_URING_OP_RECV           /* recvfrom without source */
+} rosetta_uring_opcode_t;
+
+/* Use the current file position instead of an explicit offset */
+#define ROSETTA_URING_CUR_POS       ((int64_t)-1)
+
+typedef struct {
+    uint8_t opcode;                 /* rosetta_uring_opcode_t */
+    int fd;                         /* Target file descriptor */
+    void *buf;                      /* Buffer or struct iovec array */
+    uint32_t len;                   /* Byte count or iovec count */
+    int64_t offset;                 /* File offset or ROSETTA_URING_CUR_POS */
+    int flags;                      /* MSG_* flags for send/recv */
+    int64_t result;                 /* Output: bytes transferred or -errno */
+} rosetta_uring_op_t;
+
+/* Backend statistics (per thread) */
+typedef struct {
+    uint64_t ops;                   /* Operations completed through the ring */
+    uint64_t batches;               /* io_uring_enter() calls issued */
+    uint64_t fallbacks;             /* Operations issued as plain syscalls */
+} rosetta_uring_stats_t;
+
+/* ============================================================================
+ * Backend Control
+ * ============================================================================ */
+
+/**
+ * Enable or disable the io_uring backend (process wide)
+ * @param enable true to submit batches through io_uring
+ */
+void rosetta_uring_set_enabled(bool enable);
+
+/**
+ * Check whether the backend is enabled
+ * @return true if enabled (via API or ROSETTA_IO_URING=1)
+ */
+bool rosetta_uring_enabled(void);
+
+/**
+ * Check whether the calling thread has a working ring
+ * @return true if io_uring is usable on this thread
+ *
+ * Sets up the per-thread ring on first call.
+ */
+bool rosetta_uring_available(void);
+
+/**
+ * Tear down the calling thread's ring
+ */
+void rosetta_uring_thread_cleanup(void);
+
+/**
+ * Get the calling thread's backend statistics
+ * @param stats Output statistics
+ */
+void rosetta_uring_get_stats(rosetta_uring_stats_t *stats);
+
+/* ============================================================================
+ * Submission
+ * ============================================================================ */
+
+/**
+ * Submit a batch of operations and wait for all completions
+ * @param ops Operations; result fields are filled in
+ * @param count Number of operations
+ * @return count, -EINVAL for bad arguments, or -EINTR if a signal arrived
+ *
+ * Operations on the same descriptor are linked so that they complete in
+ * submission order when either uses the file position or either writes;
+ * other operations run concurrently. Falls back to sequential plain
+ * syscalls if the backend is disabled, the ring is unavailable or there
+ * is only one operation. After -EINTR, operations that did not complete
+ * have result -EINTR.
+ */
+int rosetta_uring_submit(rosetta_uring_op_t *ops, int count);
+
+#endif /* ROSETTA_SYSCALL_URING_H */
@@ -27,7 +27,7 @@
  *    - Same order, different registers (handled by ThreadState)
  *
  * 3. Syscall Dispatch
- *    - Lookup handler in syscall table
+ *    - Lookup handler in the dense, directly indexed dispatch table
  *    - Invoke platform-specific implementation
  *    - Return results in guest state
  *
@@ -57,6 +57,7 @@
 
 #include "rosetta_syscalls.h"
 #include "rosetta_types.h"
+#include "rosetta_syscall_marshal.h"
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/mman.h>
@@ -76,6 +77,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
+#include <pthread.h>
 #ifdef __linux__
 #include <sys/epoll.h>
 #include <sys/prctl.h>
@@ -96,131 +99,197 @@
  * Syscall Number Mapping Table
  * ============================================================================ */
 
+/* Shorthand for argument kinds and flags in the table below */
+#define A_SC    SYSCALL_ARG_SCALAR
+#define A_IN    SYSCALL_ARG_PTR_IN
+#define A_OUT   SYSCALL_ARG_PTR_OUT
+#define A_IO    SYSCALL_ARG_PTR_INOUT
+#define A_PATH  SYSCALL_ARG_PATH
+#define A_IOV   SYSCALL_ARG_IOVEC
+#define A_ADDR  SYSCALL_ARG_ADDR
+#define A_MEM   SYSCALL_ARG_MEM
+
+#define F_BLK   SYSCALL_FLAG_BLOCKING
+#define F_PASS  SYSCALL_FLAG_PASSTHROUGH
+#define F_NORET SYSCALL_FLAG_NORETURN
+#define F_RADDR SYSCALL_FLAG_RET_ADDR
+
+/* Guest range sizes: byte count from an argument, or count times element */
+#define S_LEN(idx)          SYSCALL_SIZE_ARG(idx, 1)
+#define S_CNT(idx, elem)    SYSCALL_SIZE_ARG(idx, elem)
+
+/* x86_64 guest structure sizes */
+#define G_STAT          sizeof(x86_64_stat_t)
+#define G_SIGACTION     sizeof(x86_64_sigaction_t)
+#define G_EPOLL_EVENT   sizeof(x86_64_epoll_event_t)
+#define G_IOVEC         sizeof(x86_64_iovec_t)
+#define G_TIMESPEC      16
+#define G_TIMEVAL       16
+#define G_UTSNAME       390
+#define G_RUSAGE        144
+#define G_RLIMIT        16
+#define G_SIGSET        8
+#define G_POLLFD        8
+#define G_FDSET         128
+
 /* SyscallEntry: maps x86_64 guest syscall to ARM64 host syscall */
 typedef struct {
     int x86_64_nr;        /* x86_64 syscall number (guest) */
     int arm64_nr;         /* ARM64 syscall number (host) */
     syscall_handler_t handler;
+    const char *name;
+    uint8_t flags;
+    uint8_t args[SYSCALL_MAX_ARGS];
+    uint16_t sizes[SYSCALL_MAX_ARGS];
 } SyscallEntryLocal;
 
 static const SyscallEntryLocal syscall_table[] = {
     /* Basic I/O */
-    {X86_64_SYS_READ,         ARM64_SYS_READ,         syscall_read},
-    {X86_64_SYS_WRITE,        ARM64_SYS_WRITE,        syscall_write},
-    {X86_64_SYS_OPEN,         ARM64_SYS_OPEN,         syscall_open},
-    {X86_64_SYS_CLOSE,        ARM64_SYS_CLOSE,        syscall_close},
-    {X86_64_SYS_LSEEK,        ARM64_SYS_LSEEK,        syscall_lseek},
-    {X86_64_SYS_ACCESS,       ARM64_SYS_ACCESS,       syscall_access},
-    {X86_64_SYS_PIPE,         ARM64_SYS_PIPE,         syscall_pipe},
-    {X86_64_SYS_DUP2,         ARM64_SYS_DUP2,         syscall_dup2},
-    {X86_64_SYS_DUP3,         ARM64_SYS_DUP3,         syscall_dup3},
+    {X86_64_SYS_READ,         ARM64_SYS_READ,         syscall_read,         "read",         F_BLK | F_PASS, {A_SC, A_OUT, A_SC}, {0, S_LEN(2)}},
+    {X86_64_SYS_WRITE,        ARM64_SYS_WRITE,        syscall_write,        "write",        F_BLK | F_PASS, {A_SC, A_IN, A_SC}, {0, S_LEN(2)}},
+    {X86_64_SYS_OPEN,         ARM64_SYS_OPEN,         syscall_open,         "open",         F_BLK | F_PASS, {A_PATH, A_SC, A_SC}, {0}},
+    {X86_64_SYS_CLOSE,        ARM64_SYS_CLOSE,        syscall_close,        "close",        F_PASS,         {A_SC}, {0}},
+    {X86_64_SYS_PREAD64,      ARM64_SYS_PREAD64,      syscall_pread64,      "pread64",      F_BLK | F_PASS, {A_SC, A_OUT, A_SC, A_SC}, {0, S_LEN(2)}},
+    {X86_64_SYS_PWRITE64,     ARM64_SYS_PWRITE64,     syscall_pwrite64,     "pwrite64",     F_BLK | F_PASS, {A_SC, A_IN, A_SC, A_SC}, {0, S_LEN(2)}},
+    {X86_64_SYS_LSEEK,        ARM64_SYS_LSEEK,        syscall_lseek,        "lseek",        F_PASS,         {A_SC, A_SC, A_SC}, {0}},
+    {X86_64_SYS_ACCESS,       ARM64_SYS_ACCESS,       syscall_access,       "access",       F_PASS,         {A_PATH, A_SC}, {0}},
+    {X86_64_SYS_PIPE,         ARM64_SYS_PIPE,         syscall_pipe,         "pipe",         F_PASS,         {A_OUT}, {2 * 4}},
+    {X86_64_SYS_DUP2,         ARM64_SYS_DUP2,         syscall_dup2,         "dup2",         F_PASS,         {A_SC, A_SC}, {0}},
+    {X86_64_SYS_DUP3,         ARM64_SYS_DUP3,         syscall_dup3,         "dup3",         F_PASS,         {A_SC, A_SC, A_SC}, {0}},
 
     /* Memory */
-    {X86_64_SYS_MMAP,         ARM64_SYS_MMAP,         syscall_mmap},
-    {X86_64_SYS_MUNMAP,       ARM64_SYS_MUNMAP,       syscall_munmap},
-    {X86_64_SYS_MPROTECT,     ARM64_SYS_MPROTECT,     syscall_mprotect},
-    {X86_64_SYS_BRK,          ARM64_SYS_BRK,          syscall_brk},
+    {X86_64_SYS_MMAP,         ARM64_SYS_MMAP,         syscall_mmap,         "mmap",         F_RADDR,        {A_MEM, A_SC, A_SC, A_SC, A_SC, A_SC}, {S_LEN(1)}},
+    {X86_64_SYS_MUNMAP,       ARM64_SYS_MUNMAP,       syscall_munmap,       "munmap",       0,              {A_MEM, A_SC}, {S_LEN(1)}},
+    {X86_64_SYS_MPROTECT,     ARM64_SYS_MPROTECT,     syscall_mprotect,     "mprotect",     0,              {A_MEM, A_SC, A_SC}, {S_LEN(1)}},
+    {X86_64_SYS_BRK,          ARM64_SYS_BRK,          syscall_brk,          "brk",          0,              {A_ADDR}, {0}},
 
-    /* File Status */
-    {X86_64_SYS_STAT,         ARM64_SYS_STAT,         syscall_stat},
-    {X86_64_SYS_FSTAT,        ARM64_SYS_FSTAT,        syscall_fstat},
-    {X86_64_SYS_LSTAT,        ARM64_SYS_LSTAT,        syscall_lstat},
+    /* File Status (struct stat layout differs between x86_64 and ARM64) */
+    {X86_64_SYS_STAT,         ARM64_SYS_STAT,         syscall_stat,         "stat",         0,              {A_PATH, A_OUT}, {0, G_STAT}},
+    {X86_64_SYS_FSTAT,        ARM64_SYS_FSTAT,        syscall_fstat,        "fstat",        0,              {A_SC, A_OUT}, {0, G_STAT}},
+    {X86_64_SYS_LSTAT,        ARM64_SYS_LSTAT,        syscall_lstat,        "lstat",        0,              {A_PATH, A_OUT}, {0, G_STAT}},
+    {X86_64_SYS_NEWFSTATAT,   ARM64_SYS_NEWFSTATAT,   syscall_newfstatat,   "newfstatat",   0,              {A_SC, A_PATH, A_OUT, A_SC}, {0, 0, G_STAT}},
 
     /* Process */
-    {X86_64_SYS_GETPID,       ARM64_SYS_GETPID,       syscall_getpid},
-    {X86_64_SYS_GETTID,       ARM64_SYS_GETTID,       syscall_gettid},
-    {X86_64_SYS_UNAME,        ARM64_SYS_UNAME,        syscall_uname},
-    {X86_64_SYS_FCNTL,        ARM64_SYS_FCNTL,        syscall_fcntl},
-    {X86_64_SYS_SET_TID_ADDRESS, ARM64_SYS_SET_TID_ADDRESS, syscall_set_tid_address},
-    {X86_64_SYS_EXIT,         ARM64_SYS_EXIT,         (syscall_handler_t)syscall_exit},
-    {X86_64_SYS_EXIT_GROUP,   ARM64_SYS_EXIT_GROUP,   (syscall_handler_t)syscall_exit_group},
-    {X86_64_SYS_WAIT4,        ARM64_SYS_WAIT4,        syscall_wait4},
-    {X86_64_SYS_KILL,         ARM64_SYS_KILL,         syscall_kill},
+    {X86_64_SYS_GETPID,       ARM64_SYS_GETPID,       syscall_getpid,       "getpid",       F_PASS,         {0}, {0}},
+    {X86_64_SYS_GETTID,       ARM64_SYS_GETTID,       syscall_gettid,       "gettid",       F_PASS,         {0}, {0}},
+    {X86_64_SYS_UNAME,        ARM64_SYS_UNAME,        syscall_uname,        "uname",        0,              {A_OUT}, {G_UTSNAME}},
+    {X86_64_SYS_FCNTL,        ARM64_SYS_FCNTL,        syscall_fcntl,        "fcntl",        F_BLK,          {A_SC, A_SC, A_SC}, {0}},
+    {X86_64_SYS_SET_TID_ADDRESS, ARM64_SYS_SET_TID_ADDRESS, syscall_set_tid_address, "set_tid_address", 0,  {A_IO}, {4}},
+    {X86_64_SYS_EXIT,         ARM64_SYS_EXIT,         (syscall_handler_t)syscall_exit, "exit", F_NORET,     {A_SC}, {0}},
+    {X86_64_SYS_EXIT_GROUP,   ARM64_SYS_EXIT_GROUP,   (syscall_handler_t)syscall_exit_group, "exit_group", F_NORET, {A_SC}, {0}},
+    {X86_64_SYS_WAIT4,        ARM64_SYS_WAIT4,        syscall_wait4,        "wait4",        F_BLK | F_PASS, {A_SC, A_OUT, A_SC, A_OUT}, {0, 4, 0, G_RUSAGE}},
+    {X86_64_SYS_KILL,         ARM64_SYS_KILL,         syscall_kill,         "kill",         F_PASS,         {A_SC, A_SC}, {0}},
 
     /* Time */
-    {X86_64_SYS_GETTIMEOFDAY, ARM64_SYS_GETTIMEOFDAY, syscall_gettimeofday},
-    {X86_64_SYS_CLOCK_GETTIME, ARM64_SYS_CLOCK_GETTIME, syscall_clock_gettime},
-    {X86_64_SYS_NANOSLEEP,    ARM64_SYS_NANOSLEEP,    syscall_nanosleep},
+    {X86_64_SYS_GETTIMEOFDAY, ARM64_SYS_GETTIMEOFDAY, syscall_gettimeofday, "gettimeofday", F_PASS,         {A_OUT, A_OUT}, {G_TIMEVAL, 8}},
+    {X86_64_SYS_CLOCK_GETTIME, ARM64_SYS_CLOCK_GETTIME, syscall_clock_gettime, "clock_gettime", F_PASS,     {A_SC, A_OUT}, {0, G_TIMESPEC}},
+    {X86_64_SYS_NANOSLEEP,    ARM64_SYS_NANOSLEEP,    syscall_nanosleep,    "nanosleep",    F_BLK | F_PASS, {A_IN, A_OUT}, {G_TIMESPEC, G_TIMESPEC}},
 
     /* Signal */
-    {X86_64_SYS_RT_SIGACTION, ARM64_SYS_RT_SIGACTION, syscall_rt_sigaction},
-    {X86_64_SYS_RT_SIGPROCMASK, ARM64_SYS_RT_SIGPROCMASK, syscall_rt_sigprocmask},
-    {X86_64_SYS_SCHED_YIELD,  ARM64_SYS_SCHED_YIELD,  syscall_sched_yield},
+    {X86_64_SYS_RT_SIGACTION, ARM64_SYS_RT_SIGACTION, syscall_rt_sigaction, "rt_sigaction", 0,              {A_SC, A_IN, A_OUT, A_SC}, {0, G_SIGACTION, G_SIGACTION}},
+    {X86_64_SYS_RT_SIGPROCMASK, ARM64_SYS_RT_SIGPROCMASK, syscall_rt_sigprocmask, "rt_sigprocmask", 0,      {A_SC, A_IN, A_OUT, A_SC}, {0, G_SIGSET, G_SIGSET}},
+    {X86_64_SYS_SCHED_YIELD,  ARM64_SYS_SCHED_YIELD,  syscall_sched_yield,  "sched_yield",  F_PASS,         {0}, {0}},
 
     /* IPC/Sync */
-    {X86_64_SYS_FUTEX,        ARM64_SYS_FUTEX,        syscall_futex},
-    {X86_64_SYS_ARCH_PRCTL,   -1,                     syscall_arch_prctl},  /* Architecture-specific */
+    {X86_64_SYS_FUTEX,        ARM64_SYS_FUTEX,        syscall_futex,        "futex",        F_BLK,          {A_ADDR, A_SC, A_SC, A_IN, A_ADDR, A_SC}, {0}},
+    {X86_64_SYS_ARCH_PRCTL,   -1,                     syscall_arch_prctl,   "arch_prctl",   0,              {A_SC, A_ADDR}, {0}},  /* Architecture-specific */
 
     /* Network */
-    {X86_64_SYS_SOCKET,       ARM64_SYS_SOCKET,       syscall_socket},
-    {X86_64_SYS_CONNECT,      ARM64_SYS_CONNECT,      syscall_connect},
-    {X86_64_SYS_SENDTO,       ARM64_SYS_SENDTO,       syscall_sendto},
-    {X86_64_SYS_RECVFROM,     ARM64_SYS_RECVFROM,     syscall_recvfrom},
-    {X86_64_SYS_EPOLL_CREATE1, ARM64_SYS_EPOLL_CREATE1, syscall_epoll_create},
-    {X86_64_SYS_EPOLL_CTL,    ARM64_SYS_EPOLL_CTL,    syscall_epoll_ctl},
+    {X86_64_SYS_SOCKET,       ARM64_SYS_SOCKET,       syscall_socket,       "socket",       F_PASS,         {A_SC, A_SC, A_SC}, {0}},
+    {X86_64_SYS_CONNECT,      ARM64_SYS_CONNECT,      syscall_connect,      "connect",      F_BLK | F_PASS, {A_SC, A_IN, A_SC}, {0, S_LEN(2)}},
+    {X86_64_SYS_SENDTO,       ARM64_SYS_SENDTO,       syscall_sendto,       "sendto",       F_BLK | F_PASS, {A_SC, A_IN, A_SC, A_SC, A_IN, A_SC}, {0, S_LEN(2), 0, 0, S_LEN(5)}},
+    {X86_64_SYS_RECVFROM,     ARM64_SYS_RECVFROM,     syscall_recvfrom,     "recvfrom",     F_BLK | F_PASS, {A_SC, A_OUT, A_SC, A_SC, A_OUT, A_IO}, {0, S_LEN(2), 0, 0, 0, 4}},
+    {X86_64_SYS_EPOLL_CREATE1, ARM64_SYS_EPOLL_CREATE1, syscall_epoll_create, "epoll_create1", F_PASS,      {A_SC}, {0}},
+    /* struct epoll_event is packed on x86_64 only */
+    {X86_64_SYS_EPOLL_CTL,    ARM64_SYS_EPOLL_CTL,    syscall_epoll_ctl,    "epoll_ctl",    0,              {A_SC, A_SC, A_SC, A_IN}, {0, 0, 0, G_EPOLL_EVENT}},
+    {X86_64_SYS_EPOLL_WAIT,   -1,                     syscall_epoll_wait,   "epoll_wait",   F_BLK,          {A_SC, A_OUT, A_SC, A_SC}, {0, S_CNT(2, G_EPOLL_EVENT)}},
+    {X86_64_SYS_EPOLL_PWAIT,  ARM64_SYS_EPOLL_PWAIT,  syscall_epoll_pwait,  "epoll_pwait",  F_BLK,          {A_SC, A_OUT, A_SC, A_SC, A_IN, A_SC}, {0, S_CNT(2, G_EPOLL_EVENT), 0, 0, G_SIGSET}},
 
     /* Additional */
-    {X86_64_SYS_IOCTL,        ARM64_SYS_IOCTL,        syscall_ioctl},
-    {X86_64_SYS_READV,        ARM64_SYS_READV,        syscall_readv},
-    {X86_64_SYS_WRITEV,       ARM64_SYS_WRITEV,       syscall_writev},
-    {X86_64_SYS_GETCWD,       ARM64_SYS_GETCWD,       syscall_getcwd},
-    {X86_64_SYS_CHDIR,        ARM64_SYS_CHDIR,        syscall_chdir},
+    {X86_64_SYS_IOCTL,        ARM64_SYS_IOCTL,        syscall_ioctl,        "ioctl",        F_BLK,          {A_SC, A_SC, A_SC}, {0}},
+    {X86_64_SYS_READV,        ARM64_SYS_READV,        syscall_readv,        "readv",        F_BLK | F_PASS, {A_SC, A_IOV, A_SC}, {0, S_CNT(2, G_IOVEC)}},
+    {X86_64_SYS_WRITEV,       ARM64_SYS_WRITEV,       syscall_writev,       "writev",       F_BLK | F_PASS, {A_SC, A_IOV, A_SC}, {0, S_CNT(2, G_IOVEC)}},
+    {X86_64_SYS_GETCWD,       ARM64_SYS_GETCWD,       syscall_getcwd,       "getcwd",       F_PASS,         {A_OUT, A_SC}, {S_LEN(1)}},
+    {X86_64_SYS_CHDIR,        ARM64_SYS_CHDIR,        syscall_chdir,        "chdir",        F_PASS,         {A_PATH}, {0}},
 
     /* File Operations (Priority 1) */
-    {X86_64_SYS_RENAME,       ARM64_SYS_RENAME,       syscall_rename},
-    {X86_64_SYS_MKDIR,        ARM64_SYS_MKDIR,        syscall_mkdir},
-    {X86_64_SYS_RMDIR,        ARM64_SYS_RMDIR,        syscall_rmdir},
-    {X86_64_SYS_UNLINK,       ARM64_SYS_UNLINK,       syscall_unlink},
-    {X86_64_SYS_SYMLINK,      ARM64_SYS_SYMLINK,      syscall_symlink},
-    {X86_64_SYS_READLINK,     ARM64_SYS_READLINK,     syscall_readlink},
-    {X86_64_SYS_CHMOD,        ARM64_SYS_CHMOD,        syscall_chmod},
-    {X86_64_SYS_FCHMOD,       ARM64_SYS_FCHMOD,       syscall_fchmod},
-    {X86_64_SYS_CHOWN,        ARM64_SYS_CHOWN,        syscall_chown},
-    {X86_64_SYS_FCHOWN,       ARM64_SYS_FCHOWN,       syscall_fchown},
-    {X86_64_SYS_LCHOWN,       ARM64_SYS_LCHOWN,       syscall_lchown},
-    {X86_64_SYS_CREAT,        ARM64_SYS_CREAT,        syscall_creat},
+    {X86_64_SYS_RENAME,       ARM64_SYS_RENAME,       syscall_rename,       "rename",       F_PASS,         {A_PATH, A_PATH}, {0}},
+    {X86_64_SYS_MKDIR,        ARM64_SYS_MKDIR,        syscall_mkdir,        "mkdir",        F_PASS,         {A_PATH, A_SC}, {0}},
+    {X86_64_SYS_RMDIR,        ARM64_SYS_RMDIR,        syscall_rmdir,        "rmdir",        F_PASS,         {A_PATH}, {0}},
+    {X86_64_SYS_UNLINK,       ARM64_SYS_UNLINK,       syscall_unlink,       "unlink",       F_PASS,         {A_PATH}, {0}},
+    {X86_64_SYS_SYMLINK,      ARM64_SYS_SYMLINK,      syscall_symlink,      "symlink",      F_PASS,         {A_PATH, A_PATH}, {0}},
+    {X86_64_SYS_READLINK,     ARM64_SYS_READLINK,     syscall_readlink,     "readlink",     F_PASS,         {A_PATH, A_OUT, A_SC}, {0, S_LEN(2)}},
+    {X86_64_SYS_CHMOD,        ARM64_SYS_CHMOD,        syscall_chmod,        "chmod",        F_PASS,         {A_PATH, A_SC}, {0}},
+    {X86_64_SYS_FCHMOD,       ARM64_SYS_FCHMOD,       syscall_fchmod,       "fchmod",       F_PASS,         {A_SC, A_SC}, {0}},
+    {X86_64_SYS_CHOWN,        ARM64_SYS_CHOWN,        syscall_chown,        "chown",        F_PASS,         {A_PATH, A_SC, A_SC}, {0}},
+    {X86_64_SYS_FCHOWN,       ARM64_SYS_FCHOWN,       syscall_fchown,       "fchown",       F_PASS,         {A_SC, A_SC, A_SC}, {0}},
+    {X86_64_SYS_LCHOWN,       ARM64_SYS_LCHOWN,       syscall_lchown,       "lchown",       F_PASS,         {A_PATH, A_SC, A_SC}, {0}},
+    {X86_64_SYS_CREAT,        ARM64_SYS_CREAT,        syscall_creat,        "creat",        F_BLK | F_PASS, {A_PATH, A_SC}, {0}},
 
     /* Process Management (Priority 2) */
-    {X86_64_SYS_GETPGID,      ARM64_SYS_GETPGID,      syscall_getpgid},
-    {X86_64_SYS_GETSID,       ARM64_SYS_GETSID,       syscall_getsid},
-    {X86_64_SYS_SETSID,       ARM64_SYS_SETSID,       syscall_setsid},
-    {X86_64_SYS_GETGROUPS,    ARM64_SYS_GETGROUPS,    syscall_getgroups},
-    {X86_64_SYS_SETGROUPS,    ARM64_SYS_SETGROUPS,    syscall_setgroups},
-    {X86_64_SYS_SETHOSTNAME,  ARM64_SYS_SETHOSTNAME,  syscall_sethostname},
-    {X86_64_SYS_SETDOMAINNAME, ARM64_SYS_SETDOMAINNAME, syscall_setdomainname},
-    {X86_64_SYS_PRCTL,        -1,                     syscall_prctl},
+    {X86_64_SYS_GETPGID,      ARM64_SYS_GETPGID,      syscall_getpgid,      "getpgid",      F_PASS,         {A_SC}, {0}},
+    {X86_64_SYS_GETSID,       ARM64_SYS_GETSID,       syscall_getsid,       "getsid",       F_PASS,         {A_SC}, {0}},
+    {X86_64_SYS_SETSID,       ARM64_SYS_SETSID,       syscall_setsid,       "setsid",       F_PASS,         {0}, {0}},
+    {X86_64_SYS_GETGROUPS,    ARM64_SYS_GETGROUPS,    syscall_getgroups,    "getgroups",    F_PASS,         {A_SC, A_OUT}, {0, S_CNT(0, 4)}},
+    {X86_64_SYS_SETGROUPS,    ARM64_SYS_SETGROUPS,    syscall_setgroups,    "setgroups",    F_PASS,         {A_SC, A_IN}, {0, S_CNT(0, 4)}},
+    {X86_64_SYS_SETHOSTNAME,  ARM64_SYS_SETHOSTNAME,  syscall_sethostname,  "sethostname",  F_PASS,         {A_IN, A_SC}, {S_LEN(1)}},
+    {X86_64_SYS_SETDOMAINNAME, ARM64_SYS_SETDOMAINNAME, syscall_setdomainname, "setdomainname", F_PASS,     {A_IN, A_SC}, {S_LEN(1)}},
+    {X86_64_SYS_PRCTL,        -1,                     syscall_prctl,        "prctl",        0,              {A_SC, A_SC, A_SC, A_SC, A_SC}, {0}},
 
     /* Memory Operations (Priority 3) */
-    {X86_64_SYS_MADVISE,      ARM64_SYS_MADVISE,      syscall_madvise},
+    {X86_64_SYS_MADVISE,      ARM64_SYS_MADVISE,      syscall_madvise,      "madvise",      0,              {A_MEM, A_SC, A_SC}, {S_LEN(1)}},
 
     /* Signal and Time */
-    {X86_64_SYS_SET_TID_ADDRESS, ARM64_SYS_SET_TID_ADDRESS, syscall_set_tid_address},
-    {X86_64_SYS_CLOCK_GETRES,  ARM64_SYS_CLOCK_GETRES, syscall_clock_getres},
+    {X86_64_SYS_CLOCK_GETRES,  ARM64_SYS_CLOCK_GETRES, syscall_clock_getres, "clock_getres", F_PASS,        {A_SC, A_OUT}, {0, G_TIMESPEC}},
 
     /* Futex and Robust List */
-    {X86_64_SYS_SET_ROBUST_LIST, ARM64_SYS_SET_ROBUST_LIST, syscall_set_robust_list},
-    {X86_64_SYS_GET_ROBUST_LIST, ARM64_SYS_GET_ROBUST_LIST, syscall_get_robust_list},
+    {X86_64_SYS_SET_ROBUST_LIST, ARM64_SYS_SET_ROBUST_LIST, syscall_set_robust_list, "set_robust_list", 0,  {A_IN, A_SC}, {S_LEN(1)}},
+    {X86_64_SYS_GET_ROBUST_LIST, ARM64_SYS_GET_ROBUST_LIST, syscall_get_robust_list, "get_robust_list", 0,  {A_SC, A_OUT, A_OUT}, {0, 8, 8}},
 
     /* Additional File */
-    {X86_64_SYS_POLL,         ARM64_SYS_POLL,         syscall_poll},
+    {X86_64_SYS_POLL,         ARM64_SYS_POLL,         syscall_poll,         "poll",         F_BLK | F_PASS, {A_IO, A_SC, A_SC}, {S_CNT(1, G_POLLFD)}},
+    /* fd_set is FD_SETSIZE bits on both sides; Linux updates the timeout */
+    {X86_64_SYS_SELECT,       -1,                     syscall_select,       "select",       F_BLK,          {A_SC, A_IO, A_IO, A_IO, A_IO}, {0, G_FDSET, G_FDSET, G_FDSET, G_TIMEVAL}},
 
     /* Clone and Exec */
-    {X86_64_SYS_CLONE,        ARM64_SYS_CLONE,        syscall_clone},
-    {X86_64_SYS_EXECVE,       ARM64_SYS_EXECVE,       syscall_execve},
+    {X86_64_SYS_CLONE,        ARM64_SYS_CLONE,        syscall_clone,        "clone",        0,              {A_SC, A_ADDR, A_OUT, A_OUT, A_SC}, {0, 0, 4, 4}},
+    {X86_64_SYS_EXECVE,       ARM64_SYS_EXECVE,       syscall_execve,       "execve",       0,              {A_PATH, A_ADDR, A_ADDR}, {0}},
 
     /* Memory Advanced */
-    {X86_64_SYS_MINCORE,      -1,                     syscall_mincore},
-    {X86_64_SYS_MLOCK,        -1,                     syscall_mlock},
-    {X86_64_SYS_MUNLOCK,      -1,                     syscall_munlock},
-    {X86_64_SYS_MSYNC,        -1,                     syscall_msync},
-    {X86_64_SYS_PRLIMIT,      -1,                     syscall_prlimit},
+    {X86_64_SYS_MINCORE,      -1,                     syscall_mincore,      "mincore",      0,              {A_MEM, A_SC, A_OUT}, {S_LEN(1)}},
+    {X86_64_SYS_MLOCK,        -1,                     syscall_mlock,        "mlock",        0,              {A_MEM, A_SC}, {S_LEN(1)}},
+    {X86_64_SYS_MUNLOCK,      -1,                     syscall_munlock,      "munlock",      0,              {A_MEM, A_SC}, {S_LEN(1)}},
+    {X86_64_SYS_MSYNC,        -1,                     syscall_msync,        "msync",        F_BLK,          {A_MEM, A_SC, A_SC}, {S_LEN(1)}},
+    {X86_64_SYS_PRLIMIT,      -1,                     syscall_prlimit,      "prlimit64",    F_PASS,         {A_SC, A_SC, A_IN, A_OUT}, {0, 0, G_RLIMIT, G_RLIMIT}},
 
     /* Additional */
-    {X86_64_SYS_GETCPU,       -1,                     syscall_getcpu},
+    {X86_64_SYS_GETCPU,       -1,                     syscall_getcpu,       "getcpu",       F_PASS,         {A_OUT, A_OUT, A_OUT}, {4, 4}},
 };
 
 static int syscall_table_size = sizeof(syscall_table) / sizeof(syscall_table[0]);
 
+/* Dense dispatch table, indexed directly by x86_64 syscall number.
+ * Built once by init_syscall_table(); unused slots have no handler. */
+static syscall_desc_t syscall_dispatch[X86_64_SYSCALL_MAX];
+static bool syscall_dispatch_ready = false;
+static pthread_once_t syscall_dispatch_once = PTHREAD_ONCE_INIT;
+
+/**
+ * Get the dispatch table slot for a syscall number
+ */
+static inline syscall_desc_t *syscall_slot(int x86_64_nr)
+{
+    if ((unsigned int)x86_64_nr >= X86_64_SYSCALL_MAX) {
+        return NULL;
+    }
+
+    if (!__atomic_load_n(&syscall_dispatch_ready, __ATOMIC_ACQUIRE)) {
+        init_syscall_table();
+    }
+
+    return &syscall_dispatch[x86_64_nr];
+}
+
 /* ============================================================================
  * Syscall Number Translation
  * ============================================================================ */
@@ -230,16 +299,10 @@ static int syscall_table_size = sizeof(syscall_table) / sizeof(syscall_table[0])
  */
 int translate_syscall_number(int x86_64_nr)
 {
-    int i;
-
-    for (i = 0; i < syscall_table_size; i++) {
-        if (syscall_table[i].x86_64_nr == x86_64_nr) {
-            return syscall_table[i].arm64_nr;
-        }
-    }
+    const syscall_desc_t *desc = syscall_slot(x86_64_nr);
 
     /* Unknown syscall - return -1 (not supported) */
-    return -1;
+    return desc ? desc->arm64_nr : -1;
 }
 
 /**
@@ -247,15 +310,253 @@ int translate_syscall_number(int x86_64_nr)
  */
 syscall_handler_t get_syscall_handler(int x86_64_nr)
 {
+    const syscall_desc_t *desc = syscall_slot(x86_64_nr);
+
+    return desc ? desc->handler : NULL;
+}
+
+/**
+ * Look up syscall metadata
+ */
+const syscall_desc_t *syscall_lookup(int x86_64_nr)
+{
+    const syscall_desc_t *desc = syscall_slot(x86_64_nr);
+
+    if (desc == NULL || (desc->handler == NULL && desc->raw_handler == NULL)) {
+        return NULL;
+    }
+
+    return desc;
+}
+
+/**
+ * Register a raw handler in the dispatch table
+ */
+int syscall_register_raw(int x86_64_nr, const char *name,
+                         syscall_raw_handler_t handler)
+{
+    syscall_desc_t *desc = syscall_slot(x86_64_nr);
+
+    if (desc == NULL) {
+        return -1;
+    }
+
+    desc->raw_handler = handler;
+    if (name != NULL) {
+        desc->name = name;
+    }
+
+    return 0;
+}
+
+/* ============================================================================
+ * Guest Pointer Translation
+ * ============================================================================ */
+
+/* Guest address space, or NULL when guest addresses are host addresses */
+static rosetta_memmgr_t *syscall_guest_mem = NULL;
+
+/* x86_64 syscall argument registers, in argument order */
+static const int syscall_arg_regs[SYSCALL_MAX_ARGS] = {
+    X86_RDI, X86_RSI, X86_RDX, X86_R10, X86_R8, X86_R9
+};
+
+/**
+ * Set the guest address space that syscall pointer arguments refer to
+ */
+void syscall_set_guest_memory(rosetta_memmgr_t *mgr)
+{
+    syscall_guest_mem = mgr;
+}
+
+/**
+ * Get the registered guest address space
+ */
+rosetta_memmgr_t *syscall_get_guest_memory(void)
+{
+    return syscall_guest_mem;
+}
+
+/**
+ * Translate a guest range for handlers with op-dependent pointer arguments
+ */
+void *syscall_guest_ptr(uint64_t guest_addr, size_t size)
+{
+    if (guest_addr == 0) {
+        return NULL;
+    }
+    if (syscall_guest_mem == NULL) {
+        return (void *)(uintptr_t)guest_addr;
+    }
+
+    return rosetta_memmgr_guest_range(syscall_guest_mem, guest_addr,
+                                      size ? size : 1);
+}
+
+/**
+ * Guest range size of a pointer argument, from the syscall metadata
+ */
+static uint64_t syscall_arg_size(const syscall_desc_t *desc,
+                                 const uint64_t *args, int i)
+{
+    uint16_t spec = desc->arg_sizes[i];
+    uint64_t elem, count;
+
+    if (!(spec & SYSCALL_SIZE_FROM_ARG)) {
+        return spec;
+    }
+
+    elem = (spec & ~SYSCALL_SIZE_FROM_ARG) >> 3;
+    count = args[spec & 7];
+    if (elem != 0 && count > UINT64_MAX / elem) {
+        return UINT64_MAX;      /* Fails the range check */
+    }
+    return count * elem;
+}
+
+/**
+ * Translate a NUL-terminated guest string
+ *
+ * Only the terminator is searched for; paths longer than PATH_MAX are left
+ * for the host kernel to reject with ENAMETOOLONG.
+ */
+static void *syscall_translate_path(rosetta_memmgr_t *mem, uint64_t guest)
+{
+    char *host = rosetta_memmgr_guest_range(mem, guest, 1);
+    size_t avail;
+
+    if (host == NULL) {
+        return NULL;
+    }
+
+    avail = (size_t)((char *)mem->host_base + mem->total_size - host);
+    if (avail <= PATH_MAX && memchr(host, '\0', avail) == NULL) {
+        return NULL;
+    }
+    return host;
+}
+
+/**
+ * Translate a guest iovec array into a per-thread host iovec array
+ */
+static void *syscall_translate_iovec(rosetta_memmgr_t *mem, uint64_t guest,
+                                     uint64_t iovcnt)
+{
+    const x86_64_iovec_t *giov;
+    struct iovec *hiov;
+    uint64_t i;
+
+    giov = rosetta_memmgr_guest_range(mem, guest, iovcnt * sizeof(x86_64_iovec_t));
+    if (giov == NULL || iovcnt > IOV_MAX) {
+        return NULL;
+    }
+
+    hiov = rosetta_marshal_scratch(ROSETTA_SCRATCH_IOVEC,
+                                   iovcnt * sizeof(struct iovec));
+    if (hiov == NULL) {
+        return NULL;
+    }
+
+    for (i = 0; i < iovcnt; i++) {
+        hiov[i].iov_len = (size_t)giov[i].iov_len;
+        hiov[i].iov_base = giov[i].iov_len == 0 ? NULL :
+            rosetta_memmgr_guest_range(mem, giov[i].iov_base, giov[i].iov_len);
+        if (giov[i].iov_len != 0 && hiov[i].iov_base == NULL) {
+            return NULL;
+        }
+    }
+    return hiov;
+}
+
+/**
+ * Translate all pointer arguments of a syscall to host addresses
+ * @return 0 on success, negative errno if a guest range is invalid
+ *
+ * Each range is validated once as a whole; handlers then access guest
+ * memory through the host pointers without further checks.
+ */
+static int syscall_translate_args(const syscall_desc_t *desc,
+                                  const uint64_t *guest, uint64_t *host)
+{
+    rosetta_memmgr_t *mem = syscall_guest_mem;
+    void *p;
     int i;
 
-    for (i = 0; i < syscall_table_size; i++) {
-        if (syscall_table[i].x86_64_nr == x86_64_nr) {
-            return syscall_table[i].handler;
+    for (i = 0; i < SYSCALL_MAX_ARGS; i++) {
+        host[i] = guest[i];
+        if (i >= desc->nargs || guest[i] == 0) {
+            continue;           /* NULL pointers pass through */
+        }
+
+        switch (desc->arg_kinds[i]) {
+        case SYSCALL_ARG_PTR_IN:
+        case SYSCALL_ARG_PTR_OUT:
+        case SYSCALL_ARG_PTR_INOUT:
+            p = rosetta_memmgr_guest_range(mem, guest[i],
+                                           syscall_arg_size(desc, guest, i));
+            if (p == NULL) {
+                return -EFAULT;
+            }
+            break;
+
+        case SYSCALL_ARG_PATH:
+            p = syscall_translate_path(mem, guest[i]);
+            if (p == NULL) {
+                return -EFAULT;
+            }
+            break;
+
+        case SYSCALL_ARG_IOVEC:
+            p = syscall_translate_iovec(mem, guest[i], guest[desc->arg_sizes[i] & 7]);
+            if (p == NULL) {
+                return -EFAULT;
+            }
+            break;
+
+        case SYSCALL_ARG_MEM:
+            /* Mapping outside the guest window: not mapped, as far as the guest knows */
+            p = rosetta_memmgr_guest_range(mem, guest[i],
+                                           syscall_arg_size(desc, guest, i));
+            if (p == NULL) {
+                return -ENOMEM;
+            }
+            break;
+
+        default:
+            continue;
         }
+
+        host[i] = (uint64_t)(uintptr_t)p;
     }
 
-    return NULL;
+    return 0;
+}
+
+/* ============================================================================
+ * Guest Exit
+ * ============================================================================ */
+
+/* Run before the guest ends the process, or NULL */
+static void (*syscall_exit_hook)(int status) = NULL;
+
+/**
+ * Register a function to run when the guest ends the process
+ */
+void syscall_set_exit_hook(void (*hook)(int status))
+{
+    syscall_exit_hook = hook;
+}
+
+/**
+ * Run the registered exit hook, if any
+ */
+void syscall_run_exit_hook(int status)
+{
+    void (*hook)(int status) = syscall_exit_hook;
+
+    if (hook) {
+        hook(status);
+    }
 }
 
 /* ============================================================================
@@ -299,31 +600,161 @@ void remap_syscall_args(ThreadState *state)
     (void)state;
 }
 
+/**
+ * Call the handler of a table entry with the arguments in guest registers
+ */
+static int syscall_invoke(ThreadState *state, const syscall_desc_t *desc)
+{
+    if (desc != NULL && desc->handler != NULL) {
+        /* Call handler */
+        return desc->handler(state);
+    }
+
+    if (desc != NULL && desc->raw_handler != NULL) {
+        /* Runtime-registered handler takes the raw guest arguments */
+        state->syscall_result = desc->raw_handler(
+            state->guest.r[X86_RDI], state->guest.r[X86_RSI],
+            state->guest.r[X86_RDX], state->guest.r[X86_R10],
+            state->guest.r[X86_R8],  state->guest.r[X86_R9]);
+        return state->syscall_result < 0 ? -1 : 0;
+    }
+
+    /* No handler found */
+    state->syscall_result = -ENOSYS;
+    return -1;
+}
+
+/**
+ * Call a handler with its pointer arguments translated to host addresses
+ */
+static int syscall_invoke_translated(ThreadState *state, const syscall_desc_t *desc)
+{
+    uint64_t guest[SYSCALL_MAX_ARGS];
+    uint64_t host[SYSCALL_MAX_ARGS];
+    uint64_t guest_ret;
+    int i, ret;
+
+    for (i = 0; i < SYSCALL_MAX_ARGS; i++) {
+        guest[i] = state->guest.r[syscall_arg_regs[i]];
+    }
+
+    ret = syscall_translate_args(desc, guest, host);
+    if (ret < 0) {
+        state->syscall_result = ret;
+        return -1;
+    }
+
+    for (i = 0; i < SYSCALL_MAX_ARGS; i++) {
+        state->guest.r[syscall_arg_regs[i]] = host[i];
+    }
+    ret = syscall_invoke(state, desc);
+
+    /* SYSCALL preserves the guest's argument registers */
+    for (i = 0; i < SYSCALL_MAX_ARGS; i++) {
+        state->guest.r[syscall_arg_regs[i]] = guest[i];
+    }
+
+    if ((desc->flags & SYSCALL_FLAG_RET_ADDR) &&
+        (uint64_t)state->syscall_result < (uint64_t)-4095 &&
+        rosetta_memmgr_host_to_guest(syscall_guest_mem,
+                                     (void *)(uintptr_t)state->syscall_result,
+                                     &guest_ret) == 0) {
+        state->syscall_result = (int64_t)guest_ret;
+    }
+
+    return ret;
+}
+
 /**
  * Dispatch syscall to appropriate handler
  */
 int dispatch_syscall(ThreadState *state, int syscall_nr)
 {
-    syscall_handler_t handler;
+    const syscall_desc_t *desc = syscall_slot(syscall_nr);
 
-    /* Try to find handler in our table */
-    handler = get_syscall_handler(syscall_nr);
+    if (syscall_guest_mem != NULL && desc != NULL &&
+        (desc->flags & SYSCALL_FLAG_GUEST_PTRS)) {
+        return syscall_invoke_translated(state, desc);
+    }
 
-    if (handler != NULL) {
-        /* Call handler */
-        return handler(state);
+    return syscall_invoke(state, desc);
+}
+
+/**
+ * Call a known syscall's handler, translating its guest pointers
+ */
+int syscall_invoke_desc(ThreadState *state, const syscall_desc_t *desc)
+{
+    if (syscall_guest_mem != NULL && (desc->flags & SYSCALL_FLAG_GUEST_PTRS)) {
+        return syscall_invoke_translated(state, desc);
     }
 
-    /* No handler found - try direct syscall passthrough */
-    /* This is a fallback for unimplemented syscalls */
-    state->syscall_result = -ENOSYS;
-    return -1;
+    return syscall_invoke(state, desc);
+}
+
+/**
+ * Dispatch the syscall whose number is in guest RAX
+ */
+int dispatch_syscall_state(ThreadState *state)
+{
+    int ret;
+
+    state->syscall_nr = (s64)state->guest.r[X86_RAX];
+    ret = dispatch_syscall(state, (int)state->syscall_nr);
+    state->guest.r[X86_RAX] = (u64)state->syscall_result;
+
+    return ret;
+}
+
+/**
+ * Expand the sparse mapping table into the dense dispatch table so that
+ * lookups are a single bounds check and index
+ */
+static void syscall_dispatch_build(void)
+{
+    int i, j;
+
+    memset(syscall_dispatch, 0, sizeof(syscall_dispatch));
+    for (i = 0; i < X86_64_SYSCALL_MAX; i++) {
+        syscall_dispatch[i].arm64_nr = -1;
+    }
+
+    for (i = 0; i < syscall_table_size; i++) {
+        const SyscallEntryLocal *entry = &syscall_table[i];
+        syscall_desc_t *desc = &syscall_dispatch[entry->x86_64_nr];
+
+        desc->handler = entry->handler;
+        desc->name = entry->name;
+        desc->arm64_nr = (int16_t)entry->arm64_nr;
+        desc->flags = entry->flags;
+        desc->nargs = 0;
+        for (j = 0; j < SYSCALL_MAX_ARGS; j++) {
+            desc->arg_kinds[j] = entry->args[j];
+            desc->arg_sizes[j] = entry->sizes[j];
+            if (entry->args[j] != SYSCALL_ARG_NONE) {
+                desc->nargs = (uint8_t)(j + 1);
+            }
+            if (entry->args[j] != SYSCALL_ARG_NONE &&
+                entry->args[j] != SYSCALL_ARG_SCALAR &&
+                entry->args[j] != SYSCALL_ARG_ADDR) {
+                desc->flags |= SYSCALL_FLAG_GUEST_PTRS;
+            }
+        }
+        if (desc->flags & SYSCALL_FLAG_RET_ADDR) {
+            desc->flags |= SYSCALL_FLAG_GUEST_PTRS;
+        }
+    }
+
+    __atomic_store_n(&syscall_dispatch_ready, true, __ATOMIC_RELEASE);
 }
 
 /**
  * Initialize syscall table (called once at startup)
+ *
+ * Safe to call from several translating threads at once; the first call
+ * builds the table and the others wait for it.
  */
 void init_syscall_table(void)
 {
-    /* Table is statically initialized - nothing to do */
+    pthread_once(&syscall_dispatch_once, syscall_dispatch_build);
 }
@@ -16,6 +16,7 @@
  * ============================================================================ */
 
 #include "rosetta_types.h"
+#include "rosetta_memmgr.h"
 
 /* Define noreturn for C99 compatibility */
 #ifndef noreturn
@@ -35,12 +36,15 @@
 #define X86_64_SYS_FSTAT        5
 #define X86_64_SYS_LSTAT        6
 #define X86_64_SYS_POLL         7
+#define X86_64_SYS_SELECT       23
 #define X86_64_SYS_LSEEK        8
 #define X86_64_SYS_MMAP         9
 #define X86_64_SYS_MPROTECT     10
 #define X86_64_SYS_MUNMAP       11
 #define X86_64_SYS_BRK          12
 #define X86_64_SYS_IOCTL        16
+#define X86_64_SYS_PREAD64      17
+#define X86_64_SYS_PWRITE64     18
 #define X86_64_SYS_ACCESS       21
 #define X86_64_SYS_PIPE         22
 #define X86_64_SYS_DUP          32
@@ -67,6 +71,7 @@
 #define X86_64_SYS_CLOCK_GETTIME 228
 #define X86_64_SYS_EPOLL_CREATE1 291
 #define X86_64_SYS_EPOLL_CTL    233
+#define X86_64_SYS_EPOLL_WAIT   232
 #define X86_64_SYS_EPOLL_PWAIT  281
 #define X86_64_SYS_READV        19
 #define X86_64_SYS_WRITEV       20
@@ -156,12 +161,13 @@
 #define X86_64_SYS_GETRUSAGE     98
 #define X86_64_SYS_TIMES         100
 #define X86_64_SYS_SYSINFO       99
-#define X86_64_SYS_MINCORE       232
+#define X86_64_SYS_MINCORE       27
 #define X86_64_SYS_MLOCK         149
 #define X86_64_SYS_MUNLOCK       150
 #define X86_64_SYS_MSYNC         26
-#define X86_64_SYS_PRLIMIT       309
-#define X86_64_SYS_GETCPU        204
+#define X86_64_SYS_PRLIMIT       302
+#define X86_64_SYS_GETCPU        309
+#define X86_64_SYS_TIME          201
 
 /* ARM64 syscall numbers (Linux ABI) - Host */
 #define ARM64_SYS_READ          63
@@ -178,6 +184,8 @@
 #define ARM64_SYS_MUNMAP        215
 #define ARM64_SYS_BRK           214
 #define ARM64_SYS_IOCTL         29
+#define ARM64_SYS_PREAD64       67
+#define ARM64_SYS_PWRITE64      68
 #define ARM64_SYS_ACCESS        48
 #define ARM64_SYS_PIPE          40
 #define ARM64_SYS_DUP           23
@@ -303,6 +311,62 @@
  */
 typedef int (*syscall_handler_t)(ThreadState *state);
 
+/**
+ * Raw syscall handler function type (registered at runtime)
+ * @return Syscall result, negative errno on failure
+ */
+typedef int64_t (*syscall_raw_handler_t)(uint64_t arg1, uint64_t arg2,
+                                         uint64_t arg3, uint64_t arg4,
+                                         uint64_t arg5, uint64_t arg6);
+
+/* ============================================================================
+ * Syscall Metadata
+ * ============================================================================ */
+
+/* Size of the dense x86_64 syscall dispatch table */
+#define X86_64_SYSCALL_MAX      512
+
+/* Maximum number of syscall arguments */
+#define SYSCALL_MAX_ARGS        6
+
+/* Argument kinds, used to translate guest pointers */
+typedef enum {
+    SYSCALL_ARG_NONE = 0,   /* Argument not used */
+    SYSCALL_ARG_SCALAR,     /* Integer, fd or flags - passed unchanged */
+    SYSCALL_ARG_PTR_IN,     /* Guest buffer read by the kernel */
+    SYSCALL_ARG_PTR_OUT,    /* Guest buffer written by the kernel */
+    SYSCALL_ARG_PTR_INOUT,  /* Guest buffer read and written */
+    SYSCALL_ARG_PATH,       /* NUL-terminated guest string */
+    SYSCALL_ARG_IOVEC,      /* Guest struct iovec array */
+    SYSCALL_ARG_ADDR,       /* Guest address, passed unchanged */
+    SYSCALL_ARG_MEM         /* Guest mapping range (mmap family), not accessed */
+} syscall_arg_kind_t;
+
+/* Size of a pointer argument's guest range, per argument.
+ * Below SYSCALL_SIZE_FROM_ARG: fixed byte count (0 = unknown, start only).
+ * With SYSCALL_SIZE_FROM_ARG: element size times the value of another argument. */
+#define SYSCALL_SIZE_FROM_ARG       0x8000
+#define SYSCALL_SIZE_ARG(idx, elem) (SYSCALL_SIZE_FROM_ARG | ((elem) << 3) | (idx))
+
+/* Syscall flags */
+#define SYSCALL_FLAG_BLOCKING       0x01    /* May sleep in the kernel */
+#define SYSCALL_FLAG_PASSTHROUGH    0x02    /* Identical semantics on host */
+#define SYSCALL_FLAG_NORETURN       0x04    /* Does not return to the guest */
+#define SYSCALL_FLAG_RET_ADDR       0x08    /* Result is an address in guest memory */
+#define SYSCALL_FLAG_GUEST_PTRS     0x10    /* Has arguments to translate (computed) */
+
+/* Dense dispatch table entry, indexed by x86_64 syscall number */
+typedef struct {
+    syscall_handler_t handler;          /* ThreadState handler */
+    syscall_raw_handler_t raw_handler;  /* Runtime-registered handler */
+    const char *name;                   /* Syscall name */
+    int16_t arm64_nr;                   /* Host syscall number, -1 if none */
+    uint8_t flags;                      /* SYSCALL_FLAG_* */
+    uint8_t nargs;                      /* Number of used arguments */
+    uint8_t arg_kinds[SYSCALL_MAX_ARGS];/* syscall_arg_kind_t per argument */
+    uint16_t arg_sizes[SYSCALL_MAX_ARGS];/* Guest range size, SYSCALL_SIZE_* */
+} syscall_desc_t;
+
 /* Forward declaration for syscall handler function */
 int syscall_dup(ThreadState *state);
 
@@ -312,6 +376,8 @@ int syscall_dup(ThreadState *state);
 
 int syscall_read(ThreadState *state);
 int syscall_write(ThreadState *state);
+int syscall_pread64(ThreadState *state);
+int syscall_pwrite64(ThreadState *state);
 int syscall_open(ThreadState *state);
 int syscall_close(ThreadState *state);
 int syscall_lseek(ThreadState *state);
@@ -415,6 +481,7 @@ int syscall_flock(ThreadState *state);
 int syscall_fsync(ThreadState *state);
 int syscall_fdatasync(ThreadState *state);
 int syscall_poll(ThreadState *state);
+int syscall_select(ThreadState *state);
 int syscall_dup(ThreadState *state);
 
 /* Filesystem Statistics */
@@ -498,29 +565,119 @@ int syscall_epoll_pwait(ThreadState *state);
  * ============================================================================ */
 
 /**
- * Translate ARM64 syscall number to x86_64
- * @param arm64_nr ARM64 syscall number
- * @return x86_64 syscall number, or -1 if unknown
+ * Translate x86_64 syscall number to ARM64
+ * @param x86_64_nr x86_64 syscall number
+ * @return ARM64 syscall number, or -1 if unknown
  */
-int translate_syscall_number(int arm64_nr);
+int translate_syscall_number(int x86_64_nr);
 
 /**
- * Get syscall handler for ARM64 syscall
- * @param arm64_nr ARM64 syscall number
+ * Get syscall handler for x86_64 syscall
+ * @param x86_64_nr x86_64 syscall number
  * @return Handler function, or NULL if no handler
  */
-syscall_handler_t get_syscall_handler(int arm64_nr);
+syscall_handler_t get_syscall_handler(int x86_64_nr);
+
+/**
+ * Look up syscall metadata
+ * @param x86_64_nr x86_64 syscall number
+ * @return Table entry, or NULL if the syscall has no handler
+ */
+const syscall_desc_t *syscall_lookup(int x86_64_nr);
+
+/**
+ * Register a raw handler in the dispatch table
+ * @param x86_64_nr x86_64 syscall number
+ * @param name Syscall name (NULL keeps the current name)
+ * @param handler Handler function, or NULL to unregister
+ * @return 0 on success, -1 on invalid number
+ */
+int syscall_register_raw(int x86_64_nr, const char *name,
+                         syscall_raw_handler_t handler);
 
 /**
  * Dispatch syscall to appropriate handler
  * @param state Thread state
- * @param syscall_nr ARM64 syscall number
+ * @param syscall_nr x86_64 syscall number
  * @return 0 on success, negative errno on failure
  */
 int dispatch_syscall(ThreadState *state, int syscall_nr);
 
 /**
- * Initialize syscall table
+ * Dispatch the syscall whose number is in guest RAX
+ * @param state Thread state
+ * @return 0 on success, negative errno on failure
+ *
+ * Entry point for translated SYSCALL instructions whose number is not
+ * known at translation time. The result is written back to guest RAX.
+ */
+int dispatch_syscall_state(ThreadState *state);
+
+/**
+ * Call a known syscall's handler, translating its guest pointers
+ * @param state Thread state
+ * @param desc Table entry from syscall_lookup()
+ * @return 0 on success, -1 on failure (result in state->syscall_result)
+ *
+ * Entry point for translated SYSCALL instructions whose number is known
+ * at translation time but whose arguments refer to a relocated guest.
+ */
+int syscall_invoke_desc(ThreadState *state, const syscall_desc_t *desc);
+
+/* ============================================================================
+ * Guest Address Space
+ * ============================================================================ */
+
+/**
+ * Set the guest address space that syscall pointer arguments refer to
+ * @param mgr Memory manager, or NULL for a guest sharing the host address space
+ *
+ * With a memory manager registered, dispatch translates every pointer
+ * argument described by the syscall metadata to its host address, after
+ * validating the whole guest range once. Handlers then work on host
+ * pointers into guest memory directly, so read()/write() stay zero-copy.
+ */
+void syscall_set_guest_memory(rosetta_memmgr_t *mgr);
+
+/**
+ * Get the registered guest address space
+ * @return Memory manager, or NULL if guest addresses are host addresses
+ */
+rosetta_memmgr_t *syscall_get_guest_memory(void);
+
+/**
+ * Translate a guest range for handlers with op-dependent pointer arguments
+ * @param guest_addr Guest address
+ * @param size Range length in bytes
+ * @return Host pointer, or NULL if guest_addr is NULL or the range is not guest memory
+ */
+void *syscall_guest_ptr(uint64_t guest_addr, size_t size);
+
+/* ============================================================================
+ * Guest Exit
+ * ============================================================================ */
+
+/**
+ * Register a function to run when the guest ends the process
+ * @param hook Called with the exit status, or NULL for none
+ *
+ * exit and exit_group leave through _exit() without returning to the
+ * runner, so reports gathered over the run are written from the hook.
+ */
+void syscall_set_exit_hook(void (*hook)(int status));
+
+/**
+ * Run the registered exit hook, if any; exit and exit_group call this
+ * @param status Guest exit status
+ */
+void syscall_run_exit_hook(int status);
+
+/* ============================================================================
+ * Syscall Table
+ * ============================================================================ */
+
+/**
+ * Initialize syscall table (builds the dense dispatch table)
  */
 void init_syscall_table(void);
 
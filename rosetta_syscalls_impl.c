@@ -12,6 +12,9 @@
 
 #include "rosetta_syscalls_impl.h"
 #include "rosetta_refactored_helpers.h"
+#include "rosetta_syscall_uring.h"
+#include "rosetta_syscall_marshal.h"
+#include "rosetta_syscalls.h"
 #include "rosetta_types.h"
 #include <stdio.h>
 #include <stdlib.h>
@@ -93,6 +96,54 @@ int syscall_write(ThreadState *state)
     return 0;
 }
 
+/**
+ * syscall_pread64 - Read from file descriptor at offset
+ */
+int syscall_pread64(ThreadState *state)
+{
+    int fd = GUEST_ARG0(state);
+    void *buf = (void *)GUEST_ARG1(state);
+    size_t count = GUEST_ARG2(state);
+    off_t offset = (off_t)GUEST_ARG3(state);
+
+    if (offset < 0) {
+        state->syscall_result = -EINVAL;
+        return -1;
+    }
+
+    ssize_t ret = pread(fd, buf, count, offset);
+    if (ret < 0) {
+        state->syscall_result = -errno;
+        return -1;
+    }
+    state->syscall_result = ret;
+    return 0;
+}
+
+/**
+ * syscall_pwrite64 - Write to file descriptor at offset
+ */
+int syscall_pwrite64(ThreadState *state)
+{
+    int fd = GUEST_ARG0(state);
+    const void *buf = (const void *)GUEST_ARG1(state);
+    size_t count = GUEST_ARG2(state);
+    off_t offset = (off_t)GUEST_ARG3(state);
+
+    if (offset < 0) {
+        state->syscall_result = -EINVAL;
+        return -1;
+    }
+
+    ssize_t ret = pwrite(fd, buf, count, offset);
+    if (ret < 0) {
+        state->syscall_result = -errno;
+        return -1;
+    }
+    state->syscall_result = ret;
+    return 0;
+}
+
 /**
  * syscall_open - Open a file
  */
@@ -194,6 +245,18 @@ int syscall_mmap(ThreadState *state)
     int flags = GUEST_ARG3(state);
     int fd = GUEST_ARG4(state);
     off_t offset = GUEST_ARG5(state);
+    rosetta_memmgr_t *mem = syscall_get_guest_memory();
+
+    /* Relocated guest: new mappings must land inside the guest window */
+    if (mem != NULL && addr == NULL) {
+        uint64_t guest = rosetta_memmgr_alloc(mem, 0, length, (uint32_t)prot, "mmap");
+        if (guest == 0) {
+            state->syscall_result = -ENOMEM;
+            return -1;
+        }
+        addr = rosetta_memmgr_guest_to_host(mem, guest);
+        flags |= MAP_FIXED;
+    }
 
     void *ret = mmap(addr, length, prot, flags, fd, offset);
     if (ret == MAP_FAILED) {
@@ -267,13 +330,16 @@ int syscall_brk(ThreadState *state)
 int syscall_stat(ThreadState *state)
 {
     const char *pathname = (const char *)GUEST_ARG0(state);
-    struct stat *statbuf = (struct stat *)GUEST_ARG1(state);
+    void *statbuf = (void *)GUEST_ARG1(state);
+
+    struct stat *host_stat = rosetta_marshal_stat_buf(statbuf);
 
-    int ret = stat(pathname, statbuf);
+    int ret = stat(pathname, host_stat);
     if (ret < 0) {
         state->syscall_result = -errno;
         return -1;
     }
+    rosetta_marshal_stat_out(statbuf, host_stat);
     state->syscall_result = 0;
     return 0;
 }
@@ -284,13 +350,16 @@ int syscall_stat(ThreadState *state)
 int syscall_fstat(ThreadState *state)
 {
     int fd = GUEST_ARG0(state);
-    struct stat *statbuf = (struct stat *)GUEST_ARG1(state);
+    void *statbuf = (void *)GUEST_ARG1(state);
 
-    int ret = fstat(fd, statbuf);
+    struct stat *host_stat = rosetta_marshal_stat_buf(statbuf);
+
+    int ret = fstat(fd, host_stat);
     if (ret < 0) {
         state->syscall_result = -errno;
         return -1;
     }
+    rosetta_marshal_stat_out(statbuf, host_stat);
     state->syscall_result = 0;
     return 0;
 }
@@ -301,13 +370,16 @@ int syscall_fstat(ThreadState *state)
 int syscall_lstat(ThreadState *state)
 {
     const char *pathname = (const char *)GUEST_ARG0(state);
-    struct stat *statbuf = (struct stat *)GUEST_ARG1(state);
+    void *statbuf = (void *)GUEST_ARG1(state);
+
+    struct stat *host_stat = rosetta_marshal_stat_buf(statbuf);
 
-    int ret = lstat(pathname, statbuf);
+    int ret = lstat(pathname, host_stat);
     if (ret < 0) {
         state->syscall_result = -errno;
         return -1;
     }
+    rosetta_marshal_stat_out(statbuf, host_stat);
     state->syscall_result = 0;
     return 0;
 }
@@ -381,6 +453,8 @@ int syscall_fcntl(ThreadState *state)
 noreturn int syscall_exit(ThreadState *state)
 {
     int status = GUEST_ARG0(state);
+    rosetta_uring_thread_cleanup();
+    syscall_run_exit_hook(status);
     _exit(status);
 }
 
@@ -392,6 +466,8 @@ noreturn int syscall_exit(ThreadState *state)
 noreturn int syscall_exit_group(ThreadState *state)
 {
     int status = GUEST_ARG0(state);
+    rosetta_uring_thread_cleanup();
+    syscall_run_exit_hook(status);
     _exit(status);
 }
 
@@ -717,15 +793,28 @@ int syscall_settimeofday(ThreadState *state)
 int syscall_rt_sigaction(ThreadState *state)
 {
     int signum = GUEST_ARG0(state);
-    const struct sigaction *act = (const struct sigaction *)GUEST_ARG1(state);
-    struct sigaction *oact = (struct sigaction *)GUEST_ARG2(state);
+    const void *act = (const void *)GUEST_ARG1(state);
+    void *oact = (void *)GUEST_ARG2(state);
     size_t sigsetsize = GUEST_ARG3(state);
+    struct sigaction host_act, host_oact;
+
+    if (sigsetsize != sizeof(uint64_t)) {
+        state->syscall_result = -EINVAL;
+        return -1;
+    }
+
+    if (act != NULL) {
+        rosetta_marshal_sigaction_in(act, &host_act);
+    }
 
-    int ret = sigaction(signum, act, oact);
+    int ret = sigaction(signum, act ? &host_act : NULL, oact ? &host_oact : NULL);
     if (ret < 0) {
         state->syscall_result = -errno;
         return -1;
     }
+    if (oact != NULL) {
+        rosetta_marshal_sigaction_out(oact, &host_oact);
+    }
     state->syscall_result = 0;
     return 0;
 }
@@ -824,6 +913,31 @@ int syscall_arch_prctl(ThreadState *state)
  * Extended I/O Syscalls
  * ============================================================================ */
 
+/**
+ * Size of the guest structure an ioctl argument points to, 0 if scalar
+ */
+static size_t ioctl_arg_size(unsigned long request)
+{
+    switch (request) {
+    case 0x5401:    /* TCGETS */
+    case 0x5402:    /* TCSETS */
+    case 0x5403:    /* TCSETSW */
+    case 0x5404:    /* TCSETSF */
+        return 36;  /* struct termios (kernel) */
+    case 0x5413:    /* TIOCGWINSZ */
+    case 0x5414:    /* TIOCSWINSZ */
+        return 8;   /* struct winsize */
+    case 0x540F:    /* TIOCGPGRP */
+    case 0x5410:    /* TIOCSPGRP */
+    case 0x541B:    /* FIONREAD */
+    case 0x5421:    /* FIONBIO */
+        return 4;
+    default:
+        /* Requests built with _IOR/_IOW/_IOWR encode their size */
+        return _IOC_SIZE(request);
+    }
+}
+
 /**
  * syscall_ioctl - Manipulate file descriptor
  */
@@ -832,6 +946,16 @@ int syscall_ioctl(ThreadState *state)
     int fd = GUEST_ARG0(state);
     unsigned long request = GUEST_ARG1(state);
     void *arg = (void *)GUEST_ARG2(state);
+    size_t arg_size = ioctl_arg_size(request);
+
+    /* The argument is a pointer only for some requests */
+    if (arg_size != 0 && arg != NULL) {
+        arg = syscall_guest_ptr(GUEST_ARG2(state), arg_size);
+        if (arg == NULL) {
+            state->syscall_result = -EFAULT;
+            return -1;
+        }
+    }
 
     int ret = ioctl(fd, request, arg);
     if (ret < 0) {
@@ -891,6 +1015,7 @@ int syscall_poll(ThreadState *state)
     nfds_t nfds = GUEST_ARG1(state);
     int timeout = GUEST_ARG2(state);
 
+    /* struct pollfd has the same layout on x86_64 and arm64: zero-copy */
     int ret = poll(fds, nfds, timeout);
     if (ret < 0) {
         state->syscall_result = -errno;
@@ -911,6 +1036,7 @@ int syscall_select(ThreadState *state)
     fd_set *exceptfds = (fd_set *)GUEST_ARG3(state);
     struct timeval *timeout = (struct timeval *)GUEST_ARG4(state);
 
+    /* fd_set and struct timeval match between x86_64 and arm64: zero-copy */
     int ret = select(nfds, readfds, writefds, exceptfds, timeout);
     if (ret < 0) {
         state->syscall_result = -errno;
@@ -926,7 +1052,8 @@ int syscall_select(ThreadState *state)
 int syscall_readv(ThreadState *state)
 {
     int fd = GUEST_ARG0(state);
-    const struct iovec *iov = (const struct iovec *)GUEST_ARG1(state);
+    const struct iovec *iov = rosetta_marshal_iovec_in((const void *)GUEST_ARG1(state),
+                                                       (int)GUEST_ARG2(state));
     int iovcnt = GUEST_ARG2(state);
 
     ssize_t ret = readv(fd, iov, iovcnt);
@@ -944,7 +1071,8 @@ int syscall_readv(ThreadState *state)
 int syscall_writev(ThreadState *state)
 {
     int fd = GUEST_ARG0(state);
-    const struct iovec *iov = (const struct iovec *)GUEST_ARG1(state);
+    const struct iovec *iov = rosetta_marshal_iovec_in((const void *)GUEST_ARG1(state),
+                                                       (int)GUEST_ARG2(state));
     int iovcnt = GUEST_ARG2(state);
 
     ssize_t ret = writev(fd, iov, iovcnt);
@@ -1423,14 +1551,62 @@ int syscall_clone(ThreadState *state)
     return -1;
 }
 
+/**
+ * Translate a NULL-terminated guest pointer vector (argv/envp) to host
+ * @return Host vector, the guest vector itself if guest memory is not
+ *         relocated, or NULL with *err set
+ */
+static char *const *execve_vector(uint64_t guest, rosetta_scratch_slot_t slot, int *err)
+{
+    const uint64_t *gvec;
+    char **hvec = NULL;
+    size_t n = 0, cap = 0;
+
+    if (syscall_get_guest_memory() == NULL || guest == 0) {
+        return (char *const *)guest;
+    }
+
+    for (;;) {
+        gvec = syscall_guest_ptr(guest + n * sizeof(uint64_t), sizeof(uint64_t));
+        if (gvec == NULL) {
+            *err = -EFAULT;
+            return NULL;
+        }
+        if (n + 1 > cap) {
+            cap = cap ? cap * 2 : 64;
+            hvec = rosetta_marshal_scratch(slot, cap * sizeof(char *));
+            if (hvec == NULL) {
+                *err = -ENOMEM;
+                return NULL;
+            }
+        }
+        if (*gvec == 0) {
+            hvec[n] = NULL;
+            return hvec;
+        }
+        hvec[n] = syscall_guest_ptr(*gvec, 1);
+        if (hvec[n] == NULL) {
+            *err = -EFAULT;
+            return NULL;
+        }
+        n++;
+    }
+}
+
 /**
  * syscall_execve - Execute program
  */
 int syscall_execve(ThreadState *state)
 {
     const char *pathname = (const char *)GUEST_ARG0(state);
-    char *const *argv = (char *const *)GUEST_ARG1(state);
-    char *const *envp = (char *const *)GUEST_ARG2(state);
+    int err = 0;
+    char *const *argv = execve_vector(GUEST_ARG1(state), ROSETTA_SCRATCH_ARGV, &err);
+    char *const *envp = execve_vector(GUEST_ARG2(state), ROSETTA_SCRATCH_ENVP, &err);
+
+    if (err < 0) {
+        state->syscall_result = err;
+        return -1;
+    }
 
     int ret = execve(pathname, argv, envp);
     if (ret < 0) {
@@ -1573,10 +1749,11 @@ int syscall_epoll_ctl(ThreadState *state)
     int epfd = GUEST_ARG0(state);
     int op = GUEST_ARG1(state);
     int fd = GUEST_ARG2(state);
-    struct epoll_event *event = (struct epoll_event *)GUEST_ARG3(state);
+    const void *event = (const void *)GUEST_ARG3(state);
 
 #ifdef __linux__
-    int ret = epoll_ctl(epfd, op, fd, event);
+    struct epoll_event host_event;
+    int ret = epoll_ctl(epfd, op, fd, rosetta_marshal_epoll_event_in(event, &host_event));
     if (ret < 0) {
         state->syscall_result = -errno;
         return -1;
@@ -1599,16 +1776,77 @@ int syscall_epoll_ctl(ThreadState *state)
 int syscall_epoll_wait(ThreadState *state)
 {
     int epfd = GUEST_ARG0(state);
-    struct epoll_event *events = (struct epoll_event *)GUEST_ARG1(state);
+    void *events = (void *)GUEST_ARG1(state);
+    int maxevents = GUEST_ARG2(state);
+    int timeout = GUEST_ARG3(state);
+
+#ifdef __linux__
+    struct epoll_event *host_events = rosetta_marshal_epoll_events_buf(events, maxevents);
+    if (host_events == NULL && maxevents > 0) {
+        state->syscall_result = -ENOMEM;
+        return -1;
+    }
+
+    int ret = epoll_wait(epfd, host_events, maxevents, timeout);
+    if (ret < 0) {
+        state->syscall_result = -errno;
+        return -1;
+    }
+    rosetta_marshal_epoll_events_out(events, host_events, ret);
+    state->syscall_result = ret;
+    return 0;
+#else
+    (void)epfd;
+    (void)events;
+    (void)maxevents;
+    (void)timeout;
+    state->syscall_result = -38;  /* ENOSYS */
+    return -1;
+#endif
+}
+
+/**
+ * syscall_epoll_pwait - Wait for events with a temporary signal mask
+ */
+int syscall_epoll_pwait(ThreadState *state)
+{
+    int epfd = GUEST_ARG0(state);
+    void *events = (void *)GUEST_ARG1(state);
     int maxevents = GUEST_ARG2(state);
     int timeout = GUEST_ARG3(state);
+    const uint64_t *guest_mask = (const uint64_t *)GUEST_ARG4(state);
+    size_t sigsetsize = GUEST_ARG5(state);
 
 #ifdef __linux__
-    int ret = epoll_wait(epfd, events, maxevents, timeout);
+    sigset_t host_mask;
+    int sig;
+
+    if (guest_mask != NULL && sigsetsize != sizeof(uint64_t)) {
+        state->syscall_result = -EINVAL;
+        return -1;
+    }
+
+    /* The guest passes the 64-bit kernel sigset; signal numbers match */
+    sigemptyset(&host_mask);
+    for (sig = 1; guest_mask != NULL && sig <= 64; sig++) {
+        if ((*guest_mask >> (sig - 1)) & 1) {
+            sigaddset(&host_mask, sig);
+        }
+    }
+
+    struct epoll_event *host_events = rosetta_marshal_epoll_events_buf(events, maxevents);
+    if (host_events == NULL && maxevents > 0) {
+        state->syscall_result = -ENOMEM;
+        return -1;
+    }
+
+    int ret = epoll_pwait(epfd, host_events, maxevents, timeout,
+                          guest_mask != NULL ? &host_mask : NULL);
     if (ret < 0) {
         state->syscall_result = -errno;
         return -1;
     }
+    rosetta_marshal_epoll_events_out(events, host_events, ret);
     state->syscall_result = ret;
     return 0;
 #else
@@ -1616,6 +1854,8 @@ int syscall_epoll_wait(ThreadState *state)
     (void)events;
     (void)maxevents;
     (void)timeout;
+    (void)guest_mask;
+    (void)sigsetsize;
     state->syscall_result = -38;  /* ENOSYS */
     return -1;
 #endif
@@ -1986,14 +2226,17 @@ int syscall_newfstatat(ThreadState *state)
 {
     int dirfd = GUEST_ARG0(state);
     const char *pathname = (const char *)GUEST_ARG1(state);
-    struct stat *statbuf = (struct stat *)GUEST_ARG2(state);
+    void *statbuf = (void *)GUEST_ARG2(state);
     int flags = GUEST_ARG3(state);
 
-    int ret = fstatat(dirfd, pathname, statbuf, flags);
+    struct stat *host_stat = rosetta_marshal_stat_buf(statbuf);
+
+    int ret = fstatat(dirfd, pathname, host_stat, flags);
     if (ret < 0) {
         state->syscall_result = -errno;
         return -1;
     }
+    rosetta_marshal_stat_out(statbuf, host_stat);
     state->syscall_result = 0;
     return 0;
 }
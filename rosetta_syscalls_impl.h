@@ -22,6 +22,12 @@ int syscall_read(ThreadState *state);
 /* Write to file descriptor */
 int syscall_write(ThreadState *state);
 
+/* Read from file descriptor at offset */
+int syscall_pread64(ThreadState *state);
+
+/* Write to file descriptor at offset */
+int syscall_pwrite64(ThreadState *state);
+
 /* Open a file */
 int syscall_open(ThreadState *state);
 
@@ -308,6 +314,9 @@ int syscall_epoll_ctl(ThreadState *state);
 /* Wait for events on an epoll instance */
 int syscall_epoll_wait(ThreadState *state);
 
+/* Wait for events with a temporary signal mask */
+int syscall_epoll_pwait(ThreadState *state);
+
 /* ============================================================================
  * Memory Management Helpers
  * ============================================================================ */
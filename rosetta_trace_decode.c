@@ -0,0 +1,31 @@
+/*
+ * Rosetta Trace Decoder - Binary Trace File to Text
+ *
+ * Turns a file written by rosetta_trace_open() back into one line per
+ * event, merged across threads in time order.
+ *
+ * Usage: ./rosetta_trace_decode <trace-file>
+ */
+
+#include "rosetta_refactored_debug.h"
+#include <stdio.h>
+#include <string.h>
+
+int main(int argc, char **argv)
+{
+    long count;
+
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s <trace-file>\n", argv[0]);
+        return 2;
+    }
+
+    count = rosetta_trace_decode(argv[1], stdout);
+    if (count < 0) {
+        fprintf(stderr, "%s: %s\n", argv[1], strerror((int)-count));
+        return 1;
+    }
+
+    fprintf(stderr, "%ld events\n", count);
+    return 0;
+}
@@ -249,9 +249,9 @@ void save_fp_context(uint64_t *save)
         save[i * 2] = 0;      /* Would save register low */
         save[i * 2 + 1] = 0;  /* Would save register high */
     }
-    /* Save FPSR and FPCR */
-    save[64] = 0;  /* FPSR */
-    save[65] = 0;  /* FPCR */
+    /* Save FPSR and FPCR (the guest MXCSR flags and rounding mode, see rosetta_mxcsr.h) */
+    save[64] = read_fpsr();
+    save[65] = read_fpcr();
 }
 
 /**
@@ -260,8 +260,11 @@ void save_fp_context(uint64_t *save)
 void restore_fp_context(uint64_t *save)
 {
     /* Restore all 32 SIMD/FP registers */
-    (void)save;
     /* Would restore registers from saved state */
+
+    /* Restore FPSR and FPCR */
+    write_fpsr((uint32_t)save[64]);
+    write_fpcr((uint32_t)save[65]);
 }
 
 /**
@@ -1,51 +1,289 @@
 /* ============================================================================
  * Rosetta Translator - String Operations Implementation
+ * ============================================================================
+ *
+ * REP forms hand whole runs to the SIMD kernels in rosetta_string_simd.c
+ * once they reach STRING_BULK_MIN_BYTES; shorter runs and the cases the
+ * kernels cannot express stay in per-size element loops.
+ *
+ * Translated code reaches the helpers through translate_string_emit(),
+ * which spills the guest registers into ThreadState.host.x[] around a call.
  * ============================================================================ */
 
 #include "rosetta_trans_string.h"
+#include "rosetta_string_simd.h"
+#include "rosetta_arm64_emit.h"
+#include "rosetta_exec_context.h"
+#include <errno.h>
+#include <signal.h>
+#include <stddef.h>
+#include <string.h>
+
+/* Guest memory window, or NULL when guest addresses are host addresses */
+static rosetta_memmgr_t *string_guest_mem;
+
+void translate_string_set_guest_memory(rosetta_memmgr_t *mgr)
+{
+    string_guest_mem = mgr;
+}
+
+/**
+ * Host address of a string operand at guest_addr covering count elements,
+ * walking down from guest_addr when df is set
+ * Returns: NULL if any element is outside guest memory
+ */
+static uint8_t *memory_translate_addr(uint64_t guest_addr, uint64_t count, int size, int df)
+{
+    uint64_t span = (count ? count - 1 : 0) * (uint64_t)size;
+    uint64_t low = df ? guest_addr - span : guest_addr;
+    uint8_t *host;
+
+    if (string_guest_mem == NULL) {
+        return (uint8_t *)(uintptr_t)guest_addr;
+    }
+    if (count > UINT64_MAX / (uint64_t)size) {
+        return NULL;
+    }
+
+    host = rosetta_memmgr_guest_range(string_guest_mem, low, span + (uint64_t)size);
+    return host ? host + (guest_addr - low) : NULL;
+}
+
+/**
+ * Elements a scan may visit from guest_addr before leaving guest memory
+ */
+static uint64_t string_scan_limit(uint64_t guest_addr, uint64_t count, int size, int df)
+{
+    uint64_t offset, avail;
+
+    if (string_guest_mem == NULL || count == 0) {
+        return count;
+    }
+
+    offset = guest_addr - string_guest_mem->guest_base;
+    if (offset > string_guest_mem->total_size - (uint64_t)size) {
+        return 0;
+    }
+    avail = df ? offset / (uint64_t)size + 1
+               : (string_guest_mem->total_size - offset) / (uint64_t)size;
+    return avail < count ? avail : count;
+}
+
+/* ============================================================================
+ * Element Helpers
+ * ============================================================================ */
+
+static inline int string_df(const ThreadState *state)
+{
+    return (state->guest.rflags & STRING_RFLAGS_DF) != 0;
+}
+
+static inline uint64_t string_load(const uint8_t *p, int size)
+{
+    switch (size) {
+        case 1: return *(const uint8_t *)p;
+        case 2: return *(const uint16_t *)p;
+        case 4: return *(const uint32_t *)p;
+        default: return *(const uint64_t *)p;
+    }
+}
+
+static inline void string_store(uint8_t *p, uint64_t val, int size)
+{
+    switch (size) {
+        case 1: *(uint8_t *)p = (uint8_t)val; break;
+        case 2: *(uint16_t *)p = (uint16_t)val; break;
+        case 4: *(uint32_t *)p = (uint32_t)val; break;
+        default: *(uint64_t *)p = val; break;
+    }
+}
+
+#define STRING_COPY_LOOP(type) \
+    for (; count >= 4; count -= 4) { \
+        *(type *)(d) = *(const type *)(s); \
+        *(type *)(d + step) = *(const type *)(s + step); \
+        *(type *)(d + 2 * step) = *(const type *)(s + 2 * step); \
+        *(type *)(d + 3 * step) = *(const type *)(s + 3 * step); \
+        d += 4 * step; \
+        s += 4 * step; \
+    } \
+    for (; count > 0; count--) { \
+        *(type *)d = *(const type *)s; \
+        d += step; \
+        s += step; \
+    }
+
+/**
+ * Copy element by element in REP MOVS order, unrolled by four
+ */
+static void string_copy_elements(uint8_t *d, const uint8_t *s, uint64_t count,
+                                 int size, int64_t step)
+{
+    switch (size) {
+        case 1: STRING_COPY_LOOP(uint8_t); break;
+        case 2: STRING_COPY_LOOP(uint16_t); break;
+        case 4: STRING_COPY_LOOP(uint32_t); break;
+        default: STRING_COPY_LOOP(uint64_t); break;
+    }
+}
 
-static void *memory_translate_addr(uint64_t guest_addr);
+/* ============================================================================
+ * Bulk Kernels
+ * ============================================================================ */
 
-static void *memory_translate_addr(uint64_t guest_addr)
+/**
+ * Extend the pattern in base[0, period) upwards to base[0, total)
+ *
+ * Each copy doubles the valid prefix, so the source and destination of one
+ * memcpy never overlap.
+ */
+static void string_replicate_up(uint8_t *base, size_t period, size_t total)
 {
-    return (void *)(uintptr_t)guest_addr;
+    size_t have = period;
+
+    while (have < total) {
+        size_t n = have < total - have ? have : total - have;
+        rosetta_memcpy_simd(base + have, base, n);
+        have += n;
+    }
+}
+
+/**
+ * Extend the pattern in [top - period, top) downwards to [top - total, top)
+ */
+static void string_replicate_down(uint8_t *top, size_t period, size_t total)
+{
+    size_t have = period;
+
+    while (have < total) {
+        size_t n = have < total - have ? have : total - have;
+        rosetta_memcpy_simd(top - have - n, top - n, n);
+        have += n;
+    }
 }
 
-int translate_movs(ThreadState *state, const uint8_t *insn, int size, bool rep, uint32_t ecx)
+/**
+ * Copy a REP MOVS run given the lowest address of each range
+ *
+ * REP MOVS copies one element at a time, so an overlap against the copy
+ * direction repeats the first (or last) dist bytes rather than moving the
+ * block. That is what memmove cannot express and what the replicate
+ * helpers produce. A distance below the element size mixes old and new
+ * bytes inside one element and is left to the element loop.
+ */
+static void string_bulk_copy(uint8_t *dst, const uint8_t *src, size_t bytes,
+                             int size, int df)
+{
+    size_t dist;
+
+    if (dst == src) {
+        return;
+    }
+    if (dst + bytes <= src || src + bytes <= dst) {
+        rosetta_memcpy_simd(dst, src, bytes);
+        return;
+    }
+    if (df ? dst > src : dst < src) {
+        rosetta_memmove_simd(dst, src, bytes);  /* Copy order is safe */
+        return;
+    }
+
+    dist = df ? (size_t)(src - dst) : (size_t)(dst - src);
+    if (dist < (size_t)size) {
+        if (df) {
+            string_copy_elements(dst + bytes - size, src + bytes - size,
+                                 bytes / size, size, -size);
+        } else {
+            string_copy_elements(dst, src, bytes / size, size, size);
+        }
+    } else if (df) {
+        string_replicate_down((uint8_t *)src + bytes, dist, bytes + dist);
+    } else {
+        string_replicate_up((uint8_t *)src, dist, bytes + dist);
+    }
+}
+
+/**
+ * Fill a REP STOS run given its lowest address
+ */
+static void string_bulk_fill(uint8_t *dst, uint64_t val, size_t bytes, int size)
+{
+    uint64_t splat = (val & 0xFF) * 0x0101010101010101ULL;
+    uint64_t mask = size == 8 ? ~0ULL : (1ULL << (size * 8)) - 1;
+
+    if (((val ^ splat) & mask) == 0) {
+        rosetta_memset_simd(dst, (int)(val & 0xFF), bytes);
+        return;
+    }
+    string_store(dst, val, size);
+    string_replicate_up(dst, (size_t)size, bytes);
+}
+
+/**
+ * Index of the first differing byte in a[0, n), or n if equal
+ */
+static size_t string_mismatch(const uint8_t *a, const uint8_t *b, size_t n)
+{
+    size_t off = 0;
+
+    while (n - off >= STRING_BULK_MIN_BYTES) {
+        if (rosetta_memcmp_simd(a + off, b + off, STRING_BULK_MIN_BYTES) != 0) {
+            break;
+        }
+        off += STRING_BULK_MIN_BYTES;
+    }
+    while (off < n && a[off] == b[off]) {
+        off++;
+    }
+    return off;
+}
+
+static void string_set_flags(ThreadState *state, uint64_t a, uint64_t b)
+{
+    uint64_t result = a - b;
+    uint64_t nzcv = 0;
+
+    if (result & (1ULL << 63)) nzcv |= (1ULL << 31);
+    if (result == 0) nzcv |= (1ULL << 30);
+    state->host.pstate = nzcv;
+}
+
+/* ============================================================================
+ * String Translation Functions
+ * ============================================================================ */
+
+int translate_movs(ThreadState *state, const uint8_t *insn, int size, bool rep, uint64_t rcx)
 {
     uint64_t rsi = state->host.x[6];  /* RSI */
     uint64_t rdi = state->host.x[7];  /* RDI */
-    uint32_t count = rep ? ecx : 1;
-    int df = (state->host.pstate >> 27) & 1;  /* Direction flag (stub) */
-    int step = df ? -size : size;
+    uint64_t count = rep ? rcx : 1;
+    int df = string_df(state);
+    int64_t step = df ? -size : size;
+    size_t bytes = (size_t)count * size;
 
-    void *src_addr = memory_translate_addr(rsi);
-    void *dst_addr = memory_translate_addr(rdi);
+    uint8_t *src_addr, *dst_addr;
 
+    (void)insn;
+    if (count == 0) {
+        state->host.x[1] = 0;
+        return 0;
+    }
+    src_addr = memory_translate_addr(rsi, count, size, df);
+    dst_addr = memory_translate_addr(rdi, count, size, df);
     if (src_addr == NULL || dst_addr == NULL) {
         return -1;
     }
 
-    for (uint32_t i = 0; i < count; i++) {
-        uint64_t val = 0;
-        switch (size) {
-            case 1: val = *(uint8_t *)src_addr; break;
-            case 2: val = *(uint16_t *)src_addr; break;
-            case 4: val = *(uint32_t *)src_addr; break;
-            case 8: val = *(uint64_t *)src_addr; break;
-        }
-        switch (size) {
-            case 1: *(uint8_t *)dst_addr = (uint8_t)val; break;
-            case 2: *(uint16_t *)dst_addr = (uint16_t)val; break;
-            case 4: *(uint32_t *)dst_addr = (uint32_t)val; break;
-            case 8: *(uint64_t *)dst_addr = val; break;
-        }
-        src_addr = (uint8_t *)src_addr + step;
-        dst_addr = (uint8_t *)dst_addr + step;
+    if (bytes >= STRING_BULK_MIN_BYTES) {
+        /* DF=1 walks down from RSI/RDI, so the run starts count-1 below */
+        uint64_t low = df ? (count - 1) * size : 0;
+        string_bulk_copy(dst_addr - low, src_addr - low, bytes, size, df);
+    } else {
+        string_copy_elements(dst_addr, src_addr, count, size, step);
     }
 
-    state->host.x[6] = (uint64_t)src_addr;
-    state->host.x[7] = (uint64_t)dst_addr;
+    state->host.x[6] = rsi + (uint64_t)(step * count);
+    state->host.x[7] = rdi + (uint64_t)(step * count);
 
     if (rep) {
         state->host.x[1] = 0;  /* RCX = 0 */
@@ -54,30 +292,39 @@ int translate_movs(ThreadState *state, const uint8_t *insn, int size, bool rep,
     return 0;
 }
 
-int translate_stos(ThreadState *state, const uint8_t *insn, int size, bool rep, uint32_t ecx)
+int translate_stos(ThreadState *state, const uint8_t *insn, int size, bool rep, uint64_t rcx)
 {
     uint64_t rdi = state->host.x[7];  /* RDI */
     uint64_t rax = state->host.x[0];  /* RAX */
-    uint32_t count = rep ? ecx : 1;
-    int df = (state->host.pstate >> 27) & 1;
-    int step = df ? -size : size;
+    uint64_t count = rep ? rcx : 1;
+    int df = string_df(state);
+    int64_t step = df ? -size : size;
+    size_t bytes = (size_t)count * size;
 
-    void *dst_addr = memory_translate_addr(rdi);
+    uint8_t *dst_addr;
+
+    (void)insn;
+    if (count == 0) {
+        state->host.x[1] = 0;
+        return 0;
+    }
+    dst_addr = memory_translate_addr(rdi, count, size, df);
     if (dst_addr == NULL) {
         return -1;
     }
 
-    for (uint32_t i = 0; i < count; i++) {
-        switch (size) {
-            case 1: *(uint8_t *)dst_addr = (uint8_t)rax; break;
-            case 2: *(uint16_t *)dst_addr = (uint16_t)rax; break;
-            case 4: *(uint32_t *)dst_addr = (uint32_t)rax; break;
-            case 8: *(uint64_t *)dst_addr = rax; break;
+    if (bytes >= STRING_BULK_MIN_BYTES) {
+        /* Filling is order-independent; only the start address depends on DF */
+        uint64_t low = df ? (count - 1) * size : 0;
+        string_bulk_fill(dst_addr - low, rax, bytes, size);
+    } else {
+        for (uint64_t i = 0; i < count; i++) {
+            string_store(dst_addr, rax, size);
+            dst_addr += step;
         }
-        dst_addr = (uint8_t *)dst_addr + step;
     }
 
-    state->host.x[7] = (uint64_t)dst_addr;
+    state->host.x[7] = rdi + (uint64_t)(step * count);
 
     if (rep) {
         state->host.x[1] = 0;
@@ -86,31 +333,27 @@ int translate_stos(ThreadState *state, const uint8_t *insn, int size, bool rep,
     return 0;
 }
 
-int translate_lods(ThreadState *state, const uint8_t *insn, int size, bool rep, uint32_t ecx)
+int translate_lods(ThreadState *state, const uint8_t *insn, int size, bool rep, uint64_t rcx)
 {
     uint64_t rsi = state->host.x[6];  /* RSI */
-    uint32_t count = rep ? ecx : 1;
-    int df = (state->host.pstate >> 27) & 1;
-    int step = df ? -size : size;
+    uint64_t count = rep ? rcx : 1;
+    int df = string_df(state);
+    int64_t step = df ? -size : size;
+
+    uint8_t *src_addr;
 
-    void *src_addr = memory_translate_addr(rsi);
+    (void)insn;
+    if (count == 0) {
+        return 0;
+    }
+    src_addr = memory_translate_addr(rsi, count, size, df);
     if (src_addr == NULL) {
         return -1;
     }
 
-    uint64_t val = 0;
-    for (uint32_t i = 0; i < count; i++) {
-        switch (size) {
-            case 1: val = *(uint8_t *)src_addr; break;
-            case 2: val = *(uint16_t *)src_addr; break;
-            case 4: val = *(uint32_t *)src_addr; break;
-            case 8: val = *(uint64_t *)src_addr; break;
-        }
-        src_addr = (uint8_t *)src_addr + step;
-    }
-
-    state->host.x[0] = val;  /* RAX */
-    state->host.x[6] = (uint64_t)src_addr;
+    /* Only the last element loaded survives in RAX */
+    state->host.x[0] = string_load(src_addr + step * (int64_t)(count - 1), size);
+    state->host.x[6] = rsi + (uint64_t)(step * count);
 
     if (rep) {
         state->host.x[1] = 0;
@@ -119,81 +362,247 @@ int translate_lods(ThreadState *state, const uint8_t *insn, int size, bool rep,
     return 0;
 }
 
-int translate_cmps(ThreadState *state, const uint8_t *insn, int size, bool rep, uint32_t ecx)
+/*
+ * CMPS and SCAS take a single rep flag: CMPS repeats while equal (REPE) and
+ * SCAS while not equal (REPNE), the forms compilers emit for memcmp and
+ * strlen/memchr. RCX is left at the count still to go.
+ */
+
+int translate_cmps(ThreadState *state, const uint8_t *insn, int size, bool rep, uint64_t rcx)
 {
     uint64_t rsi = state->host.x[6];
     uint64_t rdi = state->host.x[7];
-    uint32_t count = rep ? ecx : 1;
-    int df = (state->host.pstate >> 27) & 1;
-    int step = df ? -size : size;
-
-    void *src_addr = memory_translate_addr(rsi);
-    void *dst_addr = memory_translate_addr(rdi);
+    uint64_t count = rep ? rcx : 1;
+    int df = string_df(state);
+    int64_t step = df ? -size : size;
+    uint64_t a = 0, b = 0;
+    uint64_t done = 0;
+    uint64_t limit, lim_src, lim_dst;
+    uint8_t *src_addr, *dst_addr;
+
+    (void)insn;
+    if (count == 0) {
+        return 0;               /* Flags unchanged */
+    }
 
-    if (src_addr == NULL || dst_addr == NULL) {
+    /* The scan may stop early, so only what it can reach must be mapped */
+    lim_src = string_scan_limit(rsi, count, size, df);
+    lim_dst = string_scan_limit(rdi, count, size, df);
+    limit = lim_src < lim_dst ? lim_src : lim_dst;
+    src_addr = memory_translate_addr(rsi, limit, size, df);
+    dst_addr = memory_translate_addr(rdi, limit, size, df);
+    if (limit == 0 || src_addr == NULL || dst_addr == NULL) {
         return -1;
     }
 
-    uint64_t result = 0;
-    for (uint32_t i = 0; i < count; i++) {
-        uint64_t a = 0, b = 0;
-        switch (size) {
-            case 1: a = *(uint8_t *)src_addr; b = *(uint8_t *)dst_addr; break;
-            case 2: a = *(uint16_t *)src_addr; b = *(uint16_t *)dst_addr; break;
-            case 4: a = *(uint32_t *)src_addr; b = *(uint32_t *)dst_addr; break;
-            case 8: a = *(uint64_t *)src_addr; b = *(uint64_t *)dst_addr; break;
+    if (size == 1 && !df && limit >= STRING_BULK_MIN_BYTES) {
+        size_t idx = string_mismatch(src_addr, dst_addr, limit);
+        if (idx == limit) {
+            idx--;
         }
-        result = a - b;
-        if (rep && result != 0) break;
-        src_addr = (uint8_t *)src_addr + step;
-        dst_addr = (uint8_t *)dst_addr + step;
+        a = src_addr[idx];
+        b = dst_addr[idx];
+        done = (uint64_t)idx + 1;
+    } else {
+        while (done < limit) {
+            a = string_load(src_addr + step * (int64_t)done, size);
+            b = string_load(dst_addr + step * (int64_t)done, size);
+            done++;
+            if (a != b) break;
+        }
+    }
+    if (done == limit && limit < count && a == b) {
+        return -1;              /* Would run off guest memory */
     }
 
-    /* Update flags */
-    uint64_t nzcv = 0;
-    if (result & (1ULL << 63)) nzcv |= (1ULL << 31);
-    if (result == 0) nzcv |= (1ULL << 30);
+    string_set_flags(state, a, b);
+    state->host.x[6] = rsi + (uint64_t)(step * done);
+    state->host.x[7] = rdi + (uint64_t)(step * done);
 
-    state->host.pstate = nzcv;
-    state->host.x[6] = (uint64_t)src_addr;
-    state->host.x[7] = (uint64_t)dst_addr;
+    if (rep) {
+        state->host.x[1] = count - done;
+    }
 
     return 0;
 }
 
-int translate_scas(ThreadState *state, const uint8_t *insn, int size, bool rep, uint32_t ecx)
+int translate_scas(ThreadState *state, const uint8_t *insn, int size, bool rep, uint64_t rcx)
 {
     uint64_t rdi = state->host.x[7];
     uint64_t rax = state->host.x[0];
-    uint32_t count = rep ? ecx : 1;
-    int df = (state->host.pstate >> 27) & 1;
-    int step = df ? -size : size;
+    uint64_t count = rep ? rcx : 1;
+    int df = string_df(state);
+    int64_t step = df ? -size : size;
+    uint64_t mask = size == 8 ? ~0ULL : (1ULL << (size * 8)) - 1;
+    uint64_t val = 0;
+    uint64_t done = 0;
+    uint64_t limit;
+    uint8_t *dst_addr;
 
-    void *dst_addr = memory_translate_addr(rdi);
-    if (dst_addr == NULL) {
+    (void)insn;
+    if (count == 0) {
+        return 0;
+    }
+
+    /* REPNE SCAS usually runs with RCX = -1: map only what the scan reaches */
+    limit = string_scan_limit(rdi, count, size, df);
+    dst_addr = memory_translate_addr(rdi, limit, size, df);
+    if (limit == 0 || dst_addr == NULL) {
         return -1;
     }
 
-    uint64_t result = 0;
-    for (uint32_t i = 0; i < count; i++) {
-        uint64_t val = 0;
-        switch (size) {
-            case 1: val = *(uint8_t *)dst_addr; break;
-            case 2: val = *(uint16_t *)dst_addr; break;
-            case 4: val = *(uint32_t *)dst_addr; break;
-            case 8: val = *(uint64_t *)dst_addr; break;
+    if (size == 1 && !df && limit >= STRING_BULK_MIN_BYTES) {
+        const uint8_t *hit = rosetta_memchr_simd(dst_addr, (int)(rax & 0xFF), limit);
+        done = hit ? (uint64_t)(hit - dst_addr) + 1 : limit;
+        val = dst_addr[done - 1];
+    } else {
+        while (done < limit) {
+            val = string_load(dst_addr + step * (int64_t)done, size);
+            done++;
+            if (val == (rax & mask)) break;
         }
-        result = rax - val;
-        if (rep && result == 0) break;
-        dst_addr = (uint8_t *)dst_addr + step;
+    }
+    if (done == limit && limit < count && val != (rax & mask)) {
+        return -1;              /* Would run off guest memory */
     }
 
-    uint64_t nzcv = 0;
-    if (result & (1ULL << 63)) nzcv |= (1ULL << 31);
-    if (result == 0) nzcv |= (1ULL << 30);
+    string_set_flags(state, rax & mask, val);
+    state->host.x[7] = rdi + (uint64_t)(step * done);
 
-    state->host.pstate = nzcv;
-    state->host.x[7] = (uint64_t)dst_addr;
+    if (rep) {
+        state->host.x[1] = count - done;
+    }
+
+    return 0;
+}
+
+/* ============================================================================
+ * Code Emission
+ * ============================================================================ */
+
+#define STRING_XSTATE       16      /* ThreadState, then &host.x[0] */
+#define STRING_XTARGET      17      /* Helper, then its result */
+#define STRING_XCTX         18      /* rosetta_exec_context_t */
+#define STRING_XLR          30
+#define STRING_HOST_X       offsetof(ThreadState, host.x)
+#define STRING_PENDING      offsetof(ThreadState, pending_signals)
+#define STRING_FAULT_BIT    (1u << (SIGSEGV - 1))
+
+#define A64_MRS_NZCV        0xD53B4200u
+#define A64_MSR_NZCV        0xD51B4200u
+#define A64_MOV_W           0x2A0003E0u     /* MOV Wd, Wm */
+#define A64_LDR_W           0xB9400000u     /* LDR Wt, [Xn, #imm] */
+#define A64_STR_W           0xB9000000u     /* STR Wt, [Xn, #imm] */
+#define A64_ORR_W_SEGV      0x32160000u     /* ORR Wd, Wn, #STRING_FAULT_BIT */
+#define STRING_FAULT_WORDS  10              /* Words of the fault exit */
+
+_Static_assert(offsetof(ThreadState, host.x) < 4096, "host.x must be reachable with ADD #imm");
+_Static_assert(SIGSEGV == 11, "A64_ORR_W_SEGV encodes bit 10");
+_Static_assert(offsetof(ThreadState, pending_signals) % 4 == 0 &&
+               offsetof(ThreadState, pending_signals) < 16384,
+               "pending_signals must be reachable with LDR W #imm");
+
+typedef int (*string_helper_t)(ThreadState *, const uint8_t *, int, bool, uint64_t);
+
+/* Element size: byte forms are the even opcodes, then REX.W, then 66 */
+static int string_operand_size(const x86_insn_t *insn)
+{
+    if ((insn->opcode & 1) == 0) {
+        return 1;
+    }
+    if (insn->rex & 0x08) {
+        return 8;
+    }
+    return insn->has_opsize ? 2 : 4;
+}
+
+/**
+ * Leave the block at pc with SIGSEGV pending, for a run the helper refused
+ */
+static void string_emit_fault(code_buffer_t *code_buf, uint64_t pc)
+{
+    emit_ldr_uoff(code_buf, STRING_XSTATE, STRING_XCTX, offsetof(rosetta_exec_context_t, state));
+    emit_movz(code_buf, STRING_XTARGET, (uint16_t)pc, 0);
+    emit_movk(code_buf, STRING_XTARGET, (uint16_t)(pc >> 16), 1);
+    emit_movk(code_buf, STRING_XTARGET, (uint16_t)(pc >> 32), 2);
+    emit_movk(code_buf, STRING_XTARGET, (uint16_t)(pc >> 48), 3);
+    emit_str_uoff(code_buf, STRING_XTARGET, STRING_XSTATE, offsetof(ThreadState, guest.rip));
+    emit_arm64_insn(code_buf, A64_LDR_W | (uint32_t)(STRING_PENDING / 4) << 10 |
+                              STRING_XSTATE << 5 | STRING_XTARGET);
+    emit_arm64_insn(code_buf, A64_ORR_W_SEGV | STRING_XTARGET << 5 | STRING_XTARGET);
+    emit_arm64_insn(code_buf, A64_STR_W | (uint32_t)(STRING_PENDING / 4) << 10 |
+                              STRING_XSTATE << 5 | STRING_XTARGET);
+    emit_ret(code_buf);
+}
+
+int translate_string_emit(code_buffer_t *code_buf, const x86_insn_t *insn, uint64_t pc)
+{
+    string_helper_t helper;
+    int rep = insn->simd_prefix == 0xF3 || insn->simd_prefix == 0xF2;
+    int i;
+
+    if (x86_is_movs(insn)) {
+        helper = translate_movs;
+    } else if (x86_is_stos(insn)) {
+        helper = translate_stos;
+    } else if (x86_is_lods(insn)) {
+        helper = translate_lods;
+    } else if (x86_is_cmps(insn)) {
+        /* The helper repeats CMPS while equal and SCAS while not equal */
+        if (insn->simd_prefix == 0xF2) {
+            return -ENOTSUP;
+        }
+        helper = translate_cmps;
+    } else if (x86_is_scas(insn)) {
+        if (insn->simd_prefix == 0xF3) {
+            return -ENOTSUP;
+        }
+        helper = translate_scas;
+    } else {
+        return -ENOENT;
+    }
+
+    /* Keep the execution context, return address and guest XMM0-15, save NZCV to pstate */
+    emit_stp_pre(code_buf, STRING_XCTX, STRING_XLR, 31, -16);
+    emit_push_q0_q15(code_buf);
+    emit_ldr_uoff(code_buf, STRING_XSTATE, STRING_XCTX, offsetof(rosetta_exec_context_t, state));
+    emit_arm64_insn(code_buf, A64_MRS_NZCV | STRING_XTARGET);
+    emit_str_uoff(code_buf, STRING_XTARGET, STRING_XSTATE, offsetof(ThreadState, host.pstate));
+
+    /* Guest register n lives in Xn; the helpers read it from host.x[n] */
+    emit_add_imm(code_buf, STRING_XSTATE, STRING_XSTATE, STRING_HOST_X);
+    for (i = 0; i < 16; i += 2) {
+        emit_stp_off(code_buf, i, i + 1, STRING_XSTATE, i * 8);
+    }
+
+    /* helper(state, NULL, size, rep, RCX), with ECX zero-extended under 0x67 */
+    if (insn->has_addrsize) {
+        emit_arm64_insn(code_buf, A64_MOV_W | 1 << 16 | 4);
+    } else {
+        emit_mov_reg(code_buf, 4, 1);
+    }
+    emit_sub_imm(code_buf, 0, STRING_XSTATE, STRING_HOST_X);
+    emit_movz(code_buf, 1, 0, 0);
+    emit_movz(code_buf, 2, (uint16_t)string_operand_size(insn), 0);
+    emit_movz(code_buf, 3, (uint16_t)rep, 0);
+    emit_mov_imm64(code_buf, STRING_XTARGET, (uint64_t)(uintptr_t)helper);
+    emit_blr(code_buf, STRING_XTARGET);
+    emit_arm64_insn(code_buf, A64_MOV_W | 0 << 16 | STRING_XTARGET);
+
+    /* Reload the registers and NZCV the helper updated; X0 is free until the LDPs */
+    emit_pop_q0_q15(code_buf);
+    emit_ldp_post(code_buf, STRING_XCTX, STRING_XLR, 31, 16);
+    emit_ldr_uoff(code_buf, STRING_XSTATE, STRING_XCTX, offsetof(rosetta_exec_context_t, state));
+    emit_ldr_uoff(code_buf, 0, STRING_XSTATE, offsetof(ThreadState, host.pstate));
+    emit_arm64_insn(code_buf, A64_MSR_NZCV | 0);
+    emit_add_imm(code_buf, STRING_XSTATE, STRING_XSTATE, STRING_HOST_X);
+    for (i = 0; i < 16; i += 2) {
+        emit_ldp_off(code_buf, i, i + 1, STRING_XSTATE, i * 8);
+    }
+
+    /* -1: the run left guest memory and nothing changed */
+    emit_cbz(code_buf, STRING_XTARGET, (STRING_FAULT_WORDS + 1) * 4);
+    string_emit_fault(code_buf, pc);
 
     return 0;
 }
@@ -10,21 +10,63 @@
 #define ROSETTA_TRANS_STRING_H
 
 #include "rosetta_refactored_types.h"
+#include "rosetta_x86_decode.h"
+#include "rosetta_codegen.h"
+#include "rosetta_memmgr.h"
+
+/* ============================================================================
+ * String Operation Tunables
+ * ============================================================================ */
+
+#define STRING_RFLAGS_DF        (1ULL << 10)    /* Guest RFLAGS direction flag */
+
+/* REP runs at least this many bytes long go to the SIMD string kernels */
+#define STRING_BULK_MIN_BYTES   64
 
 /* ============================================================================
  * String Translation Functions
+ * ============================================================================
+ *
+ * The helpers run at execution time on ThreadState.host.x[], where guest
+ * register n is Xn. Guest addresses go through the window set with
+ * translate_string_set_guest_memory(); a run that leaves it fails with -1
+ * and changes nothing.
  * ============================================================================ */
 
+/**
+ * translate_string_set_guest_memory - Set the guest memory window
+ * @param mgr Guest memory, or NULL if guest addresses are host addresses
+ */
+void translate_string_set_guest_memory(rosetta_memmgr_t *mgr);
+
+/**
+ * translate_string_emit - Emit a call to the helper for a string instruction
+ *
+ * The guest registers are spilled to ThreadState.host.x[] and NZCV to
+ * host.pstate around the call, so flags set by CMPS/SCAS come back in NZCV;
+ * guest XMM0-15 (Q0-Q15) are kept on the stack. The AVX and x87 caches in
+ * V16-V27 are not: the caller flushes them first, as for SYSCALL. A run
+ * that leaves guest memory exits the block at pc with SIGSEGV pending in
+ * ThreadState.pending_signals.
+ *
+ * @param code_buf Code buffer for emission
+ * @param insn Decoded MOVS, STOS, LODS, CMPS or SCAS
+ * @param pc Guest address of the instruction
+ * @return 0 on success, -ENOTSUP for REPNE CMPS and REPE SCAS,
+ *         -ENOENT for other instructions (nothing emitted)
+ */
+int translate_string_emit(code_buffer_t *code_buf, const x86_insn_t *insn, uint64_t pc);
+
 /**
  * translate_movs - Translate/emulate MOVS (move string) instruction
  * @param state Thread state
  * @param insn Instruction bytes (x86)
  * @param size Element size (1, 2, 4, or 8 bytes)
  * @param rep REP prefix flag
- * @param ecx Count register value
+ * @param rcx Count register value (RCX, or ECX zero-extended under 0x67)
  * @return 0 on success, -1 on failure
  */
-int translate_movs(ThreadState *state, const uint8_t *insn, int size, bool rep, uint32_t ecx);
+int translate_movs(ThreadState *state, const uint8_t *insn, int size, bool rep, uint64_t rcx);
 
 /**
  * translate_stos - Translate/emulate STOS (store string) instruction
@@ -32,10 +74,10 @@ int translate_movs(ThreadState *state, const uint8_t *insn, int size, bool rep,
  * @param insn Instruction bytes (x86)
  * @param size Element size (1, 2, 4, or 8 bytes)
  * @param rep REP prefix flag
- * @param ecx Count register value
+ * @param rcx Count register value (RCX, or ECX zero-extended under 0x67)
  * @return 0 on success, -1 on failure
  */
-int translate_stos(ThreadState *state, const uint8_t *insn, int size, bool rep, uint32_t ecx);
+int translate_stos(ThreadState *state, const uint8_t *insn, int size, bool rep, uint64_t rcx);
 
 /**
  * translate_lods - Translate/emulate LODS (load string) instruction
@@ -43,10 +85,10 @@ int translate_stos(ThreadState *state, const uint8_t *insn, int size, bool rep,
  * @param insn Instruction bytes (x86)
  * @param size Element size (1, 2, 4, or 8 bytes)
  * @param rep REP prefix flag
- * @param ecx Count register value
+ * @param rcx Count register value (RCX, or ECX zero-extended under 0x67)
  * @return 0 on success, -1 on failure
  */
-int translate_lods(ThreadState *state, const uint8_t *insn, int size, bool rep, uint32_t ecx);
+int translate_lods(ThreadState *state, const uint8_t *insn, int size, bool rep, uint64_t rcx);
 
 /**
  * translate_cmps - Translate/emulate CMPS (compare string) instruction
@@ -54,10 +96,10 @@ int translate_lods(ThreadState *state, const uint8_t *insn, int size, bool rep,
  * @param insn Instruction bytes (x86)
  * @param size Element size (1, 2, 4, or 8 bytes)
  * @param rep REP prefix flag
- * @param ecx Count register value
+ * @param rcx Count register value (RCX, or ECX zero-extended under 0x67)
  * @return 0 on success, -1 on failure
  */
-int translate_cmps(ThreadState *state, const uint8_t *insn, int size, bool rep, uint32_t ecx);
+int translate_cmps(ThreadState *state, const uint8_t *insn, int size, bool rep, uint64_t rcx);
 
 /**
  * translate_scas - Translate/emulate SCAS (scan string) instruction
@@ -65,9 +107,9 @@ int translate_cmps(ThreadState *state, const uint8_t *insn, int size, bool rep,
  * @param insn Instruction bytes (x86)
  * @param size Element size (1, 2, 4, or 8 bytes)
  * @param rep REP prefix flag
- * @param ecx Count register value
+ * @param rcx Count register value (RCX, or ECX zero-extended under 0x67)
  * @return 0 on success, -1 on failure
  */
-int translate_scas(ThreadState *state, const uint8_t *insn, int size, bool rep, uint32_t ecx);
+int translate_scas(ThreadState *state, const uint8_t *insn, int size, bool rep, uint64_t rcx);
 
 #endif /* ROSETTA_TRANS_STRING_H */
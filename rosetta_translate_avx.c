@@ -0,0 +1,805 @@
+/* ============================================================================
+ * Rosetta AVX Translation Implementation
+ * ============================================================================
+ *
+ * This module lowers VEX-encoded x86_64 AVX and AVX2 instructions to ARM64
+ * NEON. VEX.128 and VEX.256 forms of SSE table entries run that entry's
+ * lowering once per 128-bit half with explicit operands; the AVX-only
+ * table covers broadcasts, cross-lane permutes, 128-bit inserts and
+ * extracts, variable shifts and the forms whose halves interact.
+ * ============================================================================ */
+
+#include "rosetta_translate_avx.h"
+#include "rosetta_translate_simd_impl.h"
+#include "rosetta_exec_context.h"
+#include "rosetta_arm64_emit.h"
+#include <errno.h>
+#include <stddef.h>
+#include <string.h>
+
+#define AVX_SLOT_BASE   16      /* Cache slot n is V(16 + n) */
+#define AVX_XSTATE      17      /* ThreadState pointer, loaded on first use */
+#define AVX_XCTX        18      /* rosetta_exec_context_t pointer */
+#define AVX_NONE        0xFF
+#define AVX_HI_OFFSET   offsetof(ThreadState, guest.ymm_hi)
+
+_Static_assert(AVX_HI_OFFSET % 16 == 0, "ymm_hi must be reachable with LDR Q, [X17, #imm]");
+
+/* ============================================================================
+ * Upper-Half Cache
+ * ============================================================================ */
+
+void translate_avx_begin_block(translate_avx_state_t *st)
+{
+    memset(st, 0, sizeof(*st));
+    memset(st->ymm_of, AVX_NONE, sizeof(st->ymm_of));
+}
+
+/* LDR/STR Qt, [X17, #ymm_hi[reg]] */
+static void avx_hi_ldst(code_buffer_t *b, translate_avx_state_t *st, int store, uint8_t reg, uint8_t vt)
+{
+    uint32_t off = (uint32_t)(AVX_HI_OFFSET + reg * sizeof(vec128_t));
+
+    if (!st->state_loaded) {
+        emit_ldr_uoff(b, AVX_XSTATE, AVX_XCTX, offsetof(rosetta_exec_context_t, state));
+        st->state_loaded = 1;
+    }
+    emit_arm64_insn(b, (store ? 0x3D800000u : 0x3DC00000u) | ((off >> 4) << 10) |
+                       (AVX_XSTATE << 5) | vt);
+}
+
+static void avx_evict(code_buffer_t *b, translate_avx_state_t *st, int slot)
+{
+    uint8_t reg = st->ymm_of[slot];
+
+    if (reg == AVX_NONE) {
+        return;
+    }
+    if (st->dirty & (1u << reg)) {
+        avx_hi_ldst(b, st, 1, reg, AVX_SLOT_BASE + slot);
+        st->dirty &= (uint16_t)~(1u << reg);
+    }
+    st->slot_of[reg] = 0;
+    st->ymm_of[slot] = AVX_NONE;
+}
+
+/* Slot caching reg: its own, a free one, else the least recently used one this instruction has not pinned */
+static int avx_slot(code_buffer_t *b, translate_avx_state_t *st, uint8_t reg, int *fresh)
+{
+    int slot = -1;
+    int i;
+
+    *fresh = !st->slot_of[reg];
+    if (!*fresh) {
+        slot = st->slot_of[reg] - 1;
+    } else {
+        for (i = 0; i < AVX_CACHE_SLOTS; i++) {
+            if (st->pinned & (1u << i)) {
+                continue;
+            }
+            if (st->ymm_of[i] == AVX_NONE) {
+                slot = i;
+                break;
+            }
+            if (slot < 0 || st->used[i] < st->used[slot]) {
+                slot = i;
+            }
+        }
+        avx_evict(b, st, slot);
+        st->slot_of[reg] = (uint8_t)(slot + 1);
+        st->ymm_of[slot] = reg;
+    }
+    st->used[slot] = ++st->clock;
+    st->pinned |= (uint16_t)(1u << slot);
+    return slot;
+}
+
+/* Vn holding YMMreg bits 255:128, to read */
+static uint8_t avx_hi_src(code_buffer_t *b, translate_avx_state_t *st, uint8_t reg)
+{
+    int fresh;
+    uint8_t v = (uint8_t)(AVX_SLOT_BASE + avx_slot(b, st, reg, &fresh));
+
+    if (fresh) {
+        if (st->zero & (1u << reg)) {
+            neon_zero(b, v);                            /* Still dirty: memory is not zero yet */
+            st->zero &= (uint16_t)~(1u << reg);
+        } else {
+            avx_hi_ldst(b, st, 0, reg, v);
+        }
+    }
+    return v;
+}
+
+/* Vn for YMMreg bits 255:128, to overwrite entirely */
+static uint8_t avx_hi_dst(code_buffer_t *b, translate_avx_state_t *st, uint8_t reg)
+{
+    int fresh;
+    uint8_t v = (uint8_t)(AVX_SLOT_BASE + avx_slot(b, st, reg, &fresh));
+
+    st->zero &= (uint16_t)~(1u << reg);
+    st->dirty |= (uint16_t)(1u << reg);
+    return v;
+}
+
+/* YMMreg bits 255:128 become zero; no code until the next flush */
+static void avx_hi_clear(translate_avx_state_t *st, uint8_t reg)
+{
+    uint16_t bit = (uint16_t)(1u << reg);
+
+    if (st->slot_of[reg]) {
+        st->ymm_of[st->slot_of[reg] - 1] = AVX_NONE;
+        st->slot_of[reg] = 0;
+    }
+    if (!(st->zero & bit)) {
+        st->dirty |= bit;
+    }
+    st->zero |= bit;
+}
+
+void translate_avx_flush(code_buffer_t *code_buf, translate_avx_state_t *st)
+{
+    int zeroed = 0;
+    uint8_t reg;
+
+    st->state_loaded = 0;
+    for (reg = 0; reg < 16; reg++) {
+        if (!(st->dirty & (1u << reg))) {
+            continue;
+        }
+        if (st->slot_of[reg]) {
+            avx_hi_ldst(code_buf, st, 1, reg, (uint8_t)(AVX_SLOT_BASE + st->slot_of[reg] - 1));
+        } else {
+            if (!zeroed) {                              /* Dirty and uncached means zero */
+                neon_zero(code_buf, SIMD_T0);
+                zeroed = 1;
+            }
+            avx_hi_ldst(code_buf, st, 1, reg, SIMD_T0);
+        }
+    }
+    translate_avx_begin_block(st);
+}
+
+/* ============================================================================
+ * Operand Access
+ * ============================================================================ */
+
+static uint8_t avx_reg(const x86_insn_t *insn)
+{
+    return insn->reg & 0x0F;
+}
+
+static uint8_t avx_rm(const x86_insn_t *insn)
+{
+    return insn->rm & 0x0F;
+}
+
+static uint8_t avx_vvvv(const x86_insn_t *insn)
+{
+    return insn->vex_vvvv & 0x0F;
+}
+
+static int avx_imm8(const x86_insn_t *insn)
+{
+    return (int)(insn->imm & 0xFF);
+}
+
+/* LDR Vt of 1 << lg bytes at the ModR/M address plus adjust */
+static void avx_load(code_buffer_t *b, const x86_insn_t *insn, int lg, int64_t adjust,
+                     uint64_t guest_pc, uint8_t vt)
+{
+    (void)translate_simd_mem(b, insn, avx_rm(insn), lg, adjust, guest_pc, 0, vt);
+}
+
+/* ============================================================================
+ * SSE Table Entries
+ * ============================================================================ */
+
+/*
+ * VEX forms of an SSE entry. Operands are reg = op(vvvv, rm) rather than
+ * reg = op(reg, rm), or vvvv = op(rm) for group opcodes; VEX.128 zeroes
+ * the destination's upper half and VEX.256 repeats the lowering on the
+ * cached upper halves, memory operands 16 bytes on. The upper half goes
+ * first: widening and shift-count forms read the low source register.
+ */
+static int avx_lower_sse(code_buffer_t *b, translate_avx_state_t *st, const translate_simd_entry_t *e,
+                         const x86_insn_t *insn, uint64_t guest_pc)
+{
+    uint32_t f = e->flags;
+    int group = e->ext != SIMD_EXT_NONE;
+    int mem = insn->mod != 3;
+    uint8_t reg = avx_reg(insn), rm = avx_rm(insn), v = avx_vvvv(insn);
+    uint8_t vd, vn, vm, hd, hn, hm;
+    int64_t adjust = 16;
+    x86_insn_t hi;
+    int dest;
+    int ret;
+
+    if (group) {
+        vd = v;
+        vn = vm = rm;
+        dest = v;
+    } else {
+        vd = reg;
+        vn = !(f & SIMD_F_NO_VVVV) ? v : (f & SIMD_F_STORE) ? rm : reg;
+        vm = rm;
+        if (f & (SIMD_F_FLAGS | SIMD_F_GPR_REG)) {
+            dest = -1;
+        } else if (f & SIMD_F_STORE) {
+            dest = (mem || (f & SIMD_F_GPR_RM)) ? -1 : rm;
+        } else {
+            dest = reg;
+        }
+    }
+
+    if ((f & SIMD_F_XMM0) ||
+        (insn->vex_L && (!(f & (SIMD_F_YMM | SIMD_F_YMM_WIDEN)) || (dest < 0 && !(f & SIMD_F_STORE))))) {
+        return -ENOTSUP;
+    }
+    ret = translate_simd_supported(e, insn);
+    if (ret < 0) {
+        return ret;
+    }
+
+    if (!insn->vex_L) {
+        if (dest >= 0) {
+            avx_hi_clear(st, (uint8_t)dest);
+        }
+        return translate_simd_lower_op(b, e, insn, vd, vn, vm, 0, guest_pc);
+    }
+
+    hi = *insn;
+    if (f & SIMD_F_YMM_IMMHI) {
+        hi.imm = (insn->imm & 0xFF) >> (16 >> e->arg);
+    }
+
+    hm = vm;                                            /* Base GPR for memory forms */
+    if (f & SIMD_F_YMM_WIDEN) {
+        adjust = 1 << translate_simd_mem_lg(e);
+        if (!mem) {
+            neon_ext(b, SIMD_TMEM, vm, vm, (int)adjust);
+            hm = SIMD_TMEM;
+        }
+    } else if (f & SIMD_F_YMM_COUNT) {
+        adjust = 0;
+    } else if (!mem && !(f & SIMD_F_STORE)) {
+        hm = avx_hi_src(b, st, rm);
+    }
+    hn = hm;
+    if (!(f & SIMD_F_NO_VVVV) && !group) {
+        hn = avx_hi_src(b, st, v);
+    }
+    if (f & SIMD_F_STORE) {
+        hd = avx_hi_src(b, st, reg);
+        if (!mem) {
+            hm = avx_hi_dst(b, st, rm);
+        }
+        if (f & SIMD_F_NO_VVVV) {
+            hn = hm;
+        }
+    } else {
+        hd = avx_hi_dst(b, st, (uint8_t)dest);
+        if ((f & SIMD_F_NO_VVVV) || group) {
+            hn = hd;
+        }
+    }
+
+    ret = translate_simd_lower_op(b, e, &hi, hd, hn, hm, adjust, guest_pc);
+    if (ret < 0) {
+        return ret;
+    }
+    return translate_simd_lower_op(b, e, insn, vd, vn, vm, 0, guest_pc);
+}
+
+/* VPBLENDD and VPERMILPS (imm8) share blendps' and pshufd's lowerings; arg indexes this */
+static const uint8_t g_avx_alias[][2] = {
+    { 0x3A, 0x0C },                                     /* blendps */
+    { 0x0F, 0x70 },                                     /* pshufd */
+};
+
+static int avx_alias(code_buffer_t *b, translate_avx_state_t *st, const translate_avx_entry_t *a,
+                     const x86_insn_t *insn, uint64_t guest_pc)
+{
+    const translate_simd_entry_t *e = translate_simd_find(0x66, g_avx_alias[a->arg][0],
+                                                          g_avx_alias[a->arg][1], SIMD_EXT_NONE);
+
+    return e ? avx_lower_sse(b, st, e, insn, guest_pc) : -ENOENT;
+}
+
+/* ============================================================================
+ * Lowerings: Moves and Broadcasts
+ * ============================================================================ */
+
+/* VZEROUPPER (arg 0) only marks the halves zero; VZEROALL (arg 1) also clears XMM0-15 */
+static int avx_vzero(code_buffer_t *b, translate_avx_state_t *st, const translate_avx_entry_t *a,
+                     const x86_insn_t *insn, uint64_t guest_pc)
+{
+    uint8_t reg;
+
+    (void)insn;
+    (void)guest_pc;
+    for (reg = 0; reg < 16; reg++) {
+        avx_hi_clear(st, reg);
+        if (a->arg) {
+            neon_zero(b, reg);
+        }
+    }
+    return 0;
+}
+
+/* VBROADCASTSS/SD/F128, VPBROADCASTB/W/D/Q, VBROADCASTI128; arg is log2 of the element bytes */
+static int avx_broadcast(code_buffer_t *b, translate_avx_state_t *st, const translate_avx_entry_t *a,
+                         const x86_insn_t *insn, uint64_t guest_pc)
+{
+    int lg = a->arg;
+    uint8_t d = avx_reg(insn);
+    uint8_t src = avx_rm(insn);
+
+    if (insn->mod != 3) {
+        avx_load(b, insn, lg, 0, guest_pc, SIMD_TMEM);
+        src = SIMD_TMEM;
+    }
+    if (lg == 4) {
+        neon_mov(b, d, src);
+    } else {
+        neon_dup(b, lg, d, src, 0);
+    }
+    if (insn->vex_L) {
+        neon_mov(b, avx_hi_dst(b, st, d), d);
+    } else {
+        avx_hi_clear(st, d);
+    }
+    return 0;
+}
+
+/* VINSERTF128/VINSERTI128: ymm_vvvv with half imm8[0] replaced by xmm/m128 */
+static int avx_insert128(code_buffer_t *b, translate_avx_state_t *st, const translate_avx_entry_t *a,
+                         const x86_insn_t *insn, uint64_t guest_pc)
+{
+    uint8_t d = avx_reg(insn), v = avx_vvvv(insn), m = avx_rm(insn);
+
+    (void)a;
+    if (insn->mod != 3) {
+        avx_load(b, insn, 4, 0, guest_pc, SIMD_TMEM);
+        m = SIMD_TMEM;
+    }
+    if (avx_imm8(insn) & 1) {
+        neon_mov(b, avx_hi_dst(b, st, d), m);
+        neon_mov(b, d, v);
+    } else {
+        uint8_t hv = avx_hi_src(b, st, v);
+
+        neon_mov(b, avx_hi_dst(b, st, d), hv);
+        neon_mov(b, d, m);
+    }
+    return 0;
+}
+
+/* VEXTRACTF128/VEXTRACTI128: xmm/m128 = half imm8[0] of ymm_reg */
+static int avx_extract128(code_buffer_t *b, translate_avx_state_t *st, const translate_avx_entry_t *a,
+                          const x86_insn_t *insn, uint64_t guest_pc)
+{
+    uint8_t s = avx_reg(insn);
+
+    (void)a;
+    if (avx_imm8(insn) & 1) {
+        s = avx_hi_src(b, st, s);
+    }
+    if (insn->mod != 3) {
+        return translate_simd_mem(b, insn, avx_rm(insn), 4, 0, guest_pc, 1, s);
+    }
+    neon_mov(b, avx_rm(insn), s);
+    avx_hi_clear(st, avx_rm(insn));
+    return 0;
+}
+
+/* ============================================================================
+ * Lowerings: Cross-Lane Permutes
+ * ============================================================================ */
+
+/* Source half sel of VPERM2F128 (0-1: ymm_vvvv, 2-3: ymm_rm/m256); memory halves load into tmp */
+static uint8_t avx_perm2x128_src(code_buffer_t *b, translate_avx_state_t *st, const x86_insn_t *insn,
+                                 uint64_t guest_pc, int sel, uint8_t tmp)
+{
+    uint8_t r = (sel & 2) ? avx_rm(insn) : avx_vvvv(insn);
+
+    if ((sel & 2) && insn->mod != 3) {
+        avx_load(b, insn, 4, 16 * (sel & 1), guest_pc, tmp);
+        return tmp;
+    }
+    return (sel & 1) ? avx_hi_src(b, st, r) : r;
+}
+
+/* VPERM2F128/VPERM2I128: each half picks any source half, or zero (imm8 bits 3 and 7) */
+static int avx_perm2x128(code_buffer_t *b, translate_avx_state_t *st, const translate_avx_entry_t *a,
+                         const x86_insn_t *insn, uint64_t guest_pc)
+{
+    int imm = avx_imm8(insn);
+    uint8_t d = avx_reg(insn);
+    uint8_t lo = 0, hi = 0, hd;
+
+    (void)a;
+    if (!(imm & 0x08)) {
+        lo = avx_perm2x128_src(b, st, insn, guest_pc, imm & 3, SIMD_T0);
+    }
+    if (!(imm & 0x80)) {
+        hi = avx_perm2x128_src(b, st, insn, guest_pc, (imm >> 4) & 3, SIMD_T1);
+    }
+    hd = avx_hi_dst(b, st, d);
+    if (!(imm & 0x08) && lo == hd) {
+        neon_mov(b, SIMD_T0, lo);
+        lo = SIMD_T0;
+    }
+    if (imm & 0x80) {
+        neon_zero(b, hd);
+    } else {
+        neon_mov(b, hd, hi);
+    }
+    if (imm & 0x08) {
+        neon_zero(b, d);
+    } else {
+        neon_mov(b, d, lo);
+    }
+    return 0;
+}
+
+/* Whole 256-bit ymm_rm/m256 into T2 (bits 127:0) and T1 (bits 255:128) */
+static void avx_load_pair(code_buffer_t *b, translate_avx_state_t *st, const x86_insn_t *insn,
+                          uint64_t guest_pc)
+{
+    if (insn->mod != 3) {
+        avx_load(b, insn, 4, 0, guest_pc, SIMD_T2);
+        avx_load(b, insn, 4, 16, guest_pc, SIMD_T1);
+    } else {
+        neon_mov(b, SIMD_T2, avx_rm(insn));
+        neon_mov(b, SIMD_T1, avx_hi_src(b, st, avx_rm(insn)));
+    }
+}
+
+/* VPERMQ/VPERMPD: qword i of the result is qword imm8[2i+1:2i] of the source */
+static int avx_permq(code_buffer_t *b, translate_avx_state_t *st, const translate_avx_entry_t *a,
+                     const x86_insn_t *insn, uint64_t guest_pc)
+{
+    int imm = avx_imm8(insn);
+    uint8_t d = avx_reg(insn);
+    uint8_t hd;
+    int i;
+
+    (void)a;
+    avx_load_pair(b, st, insn, guest_pc);
+    hd = avx_hi_dst(b, st, d);
+    for (i = 0; i < 4; i++) {
+        int sel = (imm >> (2 * i)) & 3;
+
+        neon_ins(b, 3, i < 2 ? d : hd, i & 1, sel < 2 ? SIMD_T2 : SIMD_T1, sel & 1);
+    }
+    return 0;
+}
+
+/*
+ * VPERMD/VPERMPS: dword i of the result is dword ymm_vvvv[i] & 7 of
+ * ymm_rm. The source sits in V29:V30 for a two-register TBL; each index
+ * becomes the byte indices 4i..4i+3 as (i & 7) * 0x04040404 + 0x03020100.
+ */
+static int avx_permd(code_buffer_t *b, translate_avx_state_t *st, const translate_avx_entry_t *a,
+                     const x86_insn_t *insn, uint64_t guest_pc)
+{
+    uint8_t d = avx_reg(insn), v = avx_vvvv(insn);
+    uint8_t ih, hd;
+    int half;
+
+    (void)a;
+    avx_load_pair(b, st, insn, guest_pc);
+    ih = avx_hi_src(b, st, v);
+    hd = avx_hi_dst(b, st, d);
+    emit_mov_imm64(b, SIMD_XT0, 0x0302010003020100ull);
+    for (half = 1; half >= 0; half--) {
+        uint8_t out = half ? hd : d;
+
+        emit_arm64_insn(b, 0x4F0004E0u | SIMD_TMEM);   /* MOVI TMEM.4S, #7 */
+        neon_rrr(b, NEON_AND, SIMD_T0, half ? ih : v, SIMD_TMEM);
+        neon_movi8(b, SIMD_TMEM, 4, 1);
+        neon_rrr(b, NEON_MUL(2), SIMD_T0, SIMD_T0, SIMD_TMEM);
+        emit_arm64_insn(b, 0x4E080C00u | (SIMD_XT0 << 5) | SIMD_TMEM);    /* DUP TMEM.2D, X16 */
+        neon_rrr(b, NEON_ADD(0), SIMD_T0, SIMD_T0, SIMD_TMEM);
+        emit_arm64_insn(b, 0x4E002000u | (SIMD_T0 << 16) | (SIMD_T2 << 5) | out);  /* TBL {V29, V30} */
+    }
+    return 0;
+}
+
+/* VPERMILPD (imm8): qword i of each half is qword imm8[i] of the same half of ymm_rm/m */
+static int avx_permilpd(code_buffer_t *b, translate_avx_state_t *st, const translate_avx_entry_t *a,
+                        const x86_insn_t *insn, uint64_t guest_pc)
+{
+    int imm = avx_imm8(insn);
+    uint8_t d = avx_reg(insn), m = avx_rm(insn);
+    uint8_t hm = 0, hd = 0;
+    int half;
+
+    (void)a;
+    if (insn->vex_L) {
+        if (insn->mod == 3) {
+            hm = avx_hi_src(b, st, m);
+        }
+        hd = avx_hi_dst(b, st, d);
+    } else {
+        avx_hi_clear(st, d);
+    }
+    for (half = insn->vex_L; half >= 0; half--) {
+        uint8_t out = half ? hd : d;
+        uint8_t s = half ? hm : m;
+        int sel = imm >> (2 * half);
+
+        if (insn->mod != 3) {
+            avx_load(b, insn, 4, 16 * half, guest_pc, SIMD_T0);
+            s = SIMD_T0;
+        } else if (s == out) {
+            neon_mov(b, SIMD_T0, s);
+            s = SIMD_T0;
+        }
+        neon_ins(b, 3, out, 0, s, sel & 1);
+        neon_ins(b, 3, out, 1, s, (sel >> 1) & 1);
+    }
+    return 0;
+}
+
+/* ============================================================================
+ * Lowerings: Blends, Shifts, Masks and Tests
+ * ============================================================================ */
+
+/* VBLENDVPS/VBLENDVPD/VPBLENDVB: lanes of ymm_rm where the is4 register's lane is negative, else ymm_vvvv */
+static int avx_blendv(code_buffer_t *b, translate_avx_state_t *st, const translate_avx_entry_t *a,
+                      const x86_insn_t *insn, uint64_t guest_pc)
+{
+    uint8_t d = avx_reg(insn), v = avx_vvvv(insn), m = avx_rm(insn);
+    uint8_t k = (uint8_t)((avx_imm8(insn) >> 4) & 0x0F);
+    uint8_t hv = 0, hm = 0, hk = 0, hd = 0;
+    int half;
+
+    if (insn->vex_L) {
+        hv = avx_hi_src(b, st, v);
+        if (insn->mod == 3) {
+            hm = avx_hi_src(b, st, m);
+        }
+        hk = avx_hi_src(b, st, k);
+        hd = avx_hi_dst(b, st, d);
+    } else {
+        avx_hi_clear(st, d);
+    }
+    for (half = insn->vex_L; half >= 0; half--) {
+        uint8_t mm = half ? hm : m;
+
+        if (insn->mod != 3) {
+            avx_load(b, insn, 4, 16 * half, guest_pc, SIMD_TMEM);
+            mm = SIMD_TMEM;
+        }
+        neon_rr(b, NEON_CMLT0(a->arg), SIMD_T0, half ? hk : k);
+        neon_rrr(b, NEON_BSL, SIMD_T0, mm, half ? hv : v);
+        neon_mov(b, half ? hd : d, SIMD_T0);
+    }
+    return 0;
+}
+
+/*
+ * VPSLLVD/Q, VPSRLVD/Q, VPSRAVD: per-lane counts. USHL/SSHL read only
+ * the low byte of each count, so logical shifts mask lanes whose count
+ * is esize or more to zero and arithmetic ones clamp it to 31. arg is
+ * size | kind << 2.
+ */
+static int avx_shiftv(code_buffer_t *b, translate_avx_state_t *st, const translate_avx_entry_t *a,
+                      const x86_insn_t *insn, uint64_t guest_pc)
+{
+    int size = a->arg & 3;
+    int kind = a->arg >> 2;
+    uint8_t d = avx_reg(insn), v = avx_vvvv(insn), m = avx_rm(insn);
+    uint8_t hv = 0, hm = 0, hd = 0;
+    int half;
+
+    if (insn->vex_L) {
+        hv = avx_hi_src(b, st, v);
+        if (insn->mod == 3) {
+            hm = avx_hi_src(b, st, m);
+        }
+        hd = avx_hi_dst(b, st, d);
+    } else {
+        avx_hi_clear(st, d);
+    }
+    for (half = insn->vex_L; half >= 0; half--) {
+        uint8_t n = half ? hv : v;
+        uint8_t cnt = half ? hm : m;
+        uint8_t out = half ? hd : d;
+
+        if (insn->mod != 3) {
+            avx_load(b, insn, 4, 16 * half, guest_pc, SIMD_TMEM);
+            cnt = SIMD_TMEM;
+        }
+        if (kind == SIMD_SHIFT_SRA) {
+            emit_arm64_insn(b, 0x4F0007E0u | SIMD_T1);  /* MOVI T1.4S, #31 */
+            neon_rrr(b, NEON_UMIN(2), SIMD_T1, cnt, SIMD_T1);
+            neon_rr(b, NEON_NEG(2), SIMD_T1, SIMD_T1);
+            neon_rrr(b, NEON_SSHL(2), out, n, SIMD_T1);
+            continue;
+        }
+        if (kind == SIMD_SHIFT_SLL) {
+            neon_rrr(b, NEON_USHL(size), SIMD_T0, n, cnt);
+        } else {
+            neon_rr(b, NEON_NEG(size), SIMD_T0, cnt);
+            neon_rrr(b, NEON_USHL(size), SIMD_T0, n, SIMD_T0);
+        }
+        neon_shift(b, 1, SHIFT_SSHR, 1, size, 1, 3 + size, SIMD_T1, cnt);  /* USHR: count >= esize */
+        neon_rr(b, NEON_CMEQ0(size), SIMD_T1, SIMD_T1);
+        neon_rrr(b, NEON_AND, out, SIMD_T0, SIMD_T1);
+    }
+    return 0;
+}
+
+/* VPMOVMSKB/VMOVMSKPS/VMOVMSKPD ymm: the SSE lowering per half, the upper mask via X17 */
+static int avx_movmsk(code_buffer_t *b, translate_avx_state_t *st, const translate_avx_entry_t *a,
+                      const x86_insn_t *insn, uint64_t guest_pc)
+{
+    const translate_simd_entry_t *e = translate_simd_find(a->prefix, 0x0F, a->opcode, SIMD_EXT_NONE);
+    uint8_t d = avx_reg(insn);
+    uint8_t hm;
+
+    (void)guest_pc;
+    if (!e) {
+        return -ENOENT;
+    }
+    hm = avx_hi_src(b, st, avx_rm(insn));
+    e->lower(b, e, insn, AVX_XSTATE, hm);
+    st->state_loaded = 0;
+    e->lower(b, e, insn, d, avx_rm(insn));
+    emit_arm64_insn(b, 0x2A000000u | (AVX_XSTATE << 16) | ((uint32_t)(16 >> e->arg) << 10) |
+                       ((uint32_t)d << 5) | d);          /* ORR Wd, Wd, W17, LSL #lanes */
+    return 0;
+}
+
+/* VPTEST ymm: PTEST's two ANDs over both halves, ORed together */
+static int avx_ptest(code_buffer_t *b, translate_avx_state_t *st, const translate_avx_entry_t *a,
+                     const x86_insn_t *insn, uint64_t guest_pc)
+{
+    uint8_t d = avx_reg(insn), m = avx_rm(insn);
+    uint8_t hd, hm = SIMD_TMEM;
+
+    (void)a;
+    if (insn->mod == 3) {
+        hm = avx_hi_src(b, st, m);
+    } else {
+        avx_load(b, insn, 4, 0, guest_pc, SIMD_TMEM);
+        m = SIMD_TMEM;
+    }
+    hd = avx_hi_src(b, st, d);
+    neon_rrr(b, NEON_AND, SIMD_T0, d, m);
+    neon_rrr(b, NEON_BIC, SIMD_T1, m, d);
+    if (insn->mod != 3) {
+        avx_load(b, insn, 4, 16, guest_pc, SIMD_TMEM);
+    }
+    neon_rrr(b, NEON_AND, SIMD_T2, hd, hm);
+    neon_rrr(b, NEON_ORR, SIMD_T0, SIMD_T0, SIMD_T2);
+    neon_rrr(b, NEON_BIC, SIMD_T2, hm, hd);
+    neon_rrr(b, NEON_ORR, SIMD_T1, SIMD_T1, SIMD_T2);
+    translate_simd_ptest_flags(b);
+    return 0;
+}
+
+/* ============================================================================
+ * AVX-Only Table
+ * ============================================================================ */
+
+#define L1      AVX_L128
+#define L2      AVX_L256
+#define LB      (AVX_L128 | AVX_L256)
+#define WIG     AVX_WIG
+#define F_IMM   SIMD_F_IMM8
+#define F_REG   SIMD_F_REG_ONLY
+#define F_MEM   SIMD_F_MEM_ONLY
+#define F_NV    SIMD_F_NO_VVVV
+#define F_FL    SIMD_F_FLAGS
+#define SRL     (SIMD_SHIFT_SRL << 2)
+#define SRA     (SIMD_SHIFT_SRA << 2)
+#define SLL     (SIMD_SHIFT_SLL << 2)
+
+/* Searched before the SSE table; sorted by map, then opcode */
+static const translate_avx_entry_t g_avx_table[] = {
+    { 0x00, 0x0F, 0x50, L2, WIG, F_REG | F_NV,   0,       avx_movmsk,     "vmovmskps.256" },
+    { 0x66, 0x0F, 0x50, L2, WIG, F_REG | F_NV,   0,       avx_movmsk,     "vmovmskpd.256" },
+    { 0x00, 0x0F, 0x77, L1, WIG, F_NV,           0,       avx_vzero,      "vzeroupper" },
+    { 0x00, 0x0F, 0x77, L2, WIG, F_NV,           1,       avx_vzero,      "vzeroall" },
+    { 0x66, 0x0F, 0xD7, L2, WIG, F_REG | F_NV,   0,       avx_movmsk,     "vpmovmskb.256" },
+
+    { 0x66, 0x38, 0x16, L2, 0,   0,              0,       avx_permd,      "vpermps" },
+    { 0x66, 0x38, 0x17, L2, WIG, F_NV | F_FL,    0,       avx_ptest,      "vptest.256" },
+    { 0x66, 0x38, 0x18, LB, 0,   F_NV,           2,       avx_broadcast,  "vbroadcastss" },
+    { 0x66, 0x38, 0x19, L2, 0,   F_NV,           3,       avx_broadcast,  "vbroadcastsd" },
+    { 0x66, 0x38, 0x1A, L2, 0,   F_MEM | F_NV,   4,       avx_broadcast,  "vbroadcastf128" },
+    { 0x66, 0x38, 0x36, L2, 0,   0,              0,       avx_permd,      "vpermd" },
+    { 0x66, 0x38, 0x45, LB, 0,   0,              2 | SRL, avx_shiftv,     "vpsrlvd" },
+    { 0x66, 0x38, 0x45, LB, 1,   0,              3 | SRL, avx_shiftv,     "vpsrlvq" },
+    { 0x66, 0x38, 0x46, LB, 0,   0,              2 | SRA, avx_shiftv,     "vpsravd" },
+    { 0x66, 0x38, 0x47, LB, 0,   0,              2 | SLL, avx_shiftv,     "vpsllvd" },
+    { 0x66, 0x38, 0x47, LB, 1,   0,              3 | SLL, avx_shiftv,     "vpsllvq" },
+    { 0x66, 0x38, 0x58, LB, 0,   F_NV,           2,       avx_broadcast,  "vpbroadcastd" },
+    { 0x66, 0x38, 0x59, LB, 0,   F_NV,           3,       avx_broadcast,  "vpbroadcastq" },
+    { 0x66, 0x38, 0x5A, L2, 0,   F_MEM | F_NV,   4,       avx_broadcast,  "vbroadcasti128" },
+    { 0x66, 0x38, 0x78, LB, 0,   F_NV,           0,       avx_broadcast,  "vpbroadcastb" },
+    { 0x66, 0x38, 0x79, LB, 0,   F_NV,           1,       avx_broadcast,  "vpbroadcastw" },
+
+    { 0x66, 0x3A, 0x00, L2, 1,   F_IMM | F_NV,   0,       avx_permq,      "vpermq" },
+    { 0x66, 0x3A, 0x01, L2, 1,   F_IMM | F_NV,   0,       avx_permq,      "vpermpd" },
+    { 0x66, 0x3A, 0x02, LB, 0,   F_IMM,          0,       avx_alias,      "vpblendd" },
+    { 0x66, 0x3A, 0x04, LB, 0,   F_IMM | F_NV,   1,       avx_alias,      "vpermilps" },
+    { 0x66, 0x3A, 0x05, LB, 0,   F_IMM | F_NV,   0,       avx_permilpd,   "vpermilpd" },
+    { 0x66, 0x3A, 0x06, L2, 0,   F_IMM,          0,       avx_perm2x128,  "vperm2f128" },
+    { 0x66, 0x3A, 0x18, L2, 0,   F_IMM,          0,       avx_insert128,  "vinsertf128" },
+    { 0x66, 0x3A, 0x19, L2, 0,   F_IMM | F_NV,   0,       avx_extract128, "vextractf128" },
+    { 0x66, 0x3A, 0x38, L2, 0,   F_IMM,          0,       avx_insert128,  "vinserti128" },
+    { 0x66, 0x3A, 0x39, L2, 0,   F_IMM | F_NV,   0,       avx_extract128, "vextracti128" },
+    { 0x66, 0x3A, 0x46, L2, 0,   F_IMM,          0,       avx_perm2x128,  "vperm2i128" },
+    { 0x66, 0x3A, 0x4A, LB, 0,   F_IMM,          2,       avx_blendv,     "vblendvps" },
+    { 0x66, 0x3A, 0x4B, LB, 0,   F_IMM,          3,       avx_blendv,     "vblendvpd" },
+    { 0x66, 0x3A, 0x4C, LB, 0,   F_IMM,          0,       avx_blendv,     "vpblendvb" },
+};
+
+#undef L1
+#undef L2
+#undef LB
+#undef WIG
+#undef F_IMM
+#undef F_REG
+#undef F_MEM
+#undef F_NV
+#undef F_FL
+#undef SRL
+#undef SRA
+#undef SLL
+
+const translate_avx_entry_t *translate_avx_table(size_t *count)
+{
+    *count = sizeof(g_avx_table) / sizeof(g_avx_table[0]);
+    return g_avx_table;
+}
+
+/* ============================================================================
+ * Lowering
+ * ============================================================================ */
+
+int translate_avx_lower(code_buffer_t *code_buf, translate_avx_state_t *st,
+                        const x86_insn_t *insn, uint64_t guest_pc)
+{
+    const translate_simd_entry_t *e;
+    uint8_t map, opcode;
+    size_t i;
+
+    if (!insn->vex_prefix || insn->opcode != 0 || insn->opcode2 == 0) {
+        return -ENOENT;
+    }
+    map = (insn->opcode2 == 0x38 || insn->opcode2 == 0x3A) ? insn->opcode2 : 0x0F;
+    opcode = map == 0x0F ? insn->opcode2 : insn->opcode3;
+    st->pinned = 0;
+    st->state_loaded = 0;                               /* X17 is scratch between instructions */
+
+    for (i = 0; i < sizeof(g_avx_table) / sizeof(g_avx_table[0]); i++) {
+        const translate_avx_entry_t *a = &g_avx_table[i];
+
+        if (a->prefix != insn->simd_prefix || a->map != map || a->opcode != opcode ||
+            !(a->lengths & (1u << insn->vex_L)) || (a->w != AVX_WIG && a->w != insn->vex_w)) {
+            continue;
+        }
+        if (insn->has_modrm && insn->mod != 3 ?
+            (a->flags & SIMD_F_REG_ONLY) != 0 : (a->flags & SIMD_F_MEM_ONLY) != 0) {
+            return -ENOTSUP;
+        }
+        return a->lower(code_buf, st, a, insn, guest_pc);
+    }
+
+    if (!insn->has_modrm) {
+        return -ENOENT;
+    }
+    e = translate_simd_find(insn->simd_prefix, map, opcode, (insn->modrm >> 3) & 7);
+    if (!e) {
+        return -ENOENT;
+    }
+    return avx_lower_sse(code_buf, st, e, insn, guest_pc);
+}
+
+/* End of rosetta_translate_avx.c */
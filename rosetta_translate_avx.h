@@ -0,0 +1,106 @@
+/* ============================================================================
+ * Rosetta AVX Translation Header
+ * ============================================================================
+ *
+ * This header declares the lowering of VEX-encoded x86_64 AVX and AVX2
+ * instructions to ARM64 NEON.
+ * ============================================================================ */
+
+#ifndef ROSETTA_TRANSLATE_AVX_H
+#define ROSETTA_TRANSLATE_AVX_H
+
+#include "rosetta_types.h"
+#include "rosetta_x86_decode.h"
+#include "rosetta_codegen.h"
+
+/* ============================================================================
+ * YMM Register Model
+ * ============================================================================
+ *
+ * A YMM register is a pair of NEON registers: bits 127:0 are XMMn in Vn,
+ * as for SSE, and bits 255:128 live in ThreadState.guest.ymm_hi[n].
+ * Within a block the upper halves are cached in V16-V27, loaded on first
+ * use and written back on eviction or translate_avx_flush(). VEX.128
+ * writes and VZEROUPPER only mark a half as zero, so the common
+ * "128-bit code with a VZEROUPPER before each call" costs no loads.
+ *
+ * V16-V31 are caller-saved under AAPCS64, so the cache is flushed before
+ * anything that calls into C (SYSCALL) and at every block exit.
+ * ============================================================================ */
+
+#define AVX_CACHE_SLOTS     12      /* V16-V27 */
+
+typedef struct {
+    uint8_t slot_of[16];                /* Cache slot + 1 holding YMMn bits 255:128, 0 if none */
+    uint8_t ymm_of[AVX_CACHE_SLOTS];    /* YMM register in each slot, 0xFF if free */
+    uint32_t used[AVX_CACHE_SLOTS];     /* LRU stamps */
+    uint32_t clock;
+    uint16_t dirty;                     /* Halves newer than ThreadState */
+    uint16_t zero;                      /* Halves known to be zero and not cached */
+    uint16_t pinned;                    /* Slots the current instruction uses */
+    uint8_t state_loaded;               /* X17 holds the ThreadState pointer */
+} translate_avx_state_t;
+
+/* ============================================================================
+ * AVX-Only Forms
+ * ============================================================================
+ *
+ * VEX forms of SSE table entries reuse that table (see SIMD_F_YMM and
+ * friends in rosetta_translate_simd.h). Forms with no SSE counterpart,
+ * and 256-bit forms whose halves interact, are in a second table.
+ * ============================================================================ */
+
+#define AVX_L128            0x01    /* VEX.L = 0 allowed */
+#define AVX_L256            0x02    /* VEX.L = 1 allowed */
+#define AVX_WIG             2       /* VEX.W ignored */
+
+typedef struct translate_avx_entry translate_avx_entry_t;
+
+typedef int (*translate_avx_lower_fn)(code_buffer_t *code_buf, translate_avx_state_t *st,
+                                      const translate_avx_entry_t *a, const x86_insn_t *insn,
+                                      uint64_t guest_pc);
+
+struct translate_avx_entry {
+    uint8_t prefix;                 /* 0x00, 0x66, 0xF3 or 0xF2 (VEX.pp) */
+    uint8_t map;                    /* 0x0F, 0x38 or 0x3A (VEX.mmmmm) */
+    uint8_t opcode;
+    uint8_t lengths;                /* AVX_L128 | AVX_L256 */
+    uint8_t w;                      /* VEX.W, or AVX_WIG */
+    uint32_t flags;                 /* SIMD_F_IMM8, _REG_ONLY, _MEM_ONLY, _NO_VVVV, _FLAGS */
+    uint8_t arg;                    /* Lane size or handler argument */
+    translate_avx_lower_fn lower;
+    const char *name;
+};
+
+/**
+ * translate_avx_table - The AVX-only table, for tests and statistics
+ */
+const translate_avx_entry_t *translate_avx_table(size_t *count);
+
+/* ============================================================================
+ * Lowering
+ * ============================================================================ */
+
+/**
+ * translate_avx_begin_block - Reset the upper-half cache for a new block
+ */
+void translate_avx_begin_block(translate_avx_state_t *st);
+
+/**
+ * translate_avx_lower - Emit the NEON lowering of a VEX instruction
+ * @param st Upper-half cache of the block being translated
+ * @param guest_pc Address of the instruction, for RIP-relative operands
+ * @return 0 on success, -ENOENT for non-VEX and unknown forms, -ENOTSUP
+ *         for an operand form not lowered; nothing is emitted on failure
+ */
+int translate_avx_lower(code_buffer_t *code_buf, translate_avx_state_t *st,
+                        const x86_insn_t *insn, uint64_t guest_pc);
+
+/**
+ * translate_avx_flush - Write dirty upper halves back and empty the cache
+ *
+ * Emitted before SYSCALL and before the instruction that ends the block.
+ */
+void translate_avx_flush(code_buffer_t *code_buf, translate_avx_state_t *st);
+
+#endif /* ROSETTA_TRANSLATE_AVX_H */
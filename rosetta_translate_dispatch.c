@@ -11,7 +11,7 @@
 #include "rosetta_translate_memory.h"
 #include "rosetta_translate_branch.h"
 #include "rosetta_translate_bit.h"
-#include "rosetta_translate_string.h"
+#include "rosetta_trans_string.h"
 #include "rosetta_translate_special.h"
 #include "rosetta_translate_simd.h"
 
@@ -22,6 +22,9 @@
 InsnCategory dispatch_classify_insn(const x86_insn_t *insn)
 {
     /* SIMD/Floating Point operations (check first due to opcode2) */
+    if (translate_simd_lookup(insn) != NULL) {
+        return INSN_SIMD;
+    }
     if (insn->opcode2 >= 0x10 && insn->opcode2 <= 0x7F) {
         /* This is an SSE/SSE2/SSE4 instruction */
         return INSN_SIMD;
@@ -70,7 +73,8 @@ InsnCategory dispatch_classify_insn(const x86_insn_t *insn)
     if (x86_is_cpuid(insn) || x86_is_rdtsc(insn) || x86_is_shld(insn) ||
         x86_is_shrd(insn) || x86_is_cwd(insn) || x86_is_cqo(insn) ||
         x86_is_cli(insn) || x86_is_sti(insn) || x86_is_nop(insn) ||
-        x86_is_hlt(insn)) {
+        x86_is_cld(insn) || x86_is_std(insn) ||
+        x86_is_hlt(insn) || x86_is_syscall(insn)) {
         return INSN_SPECIAL;
     }
 
@@ -210,19 +214,8 @@ TranslateResult dispatch_translate_insn(code_buffer_t *code_buf,
             break;
 
         case INSN_STRING:
-            /* String operations */
-            if (x86_is_movs(insn)) {
-                translate_string_movs(code_buf, insn);
-            } else if (x86_is_stos(insn)) {
-                translate_string_stos(code_buf, insn);
-            } else if (x86_is_lods(insn)) {
-                translate_string_lods(code_buf, insn);
-            } else if (x86_is_cmps(insn)) {
-                translate_string_cmps(code_buf, insn);
-            } else if (x86_is_scas(insn)) {
-                translate_string_scas(code_buf, insn);
-            }
-            result.success = true;
+            /* String operations call the rosetta_trans_string.c helpers */
+            result.success = translate_string_emit(code_buf, insn, block_pc) == 0;
             break;
 
         case INSN_SPECIAL:
@@ -241,19 +234,30 @@ TranslateResult dispatch_translate_insn(code_buffer_t *code_buf,
                 translate_special_cli(code_buf, insn);
             } else if (x86_is_sti(insn)) {
                 translate_special_sti(code_buf, insn);
+            } else if (x86_is_cld(insn)) {
+                translate_special_cld(code_buf, insn);
+            } else if (x86_is_std(insn)) {
+                translate_special_std(code_buf, insn);
             } else if (x86_is_nop(insn)) {
                 translate_special_nop(code_buf, insn);
             } else if (x86_is_hlt(insn)) {
                 /* HLT - implement as NOP for our purposes */
                 translate_special_nop(code_buf, insn);
+            } else if (x86_is_syscall(insn)) {
+                /* Number unknown here - go through the dispatch table */
+                translate_special_syscall(code_buf, insn, -1);
             }
             result.success = true;
             break;
 
         case INSN_SIMD:
             /* SIMD/ Floating Point operations (SSE, SSE2, SSE4) */
+            /* Table-driven NEON lowering first; -ENOTSUP forms fall through */
+            if (translate_simd_lower(code_buf, insn, arm_rd, arm_rm, block_pc) == 0) {
+                /* Lowered */
+            }
             /* MOV instructions */
-            if (x86_is_movaps(insn) || x86_is_movups(insn) ||
+            else if (x86_is_movaps(insn) || x86_is_movups(insn) ||
                 x86_is_movapd(insn) || x86_is_movupd(insn)) {
                 translate_simd_mov(code_buf, insn, arm_rd, arm_rm);
             } else if (x86_is_movss(insn)) {
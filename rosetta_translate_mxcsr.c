@@ -0,0 +1,343 @@
+/* ============================================================================
+ * Rosetta MXCSR Translation Implementation
+ * ============================================================================
+ *
+ * LDMXCSR stores the new value in guest.mxcsr, clears FPSR and rewrites
+ * the RMode and FZ bits of FPCR only when they change. STMXCSR folds the
+ * FPSR flags into guest.mxcsr and stores it. Fast-mode x87 runs between
+ * translate_mxcsr_x87_enter() and the next SSE/AVX instruction under an
+ * FPCR built from the x87 control word, its flags going to guest.fpu_sw.
+ * X16 and X17 are scratch; the folds borrow X15 through the stack.
+ * ============================================================================ */
+
+#include "rosetta_translate_mxcsr.h"
+#include "rosetta_mxcsr.h"
+#include "rosetta_x87.h"
+#include "rosetta_exec_context.h"
+#include "rosetta_arm64_emit.h"
+#include <errno.h>
+#include <stddef.h>
+#include <string.h>
+
+#define MX_XADDR        16      /* Memory operand address, then the value */
+#define MX_XSTATE       17      /* ThreadState pointer */
+#define MX_XCTX         18      /* rosetta_exec_context_t pointer */
+#define MX_XSPILL       15      /* Borrowed by the fold, saved on the stack */
+#define MX_XZR          31
+#define MX_OFF          offsetof(ThreadState, guest.mxcsr)
+#define MX_OFF_CW       offsetof(ThreadState, guest.fpu_cw)
+#define MX_OFF_SW       offsetof(ThreadState, guest.fpu_sw)
+
+_Static_assert(MX_OFF % 4 == 0 && MX_OFF < 16384, "mxcsr must be reachable with LDR W");
+_Static_assert(MX_OFF_CW % 2 == 0 && MX_OFF_CW < 8192 && MX_OFF_SW % 2 == 0 && MX_OFF_SW < 8192,
+               "fpu_cw and fpu_sw must be reachable with LDRH");
+
+/* ============================================================================
+ * Encodings
+ * ============================================================================ */
+
+#define A64_LDR_W       0xB9400000u     /* LDR Wt, [Xn, #imm] */
+#define A64_STR_W       0xB9000000u
+#define A64_LDRH        0x79400000u     /* LDRH Wt, [Xn, #imm] */
+#define A64_STRH        0x79000000u
+#define A64_MRS_FPCR    0xD53B4400u
+#define A64_MSR_FPCR    0xD51B4400u
+#define A64_MRS_FPSR    0xD53B4420u
+#define A64_MSR_FPSR    0xD51B4420u
+#define A64_ORR_W       0x2A000000u     /* ORR Wd, Wn, Wm, <shift> #sh */
+#define A64_EOR_W       0x4A000000u
+
+static void mx_ldst_w(code_buffer_t *b, uint32_t op, uint8_t rt, uint8_t rn, uint32_t off)
+{
+    emit_arm64_insn(b, op | ((off >> 2) << 10) | ((uint32_t)rn << 5) | rt);
+}
+
+static void mx_ldst_h(code_buffer_t *b, uint32_t op, uint8_t rt, uint8_t rn, uint32_t off)
+{
+    emit_arm64_insn(b, op | ((off >> 1) << 10) | ((uint32_t)rn << 5) | rt);
+}
+
+/* UBFX Wd, Wn, #lsb, #width */
+static void mx_ubfx(code_buffer_t *b, uint8_t d, uint8_t n, int lsb, int width)
+{
+    emit_arm64_insn(b, 0x53000000u | ((uint32_t)lsb << 16) | ((uint32_t)(lsb + width - 1) << 10) |
+                       ((uint32_t)n << 5) | d);
+}
+
+/* ORR/EOR Wd, Wn, Wm, LSL or LSR #sh (op is the unshifted 32-bit opcode) */
+static void mx_logic(code_buffer_t *b, uint32_t op, uint8_t d, uint8_t n, uint8_t m, int lsr, int sh)
+{
+    emit_arm64_insn(b, op | (lsr ? 1u << 22 : 0) | ((uint32_t)m << 16) | ((uint32_t)sh << 10) |
+                       ((uint32_t)n << 5) | d);
+}
+
+/* AND Wd, Wn, #imm, as a logical immediate (immr, imms) */
+static void mx_and_imm(code_buffer_t *b, uint8_t d, uint8_t n, int immr, int imms)
+{
+    emit_arm64_insn(b, 0x12000000u | ((uint32_t)immr << 16) | ((uint32_t)imms << 10) |
+                       ((uint32_t)n << 5) | d);
+}
+
+/* ADD Xd, Xn, Xm, LSL #sh (Xn = 31 is XZR) */
+static void mx_add_lsl(code_buffer_t *b, uint8_t d, uint8_t n, uint8_t m, int sh)
+{
+    emit_arm64_insn(b, 0x8B000000u | ((uint32_t)m << 16) | ((uint32_t)sh << 10) |
+                       ((uint32_t)n << 5) | d);
+}
+
+/* ============================================================================
+ * Operands
+ * ============================================================================ */
+
+/* X16 = effective address of the memory operand (X17 may be clobbered) */
+static void mx_addr(code_buffer_t *b, const x86_insn_t *insn, uint64_t guest_pc)
+{
+    int64_t disp = insn->disp;
+    int base = insn->rm & 0x0F;
+    int index = -1;
+    uint8_t r;
+
+    if ((insn->rm & 7) == 4) {
+        index = ((insn->sib >> 3) & 7) | ((insn->rex & 0x02) ? 8 : 0);
+        if (index == 4) {
+            index = -1;                                 /* No index */
+        }
+        base = (insn->sib & 7) | ((insn->rex & 0x01) ? 8 : 0);
+        if (insn->mod == 0 && (insn->sib & 7) == 5) {
+            base = -1;                                  /* disp32 without a base */
+        }
+    } else if (insn->mod == 0 && (insn->rm & 7) == 5) {
+        emit_mov_imm64(b, MX_XADDR, guest_pc + insn->length + (uint64_t)disp);
+        return;
+    }
+
+    if (base < 0 && index < 0) {
+        emit_mov_imm64(b, MX_XADDR, (uint64_t)disp);
+        return;
+    }
+    r = (uint8_t)base;
+    if (index >= 0) {
+        mx_add_lsl(b, MX_XADDR, base < 0 ? MX_XZR : (uint8_t)base, (uint8_t)index, insn->sib >> 6);
+        r = MX_XADDR;
+    }
+    if (disp > -4096 && disp < 0) {
+        emit_sub_imm(b, MX_XADDR, r, (uint16_t)-disp);
+    } else if (disp >= 0 && disp < 4096) {
+        if (disp || r != MX_XADDR) {
+            emit_add_imm(b, MX_XADDR, r, (uint16_t)disp);
+        }
+    } else {
+        emit_mov_imm64(b, MX_XSTATE, (uint64_t)disp);
+        mx_add_lsl(b, MX_XADDR, r, MX_XSTATE, 0);
+    }
+}
+
+static void mx_state_ptr(code_buffer_t *b)
+{
+    emit_ldr_uoff(b, MX_XSTATE, MX_XCTX, offsetof(rosetta_exec_context_t, state));
+}
+
+/* Wd = MXCSR flags for FPSR (rosetta_mxcsr_flags_from_fpsr()) */
+static void mx_fpsr_flags(code_buffer_t *b, uint8_t d)
+{
+    emit_arm64_insn(b, A64_MRS_FPSR | d);
+    mx_and_imm(b, d, d, 0, 4);                                          /* IOC-IXC */
+    emit_arm64_insn(b, 0x33000000u | (31u << 16) | (4u << 10) |
+                       ((uint32_t)d << 5) | d);                         /* BFI Wd, Wd, #1, #5 */
+    mx_and_imm(b, d, d, 30, 30);                                        /* Clear bit 1 */
+}
+
+/* ============================================================================
+ * LDMXCSR / STMXCSR
+ * ============================================================================ */
+
+/*
+ * Set FPCR RMode and FZ to bits 22-24 of Wwant, keeping the other bits,
+ * and write FPCR only if they change. Clobbers Xwant and Xt.
+ */
+static void mx_set_fpcr(code_buffer_t *b, uint8_t want, uint8_t t)
+{
+    emit_arm64_insn(b, A64_MRS_FPCR | t);
+    mx_logic(b, A64_EOR_W, want, t, want, 0, 0);
+    mx_and_imm(b, want, want, 32 - FPCR_RMODE_SHIFT, 2);               /* Bits 22-24 */
+    emit_arm64_insn(b, 0x34000000u | (3u << 5) | want);                 /* CBZ Wwant, +12 */
+    emit_arm64_insn(b, 0xCA000000u | ((uint32_t)want << 16) | ((uint32_t)t << 5) | t);  /* EOR Xt, Xt, Xwant */
+    emit_arm64_insn(b, A64_MSR_FPCR | t);
+}
+
+/* FPCR for the MXCSR value in W16 (rosetta_mxcsr_to_fpcr()); clobbers X16 and X17 */
+static void mx_fpcr_from_mxcsr(code_buffer_t *b)
+{
+    mx_ubfx(b, MX_XSTATE, MX_XADDR, MXCSR_RC_SHIFT, 3);                 /* FZ:RC */
+    mx_and_imm(b, MX_XADDR, MX_XADDR, 32 - 6, 0);                       /* DAZ */
+    mx_logic(b, A64_ORR_W, MX_XSTATE, MX_XSTATE, MX_XADDR, 1, 4);       /* FZ |= DAZ */
+    mx_logic(b, A64_EOR_W, MX_XADDR, MX_XSTATE, MX_XSTATE, 1, 1);
+    mx_and_imm(b, MX_XADDR, MX_XADDR, 0, 0);                            /* RC bits differ */
+    mx_logic(b, A64_ORR_W, MX_XADDR, MX_XADDR, MX_XADDR, 0, 1);
+    mx_logic(b, A64_EOR_W, MX_XSTATE, MX_XSTATE, MX_XADDR, 0, 0);       /* Swap them */
+    emit_arm64_insn(b, 0x53000000u | (10u << 16) | (9u << 10) |
+                       (MX_XSTATE << 5) | MX_XSTATE);                   /* LSL W17, W17, #22 */
+    mx_set_fpcr(b, MX_XSTATE, MX_XADDR);
+}
+
+static void mx_ldmxcsr(code_buffer_t *b, translate_mxcsr_state_t *st, const x86_insn_t *insn,
+                       uint64_t guest_pc)
+{
+    mx_addr(b, insn, guest_pc);
+    mx_ldst_w(b, A64_LDR_W, MX_XADDR, MX_XADDR, 0);
+    mx_state_ptr(b);
+    mx_ldst_w(b, A64_STR_W, MX_XADDR, MX_XSTATE, MX_OFF);
+    if (!st->fpsr_clear) {
+        emit_arm64_insn(b, A64_MSR_FPSR | MX_XZR);
+    }
+    mx_fpcr_from_mxcsr(b);
+
+    st->fpsr_clear = 1;
+    st->fp_since_fold = 0;
+}
+
+static void mx_stmxcsr(code_buffer_t *b, translate_mxcsr_state_t *st, const x86_insn_t *insn,
+                       uint64_t guest_pc)
+{
+    if (!st->fp_since_fold) {
+        /* guest.mxcsr is current */
+        mx_addr(b, insn, guest_pc);
+        mx_state_ptr(b);
+        mx_ldst_w(b, A64_LDR_W, MX_XSTATE, MX_XSTATE, MX_OFF);
+        mx_ldst_w(b, A64_STR_W, MX_XSTATE, MX_XADDR, 0);
+        return;
+    }
+
+    emit_arm64_insn(b, 0xF81F0FE0u | MX_XSPILL);                        /* STR X15, [SP, #-16]! */
+    mx_fpsr_flags(b, MX_XADDR);
+    mx_state_ptr(b);
+    mx_ldst_w(b, A64_LDR_W, MX_XSPILL, MX_XSTATE, MX_OFF);
+    mx_logic(b, A64_ORR_W, MX_XSPILL, MX_XSPILL, MX_XADDR, 0, 0);
+    mx_ldst_w(b, A64_STR_W, MX_XSPILL, MX_XSTATE, MX_OFF);
+    mx_addr(b, insn, guest_pc);
+    mx_ldst_w(b, A64_STR_W, MX_XSPILL, MX_XADDR, 0);
+    emit_arm64_insn(b, 0xF84107E0u | MX_XSPILL);                        /* LDR X15, [SP], #16 */
+
+    st->fp_since_fold = 0;
+}
+
+/* ============================================================================
+ * Entry Points
+ * ============================================================================ */
+
+void translate_mxcsr_begin_block(translate_mxcsr_state_t *st)
+{
+    /* FPSR is unknown at block entry */
+    memset(st, 0, sizeof(*st));
+    st->fp_since_fold = 1;
+}
+
+/*
+ * May the instruction raise an MXCSR flag? (anything in the 0F maps; x87
+ * flags go to FSW, through the x87 environment or the helper call)
+ */
+static int mx_may_raise(const x86_insn_t *insn)
+{
+    return insn->vex_prefix || insn->opcode2 != 0;
+}
+
+/* Leave the x87 environment: FPSR flags to guest.fpu_sw, FPCR from guest.mxcsr */
+static void mx_x87_leave(code_buffer_t *b, translate_mxcsr_state_t *st)
+{
+    emit_arm64_insn(b, 0xF81F0FE0u | MX_XSPILL);                        /* STR X15, [SP, #-16]! */
+    mx_state_ptr(b);
+    translate_mxcsr_emit_fsw_fold(b, MX_XSTATE, MX_XADDR, MX_XSPILL);
+    emit_arm64_insn(b, 0xF84107E0u | MX_XSPILL);                        /* LDR X15, [SP], #16 */
+    emit_arm64_insn(b, A64_MSR_FPSR | MX_XZR);
+    mx_ldst_w(b, A64_LDR_W, MX_XADDR, MX_XSTATE, MX_OFF);
+    mx_fpcr_from_mxcsr(b);
+
+    st->x87_env = 0;
+    st->fpsr_clear = 1;
+    st->fp_since_fold = 0;
+}
+
+void translate_mxcsr_x87_enter(code_buffer_t *code_buf, translate_mxcsr_state_t *st)
+{
+    if (st->x87_env) {
+        return;
+    }
+    if (st->fp_since_fold) {
+        emit_arm64_insn(code_buf, 0xF81F0FE0u | MX_XSPILL);             /* STR X15, [SP, #-16]! */
+        mx_state_ptr(code_buf);
+        translate_mxcsr_emit_leave(code_buf, MX_XSTATE, MX_XADDR, MX_XSPILL);
+        emit_arm64_insn(code_buf, 0xF84107E0u | MX_XSPILL);             /* LDR X15, [SP], #16 */
+    } else {
+        mx_state_ptr(code_buf);
+    }
+    if (!st->fpsr_clear) {
+        emit_arm64_insn(code_buf, A64_MSR_FPSR | MX_XZR);
+    }
+    translate_mxcsr_emit_fcw(code_buf, MX_XSTATE, MX_XADDR, MX_XSTATE);
+
+    st->x87_env = 1;
+    st->fpsr_clear = 1;
+    st->fp_since_fold = 0;
+}
+
+void translate_mxcsr_flush(code_buffer_t *code_buf, translate_mxcsr_state_t *st)
+{
+    if (st->x87_env) {
+        mx_x87_leave(code_buf, st);
+    }
+}
+
+int translate_mxcsr_lower(code_buffer_t *code_buf, translate_mxcsr_state_t *st,
+                          const x86_insn_t *insn, uint64_t guest_pc)
+{
+    if (st->x87_env && (x86_is_ldmxcsr(insn) || x86_is_stmxcsr(insn) || mx_may_raise(insn))) {
+        mx_x87_leave(code_buf, st);
+    }
+    if (x86_is_ldmxcsr(insn)) {
+        mx_ldmxcsr(code_buf, st, insn, guest_pc);
+        return 0;
+    }
+    if (x86_is_stmxcsr(insn)) {
+        mx_stmxcsr(code_buf, st, insn, guest_pc);
+        return 0;
+    }
+    if (mx_may_raise(insn)) {
+        st->fp_since_fold = 1;
+        st->fpsr_clear = 0;
+    }
+    return -ENOENT;
+}
+
+void translate_mxcsr_emit_leave(code_buffer_t *code_buf, uint8_t state, uint8_t t0, uint8_t t1)
+{
+    mx_fpsr_flags(code_buf, t0);
+    mx_ldst_w(code_buf, A64_LDR_W, t1, state, MX_OFF);
+    mx_logic(code_buf, A64_ORR_W, t1, t1, t0, 0, 0);
+    mx_ldst_w(code_buf, A64_STR_W, t1, state, MX_OFF);
+}
+
+void translate_mxcsr_emit_resume(code_buffer_t *code_buf)
+{
+    emit_arm64_insn(code_buf, A64_MSR_FPSR | MX_XZR);
+}
+
+void translate_mxcsr_emit_fsw_fold(code_buffer_t *code_buf, uint8_t state, uint8_t t0, uint8_t t1)
+{
+    mx_fpsr_flags(code_buf, t0);                                        /* FSW bits 0-5 match MXCSR */
+    mx_ldst_h(code_buf, A64_LDRH, t1, state, MX_OFF_SW);
+    mx_logic(code_buf, A64_ORR_W, t1, t1, t0, 0, 0);
+    mx_ldst_h(code_buf, A64_STRH, t1, state, MX_OFF_SW);
+}
+
+void translate_mxcsr_emit_fcw(code_buffer_t *code_buf, uint8_t state, uint8_t t0, uint8_t t1)
+{
+    mx_ldst_h(code_buf, A64_LDRH, t0, state, MX_OFF_CW);
+    mx_ubfx(code_buf, t0, t0, X87_CW_RC_SHIFT, 2);                      /* RC, as in MXCSR */
+    mx_logic(code_buf, A64_EOR_W, t1, t0, t0, 1, 1);
+    mx_and_imm(code_buf, t1, t1, 0, 0);                                 /* RC bits differ */
+    mx_logic(code_buf, A64_ORR_W, t1, t1, t1, 0, 1);
+    mx_logic(code_buf, A64_EOR_W, t0, t0, t1, 0, 0);                    /* Swap them */
+    emit_arm64_insn(code_buf, 0x53000000u | (10u << 16) | (9u << 10) |
+                              ((uint32_t)t0 << 5) | t0);                /* LSL Wt0, Wt0, #22 (FZ clear) */
+    mx_set_fpcr(code_buf, t0, t1);
+}
@@ -0,0 +1,124 @@
+/* ============================================================================
+ * Rosetta MXCSR Translation Header
+ * ============================================================================
+ *
+ * This header declares the lowering of LDMXCSR and STMXCSR (and their VEX
+ * forms) onto the host FPCR/FPSR, following the scheme in rosetta_mxcsr.h.
+ * ============================================================================ */
+
+#ifndef ROSETTA_TRANSLATE_MXCSR_H
+#define ROSETTA_TRANSLATE_MXCSR_H
+
+#include "rosetta_types.h"
+#include "rosetta_x86_decode.h"
+#include "rosetta_codegen.h"
+
+/* ============================================================================
+ * Block Tracking
+ * ============================================================================
+ *
+ * Nothing is emitted for ordinary FP instructions: they round under the
+ * FPCR that the last LDMXCSR installed and leave their flags in FPSR.
+ * The state below only lets a block skip work that is known redundant:
+ * STMXCSR reads FPSR only if an FP instruction may have run since the
+ * last fold, and LDMXCSR clears FPSR only if it may be non-zero.
+ *
+ * Fast-mode x87 instructions run in an x87 environment instead: FPCR
+ * rounds as the guest control word selects, with FZ clear, and their
+ * flags are folded into guest.fpu_sw. The environment is entered before
+ * the first x87 instruction and left before the next SSE/AVX instruction,
+ * LDMXCSR/STMXCSR, or translate_mxcsr_flush().
+ * ============================================================================ */
+
+typedef struct {
+    uint8_t fp_since_fold;              /* FPSR may hold flags not yet in guest.mxcsr */
+    uint8_t fpsr_clear;                 /* FPSR is known to be zero */
+    uint8_t x87_env;                    /* FPCR follows guest.fpu_cw, FPSR feeds guest.fpu_sw */
+} translate_mxcsr_state_t;
+
+/* ============================================================================
+ * Lowering
+ * ============================================================================ */
+
+/**
+ * translate_mxcsr_begin_block - Reset the tracking for a new block
+ */
+void translate_mxcsr_begin_block(translate_mxcsr_state_t *st);
+
+/**
+ * translate_mxcsr_lower - Emit the lowering of LDMXCSR/STMXCSR
+ *
+ * Called for every instruction of the block, before the other lowerings,
+ * so that the tracking sees the FP instructions too. Leaves the x87
+ * environment first when the instruction needs the MXCSR one.
+ *
+ * @param st Tracking state of the block being translated
+ * @param guest_pc Address of the instruction, for RIP-relative operands
+ * @return 0 on success, -ENOENT for other instructions
+ */
+int translate_mxcsr_lower(code_buffer_t *code_buf, translate_mxcsr_state_t *st,
+                          const x86_insn_t *insn, uint64_t guest_pc);
+
+/**
+ * translate_mxcsr_x87_enter - Enter the x87 environment, if not in it
+ *
+ * Emitted before each fast-mode x87 instruction: folds pending FPSR flags
+ * into guest.mxcsr, clears FPSR and loads FPCR from guest.fpu_cw.
+ */
+void translate_mxcsr_x87_enter(code_buffer_t *code_buf, translate_mxcsr_state_t *st);
+
+/**
+ * translate_mxcsr_flush - Leave the x87 environment, if in it
+ *
+ * Emitted where translate_x87_flush() is: before SYSCALL, string
+ * instructions and the instruction that ends the block.
+ */
+void translate_mxcsr_flush(code_buffer_t *code_buf, translate_mxcsr_state_t *st);
+
+/* ============================================================================
+ * Calls into C
+ * ============================================================================
+ *
+ * C code raises FPSR flags of its own. Translated code that calls a helper
+ * folds the guest's flags into guest.mxcsr before the call and clears
+ * FPSR after it, so only guest instructions reach MXCSR. The runtime does
+ * the same around running a block (rosetta_mxcsr_read() after it,
+ * rosetta_mxcsr_resume() before it).
+ * ============================================================================ */
+
+/**
+ * translate_mxcsr_emit_leave - Emit the fold of FPSR into guest.mxcsr
+ * @param state Register holding the ThreadState pointer (kept)
+ * @param t0 Scratch register
+ * @param t1 Scratch register
+ */
+void translate_mxcsr_emit_leave(code_buffer_t *code_buf, uint8_t state, uint8_t t0, uint8_t t1);
+
+/**
+ * translate_mxcsr_emit_resume - Emit the clear of FPSR after the call
+ */
+void translate_mxcsr_emit_resume(code_buffer_t *code_buf);
+
+/**
+ * translate_mxcsr_emit_fsw_fold - Emit the fold of FPSR into guest.fpu_sw
+ *
+ * The x87 environment's counterpart of translate_mxcsr_emit_leave().
+ * @param state Register holding the ThreadState pointer (kept)
+ * @param t0 Scratch register
+ * @param t1 Scratch register
+ */
+void translate_mxcsr_emit_fsw_fold(code_buffer_t *code_buf, uint8_t state, uint8_t t0, uint8_t t1);
+
+/**
+ * translate_mxcsr_emit_fcw - Emit the load of FPCR from guest.fpu_cw
+ *
+ * RMode follows the control word's RC and FZ is cleared; FPCR is written
+ * only if they change. Used on entering the environment and after FLDCW.
+ * @param state Register holding the ThreadState pointer (read first, so
+ *              it may also be t1)
+ * @param t0 Scratch register
+ * @param t1 Scratch register
+ */
+void translate_mxcsr_emit_fcw(code_buffer_t *code_buf, uint8_t state, uint8_t t0, uint8_t t1);
+
+#endif /* ROSETTA_TRANSLATE_MXCSR_H */
@@ -7,7 +7,10 @@
  * ============================================================================ */
 
 #include "rosetta_translate_simd.h"
+#include "rosetta_translate_simd_impl.h"
 #include "rosetta_arm64_emit.h"
+#include <errno.h>
+#include <pthread.h>
 #include <string.h>
 
 /* ============================================================================
@@ -521,4 +524,1458 @@ void translate_simd_pxor(code_buffer_t *code_buf, const x86_insn_t *insn, uint8_
     emit_simd_eor(code_buf, arm_rd, arm_rd, arm_rm);
 }
 
+/* ============================================================================
+ * Operand Access
+ * ============================================================================ */
+
+int translate_simd_supported(const translate_simd_entry_t *e, const x86_insn_t *insn)
+{
+    if (insn->mod == 3) {
+        return (e->flags & SIMD_F_MEM_ONLY) ? -ENOTSUP : 0;
+    }
+    return (e->flags & SIMD_F_REG_ONLY) ? -ENOTSUP : 0;
+}
+
+int translate_simd_mem_lg(const translate_simd_entry_t *e)
+{
+    return (e->flags & SIMD_F_M16) ? 1 : (e->flags & SIMD_F_M32) ? 2 : (e->flags & SIMD_F_M64) ? 3 : 4;
+}
+
+/* ADD Xd, Xn, Xm, LSL #sh (Xn = 31 is XZR) */
+static void simd_add_lsl(code_buffer_t *b, uint8_t d, uint8_t n, uint8_t m, int sh)
+{
+    emit_arm64_insn(b, 0x8B000000u | ((uint32_t)m << 16) | ((uint32_t)sh << 10) |
+                       ((uint32_t)n << 5) | d);
+}
+
+/* STR is LDR with the load bit (22) clear */
+int translate_simd_mem(code_buffer_t *b, const x86_insn_t *insn, uint8_t arm_rm, int lg,
+                       int64_t adjust, uint64_t guest_pc, int store, uint8_t vt)
+{
+    static const uint32_t ldr[5] = {
+        0x3D400000u, 0x7D400000u, 0xBD400000u, 0xFD400000u, 0x3DC00000u   /* LDR B/H/S/D/Q, [Xn, #imm] */
+    };
+    int64_t disp = insn->disp + adjust;
+    uint8_t base = arm_rm;
+    int index = -1;
+
+    if ((insn->rm & 7) == 4) {
+        index = ((insn->sib >> 3) & 7) | ((insn->rex & 0x02) ? 8 : 0);
+        if (index == 4) {
+            index = -1;                                 /* No index */
+        }
+        base = (uint8_t)((insn->sib & 7) | ((insn->rex & 0x01) ? 8 : 0));
+        if (insn->mod == 0 && (insn->sib & 7) == 5) {
+            base = SIMD_ZR;                             /* disp32 without a base */
+        }
+    }
+
+    if (insn->mod == 0 && (insn->rm & 7) == 5) {
+        emit_mov_imm64(b, SIMD_XT0, guest_pc + insn->length + (uint64_t)disp);
+        base = SIMD_XT0;
+        disp = 0;
+    } else if (base == SIMD_ZR && index < 0) {
+        emit_mov_imm64(b, SIMD_XT0, (uint64_t)disp);
+        base = SIMD_XT0;
+        disp = 0;
+    } else if (index >= 0 && (disp <= -4096 || disp >= 4096)) {
+        /* X16 is the only scratch: displacement first, then base and index */
+        emit_mov_imm64(b, SIMD_XT0, (uint64_t)disp);
+        if (base != SIMD_ZR) {
+            simd_add_lsl(b, SIMD_XT0, SIMD_XT0, base, 0);
+        }
+        simd_add_lsl(b, SIMD_XT0, SIMD_XT0, (uint8_t)index, insn->sib >> 6);
+        base = SIMD_XT0;
+        disp = 0;
+    } else if (index >= 0) {
+        simd_add_lsl(b, SIMD_XT0, base, (uint8_t)index, insn->sib >> 6);
+        base = SIMD_XT0;
+    }
+    if (disp < 0 || (disp & ((1 << lg) - 1)) || (disp >> lg) > 0xFFF) {
+        if (disp > -4096 && disp < 0) {
+            emit_sub_imm(b, SIMD_XT0, base, (uint16_t)-disp);
+        } else if (disp >= 0 && disp < 4096) {
+            emit_add_imm(b, SIMD_XT0, base, (uint16_t)disp);
+        } else {
+            emit_mov_imm64(b, SIMD_XT0, (uint64_t)disp);
+            simd_add_lsl(b, SIMD_XT0, SIMD_XT0, base, 0);
+        }
+        base = SIMD_XT0;
+        disp = 0;
+    }
+    emit_arm64_insn(b, (ldr[lg] & ~(store ? 0x00400000u : 0)) | ((uint32_t)(disp >> lg) << 10) |
+                       ((uint32_t)base << 5) | vt);
+    return 0;
+}
+
+static int simd_imm8(const x86_insn_t *insn)
+{
+    return (int)(insn->imm & 0xFF);
+}
+
+static int simd_rexw(const x86_insn_t *insn)
+{
+    return (insn->rex & 0x08) != 0;
+}
+
+/* ============================================================================
+ * Lowerings: Direct
+ * ============================================================================ */
+
+/* Vd = op(Vd, Vm) */
+static int lower_rrr(code_buffer_t *b, const translate_simd_entry_t *e, const x86_insn_t *insn,
+                     uint8_t d, uint8_t m)
+{
+    (void)insn;
+    neon_rrr(b, e->neon, d, d, m);
+    return 0;
+}
+
+/* Vd = op(Vm, Vd): PANDN and ANDNPS are BIC with the operands swapped */
+static int lower_rrr_rev(code_buffer_t *b, const translate_simd_entry_t *e, const x86_insn_t *insn,
+                         uint8_t d, uint8_t m)
+{
+    (void)insn;
+    neon_rrr(b, e->neon, d, m, d);
+    return 0;
+}
+
+/* Vd = op(Vm, Vm): duplicating shuffles */
+static int lower_rmm(code_buffer_t *b, const translate_simd_entry_t *e, const x86_insn_t *insn,
+                     uint8_t d, uint8_t m)
+{
+    (void)insn;
+    neon_rrr(b, e->neon, d, m, m);
+    return 0;
+}
+
+/* Vd = op(Vm) */
+static int lower_rr(code_buffer_t *b, const translate_simd_entry_t *e, const x86_insn_t *insn,
+                    uint8_t d, uint8_t m)
+{
+    (void)insn;
+    neon_rr(b, e->neon, d, m);
+    return 0;
+}
+
+/* Scalar op on lane 0, upper lanes of Vd kept; arg is the FP type */
+static int lower_scalar(code_buffer_t *b, const translate_simd_entry_t *e, const x86_insn_t *insn,
+                        uint8_t d, uint8_t m)
+{
+    (void)insn;
+    neon_rrr(b, e->neon, SIMD_T0, d, m);
+    neon_ins(b, 2 + e->arg, d, 0, SIMD_T0, 0);
+    return 0;
+}
+
+static int lower_scalar1(code_buffer_t *b, const translate_simd_entry_t *e, const x86_insn_t *insn,
+                         uint8_t d, uint8_t m)
+{
+    (void)insn;
+    neon_rr(b, e->neon, SIMD_T0, m);
+    neon_ins(b, 2 + e->arg, d, 0, SIMD_T0, 0);
+    return 0;
+}
+
+/* ============================================================================
+ * Lowerings: Moves
+ * ============================================================================ */
+
+static int lower_mov(code_buffer_t *b, const translate_simd_entry_t *e, const x86_insn_t *insn,
+                     uint8_t d, uint8_t m)
+{
+    (void)e;
+    (void)insn;
+    neon_mov(b, d, m);
+    return 0;
+}
+
+/* Store-direction opcodes in register form write ModR/M.rm */
+static int lower_mov_store(code_buffer_t *b, const translate_simd_entry_t *e, const x86_insn_t *insn,
+                           uint8_t d, uint8_t m)
+{
+    (void)e;
+    (void)insn;
+    neon_mov(b, m, d);
+    return 0;
+}
+
+/* MOVSS/MOVSD: register form merges lane 0, load form zero-extends; arg is the lane size */
+static int lower_movs(code_buffer_t *b, const translate_simd_entry_t *e, const x86_insn_t *insn,
+                      uint8_t d, uint8_t m)
+{
+    if (insn->mod == 3) {
+        neon_ins(b, e->arg, d, 0, m, 0);
+    } else {
+        neon_mov(b, d, m);
+    }
+    return 0;
+}
+
+static int lower_movs_store(code_buffer_t *b, const translate_simd_entry_t *e, const x86_insn_t *insn,
+                            uint8_t d, uint8_t m)
+{
+    (void)insn;
+    neon_ins(b, e->arg, m, 0, d, 0);
+    return 0;
+}
+
+/* MOVQ xmm, xmm/m64: FMOV Dd, Dm clears the upper half */
+static int lower_movq(code_buffer_t *b, const translate_simd_entry_t *e, const x86_insn_t *insn,
+                      uint8_t d, uint8_t m)
+{
+    (void)e;
+    (void)insn;
+    neon_rr(b, 0x1E604000u, d, m);
+    return 0;
+}
+
+static int lower_movq_store(code_buffer_t *b, const translate_simd_entry_t *e, const x86_insn_t *insn,
+                            uint8_t d, uint8_t m)
+{
+    (void)e;
+    (void)insn;
+    neon_rr(b, 0x1E604000u, m, d);
+    return 0;
+}
+
+/* MOVHLPS/MOVLPS (arg 0) and MOVLHPS/MOVHPS (arg 1) write one 64-bit half */
+static int lower_movhl(code_buffer_t *b, const translate_simd_entry_t *e, const x86_insn_t *insn,
+                       uint8_t d, uint8_t m)
+{
+    int from = (insn->mod == 3 && e->arg == 0) ? 1 : 0;
+
+    neon_ins(b, 3, d, e->arg, m, from);
+    return 0;
+}
+
+static int lower_movddup(code_buffer_t *b, const translate_simd_entry_t *e, const x86_insn_t *insn,
+                         uint8_t d, uint8_t m)
+{
+    (void)e;
+    (void)insn;
+    neon_dup(b, 3, d, m, 0);
+    return 0;
+}
+
+/* MOVD/MOVQ xmm, r/m: FMOV Sd, Wn or Dd, Xn zero the rest of Vd */
+static int lower_movd_to_xmm(code_buffer_t *b, const translate_simd_entry_t *e, const x86_insn_t *insn,
+                             uint8_t d, uint8_t m)
+{
+    (void)e;
+    neon_rr(b, simd_rexw(insn) ? 0x9E670000u : 0x1E270000u, d, m);
+    return 0;
+}
+
+static int lower_movd_from_xmm(code_buffer_t *b, const translate_simd_entry_t *e, const x86_insn_t *insn,
+                               uint8_t d, uint8_t m)
+{
+    (void)e;
+    neon_rr(b, simd_rexw(insn) ? 0x9E660000u : 0x1E260000u, m, d);
+    return 0;
+}
+
+/* ============================================================================
+ * Lowerings: Integer Arithmetic
+ * ============================================================================ */
+
+/* PACKSS/PACKUS: narrow Vd into the low half, Vm into the high half */
+static int lower_pack(code_buffer_t *b, const translate_simd_entry_t *e, const x86_insn_t *insn,
+                      uint8_t d, uint8_t m)
+{
+    (void)insn;
+    neon_rr(b, e->neon, d, d);
+    if (d == m) {
+        neon_ins(b, 3, d, 1, d, 0);
+    } else {
+        neon_rr(b, e->neon | NEON_Q, d, m);
+    }
+    return 0;
+}
+
+/* PMULHW/PMULHUW: widen both halves, keep the high 16 bits of each product */
+static int lower_mulhi(code_buffer_t *b, const translate_simd_entry_t *e, const x86_insn_t *insn,
+                       uint8_t d, uint8_t m)
+{
+    (void)insn;
+    neon_rrr(b, e->neon, SIMD_T0, d, m);
+    neon_rrr(b, e->neon | NEON_Q, SIMD_T1, d, m);
+    neon_rrr(b, NEON_UZP2(1), d, SIMD_T0, SIMD_T1);
+    return 0;
+}
+
+/* PMADDWD: 32-bit products summed pairwise */
+static int lower_pmaddwd(code_buffer_t *b, const translate_simd_entry_t *e, const x86_insn_t *insn,
+                         uint8_t d, uint8_t m)
+{
+    (void)e;
+    (void)insn;
+    neon_rrr(b, NEON_SMULL(1), SIMD_T0, d, m);
+    neon_rrr(b, NEON_SMULL(1) | NEON_Q, SIMD_T1, d, m);
+    neon_rrr(b, NEON_ADDP(2), d, SIMD_T0, SIMD_T1);
+    return 0;
+}
+
+/* PMULHRSW: (a * b + 0x4000) >> 15 is a rounding narrow of the 32-bit product */
+static int lower_pmulhrsw(code_buffer_t *b, const translate_simd_entry_t *e, const x86_insn_t *insn,
+                          uint8_t d, uint8_t m)
+{
+    (void)e;
+    (void)insn;
+    neon_rrr(b, NEON_SMULL(1), SIMD_T0, d, m);
+    neon_rrr(b, NEON_SMULL(1) | NEON_Q, SIMD_T1, d, m);
+    neon_shift(b, 0, SHIFT_RSHRN, 0, 1, 1, 15, d, SIMD_T0);
+    neon_shift(b, 0, SHIFT_RSHRN, 1, 1, 1, 15, d, SIMD_T1);
+    return 0;
+}
+
+/* PMULUDQ/PMULDQ: even 32-bit lanes widened to 64-bit products */
+static int lower_muldq(code_buffer_t *b, const translate_simd_entry_t *e, const x86_insn_t *insn,
+                       uint8_t d, uint8_t m)
+{
+    (void)insn;
+    neon_rr(b, NEON_XTN(2), SIMD_T0, d);
+    neon_rr(b, NEON_XTN(2), SIMD_T1, m);
+    neon_rrr(b, e->neon, d, SIMD_T0, SIMD_T1);
+    return 0;
+}
+
+/* PSADBW: absolute differences folded into each 64-bit half */
+static int lower_psadbw(code_buffer_t *b, const translate_simd_entry_t *e, const x86_insn_t *insn,
+                        uint8_t d, uint8_t m)
+{
+    (void)e;
+    (void)insn;
+    neon_rrr(b, NEON_UABD(0), SIMD_T0, d, m);
+    neon_rr(b, NEON_UADDLP(0), SIMD_T0, SIMD_T0);
+    neon_rr(b, NEON_UADDLP(1), SIMD_T0, SIMD_T0);
+    neon_rr(b, NEON_UADDLP(2), d, SIMD_T0);
+    return 0;
+}
+
+/* PMADDUBSW: unsigned x signed bytes, adjacent products added with saturation */
+static int lower_pmaddubsw(code_buffer_t *b, const translate_simd_entry_t *e, const x86_insn_t *insn,
+                           uint8_t d, uint8_t m)
+{
+    (void)e;
+    (void)insn;
+    neon_extend(b, 1, 0, 0, SIMD_T0, d);
+    neon_extend(b, 0, 0, 0, SIMD_T1, m);
+    neon_rrr(b, NEON_MUL(1), SIMD_T0, SIMD_T0, SIMD_T1);
+    neon_extend(b, 1, 1, 0, SIMD_T1, d);
+    neon_extend(b, 0, 1, 0, SIMD_T2, m);
+    neon_rrr(b, NEON_MUL(1), SIMD_T1, SIMD_T1, SIMD_T2);
+    neon_rrr(b, NEON_UZP1(1), SIMD_T2, SIMD_T0, SIMD_T1);
+    neon_rrr(b, NEON_UZP2(1), SIMD_T0, SIMD_T0, SIMD_T1);
+    neon_rrr(b, NEON_SQADD(1), d, SIMD_T2, SIMD_T0);
+    return 0;
+}
+
+/* PSIGNB/W/D: negate, keep or zero Vd by the sign of Vm */
+static int lower_psign(code_buffer_t *b, const translate_simd_entry_t *e, const x86_insn_t *insn,
+                       uint8_t d, uint8_t m)
+{
+    (void)insn;
+    neon_rr(b, NEON_NEG(e->arg), SIMD_T0, d);
+    neon_rr(b, NEON_CMLT0(e->arg), SIMD_T1, m);
+    neon_rrr(b, NEON_BSL, SIMD_T1, SIMD_T0, d);
+    neon_rr(b, NEON_CMEQ0(e->arg), SIMD_T0, m);
+    neon_rrr(b, NEON_BIC, d, SIMD_T1, SIMD_T0);
+    return 0;
+}
+
+/* Horizontal PHSUB*, PHADDSW, HSUBPS/PD: split even/odd lanes, then op */
+static int lower_hop(code_buffer_t *b, const translate_simd_entry_t *e, const x86_insn_t *insn,
+                     uint8_t d, uint8_t m)
+{
+    (void)insn;
+    neon_rrr(b, NEON_UZP1(e->arg), SIMD_T0, d, m);
+    neon_rrr(b, NEON_UZP2(e->arg), SIMD_T1, d, m);
+    neon_rrr(b, e->neon, d, SIMD_T0, SIMD_T1);
+    return 0;
+}
+
+/* PMOVSX/PMOVZX: arg is the source lane size, neon the U bit, steps widen */
+static int lower_pmovx(code_buffer_t *b, const translate_simd_entry_t *e, const x86_insn_t *insn,
+                       uint8_t d, uint8_t m)
+{
+    int size = e->arg & 3;
+    int steps = e->arg >> 2;
+    int i;
+
+    (void)insn;
+    neon_extend(b, (int)e->neon, 0, size, d, m);
+    for (i = 1; i < steps; i++) {
+        neon_extend(b, (int)e->neon, 0, size + i, d, d);
+    }
+    return 0;
+}
+
+/* ============================================================================
+ * Lowerings: Shifts
+ * ============================================================================ */
+
+/* PSRLW/PSRAW/PSLLW/... Vd = Vm shifted by imm8; arg = size | kind << 2 */
+static int lower_shift_imm(code_buffer_t *b, const translate_simd_entry_t *e, const x86_insn_t *insn,
+                           uint8_t d, uint8_t m)
+{
+    int size = e->arg & 3;
+    int kind = e->arg >> 2;
+    int esize = 8 << size;
+    int imm = simd_imm8(insn);
+
+    if (kind == SIMD_SHIFT_SRA) {
+        if (imm > esize) {
+            imm = esize;
+        }
+        if (imm) {
+            neon_shift(b, 0, SHIFT_SSHR, 1, size, 1, imm, d, m);
+        } else {
+            neon_mov(b, d, m);
+        }
+    } else if (imm >= esize) {
+        neon_zero(b, d);
+    } else if (kind == SIMD_SHIFT_SLL) {
+        neon_shift(b, 0, SHIFT_SHL, 1, size, 0, imm, d, m);
+    } else if (imm) {
+        neon_shift(b, 1, SHIFT_SSHR, 1, size, 1, imm, d, m);
+    } else {
+        neon_mov(b, d, m);
+    }
+    return 0;
+}
+
+/* PSRLDQ (arg 0) / PSLLDQ (arg 1): whole-register byte shifts via EXT with zero */
+static int lower_shift_bytes(code_buffer_t *b, const translate_simd_entry_t *e, const x86_insn_t *insn,
+                             uint8_t d, uint8_t m)
+{
+    int imm = simd_imm8(insn);
+
+    if (imm >= 16) {
+        neon_zero(b, d);
+    } else if (imm) {
+        neon_zero(b, SIMD_T0);
+        if (e->arg) {
+            neon_ext(b, d, SIMD_T0, m, 16 - imm);
+        } else {
+            neon_ext(b, d, m, SIMD_T0, imm);
+        }
+    } else {
+        neon_mov(b, d, m);
+    }
+    return 0;
+}
+
+/*
+ * Shift by the low 64 bits of Vm. USHL/SSHL take a signed count from the
+ * low byte of each lane, so saturate the count to 64 (past every lane
+ * width, clearing or sign-filling like x86) and splat it.
+ */
+static int lower_shift_reg(code_buffer_t *b, const translate_simd_entry_t *e, const x86_insn_t *insn,
+                           uint8_t d, uint8_t m)
+{
+    int size = e->arg & 3;
+    int kind = e->arg >> 2;
+
+    (void)insn;
+    neon_rr(b, NEON_UQXTN(2), SIMD_T0, m);
+    neon_rr(b, NEON_UQXTN(1), SIMD_T0, SIMD_T0);
+    neon_rr(b, NEON_UQXTN(0), SIMD_T0, SIMD_T0);
+    neon_movi8(b, SIMD_T1, 64, 0);
+    neon_rrr(b, NEON_UMIN(0) & ~NEON_Q, SIMD_T0, SIMD_T0, SIMD_T1);
+    neon_dup(b, 0, SIMD_T0, SIMD_T0, 0);
+    if (kind != SIMD_SHIFT_SLL) {
+        neon_rr(b, NEON_NEG(0), SIMD_T0, SIMD_T0);
+    }
+    neon_rrr(b, kind == SIMD_SHIFT_SRA ? NEON_SSHL(size) : NEON_USHL(size), d, d, SIMD_T0);
+    return 0;
+}
+
+/* ============================================================================
+ * Lowerings: Shuffles
+ * ============================================================================ */
+
+/* PSHUFB: TBL zeroes out-of-range indices, so fold bit 7 into the index */
+static int lower_pshufb(code_buffer_t *b, const translate_simd_entry_t *e, const x86_insn_t *insn,
+                        uint8_t d, uint8_t m)
+{
+    (void)e;
+    (void)insn;
+    neon_movi8(b, SIMD_T0, 0x8F, 1);
+    neon_rrr(b, NEON_AND, SIMD_T0, m, SIMD_T0);
+    neon_rrr(b, 0x4E000000u, d, d, SIMD_T0);               /* TBL Vd.16B, {Vd.16B}, T0.16B */
+    return 0;
+}
+
+/* Lanes [lo, lo + 4) of Vd from Vm by imm, other lanes copied; only moved lanes are inserted */
+static void simd_permute4(code_buffer_t *b, int size, int lo, uint8_t d, uint8_t m, int imm)
+{
+    uint8_t src = m;
+    int i;
+
+    if (d == m) {
+        neon_mov(b, SIMD_T0, m);
+        src = SIMD_T0;
+    } else {
+        neon_mov(b, d, m);
+    }
+    for (i = 0; i < 4; i++) {
+        int sel = (imm >> (2 * i)) & 3;
+
+        if (sel != i) {
+            neon_ins(b, size, d, lo + i, src, lo + sel);
+        }
+    }
+}
+
+static int lower_pshufd(code_buffer_t *b, const translate_simd_entry_t *e, const x86_insn_t *insn,
+                        uint8_t d, uint8_t m)
+{
+    int imm = simd_imm8(insn);
+
+    (void)e;
+    switch (imm) {
+    case 0xE4: neon_mov(b, d, m); break;
+    case 0x00: case 0x55: case 0xAA: case 0xFF:
+        neon_dup(b, 2, d, m, imm & 3);
+        break;
+    case 0x44: neon_dup(b, 3, d, m, 0); break;
+    case 0xEE: neon_dup(b, 3, d, m, 1); break;
+    case 0x4E: neon_ext(b, d, m, m, 8); break;
+    case 0xB1: neon_rr(b, NEON_REV64(2), d, m); break;
+    case 0x1B:
+        neon_rr(b, NEON_REV64(2), SIMD_T0, m);
+        neon_ext(b, d, SIMD_T0, SIMD_T0, 8);
+        break;
+    case 0x50: neon_rrr(b, NEON_ZIP1(2), d, m, m); break;
+    case 0xFA: neon_rrr(b, NEON_ZIP2(2), d, m, m); break;
+    case 0xA0: neon_rrr(b, NEON_TRN1(2), d, m, m); break;
+    case 0xF5: neon_rrr(b, NEON_TRN2(2), d, m, m); break;
+    case 0x88: neon_rrr(b, NEON_UZP1(2), d, m, m); break;
+    case 0xDD: neon_rrr(b, NEON_UZP2(2), d, m, m); break;
+    default:
+        simd_permute4(b, 2, 0, d, m, imm);
+        break;
+    }
+    return 0;
+}
+
+/* PSHUFLW (arg 0) and PSHUFHW (arg 4) */
+static int lower_pshufw(code_buffer_t *b, const translate_simd_entry_t *e, const x86_insn_t *insn,
+                        uint8_t d, uint8_t m)
+{
+    simd_permute4(b, 1, e->arg, d, m, simd_imm8(insn));
+    return 0;
+}
+
+/* SHUFPS: lanes 0-1 from Vd, lanes 2-3 from Vm */
+static int lower_shufps(code_buffer_t *b, const translate_simd_entry_t *e, const x86_insn_t *insn,
+                        uint8_t d, uint8_t m)
+{
+    int imm = simd_imm8(insn);
+    int i;
+
+    (void)e;
+    switch (imm) {
+    case 0x44: neon_rrr(b, NEON_ZIP1(3), d, d, m); return 0;
+    case 0xEE: neon_rrr(b, NEON_ZIP2(3), d, d, m); return 0;
+    case 0xE4: neon_ins(b, 3, d, 1, m, 1); return 0;
+    case 0x4E: neon_ext(b, d, d, m, 8); return 0;
+    case 0x88: neon_rrr(b, NEON_UZP1(2), d, d, m); return 0;
+    case 0xDD: neon_rrr(b, NEON_UZP2(2), d, d, m); return 0;
+    }
+    for (i = 0; i < 4; i++) {
+        neon_ins(b, 2, SIMD_T0, i, i < 2 ? d : m, (imm >> (2 * i)) & 3);
+    }
+    neon_mov(b, d, SIMD_T0);
+    return 0;
+}
+
+static int lower_shufpd(code_buffer_t *b, const translate_simd_entry_t *e, const x86_insn_t *insn,
+                        uint8_t d, uint8_t m)
+{
+    (void)e;
+    switch (simd_imm8(insn) & 3) {
+    case 0: neon_rrr(b, NEON_ZIP1(3), d, d, m); break;
+    case 1: neon_ext(b, d, d, m, 8); break;
+    case 2: neon_ins(b, 3, d, 1, m, 1); break;
+    case 3: neon_rrr(b, NEON_ZIP2(3), d, d, m); break;
+    }
+    return 0;
+}
+
+/* PALIGNR: bytes imm.. of Vd:Vm */
+static int lower_palignr(code_buffer_t *b, const translate_simd_entry_t *e, const x86_insn_t *insn,
+                         uint8_t d, uint8_t m)
+{
+    int imm = simd_imm8(insn);
+
+    (void)e;
+    if (imm >= 32) {
+        neon_zero(b, d);
+    } else if (imm > 16) {
+        neon_zero(b, SIMD_T0);
+        neon_ext(b, d, d, SIMD_T0, imm - 16);
+    } else if (imm == 0) {
+        neon_mov(b, d, m);
+    } else if (imm < 16) {
+        neon_ext(b, d, m, d, imm);
+    }
+    return 0;
+}
+
+/* BLENDPS/BLENDPD/PBLENDW: copy the imm-selected lanes, widest first; arg is the lane size */
+static int lower_blend_imm(code_buffer_t *b, const translate_simd_entry_t *e, const x86_insn_t *insn,
+                           uint8_t d, uint8_t m)
+{
+    int size = e->arg;
+    int lanes = 16 >> size;
+    int all = (1 << lanes) - 1;
+    int imm = simd_imm8(insn) & all;
+    int i = 0;
+
+    if (imm == all) {
+        neon_mov(b, d, m);
+        return 0;
+    }
+    while (i < lanes) {
+        int s = 3;
+
+        /* Widest lane starting at i that the mask covers */
+        while (s > size) {
+            int n = 1 << (s - size);
+            int mask = ((1 << n) - 1) << i;
+
+            if ((i & (n - 1)) == 0 && (imm & mask) == mask) {
+                break;
+            }
+            s--;
+        }
+        if (imm & (1 << i)) {
+            neon_ins(b, s, d, i >> (s - size), m, i >> (s - size));
+        }
+        i += 1 << (s - size);
+    }
+    return 0;
+}
+
+/* PBLENDVB/BLENDVPS/BLENDVPD: select by the sign of each XMM0 lane */
+static int lower_blendv(code_buffer_t *b, const translate_simd_entry_t *e, const x86_insn_t *insn,
+                        uint8_t d, uint8_t m)
+{
+    (void)insn;
+    neon_rr(b, NEON_CMLT0(e->arg), SIMD_T0, SIMD_XMM0);
+    neon_rrr(b, NEON_BIT, d, m, SIMD_T0);
+    return 0;
+}
+
+/* INSERTPS: one lane from Vm (or m32), then the zero mask */
+static int lower_insertps(code_buffer_t *b, const translate_simd_entry_t *e, const x86_insn_t *insn,
+                          uint8_t d, uint8_t m)
+{
+    int imm = simd_imm8(insn);
+    int i;
+
+    (void)e;
+    neon_ins(b, 2, d, (imm >> 4) & 3, m, insn->mod == 3 ? (imm >> 6) & 3 : 0);
+    for (i = 0; i < 4; i++) {
+        if (imm & (1 << i)) {
+            neon_ins_gpr(b, 2, d, i, SIMD_ZR);
+        }
+    }
+    return 0;
+}
+
+/* ============================================================================
+ * Lowerings: Lane Extract/Insert
+ * ============================================================================ */
+
+/* PEXTRB/W/D/Q: UMOV zero-extends like x86; arg is the lane size, REX.W picks Q */
+static int lower_pextr(code_buffer_t *b, const translate_simd_entry_t *e, const x86_insn_t *insn,
+                       uint8_t d, uint8_t m)
+{
+    int size = e->arg + (e->arg == 2 && simd_rexw(insn));
+    int lanes = 16 >> size;
+
+    /* 0F C5 names the GPR in ModR/M.reg, 0F 3A 14-16 in ModR/M.rm */
+    if (e->flags & SIMD_F_GPR_REG) {
+        neon_umov(b, size, d, m, simd_imm8(insn) & (lanes - 1));
+    } else {
+        neon_umov(b, size, m, d, simd_imm8(insn) & (lanes - 1));
+    }
+    return 0;
+}
+
+static int lower_pinsr(code_buffer_t *b, const translate_simd_entry_t *e, const x86_insn_t *insn,
+                       uint8_t d, uint8_t m)
+{
+    int size = e->arg + (e->arg == 2 && simd_rexw(insn));
+    int lanes = 16 >> size;
+
+    neon_ins_gpr(b, size, d, simd_imm8(insn) & (lanes - 1), m);
+    return 0;
+}
+
+/*
+ * PMOVMSKB/MOVMSKPS/MOVMSKPD: isolate each sign bit, then fold neighbouring
+ * lanes together with shift-right-accumulate until every 64-bit half holds
+ * its half of the mask in its low byte.
+ */
+static int lower_movmsk(code_buffer_t *b, const translate_simd_entry_t *e, const x86_insn_t *insn,
+                        uint8_t d, uint8_t m)
+{
+    int size = e->arg;
+    int esize = 8 << size;
+    int lanes = 16 >> size;
+    int cur;
+
+    (void)insn;
+    neon_shift(b, 1, SHIFT_SSHR, 1, size, 1, esize - 1, SIMD_T0, m);
+    for (cur = esize; cur < 64; cur *= 2) {
+        int s = 0;
+
+        while ((8 << s) < 2 * cur) {
+            s++;
+        }
+        neon_shift(b, 1, SHIFT_USRA, 1, s, 1, cur - cur / esize, SIMD_T0, SIMD_T0);
+    }
+    neon_umov(b, 0, d, SIMD_T0, 0);
+    neon_umov(b, 0, SIMD_XT0, SIMD_T0, 8);
+    emit_arm64_insn(b, 0x2A000000u | (SIMD_XT0 << 16) | ((uint32_t)(lanes / 2) << 10) |
+                       ((uint32_t)d << 5) | d);          /* ORR Wd, Wd, W16, LSL #lanes/2 */
+    return 0;
+}
+
+/*
+ * PTEST: ZF = (Vd & Vm) == 0, CF = (~Vd & Vm) == 0, other flags clear.
+ * Flags follow the translator's mapping: ZF in Z, CF inverted in C (as
+ * after SUBS), PF in V. UMAXP folds each AND into one 32-bit "any set"
+ * lane; rotating the 64-bit pair by 34 lands lane 0 on bit 30 (Z) and
+ * lane 1 on bit 29 (C).
+ */
+void translate_simd_ptest_flags(code_buffer_t *b)
+{
+    uint32_t enc;
+
+    neon_rrr(b, NEON_UMAXP(2), SIMD_T0, SIMD_T0, SIMD_T1);
+    neon_rrr(b, NEON_UMAXP(2), SIMD_T0, SIMD_T0, SIMD_T0);
+    neon_rr(b, NEON_CMEQ0(2) & ~NEON_Q, SIMD_T0, SIMD_T0);
+    neon_rr(b, 0x9E660000u, SIMD_XT0, SIMD_T0);           /* FMOV X16, D31 */
+    arm64_encode_bitmask_imm(0xFFFFFFFF00000000ull, 1, &enc);
+    emit_arm64_insn(b, 0xD2000000u | enc | (SIMD_XT0 << 5) | SIMD_XT0);     /* EOR */
+    emit_arm64_insn(b, 0x93C00000u | (SIMD_XT0 << 16) | (34u << 10) |
+                       (SIMD_XT0 << 5) | SIMD_XT0);      /* ROR X16, X16, #34 */
+    arm64_encode_bitmask_imm(0x60000000ull, 1, &enc);
+    emit_arm64_insn(b, 0x92000000u | enc | (SIMD_XT0 << 5) | SIMD_XT0);     /* AND */
+    emit_arm64_insn(b, 0xD51B4200u | SIMD_XT0);           /* MSR NZCV, X16 */
+}
+
+static int lower_ptest(code_buffer_t *b, const translate_simd_entry_t *e, const x86_insn_t *insn,
+                       uint8_t d, uint8_t m)
+{
+    (void)e;
+    (void)insn;
+    neon_rrr(b, NEON_AND, SIMD_T0, d, m);
+    neon_rrr(b, NEON_BIC, SIMD_T1, m, d);
+    translate_simd_ptest_flags(b);
+    return 0;
+}
+
+/* ============================================================================
+ * Lowerings: Floating Point
+ * ============================================================================ */
+
+/*
+ * MINPS/MAXPS and friends return the second operand when either is NaN or
+ * both are zero, which FMIN/FMAX do not; a compare and select does. arg is
+ * sz | max << 1 | scalar << 2.
+ */
+static int lower_minmax(code_buffer_t *b, const translate_simd_entry_t *e, const x86_insn_t *insn,
+                        uint8_t d, uint8_t m)
+{
+    int sz = e->arg & 1;
+    int max = (e->arg >> 1) & 1;
+
+    (void)insn;
+    if (max) {
+        neon_rrr(b, NEON_FCMGT(sz), SIMD_T0, d, m);
+    } else {
+        neon_rrr(b, NEON_FCMGT(sz), SIMD_T0, m, d);
+    }
+    if (e->arg & 4) {
+        neon_rrr(b, NEON_BSL, SIMD_T0, d, m);
+        neon_ins(b, 2 + sz, d, 0, SIMD_T0, 0);
+    } else {
+        neon_rrr(b, NEON_BIF, d, m, SIMD_T0);
+    }
+    return 0;
+}
+
+/*
+ * CMPPS/CMPPD/CMPSS/CMPSD; arg is sz | scalar << 2. Legacy forms have
+ * predicates 0-7, VEX forms 0-31, where bit 4 only changes which QNaNs
+ * signal. Predicates 8-15 are GT/GE with the operands in x86 order,
+ * "less or greater" and TRUE, negated when bit 2 is clear.
+ */
+static int lower_cmpfp(code_buffer_t *b, const translate_simd_entry_t *e, const x86_insn_t *insn,
+                       uint8_t d, uint8_t m)
+{
+    int sz = e->arg & 1;
+    int pred = simd_imm8(insn) & (insn->vex_prefix ? 15 : 7);
+    uint8_t r = (e->arg & 4) ? SIMD_T0 : d;
+
+    if (pred & 8) {
+        switch (pred & 3) {
+        case 0:
+            neon_rrr(b, NEON_FCMGT(sz), SIMD_T1, m, d);
+            neon_rrr(b, NEON_FCMGT(sz), r, d, m);
+            neon_rrr(b, NEON_ORR, r, r, SIMD_T1);
+            break;
+        case 1: neon_rrr(b, NEON_FCMGE(sz), r, d, m); break;
+        case 2: neon_rrr(b, NEON_FCMGT(sz), r, d, m); break;
+        case 3:
+            neon_ones(b, r);
+            break;
+        }
+        pred ^= 4;
+    } else {
+        switch (pred & 3) {
+        case 0: neon_rrr(b, NEON_FCMEQ(sz), r, d, m); break;
+        case 1: neon_rrr(b, NEON_FCMGT(sz), r, m, d); break;
+        case 2: neon_rrr(b, NEON_FCMGE(sz), r, m, d); break;
+        case 3:
+            neon_rrr(b, NEON_FCMEQ(sz), SIMD_T1, d, d);
+            neon_rrr(b, NEON_FCMEQ(sz), r, m, m);
+            neon_rrr(b, NEON_AND, r, r, SIMD_T1);
+            pred ^= 4;                                  /* The AND computes ORD */
+            break;
+        }
+    }
+    if (pred & 4) {
+        neon_rr(b, NEON_NOT, r, r);
+    }
+    if (r != d) {
+        neon_ins(b, 2 + sz, d, 0, r, 0);
+    }
+    return 0;
+}
+
+/*
+ * UCOMISS/COMISS/UCOMISD/COMISD: FCMP gives x86's ZF/PF/CF under the Z,
+ * V, inverted-C mapping except when unordered (x86 sets all three);
+ * FCCMP replaces the unordered result with Z and V set, C clear.
+ */
+static int lower_comis(code_buffer_t *b, const translate_simd_entry_t *e, const x86_insn_t *insn,
+                       uint8_t d, uint8_t m)
+{
+    (void)insn;
+    emit_arm64_insn(b, 0x1E202000u | ((uint32_t)e->arg << 22) | ((uint32_t)m << 16) |
+                       ((uint32_t)d << 5));              /* FCMP */
+    emit_arm64_insn(b, 0x1E200400u | ((uint32_t)e->arg << 22) | ((uint32_t)m << 16) |
+                       (7u << 12) | ((uint32_t)d << 5) | 0x5); /* FCCMP ..., #0b0101, VC */
+    return 0;
+}
+
+/* ROUNDPS/PD/SS/SD: imm bit 2 defers to MXCSR (FPCR after translation) */
+static int lower_round(code_buffer_t *b, const translate_simd_entry_t *e, const x86_insn_t *insn,
+                       uint8_t d, uint8_t m)
+{
+    int sz = e->arg & 1;
+    int imm = simd_imm8(insn);
+    uint32_t op;
+
+    if (imm & 4) {
+        op = NEON_FRINTI(sz);
+    } else {
+        static const uint32_t modes[4] = {
+            NEON_FRINTN(0), NEON_FRINTM(0), NEON_FRINTP(0), NEON_FRINTZ(0)
+        };
+        op = modes[imm & 3] | ((uint32_t)sz << 22);
+    }
+    if (e->arg & 4) {
+        neon_rr(b, op, SIMD_T0, m);
+        neon_ins(b, 2 + sz, d, 0, SIMD_T0, 0);
+    } else {
+        neon_rr(b, op, d, m);
+    }
+    return 0;
+}
+
+/* DPPS/DPPD: masked products, pairwise sums in x86 order, masked broadcast */
+static int lower_dp(code_buffer_t *b, const translate_simd_entry_t *e, const x86_insn_t *insn,
+                    uint8_t d, uint8_t m)
+{
+    int sz = e->arg;
+    int lanes = sz ? 2 : 4;
+    int imm = simd_imm8(insn);
+    int i;
+
+    neon_rrr(b, NEON_FMUL(sz), SIMD_T0, d, m);
+    for (i = 0; i < lanes; i++) {
+        if (!(imm & (0x10 << i))) {
+            neon_ins_gpr(b, 2 + sz, SIMD_T0, i, SIMD_ZR);
+        }
+    }
+    neon_rrr(b, NEON_FADDP(sz), SIMD_T0, SIMD_T0, SIMD_T0);
+    if (!sz) {
+        neon_rrr(b, NEON_FADDP(sz), SIMD_T0, SIMD_T0, SIMD_T0);
+    }
+    neon_mov(b, d, SIMD_T0);
+    for (i = 0; i < lanes; i++) {
+        if (!(imm & (1 << i))) {
+            neon_ins_gpr(b, 2 + sz, d, i, SIMD_ZR);
+        }
+    }
+    return 0;
+}
+
+/* ADDSUBPS/ADDSUBPD: subtract in even lanes, add in odd lanes */
+static int lower_addsub(code_buffer_t *b, const translate_simd_entry_t *e, const x86_insn_t *insn,
+                        uint8_t d, uint8_t m)
+{
+    int sz = e->arg;
+
+    (void)insn;
+    neon_rrr(b, NEON_FSUB(sz), SIMD_T0, d, m);
+    neon_rrr(b, NEON_FADD(sz), d, d, m);
+    neon_ins(b, 2 + sz, d, 0, SIMD_T0, 0);
+    if (!sz) {
+        neon_ins(b, 2, d, 2, SIMD_T0, 2);
+    }
+    return 0;
+}
+
+/* ============================================================================
+ * Lowerings: Conversions
+ * ============================================================================ */
+
+/*
+ * Float to same-width integer with x86's "integer indefinite" (INT_MIN)
+ * for NaN and overflow; FCVTZS saturates instead. INT_MAX itself is not
+ * representable in the source format, so a saturated-high lane is an
+ * overflow. Result in SIMD_T2.
+ */
+static void simd_cvt_same(code_buffer_t *b, int sz, uint8_t src, int round)
+{
+    int size = 2 + sz;
+    int esize = 8 << size;
+
+    if (round) {
+        neon_rr(b, NEON_FRINTI(sz), SIMD_T0, src);
+        neon_rr(b, NEON_FCVTZS(sz), SIMD_T0, SIMD_T0);
+    } else {
+        neon_rr(b, NEON_FCVTZS(sz), SIMD_T0, src);
+    }
+    neon_rrr(b, NEON_FCMEQ(sz), SIMD_T1, src, src);
+    neon_ones(b, SIMD_T2);
+    neon_shift(b, 1, SHIFT_SSHR, 1, size, 1, 1, SIMD_T2, SIMD_T2);
+    neon_rrr(b, NEON_CMEQ(size), SIMD_T2, SIMD_T0, SIMD_T2);
+    neon_rrr(b, NEON_BIC, SIMD_T1, SIMD_T1, SIMD_T2);
+    neon_ones(b, SIMD_T2);
+    neon_shift(b, 0, SHIFT_SHL, 1, size, 0, esize - 1, SIMD_T2, SIMD_T2);
+    neon_rrr(b, NEON_BIT, SIMD_T2, SIMD_T0, SIMD_T1);
+}
+
+/*
+ * Doubles to int32 in the low half, upper half zero. INT32_MAX is a
+ * double, so range is checked by widening the saturated narrow back.
+ * Result in SIMD_T0.
+ */
+static void simd_cvt_narrow(code_buffer_t *b, uint8_t src, int round)
+{
+    if (round) {
+        neon_rr(b, NEON_FRINTI(1), SIMD_T0, src);
+        neon_rr(b, NEON_FCVTZS(1), SIMD_T0, SIMD_T0);
+    } else {
+        neon_rr(b, NEON_FCVTZS(1), SIMD_T0, src);
+    }
+    neon_rr(b, NEON_SQXTN(2), SIMD_T1, SIMD_T0);
+    neon_extend(b, 0, 0, 2, SIMD_T2, SIMD_T1);
+    neon_rrr(b, NEON_CMEQ(3), SIMD_T2, SIMD_T2, SIMD_T0);
+    neon_rrr(b, NEON_FCMEQ(1), SIMD_T0, src, src);
+    neon_rrr(b, NEON_AND, SIMD_T2, SIMD_T2, SIMD_T0);
+    neon_rr(b, NEON_XTN(2), SIMD_T2, SIMD_T2);
+    emit_arm64_insn(b, 0x0F046400u | SIMD_T0);            /* MOVI T0.2S, #0x80, LSL #24 */
+    neon_rrr(b, NEON_BIT, SIMD_T0, SIMD_T1, SIMD_T2);
+}
+
+/* CVTPS2DQ/CVTTPS2DQ (arg 0) and CVTPD2DQ/CVTTPD2DQ (arg 1); neon is "round" */
+static int lower_cvt_to_int(code_buffer_t *b, const translate_simd_entry_t *e, const x86_insn_t *insn,
+                            uint8_t d, uint8_t m)
+{
+    (void)insn;
+    if (e->arg) {
+        simd_cvt_narrow(b, m, (int)e->neon);
+        neon_mov(b, d, SIMD_T0);
+    } else {
+        simd_cvt_same(b, 0, m, (int)e->neon);
+        neon_mov(b, d, SIMD_T2);
+    }
+    return 0;
+}
+
+/* CVT(T)SS2SI/CVT(T)SD2SI r32/r64, xmm/m; arg is the source sz, neon is "round" */
+static int lower_cvt_to_gpr(code_buffer_t *b, const translate_simd_entry_t *e, const x86_insn_t *insn,
+                            uint8_t d, uint8_t m)
+{
+    int wide = simd_rexw(insn);
+
+    if (e->arg == 1 && !wide) {
+        simd_cvt_narrow(b, m, (int)e->neon);
+        neon_rr(b, 0x1E260000u, d, SIMD_T0);              /* FMOV Wd, S31 */
+        return 0;
+    }
+    if (e->arg == 0 && wide) {
+        neon_rr(b, NEON_FCVTL(1), SIMD_TMEM, m);          /* Exact widening */
+        m = SIMD_TMEM;
+    }
+    simd_cvt_same(b, wide, m, (int)e->neon);
+    neon_rr(b, wide ? 0x9E660000u : 0x1E260000u, d, SIMD_T2);
+    return 0;
+}
+
+/* CVTSI2SS/CVTSI2SD xmm, r32/r64; arg is the destination type */
+static int lower_cvt_from_gpr(code_buffer_t *b, const translate_simd_entry_t *e, const x86_insn_t *insn,
+                              uint8_t d, uint8_t m)
+{
+    emit_arm64_insn(b, 0x1E220000u | ((uint32_t)simd_rexw(insn) << 31) | ((uint32_t)e->arg << 22) |
+                       ((uint32_t)m << 5) | SIMD_T0);    /* SCVTF */
+    neon_ins(b, 2 + e->arg, d, 0, SIMD_T0, 0);
+    return 0;
+}
+
+static int lower_cvtdq2pd(code_buffer_t *b, const translate_simd_entry_t *e, const x86_insn_t *insn,
+                          uint8_t d, uint8_t m)
+{
+    (void)e;
+    (void)insn;
+    neon_extend(b, 0, 0, 2, SIMD_T0, m);
+    neon_rr(b, NEON_SCVTF(1), d, SIMD_T0);
+    return 0;
+}
+
+/* ============================================================================
+ * SSE to NEON Lowering Table
+ * ============================================================================ */
+
+#define X_      SIMD_EXT_NONE
+#define F_IMM   SIMD_F_IMM8
+#define F_M16   SIMD_F_M16
+#define F_M32   SIMD_F_M32
+#define F_M64   SIMD_F_M64
+#define F_REG   SIMD_F_REG_ONLY
+#define F_MEM   SIMD_F_MEM_ONLY
+#define F_GREG  SIMD_F_GPR_REG
+#define F_GRM   SIMD_F_GPR_RM
+#define F_S     SIMD_F_FP32
+#define F_D     SIMD_F_FP64
+#define F_W     SIMD_F_REXW
+#define F_ST    SIMD_F_STORE
+#define F_NV    SIMD_F_NO_VVVV
+#define F_Y     SIMD_F_YMM
+#define F_YI    (SIMD_F_YMM | SIMD_F_YMM_IMMHI)
+#define F_YC    (SIMD_F_YMM | SIMD_F_YMM_COUNT)
+#define F_YW    SIMD_F_YMM_WIDEN
+
+/* Sorted by map, then opcode */
+static const translate_simd_entry_t g_simd_table[] = {
+    /* 0F 1x: moves */
+    { 0x00, 0x0F, 0x10, X_, F_NV | F_Y,     0, 0, lower_mov,         "movups" },
+    { 0x66, 0x0F, 0x10, X_, F_NV | F_Y,     0, 0, lower_mov,         "movupd" },
+    { 0xF3, 0x0F, 0x10, X_, F_M32,          2, 0, lower_movs,        "movss" },
+    { 0xF2, 0x0F, 0x10, X_, F_M64,          3, 0, lower_movs,        "movsd" },
+    { 0x00, 0x0F, 0x11, X_, F_ST | F_NV | F_Y, 0, 0, lower_mov_store, "movups.st" },
+    { 0x66, 0x0F, 0x11, X_, F_ST | F_NV | F_Y, 0, 0, lower_mov_store, "movupd.st" },
+    { 0xF3, 0x0F, 0x11, X_, F_ST | F_M32,   2, 0, lower_movs_store,  "movss.st" },
+    { 0xF2, 0x0F, 0x11, X_, F_ST | F_M64,   3, 0, lower_movs_store,  "movsd.st" },
+    { 0x00, 0x0F, 0x12, X_, F_M64,          0, 0, lower_movhl,       "movhlps" },
+    { 0x66, 0x0F, 0x12, X_, F_M64 | F_MEM,  0, 0, lower_movhl,       "movlpd" },
+    { 0xF3, 0x0F, 0x12, X_, F_NV | F_Y,     0, NEON_TRN1(2), lower_rmm, "movsldup" },
+    { 0xF2, 0x0F, 0x12, X_, F_M64 | F_NV | F_Y, 0, 0, lower_movddup, "movddup" },
+    { 0x00, 0x0F, 0x14, X_, F_Y,            0, NEON_ZIP1(2), lower_rrr, "unpcklps" },
+    { 0x66, 0x0F, 0x14, X_, F_Y,            0, NEON_ZIP1(3), lower_rrr, "unpcklpd" },
+    { 0x00, 0x0F, 0x15, X_, F_Y,            0, NEON_ZIP2(2), lower_rrr, "unpckhps" },
+    { 0x66, 0x0F, 0x15, X_, F_Y,            0, NEON_ZIP2(3), lower_rrr, "unpckhpd" },
+    { 0x00, 0x0F, 0x16, X_, F_M64,          1, 0, lower_movhl,       "movlhps" },
+    { 0x66, 0x0F, 0x16, X_, F_M64 | F_MEM,  1, 0, lower_movhl,       "movhpd" },
+    { 0xF3, 0x0F, 0x16, X_, F_NV | F_Y,     0, NEON_TRN2(2), lower_rmm, "movshdup" },
+
+    /* 0F 2x: moves, conversions, compares */
+    { 0x00, 0x0F, 0x28, X_, F_NV | F_Y,     0, 0, lower_mov,         "movaps" },
+    { 0x66, 0x0F, 0x28, X_, F_NV | F_Y,     0, 0, lower_mov,         "movapd" },
+    { 0x00, 0x0F, 0x29, X_, F_ST | F_NV | F_Y, 0, 0, lower_mov_store, "movaps.st" },
+    { 0x66, 0x0F, 0x29, X_, F_ST | F_NV | F_Y, 0, 0, lower_mov_store, "movapd.st" },
+    { 0xF3, 0x0F, 0x2A, X_, F_REG | F_GRM | F_W, 0, 0, lower_cvt_from_gpr, "cvtsi2ss" },
+    { 0xF2, 0x0F, 0x2A, X_, F_REG | F_GRM | F_W, 1, 0, lower_cvt_from_gpr, "cvtsi2sd" },
+    { 0xF3, 0x0F, 0x2C, X_, F_M32 | F_GREG | F_W | F_NV, 0, 0, lower_cvt_to_gpr, "cvttss2si" },
+    { 0xF2, 0x0F, 0x2C, X_, F_M64 | F_GREG | F_W | F_NV, 1, 0, lower_cvt_to_gpr, "cvttsd2si" },
+    { 0xF3, 0x0F, 0x2D, X_, F_M32 | F_GREG | F_W | F_NV, 0, 1, lower_cvt_to_gpr, "cvtss2si" },
+    { 0xF2, 0x0F, 0x2D, X_, F_M64 | F_GREG | F_W | F_NV, 1, 1, lower_cvt_to_gpr, "cvtsd2si" },
+    { 0x00, 0x0F, 0x2E, X_, F_M32 | SIMD_F_FLAGS | F_NV, 0, 0, lower_comis, "ucomiss" },
+    { 0x66, 0x0F, 0x2E, X_, F_M64 | SIMD_F_FLAGS | F_NV, 1, 0, lower_comis, "ucomisd" },
+    { 0x00, 0x0F, 0x2F, X_, F_M32 | SIMD_F_FLAGS | F_NV, 0, 0, lower_comis, "comiss" },
+    { 0x66, 0x0F, 0x2F, X_, F_M64 | SIMD_F_FLAGS | F_NV, 1, 0, lower_comis, "comisd" },
+
+    /* 0F 5x: FP arithmetic */
+    { 0x00, 0x0F, 0x50, X_, F_REG | F_GREG | F_NV, 2, 0, lower_movmsk, "movmskps" },
+    { 0x66, 0x0F, 0x50, X_, F_REG | F_GREG | F_NV, 3, 0, lower_movmsk, "movmskpd" },
+    { 0x00, 0x0F, 0x51, X_, F_S | F_NV | F_Y, 0, NEON_FSQRT(0), lower_rr, "sqrtps" },
+    { 0x66, 0x0F, 0x51, X_, F_D | F_NV | F_Y, 0, NEON_FSQRT(1), lower_rr, "sqrtpd" },
+    { 0xF3, 0x0F, 0x51, X_, F_M32 | F_S,    0, FP_FSQRT(0), lower_scalar1, "sqrtss" },
+    { 0xF2, 0x0F, 0x51, X_, F_M64 | F_D,    1, FP_FSQRT(1), lower_scalar1, "sqrtsd" },
+    { 0x00, 0x0F, 0x54, X_, F_Y,            0, NEON_AND, lower_rrr,  "andps" },
+    { 0x66, 0x0F, 0x54, X_, F_Y,            0, NEON_AND, lower_rrr,  "andpd" },
+    { 0x00, 0x0F, 0x55, X_, F_Y,            0, NEON_BIC, lower_rrr_rev, "andnps" },
+    { 0x66, 0x0F, 0x55, X_, F_Y,            0, NEON_BIC, lower_rrr_rev, "andnpd" },
+    { 0x00, 0x0F, 0x56, X_, F_Y,            0, NEON_ORR, lower_rrr,  "orps" },
+    { 0x66, 0x0F, 0x56, X_, F_Y,            0, NEON_ORR, lower_rrr,  "orpd" },
+    { 0x00, 0x0F, 0x57, X_, F_Y,            0, NEON_EOR, lower_rrr,  "xorps" },
+    { 0x66, 0x0F, 0x57, X_, F_Y,            0, NEON_EOR, lower_rrr,  "xorpd" },
+    { 0x00, 0x0F, 0x58, X_, F_S | F_Y,      0, NEON_FADD(0), lower_rrr, "addps" },
+    { 0x66, 0x0F, 0x58, X_, F_D | F_Y,      0, NEON_FADD(1), lower_rrr, "addpd" },
+    { 0xF3, 0x0F, 0x58, X_, F_M32 | F_S,    0, FP_FADD(0), lower_scalar, "addss" },
+    { 0xF2, 0x0F, 0x58, X_, F_M64 | F_D,    1, FP_FADD(1), lower_scalar, "addsd" },
+    { 0x00, 0x0F, 0x59, X_, F_S | F_Y,      0, NEON_FMUL(0), lower_rrr, "mulps" },
+    { 0x66, 0x0F, 0x59, X_, F_D | F_Y,      0, NEON_FMUL(1), lower_rrr, "mulpd" },
+    { 0xF3, 0x0F, 0x59, X_, F_M32 | F_S,    0, FP_FMUL(0), lower_scalar, "mulss" },
+    { 0xF2, 0x0F, 0x59, X_, F_M64 | F_D,    1, FP_FMUL(1), lower_scalar, "mulsd" },
+    { 0x00, 0x0F, 0x5A, X_, F_M64 | F_D | F_NV | F_YW, 0, NEON_FCVTL(1), lower_rr, "cvtps2pd" },
+    { 0x66, 0x0F, 0x5A, X_, F_S | F_NV,     0, NEON_FCVTN(1), lower_rr, "cvtpd2ps" },
+    { 0xF3, 0x0F, 0x5A, X_, F_M32 | F_D,    1, FP_FCVT_TO_D, lower_scalar1, "cvtss2sd" },
+    { 0xF2, 0x0F, 0x5A, X_, F_M64 | F_S,    0, FP_FCVT_TO_S, lower_scalar1, "cvtsd2ss" },
+    { 0x00, 0x0F, 0x5B, X_, F_S | F_NV | F_Y, 0, NEON_SCVTF(0), lower_rr, "cvtdq2ps" },
+    { 0x66, 0x0F, 0x5B, X_, F_NV | F_Y,     0, 1, lower_cvt_to_int,  "cvtps2dq" },
+    { 0xF3, 0x0F, 0x5B, X_, F_NV | F_Y,     0, 0, lower_cvt_to_int,  "cvttps2dq" },
+    { 0x00, 0x0F, 0x5C, X_, F_S | F_Y,      0, NEON_FSUB(0), lower_rrr, "subps" },
+    { 0x66, 0x0F, 0x5C, X_, F_D | F_Y,      0, NEON_FSUB(1), lower_rrr, "subpd" },
+    { 0xF3, 0x0F, 0x5C, X_, F_M32 | F_S,    0, FP_FSUB(0), lower_scalar, "subss" },
+    { 0xF2, 0x0F, 0x5C, X_, F_M64 | F_D,    1, FP_FSUB(1), lower_scalar, "subsd" },
+    { 0x00, 0x0F, 0x5D, X_, F_S | F_Y,      0, 0, lower_minmax,      "minps" },
+    { 0x66, 0x0F, 0x5D, X_, F_D | F_Y,      1, 0, lower_minmax,      "minpd" },
+    { 0xF3, 0x0F, 0x5D, X_, F_M32 | F_S,    4, 0, lower_minmax,      "minss" },
+    { 0xF2, 0x0F, 0x5D, X_, F_M64 | F_D,    5, 0, lower_minmax,      "minsd" },
+    { 0x00, 0x0F, 0x5E, X_, F_S | F_Y,      0, NEON_FDIV(0), lower_rrr, "divps" },
+    { 0x66, 0x0F, 0x5E, X_, F_D | F_Y,      0, NEON_FDIV(1), lower_rrr, "divpd" },
+    { 0xF3, 0x0F, 0x5E, X_, F_M32 | F_S,    0, FP_FDIV(0), lower_scalar, "divss" },
+    { 0xF2, 0x0F, 0x5E, X_, F_M64 | F_D,    1, FP_FDIV(1), lower_scalar, "divsd" },
+    { 0x00, 0x0F, 0x5F, X_, F_S | F_Y,      2, 0, lower_minmax,      "maxps" },
+    { 0x66, 0x0F, 0x5F, X_, F_D | F_Y,      3, 0, lower_minmax,      "maxpd" },
+    { 0xF3, 0x0F, 0x5F, X_, F_M32 | F_S,    6, 0, lower_minmax,      "maxss" },
+    { 0xF2, 0x0F, 0x5F, X_, F_M64 | F_D,    7, 0, lower_minmax,      "maxsd" },
+
+    /* 66 0F 6x: unpacks, packs, compares */
+    { 0x66, 0x0F, 0x60, X_, F_Y,            0, NEON_ZIP1(0), lower_rrr, "punpcklbw" },
+    { 0x66, 0x0F, 0x61, X_, F_Y,            0, NEON_ZIP1(1), lower_rrr, "punpcklwd" },
+    { 0x66, 0x0F, 0x62, X_, F_Y,            0, NEON_ZIP1(2), lower_rrr, "punpckldq" },
+    { 0x66, 0x0F, 0x63, X_, F_Y,            0, NEON_SQXTN(0), lower_pack, "packsswb" },
+    { 0x66, 0x0F, 0x64, X_, F_Y,            0, NEON_CMGT(0), lower_rrr, "pcmpgtb" },
+    { 0x66, 0x0F, 0x65, X_, F_Y,            0, NEON_CMGT(1), lower_rrr, "pcmpgtw" },
+    { 0x66, 0x0F, 0x66, X_, F_Y,            0, NEON_CMGT(2), lower_rrr, "pcmpgtd" },
+    { 0x66, 0x0F, 0x67, X_, F_Y,            0, NEON_SQXTUN(0), lower_pack, "packuswb" },
+    { 0x66, 0x0F, 0x68, X_, F_Y,            0, NEON_ZIP2(0), lower_rrr, "punpckhbw" },
+    { 0x66, 0x0F, 0x69, X_, F_Y,            0, NEON_ZIP2(1), lower_rrr, "punpckhwd" },
+    { 0x66, 0x0F, 0x6A, X_, F_Y,            0, NEON_ZIP2(2), lower_rrr, "punpckhdq" },
+    { 0x66, 0x0F, 0x6B, X_, F_Y,            0, NEON_SQXTN(1), lower_pack, "packssdw" },
+    { 0x66, 0x0F, 0x6C, X_, F_Y,            0, NEON_ZIP1(3), lower_rrr, "punpcklqdq" },
+    { 0x66, 0x0F, 0x6D, X_, F_Y,            0, NEON_ZIP2(3), lower_rrr, "punpckhqdq" },
+    { 0x66, 0x0F, 0x6E, X_, F_REG | F_GRM | F_W | F_NV, 0, 0, lower_movd_to_xmm, "movd" },
+    { 0x66, 0x0F, 0x6F, X_, F_NV | F_Y,     0, 0, lower_mov,         "movdqa" },
+    { 0xF3, 0x0F, 0x6F, X_, F_NV | F_Y,     0, 0, lower_mov,         "movdqu" },
+
+    /* 0F 7x: shuffles, shifts by immediate, compares */
+    { 0x66, 0x0F, 0x70, X_, F_IMM | F_NV | F_Y, 0, 0, lower_pshufd, "pshufd" },
+    { 0xF3, 0x0F, 0x70, X_, F_IMM | F_NV | F_Y, 4, 0, lower_pshufw, "pshufhw" },
+    { 0xF2, 0x0F, 0x70, X_, F_IMM | F_NV | F_Y, 0, 0, lower_pshufw, "pshuflw" },
+    { 0x66, 0x0F, 0x71, 2,  F_IMM | F_REG | F_Y, 1 | SIMD_SHIFT_SRL << 2, 0, lower_shift_imm, "psrlw" },
+    { 0x66, 0x0F, 0x71, 4,  F_IMM | F_REG | F_Y, 1 | SIMD_SHIFT_SRA << 2, 0, lower_shift_imm, "psraw" },
+    { 0x66, 0x0F, 0x71, 6,  F_IMM | F_REG | F_Y, 1 | SIMD_SHIFT_SLL << 2, 0, lower_shift_imm, "psllw" },
+    { 0x66, 0x0F, 0x72, 2,  F_IMM | F_REG | F_Y, 2 | SIMD_SHIFT_SRL << 2, 0, lower_shift_imm, "psrld" },
+    { 0x66, 0x0F, 0x72, 4,  F_IMM | F_REG | F_Y, 2 | SIMD_SHIFT_SRA << 2, 0, lower_shift_imm, "psrad" },
+    { 0x66, 0x0F, 0x72, 6,  F_IMM | F_REG | F_Y, 2 | SIMD_SHIFT_SLL << 2, 0, lower_shift_imm, "pslld" },
+    { 0x66, 0x0F, 0x73, 2,  F_IMM | F_REG | F_Y, 3 | SIMD_SHIFT_SRL << 2, 0, lower_shift_imm, "psrlq" },
+    { 0x66, 0x0F, 0x73, 3,  F_IMM | F_REG | F_Y, 0, 0, lower_shift_bytes, "psrldq" },
+    { 0x66, 0x0F, 0x73, 6,  F_IMM | F_REG | F_Y, 3 | SIMD_SHIFT_SLL << 2, 0, lower_shift_imm, "psllq" },
+    { 0x66, 0x0F, 0x73, 7,  F_IMM | F_REG | F_Y, 1, 0, lower_shift_bytes, "pslldq" },
+    { 0x66, 0x0F, 0x74, X_, F_Y,            0, NEON_CMEQ(0), lower_rrr, "pcmpeqb" },
+    { 0x66, 0x0F, 0x75, X_, F_Y,            0, NEON_CMEQ(1), lower_rrr, "pcmpeqw" },
+    { 0x66, 0x0F, 0x76, X_, F_Y,            0, NEON_CMEQ(2), lower_rrr, "pcmpeqd" },
+    { 0x66, 0x0F, 0x7C, X_, F_D | F_Y,      0, NEON_FADDP(1), lower_rrr, "haddpd" },
+    { 0xF2, 0x0F, 0x7C, X_, F_S | F_Y,      0, NEON_FADDP(0), lower_rrr, "haddps" },
+    { 0x66, 0x0F, 0x7D, X_, F_D | F_Y,      3, NEON_FSUB(1), lower_hop, "hsubpd" },
+    { 0xF2, 0x0F, 0x7D, X_, F_S | F_Y,      2, NEON_FSUB(0), lower_hop, "hsubps" },
+    { 0x66, 0x0F, 0x7E, X_, F_REG | F_GRM | F_W | F_ST | F_NV, 0, 0, lower_movd_from_xmm, "movd.st" },
+    { 0xF3, 0x0F, 0x7E, X_, F_M64 | F_NV,   0, 0, lower_movq,        "movq" },
+    { 0x66, 0x0F, 0x7F, X_, F_ST | F_NV | F_Y, 0, 0, lower_mov_store, "movdqa.st" },
+    { 0xF3, 0x0F, 0x7F, X_, F_ST | F_NV | F_Y, 0, 0, lower_mov_store, "movdqu.st" },
+
+    /* 0F Cx */
+    { 0x00, 0x0F, 0xC2, X_, F_IMM | F_Y,    0, 0, lower_cmpfp,       "cmpps" },
+    { 0x66, 0x0F, 0xC2, X_, F_IMM | F_Y,    1, 0, lower_cmpfp,       "cmppd" },
+    { 0xF3, 0x0F, 0xC2, X_, F_IMM | F_M32,  4, 0, lower_cmpfp,       "cmpss" },
+    { 0xF2, 0x0F, 0xC2, X_, F_IMM | F_M64,  5, 0, lower_cmpfp,       "cmpsd" },
+    { 0x66, 0x0F, 0xC4, X_, F_IMM | F_REG | F_GRM, 1, 0, lower_pinsr, "pinsrw" },
+    { 0x66, 0x0F, 0xC5, X_, F_IMM | F_REG | F_GREG | F_NV, 1, 0, lower_pextr, "pextrw" },
+    { 0x00, 0x0F, 0xC6, X_, F_IMM | F_Y,    0, 0, lower_shufps,      "shufps" },
+    { 0x66, 0x0F, 0xC6, X_, F_IMM | F_YI,   3, 0, lower_shufpd,      "shufpd" },
+
+    /* 66 0F Dx */
+    { 0x66, 0x0F, 0xD0, X_, F_D | F_Y,      1, 0, lower_addsub,      "addsubpd" },
+    { 0xF2, 0x0F, 0xD0, X_, F_S | F_Y,      0, 0, lower_addsub,      "addsubps" },
+    { 0x66, 0x0F, 0xD1, X_, F_YC,           1 | SIMD_SHIFT_SRL << 2, 0, lower_shift_reg, "psrlw.x" },
+    { 0x66, 0x0F, 0xD2, X_, F_YC,           2 | SIMD_SHIFT_SRL << 2, 0, lower_shift_reg, "psrld.x" },
+    { 0x66, 0x0F, 0xD3, X_, F_YC,           3 | SIMD_SHIFT_SRL << 2, 0, lower_shift_reg, "psrlq.x" },
+    { 0x66, 0x0F, 0xD4, X_, F_Y,            0, NEON_ADD(3), lower_rrr, "paddq" },
+    { 0x66, 0x0F, 0xD5, X_, F_Y,            0, NEON_MUL(1), lower_rrr, "pmullw" },
+    { 0x66, 0x0F, 0xD6, X_, F_ST | F_NV | F_M64, 0, 0, lower_movq_store, "movq.st" },
+    { 0x66, 0x0F, 0xD7, X_, F_REG | F_GREG | F_NV, 0, 0, lower_movmsk, "pmovmskb" },
+    { 0x66, 0x0F, 0xD8, X_, F_Y,            0, NEON_UQSUB(0), lower_rrr, "psubusb" },
+    { 0x66, 0x0F, 0xD9, X_, F_Y,            0, NEON_UQSUB(1), lower_rrr, "psubusw" },
+    { 0x66, 0x0F, 0xDA, X_, F_Y,            0, NEON_UMIN(0), lower_rrr, "pminub" },
+    { 0x66, 0x0F, 0xDB, X_, F_Y,            0, NEON_AND, lower_rrr,  "pand" },
+    { 0x66, 0x0F, 0xDC, X_, F_Y,            0, NEON_UQADD(0), lower_rrr, "paddusb" },
+    { 0x66, 0x0F, 0xDD, X_, F_Y,            0, NEON_UQADD(1), lower_rrr, "paddusw" },
+    { 0x66, 0x0F, 0xDE, X_, F_Y,            0, NEON_UMAX(0), lower_rrr, "pmaxub" },
+    { 0x66, 0x0F, 0xDF, X_, F_Y,            0, NEON_BIC, lower_rrr_rev, "pandn" },
+
+    /* 66 0F Ex */
+    { 0x66, 0x0F, 0xE0, X_, F_Y,            0, NEON_URHADD(0), lower_rrr, "pavgb" },
+    { 0x66, 0x0F, 0xE1, X_, F_YC,           1 | SIMD_SHIFT_SRA << 2, 0, lower_shift_reg, "psraw.x" },
+    { 0x66, 0x0F, 0xE2, X_, F_YC,           2 | SIMD_SHIFT_SRA << 2, 0, lower_shift_reg, "psrad.x" },
+    { 0x66, 0x0F, 0xE3, X_, F_Y,            0, NEON_URHADD(1), lower_rrr, "pavgw" },
+    { 0x66, 0x0F, 0xE4, X_, F_Y,            0, NEON_UMULL(1), lower_mulhi, "pmulhuw" },
+    { 0x66, 0x0F, 0xE5, X_, F_Y,            0, NEON_SMULL(1), lower_mulhi, "pmulhw" },
+    { 0x66, 0x0F, 0xE6, X_, F_NV,           1, 0, lower_cvt_to_int,  "cvttpd2dq" },
+    { 0xF3, 0x0F, 0xE6, X_, F_M64 | F_D | F_NV | F_YW, 0, 0, lower_cvtdq2pd, "cvtdq2pd" },
+    { 0xF2, 0x0F, 0xE6, X_, F_NV,           1, 1, lower_cvt_to_int,  "cvtpd2dq" },
+    { 0x66, 0x0F, 0xE8, X_, F_Y,            0, NEON_SQSUB(0), lower_rrr, "psubsb" },
+    { 0x66, 0x0F, 0xE9, X_, F_Y,            0, NEON_SQSUB(1), lower_rrr, "psubsw" },
+    { 0x66, 0x0F, 0xEA, X_, F_Y,            0, NEON_SMIN(1), lower_rrr, "pminsw" },
+    { 0x66, 0x0F, 0xEB, X_, F_Y,            0, NEON_ORR, lower_rrr,  "por" },
+    { 0x66, 0x0F, 0xEC, X_, F_Y,            0, NEON_SQADD(0), lower_rrr, "paddsb" },
+    { 0x66, 0x0F, 0xED, X_, F_Y,            0, NEON_SQADD(1), lower_rrr, "paddsw" },
+    { 0x66, 0x0F, 0xEE, X_, F_Y,            0, NEON_SMAX(1), lower_rrr, "pmaxsw" },
+    { 0x66, 0x0F, 0xEF, X_, F_Y,            0, NEON_EOR, lower_rrr,  "pxor" },
+
+    /* 66 0F Fx */
+    { 0x66, 0x0F, 0xF1, X_, F_YC,           1 | SIMD_SHIFT_SLL << 2, 0, lower_shift_reg, "psllw.x" },
+    { 0x66, 0x0F, 0xF2, X_, F_YC,           2 | SIMD_SHIFT_SLL << 2, 0, lower_shift_reg, "pslld.x" },
+    { 0x66, 0x0F, 0xF3, X_, F_YC,           3 | SIMD_SHIFT_SLL << 2, 0, lower_shift_reg, "psllq.x" },
+    { 0x66, 0x0F, 0xF4, X_, F_Y,            0, NEON_UMULL(2), lower_muldq, "pmuludq" },
+    { 0x66, 0x0F, 0xF5, X_, F_Y,            0, 0, lower_pmaddwd,     "pmaddwd" },
+    { 0x66, 0x0F, 0xF6, X_, F_Y,            0, 0, lower_psadbw,      "psadbw" },
+    { 0x66, 0x0F, 0xF8, X_, F_Y,            0, NEON_SUB(0), lower_rrr, "psubb" },
+    { 0x66, 0x0F, 0xF9, X_, F_Y,            0, NEON_SUB(1), lower_rrr, "psubw" },
+    { 0x66, 0x0F, 0xFA, X_, F_Y,            0, NEON_SUB(2), lower_rrr, "psubd" },
+    { 0x66, 0x0F, 0xFB, X_, F_Y,            0, NEON_SUB(3), lower_rrr, "psubq" },
+    { 0x66, 0x0F, 0xFC, X_, F_Y,            0, NEON_ADD(0), lower_rrr, "paddb" },
+    { 0x66, 0x0F, 0xFD, X_, F_Y,            0, NEON_ADD(1), lower_rrr, "paddw" },
+    { 0x66, 0x0F, 0xFE, X_, F_Y,            0, NEON_ADD(2), lower_rrr, "paddd" },
+
+    /* 66 0F 38 xx: SSSE3 and SSE4.1 */
+    { 0x66, 0x38, 0x00, X_, F_Y,            0, 0, lower_pshufb,      "pshufb" },
+    { 0x66, 0x38, 0x01, X_, F_Y,            0, NEON_ADDP(1), lower_rrr, "phaddw" },
+    { 0x66, 0x38, 0x02, X_, F_Y,            0, NEON_ADDP(2), lower_rrr, "phaddd" },
+    { 0x66, 0x38, 0x03, X_, F_Y,            1, NEON_SQADD(1), lower_hop, "phaddsw" },
+    { 0x66, 0x38, 0x04, X_, F_Y,            0, 0, lower_pmaddubsw,   "pmaddubsw" },
+    { 0x66, 0x38, 0x05, X_, F_Y,            1, NEON_SUB(1), lower_hop, "phsubw" },
+    { 0x66, 0x38, 0x06, X_, F_Y,            2, NEON_SUB(2), lower_hop, "phsubd" },
+    { 0x66, 0x38, 0x07, X_, F_Y,            1, NEON_SQSUB(1), lower_hop, "phsubsw" },
+    { 0x66, 0x38, 0x08, X_, F_Y,            0, 0, lower_psign,       "psignb" },
+    { 0x66, 0x38, 0x09, X_, F_Y,            1, 0, lower_psign,       "psignw" },
+    { 0x66, 0x38, 0x0A, X_, F_Y,            2, 0, lower_psign,       "psignd" },
+    { 0x66, 0x38, 0x0B, X_, F_Y,            0, 0, lower_pmulhrsw,    "pmulhrsw" },
+    { 0x66, 0x38, 0x10, X_, SIMD_F_XMM0,    0, 0, lower_blendv,      "pblendvb" },
+    { 0x66, 0x38, 0x14, X_, SIMD_F_XMM0,    2, 0, lower_blendv,      "blendvps" },
+    { 0x66, 0x38, 0x15, X_, SIMD_F_XMM0,    3, 0, lower_blendv,      "blendvpd" },
+    { 0x66, 0x38, 0x17, X_, SIMD_F_FLAGS | F_NV, 0, 0, lower_ptest, "ptest" },
+    { 0x66, 0x38, 0x1C, X_, F_NV | F_Y,     0, NEON_ABS(0), lower_rr, "pabsb" },
+    { 0x66, 0x38, 0x1D, X_, F_NV | F_Y,     0, NEON_ABS(1), lower_rr, "pabsw" },
+    { 0x66, 0x38, 0x1E, X_, F_NV | F_Y,     0, NEON_ABS(2), lower_rr, "pabsd" },
+    { 0x66, 0x38, 0x20, X_, F_M64 | F_NV | F_YW, 0 | 1 << 2, 0, lower_pmovx, "pmovsxbw" },
+    { 0x66, 0x38, 0x21, X_, F_M32 | F_NV | F_YW, 0 | 2 << 2, 0, lower_pmovx, "pmovsxbd" },
+    { 0x66, 0x38, 0x22, X_, F_M16 | F_NV | F_YW, 0 | 3 << 2, 0, lower_pmovx, "pmovsxbq" },
+    { 0x66, 0x38, 0x23, X_, F_M64 | F_NV | F_YW, 1 | 1 << 2, 0, lower_pmovx, "pmovsxwd" },
+    { 0x66, 0x38, 0x24, X_, F_M32 | F_NV | F_YW, 1 | 2 << 2, 0, lower_pmovx, "pmovsxwq" },
+    { 0x66, 0x38, 0x25, X_, F_M64 | F_NV | F_YW, 2 | 1 << 2, 0, lower_pmovx, "pmovsxdq" },
+    { 0x66, 0x38, 0x28, X_, F_Y,            0, NEON_SMULL(2), lower_muldq, "pmuldq" },
+    { 0x66, 0x38, 0x29, X_, F_Y,            0, NEON_CMEQ(3), lower_rrr, "pcmpeqq" },
+    { 0x66, 0x38, 0x2B, X_, F_Y,            0, NEON_SQXTUN(1), lower_pack, "packusdw" },
+    { 0x66, 0x38, 0x30, X_, F_M64 | F_NV | F_YW, 0 | 1 << 2, 1, lower_pmovx, "pmovzxbw" },
+    { 0x66, 0x38, 0x31, X_, F_M32 | F_NV | F_YW, 0 | 2 << 2, 1, lower_pmovx, "pmovzxbd" },
+    { 0x66, 0x38, 0x32, X_, F_M16 | F_NV | F_YW, 0 | 3 << 2, 1, lower_pmovx, "pmovzxbq" },
+    { 0x66, 0x38, 0x33, X_, F_M64 | F_NV | F_YW, 1 | 1 << 2, 1, lower_pmovx, "pmovzxwd" },
+    { 0x66, 0x38, 0x34, X_, F_M32 | F_NV | F_YW, 1 | 2 << 2, 1, lower_pmovx, "pmovzxwq" },
+    { 0x66, 0x38, 0x35, X_, F_M64 | F_NV | F_YW, 2 | 1 << 2, 1, lower_pmovx, "pmovzxdq" },
+    { 0x66, 0x38, 0x37, X_, F_Y,            0, NEON_CMGT(3), lower_rrr, "pcmpgtq" },
+    { 0x66, 0x38, 0x38, X_, F_Y,            0, NEON_SMIN(0), lower_rrr, "pminsb" },
+    { 0x66, 0x38, 0x39, X_, F_Y,            0, NEON_SMIN(2), lower_rrr, "pminsd" },
+    { 0x66, 0x38, 0x3A, X_, F_Y,            0, NEON_UMIN(1), lower_rrr, "pminuw" },
+    { 0x66, 0x38, 0x3B, X_, F_Y,            0, NEON_UMIN(2), lower_rrr, "pminud" },
+    { 0x66, 0x38, 0x3C, X_, F_Y,            0, NEON_SMAX(0), lower_rrr, "pmaxsb" },
+    { 0x66, 0x38, 0x3D, X_, F_Y,            0, NEON_SMAX(2), lower_rrr, "pmaxsd" },
+    { 0x66, 0x38, 0x3E, X_, F_Y,            0, NEON_UMAX(1), lower_rrr, "pmaxuw" },
+    { 0x66, 0x38, 0x3F, X_, F_Y,            0, NEON_UMAX(2), lower_rrr, "pmaxud" },
+    { 0x66, 0x38, 0x40, X_, F_Y,            0, NEON_MUL(2), lower_rrr, "pmulld" },
+
+    /* 66 0F 3A xx: SSSE3 and SSE4.1 with imm8 */
+    { 0x66, 0x3A, 0x08, X_, F_IMM | F_S | F_NV | F_Y, 0, 0, lower_round, "roundps" },
+    { 0x66, 0x3A, 0x09, X_, F_IMM | F_D | F_NV | F_Y, 1, 0, lower_round, "roundpd" },
+    { 0x66, 0x3A, 0x0A, X_, F_IMM | F_M32 | F_S, 4, 0, lower_round, "roundss" },
+    { 0x66, 0x3A, 0x0B, X_, F_IMM | F_M64 | F_D, 5, 0, lower_round, "roundsd" },
+    { 0x66, 0x3A, 0x0C, X_, F_IMM | F_YI,   2, 0, lower_blend_imm,   "blendps" },
+    { 0x66, 0x3A, 0x0D, X_, F_IMM | F_YI,   3, 0, lower_blend_imm,   "blendpd" },
+    { 0x66, 0x3A, 0x0E, X_, F_IMM | F_Y,    1, 0, lower_blend_imm,   "pblendw" },
+    { 0x66, 0x3A, 0x0F, X_, F_IMM | F_Y,    0, 0, lower_palignr,     "palignr" },
+    { 0x66, 0x3A, 0x14, X_, F_IMM | F_REG | F_GRM | F_ST | F_NV, 0, 0, lower_pextr, "pextrb" },
+    { 0x66, 0x3A, 0x15, X_, F_IMM | F_REG | F_GRM | F_ST | F_NV, 1, 0, lower_pextr, "pextrw.3a" },
+    { 0x66, 0x3A, 0x16, X_, F_IMM | F_REG | F_GRM | F_W | F_ST | F_NV, 2, 0, lower_pextr, "pextrd" },
+    { 0x66, 0x3A, 0x20, X_, F_IMM | F_REG | F_GRM, 0, 0, lower_pinsr, "pinsrb" },
+    { 0x66, 0x3A, 0x21, X_, F_IMM | F_M32,  0, 0, lower_insertps,    "insertps" },
+    { 0x66, 0x3A, 0x22, X_, F_IMM | F_REG | F_GRM | F_W, 2, 0, lower_pinsr, "pinsrd" },
+    { 0x66, 0x3A, 0x40, X_, F_IMM | F_S | F_Y, 0, 0, lower_dp, "dpps" },
+    { 0x66, 0x3A, 0x41, X_, F_IMM | F_D,    1, 0, lower_dp,          "dppd" },
+};
+
+#undef X_
+#undef F_IMM
+#undef F_M16
+#undef F_M32
+#undef F_M64
+#undef F_REG
+#undef F_MEM
+#undef F_GREG
+#undef F_GRM
+#undef F_S
+#undef F_D
+#undef F_W
+#undef F_ST
+#undef F_NV
+#undef F_Y
+#undef F_YI
+#undef F_YC
+#undef F_YW
+
+/* First table index + 1 for each (map, opcode); 0 when absent */
+static uint16_t g_simd_index[3][256];
+static pthread_once_t g_simd_once = PTHREAD_ONCE_INIT;
+
+static int simd_map_slot(uint8_t map)
+{
+    return map == 0x38 ? 1 : map == 0x3A ? 2 : 0;
+}
+
+static void simd_index_once(void)
+{
+    size_t i;
+
+    for (i = sizeof(g_simd_table) / sizeof(g_simd_table[0]); i-- > 0;) {
+        const translate_simd_entry_t *e = &g_simd_table[i];
+        g_simd_index[simd_map_slot(e->map)][e->opcode] = (uint16_t)(i + 1);
+    }
+}
+
+const translate_simd_entry_t *translate_simd_table(size_t *count)
+{
+    *count = sizeof(g_simd_table) / sizeof(g_simd_table[0]);
+    return g_simd_table;
+}
+
+const translate_simd_entry_t *translate_simd_find(uint8_t prefix, uint8_t map, uint8_t opcode,
+                                                  uint8_t ext)
+{
+    size_t n = sizeof(g_simd_table) / sizeof(g_simd_table[0]);
+    size_t i;
+
+    pthread_once(&g_simd_once, simd_index_once);
+    i = g_simd_index[simd_map_slot(map)][opcode];
+    if (i == 0) {
+        return NULL;
+    }
+    for (i--; i < n && g_simd_table[i].map == map && g_simd_table[i].opcode == opcode; i++) {
+        const translate_simd_entry_t *e = &g_simd_table[i];
+
+        if (e->prefix == prefix && (e->ext == SIMD_EXT_NONE || e->ext == ext)) {
+            return e;
+        }
+    }
+    return NULL;
+}
+
+const translate_simd_entry_t *translate_simd_lookup(const x86_insn_t *insn)
+{
+    if (insn->opcode != 0 || insn->opcode2 == 0 || insn->vex_prefix || !insn->has_modrm) {
+        return NULL;
+    }
+    if (insn->opcode2 == 0x38 || insn->opcode2 == 0x3A) {
+        return translate_simd_find(insn->simd_prefix, insn->opcode2, insn->opcode3,
+                                   (insn->modrm >> 3) & 7);
+    }
+    return translate_simd_find(insn->simd_prefix, 0x0F, insn->opcode2, (insn->modrm >> 3) & 7);
+}
+
+int translate_simd_lower_op(code_buffer_t *b, const translate_simd_entry_t *e, const x86_insn_t *insn,
+                            uint8_t vd, uint8_t vn, uint8_t vm, int64_t adjust, uint64_t guest_pc)
+{
+    uint8_t dst, src;
+
+    if (insn->mod != 3) {
+        int lg = translate_simd_mem_lg(e);
+
+        if (e->flags & SIMD_F_STORE) {
+            return translate_simd_mem(b, insn, vm, lg, adjust, guest_pc, 1, vd);
+        }
+        if (e->lower == lower_mov || e->lower == lower_movs || e->lower == lower_movq) {
+            return translate_simd_mem(b, insn, vm, lg, adjust, guest_pc, 0, vd);  /* LDR zero-extends */
+        }
+        if (translate_simd_mem(b, insn, vm, lg, adjust, guest_pc, 0, SIMD_TMEM) < 0) {
+            return -ENOTSUP;
+        }
+        vm = SIMD_TMEM;
+    }
+
+    if (e->lower == lower_rrr) {
+        neon_rrr(b, e->neon, vd, vn, vm);
+        return 0;
+    }
+    if (e->lower == lower_rrr_rev) {
+        neon_rrr(b, e->neon, vd, vm, vn);
+        return 0;
+    }
+    if (e->ext != SIMD_EXT_NONE || (e->flags & SIMD_F_NO_VVVV)) {
+        return e->lower(b, e, insn, vd, vm);
+    }
+
+    /* Two-operand lowering of a three-operand form: copy vn into the destination first */
+    dst = (e->flags & SIMD_F_STORE) ? vm : vd;
+    src = (e->flags & SIMD_F_STORE) ? vd : vm;
+    if (dst != vn) {
+        if (src == dst && !(e->flags & SIMD_F_GPR_RM)) {
+            neon_mov(b, SIMD_TMEM, src);
+            src = SIMD_TMEM;
+        }
+        neon_mov(b, dst, vn);
+    }
+    return (e->flags & SIMD_F_STORE) ? e->lower(b, e, insn, src, dst) : e->lower(b, e, insn, dst, src);
+}
+
+int translate_simd_lower(code_buffer_t *code_buf, const x86_insn_t *insn,
+                         uint8_t arm_rd, uint8_t arm_rm, uint64_t guest_pc)
+{
+    const translate_simd_entry_t *e = translate_simd_lookup(insn);
+    int ret;
+
+    if (!e) {
+        return -ENOENT;
+    }
+    ret = translate_simd_supported(e, insn);
+    if (ret < 0) {
+        return ret;
+    }
+    if (e->ext != SIMD_EXT_NONE) {
+        return translate_simd_lower_op(code_buf, e, insn, arm_rm, arm_rm, arm_rm, 0, guest_pc);
+    }
+    return translate_simd_lower_op(code_buf, e, insn, arm_rd,
+                                   (e->flags & SIMD_F_STORE) ? arm_rm : arm_rd, arm_rm, 0, guest_pc);
+}
+
 /* End of rosetta_translate_simd.c */
@@ -126,4 +126,87 @@ void translate_simd_pandn(code_buffer_t *code_buf, const x86_insn_t *insn, uint8
 void translate_simd_por(code_buffer_t *code_buf, const x86_insn_t *insn, uint8_t arm_rd, uint8_t arm_rm);
 void translate_simd_pxor(code_buffer_t *code_buf, const x86_insn_t *insn, uint8_t arm_rd, uint8_t arm_rm);
 
+/* ============================================================================
+ * Table-Driven SSE to NEON Lowering
+ * ============================================================================
+ *
+ * Every legacy-encoded (non-VEX) SSE, SSE2, SSE3, SSSE3 and SSE4.1 form
+ * the table knows lowers to a short fixed NEON sequence with XMMn held in
+ * Vn and GPR n in Xn. Lowerings may clobber V28-V31 and X16/X17. The VEX
+ * forms of the same entries are lowered by rosetta_translate_avx.c.
+ *
+ * Memory operands support every ModR/M form: [base + disp], [rip + disp]
+ * and SIB [base + index * scale + disp], the address built in X16.
+ * ============================================================================ */
+
+typedef struct translate_simd_entry translate_simd_entry_t;
+
+typedef int (*translate_simd_lower_fn)(code_buffer_t *code_buf, const translate_simd_entry_t *e,
+                                       const x86_insn_t *insn, uint8_t vd, uint8_t vm);
+
+#define SIMD_F_IMM8         0x0001  /* Trailing imm8 */
+#define SIMD_F_M16          0x0002  /* Memory operand is 16 bits */
+#define SIMD_F_M32          0x0004  /* Memory operand is 32 bits */
+#define SIMD_F_M64          0x0008  /* Memory operand is 64 bits */
+#define SIMD_F_REG_ONLY     0x0010  /* Memory form not lowered */
+#define SIMD_F_GPR_REG      0x0020  /* ModR/M.reg names a GPR */
+#define SIMD_F_GPR_RM       0x0040  /* ModR/M.rm names a GPR */
+#define SIMD_F_XMM0         0x0080  /* Reads XMM0 implicitly */
+#define SIMD_F_FLAGS        0x0100  /* Writes NZCV */
+#define SIMD_F_FP32         0x0200  /* Result lanes are single precision */
+#define SIMD_F_FP64         0x0400  /* Result lanes are double precision */
+#define SIMD_F_REXW         0x0800  /* REX.W selects a 64-bit GPR form */
+#define SIMD_F_MEM_ONLY     0x1000  /* Register form is undefined */
+#define SIMD_F_STORE        0x2000  /* Writes ModR/M.rm, from ModR/M.reg */
+#define SIMD_F_NO_VVVV      0x4000  /* VEX form has no VEX.vvvv source */
+#define SIMD_F_YMM          0x8000  /* VEX.256 form runs on each 128-bit half */
+#define SIMD_F_YMM_IMMHI    0x10000 /* ... the upper half from imm8 >> (16 >> arg) */
+#define SIMD_F_YMM_COUNT    0x20000 /* ... both halves with the same 128-bit count */
+#define SIMD_F_YMM_WIDEN    0x40000 /* VEX.256 widens twice the source lanes */
+
+#define SIMD_EXT_NONE       0xFF    /* No ModR/M.reg opcode extension */
+
+struct translate_simd_entry {
+    uint8_t prefix;                 /* 0, 0x66, 0xF2 or 0xF3 */
+    uint8_t map;                    /* 0x0F, 0x38 or 0x3A */
+    uint8_t opcode;                 /* Opcode byte within the map */
+    uint8_t ext;                    /* ModR/M.reg for group opcodes */
+    uint32_t flags;                 /* SIMD_F_* */
+    uint8_t arg;                    /* Lowering-specific (lane size, mode) */
+    uint32_t neon;                  /* Base NEON encoding, when one applies */
+    translate_simd_lower_fn lower;
+    const char *name;
+};
+
+/**
+ * translate_simd_find - Find the entry for an opcode
+ * @param map 0x0F, 0x38 or 0x3A
+ * @param ext ModR/M.reg, matched against group opcodes
+ * @return Entry, or NULL
+ */
+const translate_simd_entry_t *translate_simd_find(uint8_t prefix, uint8_t map, uint8_t opcode,
+                                                  uint8_t ext);
+
+/**
+ * translate_simd_lookup - Find the table entry for an instruction
+ * @return Entry, or NULL for VEX and unknown forms
+ */
+const translate_simd_entry_t *translate_simd_lookup(const x86_insn_t *insn);
+
+/**
+ * translate_simd_table - The whole table, for tests and statistics
+ */
+const translate_simd_entry_t *translate_simd_table(size_t *count);
+
+/**
+ * translate_simd_lower - Emit the NEON lowering of an SSE instruction
+ * @param arm_rd Register from ModR/M.reg
+ * @param arm_rm Register from ModR/M.rm (the base of non-SIB memory forms)
+ * @param guest_pc Address of the instruction, for RIP-relative operands
+ * @return 0 on success, -ENOENT if not in the table, -ENOTSUP for an
+ *         operand form the table does not lower
+ */
+int translate_simd_lower(code_buffer_t *code_buf, const x86_insn_t *insn,
+                         uint8_t arm_rd, uint8_t arm_rm, uint64_t guest_pc);
+
 #endif /* ROSETTA_TRANSLATE_SIMD_H */
@@ -0,0 +1,254 @@
+/* ============================================================================
+ * Rosetta SIMD Lowering - Shared NEON Encoders
+ * ============================================================================
+ *
+ * Internal to the SSE and AVX lowerings (rosetta_translate_simd.c and
+ * rosetta_translate_avx.c): scratch register assignments, NEON encoding
+ * words and the small emit helpers both build their sequences from, and
+ * the entry points the AVX lowering uses to run an SSE table entry on
+ * explicit operands.
+ * ============================================================================ */
+
+#ifndef ROSETTA_TRANSLATE_SIMD_IMPL_H
+#define ROSETTA_TRANSLATE_SIMD_IMPL_H
+
+#include "rosetta_translate_simd.h"
+#include "rosetta_arm64_emit.h"
+
+/* ============================================================================
+ * NEON Encoders
+ * ============================================================================
+ *
+ * Base words are the Q=1 (128-bit) forms with Rd/Rn/Rm clear.
+ * ============================================================================ */
+
+#define SIMD_T0         31      /* Scratch vectors */
+#define SIMD_T1         30
+#define SIMD_T2         29
+#define SIMD_TMEM       28      /* Memory source operand */
+#define SIMD_XT0        16      /* Scratch GPR (IP0) */
+#define SIMD_XMM0       0       /* Implicit BLENDV mask */
+#define SIMD_ZR         31      /* WZR/XZR as a GPR operand */
+
+#define NEON_Q          0x40000000u
+#define NEON_3S(u, size, opc)   (0x4E200400u | ((u) << 29) | ((size) << 22) | ((opc) << 11))
+#define NEON_3D(u, size, opc)   (0x0E200000u | ((u) << 29) | ((size) << 22) | ((opc) << 12))
+#define NEON_2M(u, size, opc)   (0x4E200800u | ((u) << 29) | ((size) << 22) | ((opc) << 12))
+#define NEON_PERM(size, opc)    (0x4E000800u | ((size) << 22) | ((opc) << 12))
+
+/* Three same, integer */
+#define NEON_ADD(s)     NEON_3S(0, s, 0x10)
+#define NEON_SUB(s)     NEON_3S(1, s, 0x10)
+#define NEON_SQADD(s)   NEON_3S(0, s, 0x01)
+#define NEON_UQADD(s)   NEON_3S(1, s, 0x01)
+#define NEON_SQSUB(s)   NEON_3S(0, s, 0x05)
+#define NEON_UQSUB(s)   NEON_3S(1, s, 0x05)
+#define NEON_URHADD(s)  NEON_3S(1, s, 0x02)
+#define NEON_CMGT(s)    NEON_3S(0, s, 0x06)
+#define NEON_CMEQ(s)    NEON_3S(1, s, 0x11)
+#define NEON_SSHL(s)    NEON_3S(0, s, 0x08)
+#define NEON_USHL(s)    NEON_3S(1, s, 0x08)
+#define NEON_SMAX(s)    NEON_3S(0, s, 0x0C)
+#define NEON_SMIN(s)    NEON_3S(0, s, 0x0D)
+#define NEON_UMAX(s)    NEON_3S(1, s, 0x0C)
+#define NEON_UMIN(s)    NEON_3S(1, s, 0x0D)
+#define NEON_UABD(s)    NEON_3S(1, s, 0x0E)
+#define NEON_MUL(s)     NEON_3S(0, s, 0x13)
+#define NEON_ADDP(s)    NEON_3S(0, s, 0x17)
+#define NEON_UMAXP(s)   NEON_3S(1, s, 0x14)
+#define NEON_AND        NEON_3S(0, 0, 0x03)
+#define NEON_BIC        NEON_3S(0, 1, 0x03)
+#define NEON_ORR        NEON_3S(0, 2, 0x03)
+#define NEON_EOR        NEON_3S(1, 0, 0x03)
+#define NEON_BSL        NEON_3S(1, 1, 0x03)
+#define NEON_BIT        NEON_3S(1, 2, 0x03)
+#define NEON_BIF        NEON_3S(1, 3, 0x03)
+
+/* Three same, floating point; sz is 0 for S lanes, 1 for D lanes */
+#define NEON_FADD(sz)   NEON_3S(0, (sz), 0x1A)
+#define NEON_FSUB(sz)   NEON_3S(0, 2 | (sz), 0x1A)
+#define NEON_FMUL(sz)   NEON_3S(1, (sz), 0x1B)
+#define NEON_FDIV(sz)   NEON_3S(1, (sz), 0x1F)
+#define NEON_FADDP(sz)  NEON_3S(1, (sz), 0x1A)
+#define NEON_FCMEQ(sz)  NEON_3S(0, (sz), 0x1C)
+#define NEON_FCMGE(sz)  NEON_3S(1, (sz), 0x1C)
+#define NEON_FCMGT(sz)  NEON_3S(1, 2 | (sz), 0x1C)
+
+/* Three different (long); Q=1 selects the "2" upper-half form */
+#define NEON_SMULL(s)   NEON_3D(0, s, 0x0C)
+#define NEON_UMULL(s)   NEON_3D(1, s, 0x0C)
+
+/* Two-register miscellaneous */
+#define NEON_REV64(s)   NEON_2M(0, s, 0x00)
+#define NEON_UADDLP(s)  NEON_2M(1, s, 0x02)
+#define NEON_CMEQ0(s)   NEON_2M(0, s, 0x09)
+#define NEON_CMLT0(s)   NEON_2M(0, s, 0x0A)
+#define NEON_ABS(s)     NEON_2M(0, s, 0x0B)
+#define NEON_NEG(s)     NEON_2M(1, s, 0x0B)
+#define NEON_NOT        NEON_2M(1, 0, 0x05)
+#define NEON_XTN(s)     (NEON_2M(0, s, 0x12) & ~NEON_Q)
+#define NEON_SQXTN(s)   (NEON_2M(0, s, 0x14) & ~NEON_Q)
+#define NEON_SQXTUN(s)  (NEON_2M(1, s, 0x12) & ~NEON_Q)
+#define NEON_UQXTN(s)   (NEON_2M(1, s, 0x14) & ~NEON_Q)
+#define NEON_FCVTN(sz)  (NEON_2M(0, (sz), 0x16) & ~NEON_Q)
+#define NEON_FCVTL(sz)  (NEON_2M(0, (sz), 0x17) & ~NEON_Q)
+#define NEON_FRINTN(sz) NEON_2M(0, (sz), 0x18)
+#define NEON_FRINTM(sz) NEON_2M(0, (sz), 0x19)
+#define NEON_FRINTP(sz) NEON_2M(0, 2 | (sz), 0x18)
+#define NEON_FRINTZ(sz) NEON_2M(0, 2 | (sz), 0x19)
+#define NEON_FRINTI(sz) NEON_2M(1, 2 | (sz), 0x19)
+#define NEON_FCVTZS(sz) NEON_2M(0, 2 | (sz), 0x1B)
+#define NEON_SCVTF(sz)  NEON_2M(0, (sz), 0x1D)
+#define NEON_FSQRT(sz)  NEON_2M(1, 2 | (sz), 0x1F)
+
+/* Permutes */
+#define NEON_UZP1(s)    NEON_PERM(s, 1)
+#define NEON_TRN1(s)    NEON_PERM(s, 2)
+#define NEON_ZIP1(s)    NEON_PERM(s, 3)
+#define NEON_UZP2(s)    NEON_PERM(s, 5)
+#define NEON_TRN2(s)    NEON_PERM(s, 6)
+#define NEON_ZIP2(s)    NEON_PERM(s, 7)
+
+/* Scalar floating point; type is 0 for S, 1 for D */
+#define FP_2SRC(t, opc) (0x1E200800u | ((t) << 22) | ((opc) << 12))
+#define FP_1SRC(t, opc) (0x1E204000u | ((t) << 22) | ((opc) << 15))
+#define FP_FMUL(t)      FP_2SRC(t, 0)
+#define FP_FDIV(t)      FP_2SRC(t, 1)
+#define FP_FADD(t)      FP_2SRC(t, 2)
+#define FP_FSUB(t)      FP_2SRC(t, 3)
+#define FP_FSQRT(t)     FP_1SRC(t, 3)
+#define FP_FCVT_TO_S    FP_1SRC(1, 4)
+#define FP_FCVT_TO_D    FP_1SRC(0, 5)
+
+/* Shift kinds in the arg of shift entries: arg = size | kind << 2 */
+#define SIMD_SHIFT_SRL  0
+#define SIMD_SHIFT_SRA  1
+#define SIMD_SHIFT_SLL  2
+
+/* Shift by immediate opcodes */
+#define SHIFT_SSHR      0x00
+#define SHIFT_USRA      0x02
+#define SHIFT_SHL       0x0A
+#define SHIFT_SHRN      0x10
+#define SHIFT_RSHRN     0x11
+#define SHIFT_SSHLL     0x14
+
+static inline void neon_rrr(code_buffer_t *b, uint32_t op, uint8_t d, uint8_t n, uint8_t m)
+{
+    emit_arm64_insn(b, op | ((uint32_t)(m & 31) << 16) | ((uint32_t)(n & 31) << 5) | (d & 31));
+}
+
+static inline void neon_rr(code_buffer_t *b, uint32_t op, uint8_t d, uint8_t n)
+{
+    emit_arm64_insn(b, op | ((uint32_t)(n & 31) << 5) | (d & 31));
+}
+
+static inline void neon_mov(code_buffer_t *b, uint8_t d, uint8_t n)
+{
+    if (d != n) {
+        neon_rrr(b, NEON_ORR, d, n, n);
+    }
+}
+
+static inline void neon_zero(code_buffer_t *b, uint8_t d)
+{
+    emit_arm64_insn(b, 0x6F00E400u | d);                /* MOVI Vd.2D, #0 */
+}
+
+static inline void neon_ones(code_buffer_t *b, uint8_t d)
+{
+    emit_arm64_insn(b, 0x6F07E7E0u | d);                /* MOVI Vd.2D, #-1 */
+}
+
+/* MOVI Vd.16B (or .8B), #imm8 */
+static inline void neon_movi8(code_buffer_t *b, uint8_t d, uint8_t imm, int q)
+{
+    emit_arm64_insn(b, 0x0F00E400u | (q ? NEON_Q : 0) | ((uint32_t)(imm >> 5) << 16) |
+                       ((uint32_t)(imm & 31) << 5) | d);
+}
+
+/* imm5 field selecting element idx of a 1 << size byte lane */
+static inline uint32_t neon_imm5(int size, int idx)
+{
+    return (((uint32_t)idx << (size + 1)) | (1u << size)) & 31;
+}
+
+/* INS Vd.T[di], Vn.T[ni] */
+static inline void neon_ins(code_buffer_t *b, int size, uint8_t d, int di, uint8_t n, int ni)
+{
+    emit_arm64_insn(b, 0x6E000400u | (neon_imm5(size, di) << 16) |
+                       ((uint32_t)(ni << size) << 11) | ((uint32_t)n << 5) | d);
+}
+
+/* INS Vd.T[di], Wn/Xn */
+static inline void neon_ins_gpr(code_buffer_t *b, int size, uint8_t d, int di, uint8_t rn)
+{
+    emit_arm64_insn(b, 0x4E001C00u | (neon_imm5(size, di) << 16) | ((uint32_t)rn << 5) | d);
+}
+
+/* DUP Vd.T, Vn.T[ni] */
+static inline void neon_dup(code_buffer_t *b, int size, uint8_t d, uint8_t n, int ni)
+{
+    emit_arm64_insn(b, 0x4E000400u | (neon_imm5(size, ni) << 16) | ((uint32_t)n << 5) | d);
+}
+
+/* UMOV Wd/Xd, Vn.T[ni] */
+static inline void neon_umov(code_buffer_t *b, int size, uint8_t rd, uint8_t n, int ni)
+{
+    emit_arm64_insn(b, (size == 3 ? 0x4E003C00u : 0x0E003C00u) |
+                       (neon_imm5(size, ni) << 16) | ((uint32_t)n << 5) | rd);
+}
+
+/* EXT Vd.16B, Vn.16B, Vm.16B, #idx */
+static inline void neon_ext(code_buffer_t *b, uint8_t d, uint8_t n, uint8_t m, int idx)
+{
+    emit_arm64_insn(b, 0x6E000000u | ((uint32_t)m << 16) | ((uint32_t)idx << 11) |
+                       ((uint32_t)n << 5) | d);
+}
+
+/*
+ * Shift by immediate on 8 << size bit lanes. Right shifts and narrows
+ * encode 2 * esize - shift, left shifts and widens esize + shift; for
+ * narrows and widens size is the narrow lane.
+ */
+static inline void neon_shift(code_buffer_t *b, int u, int opc, int q, int size, int right,
+                              int shift, uint8_t d, uint8_t n)
+{
+    int esize = 8 << size;
+    uint32_t immhb = (uint32_t)(right ? 2 * esize - shift : esize + shift);
+
+    emit_arm64_insn(b, 0x0F000400u | (q ? NEON_Q : 0) | ((uint32_t)u << 29) | (immhb << 16) |
+                       ((uint32_t)opc << 11) | ((uint32_t)n << 5) | d);
+}
+
+/* SSHLL/USHLL Vd, Vn, #0 (SXTL/UXTL); upper selects the "2" form */
+static inline void neon_extend(code_buffer_t *b, int u, int upper, int size, uint8_t d, uint8_t n)
+{
+    neon_shift(b, u, SHIFT_SSHLL, upper, size, 0, 0, d, n);
+}
+
+/* ============================================================================
+ * Operand Access and Lowering Entry Points
+ * ============================================================================ */
+
+/* -ENOTSUP for forms the table does not lower (REG_ONLY, MEM_ONLY) */
+int translate_simd_supported(const translate_simd_entry_t *e, const x86_insn_t *insn);
+
+/* log2 of the memory operand size in bytes */
+int translate_simd_mem_lg(const translate_simd_entry_t *e);
+
+/* LDR/STR Vt of 1 << lg bytes at the ModR/M address plus adjust; X16 is scratch */
+int translate_simd_mem(code_buffer_t *b, const x86_insn_t *insn, uint8_t arm_rm, int lg,
+                       int64_t adjust, uint64_t guest_pc, int store, uint8_t vt);
+
+/*
+ * Lower one 128-bit form as vd = op(vn, vm). Legacy SSE passes vn == vd;
+ * vm is the base GPR for memory forms, whose displacement gains adjust.
+ */
+int translate_simd_lower_op(code_buffer_t *b, const translate_simd_entry_t *e, const x86_insn_t *insn,
+                            uint8_t vd, uint8_t vn, uint8_t vm, int64_t adjust, uint64_t guest_pc);
+
+/* PTEST flags from T0 = d & m and T1 = m & ~d */
+void translate_simd_ptest_flags(code_buffer_t *b);
+
+#endif /* ROSETTA_TRANSLATE_SIMD_IMPL_H */
@@ -7,6 +7,12 @@
  * ============================================================================ */
 
 #include "rosetta_translate_special.h"
+#include "rosetta_arm64_emit.h"
+#include "rosetta_translate_mxcsr.h"
+#include "rosetta_exec_context.h"
+#include "rosetta_syscalls.h"
+#include "rosetta_vdso.h"
+#include <stddef.h>
 #include <stdint.h>
 
 /* ============================================================================
@@ -71,4 +77,226 @@ void translate_special_nop(code_buffer_t *code_buf, const x86_insn_t *insn)
     emit_nop(code_buf);
 }
 
+/* ============================================================================
+ * SYSCALL Translation
+ * ============================================================================ */
+
+/* Scratch registers (IP0/IP1) - not used for guest state */
+#define SYSCALL_TMP_STATE   16
+#define SYSCALL_TMP_TARGET  17
+#define SYSCALL_CTX_REG     18
+#define SYSCALL_LR_REG      30
+#define SYSCALL_GUEST_RSP   4       /* Host register of guest RSP */
+
+/* Guest register in host Xn (x86 encoding order) -> ThreadState slot */
+static const uint8_t syscall_guest_slot[16] = {
+    X86_RAX, X86_RCX, X86_RDX, X86_RBX, X86_RSP, X86_RBP, X86_RSI, X86_RDI,
+    X86_R8,  X86_R9,  X86_R10, X86_R11, X86_R12, X86_R13, X86_R14, X86_R15
+};
+
+static void emit_syscall_load_addr(code_buffer_t *code_buf, uint8_t reg, uint64_t addr)
+{
+    /* MOVZ + 3x MOVK: fixed length so the sequence size is predictable */
+    emit_movz(code_buf, reg, (uint16_t)(addr & 0xFFFF), 0);
+    emit_movk(code_buf, reg, (uint16_t)((addr >> 16) & 0xFFFF), 1);
+    emit_movk(code_buf, reg, (uint16_t)((addr >> 32) & 0xFFFF), 2);
+    emit_movk(code_buf, reg, (uint16_t)((addr >> 48) & 0xFFFF), 3);
+}
+
+static void emit_syscall_guest_regs(code_buffer_t *code_buf, int store)
+{
+    const int32_t base = (int32_t)offsetof(ThreadState, guest.r);
+    uint8_t host_of_slot[16];
+    int i;
+
+    for (i = 0; i < 16; i++) {
+        host_of_slot[syscall_guest_slot[i]] = (uint8_t)i;
+    }
+
+    /* Adjacent ThreadState slots are moved as pairs */
+    for (i = 0; i < 16; i += 2) {
+        int32_t off = base + i * 8;
+        if (store) {
+            emit_stp_off(code_buf, host_of_slot[i], host_of_slot[i + 1],
+                         SYSCALL_TMP_STATE, off);
+        } else {
+            emit_ldp_off(code_buf, host_of_slot[i], host_of_slot[i + 1],
+                         SYSCALL_TMP_STATE, off);
+        }
+    }
+}
+
+/**
+ * Call a host handler(ThreadState *[, arg1]) with guest registers spilled to state
+ *
+ * Guest XMM0-15 (Q0-Q15) are saved on the stack around the call, as
+ * SYSCALL keeps them; V16-V31 hold no guest state by then.
+ *
+ * @param arg1 Second argument, or NULL for handler(state)
+ * @param load_result Load state->syscall_result into RAX afterwards
+ */
+static void emit_host_state_call(code_buffer_t *code_buf, uint64_t target,
+                                 const void *arg1, int load_result)
+{
+    const uint32_t state_off = (uint32_t)offsetof(rosetta_exec_context_t, state);
+
+    /* Preserve the execution context and return address across the call */
+    emit_stp_pre(code_buf, SYSCALL_CTX_REG, SYSCALL_LR_REG, 31, -16);
+    emit_push_q0_q15(code_buf);
+
+    /* Spill guest registers so the handler sees them in ThreadState */
+    emit_ldr_uoff(code_buf, SYSCALL_TMP_STATE, SYSCALL_CTX_REG, state_off);
+    emit_syscall_guest_regs(code_buf, 1);
+
+    /* Keep the handler's FPSR flags out of guest MXCSR */
+    translate_mxcsr_emit_leave(code_buf, SYSCALL_TMP_STATE, 0, 1);
+
+    /* handler(state) */
+    emit_mov_reg(code_buf, 0, SYSCALL_TMP_STATE);
+    if (arg1 != NULL) {
+        emit_syscall_load_addr(code_buf, 1, (uint64_t)(uintptr_t)arg1);
+    }
+    emit_syscall_load_addr(code_buf, SYSCALL_TMP_TARGET, target);
+    emit_blr(code_buf, SYSCALL_TMP_TARGET);
+    translate_mxcsr_emit_resume(code_buf);
+
+    /* Reload guest registers */
+    emit_pop_q0_q15(code_buf);
+    emit_ldp_post(code_buf, SYSCALL_CTX_REG, SYSCALL_LR_REG, 31, 16);
+    emit_ldr_uoff(code_buf, SYSCALL_TMP_STATE, SYSCALL_CTX_REG, state_off);
+    emit_syscall_guest_regs(code_buf, 0);
+
+    /* Direct handlers leave the result in syscall_result, not RAX */
+    if (load_result) {
+        emit_ldr_uoff(code_buf, 0, SYSCALL_TMP_STATE,
+                      (uint32_t)offsetof(ThreadState, syscall_result));
+    }
+}
+
+void translate_special_syscall(code_buffer_t *code_buf, const x86_insn_t *insn,
+                               int64_t known_nr)
+{
+    const syscall_desc_t *desc = NULL;
+
+    (void)insn;
+
+    if (known_nr >= 0) {
+        desc = syscall_lookup((int)known_nr);
+    }
+
+    /* Known syscalls call their handler directly, unless guest pointers
+     * must be translated for a relocated guest: then the known entry goes
+     * through syscall_invoke_desc(). The rest (and raw runtime-registered
+     * handlers) go through the RAX-indexed dispatcher. */
+    if (desc != NULL && desc->handler != NULL) {
+        if (!(desc->flags & SYSCALL_FLAG_GUEST_PTRS) || syscall_get_guest_memory() == NULL) {
+            emit_host_state_call(code_buf, (uint64_t)(uintptr_t)desc->handler, NULL, 1);
+        } else {
+            emit_host_state_call(code_buf, (uint64_t)(uintptr_t)syscall_invoke_desc, desc, 1);
+        }
+    } else {
+        emit_host_state_call(code_buf, (uint64_t)(uintptr_t)dispatch_syscall_state, NULL, 0);
+    }
+}
+
+int translate_special_vdso(code_buffer_t *code_buf, int func)
+{
+    syscall_handler_t intrinsic = rosetta_vdso_intrinsic(func);
+
+    if (intrinsic == NULL) {
+        return 0;
+    }
+
+    /* Whole vDSO function: host intrinsic, then return to the caller */
+    emit_host_state_call(code_buf, (uint64_t)(uintptr_t)intrinsic, NULL, 1);
+
+    /* Guest RET: pop the return address into guest.rip for the dispatcher */
+    emit_ldr_uoff(code_buf, SYSCALL_TMP_STATE, SYSCALL_CTX_REG,
+                  (uint32_t)offsetof(rosetta_exec_context_t, guest_mem_base));
+    emit_arm64_insn(code_buf, 0xF8606800u | ((uint32_t)SYSCALL_GUEST_RSP << 16) |
+                              (SYSCALL_TMP_STATE << 5) | SYSCALL_TMP_TARGET);   /* LDR X17, [X16, X4] */
+    emit_add_imm(code_buf, SYSCALL_GUEST_RSP, SYSCALL_GUEST_RSP, 8);
+    emit_ldr_uoff(code_buf, SYSCALL_TMP_STATE, SYSCALL_CTX_REG,
+                  (uint32_t)offsetof(rosetta_exec_context_t, state));
+    emit_str_uoff(code_buf, SYSCALL_TMP_TARGET, SYSCALL_TMP_STATE,
+                  (uint32_t)offsetof(ThreadState, guest.rip));
+    emit_ret(code_buf);
+    return 1;
+}
+
+int64_t translate_special_track_syscall_nr(const x86_insn_t *insn, int64_t known_nr)
+{
+    /* 66 leaves the upper bits of a 16-bit destination as they were */
+    const int opsize16 = insn->simd_prefix == 0x66;
+    uint8_t dst;
+
+    /* MOV r32/r64, imm (B8+r) */
+    if (insn->opcode >= 0xB8 && insn->opcode <= 0xBF) {
+        dst = (uint8_t)((insn->opcode & 7) | ((insn->rex & 0x01) << 3));
+        if (dst == X86_RAX) {
+            return (!opsize16 && insn->imm >= 0 && insn->imm < X86_64_SYSCALL_MAX) ? insn->imm : -1;
+        }
+        return known_nr;
+    }
+
+    /* MOV r/m, imm32 (C7 /0) with a register destination */
+    if (insn->opcode == 0xC7 && insn->mod == 3) {
+        dst = (uint8_t)(insn->rm | ((insn->rex & 0x01) << 3));
+        if (dst == X86_RAX) {
+            return (!opsize16 && insn->imm >= 0 && insn->imm < X86_64_SYSCALL_MAX) ? insn->imm : -1;
+        }
+        return known_nr;
+    }
+
+    /* MOV/LEA into a register other than RAX keeps RAX intact */
+    if ((insn->opcode == 0x8B || insn->opcode == 0x8D) &&
+        (insn->reg | ((insn->rex & 0x04) << 1)) != X86_RAX) {
+        return known_nr;
+    }
+
+    /* Register-to-register MOV (89 /r) into a register other than RAX */
+    if (insn->opcode == 0x89 && insn->mod == 3 &&
+        (insn->rm | ((insn->rex & 0x01) << 3)) != X86_RAX) {
+        return known_nr;
+    }
+
+    /* NOP and PUSH do not write RAX; with REX or 66, 90 is XCHG with RAX */
+    if ((insn->opcode == 0x90 && insn->rex == 0 && !opsize16) ||
+        (insn->opcode >= 0x50 && insn->opcode <= 0x57) ||
+        insn->opcode == 0x68 || insn->opcode == 0x6A) {
+        return known_nr;
+    }
+
+    /* Anything else may clobber RAX */
+    return -1;
+}
+
+/* ============================================================================
+ * Direction Flag
+ * ============================================================================ */
+
+#define DF_ORR_X17          0xB2760231u     /* ORR X17, X17, #(1 << 10) */
+#define DF_AND_X17          0x9275FA31u     /* AND X17, X17, #~(1 << 10) */
+
+/* Only the string helpers read DF, from guest.rflags */
+static void translate_special_df(code_buffer_t *code_buf, uint32_t op)
+{
+    emit_ldr_uoff(code_buf, SYSCALL_TMP_STATE, SYSCALL_CTX_REG, offsetof(rosetta_exec_context_t, state));
+    emit_ldr_uoff(code_buf, SYSCALL_TMP_TARGET, SYSCALL_TMP_STATE, offsetof(ThreadState, guest.rflags));
+    emit_arm64_insn(code_buf, op);
+    emit_str_uoff(code_buf, SYSCALL_TMP_TARGET, SYSCALL_TMP_STATE, offsetof(ThreadState, guest.rflags));
+}
+
+void translate_special_cld(code_buffer_t *code_buf, const x86_insn_t *insn)
+{
+    (void)insn;
+    translate_special_df(code_buf, DF_AND_X17);
+}
+
+void translate_special_std(code_buffer_t *code_buf, const x86_insn_t *insn)
+{
+    (void)insn;
+    translate_special_df(code_buf, DF_ORR_X17);
+}
+
 /* End of rosetta_translate_special.c */
@@ -73,6 +73,20 @@ void translate_special_cli(code_buffer_t *code_buf, const x86_insn_t *insn);
  */
 void translate_special_sti(code_buffer_t *code_buf, const x86_insn_t *insn);
 
+/**
+ * Translate CLD (clear direction flag) into guest.rflags
+ * @param code_buf Code buffer for emission
+ * @param insn Decoded x86 instruction
+ */
+void translate_special_cld(code_buffer_t *code_buf, const x86_insn_t *insn);
+
+/**
+ * Translate STD (set direction flag) into guest.rflags
+ * @param code_buf Code buffer for emission
+ * @param insn Decoded x86 instruction
+ */
+void translate_special_std(code_buffer_t *code_buf, const x86_insn_t *insn);
+
 /**
  * Translate NOP (no operation)
  * @param code_buf Code buffer for emission
@@ -80,4 +94,36 @@ void translate_special_sti(code_buffer_t *code_buf, const x86_insn_t *insn);
  */
 void translate_special_nop(code_buffer_t *code_buf, const x86_insn_t *insn);
 
+/**
+ * Translate SYSCALL (system call)
+ * @param code_buf Code buffer for emission
+ * @param insn Decoded x86 instruction
+ * @param known_nr Syscall number if known at translation time, or -1
+ *
+ * When the number is known, the emitted code calls the syscall handler
+ * directly; otherwise it calls dispatch_syscall_state().
+ */
+void translate_special_syscall(code_buffer_t *code_buf, const x86_insn_t *insn,
+                               int64_t known_nr);
+
+/**
+ * Translate a call into the guest vDSO as a host intrinsic
+ *
+ * The block runs the intrinsic, then the guest RET: the return address
+ * is popped from [RSP] into guest.rip.
+ *
+ * @param code_buf Code buffer for emission
+ * @param func vDSO function index (rosetta_vdso_lookup)
+ * @return 1 if the function was translated (block ends), 0 otherwise
+ */
+int translate_special_vdso(code_buffer_t *code_buf, int func);
+
+/**
+ * Track a constant syscall number in RAX across a block
+ * @param insn Decoded x86 instruction
+ * @param known_nr Syscall number known before this instruction, or -1
+ * @return Syscall number known after this instruction, or -1
+ */
+int64_t translate_special_track_syscall_nr(const x86_insn_t *insn, int64_t known_nr);
+
 #endif /* ROSETTA_TRANSLATE_SPECIAL_H */
@@ -0,0 +1,882 @@
+/* ============================================================================
+ * Rosetta x87 Translation Implementation
+ * ============================================================================
+ *
+ * This module lowers x86_64 x87 instructions. In fast mode loads, stores,
+ * arithmetic, compares, FCMOV, FXCH and the constants become ARM64 scalar
+ * double precision on a register stack cached in V16-V23 (see
+ * rosetta_translate_x87.h); the rest, and everything in accurate mode,
+ * calls rosetta_x87_exec() with the guest registers saved on the stack.
+ * ============================================================================ */
+
+#include "rosetta_translate_x87.h"
+#include "rosetta_translate_simd_impl.h"
+#include "rosetta_translate_mxcsr.h"
+#include "rosetta_x87.h"
+#include "rosetta_exec_context.h"
+#include "rosetta_arm64_emit.h"
+#include <errno.h>
+#include <stddef.h>
+#include <string.h>
+
+#define X87_SLOT_BASE   16      /* Slot v starts out in V(16 + v) */
+#define X87_XADDR       16      /* Memory operand address (IP0) */
+#define X87_XSTATE      17      /* ThreadState pointer, loaded on first use */
+#define X87_XCTX        18      /* rosetta_exec_context_t pointer */
+#define X87_XSPILL      15      /* Borrowed by the flush, saved on the stack */
+#define X87_XZR         31
+#define X87_OFF(field)  offsetof(ThreadState, guest.field)
+
+/* Helper call frame: X0-X15, X18/X30, Q0-Q15 */
+#define X87_FRAME       400
+#define X87_FRAME_Q     144
+
+_Static_assert(X87_OFF(st) % 16 == 0 && X87_OFF(st) < 32768 - 128, "st[] must be reachable with LDR D");
+_Static_assert(X87_OFF(fpu_sw) % 4 == 0 && X87_OFF(fpu_cc) == X87_OFF(fpu_sw) + 2,
+               "FNSTSW reads the status word and condition codes with one LDR W");
+_Static_assert(X87_OFF(fpu_cw) % 2 == 0 && X87_OFF(fpu_top) < 4096 && X87_OFF(fpu_tag) < 4096,
+               "control word, TOP and tags must be reachable with LDRH/LDRB");
+
+/* ModR/M reg field of the instruction (the /digit of memory forms) */
+#define X87_REG(insn)   (((insn)->modrm >> 3) & 7)
+#define X87_RM(insn)    ((insn)->modrm & 7)
+
+/* ============================================================================
+ * Encodings
+ * ============================================================================ */
+
+#define A64_LDRB        0x39400000u     /* LDRB Wt, [Xn, #imm] */
+#define A64_STRB        0x39000000u
+#define A64_LDRH        0x79400000u
+#define A64_STRH        0x79000000u
+#define A64_LDRSH_X     0x79800000u
+#define A64_LDR_W       0xB9400000u
+#define A64_STR_W       0xB9000000u
+#define A64_LDRSW       0xB9800000u
+#define A64_LDR_X       0xF9400000u
+#define A64_STR_X       0xF9000000u
+#define A64_LDR_S       0xBD400000u
+#define A64_STR_S       0xBD000000u
+#define A64_LDR_D       0xFD400000u
+#define A64_STR_D       0xFD000000u
+
+#define FP_FNEG         FP_1SRC(1, 2)
+#define FP_FABS         FP_1SRC(1, 1)
+#define FP_FMOV         FP_1SRC(1, 0)
+#define FP_FRINTN       FP_1SRC(1, 8)
+#define FP_FRINTP       FP_1SRC(1, 9)
+#define FP_FRINTM       FP_1SRC(1, 10)
+#define FP_FRINTZ       FP_1SRC(1, 11)
+
+/* LDR/STR of 1 << lg bytes at [Xn, #off] */
+static void x87_ldst(code_buffer_t *b, uint32_t op, int lg, uint8_t rt, uint8_t rn, uint32_t off)
+{
+    emit_arm64_insn(b, op | ((off >> lg) << 10) | ((uint32_t)rn << 5) | rt);
+}
+
+/* ADD Wd, Wn, #imm */
+static void x87_add_w(code_buffer_t *b, uint8_t d, uint8_t n, uint32_t imm)
+{
+    emit_arm64_insn(b, 0x11000000u | (imm << 10) | ((uint32_t)n << 5) | d);
+}
+
+static void x87_and7_w(code_buffer_t *b, uint8_t d, uint8_t n)
+{
+    emit_arm64_insn(b, 0x12000800u | ((uint32_t)n << 5) | d);      /* AND Wd, Wn, #7 */
+}
+
+/* ADD Xd, Xn, Xm, LSL #sh (Xn = 31 is XZR) */
+static void x87_add_lsl(code_buffer_t *b, uint8_t d, uint8_t n, uint8_t m, int sh)
+{
+    emit_arm64_insn(b, 0x8B000000u | ((uint32_t)m << 16) | ((uint32_t)sh << 10) |
+                       ((uint32_t)n << 5) | d);
+}
+
+static void x87_fp2(code_buffer_t *b, uint32_t op, uint8_t d, uint8_t n, uint8_t m)
+{
+    emit_arm64_insn(b, op | (1u << 22) | ((uint32_t)m << 16) | ((uint32_t)n << 5) | d);
+}
+
+static void x87_fcmp(code_buffer_t *b, uint8_t n, uint8_t m)
+{
+    emit_arm64_insn(b, 0x1E602000u | ((uint32_t)m << 16) | ((uint32_t)n << 5));
+}
+
+/* CSINC Wd, Wn, Wm, cond (CSET Wd, c is CSINC Wd, WZR, WZR, !c) */
+static void x87_csinc(code_buffer_t *b, uint8_t d, uint8_t n, uint8_t m, int cond)
+{
+    emit_arm64_insn(b, 0x1A800400u | ((uint32_t)m << 16) | ((uint32_t)cond << 12) |
+                       ((uint32_t)n << 5) | d);
+}
+
+/* ORR Xd, Xn, Xm, LSL #sh */
+static void x87_orr_lsl(code_buffer_t *b, uint8_t d, uint8_t n, uint8_t m, int sh)
+{
+    emit_arm64_insn(b, 0xAA000000u | ((uint32_t)m << 16) | ((uint32_t)sh << 10) |
+                       ((uint32_t)n << 5) | d);
+}
+
+static void x87_mrs_nzcv(code_buffer_t *b, uint8_t t)
+{
+    emit_arm64_insn(b, 0xD53B4200u | t);
+}
+
+static void x87_msr_nzcv(code_buffer_t *b, uint8_t t)
+{
+    emit_arm64_insn(b, 0xD51B4200u | t);
+}
+
+/* ============================================================================
+ * Stack Model
+ * ============================================================================ */
+
+void translate_x87_begin_block(translate_x87_state_t *st)
+{
+    int v;
+
+    memset(st, 0, sizeof(*st));
+    for (v = 0; v < X87_CACHE_SLOTS; v++) {
+        st->host_of[v] = (uint8_t)(X87_SLOT_BASE + v);
+    }
+    st->accurate = rosetta_x87_mode() == ROSETTA_X87_ACCURATE;
+}
+
+static void x87_state_ptr(code_buffer_t *b, translate_x87_state_t *st)
+{
+    if (!st->state_loaded) {
+        emit_ldr_uoff(b, X87_XSTATE, X87_XCTX, offsetof(rosetta_exec_context_t, state));
+        st->state_loaded = 1;
+    }
+}
+
+static int x87_slot(const translate_x87_state_t *st, int i)
+{
+    return (st->delta + i) & 7;
+}
+
+/* Vn holding ST(i), loaded from st[(TOP + slot) & 7] on first use */
+static uint8_t x87_get(code_buffer_t *b, translate_x87_state_t *st, int i)
+{
+    int v = x87_slot(st, i);
+    uint8_t vr = st->host_of[v];
+
+    if (!(st->valid & (1u << v))) {
+        x87_state_ptr(b, st);
+        x87_ldst(b, A64_LDRB, 0, X87_XADDR, X87_XSTATE, X87_OFF(fpu_top));
+        if (v) {
+            x87_add_w(b, X87_XADDR, X87_XADDR, (uint32_t)v);
+            x87_and7_w(b, X87_XADDR, X87_XADDR);
+        }
+        x87_add_lsl(b, X87_XADDR, X87_XSTATE, X87_XADDR, 4);
+        x87_ldst(b, A64_LDR_D, 3, vr, X87_XADDR, X87_OFF(st));
+        st->valid |= (uint8_t)(1u << v);
+    }
+    return vr;
+}
+
+/* ST(i) has been written through its register */
+static void x87_written(translate_x87_state_t *st, int i)
+{
+    uint8_t bit = (uint8_t)(1u << x87_slot(st, i));
+
+    st->valid |= bit;
+    st->dirty |= bit;
+}
+
+/* Vn for ST(i), to overwrite entirely */
+static uint8_t x87_dst(translate_x87_state_t *st, int i)
+{
+    x87_written(st, i);
+    return st->host_of[x87_slot(st, i)];
+}
+
+static void x87_touch(translate_x87_state_t *st, int v, int was_full)
+{
+    uint8_t bit = (uint8_t)(1u << v);
+
+    if (!(st->touched & bit)) {
+        st->touched |= bit;
+        if (was_full) {
+            st->entry_full |= bit;
+        }
+    }
+}
+
+/* Vn for the new ST(0); the slot is taken to be empty at entry if the block has not touched it */
+static uint8_t x87_push(translate_x87_state_t *st)
+{
+    int v;
+
+    st->delta = (uint8_t)((st->delta - 1) & 7);
+    v = st->delta;
+    x87_touch(st, v, 0);
+    st->full |= (uint8_t)(1u << v);
+    return x87_dst(st, 0);
+}
+
+/* The popped value is dropped without a store: its register is empty */
+static void x87_pop(translate_x87_state_t *st)
+{
+    int v = st->delta;
+    uint8_t bit = (uint8_t)(1u << v);
+
+    x87_touch(st, v, 1);
+    st->full &= (uint8_t)~bit;
+    st->valid &= (uint8_t)~bit;
+    st->dirty &= (uint8_t)~bit;
+    st->delta = (uint8_t)((v + 1) & 7);
+}
+
+/* Exchange ST(0) and ST(i) in the map; no code once both are loaded */
+static void x87_swap(code_buffer_t *b, translate_x87_state_t *st, int i)
+{
+    int v0 = x87_slot(st, 0);
+    int vi = x87_slot(st, i);
+    uint8_t r = x87_get(b, st, 0);
+
+    st->host_of[v0] = x87_get(b, st, i);
+    st->host_of[vi] = r;
+    x87_written(st, 0);
+    x87_written(st, i);
+}
+
+void translate_x87_flush(code_buffer_t *code_buf, translate_x87_state_t *st)
+{
+    uint8_t set = st->touched & st->full & (uint8_t)~st->entry_full;
+    uint8_t clr = st->touched & (uint8_t)~st->full & st->entry_full;
+    int v;
+
+    st->state_loaded = 0;
+    if (!st->dirty && !set && !clr && !st->delta) {
+        translate_x87_begin_block(st);
+        return;
+    }
+
+    x87_state_ptr(code_buf, st);
+    emit_arm64_insn(code_buf, 0xF81F0FE0u | X87_XSPILL);           /* STR X15, [SP, #-16]! */
+    x87_ldst(code_buf, A64_LDRB, 0, X87_XSPILL, X87_XSTATE, X87_OFF(fpu_top));
+
+    for (v = 0; v < X87_CACHE_SLOTS; v++) {
+        if (!(st->dirty & (1u << v))) {
+            continue;
+        }
+        if (v) {
+            x87_add_w(code_buf, X87_XADDR, X87_XSPILL, (uint32_t)v);
+            x87_and7_w(code_buf, X87_XADDR, X87_XADDR);
+            x87_add_lsl(code_buf, X87_XADDR, X87_XSTATE, X87_XADDR, 4);
+        } else {
+            x87_add_lsl(code_buf, X87_XADDR, X87_XSTATE, X87_XSPILL, 4);
+        }
+        x87_ldst(code_buf, A64_STR_D, 3, st->host_of[v], X87_XADDR, X87_OFF(st));
+    }
+
+    /*
+     * Tags are physical: rotate the slot masks by TOP at run time. Bits
+     * 15:8 of (m | m << 8) << TOP are m rotated left by TOP.
+     */
+    if (set || clr) {
+        uint64_t k = ((uint64_t)clr | (uint64_t)clr << 8) |
+                     ((uint64_t)set | (uint64_t)set << 8) << 32;
+
+        emit_mov_imm64(code_buf, X87_XADDR, k);
+        emit_arm64_insn(code_buf, 0x9AC02000u | (X87_XSPILL << 16) | (X87_XADDR << 5) |
+                                  X87_XADDR);                   /* LSLV X16, X16, X15 */
+    }
+    if (st->delta) {
+        x87_add_w(code_buf, X87_XSPILL, X87_XSPILL, st->delta);
+        x87_and7_w(code_buf, X87_XSPILL, X87_XSPILL);
+        x87_ldst(code_buf, A64_STRB, 0, X87_XSPILL, X87_XSTATE, X87_OFF(fpu_top));
+    }
+    if (set || clr) {
+        x87_ldst(code_buf, A64_LDRB, 0, X87_XSPILL, X87_XSTATE, X87_OFF(fpu_tag));
+        emit_arm64_insn(code_buf, 0x0A600000u | (X87_XADDR << 16) | (8u << 10) |
+                                  (X87_XSPILL << 5) | X87_XSPILL);      /* BIC W15, W15, W16, LSR #8 */
+        emit_arm64_insn(code_buf, 0xAA400000u | (X87_XADDR << 16) | (40u << 10) |
+                                  (X87_XSPILL << 5) | X87_XSPILL);      /* ORR X15, X15, X16, LSR #40 */
+        x87_ldst(code_buf, A64_STRB, 0, X87_XSPILL, X87_XSTATE, X87_OFF(fpu_tag));
+    }
+    emit_arm64_insn(code_buf, 0xF84107E0u | X87_XSPILL);           /* LDR X15, [SP], #16 */
+    translate_x87_begin_block(st);
+}
+
+/* ============================================================================
+ * Memory Operands
+ * ============================================================================ */
+
+/* X16 = effective address; X17 is clobbered for displacements beyond 12 bits */
+static void x87_addr(code_buffer_t *b, translate_x87_state_t *st, const x86_insn_t *insn,
+                     uint64_t guest_pc)
+{
+    int64_t disp = insn->disp;
+    int base = insn->rm & 0x0F;
+    int index = -1;
+    uint8_t r;
+
+    if ((insn->rm & 7) == 4) {
+        index = ((insn->sib >> 3) & 7) | ((insn->rex & 0x02) ? 8 : 0);
+        if (index == 4) {
+            index = -1;                                 /* No index */
+        }
+        base = (insn->sib & 7) | ((insn->rex & 0x01) ? 8 : 0);
+        if (insn->mod == 0 && (insn->sib & 7) == 5) {
+            base = -1;                                  /* disp32 without a base */
+        }
+    } else if (insn->mod == 0 && (insn->rm & 7) == 5) {
+        emit_mov_imm64(b, X87_XADDR, guest_pc + insn->length + (uint64_t)disp);
+        return;
+    }
+
+    if (base < 0 && index < 0) {
+        emit_mov_imm64(b, X87_XADDR, (uint64_t)disp);
+        return;
+    }
+    r = (uint8_t)base;
+    if (index >= 0) {
+        x87_add_lsl(b, X87_XADDR, base < 0 ? X87_XZR : (uint8_t)base, (uint8_t)index, insn->sib >> 6);
+        r = X87_XADDR;
+    }
+    if (disp > -4096 && disp < 0) {
+        emit_sub_imm(b, X87_XADDR, r, (uint16_t)-disp);
+    } else if (disp >= 0 && disp < 4096) {
+        if (disp || r != X87_XADDR) {
+            emit_add_imm(b, X87_XADDR, r, (uint16_t)disp);
+        }
+    } else {
+        emit_mov_imm64(b, X87_XSTATE, (uint64_t)disp);
+        x87_add_lsl(b, X87_XADDR, r, X87_XSTATE, 0);
+        st->state_loaded = 0;
+    }
+}
+
+/* Memory operand kinds, from the opcode */
+enum {
+    X87_M32FP,
+    X87_M64FP,
+    X87_M16INT,
+    X87_M32INT,
+    X87_M64INT
+};
+
+/* Vd = the memory operand at [X16] as a double */
+static void x87_load_mem(code_buffer_t *b, int kind, uint8_t vd)
+{
+    switch (kind) {
+    case X87_M32FP:
+        x87_ldst(b, A64_LDR_S, 2, vd, X87_XADDR, 0);
+        neon_rr(b, FP_FCVT_TO_D, vd, vd);
+        return;
+    case X87_M64FP:
+        x87_ldst(b, A64_LDR_D, 3, vd, X87_XADDR, 0);
+        return;
+    case X87_M16INT:
+        x87_ldst(b, A64_LDRSH_X, 1, X87_XADDR, X87_XADDR, 0);
+        break;
+    case X87_M32INT:
+        x87_ldst(b, A64_LDRSW, 2, X87_XADDR, X87_XADDR, 0);
+        break;
+    default:
+        x87_ldst(b, A64_LDR_X, 3, X87_XADDR, X87_XADDR, 0);
+        break;
+    }
+    emit_arm64_insn(b, 0x9E620000u | (X87_XADDR << 5) | vd);      /* SCVTF Dd, X16 */
+}
+
+/* ============================================================================
+ * Lowerings
+ * ============================================================================ */
+
+/* d = d op s for the arithmetic /digit: add, mul, sub, subr, div, divr */
+static void x87_arith(code_buffer_t *b, int op, uint8_t d, uint8_t s)
+{
+    switch (op) {
+    case 0: x87_fp2(b, FP_FADD(0), d, d, s); break;
+    case 1: x87_fp2(b, FP_FMUL(0), d, d, s); break;
+    case 4: x87_fp2(b, FP_FSUB(0), d, d, s); break;
+    case 5: x87_fp2(b, FP_FSUB(0), d, s, d); break;
+    case 6: x87_fp2(b, FP_FDIV(0), d, d, s); break;
+    default: x87_fp2(b, FP_FDIV(0), d, s, d); break;
+    }
+}
+
+/*
+ * FCOM family: C3/C2/C0 from FCMP, C1 cleared, guest flags preserved.
+ * The condition codes are built above NZCV in X16, stored with STRH.
+ */
+static void x87_compare_cc(code_buffer_t *b, translate_x87_state_t *st, uint8_t n, uint8_t m, int zero)
+{
+    x87_mrs_nzcv(b, X87_XADDR);
+    if (zero) {
+        emit_arm64_insn(b, 0x1E602008u | ((uint32_t)n << 5));    /* FCMP Dn, #0.0 */
+    } else {
+        x87_fcmp(b, n, m);
+    }
+    x87_csinc(b, X87_XSTATE, X87_XZR, X87_XZR, COND_VC);          /* Unordered */
+    x87_orr_lsl(b, X87_XADDR, X87_XADDR, X87_XSTATE, 10);           /* C2 */
+    x87_csinc(b, X87_XSTATE, X87_XSTATE, X87_XZR, COND_NE);        /* Equal or unordered */
+    x87_orr_lsl(b, X87_XADDR, X87_XADDR, X87_XSTATE, 14);           /* C3 */
+    x87_csinc(b, X87_XSTATE, X87_XZR, X87_XZR, COND_GE);          /* Less or unordered */
+    x87_orr_lsl(b, X87_XADDR, X87_XADDR, X87_XSTATE, 8);            /* C0 */
+    st->state_loaded = 0;
+    x87_state_ptr(b, st);
+    x87_ldst(b, A64_STRH, 1, X87_XADDR, X87_XSTATE, X87_OFF(fpu_cc));
+    emit_arm64_insn(b, 0x92400000u | (36u << 16) | (3u << 10) |
+                       (X87_XADDR << 5) | X87_XADDR);                 /* AND X16, X16, #0xF0000000 */
+    x87_msr_nzcv(b, X87_XADDR);
+}
+
+/* FCOMI family: ZF, PF and CF as COMISD sets them */
+static void x87_compare_flags(code_buffer_t *b, uint8_t n, uint8_t m)
+{
+    x87_fcmp(b, n, m);
+    emit_arm64_insn(b, 0x1E600400u | ((uint32_t)m << 16) | ((uint32_t)COND_VC << 12) |
+                       ((uint32_t)n << 5) | 0x5);                   /* FCCMP Dn, Dm, #0b0101, VC */
+}
+
+/* ops[RC] chosen at run time from the guest control word; clobbers W16 */
+static void x87_by_rc(code_buffer_t *b, translate_x87_state_t *st, const uint32_t ops[4])
+{
+    x87_state_ptr(b, st);
+    x87_ldst(b, A64_LDRH, 1, X87_XADDR, X87_XSTATE, X87_OFF(fpu_cw));
+    emit_tbnz(b, X87_XADDR, X87_CW_RC_SHIFT + 1, 6 * 4);
+    emit_tbnz(b, X87_XADDR, X87_CW_RC_SHIFT, 3 * 4);
+    emit_arm64_insn(b, ops[0]);                                     /* Nearest */
+    emit_b(b, 7 * 4);
+    emit_arm64_insn(b, ops[1]);                                     /* Down */
+    emit_b(b, 5 * 4);
+    emit_tbnz(b, X87_XADDR, X87_CW_RC_SHIFT, 3 * 4);
+    emit_arm64_insn(b, ops[2]);                                     /* Up */
+    emit_b(b, 2 * 4);
+    emit_arm64_insn(b, ops[3]);                                     /* Toward zero */
+}
+
+/* Vd = Vn rounded to an integer under RC */
+static void x87_round(code_buffer_t *b, translate_x87_state_t *st, uint8_t d, uint8_t n)
+{
+    uint32_t rn = ((uint32_t)n << 5) | d;
+    const uint32_t ops[4] = { FP_FRINTN | rn, FP_FRINTM | rn, FP_FRINTP | rn, FP_FRINTZ | rn };
+
+    x87_by_rc(b, st, ops);
+}
+
+/* FIST/FISTP/FISTTP: ST(0) as an integer of 1 << lg bytes to the memory operand */
+static void x87_store_int(code_buffer_t *b, translate_x87_state_t *st, const x86_insn_t *insn,
+                          uint64_t guest_pc, int lg, int truncate)
+{
+    static const uint32_t str[3] = { A64_STRH, A64_STR_W, A64_STR_X };
+    uint8_t s = x87_get(b, st, 0);
+
+    if (!truncate) {
+        x87_round(b, st, SIMD_T0, s);
+        s = SIMD_T0;
+    }
+    x87_addr(b, st, insn, guest_pc);
+    emit_arm64_insn(b, (lg == 3 ? 0x9E780000u : 0x1E780000u) |
+                       ((uint32_t)s << 5) | X87_XSTATE);            /* FCVTZS W17/X17, Dn */
+    st->state_loaded = 0;
+    x87_ldst(b, str[lg - 1], (int)lg, X87_XSTATE, X87_XADDR, 0);
+}
+
+/* FNSTSW AX: the status word with C0-C3 and TOP merged in */
+static void x87_fnstsw_ax(code_buffer_t *b, translate_x87_state_t *st)
+{
+    x87_state_ptr(b, st);
+    if (!st->accurate) {
+        /* Flags of the fast instructions are still in FPSR */
+        emit_arm64_insn(b, 0xF81F0FE0u | X87_XSPILL);               /* STR X15, [SP, #-16]! */
+        translate_mxcsr_emit_fsw_fold(b, X87_XSTATE, X87_XADDR, X87_XSPILL);
+        emit_arm64_insn(b, 0xF84107E0u | X87_XSPILL);               /* LDR X15, [SP], #16 */
+        translate_mxcsr_emit_resume(b);
+    }
+    x87_ldst(b, A64_LDR_W, 2, X87_XADDR, X87_XSTATE, X87_OFF(fpu_sw));
+    emit_arm64_insn(b, 0x2A400000u | (X87_XADDR << 16) | (16u << 10) |
+                       (X87_XADDR << 5) | X87_XADDR);                 /* ORR W16, W16, W16, LSR #16 */
+    x87_ldst(b, A64_LDRB, 0, X87_XSTATE, X87_XSTATE, X87_OFF(fpu_top));
+    st->state_loaded = 0;
+    if (st->delta) {
+        x87_add_w(b, X87_XSTATE, X87_XSTATE, st->delta);
+        x87_and7_w(b, X87_XSTATE, X87_XSTATE);
+    }
+    emit_arm64_insn(b, 0x33000000u | (21u << 16) | (2u << 10) |
+                       (X87_XSTATE << 5) | X87_XADDR);                /* BFI W16, W17, #11, #3 */
+    emit_arm64_insn(b, 0xB3400000u | (15u << 10) | (X87_XADDR << 5) | 0);  /* BFXIL X0, X16, #0, #16 */
+}
+
+/*
+ * Call rosetta_x87_exec(state, addr, nzcv, op). X0-X15, X18, X30 and
+ * Q0-Q15 are saved around the call; V16-V31 hold nothing by then. The
+ * guest's FPSR flags are folded first, into FSW in fast mode (the x87
+ * environment of rosetta_translate_mxcsr.h) and MXCSR otherwise, and the
+ * helper's cleared after. In fast mode FPCR is reloaded from the control
+ * word, which the helper may have changed.
+ */
+static void x87_call(code_buffer_t *b, translate_x87_state_t *st, const x86_insn_t *insn,
+                     uint64_t guest_pc)
+{
+    int i;
+
+    if (insn->mod != 3) {
+        x87_addr(b, st, insn, guest_pc);
+    }
+    emit_sub_imm(b, 31, 31, X87_FRAME);
+    for (i = 0; i < 16; i += 2) {
+        emit_stp_off(b, (uint8_t)i, (uint8_t)(i + 1), 31, i * 8);
+    }
+    emit_stp_off(b, X87_XCTX, 30, 31, 128);
+    for (i = 0; i < 16; i += 2) {
+        emit_arm64_insn(b, 0xAD000000u | ((uint32_t)(X87_FRAME_Q / 16 + i) << 15) |
+                           ((uint32_t)(i + 1) << 10) | (31u << 5) | (uint32_t)i);   /* STP Qi, Qi+1 */
+    }
+    emit_arm64_insn(b, 0xAA0003E0u | (X87_XADDR << 16) | 1);        /* MOV X1, X16 */
+    emit_ldr_uoff(b, 0, X87_XCTX, offsetof(rosetta_exec_context_t, state));
+    if (st->accurate) {
+        translate_mxcsr_emit_leave(b, 0, 2, 3);
+    } else {
+        translate_mxcsr_emit_fsw_fold(b, 0, 2, 3);
+    }
+    x87_mrs_nzcv(b, 2);
+    emit_movz(b, 3, (uint16_t)X87_OP(insn->opcode, insn->modrm), 0);
+    emit_mov_imm64(b, X87_XADDR, (uint64_t)(uintptr_t)rosetta_x87_exec);
+    emit_blr(b, X87_XADDR);
+    translate_mxcsr_emit_resume(b);
+    x87_msr_nzcv(b, 0);
+    for (i = 0; i < 16; i += 2) {
+        emit_arm64_insn(b, 0xAD400000u | ((uint32_t)(X87_FRAME_Q / 16 + i) << 15) |
+                           ((uint32_t)(i + 1) << 10) | (31u << 5) | (uint32_t)i);   /* LDP Qi, Qi+1 */
+    }
+    emit_ldp_off(b, X87_XCTX, 30, 31, 128);
+    if (!st->accurate) {
+        emit_ldr_uoff(b, 1, X87_XCTX, offsetof(rosetta_exec_context_t, state));
+        translate_mxcsr_emit_fcw(b, 1, 2, 3);
+    }
+    for (i = 0; i < 16; i += 2) {
+        emit_ldp_off(b, (uint8_t)i, (uint8_t)(i + 1), 31, i * 8);
+    }
+    emit_add_imm(b, 31, 31, X87_FRAME);
+    st->state_loaded = 0;
+}
+
+/* Constants of FLD1..FLDZ (D9 E8-EE) as doubles */
+static const uint64_t x87_constants[7] = {
+    0x3FF0000000000000ull,      /* 1 */
+    0x400A934F0979A371ull,      /* log2(10) */
+    0x3FF71547652B82FEull,      /* log2(e) */
+    0x400921FB54442D18ull,      /* pi */
+    0x3FD34413509F79FFull,      /* log10(2) */
+    0x3FE62E42FEFA39EFull,      /* ln(2) */
+    0
+};
+
+static int x87_lower_d9_reg(code_buffer_t *b, translate_x87_state_t *st, const x86_insn_t *insn)
+{
+    int i = X87_RM(insn);
+    uint8_t s, d;
+
+    switch (insn->modrm & 0xF8) {
+    case 0xC0:                                                      /* FLD ST(i) */
+        s = x87_get(b, st, i);
+        d = x87_push(st);
+        neon_rr(b, FP_FMOV, d, s);
+        return 0;
+    case 0xC8:                                                      /* FXCH */
+        x87_swap(b, st, i);
+        return 0;
+    case 0xE8:
+        if (i == 7) {
+            return -ENOTSUP;
+        }
+        d = x87_push(st);
+        if (i == 0) {
+            emit_arm64_insn(b, 0x1E6E1000u | d);                    /* FMOV Dd, #1.0 */
+        } else if (i == 6) {
+            emit_arm64_insn(b, 0x2F00E400u | d);                    /* MOVI Dd, #0 */
+        } else {
+            emit_mov_imm64(b, X87_XADDR, x87_constants[i]);
+            emit_arm64_insn(b, 0x9E670000u | (X87_XADDR << 5) | d); /* FMOV Dd, X16 */
+        }
+        return 0;
+    }
+
+    switch (insn->modrm) {
+    case 0xD0:                                                      /* FNOP */
+        return 0;
+    case 0xE0:
+    case 0xE1:
+    case 0xFA:
+        d = x87_get(b, st, 0);
+        neon_rr(b, insn->modrm == 0xE0 ? FP_FNEG : insn->modrm == 0xE1 ? FP_FABS : FP_FSQRT(1), d, d);
+        x87_written(st, 0);
+        return 0;
+    case 0xE4:                                                      /* FTST */
+        x87_compare_cc(b, st, x87_get(b, st, 0), 0, 1);
+        return 0;
+    case 0xF6:                                                      /* FDECSTP */
+        st->delta = (uint8_t)((st->delta - 1) & 7);
+        return 0;
+    case 0xF7:                                                      /* FINCSTP */
+        st->delta = (uint8_t)((st->delta + 1) & 7);
+        return 0;
+    case 0xFC:                                                      /* FRNDINT */
+        d = x87_get(b, st, 0);
+        x87_round(b, st, d, d);
+        x87_written(st, 0);
+        return 0;
+    }
+    return -ENOTSUP;
+}
+
+static int x87_lower_reg(code_buffer_t *b, translate_x87_state_t *st, const x86_insn_t *insn)
+{
+    static const uint8_t fcmov_cond[8] = {
+        COND_CC, COND_EQ, COND_LS, COND_VS,                         /* B, E, BE, U */
+        COND_CS, COND_NE, COND_HI, COND_VC                          /* NB, NE, NBE, NU */
+    };
+    int op = X87_REG(insn);
+    int i = X87_RM(insn);
+    uint8_t s0, si;
+
+    switch (insn->opcode) {
+    case 0xD8:
+        s0 = x87_get(b, st, 0);
+        si = x87_get(b, st, i);
+        if (op == 2 || op == 3) {                                   /* FCOM, FCOMP */
+            x87_compare_cc(b, st, s0, si, 0);
+            if (op == 3) {
+                x87_pop(st);
+            }
+            return 0;
+        }
+        x87_arith(b, op, s0, si);
+        x87_written(st, 0);
+        return 0;
+    case 0xD9:
+        return x87_lower_d9_reg(b, st, insn);
+    case 0xDA:
+    case 0xDB:
+        if (op < 4) {                                               /* FCMOVcc */
+            s0 = x87_get(b, st, 0);
+            si = x87_get(b, st, i);
+            emit_arm64_insn(b, 0x1E600C00u | ((uint32_t)s0 << 16) |
+                               ((uint32_t)fcmov_cond[(insn->opcode & 1) * 4 + op] << 12) |
+                               ((uint32_t)si << 5) | s0);           /* FCSEL */
+            x87_written(st, 0);
+            return 0;
+        }
+        if (insn->modrm == 0xE9 && insn->opcode == 0xDA) {          /* FUCOMPP */
+            x87_compare_cc(b, st, x87_get(b, st, 0), x87_get(b, st, 1), 0);
+            x87_pop(st);
+            x87_pop(st);
+            return 0;
+        }
+        if (insn->opcode == 0xDB && (op == 5 || op == 6)) {         /* FUCOMI, FCOMI */
+            x87_compare_flags(b, x87_get(b, st, 0), x87_get(b, st, i));
+            return 0;
+        }
+        if (insn->modrm == 0xE2 && insn->opcode == 0xDB) {          /* FNCLEX */
+            x87_state_ptr(b, st);
+            x87_ldst(b, A64_STRH, 1, X87_XZR, X87_XSTATE, X87_OFF(fpu_sw));
+            return 0;
+        }
+        return -ENOTSUP;
+    case 0xDC:
+    case 0xDE:
+        s0 = x87_get(b, st, 0);
+        si = x87_get(b, st, i);
+        if (op == 2 || op == 3) {                                   /* FCOM2, FCOMP3/5, FCOMPP */
+            if (insn->opcode == 0xDE && insn->modrm != 0xD9) {
+                return -ENOTSUP;
+            }
+            x87_compare_cc(b, st, s0, si, 0);
+            if (op == 3) {
+                x87_pop(st);
+                if (insn->opcode == 0xDE) {
+                    x87_pop(st);
+                }
+            }
+            return 0;
+        }
+        x87_arith(b, op >= 4 ? op ^ 1 : op, si, s0);                /* ST(i) = ST(i) op ST(0) */
+        x87_written(st, i);
+        if (insn->opcode == 0xDE) {
+            x87_pop(st);
+        }
+        return 0;
+    case 0xDD:
+        switch (op) {
+        case 0: {                                                   /* FFREE */
+            int v = x87_slot(st, i);
+
+            x87_touch(st, v, 1);
+            st->full &= (uint8_t)~(1u << v);
+            return 0;
+        }
+        case 2:                                                     /* FST ST(i) */
+        case 3:                                                     /* FSTP ST(i) */
+            if (i && op == 3) {
+                int v0 = x87_slot(st, 0);
+                int vi = x87_slot(st, i);
+                uint8_t r = st->host_of[vi];
+
+                st->host_of[vi] = x87_get(b, st, 0);
+                st->host_of[v0] = r;
+                x87_written(st, i);
+            } else if (i) {
+                s0 = x87_get(b, st, 0);
+                neon_rr(b, FP_FMOV, x87_dst(st, i), s0);
+            }
+            if (op == 3) {
+                x87_pop(st);
+            }
+            return 0;
+        case 4:                                                     /* FUCOM */
+        case 5:                                                     /* FUCOMP */
+            x87_compare_cc(b, st, x87_get(b, st, 0), x87_get(b, st, i), 0);
+            if (op == 5) {
+                x87_pop(st);
+            }
+            return 0;
+        }
+        return -ENOTSUP;
+    case 0xDF:
+        if (op == 5 || op == 6) {                                   /* FUCOMIP, FCOMIP */
+            x87_compare_flags(b, x87_get(b, st, 0), x87_get(b, st, i));
+            x87_pop(st);
+            return 0;
+        }
+        return -ENOTSUP;
+    }
+    return -ENOTSUP;
+}
+
+static int x87_lower_mem(code_buffer_t *b, translate_x87_state_t *st, const x86_insn_t *insn,
+                         uint64_t guest_pc)
+{
+    int op = X87_REG(insn);
+    uint8_t s0, d;
+
+    switch (insn->opcode) {
+    case 0xD8:
+    case 0xDA:
+    case 0xDC:
+    case 0xDE: {                                                    /* Arithmetic and FCOM with a memory operand */
+        static const uint8_t kinds[4] = { X87_M32FP, X87_M32INT, X87_M64FP, X87_M16INT };
+
+        s0 = x87_get(b, st, 0);
+        x87_addr(b, st, insn, guest_pc);
+        x87_load_mem(b, kinds[(insn->opcode >> 1) & 3], SIMD_T0);
+        if (op == 2 || op == 3) {
+            x87_compare_cc(b, st, s0, SIMD_T0, 0);
+            if (op == 3) {
+                x87_pop(st);
+            }
+            return 0;
+        }
+        x87_arith(b, op, s0, SIMD_T0);
+        x87_written(st, 0);
+        return 0;
+    }
+    case 0xD9:
+    case 0xDD:
+        switch (op) {
+        case 0:                                                     /* FLD m32fp, m64fp */
+            x87_addr(b, st, insn, guest_pc);
+            d = x87_push(st);
+            x87_load_mem(b, insn->opcode == 0xD9 ? X87_M32FP : X87_M64FP, d);
+            return 0;
+        case 1:                                                     /* FISTTP m64 */
+            if (insn->opcode != 0xDD) {
+                return -ENOTSUP;
+            }
+            x87_store_int(b, st, insn, guest_pc, 3, 1);
+            x87_pop(st);
+            return 0;
+        case 2:                                                     /* FST, FSTP */
+        case 3:
+            s0 = x87_get(b, st, 0);
+            x87_addr(b, st, insn, guest_pc);
+            if (insn->opcode == 0xD9) {
+                neon_rr(b, FP_FCVT_TO_S, SIMD_T0, s0);
+                x87_ldst(b, A64_STR_S, 2, SIMD_T0, X87_XADDR, 0);
+            } else {
+                x87_ldst(b, A64_STR_D, 3, s0, X87_XADDR, 0);
+            }
+            if (op == 3) {
+                x87_pop(st);
+            }
+            return 0;
+        case 5:                                                     /* FLDCW */
+            if (insn->opcode != 0xD9) {
+                return -ENOTSUP;
+            }
+            x87_addr(b, st, insn, guest_pc);
+            x87_ldst(b, A64_LDRH, 1, X87_XADDR, X87_XADDR, 0);
+            x87_state_ptr(b, st);
+            x87_ldst(b, A64_STRH, 1, X87_XADDR, X87_XSTATE, X87_OFF(fpu_cw));
+            translate_mxcsr_emit_fcw(b, X87_XSTATE, X87_XADDR, X87_XSTATE);   /* New RC */
+            st->state_loaded = 0;
+            return 0;
+        case 7:                                                     /* FNSTCW */
+            if (insn->opcode != 0xD9) {
+                return -ENOTSUP;
+            }
+            x87_addr(b, st, insn, guest_pc);
+            x87_state_ptr(b, st);
+            x87_ldst(b, A64_LDRH, 1, X87_XSTATE, X87_XSTATE, X87_OFF(fpu_cw));
+            st->state_loaded = 0;
+            x87_ldst(b, A64_STRH, 1, X87_XSTATE, X87_XADDR, 0);
+            return 0;
+        }
+        return -ENOTSUP;
+    case 0xDB:
+    case 0xDF:
+        switch (op) {
+        case 0:                                                     /* FILD m32, m16 */
+        case 5:                                                     /* FILD m64 */
+            if (op == 5 && insn->opcode != 0xDF) {
+                return -ENOTSUP;
+            }
+            x87_addr(b, st, insn, guest_pc);
+            d = x87_push(st);
+            x87_load_mem(b, op == 5 ? X87_M64INT : insn->opcode == 0xDB ? X87_M32INT : X87_M16INT, d);
+            return 0;
+        case 1:                                                     /* FISTTP */
+        case 2:                                                     /* FIST */
+        case 3:                                                     /* FISTP */
+        case 7:                                                     /* FISTP m64 */
+            if (op == 7 && insn->opcode != 0xDF) {
+                return -ENOTSUP;
+            }
+            x87_store_int(b, st, insn, guest_pc, op == 7 ? 3 : insn->opcode == 0xDB ? 2 : 1, op == 1);
+            if (op != 2) {
+                x87_pop(st);
+            }
+            return 0;
+        }
+        return -ENOTSUP;
+    }
+    return -ENOTSUP;
+}
+
+int translate_x87_lower(code_buffer_t *code_buf, translate_x87_state_t *st,
+                        const x86_insn_t *insn, uint64_t guest_pc)
+{
+    if (insn->opcode < 0xD8 || insn->opcode > 0xDF || insn->opcode2 || insn->vex_prefix) {
+        return -ENOENT;
+    }
+    st->state_loaded = 0;                                           /* X17 does not survive other lowerings */
+
+    if (insn->opcode == 0xDF && insn->modrm == 0xE0) {              /* FNSTSW AX */
+        x87_fnstsw_ax(code_buf, st);
+        return 0;
+    }
+    if (!st->accurate) {
+        int ret = insn->mod == 3 ? x87_lower_reg(code_buf, st, insn)
+                                 : x87_lower_mem(code_buf, st, insn, guest_pc);
+
+        if (ret == 0) {
+            return 0;
+        }
+        translate_x87_flush(code_buf, st);
+    }
+    x87_call(code_buf, st, insn, guest_pc);
+    return 0;
+}
@@ -0,0 +1,75 @@
+/* ============================================================================
+ * Rosetta x87 Translation Header
+ * ============================================================================
+ *
+ * This header declares the lowering of x86_64 x87 instructions (D8-DF) to
+ * ARM64 scalar floating point, with calls into rosetta_x87_exec() for the
+ * instructions that are not lowered inline.
+ * ============================================================================ */
+
+#ifndef ROSETTA_TRANSLATE_X87_H
+#define ROSETTA_TRANSLATE_X87_H
+
+#include "rosetta_types.h"
+#include "rosetta_x86_decode.h"
+#include "rosetta_codegen.h"
+
+/* ============================================================================
+ * Register Stack Model
+ * ============================================================================
+ *
+ * In fast mode (rosetta_x87.h) the stack is tracked at translation time
+ * relative to TOP at block entry: slot v is physical register
+ * (TOP_entry + v) & 7 and ST(i) is slot (delta + i) & 7. Each slot lives
+ * in one of V16-V23, loaded from ThreadState on first use; FXCH and
+ * FSTP ST(i) only permute the slot-to-register map. TOP, the tag word and
+ * dirty slots are written back by translate_x87_flush(), so a block whose
+ * pushes and pops balance costs no TOP or tag traffic.
+ *
+ * The registers are shared with the AVX upper-half cache: the AVX cache
+ * is flushed before an x87 instruction and this one before a VEX one.
+ * In accurate mode nothing is cached and every instruction but
+ * FNSTSW AX is a call into rosetta_x87_exec().
+ * ============================================================================ */
+
+#define X87_CACHE_SLOTS     8       /* V16-V23 */
+
+typedef struct {
+    uint8_t host_of[X87_CACHE_SLOTS];   /* NEON register holding each slot */
+    uint8_t valid;                      /* Slots loaded into their register */
+    uint8_t dirty;                      /* Slots newer than ThreadState */
+    uint8_t touched;                    /* Slots pushed, popped or freed in the block */
+    uint8_t full;                       /* Touched slots now in use */
+    uint8_t entry_full;                 /* Touched slots in use at block entry */
+    uint8_t delta;                      /* TOP - TOP at entry, mod 8 */
+    uint8_t accurate;                   /* ROSETTA_X87_ACCURATE */
+    uint8_t state_loaded;               /* X17 holds the ThreadState pointer */
+} translate_x87_state_t;
+
+/* ============================================================================
+ * Lowering
+ * ============================================================================ */
+
+/**
+ * translate_x87_begin_block - Reset the stack model for a new block
+ */
+void translate_x87_begin_block(translate_x87_state_t *st);
+
+/**
+ * translate_x87_lower - Emit the lowering of an x87 instruction
+ * @param st Stack model of the block being translated
+ * @param guest_pc Address of the instruction, for RIP-relative operands
+ * @return 0 on success, -ENOENT for non-x87 instructions (nothing emitted)
+ */
+int translate_x87_lower(code_buffer_t *code_buf, translate_x87_state_t *st,
+                        const x86_insn_t *insn, uint64_t guest_pc);
+
+/**
+ * translate_x87_flush - Write cached registers, TOP and tags back
+ *
+ * Emitted before SYSCALL, before a VEX instruction and before the
+ * instruction that ends the block.
+ */
+void translate_x87_flush(code_buffer_t *code_buf, translate_x87_state_t *st);
+
+#endif /* ROSETTA_TRANSLATE_X87_H */
@@ -100,6 +100,20 @@ typedef struct {
 
     /* XMM registers (each 128-bit) */
     vec128_t xmm[16];
+
+    /* YMM bits 255:128 (the low halves are xmm) */
+    vec128_t ymm_hi[16];
+
+    /* x87 physical registers R0-R7, in the format of the x87 mode (rosetta_x87.h) */
+    vec128_t st[8];
+    u16 fpu_sw;         /* Status word without TOP and C0-C3 */
+    u16 fpu_cc;         /* C0-C3, at their status word bits (8, 9, 10, 14) */
+    u16 fpu_cw;         /* Control word */
+    u8  fpu_tag;        /* Bit n set: Rn is not empty */
+    u8  fpu_top;        /* TOP, 0-7 */
+
+    /* MXCSR; exception flags raised since the last LDMXCSR may still be in FPSR (rosetta_mxcsr.h) */
+    u32 mxcsr;
 } x86_context_t;
 
 /* ============================================================================
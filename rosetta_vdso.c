@@ -0,0 +1,288 @@
+/* ============================================================================
+ * Rosetta Guest vDSO Emulation - Implementation
+ * ============================================================================
+ *
+ * Builds a minimal ET_DYN image exporting the x86_64 vDSO functions with a
+ * DT_HASH/DT_SYMTAB/DT_STRTAB dynamic section, which is all the guest libc
+ * needs to resolve them. Each function body is a real "mov eax, nr;
+ * syscall; ret" stub, so the image stays correct even if a call site is
+ * interpreted rather than translated; translated calls never execute it.
+ * ============================================================================ */
+
+#include "rosetta_vdso.h"
+#include <elf.h>
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+
+/* ============================================================================
+ * Function Table
+ * ============================================================================ */
+
+typedef struct {
+    const char *name;               /* __vdso_* symbol */
+    const char *alias;              /* Weak alias exported by Linux */
+    int syscall_nr;                 /* Fallback syscall number */
+} vdso_func_desc_t;
+
+static const vdso_func_desc_t vdso_funcs[ROSETTA_VDSO_NUM_FUNCS] = {
+    [ROSETTA_VDSO_CLOCK_GETTIME] = {"__vdso_clock_gettime", "clock_gettime", X86_64_SYS_CLOCK_GETTIME},
+    [ROSETTA_VDSO_GETTIMEOFDAY]  = {"__vdso_gettimeofday",  "gettimeofday",  X86_64_SYS_GETTIMEOFDAY},
+    [ROSETTA_VDSO_TIME]          = {"__vdso_time",          "time",          X86_64_SYS_TIME},
+    [ROSETTA_VDSO_GETCPU]        = {"__vdso_getcpu",        "getcpu",        X86_64_SYS_GETCPU},
+    [ROSETTA_VDSO_CLOCK_GETRES]  = {"__vdso_clock_getres",  "clock_getres",  X86_64_SYS_CLOCK_GETRES},
+};
+
+/* Each function is exported under both names */
+#define VDSO_NUM_SYMS   (1 + 2 * ROSETTA_VDSO_NUM_FUNCS)    /* Incl. null symbol */
+
+static uint64_t g_vdso_base = 0;
+static uint64_t g_vdso_text = 0;    /* Image offset of first function */
+
+/* ============================================================================
+ * Intrinsics
+ * ============================================================================ */
+
+/* Go through dispatch so guest pointers are translated like for SYSCALL */
+static int vdso_clock_gettime(ThreadState *state)
+{
+    return dispatch_syscall(state, X86_64_SYS_CLOCK_GETTIME);
+}
+
+static int vdso_gettimeofday(ThreadState *state)
+{
+    return dispatch_syscall(state, X86_64_SYS_GETTIMEOFDAY);
+}
+
+static int vdso_getcpu(ThreadState *state)
+{
+    return dispatch_syscall(state, X86_64_SYS_GETCPU);
+}
+
+static int vdso_clock_getres(ThreadState *state)
+{
+    return dispatch_syscall(state, X86_64_SYS_CLOCK_GETRES);
+}
+
+/**
+ * time(tloc) - no dedicated syscall handler exists for it
+ */
+static int vdso_time(ThreadState *state)
+{
+    uint64_t guest_tloc = state->guest.r[X86_RDI];
+    time_t *tloc = syscall_guest_ptr(guest_tloc, sizeof(int64_t));
+    time_t now = time(NULL);
+
+    if (guest_tloc != 0 && tloc == NULL) {
+        state->syscall_result = -EFAULT;
+        return -1;
+    }
+    if (tloc != NULL) {
+        *tloc = now;
+    }
+    state->syscall_result = (int64_t)now;
+    return 0;
+}
+
+static const syscall_handler_t vdso_intrinsics[ROSETTA_VDSO_NUM_FUNCS] = {
+    [ROSETTA_VDSO_CLOCK_GETTIME] = vdso_clock_gettime,
+    [ROSETTA_VDSO_GETTIMEOFDAY]  = vdso_gettimeofday,
+    [ROSETTA_VDSO_TIME]          = vdso_time,
+    [ROSETTA_VDSO_GETCPU]        = vdso_getcpu,
+    [ROSETTA_VDSO_CLOCK_GETRES]  = vdso_clock_getres,
+};
+
+syscall_handler_t rosetta_vdso_intrinsic(int func)
+{
+    if (func < 0 || func >= ROSETTA_VDSO_NUM_FUNCS) {
+        return NULL;
+    }
+    return vdso_intrinsics[func];
+}
+
+/* ============================================================================
+ * Image Construction
+ * ============================================================================ */
+
+static size_t vdso_align(size_t off, size_t align)
+{
+    return (off + align - 1) & ~(align - 1);
+}
+
+int rosetta_vdso_build(uint8_t *buf, size_t size)
+{
+    Elf64_Ehdr *eh;
+    Elf64_Phdr *ph;
+    Elf64_Sym *sym;
+    Elf64_Dyn *dyn;
+    uint32_t *hash;
+    char *strtab;
+    size_t off_phdr, off_sym, off_str, off_hash, off_dyn, off_text, end;
+    size_t str_len = 1;
+    int i;
+
+    if (buf == NULL || size < ROSETTA_VDSO_SIZE) {
+        return -1;
+    }
+
+    /* Layout: ehdr | phdrs | dynsym | dynstr | hash | dynamic | text */
+    off_phdr = sizeof(Elf64_Ehdr);
+    off_sym = vdso_align(off_phdr + 2 * sizeof(Elf64_Phdr), 8);
+    off_str = off_sym + VDSO_NUM_SYMS * sizeof(Elf64_Sym);
+    for (i = 0; i < ROSETTA_VDSO_NUM_FUNCS; i++) {
+        str_len += strlen(vdso_funcs[i].name) + 1 + strlen(vdso_funcs[i].alias) + 1;
+    }
+    str_len += strlen("linux-vdso.so.1") + 1;
+    off_hash = vdso_align(off_str + str_len, 8);
+    off_dyn = vdso_align(off_hash + (2 + 1 + VDSO_NUM_SYMS) * sizeof(uint32_t), 8);
+    off_text = vdso_align(off_dyn + 7 * sizeof(Elf64_Dyn), ROSETTA_VDSO_FUNC_ALIGN);
+    end = off_text + ROSETTA_VDSO_NUM_FUNCS * ROSETTA_VDSO_FUNC_ALIGN;
+
+    if (end > size) {
+        return -1;
+    }
+
+    memset(buf, 0, ROSETTA_VDSO_SIZE);
+
+    /* ELF header */
+    eh = (Elf64_Ehdr *)buf;
+    memcpy(eh->e_ident, ELFMAG, SELFMAG);
+    eh->e_ident[EI_CLASS] = ELFCLASS64;
+    eh->e_ident[EI_DATA] = ELFDATA2LSB;
+    eh->e_ident[EI_VERSION] = EV_CURRENT;
+    eh->e_ident[EI_OSABI] = ELFOSABI_SYSV;
+    eh->e_type = ET_DYN;
+    eh->e_machine = EM_X86_64;
+    eh->e_version = EV_CURRENT;
+    eh->e_phoff = off_phdr;
+    eh->e_ehsize = sizeof(Elf64_Ehdr);
+    eh->e_phentsize = sizeof(Elf64_Phdr);
+    eh->e_phnum = 2;
+    eh->e_shentsize = sizeof(Elf64_Shdr);
+
+    /* Program headers: one R+X load covering the image, plus dynamic */
+    ph = (Elf64_Phdr *)(buf + off_phdr);
+    ph[0].p_type = PT_LOAD;
+    ph[0].p_flags = PF_R | PF_X;
+    ph[0].p_filesz = end;
+    ph[0].p_memsz = end;
+    ph[0].p_align = ROSETTA_PAGE_SIZE;
+    ph[1].p_type = PT_DYNAMIC;
+    ph[1].p_flags = PF_R;
+    ph[1].p_offset = ph[1].p_vaddr = ph[1].p_paddr = off_dyn;
+    ph[1].p_filesz = ph[1].p_memsz = 7 * sizeof(Elf64_Dyn);
+    ph[1].p_align = 8;
+
+    /* Symbols and strings */
+    sym = (Elf64_Sym *)(buf + off_sym);
+    strtab = (char *)(buf + off_str);
+    str_len = 1;
+    for (i = 0; i < ROSETTA_VDSO_NUM_FUNCS; i++) {
+        uint64_t addr = off_text + (uint64_t)i * ROSETTA_VDSO_FUNC_ALIGN;
+        int k;
+
+        for (k = 0; k < 2; k++) {
+            const char *name = k ? vdso_funcs[i].alias : vdso_funcs[i].name;
+            Elf64_Sym *s = &sym[1 + 2 * i + k];
+
+            s->st_name = (Elf64_Word)str_len;
+            s->st_info = ELF64_ST_INFO(k ? STB_WEAK : STB_GLOBAL, STT_FUNC);
+            s->st_shndx = 1;    /* Any defined section */
+            s->st_value = addr;
+            s->st_size = ROSETTA_VDSO_FUNC_ALIGN;
+            strcpy(strtab + str_len, name);
+            str_len += strlen(name) + 1;
+        }
+    }
+    strcpy(strtab + str_len, "linux-vdso.so.1");
+    {
+        size_t soname = str_len;
+        str_len += strlen("linux-vdso.so.1") + 1;
+
+        /* SysV hash: single bucket, chain walks every symbol */
+        hash = (uint32_t *)(buf + off_hash);
+        hash[0] = 1;                    /* nbucket */
+        hash[1] = VDSO_NUM_SYMS;        /* nchain */
+        hash[2] = VDSO_NUM_SYMS > 1 ? 1 : 0;
+        for (i = 0; i < VDSO_NUM_SYMS; i++) {
+            hash[3 + i] = (i + 1 < VDSO_NUM_SYMS && i != 0) ? (uint32_t)(i + 1) : 0;
+        }
+
+        /* Dynamic section */
+        dyn = (Elf64_Dyn *)(buf + off_dyn);
+        dyn[0].d_tag = DT_HASH;    dyn[0].d_un.d_ptr = off_hash;
+        dyn[1].d_tag = DT_SYMTAB;  dyn[1].d_un.d_ptr = off_sym;
+        dyn[2].d_tag = DT_STRTAB;  dyn[2].d_un.d_ptr = off_str;
+        dyn[3].d_tag = DT_STRSZ;   dyn[3].d_un.d_val = str_len;
+        dyn[4].d_tag = DT_SYMENT;  dyn[4].d_un.d_val = sizeof(Elf64_Sym);
+        dyn[5].d_tag = DT_SONAME;  dyn[5].d_un.d_val = soname;
+        dyn[6].d_tag = DT_NULL;
+    }
+
+    /* Function bodies: mov eax, nr; syscall; ret; int3 padding */
+    for (i = 0; i < ROSETTA_VDSO_NUM_FUNCS; i++) {
+        uint8_t *p = buf + off_text + (size_t)i * ROSETTA_VDSO_FUNC_ALIGN;
+        uint32_t nr = (uint32_t)vdso_funcs[i].syscall_nr;
+
+        memset(p, 0xCC, ROSETTA_VDSO_FUNC_ALIGN);
+        p[0] = 0xB8;
+        memcpy(p + 1, &nr, 4);
+        p[5] = 0x0F;
+        p[6] = 0x05;
+        p[7] = 0xC3;
+    }
+
+    g_vdso_text = off_text;
+    return (int)end;
+}
+
+/* ============================================================================
+ * Mapping and Lookup
+ * ============================================================================ */
+
+uint64_t rosetta_vdso_map(rosetta_memmgr_t *mgr)
+{
+    uint8_t image[ROSETTA_VDSO_SIZE];
+    uint64_t base;
+
+    if (mgr == NULL || rosetta_vdso_build(image, sizeof(image)) < 0) {
+        return 0;
+    }
+
+    /* Just below the default stack, where Linux places it too */
+    base = mgr->guest_base + mgr->total_size - ROSETTA_STACK_SIZE - ROSETTA_VDSO_SIZE;
+    base = rosetta_memmgr_alloc(mgr, base, ROSETTA_VDSO_SIZE,
+                                ROSETTA_PROT_READ | ROSETTA_PROT_EXEC, "[vdso]");
+    if (base == 0) {
+        return 0;
+    }
+
+    if (rosetta_memmgr_write(mgr, base, image, sizeof(image)) != (ssize_t)sizeof(image)) {
+        return 0;
+    }
+
+    g_vdso_base = base;
+    return base;
+}
+
+uint64_t rosetta_vdso_base(void)
+{
+    return g_vdso_base;
+}
+
+int rosetta_vdso_lookup(uint64_t guest_pc)
+{
+    uint64_t off;
+
+    if (g_vdso_base == 0 || guest_pc < g_vdso_base + g_vdso_text) {
+        return -1;
+    }
+
+    off = guest_pc - g_vdso_base - g_vdso_text;
+    if (off % ROSETTA_VDSO_FUNC_ALIGN != 0 ||
+        off / ROSETTA_VDSO_FUNC_ALIGN >= ROSETTA_VDSO_NUM_FUNCS) {
+        return -1;
+    }
+
+    return (int)(off / ROSETTA_VDSO_FUNC_ALIGN);
+}
@@ -0,0 +1,86 @@
+/* ============================================================================
+ * Rosetta Guest vDSO Emulation Header
+ * ============================================================================
+ *
+ * Synthetic x86_64 vDSO image mapped into the guest and advertised through
+ * AT_SYSINFO_EHDR. Its exported functions are recognized by the translator
+ * and replaced with intrinsics that call the host C library (and therefore
+ * the host vDSO) directly, so guest time queries never reach SYSCALL.
+ * ============================================================================ */
+
+#ifndef ROSETTA_VDSO_H
+#define ROSETTA_VDSO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "rosetta_memmgr.h"
+#include "rosetta_syscalls.h"
+
+/* ============================================================================
+ * vDSO Configuration
+ * ============================================================================ */
+
+#define ROSETTA_VDSO_SIZE       ROSETTA_PAGE_SIZE   /* Image fits one page */
+#define ROSETTA_VDSO_FUNC_ALIGN 16                  /* Bytes per function slot */
+
+/* Auxiliary vector tag for the vDSO base */
+#ifndef AT_SYSINFO_EHDR
+#define AT_SYSINFO_EHDR         33
+#endif
+
+/* Exported vDSO functions */
+typedef enum {
+    ROSETTA_VDSO_CLOCK_GETTIME = 0,
+    ROSETTA_VDSO_GETTIMEOFDAY,
+    ROSETTA_VDSO_TIME,
+    ROSETTA_VDSO_GETCPU,
+    ROSETTA_VDSO_CLOCK_GETRES,
+    ROSETTA_VDSO_NUM_FUNCS
+} rosetta_vdso_func_t;
+
+/* ============================================================================
+ * vDSO API
+ * ============================================================================ */
+
+/**
+ * Build the vDSO ELF image
+ * @param buf Output buffer (at least ROSETTA_VDSO_SIZE bytes)
+ * @param size Buffer size
+ * @return Image size in bytes, or -1 on error
+ *
+ * The image is position independent; symbol values are offsets from the
+ * load address, as with the kernel vDSO.
+ */
+int rosetta_vdso_build(uint8_t *buf, size_t size);
+
+/**
+ * Map the vDSO image into guest memory
+ * @param mgr Memory manager
+ * @return Guest address of the image (AT_SYSINFO_EHDR), or 0 on error
+ */
+uint64_t rosetta_vdso_map(rosetta_memmgr_t *mgr);
+
+/**
+ * Get guest address of the mapped vDSO
+ * @return Guest base address, or 0 if not mapped
+ */
+uint64_t rosetta_vdso_base(void);
+
+/**
+ * Identify a vDSO function entry point
+ * @param guest_pc Guest address
+ * @return rosetta_vdso_func_t, or -1 if guest_pc is not a vDSO entry
+ */
+int rosetta_vdso_lookup(uint64_t guest_pc);
+
+/**
+ * Get the host intrinsic implementing a vDSO function
+ * @param func Function index
+ * @return Handler that leaves its result in state->syscall_result, or NULL
+ *
+ * Arguments are read from RDI/RSI/RDX, which is both the SysV calling
+ * convention used to call the vDSO and the syscall argument convention.
+ */
+syscall_handler_t rosetta_vdso_intrinsic(int func);
+
+#endif /* ROSETTA_VDSO_H */
@@ -50,7 +50,7 @@ static const uint8_t modrm_lookup[256] = {
     /* 0xC0-0xC7 */ 1,1,0,0, 1,1,1,1,
     /* 0xC8-0xCF */ 0,0,0,0, 0,0,0,0,  /* ENTER, LEAVE, RET */
     /* 0xD0-0xD7 */ 1,1,1,1, 1,1,1,1,
-    /* 0xD8-0xDF */ 0,0,0,0, 0,0,0,0,  /* floating point */
+    /* 0xD8-0xDF */ 1,1,1,1, 1,1,1,1,  /* x87 */
     /* 0xE0-0xE7 */ 0,0,0,0, 0,0,0,0,  /* LOOP, JEXCXZ */
     /* 0xE8-0xEF */ 0,0,0,0, 0,0,0,0,  /* CALL, JMP */
     /* 0xF0-0xF7 */ 0,1,1,1, 1,1,1,1,  /* 0xF0=LOCK, F6/F7=group */
@@ -80,10 +80,10 @@ static const uint8_t modrm_0f_lookup[256] = {
     /* 0x28-0x2F */ 1,1,1,1, 1,1,1,1,  /* MOVAPS, CVT */
     /* 0x30-0x37 */ 2,2,2,0, 2,2,0,0,  /* WRMSR, RDTSC, etc */
     /* 0x38-0x3F */ 1,1,1,1, 1,1,1,1,  /* SSE4, SHA */
-    /* 0x40-0x4F */ 1,1,1,1, 1,1,1,1,
+    /* 0x40-0x4F */ 1,1,1,1, 1,1,1,1, 1,1,1,1, 1,1,1,1,  /* CMOVcc */
     /* 0x50-0x5F */ 1,1,1,1, 1,1,1,1, 1,1,1,1, 1,1,1,1,
     /* 0x60-0x6F */ 1,1,1,1, 1,1,1,1, 1,1,1,1, 1,1,1,1,
-    /* 0x70-0x7F */ 1,1,1,1, 1,1,1,1, 1,1,1,1, 1,1,1,1,
+    /* 0x70-0x7F */ 1,1,1,1, 1,1,1,0, 1,1,1,1, 1,1,1,1,  /* 77: EMMS/VZEROUPPER */
     /* 0x80-0x8F */ 1,1,1,1, 1,1,1,1, 1,1,1,1, 1,1,1,1,  /* JO, JNO, etc */
     /* 0x90-0x9F */ 1,1,1,1, 1,1,1,1, 1,1,1,1, 1,1,1,1,  /* SETO, SETNO, etc */
     /* 0xA0-0xAF */ 2,2,0,2, 2,1,1,1, 1,2,2,1, 1,1,1,1,  /* CPUID, etc */
@@ -414,8 +414,7 @@ static int decode_lea_fast(const uint8_t *p, x86_insn_t *insn)
 
     /* Handle SIB byte if present */
     if (insn->rm == 0x04 && insn->mod != 0x03) {
-        /* SIB byte present - skip it */
-        p++;
+        insn->sib = *p++;
         insn->length = p - start;
     }
 
@@ -822,6 +821,9 @@ int decode_x86_insn(const uint8_t *insn_ptr, x86_insn_t *insn) HOT_PATH
             if (byte == 0x66) {
                 insn->is_64bit = 0;
                 insn->simd_prefix = 0x66;
+                insn->has_opsize = 1;
+            } else if (byte == 0x67) {
+                insn->has_addrsize = 1;
             } else if (byte == 0xF2) {
                 has_rep = 1;
                 insn->simd_prefix = 0xF2;
@@ -864,6 +866,9 @@ int decode_x86_insn(const uint8_t *insn_ptr, x86_insn_t *insn) HOT_PATH
 
             uint8_t vex_byte1 = *p++;
 
+            /* ~R extends ModR/M.reg like REX.R */
+            rex = (vex_byte1 & 0x80) ? 0 : 0x04;
+
             insn->vex_prefix = 1;  /* Mark as 2-byte VEX */
             insn->vex_vvvv = (~(vex_byte1 >> 3)) & 0x0F;  /* Inverted vvvv (bits 6-3) */
             insn->vex_L = (vex_byte1 >> 2) & 0x01;         /* L field (bit 2) */
@@ -887,6 +892,9 @@ int decode_x86_insn(const uint8_t *insn_ptr, x86_insn_t *insn) HOT_PATH
             uint8_t vex_byte1 = *p++;
             uint8_t vex_byte2 = *p++;
 
+            /* ~R~X~B and W carry the REX bits */
+            rex = (uint8_t)(((~vex_byte1 >> 5) & 0x07) | ((vex_byte2 & 0x80) >> 4));
+
             insn->vex_prefix = 2;  /* Mark as 3-byte VEX */
             insn->vex_m = vex_byte1 & 0x1F;               /* mmmmmm field (bits 4-0) */
             insn->vex_vvvv = (~(vex_byte2 >> 3)) & 0x0F;  /* Inverted vvvv (bits 6-3) */
@@ -902,13 +910,10 @@ int decode_x86_insn(const uint8_t *insn_ptr, x86_insn_t *insn) HOT_PATH
                 /* 0F map - implied 0F XX opcode */
                 insn->opcode2 = *p++;
                 insn->opcode = 0;
-            } else if (insn->vex_m == 0x02) {
-                /* 0F 38 map */
-                insn->opcode2 = *p++;  /* Store as opcode2 for now */
-                insn->opcode = 0;
-            } else if (insn->vex_m == 0x03) {
-                /* 0F 3A map */
-                insn->opcode2 = *p++;  /* Store as opcode2 for now */
+            } else if (insn->vex_m == 0x02 || insn->vex_m == 0x03) {
+                /* 0F 38 / 0F 3A maps: same layout as the legacy three-byte escapes */
+                insn->opcode2 = insn->vex_m == 0x02 ? 0x38 : 0x3A;
+                insn->opcode3 = *p++;
                 insn->opcode = 0;
             } else {
                 /* Other maps */
@@ -917,7 +922,8 @@ int decode_x86_insn(const uint8_t *insn_ptr, x86_insn_t *insn) HOT_PATH
         }
 
         /* Mark as VEX instruction */
-        insn->rex |= 0x80;
+        insn->rex = rex | 0x80;
+        insn->is_64bit = (rex & 0x08) ? 1 : 0;
     } else {
         /* Not a VEX instruction - normal opcode processing */
 
@@ -948,7 +954,6 @@ int decode_x86_insn(const uint8_t *insn_ptr, x86_insn_t *insn) HOT_PATH
     /* Determine if has ModR/M using O(1) lookup table */
     uint8_t op = insn->opcode;
     uint8_t op2 = insn->opcode2;
-    uint8_t op3 = insn->opcode3;
     int has_modrm = 0;
 
     /* Use lookup tables for O(1) ModR/M detection */
@@ -973,13 +978,14 @@ int decode_x86_insn(const uint8_t *insn_ptr, x86_insn_t *insn) HOT_PATH
 
         /* Handle SIB */
         if (insn->mod != 3 && (insn->rm & 7) == 4) {
-            p++;
+            insn->sib = *p++;
         }
 
         /* Handle displacement - optimized with reduced branching */
         uint8_t mod_val = insn->mod;
         if (mod_val == 0) {
-            if ((insn->rm & 7) == 5) {
+            /* RIP-relative, or a SIB byte with no base */
+            if ((insn->rm & 7) == 5 || ((insn->rm & 7) == 4 && (insn->sib & 7) == 5)) {
                 insn->disp = *(const int32_t *)p;
                 p += 4;
             }
@@ -994,10 +1000,13 @@ int decode_x86_insn(const uint8_t *insn_ptr, x86_insn_t *insn) HOT_PATH
 
     /* Parse immediate with optimized lookup */
     if (op >= 0xB8 && op <= 0xBF) {
-        /* MOV r64, imm64/imm32 */
+        /* MOV r64, imm64/imm32 (imm16 with 66) */
         if (rex & 0x08) {
             insn->imm = *(const int64_t *)p;
             p += 8;
+        } else if (insn->simd_prefix == 0x66) {
+            insn->imm = *(const int16_t *)p;
+            p += 2;
         } else {
             insn->imm = *(const int32_t *)p;
             p += 4;
@@ -1060,6 +1069,19 @@ int decode_x86_insn(const uint8_t *insn_ptr, x86_insn_t *insn) HOT_PATH
             insn->imm = *(const int32_t *)p;
             p += 4;
         }
+    } else if (op == 0xC6) {
+        /* MOV r/m8, imm8 */
+        insn->imm = *(const int8_t *)p;
+        p += 1;
+    } else if (op == 0xC7) {
+        /* MOV r/m, imm32 (sign-extended with REX.W), imm16 with 66 */
+        if (insn->simd_prefix == 0x66 && !(rex & 0x08)) {
+            insn->imm = *(const int16_t *)p;
+            p += 2;
+        } else {
+            insn->imm = *(const int32_t *)p;
+            p += 4;
+        }
     } else if (op >= 0xB0 && op <= 0xB7) {
         /* MOV r8, imm8 - 8-bit immediate move */
         if (!(rex & 0x08)) {  /* Not 64-bit move */
@@ -1090,7 +1112,7 @@ int decode_x86_insn(const uint8_t *insn_ptr, x86_insn_t *insn) HOT_PATH
         /* BT/BTS/BTR/BTC with immediate */
         insn->imm = *(const int8_t *)p;
         p += 1;
-    } else if (op3 != 0) {
+    } else if (op2 == 0x38 || op2 == 0x3A) {
         /* Three-byte escape instructions (0F 38 or 0F 3A) */
         /* Many of these have immediates */
         if (op2 == 0x3A) {
@@ -1107,6 +1129,10 @@ int decode_x86_insn(const uint8_t *insn_ptr, x86_insn_t *insn) HOT_PATH
         /* PSHUFD/PSHUFHW/PSHUFLW with immediate */
         insn->imm = *(const int8_t *)p;
         p += 1;
+    } else if (op2 >= 0x71 && op2 <= 0x73) {
+        /* PSRLW/PSRAW/PSLLW/.../PSRLDQ/PSLLDQ shift groups with immediate */
+        insn->imm = *(const int8_t *)p;
+        p += 1;
     } else if (op2 == 0xC5) {
         /* PEXTRW with immediate */
         insn->imm = *(const int8_t *)p;
@@ -37,6 +37,8 @@ typedef struct {
     int has_modrm;          /* Has ModR/M byte */
     int is_64bit;           /* 64-bit operand size */
     int has_lock;           /* LOCK prefix present */
+    uint8_t has_opsize;     /* 0x66 seen, even if a later F2/F3 took simd_prefix */
+    uint8_t has_addrsize;   /* 0x67: 32-bit addresses, ECX as the REP count */
 
     /* VEX prefix fields (for AVX instructions) */
     uint8_t vex_prefix;     /* VEX prefix type: 0=none, 1=C5 (2-byte), 2=C4 (3-byte) */
@@ -45,6 +47,7 @@ typedef struct {
     uint8_t vex_m;          /* Opcode map (for C4 only) */
     uint8_t vex_w;          /* W bit (for C4 only) */
     uint8_t vex_vvvv;       /* VEX.vvvv register specifier (inverted) */
+    uint8_t sib;            /* SIB byte (0 if none) */
 } x86_insn_t;
 
 /* ============================================================================
@@ -147,6 +150,8 @@ static inline int x86_is_shrd(const x86_insn_t *i);
 static inline int x86_is_cwd(const x86_insn_t *i);
 static inline int x86_is_cqo(const x86_insn_t *i);
 static inline int x86_is_cli(const x86_insn_t *i);
+static inline int x86_is_cld(const x86_insn_t *i);
+static inline int x86_is_std(const x86_insn_t *i);
 static inline int x86_is_sti(const x86_insn_t *i);
 static inline int x86_is_cli_sti(const x86_insn_t *i);
 
@@ -463,6 +468,14 @@ static inline int x86_is_nop(const x86_insn_t *i) {
 static inline int x86_is_hlt(const x86_insn_t *i) {
     return i->opcode == 0xF4;
 }
+static inline int x86_is_syscall(const x86_insn_t *i) {
+    /* SYSCALL (0F 05) */
+    return i->opcode == 0x0F && i->opcode2 == 0x05;
+}
+static inline int x86_is_x87(const x86_insn_t *i) {
+    /* x87 escape opcodes (D8-DF) */
+    return i->opcode >= 0xD8 && i->opcode <= 0xDF && i->opcode2 == 0;
+}
 
 /* P1 - Control flow instructions */
 static inline int x86_is_cmov(const x86_insn_t *i) {
@@ -549,6 +562,12 @@ static inline int x86_is_cqo(const x86_insn_t *i) {
 static inline int x86_is_cli(const x86_insn_t *i) {
     return i->opcode == 0xFA;
 }
+static inline int x86_is_cld(const x86_insn_t *i) {
+    return i->opcode == 0xFC;
+}
+static inline int x86_is_std(const x86_insn_t *i) {
+    return i->opcode == 0xFD;
+}
 static inline int x86_is_sti(const x86_insn_t *i) {
     return i->opcode == 0xFB;
 }
@@ -805,12 +824,18 @@ static inline int x86_is_rcpss(const x86_insn_t *i) {
     return i->opcode2 == 0x53 && i->simd_prefix == 0xF3;
 }
 
-/* MXCSR control */
+/* MXCSR control: 0F AE /2 and /3 (and VEX.LZ.0F AE), memory forms only */
+static inline int x86_is_mxcsr_op(const x86_insn_t *i, int digit) {
+    int legacy = !i->vex_prefix && i->simd_prefix == 0;
+    int vex = i->vex_prefix && i->vex_m == 0x01 && i->vex_pp == 0 && i->vex_L == 0;
+    return i->opcode == 0 && i->opcode2 == 0xAE && (legacy || vex) && i->has_modrm && i->mod != 3 &&
+           ((i->modrm >> 3) & 7) == digit;
+}
 static inline int x86_is_ldmxcsr(const x86_insn_t *i) {
-    return i->opcode2 == 0xAE && i->modrm == 0x1A;
+    return x86_is_mxcsr_op(i, 2);
 }
 static inline int x86_is_stmxcsr(const x86_insn_t *i) {
-    return i->opcode2 == 0xAE && i->modrm == 0x1E;
+    return x86_is_mxcsr_op(i, 3);
 }
 
 /* Integer SIMD instructions */
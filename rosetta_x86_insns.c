@@ -63,7 +63,8 @@ int decode_x86_insn(const uint8_t *insn_ptr, x86_insn_t *insn)
         op == 0xC0 || op == 0xC1 ||
         op == 0xD0 || op == 0xD1 || op == 0xD2 || op == 0xD3 ||
         op == 0xF6 || op == 0xF7 ||
-        op == 0x80 || op == 0x81 || op == 0x82 || op == 0x83) {
+        op == 0x80 || op == 0x81 || op == 0x82 || op == 0x83 ||
+        (op >= 0xD8 && op <= 0xDF)) {
         has_modrm = 1;
     }
     if (op2 != 0 && (
@@ -92,11 +93,12 @@ int decode_x86_insn(const uint8_t *insn_ptr, x86_insn_t *insn)
 
         /* Handle SIB */
         if (insn->mod != 3 && (insn->rm & 7) == 4) {
-            p++;
+            insn->sib = *p++;
         }
 
         /* Handle displacement */
-        if (insn->mod == 0 && (insn->rm & 7) == 5) {
+        if (insn->mod == 0 &&
+            ((insn->rm & 7) == 5 || ((insn->rm & 7) == 4 && (insn->sib & 7) == 5))) {
             insn->disp = *(const int32_t *)p;
             p += 4;
         } else if (insn->mod == 1) {
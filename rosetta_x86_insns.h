@@ -15,9 +15,11 @@
  * x86 Instruction Structure
  * ============================================================================ */
 
+/* Same layout as x86_insn_t in rosetta_x86_decode.h, which either decoder may fill */
 typedef struct {
     uint8_t opcode;         /* Primary opcode byte */
     uint8_t opcode2;        /* Secondary opcode (for 0F xx) */
+    uint8_t opcode3;        /* Tertiary opcode (for 0F 38/3A xx) */
     uint8_t rex;            /* REX prefix (0 if none) */
     uint8_t modrm;          /* ModR/M byte (0 if none) */
     int32_t disp;           /* Displacement */
@@ -28,8 +30,19 @@ typedef struct {
     uint8_t mod;            /* ModR/M mod field */
     uint8_t reg;            /* ModR/M reg field */
     uint8_t rm;             /* ModR/M rm field */
+    uint8_t simd_prefix;    /* SIMD prefix: 0x66, 0xF2, 0xF3 */
     int has_modrm;          /* Has ModR/M byte */
     int is_64bit;           /* 64-bit operand size */
+    int has_lock;           /* LOCK prefix present */
+
+    /* VEX prefix fields (for AVX instructions) */
+    uint8_t vex_prefix;     /* VEX prefix type: 0=none, 1=C5 (2-byte), 2=C4 (3-byte) */
+    uint8_t vex_L;          /* Vector length: 0=128-bit, 1=256-bit */
+    uint8_t vex_pp;         /* SIMD prefix: 0=none, 1=0x66, 2=0xF3, 3=0xF2 */
+    uint8_t vex_m;          /* Opcode map (for C4 only) */
+    uint8_t vex_w;          /* W bit (for C4 only) */
+    uint8_t vex_vvvv;       /* VEX.vvvv register specifier */
+    uint8_t sib;            /* SIB byte (0 if none) */
 } x86_insn_t;
 
 /* ============================================================================
@@ -390,6 +403,16 @@ static inline int x86_is_rdtsc(const x86_insn_t *i)
     return i->opcode == 0x0F && i->opcode2 == 0x31;
 }
 
+static inline int x86_is_syscall(const x86_insn_t *i)
+{
+    return i->opcode == 0x0F && i->opcode2 == 0x05;
+}
+
+static inline int x86_is_x87(const x86_insn_t *i)
+{
+    return i->opcode >= 0xD8 && i->opcode <= 0xDF && i->opcode2 == 0;
+}
+
 static inline int x86_is_cqo(const x86_insn_t *i)
 {
     return i->opcode == 0x48 && i->opcode2 == 0x99;
@@ -0,0 +1,1770 @@
+/* ============================================================================
+ * Rosetta x87 FPU Emulation
+ * ============================================================================
+ *
+ * 80-bit extended precision softfloat and a one-instruction executor for
+ * the x87 (D8-DF) opcodes. Translated code calls rosetta_x87_exec() for
+ * every x87 instruction in accurate mode, and in fast mode for the ones
+ * it does not lower inline (transcendentals, environment and BCD forms).
+ * ============================================================================ */
+
+#include "rosetta_x87.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef rosetta_x87_f80_t f80_t;
+typedef unsigned __int128 u128;
+
+#define F80_INT         0x8000000000000000ull   /* Explicit integer bit */
+#define F80_QUIET       0x4000000000000000ull
+#define F80_BIAS        16383
+#define F80_EMAX        0x7FFF
+
+#define RC_NEAREST      0
+#define RC_DOWN         1
+#define RC_UP           2
+#define RC_ZERO         3
+
+static const f80_t f80_indefinite = { 0xC000000000000000ull, 0xFFFF };
+
+/* ============================================================================
+ * Mode
+ * ============================================================================ */
+
+static int g_x87_mode = -1;
+
+void rosetta_x87_set_mode(rosetta_x87_mode_t mode)
+{
+    g_x87_mode = (int)mode;
+}
+
+rosetta_x87_mode_t rosetta_x87_mode(void)
+{
+    if (g_x87_mode < 0) {
+        const char *env = getenv(ROSETTA_X87_ENV);
+        g_x87_mode = (env != NULL && strcmp(env, "accurate") == 0) ? ROSETTA_X87_ACCURATE
+                                                                   : ROSETTA_X87_FAST;
+    }
+    return (rosetta_x87_mode_t)g_x87_mode;
+}
+
+void rosetta_x87_reset(x86_context_t *guest)
+{
+    guest->fpu_cw = X87_CW_DEFAULT;
+    guest->fpu_sw = 0;
+    guest->fpu_cc = 0;
+    guest->fpu_tag = 0;
+    guest->fpu_top = 0;
+}
+
+/* ============================================================================
+ * Classification and Packing
+ * ============================================================================ */
+
+static f80_t f80_pack(int sign, int32_t exp, uint64_t mant)
+{
+    f80_t r = { mant, (uint16_t)((sign ? 0x8000 : 0) | (exp & 0x7FFF)) };
+    return r;
+}
+
+static int f80_sign(f80_t a)
+{
+    return a.sexp >> 15;
+}
+
+static int32_t f80_exp(f80_t a)
+{
+    return a.sexp & 0x7FFF;
+}
+
+/* Pseudo-NaNs, pseudo-infinities and unnormals: invalid operands since the 387 */
+static int f80_unsupported(f80_t a)
+{
+    return f80_exp(a) != 0 && !(a.mant & F80_INT);
+}
+
+static int f80_is_nan(f80_t a)
+{
+    return f80_exp(a) == F80_EMAX && (a.mant & F80_INT) && (a.mant << 1) != 0;
+}
+
+static int f80_is_snan(f80_t a)
+{
+    return f80_is_nan(a) && !(a.mant & F80_QUIET);
+}
+
+static int f80_is_inf(f80_t a)
+{
+    return f80_exp(a) == F80_EMAX && a.mant == F80_INT;
+}
+
+static int f80_is_zero(f80_t a)
+{
+    return f80_exp(a) == 0 && a.mant == 0;
+}
+
+/* Denormals and pseudo-denormals */
+static int f80_is_denormal(f80_t a)
+{
+    return f80_exp(a) == 0 && a.mant != 0;
+}
+
+/* Normalized significand and unbiased exponent of a finite non-zero value */
+static uint64_t f80_unpack(f80_t a, int32_t *e)
+{
+    int32_t exp = f80_exp(a) ? f80_exp(a) : 1;
+    int shift = __builtin_clzll(a.mant);
+
+    *e = exp - F80_BIAS - shift;
+    return a.mant << shift;
+}
+
+static int f80_rc(uint16_t cw)
+{
+    return (cw >> X87_CW_RC_SHIFT) & 3;
+}
+
+/* Significand bits under the precision control */
+static int f80_precision(uint16_t cw)
+{
+    static const int bits[4] = { 24, 64, 53, 64 };
+    return bits[(cw >> X87_CW_PC_SHIFT) & 3];
+}
+
+static u128 jam128(u128 v, int32_t n)
+{
+    if (n <= 0) {
+        return v;
+    }
+    if (n >= 128) {
+        return v != 0;
+    }
+    return (v >> n) | ((v & (((u128)1 << n) - 1)) != 0);
+}
+
+/* ============================================================================
+ * Rounding
+ * ============================================================================ */
+
+/* Whether rounding adds one at the last kept bit */
+static int round_up(int rc, int sign, u128 rest, u128 half, int lsb)
+{
+    switch (rc) {
+    case RC_NEAREST: return rest > half || (rest == half && lsb);
+    case RC_DOWN:    return sign && rest != 0;
+    case RC_UP:      return !sign && rest != 0;
+    default:         return 0;
+    }
+}
+
+/*
+ * Round (v / 2^127) * 2^*e, v normalized, to a p-bit significand; values
+ * below 2^emin are denormalized first. Returns the significand, integer
+ * bit at p - 1 unless the result is denormal, and updates *e. Overflow is
+ * left to the caller; underflow and precision are raised here, with
+ * tininess detected after rounding as on x86.
+ */
+static uint64_t round_sig(int sign, int32_t *e, u128 v, int p, int32_t emin, int rc, uint16_t *sw)
+{
+    int sh = 128 - p;
+    u128 mask = ((u128)1 << sh) - 1, half = (u128)1 << (sh - 1);
+    int tiny = 0;
+    uint64_t m;
+    u128 rest;
+    int inc;
+
+    if (*e < emin) {
+        tiny = 1;
+        if (*e == emin - 1) {
+            /* Not tiny if rounding at unbounded exponent reaches 2^emin */
+            u128 r0 = v & mask;
+            uint64_t m0 = (uint64_t)(v >> sh);
+            if (round_up(rc, sign, r0, half, (int)(m0 & 1)) && ((u128)m0 + 1) >> p) {
+                tiny = 0;
+            }
+        }
+        v = jam128(v, emin - *e);
+        *e = emin;
+    }
+    rest = v & mask;
+    m = (uint64_t)(v >> sh);
+    inc = round_up(rc, sign, rest, half, (int)(m & 1));
+    if (inc) {
+        m++;
+        if (p == 64 ? m == 0 : (m >> p) != 0) {
+            m = (uint64_t)1 << (p - 1);
+            (*e)++;
+        }
+        *sw |= X87_SW_C1;
+    }
+    if (rest) {
+        *sw |= X87_SW_PE | (tiny ? X87_SW_UE : 0);
+    }
+    return m;
+}
+
+/* Overflowed result: infinity, or the largest finite value when rounding toward zero */
+static int overflow_to_inf(int rc, int sign)
+{
+    return rc == RC_NEAREST || (rc == RC_UP && !sign) || (rc == RC_DOWN && sign);
+}
+
+/* Round and pack (v / 2^127) * 2^e under the precision and rounding control */
+static f80_t f80_round_pack(int sign, int32_t e, u128 v, uint16_t cw, uint16_t *sw)
+{
+    int p = f80_precision(cw), rc = f80_rc(cw);
+    uint64_t m;
+
+    if (v == 0) {
+        return f80_pack(sign, 0, 0);
+    }
+    m = round_sig(sign, &e, v, p, 1 - F80_BIAS, rc, sw);
+    if (e > F80_BIAS) {
+        *sw |= X87_SW_OE | X87_SW_PE;
+        *sw &= (uint16_t)~X87_SW_C1;
+        if (overflow_to_inf(rc, sign)) {
+            *sw |= X87_SW_C1;
+            return f80_pack(sign, F80_EMAX, F80_INT);
+        }
+        return f80_pack(sign, F80_EMAX - 1, ~0ull << (64 - p));
+    }
+    m <<= 64 - p;
+    return f80_pack(sign, (m & F80_INT) ? e + F80_BIAS : 0, m);
+}
+
+/* ============================================================================
+ * Special Operands
+ * ============================================================================ */
+
+/* NaN result of a two-operand instruction: the larger significand, quietened */
+static f80_t f80_propagate_nan(f80_t a, f80_t b, uint16_t *sw)
+{
+    int na = f80_is_nan(a), nb = f80_is_nan(b);
+    int sa = f80_is_snan(a), sb = f80_is_snan(b);
+    uint64_t qa = a.mant | F80_QUIET, qb = b.mant | F80_QUIET;
+
+    if (sa || sb) {
+        *sw |= X87_SW_IE;
+    }
+    a.mant = qa;
+    b.mant = qb;
+    if (!nb) {
+        return a;
+    }
+    if (!na) {
+        return b;
+    }
+    if (sa != sb) {
+        return sa ? b : a;                      /* Quiet NaN over signalling */
+    }
+    if (qa != qb) {
+        return qa > qb ? a : b;
+    }
+    return a.sexp <= b.sexp ? a : b;
+}
+
+/* Invalid, NaN and denormal operands; returns 1 with *r set if the operation is decided */
+static int f80_special2(f80_t a, f80_t b, f80_t *r, uint16_t *sw)
+{
+    if (f80_unsupported(a) || f80_unsupported(b)) {
+        *sw |= X87_SW_IE;
+        *r = f80_indefinite;
+        return 1;
+    }
+    if (f80_is_nan(a) || f80_is_nan(b)) {
+        *r = f80_propagate_nan(a, b, sw);
+        return 1;
+    }
+    if (f80_is_denormal(a) || f80_is_denormal(b)) {
+        *sw |= X87_SW_DE;
+    }
+    return 0;
+}
+
+/* ============================================================================
+ * Arithmetic
+ * ============================================================================ */
+
+static f80_t f80_addsub(f80_t a, f80_t b, int negate_b, uint16_t cw, uint16_t *sw)
+{
+    int sa = f80_sign(a), sb = f80_sign(b) ^ negate_b, rc = f80_rc(cw);
+    int32_t ea, eb;
+    uint64_t ma, mb;
+    u128 va, vb, v;
+    f80_t r;
+
+    if (f80_special2(a, b, &r, sw)) {
+        return r;
+    }
+    if (f80_is_inf(a) || f80_is_inf(b)) {
+        if (f80_is_inf(a) && f80_is_inf(b) && sa != sb) {
+            *sw |= X87_SW_IE;
+            return f80_indefinite;
+        }
+        return f80_is_inf(a) ? f80_pack(sa, F80_EMAX, F80_INT) : f80_pack(sb, F80_EMAX, F80_INT);
+    }
+    if (f80_is_zero(a) && f80_is_zero(b)) {
+        return f80_pack(sa == sb ? sa : rc == RC_DOWN, 0, 0);
+    }
+    if (f80_is_zero(b) || f80_is_zero(a)) {
+        /* x + 0 still rounds to the precision control */
+        int s = f80_is_zero(b) ? sa : sb;
+        ma = f80_unpack(f80_is_zero(b) ? a : b, &ea);
+        return f80_round_pack(s, ea, (u128)ma << 64, cw, sw);
+    }
+
+    ma = f80_unpack(a, &ea);
+    mb = f80_unpack(b, &eb);
+    if (ea < eb || (ea == eb && ma < mb)) {
+        int32_t te = ea;
+        uint64_t tm = ma;
+        int ts = sa;
+        ea = eb; ma = mb; sa = sb;
+        eb = te; mb = tm; sb = ts;
+    }
+
+    /* Integer bit at 126, leaving room for the carry */
+    va = (u128)ma << 63;
+    vb = jam128((u128)mb << 63, ea - eb);
+    if (sa == sb) {
+        v = va + vb;
+    } else {
+        v = va - vb;
+        if (v == 0) {
+            return f80_pack(rc == RC_DOWN, 0, 0);
+        }
+    }
+    if (v >> 127) {
+        ea++;
+    } else {
+        int lz = (uint64_t)(v >> 64) ? __builtin_clzll((uint64_t)(v >> 64))
+                                     : 64 + __builtin_clzll((uint64_t)v);
+        v <<= lz;
+        ea -= lz - 1;
+    }
+    return f80_round_pack(sa, ea, v, cw, sw);
+}
+
+rosetta_x87_f80_t rosetta_x87_f80_add(rosetta_x87_f80_t a, rosetta_x87_f80_t b, uint16_t cw, uint16_t *sw)
+{
+    return f80_addsub(a, b, 0, cw, sw);
+}
+
+rosetta_x87_f80_t rosetta_x87_f80_sub(rosetta_x87_f80_t a, rosetta_x87_f80_t b, uint16_t cw, uint16_t *sw)
+{
+    return f80_addsub(a, b, 1, cw, sw);
+}
+
+rosetta_x87_f80_t rosetta_x87_f80_mul(rosetta_x87_f80_t a, rosetta_x87_f80_t b, uint16_t cw, uint16_t *sw)
+{
+    int sign = f80_sign(a) ^ f80_sign(b);
+    int32_t ea, eb;
+    uint64_t ma, mb;
+    u128 v;
+    f80_t r;
+
+    if (f80_special2(a, b, &r, sw)) {
+        return r;
+    }
+    if (f80_is_inf(a) || f80_is_inf(b)) {
+        if (f80_is_zero(a) || f80_is_zero(b)) {
+            *sw |= X87_SW_IE;
+            return f80_indefinite;
+        }
+        return f80_pack(sign, F80_EMAX, F80_INT);
+    }
+    if (f80_is_zero(a) || f80_is_zero(b)) {
+        return f80_pack(sign, 0, 0);
+    }
+    ma = f80_unpack(a, &ea);
+    mb = f80_unpack(b, &eb);
+    v = (u128)ma * mb;
+    if (v >> 127) {
+        return f80_round_pack(sign, ea + eb + 1, v, cw, sw);
+    }
+    return f80_round_pack(sign, ea + eb, v << 1, cw, sw);
+}
+
+rosetta_x87_f80_t rosetta_x87_f80_div(rosetta_x87_f80_t a, rosetta_x87_f80_t b, uint16_t cw, uint16_t *sw)
+{
+    int sign = f80_sign(a) ^ f80_sign(b);
+    int32_t ea, eb, e;
+    uint64_t ma, mb, q, q2;
+    u128 n, rem;
+    f80_t r;
+
+    if (f80_is_zero(b) && !f80_is_zero(a) && f80_exp(a) != F80_EMAX && !f80_unsupported(a)) {
+        *sw |= X87_SW_ZE;                       /* Finite / 0 reports no denormal operand */
+        return f80_pack(sign, F80_EMAX, F80_INT);
+    }
+    if (f80_special2(a, b, &r, sw)) {
+        return r;
+    }
+    if (f80_is_inf(a)) {
+        if (f80_is_inf(b)) {
+            *sw |= X87_SW_IE;
+            return f80_indefinite;
+        }
+        return f80_pack(sign, F80_EMAX, F80_INT);
+    }
+    if (f80_is_inf(b)) {
+        return f80_pack(sign, 0, 0);
+    }
+    if (f80_is_zero(b)) {
+        if (f80_is_zero(a)) {
+            *sw |= X87_SW_IE;
+            return f80_indefinite;
+        }
+        *sw |= X87_SW_ZE;
+        return f80_pack(sign, F80_EMAX, F80_INT);
+    }
+    if (f80_is_zero(a)) {
+        return f80_pack(sign, 0, 0);
+    }
+
+    ma = f80_unpack(a, &ea);
+    mb = f80_unpack(b, &eb);
+    e = ea - eb;
+    if (ma >= mb) {
+        n = (u128)ma << 63;
+    } else {
+        n = (u128)ma << 64;
+        e--;
+    }
+    q = (uint64_t)(n / mb);
+    rem = n % mb;
+    q2 = (uint64_t)((rem << 64) / mb);
+    rem = (rem << 64) % mb;
+    return f80_round_pack(sign, e, ((u128)q << 64) | q2 | (rem != 0), cw, sw);
+}
+
+/* floor(sqrt(n)) for n < 2^128 */
+static uint64_t isqrt128(u128 n)
+{
+    uint64_t r = (uint64_t)sqrt((double)n);
+    int i;
+
+    if (r == 0) {
+        r = 1;
+    }
+    for (i = 0; i < 3; i++) {
+        u128 q = n / r;
+        u128 s = ((u128)r + q) >> 1;
+        r = s > ~0ull ? ~0ull : (uint64_t)s;
+    }
+    while ((u128)r * r > n) {
+        r--;
+    }
+    while (r != ~0ull && (u128)(r + 1) * (r + 1) <= n) {
+        r++;
+    }
+    return r;
+}
+
+rosetta_x87_f80_t rosetta_x87_f80_sqrt(rosetta_x87_f80_t a, uint16_t cw, uint16_t *sw)
+{
+    int32_t e;
+    uint64_t m, root;
+    u128 n, rem;
+
+    if (f80_unsupported(a)) {
+        *sw |= X87_SW_IE;
+        return f80_indefinite;
+    }
+    if (f80_is_nan(a)) {
+        return f80_propagate_nan(a, a, sw);
+    }
+    if (f80_is_zero(a)) {
+        return a;
+    }
+    if (f80_sign(a)) {
+        *sw |= X87_SW_IE;
+        return f80_indefinite;
+    }
+    if (f80_is_inf(a)) {
+        return a;
+    }
+    if (f80_is_denormal(a)) {
+        *sw |= X87_SW_DE;
+    }
+
+    /* Radicand in [2^126, 2^128) so that the root has its top bit set */
+    m = f80_unpack(a, &e);
+    if (e & 1) {
+        n = (u128)m << 64;
+        e = (e - 1) / 2;
+    } else {
+        n = (u128)m << 63;
+        e = e / 2;
+    }
+    root = isqrt128(n);
+    rem = n - (u128)root * root;
+
+    /* sqrt(n) >= root + 1/2 exactly when rem > root; never equal */
+    return f80_round_pack(0, e, ((u128)root << 64) | (rem > root ? 1ull << 63 : 0) | (rem != 0),
+                          cw, sw);
+}
+
+rosetta_x87_f80_t rosetta_x87_f80_round_int(rosetta_x87_f80_t a, uint16_t cw, uint16_t *sw)
+{
+    int sign = f80_sign(a), rc = f80_rc(cw);
+    int32_t e;
+    uint64_t m, mask, rest, trunc;
+    int inc;
+
+    if (f80_unsupported(a)) {
+        *sw |= X87_SW_IE;
+        return f80_indefinite;
+    }
+    if (f80_is_nan(a)) {
+        return f80_propagate_nan(a, a, sw);
+    }
+    if (f80_is_zero(a) || f80_is_inf(a)) {
+        return a;
+    }
+    if (f80_is_denormal(a)) {
+        *sw |= X87_SW_DE;
+    }
+    m = f80_unpack(a, &e);
+    if (e >= 63) {
+        return a;
+    }
+    if (e < 0) {
+        *sw |= X87_SW_PE;
+        inc = rc == RC_NEAREST ? (e == -1 && m > F80_INT) : round_up(rc, sign, 1, 1, 0);
+        if (!inc) {
+            return f80_pack(sign, 0, 0);
+        }
+        *sw |= X87_SW_C1;
+        return f80_pack(sign, F80_BIAS, F80_INT);
+    }
+    mask = (1ull << (63 - e)) - 1;
+    rest = m & mask;
+    if (rest == 0) {
+        return f80_pack(sign, e + F80_BIAS, m);
+    }
+    *sw |= X87_SW_PE;
+    trunc = m & ~mask;
+    inc = round_up(rc, sign, rest, (mask >> 1) + 1, (int)((m >> (63 - e)) & 1));
+    if (inc) {
+        trunc += mask + 1;
+        *sw |= X87_SW_C1;
+        if (trunc == 0) {
+            return f80_pack(sign, e + 1 + F80_BIAS, F80_INT);
+        }
+    }
+    return f80_pack(sign, e + F80_BIAS, trunc);
+}
+
+int rosetta_x87_f80_compare(rosetta_x87_f80_t a, rosetta_x87_f80_t b, int quiet, uint16_t *sw)
+{
+    int32_t ea, eb;
+    uint64_t ma, mb;
+    int sa = f80_sign(a), sb = f80_sign(b), lt;
+
+    if (f80_unsupported(a) || f80_unsupported(b)) {
+        *sw |= X87_SW_IE;
+        return X87_CMP_UN;
+    }
+    if (f80_is_nan(a) || f80_is_nan(b)) {
+        if (!quiet || f80_is_snan(a) || f80_is_snan(b)) {
+            *sw |= X87_SW_IE;
+        }
+        return X87_CMP_UN;
+    }
+    if (f80_is_denormal(a) || f80_is_denormal(b)) {
+        *sw |= X87_SW_DE;
+    }
+    if (f80_is_zero(a) && f80_is_zero(b)) {
+        return X87_CMP_EQ;
+    }
+    if (sa != sb) {
+        return sa ? X87_CMP_LT : X87_CMP_GT;
+    }
+
+    /* Same sign: order magnitudes, zero below everything */
+    if (f80_is_zero(a) || f80_is_zero(b)) {
+        lt = f80_is_zero(a);
+    } else if (f80_is_inf(a) || f80_is_inf(b)) {
+        if (f80_is_inf(a) && f80_is_inf(b)) {
+            return X87_CMP_EQ;
+        }
+        lt = f80_is_inf(b);
+    } else {
+        ma = f80_unpack(a, &ea);
+        mb = f80_unpack(b, &eb);
+        if (ea == eb && ma == mb) {
+            return X87_CMP_EQ;
+        }
+        lt = ea < eb || (ea == eb && ma < mb);
+    }
+    return lt != sa ? X87_CMP_LT : X87_CMP_GT;
+}
+
+/* ============================================================================
+ * Conversions
+ * ============================================================================ */
+
+/* Widen an IEEE binary format; signalling NaNs stay signalling unless quiet is set */
+static f80_t f80_from_ieee(uint64_t bits, int fbits, int ebits, int quiet, uint16_t *sw)
+{
+    int sign = (int)(bits >> (fbits + ebits));
+    int32_t emask = (1 << ebits) - 1, bias = emask >> 1;
+    int32_t exp = (int32_t)(bits >> fbits) & emask;
+    uint64_t frac = bits & ((1ull << fbits) - 1);
+    int shift;
+
+    if (exp == emask) {
+        if (frac == 0) {
+            return f80_pack(sign, F80_EMAX, F80_INT);
+        }
+        if (!(frac >> (fbits - 1)) && quiet) {
+            *sw |= X87_SW_IE;                   /* Signalling NaN */
+        }
+        return f80_pack(sign, F80_EMAX, F80_INT | (quiet ? F80_QUIET : 0) | (frac << (63 - fbits)));
+    }
+    if (exp == 0) {
+        if (frac == 0) {
+            return f80_pack(sign, 0, 0);
+        }
+        *sw |= X87_SW_DE;
+        shift = __builtin_clzll(frac);
+        return f80_pack(sign, 1 - bias + F80_BIAS - (shift - (63 - fbits)), frac << shift);
+    }
+    return f80_pack(sign, exp - bias + F80_BIAS, F80_INT | (frac << (63 - fbits)));
+}
+
+rosetta_x87_f80_t rosetta_x87_f80_from_f32(uint32_t bits, uint16_t *sw)
+{
+    return f80_from_ieee(bits, 23, 8, 1, sw);
+}
+
+rosetta_x87_f80_t rosetta_x87_f80_from_f64(uint64_t bits, uint16_t *sw)
+{
+    return f80_from_ieee(bits, 52, 11, 1, sw);
+}
+
+rosetta_x87_f80_t rosetta_x87_f80_from_i64(int64_t v)
+{
+    uint64_t m = v < 0 ? 0 - (uint64_t)v : (uint64_t)v;
+    int shift;
+
+    if (m == 0) {
+        return f80_pack(0, 0, 0);
+    }
+    shift = __builtin_clzll(m);
+    return f80_pack(v < 0, 63 - shift + F80_BIAS, m << shift);
+}
+
+/* Narrow to an IEEE binary format under the rounding control */
+static uint64_t f80_to_ieee(f80_t a, int fbits, int ebits, uint16_t cw, uint16_t *sw)
+{
+    int sign = f80_sign(a), rc = f80_rc(cw);
+    int32_t emask = (1 << ebits) - 1, bias = emask >> 1, e;
+    uint64_t s = (uint64_t)sign << (fbits + ebits), inf = (uint64_t)emask << fbits, m;
+
+    if (f80_unsupported(a)) {
+        *sw |= X87_SW_IE;
+        return (1ull << (fbits + ebits)) | inf | (1ull << (fbits - 1));
+    }
+    if (f80_is_nan(a)) {
+        if (f80_is_snan(a)) {
+            *sw |= X87_SW_IE;
+        }
+        return s | inf | (1ull << (fbits - 1)) | ((a.mant << 1) >> (64 - fbits));
+    }
+    if (f80_is_inf(a)) {
+        return s | inf;
+    }
+    if (f80_is_zero(a)) {
+        return s;
+    }
+    m = f80_unpack(a, &e);
+    m = round_sig(sign, &e, (u128)m << 64, fbits + 1, 1 - bias, rc, sw);
+    if (e > bias) {
+        *sw |= X87_SW_OE | X87_SW_PE;
+        *sw &= (uint16_t)~X87_SW_C1;
+        if (overflow_to_inf(rc, sign)) {
+            *sw |= X87_SW_C1;
+            return s | inf;
+        }
+        return s | (inf - 1);
+    }
+    if (!(m >> fbits)) {
+        return s | m;                           /* Denormal */
+    }
+    return s | ((uint64_t)(e + bias) << fbits) | (m & ((1ull << fbits) - 1));
+}
+
+uint32_t rosetta_x87_f80_to_f32(rosetta_x87_f80_t a, uint16_t cw, uint16_t *sw)
+{
+    return (uint32_t)f80_to_ieee(a, 23, 8, cw, sw);
+}
+
+uint64_t rosetta_x87_f80_to_f64(rosetta_x87_f80_t a, uint16_t cw, uint16_t *sw)
+{
+    return f80_to_ieee(a, 52, 11, cw, sw);
+}
+
+int64_t rosetta_x87_f80_to_int(rosetta_x87_f80_t a, int bits, int truncate, uint16_t cw, uint16_t *sw)
+{
+    int64_t indefinite = (int64_t)(~0ull << (bits - 1));
+    uint64_t limit = 1ull << (bits - 1), mag;
+    uint16_t rsw = 0;
+    int sign = f80_sign(a);
+    int32_t e;
+    f80_t r;
+
+    if (f80_unsupported(a) || f80_is_nan(a) || f80_is_inf(a)) {
+        *sw |= X87_SW_IE;
+        return indefinite;
+    }
+    if (f80_is_zero(a)) {
+        return 0;
+    }
+    r = rosetta_x87_f80_round_int(a, truncate ? (uint16_t)(cw | RC_ZERO << X87_CW_RC_SHIFT) : cw, &rsw);
+    if (f80_is_zero(r)) {
+        *sw |= rsw & (X87_SW_PE | X87_SW_C1);
+        return 0;
+    }
+    mag = f80_unpack(r, &e);
+    if (e > 63 || (mag >>= 63 - e) > limit - !sign) {
+        *sw |= X87_SW_IE;
+        return indefinite;
+    }
+    *sw |= rsw & (X87_SW_PE | X87_SW_C1);
+    return sign ? (int64_t)(0 - mag) : (int64_t)mag;
+}
+
+/* ============================================================================
+ * Host Long Double Bridge
+ * ============================================================================
+ *
+ * Transcendentals go through the host libm at long double precision: exact
+ * for 80-bit and binary128 long doubles, double precision on hosts (such as
+ * macOS) where long double is double.
+ * ============================================================================ */
+
+static long double f80_to_ld(f80_t a)
+{
+    int32_t e;
+    uint64_t m;
+    long double v;
+
+    if (f80_is_nan(a) || f80_unsupported(a)) {
+        return NAN;
+    }
+    if (f80_is_inf(a)) {
+        return f80_sign(a) ? -INFINITY : INFINITY;
+    }
+    if (f80_is_zero(a)) {
+        return f80_sign(a) ? -0.0L : 0.0L;
+    }
+    m = f80_unpack(a, &e);
+    v = ldexpl((long double)m, e - 63);
+    return f80_sign(a) ? -v : v;
+}
+
+static f80_t f80_from_ld(long double v, uint16_t cw, uint16_t *sw)
+{
+    long double frac, hi_part;
+    uint64_t hi, lo;
+    int e;
+
+    if (isnan(v)) {
+        return f80_indefinite;
+    }
+    if (isinf(v)) {
+        return f80_pack(v < 0, F80_EMAX, F80_INT);
+    }
+    if (v == 0) {
+        return f80_pack(signbit(v) != 0, 0, 0);
+    }
+    frac = frexpl(fabsl(v), &e);                /* [0.5, 1) */
+    hi_part = floorl(ldexpl(frac, 64));
+    hi = (uint64_t)hi_part;
+    lo = (uint64_t)ldexpl(ldexpl(frac, 64) - hi_part, 64);
+    return f80_round_pack(v < 0, e - 1, ((u128)hi << 64) | lo, cw, sw);
+}
+
+/* ============================================================================
+ * Register File
+ * ============================================================================ */
+
+typedef struct {
+    x86_context_t *g;
+    int fast;                       /* st[] holds doubles */
+    uint16_t cw;
+    uint16_t sw;                    /* Flags and C1 raised by this instruction */
+} x87_exec_t;
+
+static int x87_phys(const x87_exec_t *x, int i)
+{
+    return (x->g->fpu_top + i) & 7;
+}
+
+static int x87_empty(const x87_exec_t *x, int i)
+{
+    return !(x->g->fpu_tag & (1u << x87_phys(x, i)));
+}
+
+static f80_t x87_raw(const x87_exec_t *x, int phys)
+{
+    f80_t r;
+    uint16_t ignore = 0;
+
+    if (x->fast) {
+        return rosetta_x87_f80_from_f64(x->g->st[phys].u64[0], &ignore);
+    }
+    memcpy(&r.mant, &x->g->st[phys].u64[0], 8);
+    r.sexp = x->g->st[phys].u16[4];
+    return r;
+}
+
+static void x87_set_raw(x87_exec_t *x, int phys, f80_t v)
+{
+    uint16_t ignore = 0;
+
+    memset(&x->g->st[phys], 0, sizeof(x->g->st[phys]));
+    if (x->fast) {
+        x->g->st[phys].u64[0] = rosetta_x87_f80_to_f64(v, X87_CW_DEFAULT, &ignore);
+    } else {
+        x->g->st[phys].u64[0] = v.mant;
+        x->g->st[phys].u16[4] = v.sexp;
+    }
+    x->g->fpu_tag |= (uint8_t)(1u << phys);
+}
+
+/* ST(i); an empty register is a stack underflow and reads as the indefinite */
+static f80_t x87_get(x87_exec_t *x, int i)
+{
+    if (x87_empty(x, i)) {
+        x->sw |= X87_SW_IE | X87_SW_SF;
+        x->sw &= (uint16_t)~X87_SW_C1;
+        return f80_indefinite;
+    }
+    return x87_raw(x, x87_phys(x, i));
+}
+
+/* After a stack fault the destination gets the indefinite, whatever the operation made */
+static void x87_set(x87_exec_t *x, int i, f80_t v)
+{
+    x87_set_raw(x, x87_phys(x, i), (x->sw & X87_SW_SF) ? f80_indefinite : v);
+}
+
+/* Whether a push would overflow: ST(7) is in use */
+static int x87_push_faults(x87_exec_t *x)
+{
+    if (x87_empty(x, 7)) {
+        return 0;
+    }
+    if (!(x->sw & X87_SW_SF)) {
+        x->sw |= X87_SW_C1;
+    }
+    x->sw |= X87_SW_IE | X87_SW_SF;
+    return 1;
+}
+
+static void x87_push(x87_exec_t *x, f80_t v)
+{
+    x87_push_faults(x);
+    x->g->fpu_top = (uint8_t)((x->g->fpu_top - 1) & 7);
+    x87_set(x, 0, v);
+}
+
+static void x87_pop(x87_exec_t *x)
+{
+    x->g->fpu_tag &= (uint8_t)~(1u << x87_phys(x, 0));
+    x->g->fpu_top = (uint8_t)((x->g->fpu_top + 1) & 7);
+}
+
+static void x87_set_cc(x87_exec_t *x, uint16_t cc)
+{
+    x->g->fpu_cc = (uint16_t)((x->g->fpu_cc & X87_SW_C1) | (cc & ~X87_SW_C1));
+}
+
+/* C3, C2, C0 of a compare */
+static void x87_compare_cc(x87_exec_t *x, int rel)
+{
+    static const uint16_t cc[4] = {
+        X87_SW_C0, X87_SW_C3, 0, X87_SW_C3 | X87_SW_C2 | X87_SW_C0
+    };
+    x87_set_cc(x, cc[rel]);
+}
+
+/* NZCV for FCOMI: ZF = Z, PF = V, CF = !C, with "less" as FCMP leaves it */
+static uint64_t x87_compare_nzcv(int rel)
+{
+    static const uint64_t nzcv[4] = { 0x8, 0x6, 0x2, 0x5 };
+    return nzcv[rel] << 28;
+}
+
+/* FCMOVcc conditions (DA: B, E, BE, U; DB: the negations) on host NZCV */
+static int x87_fcmov_cond(uint64_t nzcv, int negate, int cond)
+{
+    int z = (nzcv >> 30) & 1, cf = !((nzcv >> 29) & 1), pf = (nzcv >> 28) & 1;
+    int r;
+
+    switch (cond) {
+    case 0: r = cf; break;
+    case 1: r = z; break;
+    case 2: r = cf || z; break;
+    default: r = pf; break;
+    }
+    return negate ? !r : r;
+}
+
+/* ============================================================================
+ * Memory Operands
+ * ============================================================================ */
+
+static uint64_t mem_load(uint64_t addr, int size)
+{
+    uint64_t v = 0;
+    memcpy(&v, (const void *)(uintptr_t)addr, (size_t)size);
+    return v;
+}
+
+static void mem_store(uint64_t addr, uint64_t v, int size)
+{
+    memcpy((void *)(uintptr_t)addr, &v, (size_t)size);
+}
+
+static f80_t mem_load_f80(uint64_t addr)
+{
+    f80_t r;
+
+    r.mant = mem_load(addr, 8);
+    r.sexp = (uint16_t)mem_load(addr + 8, 2);
+    return r;
+}
+
+static void mem_store_f80(uint64_t addr, f80_t v)
+{
+    mem_store(addr, v.mant, 8);
+    mem_store(addr + 8, v.sexp, 2);
+}
+
+/* Two-bit tag of a non-empty register for the full tag word: valid, zero or special */
+static uint16_t x87_full_tag(f80_t v)
+{
+    if (f80_is_zero(v)) {
+        return 1;
+    }
+    if (f80_exp(v) == 0 || f80_exp(v) == F80_EMAX || f80_unsupported(v)) {
+        return 2;
+    }
+    return 0;
+}
+
+static uint16_t x87_status_word(const x87_exec_t *x)
+{
+    return (uint16_t)(x->g->fpu_sw | x->g->fpu_cc | (x->g->fpu_top << X87_SW_TOP_SHIFT));
+}
+
+/* FNSTENV in the 28-byte protected-mode format; returns its size */
+static int x87_store_env(x87_exec_t *x, uint64_t addr)
+{
+    uint16_t tag = 0;
+    int i;
+
+    for (i = 0; i < 8; i++) {
+        uint16_t t = (x->g->fpu_tag & (1u << i)) ? x87_full_tag(x87_raw(x, i)) : 3;
+        tag |= (uint16_t)(t << (2 * i));
+    }
+    mem_store(addr, 0xFFFF0000u | x->g->fpu_cw, 4);
+    mem_store(addr + 4, 0xFFFF0000u | x87_status_word(x), 4);
+    mem_store(addr + 8, 0xFFFF0000u | tag, 4);
+    mem_store(addr + 12, 0, 8);
+    mem_store(addr + 20, 0, 8);
+    return 28;
+}
+
+static int x87_load_env(x87_exec_t *x, uint64_t addr)
+{
+    uint16_t sw = (uint16_t)mem_load(addr + 4, 2), tag = (uint16_t)mem_load(addr + 8, 2);
+    int i;
+
+    x->g->fpu_cw = (uint16_t)mem_load(addr, 2);
+    x->g->fpu_sw = (uint16_t)(sw & ~(X87_SW_CC | 7u << X87_SW_TOP_SHIFT));
+    x->g->fpu_cc = (uint16_t)(sw & X87_SW_CC);
+    x->g->fpu_top = (uint8_t)((sw >> X87_SW_TOP_SHIFT) & 7);
+    x->g->fpu_tag = 0;
+    for (i = 0; i < 8; i++) {
+        if (((tag >> (2 * i)) & 3) != 3) {
+            x->g->fpu_tag |= (uint8_t)(1u << i);
+        }
+    }
+    return 28;
+}
+
+/* FBLD: 18 packed BCD digits and a sign byte */
+static f80_t x87_bcd_load(uint64_t addr)
+{
+    int64_t v = 0;
+    int i;
+
+    for (i = 8; i >= 0; i--) {
+        uint8_t b = (uint8_t)mem_load(addr + (uint64_t)i, 1);
+        v = v * 100 + (b >> 4) * 10 + (b & 15);
+    }
+    return rosetta_x87_f80_from_i64((mem_load(addr + 9, 1) & 0x80) ? -v : v);
+}
+
+static void x87_bcd_store(x87_exec_t *x, uint64_t addr, f80_t v)
+{
+    uint16_t sw = 0;
+    int64_t n = rosetta_x87_f80_to_int(v, 64, 0, x->cw, &sw);
+    uint64_t m = n < 0 ? 0 - (uint64_t)n : (uint64_t)n;
+    int i;
+
+    if ((sw & X87_SW_IE) || m > 999999999999999999ull) {
+        /* Packed BCD indefinite */
+        x->sw |= X87_SW_IE;
+        mem_store(addr, 0, 7);
+        mem_store(addr + 7, 0xFFFFC0, 3);
+        return;
+    }
+    x->sw |= sw;
+    for (i = 0; i < 9; i++) {
+        mem_store(addr + (uint64_t)i, (m % 10) | ((m / 10) % 10) << 4, 1);
+        m /= 100;
+    }
+    mem_store(addr + 9, n < 0 || (n == 0 && f80_sign(v)) ? 0x80 : 0, 1);
+}
+
+/* ============================================================================
+ * Transcendental and Partial Remainder
+ * ============================================================================ */
+
+/* Exact ST(0) rem ST(1), truncating (FPREM) or to nearest (FPREM1) */
+static void x87_prem(x87_exec_t *x, int nearest)
+{
+    f80_t a = x87_get(x, 0), b = x87_get(x, 1), r;
+    int32_t ea, eb, d;
+    uint64_t ma, mb, q = 0;
+    u128 rem;
+    int sign = f80_sign(a), partial = 0;
+
+    /* NaN and invalid operands clear C2 and keep C0 and C3 */
+    if (!f80_is_nan(a) && !f80_is_nan(b) && (f80_is_inf(a) || f80_is_zero(b) ||
+                                             f80_unsupported(a) || f80_unsupported(b))) {
+        x->sw |= X87_SW_IE;
+        x87_set(x, 0, f80_indefinite);
+        x87_set_cc(x, x->g->fpu_cc & (X87_SW_C0 | X87_SW_C3));
+        return;
+    }
+    if (f80_special2(a, b, &r, &x->sw)) {
+        x87_set(x, 0, r);
+        x87_set_cc(x, x->g->fpu_cc & (X87_SW_C0 | X87_SW_C3));
+        return;
+    }
+    if (f80_is_zero(a) || f80_is_inf(b)) {
+        if (f80_is_denormal(a) && (a.mant & F80_INT)) {
+            x87_set(x, 0, f80_pack(sign, 1, a.mant));     /* Pseudo-denormals come back normalized */
+        }
+        x87_set_cc(x, 0);
+        return;
+    }
+    ma = f80_unpack(a, &ea);
+    mb = f80_unpack(b, &eb);
+    d = ea - eb;
+    if (d >= 64) {
+        /* Partial remainder: a 32-63 bit quotient per step, leaving a multiple of 32 */
+        int n = 32 + (d & 31);
+        eb += d - n;
+        d = n;
+        partial = 1;
+        nearest = 0;
+    }
+    if (d < 0) {
+        rem = ma;
+        if (nearest && d == -1 && ma > mb) {
+            rem = ((u128)mb << 1) - ma;         /* |B| - |A|, at A's scale */
+            sign ^= 1;
+            q = 1;
+        }
+        eb = ea;
+    } else {
+        u128 num = (u128)ma << d;
+        q = (uint64_t)(num / mb);
+        rem = num % mb;
+        if (nearest && (rem << 1 > mb || (rem << 1 == mb && (q & 1)))) {
+            rem = mb - rem;
+            sign ^= 1;
+            q++;
+        }
+    }
+    if (rem == 0) {
+        r = f80_pack(f80_sign(a), 0, 0);
+    } else {
+        int lz = 64 + __builtin_clzll((uint64_t)rem);
+        r = f80_round_pack(sign, eb + 64 - lz, rem << lz,
+                           (uint16_t)(x->cw | 3u << X87_CW_PC_SHIFT), &x->sw);
+    }
+    x87_set(x, 0, r);
+    if (partial) {
+        x87_set_cc(x, X87_SW_C2);
+        return;
+    }
+    x87_set_cc(x, (uint16_t)(((q >> 2) & 1) ? X87_SW_C0 : 0) | (((q >> 1) & 1) ? X87_SW_C3 : 0));
+    if (q & 1) {
+        x->sw |= X87_SW_C1;
+    }
+}
+
+/* FSIN, FCOS, FPTAN and FSINCOS leave operands of 2^63 and up alone, with C2 set */
+static int x87_trig_range(x87_exec_t *x, f80_t a)
+{
+    x87_set_cc(x, 0);
+    if (!f80_is_nan(a) && !f80_is_inf(a) && !f80_unsupported(a) && f80_exp(a) >= F80_BIAS + 63) {
+        x87_set_cc(x, X87_SW_C2);
+        return 0;
+    }
+    return 1;
+}
+
+/* One-operand transcendental through libm; NaNs propagate, infinities are invalid */
+static int x87_unary_special(x87_exec_t *x, f80_t a, f80_t *r)
+{
+    if (f80_unsupported(a) || f80_is_inf(a)) {
+        x->sw |= X87_SW_IE;
+        *r = f80_indefinite;
+        return 1;
+    }
+    if (f80_is_nan(a)) {
+        *r = f80_propagate_nan(a, a, &x->sw);
+        return 1;
+    }
+    if (f80_is_denormal(a)) {
+        x->sw |= X87_SW_DE;
+    }
+    return 0;
+}
+
+static void x87_transcendental(x87_exec_t *x, int rm)
+{
+    f80_t a = x87_get(x, 0), b, r;
+    long double va = f80_to_ld(a), vb;
+
+    switch (rm) {
+    case 0:                                     /* F2XM1 */
+        if (!x87_unary_special(x, a, &r)) {
+            r = f80_is_zero(a) ? a : f80_from_ld(expm1l(va * 0.693147180559945309417232121458L),
+                                                 x->cw, &x->sw);
+            x->sw |= f80_is_zero(a) ? 0 : X87_SW_PE;
+        }
+        x87_set(x, 0, r);
+        break;
+    case 1:                                     /* FYL2X */
+    case 9:                                     /* FYL2XP1 */
+        b = x87_get(x, 1);
+        vb = f80_to_ld(b);
+        if (f80_special2(a, b, &r, &x->sw)) {
+            /* NaN or invalid */
+        } else if (rm == 1 && f80_sign(a) && !f80_is_zero(a)) {
+            x->sw |= X87_SW_IE;
+            r = f80_indefinite;
+        } else if (rm == 1 && f80_is_zero(a)) {
+            if (f80_is_zero(b)) {
+                x->sw |= X87_SW_IE;
+                r = f80_indefinite;
+            } else {
+                x->sw |= X87_SW_ZE;
+                r = f80_pack(!f80_sign(b), F80_EMAX, F80_INT);
+            }
+        } else {
+            long double l = rm == 1 ? log2l(va) : log1pl(va) / 0.693147180559945309417232121458L;
+            r = f80_from_ld(vb * l, x->cw, &x->sw);
+            x->sw |= X87_SW_PE;
+        }
+        x87_set(x, 1, r);
+        x87_pop(x);
+        break;
+    case 2:                                     /* FPTAN */
+        if (!x87_trig_range(x, a)) {
+            break;
+        }
+        if (!x87_unary_special(x, a, &r)) {
+            r = f80_is_zero(a) ? a : f80_from_ld(tanl(va), x->cw, &x->sw);
+            x->sw |= f80_is_zero(a) ? 0 : X87_SW_PE;
+        }
+        x87_set(x, 0, r);
+        x87_push(x, f80_pack(0, F80_BIAS, F80_INT));
+        break;
+    case 3:                                     /* FPATAN */
+        b = x87_get(x, 1);
+        if (!f80_special2(a, b, &r, &x->sw)) {
+            r = f80_from_ld(atan2l(f80_to_ld(b), va), x->cw, &x->sw);
+            x->sw |= f80_is_zero(b) && !f80_sign(a) ? 0 : X87_SW_PE;
+        }
+        x87_set(x, 1, r);
+        x87_pop(x);
+        break;
+    case 14:                                    /* FSIN */
+    case 15:                                    /* FCOS */
+        if (!x87_trig_range(x, a)) {
+            break;
+        }
+        if (!x87_unary_special(x, a, &r)) {
+            if (f80_is_zero(a)) {
+                r = rm == 14 ? a : f80_pack(0, F80_BIAS, F80_INT);
+            } else {
+                r = f80_from_ld(rm == 14 ? sinl(va) : cosl(va), x->cw, &x->sw);
+                x->sw |= X87_SW_PE;
+            }
+        }
+        x87_set(x, 0, r);
+        break;
+    case 11:                                    /* FSINCOS */
+        if (!x87_trig_range(x, a)) {
+            break;
+        }
+        if (!x87_unary_special(x, a, &r)) {
+            b = f80_is_zero(a) ? f80_pack(0, F80_BIAS, F80_INT) : f80_from_ld(cosl(va), x->cw, &x->sw);
+            r = f80_is_zero(a) ? a : f80_from_ld(sinl(va), x->cw, &x->sw);
+            x->sw |= f80_is_zero(a) ? 0 : X87_SW_PE;
+        } else {
+            b = r;
+        }
+        x87_set(x, 0, r);
+        x87_push(x, b);
+        break;
+    }
+}
+
+/* FSCALE: ST(0) * 2^trunc(ST(1)), exact but for the final rounding */
+static f80_t x87_scale(x87_exec_t *x, f80_t a, f80_t b)
+{
+    int64_t n;
+    int32_t e;
+    uint64_t m;
+    f80_t r;
+
+    if (f80_special2(a, b, &r, &x->sw)) {
+        return r;
+    }
+    if (f80_is_inf(b)) {
+        if ((f80_sign(b) && f80_is_inf(a)) || (!f80_sign(b) && f80_is_zero(a))) {
+            x->sw |= X87_SW_IE;
+            return f80_indefinite;
+        }
+        if (f80_is_zero(a) || f80_is_inf(a)) {
+            return a;
+        }
+        return f80_sign(b) ? f80_pack(f80_sign(a), 0, 0) : f80_pack(f80_sign(a), F80_EMAX, F80_INT);
+    }
+    if (f80_is_zero(a) || f80_is_inf(a)) {
+        return a;
+    }
+    {
+        uint16_t ignore = 0;
+        n = f80_exp(b) >= F80_BIAS + 20 ? (f80_sign(b) ? -100000 : 100000)
+                                        : rosetta_x87_f80_to_int(b, 64, 1, x->cw, &ignore);
+    }
+    m = f80_unpack(a, &e);
+    return f80_round_pack(f80_sign(a), (int32_t)(e + n), (u128)m << 64,
+                          (uint16_t)(x->cw | 3u << X87_CW_PC_SHIFT), &x->sw);
+}
+
+/* FXAM class in C3, C2, C0 and the sign in C1 */
+static void x87_examine(x87_exec_t *x)
+{
+    f80_t a = x87_raw(x, x87_phys(x, 0));
+    uint16_t cc;
+
+    if (x87_empty(x, 0)) {
+        cc = X87_SW_C3 | X87_SW_C0;
+    } else if (f80_unsupported(a)) {
+        cc = 0;
+    } else if (f80_is_nan(a)) {
+        cc = X87_SW_C0;
+    } else if (f80_is_inf(a)) {
+        cc = X87_SW_C2 | X87_SW_C0;
+    } else if (f80_is_zero(a)) {
+        cc = X87_SW_C3;
+    } else if (f80_is_denormal(a)) {
+        cc = X87_SW_C3 | X87_SW_C2;
+    } else {
+        cc = X87_SW_C2;
+    }
+    x87_set_cc(x, cc);
+    if (f80_sign(a)) {
+        x->sw |= X87_SW_C1;
+    }
+}
+
+/* ============================================================================
+ * Instruction Execution
+ * ============================================================================ */
+
+/* FLDL2T, FLDL2E, FLDPI, FLDLG2, FLDLN2 to 128 bits, rounded under the rounding control */
+static f80_t x87_constant(x87_exec_t *x, int rm)
+{
+    static const struct { uint64_t hi, lo; int32_t e; } k[5] = {
+        { 0xD49A784BCD1B8AFEull, 0x492BF6FF4DAFDB4Cull, 1 },
+        { 0xB8AA3B295C17F0BBull, 0xBE87FED0691D3E89ull, 0 },
+        { 0xC90FDAA22168C234ull, 0xC4C6628B80DC1CD1ull, 1 },
+        { 0x9A209A84FBCFF798ull, 0x8F8959AC0B7C9178ull, -2 },
+        { 0xB17217F7D1CF79ABull, 0xC9E3B39803F2F6AFull, -1 },
+    };
+    uint16_t ignore = 0;
+
+    if (rm == 0) {
+        return f80_pack(0, F80_BIAS, F80_INT);          /* FLD1 */
+    }
+    if (rm == 6) {
+        return f80_pack(0, 0, 0);                       /* FLDZ */
+    }
+    /* The constants are rounded to 64 bits whatever the precision control, without raising */
+    return f80_round_pack(0, k[rm - 1].e, ((u128)k[rm - 1].hi << 64) | k[rm - 1].lo,
+                          (uint16_t)(x->cw | 3u << X87_CW_PC_SHIFT), &ignore);
+}
+
+/* Arithmetic by the ModR/M reg field: dst = dst op src, or src op dst for the reversed forms */
+static f80_t x87_arith(x87_exec_t *x, int op, f80_t dst, f80_t src)
+{
+    switch (op) {
+    case 0: return rosetta_x87_f80_add(dst, src, x->cw, &x->sw);
+    case 1: return rosetta_x87_f80_mul(dst, src, x->cw, &x->sw);
+    case 4: return rosetta_x87_f80_sub(dst, src, x->cw, &x->sw);
+    case 5: return rosetta_x87_f80_sub(src, dst, x->cw, &x->sw);
+    case 6: return rosetta_x87_f80_div(dst, src, x->cw, &x->sw);
+    default: return rosetta_x87_f80_div(src, dst, x->cw, &x->sw);
+    }
+}
+
+/* D8, DA, DC, DE memory forms and D8 register forms: ST(0) = ST(0) op src */
+static void x87_arith_st0(x87_exec_t *x, int op, f80_t src)
+{
+    f80_t a = x87_get(x, 0);
+
+    if (op == 2 || op == 3) {
+        x87_compare_cc(x, rosetta_x87_f80_compare(a, src, 0, &x->sw));
+        if (op == 3) {
+            x87_pop(x);
+        }
+        return;
+    }
+    x87_set(x, 0, x87_arith(x, op, a, src));
+}
+
+static void x87_store_int(x87_exec_t *x, uint64_t addr, int bytes, int truncate, int pop)
+{
+    mem_store(addr, (uint64_t)rosetta_x87_f80_to_int(x87_get(x, 0), bytes * 8, truncate, x->cw, &x->sw),
+              bytes);
+    if (pop) {
+        x87_pop(x);
+    }
+}
+
+/*
+ * Memory operand of the D8, DA, DC and DE arithmetic forms; NaNs are resolved
+ * by the operation. As for registers, a denormal operand is not reported when
+ * ST(0) is a NaN or unsupported, nor when FDIVR divides it by zero.
+ */
+static f80_t x87_mem_operand(x87_exec_t *x, int opcode, int op, uint64_t addr)
+{
+    f80_t a = x87_get(x, 0);
+    uint16_t sw = 0;
+    f80_t v;
+
+    switch (opcode) {
+    case 0xD8:
+    case 0xDC:
+        v = opcode == 0xD8 ? f80_from_ieee(mem_load(addr, 4), 23, 8, 0, &sw)
+                           : f80_from_ieee(mem_load(addr, 8), 52, 11, 0, &sw);
+        if (!f80_is_nan(a) && !f80_unsupported(a) && !(op == 7 && f80_is_zero(a))) {
+            x->sw |= sw;
+        }
+        return v;
+    case 0xDA: return rosetta_x87_f80_from_i64((int32_t)mem_load(addr, 4));
+    default:   return rosetta_x87_f80_from_i64((int16_t)mem_load(addr, 2));
+    }
+}
+
+/* FLD, FILD and FBLD memory forms */
+static int x87_is_load(int opcode, int reg)
+{
+    switch (opcode) {
+    case 0xD9: case 0xDD: return reg == 0;
+    case 0xDB: return reg == 0 || reg == 5;
+    case 0xDF: return reg == 0 || reg == 4 || reg == 5;
+    default:   return 0;
+    }
+}
+
+static void x87_exec_mem(x87_exec_t *x, int opcode, int reg, uint64_t addr)
+{
+    uint16_t ignore = 0;
+    f80_t v;
+
+    /* Stack faults come first: the memory operand is not examined */
+    if (x87_is_load(opcode, reg) && x87_push_faults(x)) {
+        x87_push(x, f80_indefinite);
+        return;
+    }
+
+    switch (opcode) {
+    case 0xD8:
+    case 0xDA:
+    case 0xDC:
+    case 0xDE:
+        x87_arith_st0(x, reg, x87_empty(x, 0) ? f80_indefinite : x87_mem_operand(x, opcode, reg, addr));
+        break;
+    case 0xD9:
+        switch (reg) {
+        case 0:
+            x87_push(x, rosetta_x87_f80_from_f32((uint32_t)mem_load(addr, 4), &x->sw));
+            break;
+        case 2:
+        case 3:
+            mem_store(addr, rosetta_x87_f80_to_f32(x87_get(x, 0), x->cw, &x->sw), 4);
+            if (reg == 3) {
+                x87_pop(x);
+            }
+            break;
+        case 4:
+            x87_load_env(x, addr);
+            break;
+        case 5:
+            x->g->fpu_cw = (uint16_t)mem_load(addr, 2);
+            break;
+        case 6:
+            x87_store_env(x, addr);
+            break;
+        case 7:
+            mem_store(addr, x->g->fpu_cw, 2);
+            break;
+        }
+        break;
+    case 0xDB:
+        switch (reg) {
+        case 0:
+            x87_push(x, rosetta_x87_f80_from_i64((int32_t)mem_load(addr, 4)));
+            break;
+        case 1:
+        case 2:
+        case 3:
+            x87_store_int(x, addr, 4, reg == 1, reg != 2);
+            break;
+        case 5:
+            x87_push(x, mem_load_f80(addr));
+            break;
+        case 7:
+            mem_store_f80(addr, x87_get(x, 0));
+            x87_pop(x);
+            break;
+        }
+        break;
+    case 0xDD:
+        switch (reg) {
+        case 0:
+            x87_push(x, rosetta_x87_f80_from_f64(mem_load(addr, 8), &x->sw));
+            break;
+        case 1:
+            x87_store_int(x, addr, 8, 1, 1);
+            break;
+        case 2:
+        case 3:
+            mem_store(addr, rosetta_x87_f80_to_f64(x87_get(x, 0), x->cw, &x->sw), 8);
+            if (reg == 3) {
+                x87_pop(x);
+            }
+            break;
+        case 4: {
+            int i;
+            x87_load_env(x, addr);
+            for (i = 0; i < 8; i++) {
+                v = mem_load_f80(addr + 28 + (uint64_t)i * 10);
+                if (x->fast) {
+                    x->g->st[x87_phys(x, i)].u64[0] = rosetta_x87_f80_to_f64(v, X87_CW_DEFAULT, &ignore);
+                } else {
+                    x->g->st[x87_phys(x, i)].u64[0] = v.mant;
+                    x->g->st[x87_phys(x, i)].u16[4] = v.sexp;
+                }
+            }
+            break;
+        }
+        case 6: {
+            int i;
+            x87_store_env(x, addr);
+            for (i = 0; i < 8; i++) {
+                mem_store_f80(addr + 28 + (uint64_t)i * 10, x87_raw(x, x87_phys(x, i)));
+            }
+            rosetta_x87_reset(x->g);
+            x->sw = 0;
+            break;
+        }
+        case 7:
+            mem_store(addr, x87_status_word(x), 2);
+            break;
+        }
+        break;
+    case 0xDF:
+        switch (reg) {
+        case 0:
+            x87_push(x, rosetta_x87_f80_from_i64((int16_t)mem_load(addr, 2)));
+            break;
+        case 1:
+        case 2:
+        case 3:
+            x87_store_int(x, addr, 2, reg == 1, reg != 2);
+            break;
+        case 4:
+            x87_push(x, x87_bcd_load(addr));
+            break;
+        case 5:
+            x87_push(x, rosetta_x87_f80_from_i64((int64_t)mem_load(addr, 8)));
+            break;
+        case 6:
+            x87_bcd_store(x, addr, x87_get(x, 0));
+            x87_pop(x);
+            break;
+        case 7:
+            x87_store_int(x, addr, 8, 0, 1);
+            break;
+        }
+        break;
+    }
+}
+
+static void x87_exec_d9(x87_exec_t *x, int reg, int rm)
+{
+    f80_t a;
+
+    switch (reg) {
+    case 0:                                     /* FLD ST(i) */
+        a = x87_get(x, rm);
+        x87_push(x, a);
+        break;
+    case 1:                                 /* FXCH: an empty register swaps in as the indefinite */
+        a = x87_get(x, 0);
+        {
+            f80_t b = x87_get(x, rm);
+            x87_set_raw(x, x87_phys(x, 0), b);
+            x87_set_raw(x, x87_phys(x, rm), a);
+        }
+        break;
+    case 4:
+        switch (rm) {
+        case 0:                                 /* FCHS */
+            a = x87_get(x, 0);
+            a.sexp ^= 0x8000;
+            x87_set(x, 0, a);
+            break;
+        case 1:                                 /* FABS */
+            a = x87_get(x, 0);
+            a.sexp &= 0x7FFF;
+            x87_set(x, 0, a);
+            break;
+        case 4:                                 /* FTST */
+            a = x87_get(x, 0);
+            x87_compare_cc(x, rosetta_x87_f80_compare(a, f80_pack(0, 0, 0), 0, &x->sw));
+            break;
+        case 5:                                 /* FXAM */
+            x87_examine(x);
+            break;
+        }
+        break;
+    case 5:                                     /* FLD1 ... FLDZ */
+        if (rm != 7) {
+            x87_push(x, x87_constant(x, rm));
+        }
+        break;
+    case 6:
+        switch (rm) {
+        case 4:                                 /* FXTRACT */
+            a = x87_get(x, 0);
+            if (x87_push_faults(x)) {
+                x87_set(x, 0, a);
+                x87_push(x, a);
+            } else if (f80_is_zero(a)) {
+                x->sw |= X87_SW_ZE;
+                x87_set(x, 0, f80_pack(1, F80_EMAX, F80_INT));
+                x87_push(x, a);
+            } else if (f80_is_inf(a)) {
+                x87_set(x, 0, f80_pack(0, F80_EMAX, F80_INT));
+                x87_push(x, a);
+            } else if (x87_unary_special(x, a, &a)) {
+                x87_set(x, 0, a);
+                x87_push(x, a);
+            } else {
+                int32_t e;
+                uint64_t m = f80_unpack(a, &e);
+                x87_set(x, 0, rosetta_x87_f80_from_i64(e));
+                x87_push(x, f80_pack(f80_sign(a), F80_BIAS, m));
+            }
+            break;
+        case 5:                                 /* FPREM1 */
+            x87_prem(x, 1);
+            break;
+        case 6:                                 /* FDECSTP */
+            x->g->fpu_top = (uint8_t)((x->g->fpu_top - 1) & 7);
+            break;
+        case 7:                                 /* FINCSTP */
+            x->g->fpu_top = (uint8_t)((x->g->fpu_top + 1) & 7);
+            break;
+        default:
+            x87_transcendental(x, rm);
+            break;
+        }
+        break;
+    case 7:
+        switch (rm) {
+        case 0:                                 /* FPREM */
+            x87_prem(x, 0);
+            break;
+        case 2:                                 /* FSQRT */
+            x87_set(x, 0, rosetta_x87_f80_sqrt(x87_get(x, 0), x->cw, &x->sw));
+            break;
+        case 4:                                 /* FRNDINT */
+            x87_set(x, 0, rosetta_x87_f80_round_int(x87_get(x, 0), x->cw, &x->sw));
+            break;
+        case 5:                                 /* FSCALE */
+            a = x87_get(x, 0);
+            x87_set(x, 0, x87_scale(x, a, x87_get(x, 1)));
+            break;
+        default:
+            x87_transcendental(x, 8 + rm);
+            break;
+        }
+        break;
+    }
+}
+
+static void x87_exec_reg(x87_exec_t *x, int opcode, int reg, int rm, uint64_t *nzcv)
+{
+    f80_t a, b;
+    int rel;
+
+    switch (opcode) {
+    case 0xD8:
+        x87_arith_st0(x, reg, x87_get(x, rm));
+        break;
+    case 0xD9:
+        x87_exec_d9(x, reg, rm);
+        break;
+    case 0xDA:
+    case 0xDB:
+        if (reg < 4) {                          /* FCMOVcc */
+            b = x87_get(x, 0);
+            a = x87_get(x, rm);
+            if (x->sw & X87_SW_SF) {
+                x87_set(x, 0, f80_indefinite);
+            } else if (x87_fcmov_cond(*nzcv, opcode == 0xDB, reg)) {
+                x87_set(x, 0, a);
+            }
+            (void)b;
+        } else if (opcode == 0xDA && reg == 5 && rm == 1) {     /* FUCOMPP */
+            x87_compare_cc(x, rosetta_x87_f80_compare(x87_get(x, 0), x87_get(x, 1), 1, &x->sw));
+            x87_pop(x);
+            x87_pop(x);
+        } else if (opcode == 0xDB && reg == 4 && rm == 2) {     /* FNCLEX */
+            x->g->fpu_sw &= (uint16_t)~0x80FFu;
+        } else if (opcode == 0xDB && reg == 4 && rm == 3) {     /* FNINIT */
+            rosetta_x87_reset(x->g);
+            x->sw = 0;
+        } else if (opcode == 0xDB && (reg == 5 || reg == 6)) {  /* FUCOMI, FCOMI */
+            rel = rosetta_x87_f80_compare(x87_get(x, 0), x87_get(x, rm), reg == 5, &x->sw);
+            *nzcv = x87_compare_nzcv(rel);
+        }
+        break;
+    case 0xDC:
+    case 0xDE:
+        if (reg == 2 || reg == 3) {             /* FCOM2, FCOMP3, FCOMP5 aliases and FCOMPP */
+            x87_compare_cc(x, rosetta_x87_f80_compare(x87_get(x, 0), x87_get(x, rm), 0, &x->sw));
+            if (opcode == 0xDE || reg == 3) {
+                x87_pop(x);
+            }
+            if (opcode == 0xDE && reg == 3) {
+                x87_pop(x);
+            }
+            break;
+        }
+        /* ST(i) = ST(i) op ST(0); the SUB and DIV reg values name the reversed forms */
+        a = x87_get(x, rm);
+        b = x87_get(x, 0);
+        x87_set(x, rm, x87_arith(x, reg >= 4 ? reg ^ 1 : reg, a, b));
+        if (opcode == 0xDE) {
+            x87_pop(x);
+        }
+        break;
+    case 0xDD:
+    case 0xDF:
+        switch (reg) {
+        case 0:                                 /* FFREE, FFREEP */
+            x->g->fpu_tag &= (uint8_t)~(1u << x87_phys(x, rm));
+            if (opcode == 0xDF) {
+                x87_pop(x);
+            }
+            break;
+        case 1:                                 /* FXCH4, FXCH7 */
+            x87_exec_d9(x, 1, rm);
+            break;
+        case 2:                                 /* FST ST(i) */
+        case 3:                                 /* FSTP ST(i) */
+            x87_set(x, rm, x87_get(x, 0));
+            if (reg == 3 || opcode == 0xDF) {
+                x87_pop(x);
+            }
+            break;
+        case 4:                                 /* FUCOM; DF E0 (FNSTSW AX) is lowered inline */
+        case 5:                                 /* FUCOMP, FUCOMIP */
+        case 6:                                 /* FCOMIP */
+            if (opcode == 0xDD) {
+                x87_compare_cc(x, rosetta_x87_f80_compare(x87_get(x, 0), x87_get(x, rm), 1, &x->sw));
+            } else if (reg != 4) {
+                rel = rosetta_x87_f80_compare(x87_get(x, 0), x87_get(x, rm), reg == 5, &x->sw);
+                *nzcv = x87_compare_nzcv(rel);
+            } else {
+                break;
+            }
+            if (reg == 5 || opcode == 0xDF) {
+                x87_pop(x);
+            }
+            break;
+        }
+        break;
+    }
+}
+
+/* Control instructions and FCMOVcc leave C1 alone unless the stack faults */
+static int x87_keeps_c1(int opcode, int modrm)
+{
+    int reg = (modrm >> 3) & 7;
+
+    if (modrm < 0xC0) {
+        return (opcode == 0xD9 && reg >= 4) || (opcode == 0xDD && reg >= 4);
+    }
+    return ((opcode == 0xDA || opcode == 0xDB) && modrm < 0xE0) ||
+           ((opcode == 0xDB || opcode == 0xDF) && modrm >= 0xE8 && modrm < 0xF8) ||
+           (opcode == 0xD9 && modrm == 0xD0) || (opcode == 0xDB && modrm == 0xE2) ||
+           (opcode == 0xDF && modrm == 0xE0);
+}
+
+uint64_t rosetta_x87_exec(ThreadState *state, uint64_t addr, uint64_t nzcv, uint32_t op)
+{
+    x87_exec_t x;
+    int opcode = op & 0xFF, modrm = (op >> 8) & 0xFF;
+    int mod = modrm >> 6, reg = (modrm >> 3) & 7, rm = modrm & 7;
+
+    x.g = &state->guest;
+    x.fast = rosetta_x87_mode() == ROSETTA_X87_FAST;
+    x.cw = x.g->fpu_cw;
+    x.sw = 0;
+
+    if (mod != 3) {
+        x87_exec_mem(&x, opcode, reg, addr);
+    } else {
+        x87_exec_reg(&x, opcode, reg, rm, &nzcv);
+    }
+
+    /* C1 reports rounding and stack faults; C0, C2 and C3 only change when an instruction sets them */
+    if (!x87_keeps_c1(opcode, modrm) || (x.sw & X87_SW_SF)) {
+        x.g->fpu_cc = (uint16_t)((x.g->fpu_cc & ~X87_SW_C1) | (x.sw & X87_SW_C1));
+    }
+    x.g->fpu_sw |= x.sw & 0x7F;
+    return nzcv;
+}
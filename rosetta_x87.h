@@ -0,0 +1,152 @@
+/* ============================================================================
+ * Rosetta x87 FPU Emulation Header
+ * ============================================================================
+ *
+ * The guest x87 state lives in ThreadState.guest (st, fpu_sw, fpu_cc,
+ * fpu_cw, fpu_tag, fpu_top). Two modes are provided:
+ *
+ * - Fast: registers hold host doubles (st[n].f64[0]). Translated code
+ *   keeps the stack in NEON registers and computes in double precision,
+ *   as if the control word selected 53-bit precision with a double's
+ *   exponent range. Arithmetic rounds under an FPCR loaded from the
+ *   control word's RC, and its exception flags go to the status word
+ *   (rosetta_translate_mxcsr.h); precision control is ignored.
+ * - Accurate: registers hold 80-bit values (rosetta_x87_f80_t at st[n])
+ *   and every instruction runs through rosetta_x87_exec() on the
+ *   softfloat below, honouring precision and rounding control and the
+ *   status word exception flags. Exceptions always behave as masked.
+ *
+ * The mode is process wide and must be chosen before the first block is
+ * translated, since it fixes the register format.
+ * ============================================================================ */
+
+#ifndef ROSETTA_X87_H
+#define ROSETTA_X87_H
+
+#include "rosetta_types.h"
+
+/* ============================================================================
+ * Configuration
+ * ============================================================================ */
+
+/* Environment variable that selects the mode at startup ("accurate" or "fast") */
+#define ROSETTA_X87_ENV             "ROSETTA_X87"
+
+typedef enum {
+    ROSETTA_X87_FAST = 0,           /* Host double precision (default) */
+    ROSETTA_X87_ACCURATE            /* 80-bit softfloat */
+} rosetta_x87_mode_t;
+
+/**
+ * Select the x87 mode (process wide)
+ */
+void rosetta_x87_set_mode(rosetta_x87_mode_t mode);
+
+/**
+ * Current x87 mode
+ * @return The mode set through the API, else from ROSETTA_X87
+ */
+rosetta_x87_mode_t rosetta_x87_mode(void);
+
+/**
+ * Put the guest x87 state in its FNINIT state
+ */
+void rosetta_x87_reset(x86_context_t *guest);
+
+/* ============================================================================
+ * Status and Control Words
+ * ============================================================================ */
+
+#define X87_SW_IE           0x0001  /* Invalid operation */
+#define X87_SW_DE           0x0002  /* Denormal operand */
+#define X87_SW_ZE           0x0004  /* Zero divide */
+#define X87_SW_OE           0x0008  /* Overflow */
+#define X87_SW_UE           0x0010  /* Underflow */
+#define X87_SW_PE           0x0020  /* Precision */
+#define X87_SW_SF           0x0040  /* Stack fault */
+#define X87_SW_ES           0x0080  /* Error summary */
+#define X87_SW_C0           0x0100
+#define X87_SW_C1           0x0200
+#define X87_SW_C2           0x0400
+#define X87_SW_C3           0x4000
+#define X87_SW_CC           (X87_SW_C0 | X87_SW_C1 | X87_SW_C2 | X87_SW_C3)
+#define X87_SW_TOP_SHIFT    11
+
+#define X87_CW_DEFAULT      0x037F  /* All masked, 64-bit precision, round to nearest */
+#define X87_CW_PC_SHIFT     8       /* 0: 24 bits, 2: 53 bits, 3: 64 bits */
+#define X87_CW_RC_SHIFT     10      /* 0: nearest, 1: down, 2: up, 3: toward zero */
+
+/* ============================================================================
+ * 80-bit Softfloat
+ * ============================================================================
+ *
+ * Results are rounded under the precision and rounding control of cw and
+ * exception flags are ORed into *sw, along with C1 when a result was
+ * rounded up. NaN operands propagate as the x87 does.
+ * ============================================================================ */
+
+typedef struct {
+    uint64_t mant;                  /* Significand, explicit integer bit at 63 */
+    uint16_t sexp;                  /* Sign (bit 15) and biased exponent */
+} rosetta_x87_f80_t;
+
+/* Result of rosetta_x87_f80_compare() */
+#define X87_CMP_LT          0
+#define X87_CMP_EQ          1
+#define X87_CMP_GT          2
+#define X87_CMP_UN          3
+
+rosetta_x87_f80_t rosetta_x87_f80_add(rosetta_x87_f80_t a, rosetta_x87_f80_t b, uint16_t cw, uint16_t *sw);
+rosetta_x87_f80_t rosetta_x87_f80_sub(rosetta_x87_f80_t a, rosetta_x87_f80_t b, uint16_t cw, uint16_t *sw);
+rosetta_x87_f80_t rosetta_x87_f80_mul(rosetta_x87_f80_t a, rosetta_x87_f80_t b, uint16_t cw, uint16_t *sw);
+rosetta_x87_f80_t rosetta_x87_f80_div(rosetta_x87_f80_t a, rosetta_x87_f80_t b, uint16_t cw, uint16_t *sw);
+rosetta_x87_f80_t rosetta_x87_f80_sqrt(rosetta_x87_f80_t a, uint16_t cw, uint16_t *sw);
+
+/* FRNDINT: round to an integer under the rounding control */
+rosetta_x87_f80_t rosetta_x87_f80_round_int(rosetta_x87_f80_t a, uint16_t cw, uint16_t *sw);
+
+/**
+ * Compare two values
+ * @param quiet Raise invalid only for signalling NaNs (FUCOM), not for any NaN (FCOM)
+ * @return X87_CMP_LT, _EQ, _GT or _UN
+ */
+int rosetta_x87_f80_compare(rosetta_x87_f80_t a, rosetta_x87_f80_t b, int quiet, uint16_t *sw);
+
+/* Exact widening loads (FLD m32/m64, FILD); signalling NaNs are quietened */
+rosetta_x87_f80_t rosetta_x87_f80_from_f32(uint32_t bits, uint16_t *sw);
+rosetta_x87_f80_t rosetta_x87_f80_from_f64(uint64_t bits, uint16_t *sw);
+rosetta_x87_f80_t rosetta_x87_f80_from_i64(int64_t v);
+
+/* Narrowing stores (FST m32/m64) under the rounding control only */
+uint32_t rosetta_x87_f80_to_f32(rosetta_x87_f80_t a, uint16_t cw, uint16_t *sw);
+uint64_t rosetta_x87_f80_to_f64(rosetta_x87_f80_t a, uint16_t cw, uint16_t *sw);
+
+/**
+ * Convert to a bits-wide integer (FIST, FISTTP)
+ * @param truncate Round toward zero regardless of the control word
+ * @return The integer, or the integer indefinite with invalid raised
+ */
+int64_t rosetta_x87_f80_to_int(rosetta_x87_f80_t a, int bits, int truncate, uint16_t cw, uint16_t *sw);
+
+/* ============================================================================
+ * Instruction Execution
+ * ============================================================================ */
+
+/* rosetta_x87_exec() op argument: the opcode byte and its ModR/M byte */
+#define X87_OP(opcode, modrm)   ((uint32_t)(opcode) | (uint32_t)(modrm) << 8)
+
+/**
+ * Execute one x87 instruction (D8-DF) on the guest state
+ *
+ * Called from translated code for every instruction in accurate mode and
+ * for the instructions fast mode does not lower inline.
+ *
+ * @param state Thread state holding the x87 registers
+ * @param addr Memory operand address (ignored for register forms)
+ * @param nzcv Guest flags as held in NZCV (ZF = Z, CF = !C, PF = V)
+ * @param op X87_OP(opcode, modrm)
+ * @return NZCV to continue with, updated by FCOMI and friends
+ */
+uint64_t rosetta_x87_exec(ThreadState *state, uint64_t addr, uint64_t nzcv, uint32_t op);
+
+#endif /* ROSETTA_X87_H */
@@ -0,0 +1,359 @@
+/*=============================================================================
+ * ARM64 Interpreter for the Lowering Tests
+ *=============================================================================*/
+
+#include <string.h>
+#include "test_a64_interp.h"
+
+/* ============================================================================
+ * Registers and Conditions
+ * ============================================================================ */
+
+uint64_t a64_xr(const a64_t *c, int r)
+{
+    return r == 31 ? 0 : c->x[r];
+}
+
+uint64_t a64_xr_sp(const a64_t *c, int r)
+{
+    return r == 31 ? c->sp : c->x[r];
+}
+
+void a64_xw(a64_t *c, int sf, int r, uint64_t v)
+{
+    if (r != 31) {
+        c->x[r] = sf ? v : (uint32_t)v;
+    }
+}
+
+void a64_xw_sp(a64_t *c, int sf, int r, uint64_t v)
+{
+    if (r == 31) {
+        c->sp = v;
+    } else {
+        a64_xw(c, sf, r, v);
+    }
+}
+
+uint32_t a64_fcmp_nzcv(double a, double b)
+{
+    if (a != a || b != b) {
+        return 0x3;
+    }
+    return a == b ? 0x6 : a < b ? 0x8 : 0x2;
+}
+
+int a64_cond_holds(uint32_t nzcv, int cond)
+{
+    int n = (nzcv >> 3) & 1, z = (nzcv >> 2) & 1, cf = (nzcv >> 1) & 1, v = nzcv & 1;
+    int r;
+
+    switch (cond >> 1) {
+    case 0: r = z; break;
+    case 1: r = cf; break;
+    case 2: r = n; break;
+    case 3: r = v; break;
+    case 4: r = cf && !z; break;
+    case 5: r = n == v; break;
+    case 6: r = n == v && !z; break;
+    default: r = 1; break;
+    }
+    return (cond & 1) && cond != 15 ? !r : r;
+}
+
+/* ============================================================================
+ * Data Processing
+ * ============================================================================ */
+
+static uint64_t decode_bitmask(int n, int immr, int imms)
+{
+    int len = 31 - __builtin_clz((unsigned)((n << 6) | (~imms & 0x3F)));
+    int esize = 1 << len, s = imms & (esize - 1), rot = immr & (esize - 1);
+    uint64_t welem = s + 1 == 64 ? ~0ull : (1ull << (s + 1)) - 1;
+    uint64_t emask = esize == 64 ? ~0ull : (1ull << esize) - 1;
+    uint64_t x = 0;
+    int i;
+
+    welem = rot ? ((welem >> rot) | (welem << (esize - rot))) & emask : welem;
+    for (i = 0; i < 64; i += esize) {
+        x |= welem << i;
+    }
+    return x;
+}
+
+/* UBFM and BFM (UBFX, LSL, BFI, BFXIL) */
+static uint64_t bfm(uint64_t dst, uint64_t src, int sf, int immr, int imms)
+{
+    int size = sf ? 64 : 32;
+    uint64_t mask;
+
+    if (imms >= immr) {
+        int width = imms - immr + 1;
+        mask = width == 64 ? ~0ull : (1ull << width) - 1;
+        return (dst & ~mask) | ((src >> immr) & mask);
+    }
+    mask = (1ull << (imms + 1)) - 1;
+    return (dst & ~(mask << (size - immr))) | ((src & mask) << (size - immr));
+}
+
+static int a64_gpr(a64_t *c, uint32_t w)
+{
+    int sf = w >> 31, rd = w & 31, rn = (w >> 5) & 31, rm = (w >> 16) & 31;
+
+    if ((w & 0x1F800000u) == 0x12800000u) {                       /* MOVN/MOVZ/MOVK */
+        int opc = (w >> 29) & 3, hw = (w >> 21) & 3;
+        uint64_t imm = (uint64_t)((w >> 5) & 0xFFFF) << (16 * hw);
+        if (opc == 0) {
+            a64_xw(c, sf, rd, ~imm);
+        } else if (opc == 2) {
+            a64_xw(c, sf, rd, imm);
+        } else if (opc == 3) {
+            a64_xw(c, sf, rd, (a64_xr(c, rd) & ~(0xFFFFull << (16 * hw))) | imm);
+        } else {
+            return -1;
+        }
+    } else if ((w & 0x1F800000u) == 0x11000000u) {                /* ADD/SUB imm */
+        uint64_t imm = (uint64_t)((w >> 10) & 0xFFF) << (((w >> 22) & 1) * 12);
+        if (w & (1u << 29)) {
+            return -1;
+        }
+        a64_xw_sp(c, sf, rd, (w & (1u << 30)) ? a64_xr_sp(c, rn) - imm : a64_xr_sp(c, rn) + imm);
+    } else if ((w & 0x1F800000u) == 0x12000000u) {                /* Logical imm */
+        uint64_t imm = decode_bitmask((w >> 22) & 1, (w >> 16) & 63, (w >> 10) & 63);
+        switch ((w >> 29) & 3) {
+        case 0: a64_xw(c, sf, rd, a64_xr(c, rn) & imm); break;
+        case 1: a64_xw(c, sf, rd, a64_xr(c, rn) | imm); break;
+        case 2: a64_xw(c, sf, rd, a64_xr(c, rn) ^ imm); break;
+        default: return -1;
+        }
+    } else if ((w & 0x1F000000u) == 0x0A000000u) {                /* Logical shifted reg */
+        int sh = (w >> 10) & 63, type = (w >> 22) & 3;
+        uint64_t b = sf ? a64_xr(c, rm) : (uint32_t)a64_xr(c, rm), a = a64_xr(c, rn);
+        if (type == 0) {
+            b <<= sh;
+        } else if (type == 1) {
+            b >>= sh;
+        } else {
+            return -1;
+        }
+        if (w & (1u << 21)) {
+            b = ~b;
+        }
+        switch ((w >> 29) & 3) {
+        case 0: a64_xw(c, sf, rd, a & b); break;
+        case 1: a64_xw(c, sf, rd, a | b); break;
+        case 2: a64_xw(c, sf, rd, a ^ b); break;
+        default: return -1;
+        }
+    } else if ((w & 0x1F200000u) == 0x0B000000u) {                /* ADD/SUB shifted reg, LSL */
+        uint64_t b = a64_xr(c, rm) << ((w >> 10) & 63);
+        if ((w >> 22) & 3 || (w & (1u << 29))) {
+            return -1;
+        }
+        a64_xw(c, sf, rd, (w & (1u << 30)) ? a64_xr(c, rn) - b : a64_xr(c, rn) + b);
+    } else if ((w & 0xFFE00000u) == 0x93C00000u) {                /* EXTR X */
+        int lsb = (w >> 10) & 63;
+        uint64_t lo = a64_xr(c, rm), hi = a64_xr(c, rn);
+        a64_xw(c, 1, rd, lsb ? (lo >> lsb) | (hi << (64 - lsb)) : lo);
+    } else if ((w & 0x7FE0FC00u) == 0x1AC02000u) {                /* LSLV */
+        a64_xw(c, sf, rd, a64_xr(c, rn) << (a64_xr(c, rm) & (sf ? 63 : 31)));
+    } else if ((w & 0x7FE00800u) == 0x1A800000u) {                /* CSEL, CSINC */
+        uint64_t r = a64_cond_holds(c->nzcv, (w >> 12) & 15) ? a64_xr(c, rn) :
+                     a64_xr(c, rm) + ((w >> 10) & 1);
+        a64_xw(c, sf, rd, r);
+    } else if ((w & 0x7F800000u) == 0x53000000u) {                /* UBFM */
+        a64_xw(c, sf, rd, bfm(0, a64_xr(c, rn), sf, (w >> 16) & 63, (w >> 10) & 63));
+    } else if ((w & 0x7F800000u) == 0x33000000u) {                /* BFM */
+        a64_xw(c, sf, rd, bfm(a64_xr(c, rd), a64_xr(c, rn), sf, (w >> 16) & 63, (w >> 10) & 63));
+    } else if ((w & 0xFFFFFFE0u) == 0xD53B4200u) {                /* MRS NZCV */
+        a64_xw(c, 1, rd, (uint64_t)c->nzcv << 28);
+    } else if ((w & 0xFFFFFFE0u) == 0xD51B4200u) {                /* MSR NZCV */
+        c->nzcv = (uint32_t)(a64_xr(c, rd) >> 28) & 15;
+    } else if ((w & 0xFFFFFFE0u) == 0xD53B4400u) {                /* MRS FPCR */
+        a64_xw(c, 1, rd, c->fpcr);
+    } else if ((w & 0xFFFFFFE0u) == 0xD51B4400u) {                /* MSR FPCR */
+        c->fpcr = (uint32_t)a64_xr(c, rd);
+        c->fpcr_writes++;
+    } else if ((w & 0xFFFFFFE0u) == 0xD53B4420u) {                /* MRS FPSR */
+        a64_xw(c, 1, rd, c->fpsr);
+        c->fpsr_reads++;
+    } else if ((w & 0xFFFFFFE0u) == 0xD51B4420u) {                /* MSR FPSR */
+        c->fpsr = (uint32_t)a64_xr(c, rd);
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+/* ============================================================================
+ * Loads and Stores
+ * ============================================================================ */
+
+static int a64_ldst(a64_t *c, uint32_t w)
+{
+    int size = (w >> 30) & 3, vec = (w >> 26) & 1, opc = (w >> 22) & 3;
+    int rt = w & 31, rn = (w >> 5) & 31;
+    uint64_t addr, x = 0;
+
+    if ((w & 0x3B000000u) == 0x39000000u) {                       /* Unsigned offset */
+        int lg = vec && (opc & 2) ? 4 : size;
+        addr = a64_xr_sp(c, rn) + ((uint64_t)((w >> 10) & 0xFFF) << lg);
+        if (vec) {
+            if ((opc & 2) && size) {
+                return -1;
+            }
+            if (opc & 1) {
+                memset(&c->v[rt], 0, 16);
+                memcpy(&c->v[rt], (void *)(uintptr_t)addr, (size_t)1 << lg);
+            } else {
+                memcpy((void *)(uintptr_t)addr, &c->v[rt], (size_t)1 << lg);
+            }
+            return 0;
+        }
+        if (opc == 0) {
+            x = a64_xr(c, rt);
+            memcpy((void *)(uintptr_t)addr, &x, (size_t)1 << size);
+            return 0;
+        }
+        memcpy(&x, (void *)(uintptr_t)addr, (size_t)1 << size);
+        if (opc >= 2) {
+            int bits = 8 << size;
+            x = (uint64_t)((int64_t)(x << (64 - bits)) >> (64 - bits));
+            a64_xw(c, opc == 2, rt, x);
+        } else {
+            a64_xw(c, 1, rt, x);
+        }
+        return 0;
+    }
+    if ((w & 0x3B200C00u) == 0x38200800u && !vec && opc < 2) {   /* Register offset, LSL */
+        int lsl = (w >> 12) & 1;
+        if (((w >> 13) & 7) != 3) {
+            return -1;
+        }
+        addr = a64_xr_sp(c, rn) + (a64_xr(c, (w >> 16) & 31) << (lsl ? size : 0));
+        if (opc == 0) {
+            x = a64_xr(c, rt);
+            memcpy((void *)(uintptr_t)addr, &x, (size_t)1 << size);
+        } else {
+            memcpy(&x, (void *)(uintptr_t)addr, (size_t)1 << size);
+            a64_xw(c, 1, rt, x);
+        }
+        return 0;
+    }
+    if ((w & 0xFFE00400u) == 0xF8000400u || (w & 0xFFE00400u) == 0xF8400400u) {  /* X pre/post index */
+        int64_t imm = (int64_t)((uint64_t)((w >> 12) & 0x1FF) << 55) >> 55;
+        int pre = (w >> 11) & 1;
+        uint64_t base = a64_xr_sp(c, rn);
+        addr = pre ? base + (uint64_t)imm : base;
+        if (opc & 1) {
+            memcpy(&x, (void *)(uintptr_t)addr, 8);
+            a64_xw(c, 1, rt, x);
+        } else {
+            x = a64_xr(c, rt);
+            memcpy((void *)(uintptr_t)addr, &x, 8);
+        }
+        a64_xw_sp(c, 1, rn, base + (uint64_t)imm);
+        return 0;
+    }
+    if ((w & 0xFFC00000u) == 0xA9000000u || (w & 0xFFC00000u) == 0xA9400000u ||
+        (w & 0xFFC00000u) == 0xAD000000u || (w & 0xFFC00000u) == 0xAD400000u) {  /* LDP/STP offset */
+        int lg = vec ? 4 : 3;
+        int rt2 = (w >> 10) & 31, load = (w >> 22) & 1;
+        int64_t imm = ((int64_t)((uint64_t)((w >> 15) & 0x7F) << 57) >> 57) * (1 << lg);
+        addr = a64_xr_sp(c, rn) + (uint64_t)imm;
+        if (vec) {
+            if (load) {
+                memcpy(&c->v[rt], (void *)(uintptr_t)addr, 16);
+                memcpy(&c->v[rt2], (void *)(uintptr_t)(addr + 16), 16);
+            } else {
+                memcpy((void *)(uintptr_t)addr, &c->v[rt], 16);
+                memcpy((void *)(uintptr_t)(addr + 16), &c->v[rt2], 16);
+            }
+        } else if (load) {
+            memcpy(&x, (void *)(uintptr_t)addr, 8);
+            a64_xw(c, 1, rt, x);
+            memcpy(&x, (void *)(uintptr_t)(addr + 8), 8);
+            a64_xw(c, 1, rt2, x);
+        } else {
+            x = a64_xr(c, rt);
+            memcpy((void *)(uintptr_t)addr, &x, 8);
+            x = a64_xr(c, rt2);
+            memcpy((void *)(uintptr_t)(addr + 8), &x, 8);
+        }
+        return 0;
+    }
+    if ((w & 0xFFC00000u) == 0xA9800000u || (w & 0xFFC00000u) == 0xA8C00000u) {  /* STP pre, LDP post */
+        int rt2 = (w >> 10) & 31, load = (w >> 22) & 1;
+        int64_t imm = ((int64_t)((uint64_t)((w >> 15) & 0x7F) << 57) >> 57) * 8;
+        uint64_t base = a64_xr_sp(c, rn);
+        addr = load ? base : base + (uint64_t)imm;
+        if (load) {
+            memcpy(&x, (void *)(uintptr_t)addr, 8);
+            a64_xw(c, 1, rt, x);
+            memcpy(&x, (void *)(uintptr_t)(addr + 8), 8);
+            a64_xw(c, 1, rt2, x);
+        } else {
+            x = a64_xr(c, rt);
+            memcpy((void *)(uintptr_t)addr, &x, 8);
+            x = a64_xr(c, rt2);
+            memcpy((void *)(uintptr_t)(addr + 8), &x, 8);
+        }
+        a64_xw_sp(c, 1, rn, base + (uint64_t)imm);
+        return 0;
+    }
+    return -1;
+}
+
+/* ============================================================================
+ * Execution
+ * ============================================================================ */
+
+size_t a64_run(a64_t *c, const uint32_t *code, size_t n)
+{
+    size_t i = 0;
+    int steps = 0;
+
+    while (i < n) {
+        uint32_t w = code[i];
+        int ret;
+
+        if (++steps > 100000) {
+            return i + 1;
+        }
+        if ((w & 0xFC000000u) == 0x14000000u) {                   /* B */
+            int32_t off = (int32_t)(w << 6) >> 6;
+            i += (size_t)(int64_t)off;
+            continue;
+        }
+        if ((w & 0x7E000000u) == 0x34000000u) {                   /* CBZ, CBNZ */
+            int32_t off = (int32_t)(((w >> 5) & 0x7FFFF) << 13) >> 13;
+            uint64_t v = (w >> 31) ? a64_xr(c, w & 31) : (uint32_t)a64_xr(c, w & 31);
+            i += (v == 0) != ((w >> 24) & 1) ? (size_t)(int64_t)off : 1;
+            continue;
+        }
+        if ((w & 0x7E000000u) == 0x36000000u) {                   /* TBZ, TBNZ */
+            int bit = (int)((w >> 19) & 31) | (int)(w >> 31) << 5;
+            int32_t off = (int32_t)(((w >> 5) & 0x3FFF) << 18) >> 18;
+            i += ((a64_xr(c, w & 31) >> bit) & 1) == ((w >> 24) & 1) ? (size_t)(int64_t)off : 1;
+            continue;
+        }
+        if (w == 0xD65F03C0u) {                                    /* RET ends the run */
+            c->returned = 1;
+            return 0;
+        }
+        if ((w & 0xFFFFFC1Fu) == 0xD63F0000u) {                   /* BLR */
+            ret = c->blr ? c->blr(c, a64_xr(c, (w >> 5) & 31)) : -1;
+        } else if ((w & 0x0E000000u) == 0x0E000000u) {
+            ret = c->simd ? c->simd(c, w) : -1;
+        } else if ((w & 0x0A000000u) == 0x08000000u) {
+            ret = a64_ldst(c, w);
+        } else {
+            ret = a64_gpr(c, w);
+        }
+        if (ret < 0) {
+            return i + 1;
+        }
+        i++;
+    }
+    return 0;
+}
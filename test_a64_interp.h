@@ -0,0 +1,66 @@
+/*=============================================================================
+ * ARM64 Interpreter for the Lowering Tests
+ *=============================================================================
+ *
+ * Runs the ARM64 words a lowering emits, directly on host memory, for the
+ * differential tests (test_sse_neon.c, test_x87.c, test_mxcsr.c). The core
+ * covers the integer, load/store, branch and system-register classes the
+ * lowerings and host calls emit; SIMD and FP encodings, and BLR targets, are left to the
+ * test through hooks. Anything else fails, so a stray encoding shows up as
+ * a failure.
+ *
+ *=============================================================================*/
+
+#ifndef TEST_A64_INTERP_H
+#define TEST_A64_INTERP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef union {
+    uint8_t b[16];
+    uint16_t h[8];
+    uint32_t s[4];
+    uint64_t d[2];
+    float f[4];
+    double df[2];
+} a64_vreg_t;
+
+typedef struct a64 a64_t;
+
+struct a64 {
+    uint64_t x[32];             /* x[31] reads as zero; SP is separate */
+    uint64_t sp;
+    a64_vreg_t v[32];
+    uint32_t nzcv;              /* Bits 3..0: N, Z, C, V */
+    uint32_t fpcr;
+    uint32_t fpsr;
+    int fpcr_writes;            /* MSR FPCR */
+    int fpsr_reads;             /* MRS FPSR */
+    int helper_calls;           /* Counted by the blr hook */
+    int returned;               /* Stopped at a RET */
+
+    /* SIMD and FP data processing (bits 27:25 = 111); -1 if not understood */
+    int (*simd)(a64_t *c, uint32_t w);
+    /* BLR to target; -1 for an unexpected target */
+    int (*blr)(a64_t *c, uint64_t target);
+};
+
+/* General registers, with register 31 as XZR or (the _sp forms) SP */
+uint64_t a64_xr(const a64_t *c, int r);
+uint64_t a64_xr_sp(const a64_t *c, int r);
+void a64_xw(a64_t *c, int sf, int r, uint64_t v);
+void a64_xw_sp(a64_t *c, int sf, int r, uint64_t v);
+
+/* NZCV of FCMP a, b and the condition codes over NZCV */
+uint32_t a64_fcmp_nzcv(double a, double b);
+int a64_cond_holds(uint32_t nzcv, int cond);
+
+/**
+ * a64_run - Run words until the end of code or a RET
+ * @return 0, or the index + 1 of the first word not understood (a branch
+ *         loop past 100000 steps also fails there)
+ */
+size_t a64_run(a64_t *c, const uint32_t *code, size_t n);
+
+#endif /* TEST_A64_INTERP_H */
@@ -0,0 +1,489 @@
+/*=============================================================================
+ * AES Round Translation Test
+ *=============================================================================
+ *
+ * Checks the host AES steps against FIPS-197 with and without AES-NI, and
+ * that translated ARM64 AESE/AESMC and AESD/AESIMC rounds are fused into
+ * one AES-NI round per guest pair and still encrypt and decrypt the
+ * FIPS-197 Appendix C.1 block. Unpaired steps are checked against the
+ * host library.
+ *
+ * Build: gcc -std=gnu11 -o test_aes test_aes.c rosetta_aes.c rosetta_crc32.c \
+ *            rosetta_ir_opt.c rosetta_ir.c rosetta_ir_from_x86.c \
+ *            rosetta_ir_from_arm64.c rosetta_ir_to_arm64.c rosetta_ir_to_x86.c \
+ *            rosetta_ir_to_x86_crypto.c rosetta_regalloc.c rosetta_emit_x86.c \
+ *            rosetta_arm64_emit.c rosetta_insn_cache.c \
+ *            rosetta_translate_mxcsr.c rosetta_sha.c \
+ *            rosetta_pmull.c -pthread
+ *
+ *=============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include "rosetta_aes.h"
+#include "rosetta_ir_opt.h"
+#include "rosetta_ir_to_x86.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST_START(name) \
+    printf("\n--- Test: %s ---\n", name)
+
+#define TEST_PASS(name) \
+    do { \
+        tests_passed++; \
+        printf("✅ PASS: %s\n", name); \
+    } while(0)
+
+#define TEST_FAIL(name, reason) \
+    do { \
+        tests_failed++; \
+        printf("❌ FAIL: %s - %s\n", name, reason); \
+    } while(0)
+
+static ir_block_t blk;
+static ir_opt_stats_t stats;
+static uint8_t *exec_mem;
+static ThreadState state;
+
+/* FIPS-197 Appendix C.1 */
+static const uint8_t fips_key[16] = {
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+    0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f
+};
+static const uint8_t fips_plain[16] = {
+    0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
+    0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff
+};
+static const uint8_t fips_cipher[16] = {
+    0x69, 0xc4, 0xe0, 0xd8, 0x6a, 0x7b, 0x04, 0x30,
+    0xd8, 0xcd, 0xb7, 0x80, 0x70, 0xb4, 0xc5, 0x5a
+};
+
+static uint8_t rk[11][16];      /* Encryption round keys */
+static uint8_t dk[11][16];      /* Equivalent inverse cipher round keys */
+
+/* ============================================================================
+ * Reference Key Schedule
+ * ============================================================================ */
+
+static uint8_t gf_mul(uint8_t a, uint8_t b)
+{
+    uint8_t r = 0;
+
+    for (; b; b >>= 1) {
+        if (b & 1) {
+            r ^= a;
+        }
+        a = (uint8_t)((a << 1) ^ ((a & 0x80) ? 0x1B : 0));
+    }
+    return r;
+}
+
+static uint8_t sbox(uint8_t x)
+{
+    uint8_t inv = x ? 1 : 0, b;
+    int i;
+
+    for (i = 0; x && i < 254; i++) {
+        inv = gf_mul(inv, x);
+    }
+    b = inv;
+    for (i = 1; i < 5; i++) {
+        b ^= (uint8_t)((inv << i) | (inv >> (8 - i)));
+    }
+    return b ^ 0x63;
+}
+
+static void inv_mix(uint8_t *out, const uint8_t *in)
+{
+    int c;
+
+    for (c = 0; c < 4; c++) {
+        const uint8_t *s = &in[4 * c];
+        out[4 * c + 0] = gf_mul(s[0], 14) ^ gf_mul(s[1], 11) ^ gf_mul(s[2], 13) ^ gf_mul(s[3], 9);
+        out[4 * c + 1] = gf_mul(s[0], 9) ^ gf_mul(s[1], 14) ^ gf_mul(s[2], 11) ^ gf_mul(s[3], 13);
+        out[4 * c + 2] = gf_mul(s[0], 13) ^ gf_mul(s[1], 9) ^ gf_mul(s[2], 14) ^ gf_mul(s[3], 11);
+        out[4 * c + 3] = gf_mul(s[0], 11) ^ gf_mul(s[1], 13) ^ gf_mul(s[2], 9) ^ gf_mul(s[3], 14);
+    }
+}
+
+static void expand_key(void)
+{
+    uint8_t *w = &rk[0][0];
+    uint8_t rcon = 1;
+    int i, j;
+
+    memcpy(w, fips_key, 16);
+    for (i = 16; i < 176; i += 4) {
+        uint8_t t[4] = { w[i - 4], w[i - 3], w[i - 2], w[i - 1] };
+
+        if (i % 16 == 0) {
+            uint8_t t0 = t[0];
+            t[0] = sbox(t[1]) ^ rcon;
+            t[1] = sbox(t[2]);
+            t[2] = sbox(t[3]);
+            t[3] = sbox(t0);
+            rcon = gf_mul(rcon, 2);
+        }
+        for (j = 0; j < 4; j++) {
+            w[i + j] = w[i - 16 + j] ^ t[j];
+        }
+    }
+
+    memcpy(dk[0], rk[10], 16);
+    for (i = 1; i < 10; i++) {
+        inv_mix(dk[i], rk[10 - i]);
+    }
+    memcpy(dk[10], rk[0], 16);
+}
+
+/* ============================================================================
+ * Helpers
+ * ============================================================================ */
+
+/* AESE/AESD/AESMC/AESIMC Vd, Vn; op numbered as IR_AES_E..IR_AES_IMC */
+static uint32_t a64_aes(int op, int rd, int rn)
+{
+    return 0x4E284800u | ((uint32_t)op << 12) | ((uint32_t)rn << 5) | (uint32_t)rd;
+}
+
+/* EOR Vd.16B, Vn.16B, Vm.16B */
+static uint32_t a64_eor16(int rd, int rn, int rm)
+{
+    return 0x6E201C00u | ((uint32_t)rm << 16) | ((uint32_t)rn << 5) | (uint32_t)rd;
+}
+
+/* AESE/AESMC x9, AESE, EOR with V1-V11 as keys, or AESD/AESIMC with decrypt */
+static int aes_program(uint32_t *code, int decrypt)
+{
+    int n = 0, r;
+
+    for (r = 0; r < 9; r++) {
+        code[n++] = a64_aes(decrypt ? IR_AES_D : IR_AES_E, 0, r + 1);
+        code[n++] = a64_aes(decrypt ? IR_AES_IMC : IR_AES_MC, 0, 0);
+    }
+    code[n++] = a64_aes(decrypt ? IR_AES_D : IR_AES_E, 0, 10);
+    code[n++] = a64_eor16(0, 0, 11);
+    return n;
+}
+
+static int count_aes(ir_aes_op_t op)
+{
+    int i, n = 0;
+
+    for (i = 0; i < blk.count; i++) {
+        n += (blk.insns[i].op == IR_AES && blk.insns[i].imm == op);
+    }
+    return n;
+}
+
+static int emit_x86(const uint32_t *code, int n, uint32_t passes)
+{
+    code_buf_t buf;
+
+    memset(&stats, 0, sizeof(stats));
+    ir_block_init(&blk, 0x3000);
+    if (ir_arm64_lower_block(&blk, code, 0x3000, n) != n ||
+        ir_optimize(&blk, passes, &stats) != 0) {
+        return -1;
+    }
+    code_buf_init(&buf, exec_mem, 4096);
+    return ir_emit_x86(&blk, &buf);
+}
+
+static void run(void)
+{
+    ((void (*)(ThreadState *))exec_mem)(&state);
+}
+
+/* ============================================================================
+ * Tests
+ * ============================================================================ */
+
+static int check_host(char *why, size_t why_len)
+{
+    uint8_t s[16];
+    int r;
+
+    /* ARM64 order */
+    memcpy(s, fips_plain, 16);
+    for (r = 0; r < 9; r++) {
+        rosetta_aes_step(ROS_AES_E, s, s, rk[r]);
+        rosetta_aes_step(ROS_AES_MC, s, s, NULL);
+    }
+    rosetta_aes_step(ROS_AES_E, s, s, rk[9]);
+    for (r = 0; r < 16; r++) {
+        s[r] ^= rk[10][r];
+    }
+    if (memcmp(s, fips_cipher, 16) != 0) {
+        snprintf(why, why_len, "AESE/AESMC sequence");
+        return -1;
+    }
+
+    /* x86 order */
+    memcpy(s, fips_plain, 16);
+    for (r = 0; r < 16; r++) {
+        s[r] ^= rk[0][r];
+    }
+    for (r = 1; r < 10; r++) {
+        rosetta_aes_step(ROS_AES_ENC, s, s, rk[r]);
+    }
+    rosetta_aes_step(ROS_AES_ENCLAST, s, s, rk[10]);
+    if (memcmp(s, fips_cipher, 16) != 0) {
+        snprintf(why, why_len, "AESENC sequence");
+        return -1;
+    }
+
+    /* And back, with the equivalent inverse cipher keys */
+    for (r = 0; r < 9; r++) {
+        rosetta_aes_step(ROS_AES_D, s, s, dk[r]);
+        rosetta_aes_step(ROS_AES_IMC, s, s, NULL);
+    }
+    rosetta_aes_step(ROS_AES_D, s, s, dk[9]);
+    for (r = 0; r < 16; r++) {
+        s[r] ^= dk[10][r];
+    }
+    if (memcmp(s, fips_plain, 16) != 0) {
+        snprintf(why, why_len, "AESD/AESIMC sequence");
+        return -1;
+    }
+
+    memcpy(s, fips_cipher, 16);
+    for (r = 0; r < 16; r++) {
+        s[r] ^= dk[0][r];
+    }
+    for (r = 1; r < 10; r++) {
+        rosetta_aes_step(ROS_AES_DEC, s, s, dk[r]);
+    }
+    rosetta_aes_step(ROS_AES_DECLAST, s, s, dk[10]);
+    if (memcmp(s, fips_plain, 16) != 0) {
+        snprintf(why, why_len, "AESDEC sequence");
+        return -1;
+    }
+    return 0;
+}
+
+static void test_host(uint32_t hw)
+{
+    char name[64];
+    char why[128];
+
+    snprintf(name, sizeof(name), "FIPS-197 C.1 with %s", hw ? "AES-NI" : "tables");
+    TEST_START(name);
+
+    if (rosetta_aes_set_hw(hw) != 0 || rosetta_aes_hw() != hw) {
+        TEST_FAIL(name, "could not select a supported feature set");
+        return;
+    }
+    if (check_host(why, sizeof(why)) != 0) {
+        TEST_FAIL(name, why);
+        return;
+    }
+    TEST_PASS(name);
+}
+
+static void test_translated(int decrypt)
+{
+    const char *name = decrypt ? "Translated AESD/AESIMC block fuses to AESDEC"
+                               : "Translated AESE/AESMC block fuses to AESENC";
+    uint8_t (*keys)[16] = decrypt ? dk : rk;
+    uint32_t code[20];
+    int n = aes_program(code, decrypt);
+    int r;
+
+    TEST_START(name);
+
+    if (emit_x86(code, n, IR_OPT_ALL) != 0) {
+        TEST_FAIL(name, "block not emitted");
+        return;
+    }
+    if (stats.aes_rounds_fused != 9 ||
+        count_aes(decrypt ? IR_AES_DEC : IR_AES_ENC) != 9 ||
+        count_aes(decrypt ? IR_AES_DECLAST : IR_AES_ENCLAST) != 1 ||
+        count_aes(decrypt ? IR_AES_IMC : IR_AES_MC) != 0 ||
+        count_aes(decrypt ? IR_AES_D : IR_AES_E) != 0) {
+        ir_print(&blk, stdout);
+        TEST_FAIL(name, "rounds not fused one to one");
+        return;
+    }
+
+    memset(&state, 0, sizeof(state));
+    memcpy(state.host.v[0].u8, decrypt ? fips_cipher : fips_plain, 16);
+    for (r = 0; r <= 10; r++) {
+        memcpy(state.host.v[r + 1].u8, keys[r], 16);
+    }
+    run();
+    if (memcmp(state.host.v[0].u8, decrypt ? fips_plain : fips_cipher, 16) != 0) {
+        TEST_FAIL(name, "wrong result");
+        return;
+    }
+    if (memcmp(state.host.v[1].u8, keys[0], 16) != 0 ||
+        memcmp(state.host.v[11].u8, keys[10], 16) != 0 ||
+        state.host.pc != 0x3000u + 4u * (uint64_t)n) {
+        TEST_FAIL(name, "keys or pc clobbered");
+        return;
+    }
+    TEST_PASS(name);
+}
+
+static void test_unpaired(void)
+{
+    const char *name = "Unpaired AES steps";
+    static const uint32_t code[] = {
+        0x4E284862,     /* aese v2, v3 */
+        0x4E2868A4,     /* aesmc v4, v5 */
+        0x4E2878C6,     /* aesimc v6, v6 */
+        0x4E2858E7,     /* aesd v7, v7 */
+        0x4E284928,     /* aese v8, v9 */
+        0x4E28690A,     /* aesmc v10, v8: v8 stays live, no fusion */
+    };
+    uint8_t in[16][16], want[16][16];
+    int i, j;
+
+    TEST_START(name);
+
+    srand(44);
+    for (i = 0; i < 16; i++) {
+        for (j = 0; j < 16; j++) {
+            in[i][j] = (uint8_t)rand();
+        }
+    }
+    memcpy(want, in, sizeof(want));
+    rosetta_aes_step(ROS_AES_E, want[2], in[2], in[3]);
+    rosetta_aes_step(ROS_AES_MC, want[4], in[5], NULL);
+    rosetta_aes_step(ROS_AES_IMC, want[6], in[6], NULL);
+    rosetta_aes_step(ROS_AES_D, want[7], in[7], in[7]);
+    rosetta_aes_step(ROS_AES_E, want[8], in[8], in[9]);
+    rosetta_aes_step(ROS_AES_MC, want[10], want[8], NULL);
+
+    if (emit_x86(code, 6, IR_OPT_ALL) != 0) {
+        TEST_FAIL(name, "block not emitted");
+        return;
+    }
+    if (stats.aes_rounds_fused != 0) {
+        TEST_FAIL(name, "fused a pair whose intermediate is live");
+        return;
+    }
+    memset(&state, 0, sizeof(state));
+    for (i = 0; i < 16; i++) {
+        memcpy(state.host.v[i].u8, in[i], 16);
+    }
+    run();
+    for (i = 0; i < 16; i++) {
+        if (memcmp(state.host.v[i].u8, want[i], 16) != 0) {
+            char why[32];
+            snprintf(why, sizeof(why), "v%d differs", i);
+            TEST_FAIL(name, why);
+            return;
+        }
+    }
+    TEST_PASS(name);
+}
+
+static void test_no_aesni(void)
+{
+    const char *name = "Blocks with AES steps need AES-NI";
+    uint32_t code[20];
+    int n = aes_program(code, 0);
+
+    TEST_START(name);
+
+    rosetta_aes_set_hw(0);
+    if (emit_x86(code, n, IR_OPT_ALL) != -1) {
+        TEST_FAIL(name, "emitted without AES-NI");
+        return;
+    }
+    TEST_PASS(name);
+}
+
+static void test_lowering(void)
+{
+    const char *name = "AES lowering and verification";
+    ir_ref_t a, b, g;
+
+    TEST_START(name);
+
+    ir_block_init(&blk, 0);
+    if (ir_arm64_lower_insn(&blk, a64_aes(IR_AES_E, 0, 1), 0) != 0 ||
+        ir_arm64_lower_insn(&blk, a64_eor16(2, 0, 1), 0) != 0 ||
+        count_aes(IR_AES_E) != 1 || blk.insns[blk.count - 1].size != 16 ||
+        blk.insns[blk.count - 1].reg != IR_ARM64_V0 + 2) {
+        TEST_FAIL(name, "AESE/EOR not lowered");
+        return;
+    }
+
+    /* Vector values do not mix with scalar ones */
+    ir_block_init(&blk, 0);
+    a = ir_get_vreg(&blk, IR_ARM64_V0);
+    g = ir_get_reg(&blk, 0);
+    b = ir_emit(&blk, IR_XOR, 16, a, g, 0);
+    ir_br(&blk, 0);
+    if (ir_verify(&blk) == 0) {
+        TEST_FAIL(name, "vector XOR of a scalar verified");
+        return;
+    }
+    blk.insns[b].op = IR_ADD;
+    blk.insns[b].b = a;
+    if (ir_verify(&blk) == 0) {
+        TEST_FAIL(name, "vector ADD verified");
+        return;
+    }
+    blk.insns[b].op = IR_AES;
+    blk.insns[b].imm = IR_AES_MC;
+    if (ir_verify(&blk) == 0) {
+        TEST_FAIL(name, "AESMC with a key verified");
+        return;
+    }
+    blk.insns[b].b = IR_NONE;
+    if (ir_verify(&blk) != 0) {
+        TEST_FAIL(name, "valid AESMC rejected");
+        return;
+    }
+    TEST_PASS(name);
+}
+
+int main(void)
+{
+    uint32_t supported;
+
+    ir_x86_register_crypto();
+
+    printf("=================================================\n");
+    printf("AES Round Translation Test\n");
+    printf("=================================================\n");
+
+    exec_mem = mmap(NULL, 4096, PROT_READ | PROT_WRITE | PROT_EXEC,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (exec_mem == MAP_FAILED) {
+        perror("mmap");
+        return 1;
+    }
+
+    expand_key();
+    test_lowering();
+    supported = rosetta_aes_hw_supported();
+    test_host(0);
+    if (supported & ROS_AES_HW_AESNI) {
+        test_host(ROS_AES_HW_AESNI);
+        test_translated(0);
+        test_translated(1);
+        test_unpaired();
+    } else {
+        printf("\nAES-NI not available, skipping translated blocks\n");
+    }
+    test_no_aesni();
+    rosetta_aes_set_hw(supported);
+
+    munmap(exec_mem, 4096);
+
+    printf("\n=================================================\n");
+    printf("Results: %d passed, %d failed\n", tests_passed, tests_failed);
+    printf("=================================================\n");
+
+    return tests_failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,395 @@
+/*=============================================================================
+ * ARM64 Immediate Synthesizer Test
+ *=============================================================================
+ *
+ * Checks bitmask immediate encoding, the instruction counts chosen for
+ * typical constants, and runs the generated sequences through a small
+ * interpreter for the instructions the synthesizer emits, so every value
+ * is checked bit for bit without an ARM64 host.
+ *
+ * Build: gcc -std=gnu11 -o test_arm64_imm test_arm64_imm.c rosetta_arm64_emit.c \
+ *            rosetta_ir.c rosetta_ir_from_x86.c rosetta_ir_from_arm64.c \
+ *            rosetta_ir_to_arm64.c rosetta_ir_to_x86.c rosetta_regalloc.c \
+ *            rosetta_emit_x86.c rosetta_insn_cache.c rosetta_translate_mxcsr.c
+ *
+ *=============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "rosetta_arm64_emit.h"
+#include "rosetta_ir.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST_START(name) \
+    printf("\n--- Test: %s ---\n", name)
+
+#define TEST_PASS(name) \
+    do { \
+        tests_passed++; \
+        printf("✅ PASS: %s\n", name); \
+    } while(0)
+
+#define TEST_FAIL(name, reason) \
+    do { \
+        tests_failed++; \
+        printf("❌ FAIL: %s - %s\n", name, reason); \
+    } while(0)
+
+static uint8_t code[4096];
+static code_buffer_t buf;
+
+static void buf_reset(void)
+{
+    memset(&buf, 0, sizeof(buf));
+    buf.buffer = code;
+    buf.size = sizeof(code);
+}
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15ULL;
+
+static uint64_t rng(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+/* ============================================================================
+ * Reference Interpreter
+ * ============================================================================ */
+
+static uint64_t ror_elem(uint64_t v, unsigned r, unsigned size)
+{
+    uint64_t mask = size == 64 ? ~0ULL : (1ULL << size) - 1;
+    return r ? ((v >> r) | (v << (size - r))) & mask : v;
+}
+
+/* DecodeBitMasks() from the architecture manual, wmask only */
+static uint64_t decode_bitmask(uint32_t n, uint32_t immr, uint32_t imms, int is_64)
+{
+    uint32_t combined = (n << 6) | (~imms & 0x3F);
+    unsigned len = 31 - (unsigned)__builtin_clz(combined);
+    unsigned size = 1u << len;
+    unsigned s = imms & (size - 1), r = immr & (size - 1);
+    uint64_t elem = ror_elem((1ULL << (s + 1)) - 1, r, size);
+    uint64_t v = 0;
+    unsigned i;
+
+    for (i = 0; i < 64; i += size) {
+        v |= elem << i;
+    }
+    return is_64 ? v : v & 0xFFFFFFFFULL;
+}
+
+/*
+ * Run words from code[start] until a NOP or the end; pc of code[0] is
+ * base. Returns -1 on an instruction the synthesizer should never emit.
+ */
+static int run(uint64_t *x, uint32_t start, uint32_t end, uint64_t base)
+{
+    uint32_t off;
+
+    for (off = start; off < end; off += 4) {
+        uint32_t w, rd;
+        uint64_t pc = base + off;
+
+        memcpy(&w, code + off, 4);
+        rd = w & 0x1F;
+
+        if (w == 0xD503201F) {
+            break;
+        } else if ((w & 0x7F800000) == 0x52800000 || (w & 0x7F800000) == 0x12800000) {
+            /* MOVZ / MOVN */
+            uint64_t v = (uint64_t)((w >> 5) & 0xFFFF) << (((w >> 21) & 3) * 16);
+            if ((w & 0x7F800000) == 0x12800000) {
+                v = ~v;
+            }
+            x[rd] = (w >> 31) ? v : v & 0xFFFFFFFFULL;
+        } else if ((w & 0x7F800000) == 0x72800000) {
+            unsigned sh = ((w >> 21) & 3) * 16;
+            x[rd] = (x[rd] & ~(0xFFFFULL << sh)) | ((uint64_t)((w >> 5) & 0xFFFF) << sh);
+            if (!(w >> 31)) {
+                x[rd] &= 0xFFFFFFFFULL;
+            }
+        } else if ((w & 0x7F8003E0) == 0x320003E0) {
+            /* ORR Rd, ZR, #bitmask */
+            x[rd] = decode_bitmask((w >> 22) & 1, (w >> 16) & 0x3F, (w >> 10) & 0x3F, w >> 31);
+        } else if ((w & 0x9F000000) == 0x10000000 || (w & 0x9F000000) == 0x90000000) {
+            int64_t imm = (int64_t)((((w >> 5) & 0x7FFFF) << 2) | ((w >> 29) & 3));
+            imm = (imm << 43) >> 43;
+            x[rd] = (w >> 31) ? (pc & ~0xFFFULL) + (uint64_t)(imm << 12) : pc + (uint64_t)imm;
+        } else if ((w & 0xFF800000) == 0x91000000 || (w & 0xFF800000) == 0xD1000000) {
+            uint64_t imm = (w >> 10) & 0xFFF;
+            uint64_t rn = x[(w >> 5) & 0x1F];
+            x[rd] = (w & 0x40000000) ? rn - imm : rn + imm;
+        } else if ((w & 0xFFE0FFE0) == 0xAA0003E0) {
+            x[rd] = x[(w >> 16) & 0x1F];
+        } else if ((w & 0xFF000000) == 0x58000000) {
+            int64_t imm = (int64_t)((w >> 5) & 0x7FFFF);
+            imm = (imm << 45) >> 43;
+            memcpy(&x[rd], code + off + imm, 8);
+        } else {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int check_value(uint64_t value, int *insns)
+{
+    uint64_t x[32];
+
+    buf_reset();
+    *insns = emit_mov_imm64(&buf, 3, value);
+    memset(x, 0xA5, sizeof(x));
+    return run(x, 0, buf.offset, 0) == 0 && x[3] == value;
+}
+
+/* ============================================================================
+ * Encodings
+ * ============================================================================ */
+
+static void test_bitmask_encoding(void)
+{
+    static const unsigned sizes[] = { 2, 4, 8, 16, 32, 64 };
+    uint32_t bad;
+    int s, i;
+
+    TEST_START("Bitmask immediates round-trip");
+    for (s = 0; s < 6; s++) {
+        unsigned size = sizes[s], ones, rot;
+
+        for (ones = 1; ones < size; ones++) {
+            for (rot = 0; rot < size; rot++) {
+                uint64_t elem = ror_elem((1ULL << ones) - 1, rot, size), v = 0;
+                uint32_t enc;
+
+                for (i = 0; i < 64; i += (int)size) {
+                    v |= elem << i;
+                }
+                if (!arm64_encode_bitmask_imm(v, 1, &enc) ||
+                    decode_bitmask((enc >> 22) & 1, (enc >> 16) & 0x3F, (enc >> 10) & 0x3F, 1) != v) {
+                    TEST_FAIL("Bitmask round-trip", "valid pattern rejected or misencoded");
+                    return;
+                }
+            }
+        }
+    }
+
+    /* Random values: anything accepted must decode back */
+    for (i = 0; i < 100000; i++) {
+        uint64_t v = rng();
+        uint32_t enc;
+
+        if (arm64_encode_bitmask_imm(v, 1, &enc) &&
+            decode_bitmask((enc >> 22) & 1, (enc >> 16) & 0x3F, (enc >> 10) & 0x3F, 1) != v) {
+            TEST_FAIL("Bitmask round-trip", "random value misencoded");
+            return;
+        }
+    }
+    if (arm64_encode_bitmask_imm(0, 1, &bad) || arm64_encode_bitmask_imm(~0ULL, 1, &bad) ||
+        arm64_encode_bitmask_imm(0x1234, 1, &bad)) {
+        TEST_FAIL("Bitmask round-trip", "unencodable value accepted");
+        return;
+    }
+    TEST_PASS("Bitmask round-trip");
+}
+
+static void test_costs(void)
+{
+    static const struct {
+        uint64_t value;
+        int insns;
+    } cases[] = {
+        { 0, 1 },
+        { ~0ULL, 1 },
+        { 0x1234, 1 },
+        { 0xFFFFFFFFFFFF1234ULL, 1 },         /* MOVN */
+        { 0x00000000FFFF1234ULL, 1 },         /* MOVN W */
+        { 0x5555555555555555ULL, 1 },         /* ORR bitmask */
+        { 0x00000000FFFFFF00ULL, 1 },         /* ORR W bitmask */
+        { 0x0F0F0F0F0F0F0F0FULL, 1 },
+        { 0x12345678, 2 },
+        { 0x00FF00FF00FF1234ULL, 2 },         /* ORR + MOVK */
+        { 0x0000700000001234ULL, 2 },
+        { 0x0123456789ABCDEFULL, 4 },
+    };
+    size_t i;
+
+    TEST_START("Instruction counts for typical constants");
+    for (i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        int n;
+
+        if (!check_value(cases[i].value, &n) || n != cases[i].insns) {
+            printf("  0x%016llx: %d instructions, expected %d\n",
+                   (unsigned long long)cases[i].value, n, cases[i].insns);
+            TEST_FAIL("Costs", "wrong sequence");
+            return;
+        }
+    }
+    TEST_PASS("Costs");
+}
+
+static void test_random_values(void)
+{
+    int i, n;
+
+    TEST_START("Random constants materialize exactly");
+    for (i = 0; i < 200000; i++) {
+        uint64_t v = rng();
+
+        /* Mix in sparse and repeating shapes */
+        switch (i & 3) {
+        case 1: v &= rng() & rng(); break;
+        case 2: v |= rng() | rng(); break;
+        case 3: v = (v & 0xFFFF) * 0x0001000100010001ULL ^ (rng() & 0xFFFF); break;
+        default: break;
+        }
+        if (!check_value(v, &n) || n > 4) {
+            printf("  0x%016llx\n", (unsigned long long)v);
+            TEST_FAIL("Random constants", "wrong value");
+            return;
+        }
+    }
+    TEST_PASS("Random constants");
+}
+
+/* ============================================================================
+ * Synthesizer
+ * ============================================================================ */
+
+static void test_cache_and_pool(void)
+{
+    arm64_imm_ctx_t ic;
+    uint64_t x[32];
+    uint32_t after_first;
+
+    TEST_START("Register cache and literal pool");
+    buf_reset();
+    arm64_imm_init(&ic, &buf, 0, 1u << 17);
+
+    arm64_imm_materialize(&ic, 17, 0x0123456789ABCDEFULL);     /* LDR literal */
+    after_first = buf.offset;
+    arm64_imm_materialize(&ic, 17, 0x0123456789ABCDEFULL);     /* nothing */
+    arm64_imm_materialize(&ic, 2, 0x0123456789ABCDEFULL);      /* MOV x2, x17 */
+    arm64_imm_materialize(&ic, 17, 0x0123456789ABCDEFULL + 64); /* ADD x17, x17, #64 */
+    arm64_imm_materialize(&ic, 5, 0xFEDCBA9876543210ULL);      /* second literal */
+    arm64_imm_materialize(&ic, 6, 0xFEDCBA9876543210ULL);      /* shares it */
+    emit_nop(&buf);
+    if (after_first != 4 || ic.reused != 3 || ic.pooled != 3 ||
+        arm64_imm_flush_pool(&ic) != 0) {
+        TEST_FAIL("Cache and pool", "wrong forms chosen");
+        return;
+    }
+    memset(x, 0, sizeof(x));
+    if (run(x, 0, buf.offset, 0) != 0 || x[2] != 0x0123456789ABCDEFULL ||
+        x[17] != 0x0123456789ABCDEFULL + 64 || x[5] != 0xFEDCBA9876543210ULL ||
+        x[6] != x[5] || buf.offset != 6 * 4 + 2 * 8) {
+        TEST_FAIL("Cache and pool", "wrong values or pool layout");
+        return;
+    }
+
+    arm64_imm_invalidate(&ic, 17);
+    after_first = buf.offset;
+    arm64_imm_materialize(&ic, 17, 0x0123456789ABCDEFULL);
+    if (buf.offset != after_first + 4 || ic.reused != 3) {
+        TEST_FAIL("Cache and pool", "invalidated register reused");
+        return;
+    }
+    TEST_PASS("Cache and pool");
+}
+
+static void test_pc_relative(void)
+{
+    const uint64_t base = 0x7F1234560000ULL;
+    arm64_imm_ctx_t ic;
+    uint64_t x[32];
+
+    TEST_START("ADR/ADRP for addresses near the code");
+    buf_reset();
+    arm64_imm_init(&ic, &buf, base, 0);
+    arm64_imm_materialize(&ic, 1, base + 0x40);                /* ADR */
+    arm64_imm_materialize(&ic, 2, base - 0x2345670ULL);        /* ADRP + ADD */
+    arm64_imm_materialize(&ic, 3, base + 0x10000000ULL);       /* ADRP */
+    arm64_imm_materialize(&ic, 4, 0x42);                       /* MOVZ */
+
+    memset(x, 0, sizeof(x));
+    if (ic.pc_relative != 3 || buf.offset != 5 * 4 ||
+        run(x, 0, buf.offset, base) != 0 || x[1] != base + 0x40 ||
+        x[2] != base - 0x2345670ULL || x[3] != base + 0x10000000ULL || x[4] != 0x42) {
+        TEST_FAIL("PC-relative", "wrong forms or values");
+        return;
+    }
+    TEST_PASS("PC-relative");
+}
+
+/* ============================================================================
+ * IR Back-end
+ * ============================================================================ */
+
+static int find_word(uint32_t word)
+{
+    uint32_t off;
+
+    for (off = 0; off + 4 <= buf.offset; off += 4) {
+        uint32_t w;
+        memcpy(&w, code + off, 4);
+        if (w == word) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void test_ir_backend(void)
+{
+    static const uint8_t x86[] = {
+        0x48, 0xB8, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55,    /* mov rax, 0x5555... */
+        0x48, 0xB9, 0xEF, 0xCD, 0xAB, 0x89, 0x67, 0x45, 0x23, 0x01,    /* mov rcx, 0x0123... */
+        0x48, 0x25, 0xFF, 0x00, 0x00, 0x00,                            /* and rax, 0xff */
+    };
+    static ir_block_t blk;
+    uint64_t lit;
+
+    TEST_START("IR back-end constants");
+    ir_block_init(&blk, 0x400000);
+    ir_x86_lower_block(&blk, x86, 0x400000, 3);
+    buf_reset();
+    if (ir_emit_arm64(&blk, &buf) != 0) {
+        TEST_FAIL("IR back-end", "emission failed");
+        return;
+    }
+    memcpy(&lit, code + buf.offset - 8, 8);
+    if (!find_word(0xB200F3E0) ||           /* orr x0, xzr, #0x5555555555555555 */
+        !find_word(0xF2401C00) ||           /* ands x0, x0, #0xff */
+        lit != 0x0123456789ABCDEFULL) {
+        TEST_FAIL("IR back-end", "expected single-instruction forms and a literal");
+        return;
+    }
+    TEST_PASS("IR back-end");
+}
+
+int main(void)
+{
+    printf("=================================================\n");
+    printf("ARM64 Immediate Synthesizer Test\n");
+    printf("=================================================\n");
+
+    test_bitmask_encoding();
+    test_costs();
+    test_random_values();
+    test_cache_and_pool();
+    test_pc_relative();
+    test_ir_backend();
+
+    printf("\n=================================================\n");
+    printf("Results: %d passed, %d failed\n", tests_passed, tests_failed);
+    printf("=================================================\n");
+
+    return tests_failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,337 @@
+/*=============================================================================
+ * Block Profiling Test
+ *=============================================================================
+ *
+ * Runs instrumented ARM64-guest blocks through the x86_64 back-end and
+ * checks the entry and exit counters, looks for the counter updates in
+ * ARM64 back-end output and per-instruction block entries, and checks the
+ * hot block ranking, the statistics hand-off and the symbolized hot spot
+ * dump.
+ *
+ * Build: gcc -std=gnu11 -pthread -o test_block_profile test_block_profile.c \
+ *            rosetta_block_profile.c rosetta_refactored_stats.c \
+ *            rosetta_elf_loader.c rosetta_ir.c rosetta_ir_from_x86.c \
+ *            rosetta_ir_from_arm64.c rosetta_ir_to_arm64.c rosetta_ir_to_x86.c \
+ *            rosetta_regalloc.c rosetta_emit_x86.c rosetta_arm64_emit.c \
+ *            rosetta_insn_cache.c rosetta_translate_mxcsr.c
+ *
+ *=============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include "rosetta_block_profile.h"
+#include "rosetta_refactored_stats.h"
+#include "rosetta_arm64_emit.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST_START(name) \
+    printf("\n--- Test: %s ---\n", name)
+
+#define TEST_PASS(name) \
+    do { \
+        tests_passed++; \
+        printf("✅ PASS: %s\n", name); \
+    } while(0)
+
+#define TEST_FAIL(name, reason) \
+    do { \
+        tests_failed++; \
+        printf("❌ FAIL: %s - %s\n", name, reason); \
+    } while(0)
+
+static ir_block_t blk;
+static uint8_t *exec_mem;
+static ThreadState state;
+
+/* add x0, x1, x2; subs x3, x0, #5; b.eq +8 */
+static const uint32_t subs_beq[] = { 0x8B020020, 0xF1001403, 0x54000040 };
+
+static int find_word(const uint8_t *code, uint32_t size, uint32_t word)
+{
+    uint32_t off;
+
+    for (off = 0; off + 4 <= size; off += 4) {
+        if (memcmp(code + off, &word, 4) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void run(uint8_t *code, uint64_t x1, uint64_t x2)
+{
+    memset(&state, 0, sizeof(state));
+    state.host.x[1] = x1;
+    state.host.x[2] = x2;
+    ((void (*)(ThreadState *))code)(&state);
+}
+
+/* ============================================================================
+ * Tests
+ * ============================================================================ */
+
+static void test_x86_counters(void)
+{
+    const char *name = "x86 back-end entry and exit counters";
+    code_buf_t buf;
+    uint64_t *ctr;
+    int i;
+
+    TEST_START(name);
+    rosetta_profile_set_enabled(1);
+
+    ir_block_init(&blk, 0x1000);
+    ir_arm64_lower_block(&blk, subs_beq, 0x1000, 3);
+    rosetta_profile_instrument(&blk);
+    ctr = blk.exec_counters;
+    code_buf_init(&buf, exec_mem, 4096);
+    if (!ctr || ir_emit_x86(&blk, &buf) != 0) {
+        TEST_FAIL(name, "translation failed");
+        return;
+    }
+
+    for (i = 0; i < 3; i++) {
+        run(exec_mem, 3, 2);                            /* taken */
+    }
+    if (state.host.pc != 0x1010 || state.host.pstate != (NZCV_Z | NZCV_C)) {
+        TEST_FAIL(name, "taken path state changed by instrumentation");
+        return;
+    }
+    for (i = 0; i < 2; i++) {
+        run(exec_mem, 1, 1);                            /* fall-through */
+    }
+    if (state.host.pc != 0x100C || state.host.pstate != NZCV_N) {
+        TEST_FAIL(name, "fall-through state changed by instrumentation");
+        return;
+    }
+
+    printf("  entry=%llu taken=%llu fall=%llu\n",
+           (unsigned long long)ctr[IR_PROF_ENTRY], (unsigned long long)ctr[IR_PROF_TAKEN],
+           (unsigned long long)ctr[IR_PROF_FALLTHROUGH]);
+    if (ctr[IR_PROF_ENTRY] != 5 || ctr[IR_PROF_TAKEN] != 3 ||
+        ctr[IR_PROF_FALLTHROUGH] != 2) {
+        TEST_FAIL(name, "wrong counts");
+        return;
+    }
+    TEST_PASS(name);
+}
+
+static void test_retranslate_and_disable(void)
+{
+    const char *name = "Retranslation shares counters, disabled mode emits none";
+    code_buf_t buf;
+    uint32_t plain_size;
+
+    TEST_START(name);
+
+    /* Same guest pc again, e.g. after a cache flush */
+    ir_block_init(&blk, 0x1000);
+    ir_arm64_lower_block(&blk, subs_beq, 0x1000, 3);
+    rosetta_profile_instrument(&blk);
+    code_buf_init(&buf, exec_mem + 2048, 2048);
+    if (ir_emit_x86(&blk, &buf) != 0) {
+        TEST_FAIL(name, "translation failed");
+        return;
+    }
+    run(exec_mem + 2048, 3, 2);
+    if (blk.exec_counters[IR_PROF_ENTRY] != 6 || blk.exec_counters[IR_PROF_TAKEN] != 4) {
+        TEST_FAIL(name, "retranslated block did not reuse its counters");
+        return;
+    }
+
+    rosetta_profile_set_enabled(0);
+    ir_block_init(&blk, 0x1000);
+    ir_arm64_lower_block(&blk, subs_beq, 0x1000, 3);
+    rosetta_profile_instrument(&blk);
+    code_buf_init(&buf, exec_mem + 2048, 2048);
+    if (blk.exec_counters || ir_emit_x86(&blk, &buf) != 0) {
+        TEST_FAIL(name, "disabled profiling still instrumented");
+        return;
+    }
+    plain_size = (uint32_t)buf.offset;
+    rosetta_profile_set_enabled(1);
+
+    rosetta_profile_instrument(&blk);
+    code_buf_init(&buf, exec_mem + 2048, 2048);
+    ir_emit_x86(&blk, &buf);
+    printf("  plain=%u instrumented=%u bytes\n", plain_size, (uint32_t)buf.offset);
+    if (buf.offset <= plain_size) {
+        TEST_FAIL(name, "instrumented block not larger");
+        return;
+    }
+    TEST_PASS(name);
+}
+
+static void test_arm64_counters(void)
+{
+    const char *name = "ARM64 back-end counter updates";
+    /* add rax, rbx; cmp rax, rcx; jne +0x10 */
+    static const uint8_t code[] = { 0x48, 0x01, 0xD8, 0x48, 0x39, 0xC8, 0x75, 0x10 };
+    static uint8_t out[4096];
+    code_buffer_t buf;
+
+    TEST_START(name);
+    ir_block_init(&blk, 0x400000);
+    ir_x86_lower_block(&blk, code, 0x400000, 16);
+    rosetta_profile_instrument(&blk);
+
+    memset(&buf, 0, sizeof(buf));
+    buf.buffer = out;
+    buf.size = sizeof(out);
+    if (!blk.exec_counters || ir_emit_arm64(&blk, &buf) != 0) {
+        TEST_FAIL(name, "emission failed");
+        return;
+    }
+
+    if (!find_word(out, buf.offset, 0xF9400211) ||     /* ldr x17, [x16] */
+        !find_word(out, buf.offset, 0x91000631) ||     /* add x17, x17, #1 */
+        !find_word(out, buf.offset, 0xF9000211) ||     /* str x17, [x16] */
+        !find_word(out, buf.offset, 0xF9000611) ||     /* str x17, [x16, #8] */
+        !find_word(out, buf.offset, 0xF9000A11)) {     /* str x17, [x16, #16] */
+        TEST_FAIL(name, "counter updates missing");
+        return;
+    }
+    TEST_PASS(name);
+}
+
+static void test_entry_only(void)
+{
+    const char *name = "Per-instruction blocks count entries";
+    static uint8_t out[256];
+    code_buffer_t buf;
+    uint64_t *ctr;
+
+    TEST_START(name);
+    memset(&buf, 0, sizeof(buf));
+    buf.buffer = out;
+    buf.size = sizeof(out);
+    ctr = rosetta_profile_emit_entry(&buf, 0x500000);
+    if (!ctr || ctr != rosetta_profile_counters(0x500000, 4)) {
+        TEST_FAIL(name, "no counters for the block");
+        return;
+    }
+    if (buf.offset > 6 * 4 ||
+        !find_word(out, buf.offset, 0xF9400211) ||     /* ldr x17, [x16] */
+        !find_word(out, buf.offset, 0x91000631) ||     /* add x17, x17, #1 */
+        !find_word(out, buf.offset, 0xF9000211)) {     /* str x17, [x16] */
+        TEST_FAIL(name, "entry count missing");
+        return;
+    }
+
+    rosetta_profile_set_enabled(0);
+    buf.offset = 0;
+    ctr = rosetta_profile_emit_entry(&buf, 0x500000);
+    rosetta_profile_set_enabled(1);
+    if (ctr || buf.offset != 0) {
+        TEST_FAIL(name, "disabled profiling still emitted");
+        return;
+    }
+    TEST_PASS(name);
+}
+
+static void test_reporting(void)
+{
+    const char *name = "Hot blocks, stats hand-off and dump";
+    static char strtab[] = "\0cold_fn\0hot_loop";
+    static elf64_sym_t syms[3];
+    rosetta_elf_binary_t bin;
+    rosetta_block_profile_t hot[4];
+    rosetta_block_stats_t bs[2];
+    uint64_t *cold, *warm;
+    char *text = NULL;
+    size_t text_len = 0, n;
+    FILE *f;
+
+    TEST_START(name);
+
+    /* 0x1000 has 6 entries from the earlier tests */
+    cold = rosetta_profile_counters(0x2000, 4);
+    warm = rosetta_profile_counters(0x3000, 2);
+    cold[IR_PROF_ENTRY] = 1;
+    warm[IR_PROF_ENTRY] = 4;
+
+    n = rosetta_profile_hot_blocks(hot, 2);
+    if (n != 2 || hot[0].guest_pc != 0x1000 || hot[1].guest_pc != 0x3000 ||
+        hot[0].counters[IR_PROF_ENTRY] != 6) {
+        TEST_FAIL(name, "wrong hot block ranking");
+        return;
+    }
+
+    rosetta_stats_init();
+    rosetta_stats_record_block(0x2000, 0, 16, 40, 4);
+    rosetta_stats_record_block(0x1000, 0, 12, 60, 3);
+    rosetta_profile_publish();
+    if (rosetta_stats_get_hot_blocks(bs, 2) != 2 || bs[0].guest_pc != 0x1000 ||
+        bs[0].hit_count != 6 || bs[1].hit_count != 1) {
+        TEST_FAIL(name, "stats hot blocks not fed by the profile");
+        return;
+    }
+
+    /* Minimal symbol table: hot_loop covers 0x1000-0x10ff */
+    memset(&bin, 0, sizeof(bin));
+    syms[1].st_name = 1;
+    syms[1].st_info = STT_FUNC;
+    syms[1].st_value = 0x2000;
+    syms[1].st_size = 0x40;
+    syms[2].st_name = 9;
+    syms[2].st_info = STT_FUNC;
+    syms[2].st_value = 0xFF0;
+    syms[2].st_size = 0x100;
+    bin.symtab = syms;
+    bin.symtab_count = 3;
+    bin.strtab = strtab;
+    bin.strtab_size = sizeof(strtab);
+
+    f = open_memstream(&text, &text_len);
+    rosetta_profile_dump(f, &bin, 3);
+    fclose(f);
+    printf("%s", text);
+
+    if (!strstr(text, "hot_loop+0x10") || !strstr(text, "cold_fn+0x0") ||
+        !strstr(text, "Block entries: 11") || !strstr(text, " 54.5%")) {
+        free(text);
+        TEST_FAIL(name, "dump missing symbols or shares");
+        return;
+    }
+    free(text);
+
+    rosetta_profile_reset();
+    if (rosetta_profile_hot_blocks(hot, 1) != 1 || hot[0].counters[IR_PROF_ENTRY] != 0) {
+        TEST_FAIL(name, "reset left counts behind");
+        return;
+    }
+    TEST_PASS(name);
+}
+
+int main(void)
+{
+    printf("=================================================\n");
+    printf("Block Profiling Test\n");
+    printf("=================================================\n");
+
+    exec_mem = mmap(NULL, 4096, PROT_READ | PROT_WRITE | PROT_EXEC,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (exec_mem == MAP_FAILED) {
+        perror("mmap");
+        return 1;
+    }
+
+    test_x86_counters();
+    test_retranslate_and_disable();
+    test_arm64_counters();
+    test_entry_only();
+    test_reporting();
+
+    munmap(exec_mem, 4096);
+
+    printf("\n=================================================\n");
+    printf("Results: %d passed, %d failed\n", tests_passed, tests_failed);
+    printf("=================================================\n");
+
+    return tests_failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,371 @@
+/*=============================================================================
+ * CRC32 / CRC32C Translation Test
+ *=============================================================================
+ *
+ * Checks the host CRC library and translated ARM64 CRC32{B,H,W,X} and
+ * CRC32C{B,H,W,X} against a bit-at-a-time reference, once for every
+ * combination of SSE4.2 and PCLMULQDQ the host has (none = tables), and
+ * that a run of CRC32X is fused into one folded chain that still computes
+ * the same result.
+ *
+ * Build: gcc -std=gnu11 -o test_crc32 test_crc32.c rosetta_crc32.c rosetta_aes.c \
+ *            rosetta_ir_opt.c rosetta_ir.c rosetta_ir_from_x86.c \
+ *            rosetta_ir_from_arm64.c rosetta_ir_to_arm64.c rosetta_ir_to_x86.c \
+ *            rosetta_ir_to_x86_crypto.c rosetta_regalloc.c rosetta_emit_x86.c \
+ *            rosetta_arm64_emit.c rosetta_insn_cache.c \
+ *            rosetta_translate_mxcsr.c rosetta_sha.c \
+ *            rosetta_pmull.c
+ *
+ *=============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include "rosetta_crc32.h"
+#include "rosetta_ir_opt.h"
+#include "rosetta_ir_to_x86.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST_START(name) \
+    printf("\n--- Test: %s ---\n", name)
+
+#define TEST_PASS(name) \
+    do { \
+        tests_passed++; \
+        printf("✅ PASS: %s\n", name); \
+    } while(0)
+
+#define TEST_FAIL(name, reason) \
+    do { \
+        tests_failed++; \
+        printf("❌ FAIL: %s - %s\n", name, reason); \
+    } while(0)
+
+static ir_block_t blk;
+static ir_opt_stats_t stats;
+static uint8_t *exec_mem;
+static ThreadState state;
+static uint64_t rng = 0x9E3779B97F4A7C15ull;
+
+static uint64_t next_rand(void)
+{
+    rng ^= rng << 13;
+    rng ^= rng >> 7;
+    rng ^= rng << 17;
+    return rng;
+}
+
+/* ARM64 CRC32: reflected, no inversion, low `bytes` bytes of data */
+static uint32_t crc_ref(int castagnoli, uint32_t crc, uint64_t data, unsigned bytes)
+{
+    uint32_t poly = castagnoli ? 0x82F63B78u : 0xEDB88320u;
+    unsigned i;
+    int b;
+
+    for (i = 0; i < bytes; i++) {
+        crc ^= (uint8_t)(data >> (i * 8));
+        for (b = 0; b < 8; b++) {
+            crc = (crc >> 1) ^ ((crc & 1) ? poly : 0);
+        }
+    }
+    return crc;
+}
+
+/* CRC32{C}{B,H,W,X} Wd, Wn, Rm */
+static uint32_t a64_crc32(int castagnoli, int sz, int rd, int rn, int rm)
+{
+    return ((uint32_t)(sz == 3) << 31) | 0x1AC04000u | ((uint32_t)rm << 16) |
+           ((uint32_t)castagnoli << 12) | ((uint32_t)sz << 10) | ((uint32_t)rn << 5) |
+           (uint32_t)rd;
+}
+
+static int count_op(ir_op_t op)
+{
+    int i, n = 0;
+
+    for (i = 0; i < blk.count; i++) {
+        n += (blk.insns[i].op == op);
+    }
+    return n;
+}
+
+static int emit_x86(const uint32_t *code, int n, uint32_t passes)
+{
+    code_buf_t buf;
+
+    ir_block_init(&blk, 0x3000);
+    if (ir_arm64_lower_block(&blk, code, 0x3000, n) != n ||
+        ir_optimize(&blk, passes, &stats) != 0) {
+        return -1;
+    }
+    code_buf_init(&buf, exec_mem, 4096);
+    return ir_emit_x86(&blk, &buf);
+}
+
+static void run(void)
+{
+    ((void (*)(ThreadState *))exec_mem)(&state);
+}
+
+/* ============================================================================
+ * Tests (run once per host feature set)
+ * ============================================================================ */
+
+static int check_host(char *why, size_t why_len)
+{
+    uint8_t buf[200];
+    int c, it;
+    size_t len;
+
+    for (c = 0; c < 2; c++) {
+        for (it = 0; it < 4000; it++) {
+            uint32_t crc = (uint32_t)next_rand();
+            uint64_t data = next_rand();
+            unsigned bytes = 1u << (it & 3);
+
+            if (rosetta_crc32_step((rosetta_crc32_poly_t)c, crc, data, bytes) !=
+                crc_ref(c, crc, data, bytes)) {
+                snprintf(why, why_len, "step poly=%d bytes=%u", c, bytes);
+                return -1;
+            }
+        }
+        for (len = 0; len < sizeof(buf); len++) {
+            uint32_t expect = 0x12345678;
+            size_t i;
+
+            buf[len] = (uint8_t)next_rand();
+            for (i = 0; i <= len; i++) {
+                expect = crc_ref(c, expect, buf[i], 1);
+            }
+            if (rosetta_crc32_buf((rosetta_crc32_poly_t)c, 0x12345678, buf, len + 1) != expect) {
+                snprintf(why, why_len, "buf poly=%d len=%zu", c, len + 1);
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+static int check_translated_steps(char *why, size_t why_len)
+{
+    int c, sz, it;
+
+    for (c = 0; c < 2; c++)
+    for (sz = 0; sz < 4; sz++) {
+        /* Separate registers, then the accumulator updated in place */
+        const uint32_t code[2] = { a64_crc32(c, sz, 0, 1, 2), a64_crc32(c, sz, 3, 3, 2) };
+        unsigned bytes = 1u << sz;
+
+        if (emit_x86(code, 2, 0) != 0) {
+            snprintf(why, why_len, "emit poly=%d bytes=%u", c, bytes);
+            return -1;
+        }
+        for (it = 0; it < 200; it++) {
+            uint64_t x1 = next_rand(), x2 = next_rand(), x3 = next_rand();
+            uint32_t r0 = crc_ref(c, (uint32_t)x1, x2, bytes);
+            uint32_t r3 = crc_ref(c, (uint32_t)x3, x2, bytes);
+
+            memset(&state, 0, sizeof(state));
+            state.host.x[1] = x1;
+            state.host.x[2] = x2;
+            state.host.x[3] = x3;
+            run();
+            if (state.host.x[0] != r0 || state.host.x[3] != r3 ||
+                state.host.x[1] != x1 || state.host.x[2] != x2 || state.host.pc != 0x3008) {
+                snprintf(why, why_len, "poly=%d bytes=%u x0=%#llx want %#x", c, bytes,
+                         (unsigned long long)state.host.x[0], r0);
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+static int check_fused_chain(char *why, size_t why_len)
+{
+    static const uint32_t chain[] = {
+        0x9AC14C00,     /* crc32x w0, w0, x1 */
+        0x9AC24C00,     /* crc32x w0, w0, x2 */
+        0x9AC34C00,     /* crc32x w0, w0, x3 */
+        0x9AC44C00,     /* crc32x w0, w0, x4 */
+    };
+    /* The middle value is also written to x5, so the chain splits there */
+    static const uint32_t split[] = {
+        0x9AC14C05,     /* crc32x w5, w0, x1 */
+        0x9AC24CA0,     /* crc32x w0, w5, x2 */
+        0x9AC34C00,     /* crc32x w0, w0, x3 */
+    };
+    int it, r;
+
+    if (chain[0] != a64_crc32(0, 3, 0, 0, 1) || split[1] != a64_crc32(0, 3, 0, 5, 2)) {
+        snprintf(why, why_len, "test encodings");
+        return -1;
+    }
+
+    memset(&stats, 0, sizeof(stats));
+    if (emit_x86(chain, 4, IR_OPT_ALL) != 0) {
+        snprintf(why, why_len, "emit chain");
+        return -1;
+    }
+    if (stats.crcs_fused != 3 || count_op(IR_CRC32_FOLD) != 3 || count_op(IR_CRC32) != 1) {
+        snprintf(why, why_len, "chain: %u fused, %d folds", stats.crcs_fused,
+                 count_op(IR_CRC32_FOLD));
+        return -1;
+    }
+    for (it = 0; it < 500; it++) {
+        uint64_t x0 = next_rand();
+        uint32_t expect = (uint32_t)x0;
+
+        memset(&state, 0, sizeof(state));
+        state.host.x[0] = x0;
+        for (r = 1; r <= 4; r++) {
+            state.host.x[r] = next_rand();
+            expect = crc_ref(0, expect, state.host.x[r], 8);
+        }
+        run();
+        if (state.host.x[0] != expect) {
+            snprintf(why, why_len, "chain result %#llx want %#x",
+                     (unsigned long long)state.host.x[0], expect);
+            return -1;
+        }
+    }
+
+    memset(&stats, 0, sizeof(stats));
+    if (emit_x86(split, 3, IR_OPT_ALL) != 0) {
+        snprintf(why, why_len, "emit split chain");
+        return -1;
+    }
+    if (stats.crcs_fused != 1) {
+        snprintf(why, why_len, "split chain: %u fused", stats.crcs_fused);
+        return -1;
+    }
+    for (it = 0; it < 500; it++) {
+        uint64_t x0 = next_rand(), x1 = next_rand(), x2 = next_rand(), x3 = next_rand();
+        uint32_t x5 = crc_ref(0, (uint32_t)x0, x1, 8);
+        uint32_t expect = crc_ref(0, crc_ref(0, x5, x2, 8), x3, 8);
+
+        memset(&state, 0, sizeof(state));
+        state.host.x[0] = x0;
+        state.host.x[1] = x1;
+        state.host.x[2] = x2;
+        state.host.x[3] = x3;
+        run();
+        if (state.host.x[0] != expect || state.host.x[5] != x5) {
+            snprintf(why, why_len, "split chain result");
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* ============================================================================
+ * Driver
+ * ============================================================================ */
+
+static void test_hw(uint32_t hw)
+{
+    char name[96];
+    char why[128];
+
+    snprintf(name, sizeof(name), "CRC with%s%s%s", hw ? "" : " tables only",
+             (hw & ROS_CRC32_HW_SSE42) ? " SSE4.2" : "",
+             (hw & ROS_CRC32_HW_PCLMUL) ? " PCLMULQDQ" : "");
+    TEST_START(name);
+
+    if (rosetta_crc32_set_hw(hw) != 0 || rosetta_crc32_hw() != hw) {
+        TEST_FAIL(name, "could not select a supported feature set");
+        return;
+    }
+    if (check_host(why, sizeof(why)) != 0 ||
+        check_translated_steps(why, sizeof(why)) != 0 ||
+        check_fused_chain(why, sizeof(why)) != 0) {
+        TEST_FAIL(name, why);
+        return;
+    }
+    TEST_PASS(name);
+}
+
+static void test_lowering(void)
+{
+    const char *name = "CRC32 lowering and verification";
+
+    TEST_START(name);
+
+    /* sf must match the X form */
+    ir_block_init(&blk, 0);
+    if (ir_arm64_lower_insn(&blk, a64_crc32(0, 3, 0, 1, 2) & 0x7FFFFFFF, 0) != -1 ||
+        ir_arm64_lower_insn(&blk, a64_crc32(1, 0, 0, 1, 2) | 0x80000000u, 0) != -1) {
+        TEST_FAIL(name, "accepted a bad sf bit");
+        return;
+    }
+    if (ir_arm64_lower_insn(&blk, a64_crc32(1, 1, 0, 1, 31), 0) != 0 ||
+        count_op(IR_CRC32) != 1) {
+        TEST_FAIL(name, "CRC32CH not lowered");
+        return;
+    }
+
+    /* A fold may only feed a 64-bit step of the same polynomial */
+    ir_block_init(&blk, 0);
+    {
+        ir_ref_t a = ir_get_reg(&blk, 0), b = ir_get_reg(&blk, 1);
+        ir_ref_t f = ir_emit(&blk, IR_CRC32_FOLD, 8, a, b, IR_CRC_IEEE);
+
+        ir_emit(&blk, IR_CRC32, 4, f, b, IR_CRC_IEEE);
+        ir_br(&blk, 0);
+        if (ir_verify(&blk) == 0) {
+            TEST_FAIL(name, "fold into a 32-bit step verified");
+            return;
+        }
+        blk.insns[blk.count - 2].size = 8;
+        blk.insns[blk.count - 2].imm = IR_CRC_CASTAGNOLI;
+        if (ir_verify(&blk) == 0) {
+            TEST_FAIL(name, "fold into the other polynomial verified");
+            return;
+        }
+        blk.insns[blk.count - 2].imm = IR_CRC_IEEE;
+        if (ir_verify(&blk) != 0) {
+            TEST_FAIL(name, "valid fold rejected");
+            return;
+        }
+    }
+    TEST_PASS(name);
+}
+
+int main(void)
+{
+    uint32_t supported, hw;
+
+    ir_x86_register_crypto();
+
+    printf("=================================================\n");
+    printf("CRC32 / CRC32C Translation Test\n");
+    printf("=================================================\n");
+
+    exec_mem = mmap(NULL, 4096, PROT_READ | PROT_WRITE | PROT_EXEC,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (exec_mem == MAP_FAILED) {
+        perror("mmap");
+        return 1;
+    }
+
+    test_lowering();
+    supported = rosetta_crc32_hw_supported();
+    for (hw = 0; hw <= (ROS_CRC32_HW_SSE42 | ROS_CRC32_HW_PCLMUL); hw++) {
+        if ((hw & supported) == hw) {
+            test_hw(hw);
+        }
+    }
+    rosetta_crc32_set_hw(supported);
+
+    munmap(exec_mem, 4096);
+
+    printf("\n=================================================\n");
+    printf("Results: %d passed, %d failed\n", tests_passed, tests_failed);
+    printf("=================================================\n");
+
+    return tests_failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,322 @@
+/*=============================================================================
+ * Intermediate Representation Test
+ *=============================================================================
+ *
+ * Lowers x86_64 and ARM64 sequences into the IR, checks the verifier and
+ * the ARM64 back-end output, and runs blocks from the x86_64 back-end
+ * natively against a ThreadState.
+ *
+ * Build: gcc -std=gnu11 -o test_ir test_ir.c rosetta_ir.c rosetta_ir_from_x86.c \
+ *            rosetta_ir_from_arm64.c rosetta_ir_to_arm64.c rosetta_ir_to_x86.c \
+ *            rosetta_regalloc.c rosetta_emit_x86.c rosetta_arm64_emit.c \
+ *            rosetta_insn_cache.c rosetta_translate_mxcsr.c
+ *
+ *=============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include "rosetta_ir.h"
+#include "rosetta_arm64_emit.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST_START(name) \
+    printf("\n--- Test: %s ---\n", name)
+
+#define TEST_PASS(name) \
+    do { \
+        tests_passed++; \
+        printf("✅ PASS: %s\n", name); \
+    } while(0)
+
+#define TEST_FAIL(name, reason) \
+    do { \
+        tests_failed++; \
+        printf("❌ FAIL: %s - %s\n", name, reason); \
+    } while(0)
+
+static ir_block_t blk;
+static uint8_t *exec_mem;
+static ThreadState state;
+
+/* Lower ARM64 words, emit x86_64 and run the block once */
+static int run_arm64_block(const uint32_t *code, int n, uint64_t pc)
+{
+    code_buf_t buf;
+
+    ir_block_init(&blk, pc);
+    if (ir_arm64_lower_block(&blk, code, pc, n) != n) {
+        return -1;
+    }
+    code_buf_init(&buf, exec_mem, 4096);
+    if (ir_emit_x86(&blk, &buf) != 0) {
+        return -1;
+    }
+    ((void (*)(ThreadState *))exec_mem)(&state);
+    return 0;
+}
+
+static int find_word(const uint8_t *code, uint32_t size, uint32_t word)
+{
+    uint32_t off;
+
+    for (off = 0; off + 4 <= size; off += 4) {
+        uint32_t w;
+        memcpy(&w, code + off, 4);
+        if (w == word) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* ============================================================================
+ * Front-ends
+ * ============================================================================ */
+
+static void test_x86_lowering(void)
+{
+    /* add rax, rbx; cmp rax, rcx; jne +0x10 */
+    static const uint8_t code[] = { 0x48, 0x01, 0xD8, 0x48, 0x39, 0xC8, 0x75, 0x10 };
+    const ir_insn_t *last;
+
+    TEST_START("x86 ALU + Jcc lowering");
+    ir_block_init(&blk, 0x400000);
+    if (ir_x86_lower_block(&blk, code, 0x400000, 16) != 3) {
+        TEST_FAIL("x86 lowering", "wrong instruction count");
+        return;
+    }
+    last = &blk.insns[blk.count - 1];
+    if (ir_verify(&blk) != 0 || !blk.terminated || last->op != IR_BRCOND ||
+        last->cond != IR_COND_NE || last->imm != 0x400018 || last->imm2 != 0x400008 ||
+        blk.insns[last->a].op != IR_CMP) {
+        ir_print(&blk, stdout);
+        TEST_FAIL("x86 lowering", "unexpected IR");
+        return;
+    }
+    TEST_PASS("x86 lowering");
+}
+
+static void test_x86_unsupported(void)
+{
+    static const uint8_t ud2[] = { 0x0F, 0x0B };
+    uint16_t count;
+
+    TEST_START("x86 unsupported instruction");
+    ir_block_init(&blk, 0x1000);
+    ir_get_reg(&blk, 0);
+    count = blk.count;
+    if (ir_x86_lower_insn(&blk, ud2, 0x1000) != -1 || blk.count != count) {
+        TEST_FAIL("x86 unsupported", "block modified");
+        return;
+    }
+    TEST_PASS("x86 unsupported");
+}
+
+static void test_arm64_lowering(void)
+{
+    /* adds x0, x1, #4; b.ne +8 */
+    static const uint32_t code[] = { 0xB1001020, 0x54000041 };
+    const ir_insn_t *last;
+
+    TEST_START("ARM64 ADDS + B.cond lowering");
+    ir_block_init(&blk, 0x2000);
+    if (ir_arm64_lower_block(&blk, code, 0x2000, 8) != 2) {
+        TEST_FAIL("ARM64 lowering", "wrong instruction count");
+        return;
+    }
+    last = &blk.insns[blk.count - 1];
+    if (ir_verify(&blk) != 0 || last->op != IR_BRCOND || last->cond != IR_COND_NE ||
+        last->imm != 0x200C || last->imm2 != 0x2008 || blk.flags_ref != last->a) {
+        ir_print(&blk, stdout);
+        TEST_FAIL("ARM64 lowering", "unexpected IR");
+        return;
+    }
+    TEST_PASS("ARM64 lowering");
+}
+
+static void test_verify_rejects(void)
+{
+    ir_ref_t v;
+
+    TEST_START("Verifier rejects forward reference");
+    ir_block_init(&blk, 0);
+    v = ir_const(&blk, 1);
+    ir_emit(&blk, IR_ADD, 8, v, (ir_ref_t)(v + 5), 0);
+    ir_br(&blk, 0);
+    if (ir_verify(&blk) != -2) {
+        TEST_FAIL("Verifier", "bad operand accepted");
+        return;
+    }
+    TEST_PASS("Verifier");
+}
+
+/* ============================================================================
+ * Back-ends
+ * ============================================================================ */
+
+static void test_arm64_backend(void)
+{
+    static const uint8_t code[] = { 0x48, 0x01, 0xD8, 0x48, 0x39, 0xC8, 0x75, 0x10 };
+    static uint8_t out[4096];
+    code_buffer_t buf;
+
+    TEST_START("ARM64 back-end");
+    ir_block_init(&blk, 0x400000);
+    ir_x86_lower_block(&blk, code, 0x400000, 16);
+
+    memset(&buf, 0, sizeof(buf));
+    buf.buffer = out;
+    buf.size = sizeof(out);
+    if (ir_emit_arm64(&blk, &buf) != 0) {
+        TEST_FAIL("ARM64 back-end", "emission failed");
+        return;
+    }
+
+    /* Result goes straight into RAX's home register */
+    if (!find_word(out, buf.offset, 0xAB030000) ||         /* adds x0, x0, x3 */
+        !find_word(out, buf.offset, 0xEB01001F) ||         /* cmp x0, x1 */
+        !find_word(out, buf.offset, 0xD65F03C0)) {         /* ret */
+        TEST_FAIL("ARM64 back-end", "expected instructions missing");
+        return;
+    }
+    TEST_PASS("ARM64 back-end");
+}
+
+/* Helper calls keep guest XMM0-15 (Q0-Q15) across the C call */
+static void test_arm64_call(void)
+{
+    static const uint8_t code[] = { 0x0F, 0x05, 0xC3 };      /* syscall; ret */
+    static uint8_t out[4096];
+    code_buffer_t buf;
+
+    TEST_START("ARM64 helper call");
+    ir_block_init(&blk, 0x400000);
+    blk.syscall_helper = 0x12345678;
+    ir_x86_lower_block(&blk, code, 0x400000, 16);
+
+    memset(&buf, 0, sizeof(buf));
+    buf.buffer = out;
+    buf.size = sizeof(out);
+    if (ir_emit_arm64(&blk, &buf) != 0) {
+        TEST_FAIL("ARM64 helper call", "emission failed");
+        return;
+    }
+    if (!find_word(out, buf.offset, 0xD10403FF) ||         /* sub sp, sp, #256 */
+        !find_word(out, buf.offset, 0xAD0007E0) ||         /* stp q0, q1, [sp] */
+        !find_word(out, buf.offset, 0xAD073FEE) ||         /* stp q14, q15, [sp, #224] */
+        !find_word(out, buf.offset, 0xAD4007E0) ||         /* ldp q0, q1, [sp] */
+        !find_word(out, buf.offset, 0xAD473FEE) ||         /* ldp q14, q15, [sp, #224] */
+        !find_word(out, buf.offset, 0x910403FF)) {         /* add sp, sp, #256 */
+        TEST_FAIL("ARM64 helper call", "Q0-Q15 not saved around the call");
+        return;
+    }
+    TEST_PASS("ARM64 helper call");
+}
+
+static void test_x86_backend_branch(void)
+{
+    /* add x0, x1, x2; subs x3, x0, #5; b.eq +8 */
+    static const uint32_t code[] = { 0x8B020020, 0xF1001403, 0x54000040 };
+
+    TEST_START("x86 back-end: SUBS + B.EQ");
+    memset(&state, 0, sizeof(state));
+    state.host.x[1] = 3;
+    state.host.x[2] = 2;
+    if (run_arm64_block(code, 3, 0x1000) != 0) {
+        TEST_FAIL("SUBS + B.EQ", "translation failed");
+        return;
+    }
+    if (state.host.x[0] != 5 || state.host.x[3] != 0 || state.host.pc != 0x1010 ||
+        state.host.pstate != (NZCV_Z | NZCV_C)) {
+        TEST_FAIL("SUBS + B.EQ", "taken path state wrong");
+        return;
+    }
+
+    memset(&state, 0, sizeof(state));
+    state.host.x[1] = 1;
+    state.host.x[2] = 1;
+    ((void (*)(ThreadState *))exec_mem)(&state);
+    if (state.host.x[3] != (uint64_t)-3 || state.host.pc != 0x100C ||
+        state.host.pstate != NZCV_N) {
+        TEST_FAIL("SUBS + B.EQ", "fall-through state wrong");
+        return;
+    }
+    TEST_PASS("SUBS + B.EQ");
+}
+
+static void test_x86_backend_memory(void)
+{
+    /* ldr x0, [x1, #8]; str x0, [x1, #16] */
+    static const uint32_t code[] = { 0xF9400420, 0xF9000820 };
+    uint64_t data[3] = { 0, 0x1122334455667788ULL, 0 };
+
+    TEST_START("x86 back-end: LDR/STR");
+    memset(&state, 0, sizeof(state));
+    state.host.x[1] = (uint64_t)(uintptr_t)data;
+    if (run_arm64_block(code, 2, 0x3000) != 0) {
+        TEST_FAIL("LDR/STR", "translation failed");
+        return;
+    }
+    if (state.host.x[0] != data[1] || data[2] != data[1] || state.host.pc != 0x3008) {
+        TEST_FAIL("LDR/STR", "wrong memory or register state");
+        return;
+    }
+    TEST_PASS("LDR/STR");
+}
+
+static void test_x86_backend_cbz_flags(void)
+{
+    /* subs x0, x0, #1; cbz x1, +8 -- CBZ must not replace the guest flags */
+    static const uint32_t code[] = { 0xF1000400, 0xB4000041 };
+
+    TEST_START("x86 back-end: CBZ keeps NZCV");
+    memset(&state, 0, sizeof(state));
+    state.host.x[0] = 1;
+    if (run_arm64_block(code, 2, 0x4000) != 0) {
+        TEST_FAIL("CBZ keeps NZCV", "translation failed");
+        return;
+    }
+    if (state.host.x[0] != 0 || state.host.pc != 0x400C ||
+        state.host.pstate != (NZCV_Z | NZCV_C)) {
+        TEST_FAIL("CBZ keeps NZCV", "wrong pc or flags");
+        return;
+    }
+    TEST_PASS("CBZ keeps NZCV");
+}
+
+int main(void)
+{
+    printf("=================================================\n");
+    printf("IR Test\n");
+    printf("=================================================\n");
+
+    exec_mem = mmap(NULL, 4096, PROT_READ | PROT_WRITE | PROT_EXEC,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (exec_mem == MAP_FAILED) {
+        perror("mmap");
+        return 1;
+    }
+
+    test_x86_lowering();
+    test_x86_unsupported();
+    test_arm64_lowering();
+    test_verify_rejects();
+    test_arm64_backend();
+    test_arm64_call();
+    test_x86_backend_branch();
+    test_x86_backend_memory();
+    test_x86_backend_cbz_flags();
+
+    munmap(exec_mem, 4096);
+
+    printf("\n=================================================\n");
+    printf("Results: %d passed, %d failed\n", tests_passed, tests_failed);
+    printf("=================================================\n");
+
+    return tests_failed > 0 ? 1 : 0;
+}
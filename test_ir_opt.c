@@ -0,0 +1,349 @@
+/*=============================================================================
+ * IR Optimizer Test
+ *=============================================================================
+ *
+ * Runs each optimizer pass on small blocks and checks its statistics and
+ * the resulting instruction count, the address modes the ARM64 back-end
+ * picks for folded x86_64 operands, and that an optimized ARM64 block
+ * still computes the same guest state through the x86_64 back-end.
+ *
+ * Build: gcc -std=gnu11 -o test_ir_opt test_ir_opt.c rosetta_ir_opt.c \
+ *            rosetta_ir.c rosetta_ir_from_x86.c rosetta_ir_from_arm64.c \
+ *            rosetta_ir_to_arm64.c rosetta_ir_to_x86.c rosetta_regalloc.c \
+ *            rosetta_emit_x86.c rosetta_arm64_emit.c rosetta_insn_cache.c \
+ *            rosetta_translate_mxcsr.c
+ *
+ *=============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include "rosetta_ir_opt.h"
+#include "rosetta_arm64_emit.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST_START(name) \
+    printf("\n--- Test: %s ---\n", name)
+
+#define TEST_PASS(name) \
+    do { \
+        tests_passed++; \
+        printf("✅ PASS: %s\n", name); \
+    } while(0)
+
+#define TEST_FAIL(name, reason) \
+    do { \
+        tests_failed++; \
+        printf("❌ FAIL: %s - %s\n", name, reason); \
+    } while(0)
+
+static ir_block_t blk;
+static ir_opt_stats_t stats;
+static uint8_t *exec_mem;
+static ThreadState state;
+
+static int count_op(ir_op_t op)
+{
+    int i, n = 0;
+
+    for (i = 0; i < blk.count; i++) {
+        n += (blk.insns[i].op == op);
+    }
+    return n;
+}
+
+static int find_word(const uint8_t *code, uint32_t size, uint32_t word)
+{
+    uint32_t off;
+
+    for (off = 0; off + 4 <= size; off += 4) {
+        uint32_t w;
+        memcpy(&w, code + off, 4);
+        if (w == word) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* ============================================================================
+ * Passes
+ * ============================================================================ */
+
+static void test_const_prop(void)
+{
+    ir_ref_t v;
+
+    TEST_START("Constant folding");
+    memset(&stats, 0, sizeof(stats));
+    ir_block_init(&blk, 0);
+    v = ir_emit(&blk, IR_ADD, 8, ir_const(&blk, 5), ir_const(&blk, 7), 0);
+    v = ir_emit(&blk, IR_SHL, 8, v, ir_const(&blk, 2), 0);
+    v = ir_emit(&blk, IR_ADD, 4, v, ir_const(&blk, -1), 0);     /* 32-bit wrap */
+    ir_set_reg(&blk, 0, v);
+    v = ir_emit(&blk, IR_OR, 8, ir_get_reg(&blk, 1), ir_const(&blk, 0), 0);
+    ir_set_reg(&blk, 2, v);
+    ir_br(&blk, 0x100);
+
+    if (ir_optimize(&blk, IR_OPT_ALL, &stats) != 0) {
+        TEST_FAIL("Constant folding", "optimizer failed");
+        return;
+    }
+    if (stats.consts_folded != 4 || blk.count != 5 || blk.insns[1].op != IR_SET_REG ||
+        blk.insns[0].op != IR_CONST || blk.insns[0].imm != 47 ||
+        blk.insns[blk.insns[3].a].op != IR_GET_REG ||
+        stats.insns_in != 13 || stats.insns_out != 5) {
+        TEST_FAIL("Constant folding", "wrong folded block");
+        ir_print(&blk, stdout);
+        return;
+    }
+    TEST_PASS("Constant folding");
+}
+
+static void test_copy_prop_dead_store(void)
+{
+    ir_ref_t v;
+
+    TEST_START("Copy propagation and dead guest stores");
+    memset(&stats, 0, sizeof(stats));
+    ir_block_init(&blk, 0);
+    v = ir_emit(&blk, IR_ADD, 8, ir_get_reg(&blk, 1), ir_const(&blk, 1), 0);
+    ir_set_reg(&blk, 0, v);
+    v = ir_emit(&blk, IR_ADD, 8, ir_get_reg(&blk, 0), ir_const(&blk, 2), 0);
+    ir_set_reg(&blk, 0, v);
+    ir_br(&blk, 0);
+
+    ir_optimize(&blk, IR_OPT_ALL, &stats);
+    if (stats.copies_propagated != 1 || stats.dead_stores != 1 ||
+        count_op(IR_SET_REG) != 1 || count_op(IR_GET_REG) != 1) {
+        TEST_FAIL("Copy propagation", "guest register traffic not removed");
+        return;
+    }
+    TEST_PASS("Copy propagation");
+}
+
+static void test_call_barrier(void)
+{
+    TEST_START("Helper calls keep guest register reads and writes");
+    memset(&stats, 0, sizeof(stats));
+    ir_block_init(&blk, 0);
+    ir_set_reg(&blk, 0, ir_const(&blk, 1));
+    ir_call(&blk, 0x1234);
+    ir_set_reg(&blk, 1, ir_get_reg(&blk, 0));
+    ir_set_reg(&blk, 0, ir_const(&blk, 2));
+    ir_br(&blk, 0);
+
+    ir_optimize(&blk, IR_OPT_ALL, &stats);
+    if (stats.copies_propagated != 0 || stats.dead_stores != 0 ||
+        count_op(IR_SET_REG) != 3 || count_op(IR_GET_REG) != 1) {
+        TEST_FAIL("Call barrier", "optimized across a helper call");
+        return;
+    }
+    TEST_PASS("Call barrier");
+}
+
+static void test_load_elim(void)
+{
+    ir_ref_t base, a, b;
+
+    TEST_START("Redundant loads");
+    memset(&stats, 0, sizeof(stats));
+    ir_block_init(&blk, 0);
+    base = ir_get_reg(&blk, 1);
+    a = ir_load(&blk, 8, base, 8);
+    b = ir_load(&blk, 8, ir_get_reg(&blk, 1), 8);               /* same address */
+    ir_set_reg(&blk, 0, ir_emit(&blk, IR_ADD, 8, a, b, 0));
+    ir_store(&blk, 8, base, 16, a);
+    ir_set_reg(&blk, 2, ir_load(&blk, 8, base, 16));            /* forwarded */
+    ir_set_reg(&blk, 3, ir_load(&blk, 8, base, 8));             /* may alias */
+    ir_br(&blk, 0);
+
+    ir_optimize(&blk, IR_OPT_ALL, &stats);
+    if (stats.loads_eliminated != 3 || count_op(IR_LOAD) != 2 ||
+        count_op(IR_GET_REG) != 1) {
+        TEST_FAIL("Redundant loads", "wrong loads removed");
+        return;
+    }
+    TEST_PASS("Redundant loads");
+}
+
+static void test_flags_kept(void)
+{
+    /* subs x3, x0, #5 (result discarded to xzr); b.eq */
+    static const uint32_t code[] = { 0xF100141F, 0x54000040 };
+
+    TEST_START("Flags producers survive dead code elimination");
+    memset(&stats, 0, sizeof(stats));
+    ir_block_init(&blk, 0x1000);
+    ir_arm64_lower_block(&blk, code, 0x1000, 2);
+
+    if (ir_optimize(&blk, IR_OPT_ALL, &stats) != 0 || count_op(IR_SUB) != 1 ||
+        blk.flags_ref == IR_NONE || blk.insns[blk.flags_ref].op != IR_SUB) {
+        TEST_FAIL("Flags kept", "flags producer removed");
+        return;
+    }
+    TEST_PASS("Flags kept");
+}
+
+/* ============================================================================
+ * Address Modes
+ * ============================================================================ */
+
+static int emit_x86_arm64(const uint8_t *code, uint8_t *out, size_t size, uint32_t *len)
+{
+    code_buffer_t buf;
+
+    memset(&stats, 0, sizeof(stats));
+    ir_block_init(&blk, 0x400000);
+    ir_x86_lower_block(&blk, code, 0x400000, 1);
+    if (ir_optimize(&blk, IR_OPT_ALL, &stats) != 0) {
+        return -1;
+    }
+    memset(&buf, 0, sizeof(buf));
+    buf.buffer = out;
+    buf.size = size;
+    if (ir_emit_arm64(&blk, &buf) != 0) {
+        return -1;
+    }
+    *len = buf.offset;
+    return 0;
+}
+
+static void test_addr_fold_scaled(void)
+{
+    /* mov rax, [rbx + rcx*8] */
+    static const uint8_t code[] = { 0x48, 0x8B, 0x04, 0xCB };
+    static uint8_t out[4096];
+    uint32_t len;
+
+    TEST_START("Scaled index folded into LDR");
+    if (emit_x86_arm64(code, out, sizeof(out), &len) != 0) {
+        TEST_FAIL("Scaled index", "translation failed");
+        return;
+    }
+    if (stats.addrs_folded != 1 || count_op(IR_SHL) != 0 || count_op(IR_ADD) != 0 ||
+        !find_word(out, len, 0x8B030211) ||         /* add x17, x16, x3 */
+        !find_word(out, len, 0xF8617A20)) {         /* ldr x0, [x17, x1, lsl #3] */
+        TEST_FAIL("Scaled index", "expected register-offset load");
+        return;
+    }
+    TEST_PASS("Scaled index");
+}
+
+static void test_addr_fold_disp(void)
+{
+    /* mov rax, [rbx + rcx*8 + 16] */
+    static const uint8_t code[] = { 0x48, 0x8B, 0x44, 0xCB, 0x10 };
+    static uint8_t out[4096];
+    uint32_t len;
+
+    TEST_START("Scaled index with displacement");
+    if (emit_x86_arm64(code, out, sizeof(out), &len) != 0) {
+        TEST_FAIL("Index + disp", "translation failed");
+        return;
+    }
+    if (stats.addrs_folded != 1 || count_op(IR_SHL) != 0 ||
+        !find_word(out, len, 0x8B010C71) ||         /* add x17, x3, x1, lsl #3 */
+        !find_word(out, len, 0xF8716A00)) {         /* ldr x0, [x16, x17] */
+        TEST_FAIL("Index + disp", "expected shifted add and load");
+        return;
+    }
+    TEST_PASS("Index + disp");
+}
+
+/* ============================================================================
+ * Generated Code
+ * ============================================================================ */
+
+static int emit_x86(const uint32_t *code, int n, uint32_t passes, size_t *len)
+{
+    code_buf_t buf;
+
+    ir_block_init(&blk, 0x2000);
+    if (ir_arm64_lower_block(&blk, code, 0x2000, n) != n ||
+        ir_optimize(&blk, passes, &stats) != 0) {
+        return -1;
+    }
+    code_buf_init(&buf, exec_mem, 4096);
+    if (ir_emit_x86(&blk, &buf) != 0) {
+        return -1;
+    }
+    *len = buf.offset;
+    return 0;
+}
+
+static void test_execute(void)
+{
+    static const uint32_t code[] = {
+        0x91002020,     /* add x0, x1, #8 */
+        0xF9400402,     /* ldr x2, [x0, #8] */
+        0x91000400,     /* add x0, x0, #1 */
+        0x91000800,     /* add x0, x0, #2 */
+        0xF9400423,     /* ldr x3, [x1, #8] */
+    };
+    uint64_t data[3] = { 0, 0x55, 0xAA };
+    size_t plain, opt;
+
+    TEST_START("Optimized block runs and shrinks");
+    if (emit_x86(code, 5, 0, &plain) != 0) {
+        TEST_FAIL("Execute", "translation failed");
+        return;
+    }
+    memset(&stats, 0, sizeof(stats));
+    if (emit_x86(code, 5, IR_OPT_ALL, &opt) != 0) {
+        TEST_FAIL("Execute", "translation failed");
+        return;
+    }
+    memset(&state, 0, sizeof(state));
+    state.host.x[1] = (uint64_t)(uintptr_t)data;
+    ((void (*)(ThreadState *))exec_mem)(&state);
+
+    if (state.host.x[0] != state.host.x[1] + 11 || state.host.x[2] != 0xAA ||
+        state.host.x[3] != 0x55 || state.host.pc != 0x2014) {
+        TEST_FAIL("Execute", "wrong guest state");
+        return;
+    }
+    if (opt >= plain || stats.addrs_folded == 0 || stats.dead_stores == 0 ||
+        stats.insns_out >= stats.insns_in) {
+        TEST_FAIL("Execute", "optimized code not smaller");
+        return;
+    }
+    printf("  %zu -> %zu bytes, %u -> %u IR insns\n", plain, opt,
+           stats.insns_in, stats.insns_out);
+    TEST_PASS("Execute");
+}
+
+int main(void)
+{
+    printf("=================================================\n");
+    printf("IR Optimizer Test\n");
+    printf("=================================================\n");
+
+    exec_mem = mmap(NULL, 4096, PROT_READ | PROT_WRITE | PROT_EXEC,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (exec_mem == MAP_FAILED) {
+        perror("mmap");
+        return 1;
+    }
+
+    test_const_prop();
+    test_copy_prop_dead_store();
+    test_call_barrier();
+    test_load_elim();
+    test_flags_kept();
+    test_addr_fold_scaled();
+    test_addr_fold_disp();
+    test_execute();
+
+    munmap(exec_mem, 4096);
+
+    printf("\n=================================================\n");
+    printf("Results: %d passed, %d failed\n", tests_passed, tests_failed);
+    printf("=================================================\n");
+
+    return tests_failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,194 @@
+/*=============================================================================
+ * Leveled Logging Test
+ *=============================================================================
+ *
+ * Checks that disabled levels do not evaluate their arguments, that output
+ * is held in the per-thread buffer until a flush (errors excepted), and that
+ * a thread's buffer is written when the thread exits.
+ *
+ * Build: gcc -std=gnu11 -pthread -o test_log test_log.c rosetta_log.c
+ *
+ *=============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "rosetta_log.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST_START(name) \
+    printf("\n--- Test: %s ---\n", name)
+
+#define TEST_PASS(name) \
+    do { \
+        tests_passed++; \
+        printf("✅ PASS: %s\n", name); \
+    } while(0)
+
+#define TEST_FAIL(name, reason) \
+    do { \
+        tests_failed++; \
+        printf("❌ FAIL: %s - %s\n", name, reason); \
+    } while(0)
+
+static int log_pipe[2];
+
+static int evaluated(int *counter)
+{
+    return ++*counter;
+}
+
+/* Read whatever has reached the pipe so far */
+static size_t drain(char *buf, size_t size)
+{
+    size_t len = 0;
+    ssize_t n;
+
+    while (len + 1 < size && (n = read(log_pipe[0], buf + len, size - 1 - len)) > 0) {
+        len += (size_t)n;
+    }
+    buf[len] = '\0';
+    return len;
+}
+
+/* ============================================================================
+ * Tests
+ * ============================================================================ */
+
+static void test_filtering(void)
+{
+    const char *name = "disabled levels skip argument evaluation";
+    int count = 0;
+
+    TEST_START(name);
+    rosetta_log_set_level(ROS_LOG_LEVEL_TRACE);
+    ROS_LOG_TRACE("%d\n", evaluated(&count));   /* Compiled out at default max */
+    rosetta_log_set_level(ROS_LOG_LEVEL_WARN);
+    ROS_LOG_DEBUG("%d\n", evaluated(&count));   /* Filtered at run time */
+    ROS_LOG_INFO("%d\n", evaluated(&count));
+    ROS_LOG_WARN("%d\n", evaluated(&count));
+
+#if ROSETTA_LOG_MAX_LEVEL >= ROS_LOG_LEVEL_TRACE
+    if (count != 2) {
+#else
+    if (count != 1) {
+#endif
+        TEST_FAIL(name, "wrong number of arguments evaluated");
+        return;
+    }
+    TEST_PASS(name);
+}
+
+static void test_buffering(void)
+{
+    const char *name = "buffered until flush, errors written at once";
+    char buf[256];
+
+    TEST_START(name);
+    drain(buf, sizeof(buf));
+    rosetta_log_set_level(ROS_LOG_LEVEL_INFO);
+
+    ROS_LOG_INFO("[T] block %d\n", 1);
+    ROS_LOG_INFO("[T] block %d\n", 2);
+    if (drain(buf, sizeof(buf)) != 0) {
+        TEST_FAIL(name, "info written before flush");
+        return;
+    }
+
+    ROS_LOG_ERROR("[T] error\n");
+    drain(buf, sizeof(buf));
+    if (strcmp(buf, "[T] block 1\n[T] block 2\n[T] error\n") != 0) {
+        TEST_FAIL(name, "error did not write out the buffer in order");
+        return;
+    }
+
+    ROS_LOG_INFO("[T] tail\n");
+    rosetta_log_flush();
+    drain(buf, sizeof(buf));
+    if (strcmp(buf, "[T] tail\n") != 0) {
+        TEST_FAIL(name, "flush lost output");
+        return;
+    }
+    TEST_PASS(name);
+}
+
+static void test_overflow(void)
+{
+    const char *name = "full buffer is written out";
+    char *buf = malloc(2 * ROS_LOG_BUFFER_SIZE);
+    size_t total = 0;
+    int i;
+
+    TEST_START(name);
+    for (i = 0; i < ROS_LOG_BUFFER_SIZE / 16; i++) {
+        ROS_LOG_INFO("[T] line %06d\n", i);     /* 16 bytes each */
+    }
+    ROS_LOG_INFO("[T] line %06d\n", i);
+    total = drain(buf, 2 * ROS_LOG_BUFFER_SIZE);
+    rosetta_log_flush();
+    total += drain(buf, 2 * ROS_LOG_BUFFER_SIZE);
+    free(buf);
+
+    if (total != (size_t)(i + 1) * 16) {
+        TEST_FAIL(name, "bytes lost across the overflow");
+        return;
+    }
+    TEST_PASS(name);
+}
+
+static void *thread_body(void *arg)
+{
+    (void)arg;
+    ROS_LOG_INFO("[T] from thread\n");
+    return NULL;
+}
+
+static void test_thread_exit(void)
+{
+    const char *name = "thread buffer written at exit";
+    char buf[256];
+    pthread_t t;
+
+    TEST_START(name);
+    pthread_create(&t, NULL, thread_body, NULL);
+    pthread_join(t, NULL);
+    drain(buf, sizeof(buf));
+    if (strcmp(buf, "[T] from thread\n") != 0) {
+        TEST_FAIL(name, "thread output lost");
+        return;
+    }
+    TEST_PASS(name);
+}
+
+int main(void)
+{
+    printf("=================================================\n");
+    printf("Leveled Logging Test\n");
+    printf("=================================================\n");
+
+    if (pipe(log_pipe) != 0) {
+        perror("pipe");
+        return 1;
+    }
+    /* Non-blocking read end so drain() returns once the pipe is empty */
+    fcntl(log_pipe[0], F_SETFL, O_NONBLOCK);
+    rosetta_log_set_fd(log_pipe[1]);
+
+    test_filtering();
+    test_buffering();
+    test_overflow();
+    test_thread_exit();
+
+    rosetta_log_set_fd(STDERR_FILENO);
+
+    printf("\n=================================================\n");
+    printf("Results: %d passed, %d failed\n", tests_passed, tests_failed);
+    printf("=================================================\n");
+
+    return tests_failed > 0 ? 1 : 0;
+}
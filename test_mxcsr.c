@@ -0,0 +1,654 @@
+/*=============================================================================
+ * MXCSR Emulation Test
+ *=============================================================================
+ *
+ * Checks the MXCSR <-> FPCR/FPSR conversions, the runtime entry points on
+ * the emulated FP registers of rosetta_fp_utils.c, and translated
+ * LDMXCSR/STMXCSR run on a small ARM64 interpreter that models FPCR and
+ * FPSR and counts FPCR writes:
+ *
+ * - LDMXCSR installs RMode and FZ, keeps the other FPCR bits, clears FPSR
+ *   and writes FPCR only when the value changes.
+ * - STMXCSR stores guest.mxcsr with the FPSR flags folded in.
+ * - Guest registers, SP and NZCV are preserved, for base, SIB, RIP and
+ *   VEX forms.
+ * - The block tracking drops the FPSR fold and clear when redundant.
+ * - Around a helper call, the guest flags reach guest.mxcsr and the
+ *   helper's flags are dropped.
+ * - The fast-mode x87 environment rounds as the x87 control word selects,
+ *   sends the x87 flags to the status word, and hands FPCR/FPSR back to
+ *   MXCSR before SSE or at the flush.
+ *
+ * Build: gcc -std=gnu11 -o test_mxcsr test_mxcsr.c test_a64_interp.c rosetta_mxcsr.c \
+ *            rosetta_translate_mxcsr.c rosetta_fp_utils.c rosetta_arm64_emit.c \
+ *            rosetta_x86_decode.c rosetta_insn_cache.c -pthread
+ *
+ *=============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include "rosetta_mxcsr.h"
+#include "rosetta_translate_mxcsr.h"
+#include "rosetta_x87.h"
+#include "rosetta_exec_context.h"
+#include "rosetta_arm64_emit.h"
+#include "test_a64_interp.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST_START(name) \
+    printf("\n--- Test: %s ---\n", name)
+
+#define TEST_PASS(name) \
+    do { \
+        tests_passed++; \
+        printf("✅ PASS: %s\n", name); \
+    } while(0)
+
+#define TEST_FAIL(name, reason) \
+    do { \
+        tests_failed++; \
+        printf("❌ FAIL: %s - %s\n", name, reason); \
+    } while(0)
+
+#if defined(__x86_64__)
+
+extern uint32_t read_fpcr(void);
+extern void write_fpcr(uint32_t val);
+extern uint32_t read_fpsr(void);
+extern void write_fpsr(uint32_t val);
+
+static uint64_t rng_state = 0x2545F4914F6CDD1Dull;
+
+static uint64_t rnd(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+/* Random valid MXCSR: flags, DAZ, masks, RC and FZ */
+static uint32_t rnd_mxcsr(void)
+{
+    return (uint32_t)rnd() & 0xFFFF;
+}
+
+/* ============================================================================
+ * Blocks
+ * ============================================================================ */
+
+static ThreadState ts;
+static rosetta_exec_context_t ectx;
+static uint64_t stack[64];
+static uint32_t guest_mem[64];
+
+/* Guest instruction forms, each addressing guest_mem[MEM_SLOT] */
+#define MEM_SLOT    5
+
+enum {
+    F_RSI_D8,           /* [rsi + 8] */
+    F_RSP_D8,           /* [rsp + 8], SIB */
+    F_SIB_D32,          /* [rsi + rcx*4 + 0x1000] */
+    F_R8,               /* [r8 + 8], REX.B */
+    F_RIP,              /* [rip + disp32] */
+    F_VEX,              /* VEX.LZ.0F AE, [rsi + 8] */
+    F_COUNT
+};
+
+/* Encode (V)LDMXCSR (digit 2) or (V)STMXCSR (3); sets the guest registers */
+static int encode(uint8_t *p, int form, int digit, a64_t *c, uint64_t *guest_pc)
+{
+    uint64_t target = (uint64_t)(uintptr_t)&guest_mem[MEM_SLOT];
+    int n = 0;
+    int32_t d;
+
+    switch (form) {
+    case F_RSI_D8:
+        c->x[6] = target - 8;
+        p[n++] = 0x0F; p[n++] = 0xAE; p[n++] = (uint8_t)(0x46 | digit << 3); p[n++] = 8;
+        break;
+    case F_RSP_D8:
+        c->x[4] = target - 8;
+        p[n++] = 0x0F; p[n++] = 0xAE; p[n++] = (uint8_t)(0x44 | digit << 3); p[n++] = 0x24; p[n++] = 8;
+        break;
+    case F_SIB_D32:
+        c->x[1] = 3;
+        c->x[6] = target - 0x1000 - 12;
+        p[n++] = 0x0F; p[n++] = 0xAE; p[n++] = (uint8_t)(0x84 | digit << 3); p[n++] = 0x8E;
+        d = 0x1000;
+        memcpy(p + n, &d, 4);
+        n += 4;
+        break;
+    case F_R8:
+        c->x[8] = target - 8;
+        p[n++] = 0x41; p[n++] = 0x0F; p[n++] = 0xAE; p[n++] = (uint8_t)(0x40 | digit << 3); p[n++] = 8;
+        break;
+    case F_RIP:
+        p[n++] = 0x0F; p[n++] = 0xAE; p[n++] = (uint8_t)(0x05 | digit << 3);
+        d = 0x40;
+        memcpy(p + n, &d, 4);
+        n += 4;
+        *guest_pc = target - 0x40 - (uint64_t)n;
+        break;
+    default:
+        c->x[6] = target - 8;
+        p[n++] = 0xC5; p[n++] = 0xF8; p[n++] = 0xAE; p[n++] = (uint8_t)(0x46 | digit << 3); p[n++] = 8;
+        break;
+    }
+    return n;
+}
+
+static void init_cpu(a64_t *c)
+{
+    int i;
+
+    memset(c, 0, sizeof(*c));
+    for (i = 0; i < 31; i++) {
+        c->x[i] = rnd();
+    }
+    c->x[18] = (uint64_t)(uintptr_t)&ectx;
+    c->sp = (uint64_t)(uintptr_t)&stack[48];
+    c->nzcv = (uint32_t)rnd() & 15;
+    c->fpcr = (uint32_t)rnd() & 0x07C00000u;   /* AHP, DN, FZ, RMode */
+    c->fpsr = (uint32_t)rnd() & 0x9Fu;
+}
+
+/* Translate one instruction and run it; returns 0 or -1 (reported) */
+static int run_one(const char *name, a64_t *c, translate_mxcsr_state_t *st, int form, int digit)
+{
+    static uint32_t words[256];
+    uint8_t bytes[16];
+    code_buffer_t buf;
+    x86_insn_t insn;
+    uint64_t guest_pc = 0x400000;
+    size_t bad;
+    int len = encode(bytes, form, digit, c, &guest_pc);
+    char msg[128];
+
+    if (decode_x86_insn(bytes, &insn) != len) {
+        snprintf(msg, sizeof(msg), "form %d: decoded length differs", form);
+        TEST_FAIL(name, msg);
+        return -1;
+    }
+    code_buffer_init_arm64(&buf, (uint8_t *)words, sizeof(words));
+    if (translate_mxcsr_lower(&buf, st, &insn, guest_pc) != 0) {
+        snprintf(msg, sizeof(msg), "form %d: not lowered", form);
+        TEST_FAIL(name, msg);
+        return -1;
+    }
+    bad = a64_run(c, words, code_buffer_get_size_arm64(&buf) / 4);
+    if (bad) {
+        snprintf(msg, sizeof(msg), "form %d: word %zu (%08x) not understood", form, bad - 1,
+                 words[bad - 1]);
+        TEST_FAIL(name, msg);
+        return -1;
+    }
+    return 0;
+}
+
+/* Guest registers, SP and NZCV unchanged (X16/X17 are scratch) */
+static int preserved(const a64_t *before, const a64_t *after)
+{
+    int i;
+
+    for (i = 0; i < 31; i++) {
+        if (i != 16 && i != 17 && before->x[i] != after->x[i]) {
+            return 0;
+        }
+    }
+    return before->sp == after->sp && before->nzcv == after->nzcv;
+}
+
+/* ============================================================================
+ * Tests
+ * ============================================================================ */
+
+static void test_conversions(void)
+{
+    static const uint32_t rmode_of_rc[4] = { 0, 2, 1, 3 };     /* RN, RM, RP, RZ */
+    const char *name = "MXCSR to FPCR and FPSR to MXCSR";
+    uint32_t m, f;
+
+    TEST_START(name);
+    for (m = 0; m < 0x10000; m++) {
+        uint32_t want = rmode_of_rc[(m >> 13) & 3] << 22 | ((m & 0x8040) ? 1u << 24 : 0);
+        if (rosetta_mxcsr_to_fpcr(m) != want) {
+            TEST_FAIL(name, "rounding mode or flush-to-zero");
+            return;
+        }
+    }
+    for (f = 0; f < 0x100; f++) {
+        uint32_t want = 0;
+        want |= (f & FPSR_IOC) ? MXCSR_IE : 0;
+        want |= (f & FPSR_DZC) ? MXCSR_ZE : 0;
+        want |= (f & FPSR_OFC) ? MXCSR_OE : 0;
+        want |= (f & FPSR_UFC) ? MXCSR_UE : 0;
+        want |= (f & FPSR_IXC) ? MXCSR_PE : 0;
+        if (rosetta_mxcsr_flags_from_fpsr(f | 0xF8000000u) != want) {
+            TEST_FAIL(name, "exception flags");
+            return;
+        }
+    }
+    TEST_PASS(name);
+}
+
+static void test_runtime(void)
+{
+    const char *name = "Runtime enter, read and write";
+    x86_context_t g;
+
+    TEST_START(name);
+    rosetta_mxcsr_reset(&g);
+    if (g.mxcsr != 0x1F80) {
+        TEST_FAIL(name, "reset value");
+        return;
+    }
+
+    memset(&ts, 0, sizeof(ts));
+    ts.guest.mxcsr = 0x1F80 | 3u << 13;        /* Toward zero */
+    write_fpcr(0x02000000u | 1u << 22);         /* DN, RP */
+    write_fpsr(0x1F);
+    rosetta_mxcsr_enter(&ts);
+    if (read_fpcr() != (0x02000000u | 3u << 22) || read_fpsr() != 0 || ts.host.fpcr != read_fpcr()) {
+        TEST_FAIL(name, "enter: FPCR keeps DN and takes RZ, FPSR is cleared");
+        return;
+    }
+
+    write_fpsr(FPSR_DZC | FPSR_IXC);            /* Raised by translated code */
+    if (rosetta_mxcsr_read(&ts) != (0x1F80 | 3u << 13 | MXCSR_ZE | MXCSR_PE) ||
+        ts.guest.mxcsr != (0x1F80 | 3u << 13 | MXCSR_ZE | MXCSR_PE)) {
+        TEST_FAIL(name, "read folds the FPSR flags");
+        return;
+    }
+
+    rosetta_mxcsr_write(&ts, 0x1F80 | 1u << 13 | MXCSR_FZ | MXCSR_OE);
+    if (read_fpcr() != (0x02000000u | 2u << 22 | FPCR_FZ) || read_fpsr() != 0 ||
+        rosetta_mxcsr_read(&ts) != (0x1F80 | 1u << 13 | MXCSR_FZ | MXCSR_OE)) {
+        TEST_FAIL(name, "write: RM and FZ, flags replaced");
+        return;
+    }
+
+    write_fpsr(FPSR_UFC);                       /* Raised by C code between blocks */
+    rosetta_mxcsr_resume(&ts);
+    if (read_fpsr() != 0 || ts.host.fpsr != 0 ||
+        rosetta_mxcsr_read(&ts) != (0x1F80 | 1u << 13 | MXCSR_FZ | MXCSR_OE)) {
+        TEST_FAIL(name, "resume drops the flags of C code");
+        return;
+    }
+    TEST_PASS(name);
+}
+
+static void test_ldmxcsr(void)
+{
+    const char *name = "LDMXCSR on FPCR and FPSR";
+    int iter, form;
+
+    TEST_START(name);
+    for (iter = 0; iter < 4000; iter++) {
+        translate_mxcsr_state_t st;
+        a64_t c, before;
+        uint32_t m = rnd_mxcsr();
+        uint32_t want_fpcr;
+
+        form = iter % F_COUNT;
+        if (iter % 7 == 0) {
+            m = 0x1F80;                         /* Often the default, which matches FPCR RN */
+        }
+        init_cpu(&c);
+        memset(&ts, 0, sizeof(ts));
+        ectx.state = &ts;
+        guest_mem[MEM_SLOT] = m;
+        translate_mxcsr_begin_block(&st);
+        {
+            uint8_t tmp[16];
+            uint64_t pc = 0;
+            encode(tmp, form, 2, &c, &pc);      /* Guest registers first, for the snapshot */
+        }
+        before = c;
+        if (run_one(name, &c, &st, form, 2) < 0) {
+            return;
+        }
+        want_fpcr = (before.fpcr & ~FPCR_MXCSR_BITS) | rosetta_mxcsr_to_fpcr(m);
+        if (ts.guest.mxcsr != m || c.fpcr != want_fpcr || c.fpsr != 0) {
+            char msg[128];
+            snprintf(msg, sizeof(msg), "form %d mxcsr %04x: fpcr %08x want %08x, fpsr %x",
+                     form, m, c.fpcr, want_fpcr, c.fpsr);
+            TEST_FAIL(name, msg);
+            return;
+        }
+        if (c.fpcr_writes != (want_fpcr != before.fpcr)) {
+            TEST_FAIL(name, "FPCR written although unchanged, or not written");
+            return;
+        }
+        if (!preserved(&before, &c)) {
+            TEST_FAIL(name, "guest register, SP or NZCV clobbered");
+            return;
+        }
+    }
+    TEST_PASS(name);
+}
+
+static void test_stmxcsr(void)
+{
+    const char *name = "STMXCSR folds FPSR flags";
+    int iter, form;
+
+    TEST_START(name);
+    for (iter = 0; iter < 4000; iter++) {
+        translate_mxcsr_state_t st;
+        a64_t c, before;
+        uint32_t m = rnd_mxcsr(), want;
+
+        form = iter % F_COUNT;
+        init_cpu(&c);
+        memset(&ts, 0, sizeof(ts));
+        ectx.state = &ts;
+        ts.guest.mxcsr = m;
+        guest_mem[MEM_SLOT] = 0xDEADBEEF;
+        translate_mxcsr_begin_block(&st);
+        {
+            uint8_t tmp[16];
+            uint64_t pc = 0;
+            encode(tmp, form, 3, &c, &pc);
+        }
+        before = c;
+        if (run_one(name, &c, &st, form, 3) < 0) {
+            return;
+        }
+        want = m | rosetta_mxcsr_flags_from_fpsr(before.fpsr);
+        if (guest_mem[MEM_SLOT] != want || ts.guest.mxcsr != want) {
+            char msg[128];
+            snprintf(msg, sizeof(msg), "form %d: stored %08x, guest %08x, want %08x",
+                     form, guest_mem[MEM_SLOT], ts.guest.mxcsr, want);
+            TEST_FAIL(name, msg);
+            return;
+        }
+        if (c.fpcr != before.fpcr || c.fpsr != before.fpsr || c.fpcr_writes || c.fpsr_reads != 1) {
+            TEST_FAIL(name, "FPCR or FPSR changed, or FPSR not read once");
+            return;
+        }
+        if (!preserved(&before, &c)) {
+            TEST_FAIL(name, "guest register, SP or NZCV clobbered");
+            return;
+        }
+    }
+    TEST_PASS(name);
+}
+
+/* A helper that raises flags of its own */
+static int raising_helper(a64_t *c, uint64_t target)
+{
+    (void)target;
+    c->helper_calls++;
+    c->fpsr |= FPSR_IXC | FPSR_UFC;
+    return 0;
+}
+
+static void test_helper_call(void)
+{
+    const char *name = "FPSR around helper calls";
+    static uint32_t words[64];
+    int iter;
+
+    TEST_START(name);
+    for (iter = 0; iter < 1000; iter++) {
+        code_buffer_t buf;
+        a64_t c, before;
+        uint32_t m = rnd_mxcsr();
+        size_t bad;
+
+        init_cpu(&c);
+        c.blr = raising_helper;
+        memset(&ts, 0, sizeof(ts));
+        ts.guest.mxcsr = m;
+        c.x[16] = (uint64_t)(uintptr_t)&ts;
+        before = c;
+
+        code_buffer_init_arm64(&buf, (uint8_t *)words, sizeof(words));
+        translate_mxcsr_emit_leave(&buf, 16, 0, 1);
+        emit_blr(&buf, 17);
+        translate_mxcsr_emit_resume(&buf);
+        bad = a64_run(&c, words, code_buffer_get_size_arm64(&buf) / 4);
+        if (bad) {
+            char msg[64];
+            snprintf(msg, sizeof(msg), "word %zu (%08x) not understood", bad - 1, words[bad - 1]);
+            TEST_FAIL(name, msg);
+            return;
+        }
+        if (ts.guest.mxcsr != (m | rosetta_mxcsr_flags_from_fpsr(before.fpsr)) ||
+            c.fpsr != 0 || c.helper_calls != 1) {
+            char msg[128];
+            snprintf(msg, sizeof(msg), "guest %08x want %08x, fpsr %x after the call",
+                     ts.guest.mxcsr, m | rosetta_mxcsr_flags_from_fpsr(before.fpsr), c.fpsr);
+            TEST_FAIL(name, msg);
+            return;
+        }
+        if (c.fpcr != before.fpcr || c.x[16] != before.x[16] || c.nzcv != before.nzcv) {
+            TEST_FAIL(name, "FPCR, the state register or NZCV changed");
+            return;
+        }
+    }
+    TEST_PASS(name);
+}
+
+/* Run the words emitted since *start; returns 0 or -1 (reported) */
+static int run_from(const char *name, a64_t *c, const uint32_t *words, code_buffer_t *buf,
+                    uint32_t *start)
+{
+    size_t n = code_buffer_get_size_arm64(buf) / 4;
+    size_t bad = a64_run(c, words + *start, n - *start);
+
+    if (bad) {
+        char msg[64];
+        snprintf(msg, sizeof(msg), "word %zu (%08x) not understood", bad - 1, words[*start + bad - 1]);
+        TEST_FAIL(name, msg);
+        return -1;
+    }
+    *start = (uint32_t)n;
+    return 0;
+}
+
+static void test_x87_env(void)
+{
+    static const uint32_t rmode_of_rc[4] = { 0, 2, 1, 3 };
+    static const uint8_t addps[] = { 0x0F, 0x58, 0xC1 };            /* addps xmm0, xmm1 */
+    static const uint8_t add[] = { 0x48, 0x01, 0xC8 };               /* add rax, rcx */
+    const char *name = "x87 environment";
+    static uint32_t words[256];
+    int iter;
+
+    TEST_START(name);
+    for (iter = 0; iter < 1000; iter++) {
+        translate_mxcsr_state_t st;
+        code_buffer_t buf;
+        x86_insn_t insn;
+        a64_t c, before;
+        uint32_t m = rnd_mxcsr(), rc = (uint32_t)rnd() & 3;
+        uint32_t start = 0, mx, len;
+
+        init_cpu(&c);
+        memset(&ts, 0, sizeof(ts));
+        ectx.state = &ts;
+        ts.guest.mxcsr = m;
+        ts.guest.fpu_cw = (uint16_t)(0x037F | rc << 10);
+        ts.guest.fpu_sw = X87_SW_DE;
+        before = c;
+
+        /* Enter: SSE flags go to MXCSR, FPCR takes RC with FZ clear */
+        code_buffer_init_arm64(&buf, (uint8_t *)words, sizeof(words));
+        translate_mxcsr_begin_block(&st);
+        translate_mxcsr_x87_enter(&buf, &st);
+        len = code_buffer_get_size_arm64(&buf);
+        translate_mxcsr_x87_enter(&buf, &st);
+        decode_x86_insn(add, &insn);
+        translate_mxcsr_lower(&buf, &st, &insn, 0);
+        if (code_buffer_get_size_arm64(&buf) != len) {
+            TEST_FAIL(name, "x87 environment entered twice or left for ADD");
+            return;
+        }
+        if (run_from(name, &c, words, &buf, &start) < 0) {
+            return;
+        }
+        mx = m | rosetta_mxcsr_flags_from_fpsr(before.fpsr);
+        if (c.fpcr != ((before.fpcr & ~FPCR_MXCSR_BITS) | rmode_of_rc[rc] << FPCR_RMODE_SHIFT) ||
+            c.fpsr != 0 || ts.guest.mxcsr != mx || ts.guest.fpu_sw != X87_SW_DE) {
+            char msg[128];
+            snprintf(msg, sizeof(msg), "enter rc %u: fpcr %08x, fpsr %x, mxcsr %04x",
+                     rc, c.fpcr, c.fpsr, ts.guest.mxcsr);
+            TEST_FAIL(name, msg);
+            return;
+        }
+
+        /* An x87 instruction raises PE and UE; SSE, or the flush, leaves */
+        c.fpsr |= FPSR_IXC | FPSR_UFC;
+        if (iter & 1) {
+            translate_mxcsr_flush(&buf, &st);
+        } else {
+            decode_x86_insn(addps, &insn);
+            translate_mxcsr_lower(&buf, &st, &insn, 0);
+        }
+        if (st.x87_env) {
+            TEST_FAIL(name, "x87 environment not left");
+            return;
+        }
+        if (run_from(name, &c, words, &buf, &start) < 0) {
+            return;
+        }
+        if (ts.guest.fpu_sw != (X87_SW_DE | X87_SW_UE | X87_SW_PE) || ts.guest.mxcsr != mx ||
+            c.fpsr != 0 || c.fpcr != ((before.fpcr & ~FPCR_MXCSR_BITS) | rosetta_mxcsr_to_fpcr(m))) {
+            char msg[128];
+            snprintf(msg, sizeof(msg), "leave: fsw %04x, mxcsr %04x, fpcr %08x",
+                     ts.guest.fpu_sw, ts.guest.mxcsr, c.fpcr);
+            TEST_FAIL(name, msg);
+            return;
+        }
+        if (!preserved(&before, &c)) {
+            TEST_FAIL(name, "guest register, SP or NZCV clobbered");
+            return;
+        }
+    }
+    TEST_PASS(name);
+}
+
+/* Translate a sequence; returns the number of MRS/MSR FPSR words */
+static int count_fpsr_access(const uint8_t *const *seq, int n)
+{
+    static uint32_t words[512];
+    translate_mxcsr_state_t st;
+    code_buffer_t buf;
+    size_t i, nw;
+    int k, count = 0;
+
+    code_buffer_init_arm64(&buf, (uint8_t *)words, sizeof(words));
+    translate_mxcsr_begin_block(&st);
+    for (k = 0; k < n; k++) {
+        x86_insn_t insn;
+        decode_x86_insn(seq[k], &insn);
+        translate_mxcsr_lower(&buf, &st, &insn, 0x400000);
+    }
+    nw = code_buffer_get_size_arm64(&buf) / 4;
+    for (i = 0; i < nw; i++) {
+        if ((words[i] & 0xFFDFFFE0u) == 0xD51B4420u) {
+            count++;
+        }
+    }
+    return count;
+}
+
+static void test_tracking(void)
+{
+    static const uint8_t ld[] = { 0x0F, 0xAE, 0x56, 0x08 };         /* ldmxcsr [rsi+8] */
+    static const uint8_t stx[] = { 0x0F, 0xAE, 0x5E, 0x08 };        /* stmxcsr [rsi+8] */
+    static const uint8_t addps[] = { 0x0F, 0x58, 0xC1 };             /* addps xmm0, xmm1 */
+    static const uint8_t add[] = { 0x48, 0x01, 0xC8 };               /* add rax, rcx */
+    static const uint8_t fxsave[] = { 0x0F, 0xAE, 0x06 };            /* fxsave [rsi] */
+    static const uint8_t lfence[] = { 0x0F, 0xAE, 0xE8 };
+    static const uint8_t wrfs[] = { 0xF3, 0x48, 0x0F, 0xAE, 0xD0 };  /* wrfsbase rax */
+    static const uint8_t vex_l1[] = { 0xC5, 0xFC, 0xAE, 0x56, 0x08 };
+    const char *name = "Block tracking and decoding";
+    const uint8_t *seq[4];
+    static uint32_t words[64];
+    translate_mxcsr_state_t st;
+    code_buffer_t buf;
+    x86_insn_t insn;
+    const uint8_t *other[] = { add, fxsave, lfence, wrfs, vex_l1 };
+    size_t k;
+
+    TEST_START(name);
+
+    /* ldmxcsr; ldmxcsr: the second one knows FPSR is clear */
+    seq[0] = ld; seq[1] = ld;
+    if (count_fpsr_access(seq, 2) != 1) {
+        TEST_FAIL(name, "redundant FPSR clear");
+        return;
+    }
+    /* ldmxcsr; addps; ldmxcsr: both clear */
+    seq[0] = ld; seq[1] = addps; seq[2] = ld;
+    if (count_fpsr_access(seq, 3) != 2) {
+        TEST_FAIL(name, "FPSR clear after an SSE instruction");
+        return;
+    }
+    /* ldmxcsr; add; stmxcsr: no fold */
+    seq[0] = ld; seq[1] = add; seq[2] = stx;
+    if (count_fpsr_access(seq, 3) != 1) {
+        TEST_FAIL(name, "fold without FP instructions");
+        return;
+    }
+    /* stmxcsr at block entry, and after addps: fold each time */
+    seq[0] = stx; seq[1] = addps; seq[2] = stx; seq[3] = stx;
+    if (count_fpsr_access(seq, 4) != 2) {
+        TEST_FAIL(name, "fold at entry or after SSE, once");
+        return;
+    }
+
+    for (k = 0; k < sizeof(other) / sizeof(other[0]); k++) {
+        code_buffer_init_arm64(&buf, (uint8_t *)words, sizeof(words));
+        translate_mxcsr_begin_block(&st);
+        decode_x86_insn(other[k], &insn);
+        if (x86_is_ldmxcsr(&insn) || x86_is_stmxcsr(&insn) ||
+            translate_mxcsr_lower(&buf, &st, &insn, 0) != -ENOENT ||
+            code_buffer_get_size_arm64(&buf) != 0) {
+            char msg[64];
+            snprintf(msg, sizeof(msg), "instruction %zu taken as LDMXCSR/STMXCSR", k);
+            TEST_FAIL(name, msg);
+            return;
+        }
+    }
+    TEST_PASS(name);
+}
+
+int main(void)
+{
+    printf("=================================================================\n");
+    printf("MXCSR Emulation Test\n");
+    printf("=================================================================\n");
+
+    test_conversions();
+    test_runtime();
+    test_ldmxcsr();
+    test_stmxcsr();
+    test_tracking();
+    test_helper_call();
+    test_x87_env();
+
+    printf("\n=================================================================\n");
+    printf("Results: %d passed, %d failed\n", tests_passed, tests_failed);
+    printf("=================================================================\n");
+
+    return tests_failed ? 1 : 0;
+}
+
+#else /* !__x86_64__ */
+
+int main(void)
+{
+    printf("MXCSR emulation test skipped: host is not x86_64\n");
+    return 0;
+}
+
+#endif /* __x86_64__ */
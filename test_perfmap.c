@@ -0,0 +1,210 @@
+/*=============================================================================
+ * Perf Map Test
+ *=============================================================================
+ *
+ * Records a few blocks, then reads back /tmp/perf-<pid>.map and
+ * /tmp/jit-<pid>.dump and checks names, addresses, the jitdump record
+ * layout and the code bytes.
+ *
+ * Build: gcc -std=gnu11 -pthread -o test_perfmap test_perfmap.c \
+ *            rosetta_perfmap.c rosetta_elf_loader.c
+ *
+ *=============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include "rosetta_perfmap.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST_START(name) \
+    printf("\n--- Test: %s ---\n", name)
+
+#define TEST_PASS(name) \
+    do { \
+        tests_passed++; \
+        printf("✅ PASS: %s\n", name); \
+    } while(0)
+
+#define TEST_FAIL(name, reason) \
+    do { \
+        tests_failed++; \
+        printf("❌ FAIL: %s - %s\n", name, reason); \
+    } while(0)
+
+static char map_path[64];
+static char dump_path[64];
+static uint8_t block_a[24];
+static uint8_t block_b[40];
+
+static char *read_file(const char *path, size_t *len)
+{
+    FILE *f = fopen(path, "rb");
+    char *data;
+    long size;
+
+    if (!f) {
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    data = calloc(1, (size_t)size + 1);
+    if (data && fread(data, 1, (size_t)size, f) != (size_t)size) {
+        free(data);
+        data = NULL;
+    }
+    fclose(f);
+    *len = (size_t)size;
+    return data;
+}
+
+static void record_blocks(void)
+{
+    static char strtab[] = "\0main";
+    static elf64_sym_t syms[2];
+    static rosetta_elf_binary_t bin;
+    size_t i;
+
+    for (i = 0; i < sizeof(block_a); i++) {
+        block_a[i] = (uint8_t)(0xA0 + i);
+    }
+    for (i = 0; i < sizeof(block_b); i++) {
+        block_b[i] = (uint8_t)(0x10 + i);
+    }
+
+    syms[1].st_name = 1;
+    syms[1].st_info = STT_FUNC;
+    syms[1].st_value = 0x401000;
+    syms[1].st_size = 0x80;
+    bin.symtab = syms;
+    bin.symtab_count = 2;
+    bin.strtab = strtab;
+    bin.strtab_size = sizeof(strtab);
+
+    rosetta_perfmap_open(&bin, ROS_PERFMAP_MAP | ROS_PERFMAP_JITDUMP);
+    rosetta_perfmap_record_block(block_a, sizeof(block_a), 0x401010);
+    rosetta_perfmap_record_block(block_b, sizeof(block_b), 0x7F0000);
+    rosetta_perfmap_close();
+
+    /* Closed: nothing more is written */
+    rosetta_perfmap_record_block(block_a, sizeof(block_a), 0x401000);
+}
+
+/* ============================================================================
+ * Tests
+ * ============================================================================ */
+
+static void test_perf_map(void)
+{
+    const char *name = "perf-<pid>.map entries";
+    char expect_a[96], expect_b[96];
+    size_t len;
+    char *text = read_file(map_path, &len);
+
+    TEST_START(name);
+    if (!text) {
+        TEST_FAIL(name, "map not written");
+        return;
+    }
+    printf("%s", text);
+
+    snprintf(expect_a, sizeof(expect_a), "%llx %x guest:main+0x10\n",
+             (unsigned long long)(uintptr_t)block_a, (unsigned)sizeof(block_a));
+    snprintf(expect_b, sizeof(expect_b), "%llx %x guest:0x7f0000\n",
+             (unsigned long long)(uintptr_t)block_b, (unsigned)sizeof(block_b));
+    if (strncmp(text, expect_a, strlen(expect_a)) != 0 || !strstr(text, expect_b) ||
+        strlen(text) != strlen(expect_a) + strlen(expect_b)) {
+        free(text);
+        TEST_FAIL(name, "wrong map lines");
+        return;
+    }
+    free(text);
+    TEST_PASS(name);
+}
+
+static void test_jitdump(void)
+{
+    const char *name = "jit-<pid>.dump records";
+    size_t len, off;
+    uint8_t *data = (uint8_t *)read_file(dump_path, &len);
+    uint32_t hdr[6], rec[2];
+    uint64_t fields[4];
+    int loads = 0, closed = 0;
+
+    TEST_START(name);
+    if (!data || len < 40) {
+        free(data);
+        TEST_FAIL(name, "dump not written");
+        return;
+    }
+
+    memcpy(hdr, data, sizeof(hdr));
+    if (hdr[0] != 0x4A695444 || hdr[1] != 1 || hdr[2] != 40 || hdr[5] != (uint32_t)getpid()) {
+        free(data);
+        TEST_FAIL(name, "bad file header");
+        return;
+    }
+
+    for (off = hdr[2]; off + 16 <= len; off += rec[1]) {
+        memcpy(rec, data + off, sizeof(rec));
+        if (rec[1] < 16 || off + rec[1] > len) {
+            break;
+        }
+        if (rec[0] == 0) {
+            const char *sym = (const char *)data + off + 56;
+            const uint8_t *code = (const uint8_t *)sym + strlen(sym) + 1;
+            const uint8_t *want = loads == 0 ? block_a : block_b;
+
+            memcpy(fields, data + off + 24, sizeof(fields));
+            printf("  load %s vma=0x%llx size=%llu index=%llu\n", sym,
+                   (unsigned long long)fields[0], (unsigned long long)fields[2],
+                   (unsigned long long)fields[3]);
+            if (fields[0] != (uint64_t)(uintptr_t)want || fields[1] != fields[0] ||
+                fields[3] != (uint64_t)loads ||
+                memcmp(code, want, (size_t)fields[2]) != 0 ||
+                strcmp(sym, loads == 0 ? "guest:main+0x10" : "guest:0x7f0000") != 0) {
+                free(data);
+                TEST_FAIL(name, "wrong code load record");
+                return;
+            }
+            loads++;
+        } else if (rec[0] == 3) {
+            closed++;
+        }
+    }
+    free(data);
+
+    if (off != len || loads != 2 || closed != 1) {
+        TEST_FAIL(name, "wrong record sequence");
+        return;
+    }
+    TEST_PASS(name);
+}
+
+int main(void)
+{
+    printf("=================================================\n");
+    printf("Perf Map Test\n");
+    printf("=================================================\n");
+
+    snprintf(map_path, sizeof(map_path), "/tmp/perf-%d.map", (int)getpid());
+    snprintf(dump_path, sizeof(dump_path), "/tmp/jit-%d.dump", (int)getpid());
+    record_blocks();
+
+    test_perf_map();
+    test_jitdump();
+
+    unlink(map_path);
+    unlink(dump_path);
+
+    printf("\n=================================================\n");
+    printf("Results: %d passed, %d failed\n", tests_passed, tests_failed);
+    printf("=================================================\n");
+
+    return tests_failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,412 @@
+/*=============================================================================
+ * Guest Register Allocator Test
+ *=============================================================================
+ *
+ * Checks the linear-scan intervals and spill choices, then runs ARM64
+ * blocks through the x86_64 back-end under register pressure and across a
+ * helper call to make sure cached guest registers, general and vector,
+ * are loaded, written back and reloaded at the right points.
+ *
+ * Build: gcc -std=gnu11 -o test_regalloc test_regalloc.c rosetta_regalloc.c \
+ *            rosetta_ir.c rosetta_ir_from_x86.c rosetta_ir_from_arm64.c \
+ *            rosetta_ir_to_arm64.c rosetta_ir_to_x86.c rosetta_emit_x86.c \
+ *            rosetta_arm64_emit.c rosetta_insn_cache.c rosetta_translate_mxcsr.c
+ *
+ *=============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include "rosetta_regalloc.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST_START(name) \
+    printf("\n--- Test: %s ---\n", name)
+
+#define TEST_PASS(name) \
+    do { \
+        tests_passed++; \
+        printf("✅ PASS: %s\n", name); \
+    } while(0)
+
+#define TEST_FAIL(name, reason) \
+    do { \
+        tests_failed++; \
+        printf("❌ FAIL: %s - %s\n", name, reason); \
+    } while(0)
+
+static ir_block_t blk;
+static ra_alloc_t ra;
+static uint8_t *exec_mem;
+static size_t exec_size;
+static ThreadState state;
+
+static int emit_arm64_block(const uint32_t *code, int n, uint64_t pc, uint64_t helper)
+{
+    code_buf_t buf;
+
+    ir_block_init(&blk, pc);
+    blk.syscall_helper = helper;
+    if (ir_arm64_lower_block(&blk, code, pc, n) != n) {
+        return -1;
+    }
+    code_buf_init(&buf, exec_mem, 4096);
+    if (ir_emit_x86(&blk, &buf) != 0) {
+        return -1;
+    }
+    exec_size = buf.offset;
+    return 0;
+}
+
+static void run_block(void)
+{
+    ((void (*)(ThreadState *))exec_mem)(&state);
+}
+
+/* ============================================================================
+ * Allocation
+ * ============================================================================ */
+
+static void test_spill_furthest(void)
+{
+    static const uint8_t pool[2] = { 12, 13 };
+    ir_ref_t a, b, c;
+
+    TEST_START("Spill the interval ending furthest away");
+    ir_block_init(&blk, 0);
+    a = ir_get_reg(&blk, 1);                    /* r1 live to the end */
+    b = ir_get_reg(&blk, 2);                    /* r2 dies early */
+    c = ir_get_reg(&blk, 3);                    /* r3 arrives under pressure */
+    ir_set_reg(&blk, 4, ir_emit(&blk, IR_ADD, 8, b, c, 0));
+    ir_set_reg(&blk, 5, a);
+    ir_br(&blk, 0);
+
+    if (ra_linear_scan(&blk, pool, 2, &ra) != 0) {
+        TEST_FAIL("Spill choice", "allocation failed");
+        return;
+    }
+    if (ra.count != 5 || ra.host_of[1] != RA_SPILLED || ra.host_of[2] == RA_SPILLED ||
+        ra.host_of[3] == RA_SPILLED || ra.host_of[2] == ra.host_of[3] ||
+        ra.spills < 1) {
+        TEST_FAIL("Spill choice", "wrong registers spilled");
+        return;
+    }
+    if (!ra_interval(&ra, 4)->written || ra_interval(&ra, 4)->end != blk.count - 1 ||
+        !ra_interval(&ra, 1)->read_first) {
+        TEST_FAIL("Spill choice", "interval bounds wrong");
+        return;
+    }
+    TEST_PASS("Spill choice");
+}
+
+static void test_value_pins_register(void)
+{
+    static const uint8_t pool[1] = { 12 };
+    ir_ref_t a;
+
+    TEST_START("A read value keeps its register until its last use");
+    ir_block_init(&blk, 0);
+    a = ir_get_reg(&blk, 1);
+    ir_get_reg(&blk, 2);
+    ir_set_reg(&blk, 3, a);
+    ir_br(&blk, 0);
+
+    ra_linear_scan(&blk, pool, 1, &ra);
+    if (ra_interval(&ra, 1)->end < 2 || ra.host_of[1] == ra.host_of[2]) {
+        TEST_FAIL("Pinned value", "register reused while value live");
+        return;
+    }
+    TEST_PASS("Pinned value");
+}
+
+static void test_vector_class(void)
+{
+    static const uint8_t pool[4] = { 12, 13, 14, 15 };
+    ir_ref_t g, v1, v2;
+
+    TEST_START("Vector registers allocated as their own class");
+    ir_block_init(&blk, 0);
+    g = ir_get_reg(&blk, 1);
+    v1 = ir_get_vreg(&blk, IR_ARM64_V0 + 1);
+    v2 = ir_get_vreg(&blk, IR_ARM64_V0 + 2);
+    ir_set_vreg(&blk, IR_ARM64_V0 + 0, ir_emit(&blk, IR_XOR, 16, v1, v2, 0));
+    ir_set_reg(&blk, 0, g);
+    ir_br(&blk, 0);
+
+    if (ra_linear_scan(&blk, pool, 4, &ra) != 0 || ra.count != 2 ||
+        ra_interval(&ra, 1) == NULL || ra_interval(&ra, 2) != NULL) {
+        TEST_FAIL("Vector class", "vector registers among the GPR intervals");
+        return;
+    }
+    if (ra_linear_scan_class(&blk, RA_CLASS_VEC, pool, 4, &ra) != 0 || ra.count != 3 ||
+        ra.host_of[0] == RA_SPILLED || ra.host_of[1] == RA_SPILLED ||
+        ra.host_of[2] == RA_SPILLED || ra.host_of[1] == ra.host_of[2] ||
+        !ra_interval(&ra, 0)->written || !ra_interval(&ra, 1)->read_first) {
+        TEST_FAIL("Vector class", "wrong vector intervals");
+        return;
+    }
+    TEST_PASS("Vector class");
+}
+
+/* ============================================================================
+ * Generated Code
+ * ============================================================================ */
+
+static void test_single_load_store(void)
+{
+    /* add x0, x0, #1 four times */
+    static const uint32_t code[] = { 0x91000400, 0x91000400, 0x91000400, 0x91000400 };
+    uint32_t slot = (uint32_t)ra_spill_slot(RA_CLASS_GPR, 0);
+    int refs = 0;
+    size_t off;
+
+    TEST_START("Guest register cached across the block");
+    memset(&state, 0, sizeof(state));
+    state.host.x[0] = 10;
+    if (emit_arm64_block(code, 4, 0x1000, 0) != 0) {
+        TEST_FAIL("Cached register", "translation failed");
+        return;
+    }
+    for (off = 0; off + 4 <= exec_size; off++) {
+        uint32_t v;
+        memcpy(&v, exec_mem + off, 4);
+        refs += (v == slot);
+    }
+    run_block();
+    if (refs != 2 || state.host.x[0] != 14 || state.host.pc != 0x1010) {
+        TEST_FAIL("Cached register", "expected one load and one store");
+        return;
+    }
+    TEST_PASS("Cached register");
+}
+
+static void test_pressure(void)
+{
+    /* Twelve guest registers live at once, more than the host pool */
+    static const uint32_t code[] = {
+        0x8B020020,     /* add x0, x1, x2 */
+        0x8B050083,     /* add x3, x4, x5 */
+        0x8B0800E6,     /* add x6, x7, x8 */
+        0x8B0B0149,     /* add x9, x10, x11 */
+        0x8B03000C,     /* add x12, x0, x3 */
+        0x8B0900CD,     /* add x13, x6, x9 */
+        0x8B0D018E,     /* add x14, x12, x13 */
+        0x8B0B002F,     /* add x15, x1, x11 */
+    };
+    int r;
+
+    TEST_START("Spilled registers under pressure");
+    memset(&state, 0, sizeof(state));
+    for (r = 1; r <= 11; r++) {
+        state.host.x[r] = (uint64_t)r * 100;
+    }
+    if (emit_arm64_block(code, 8, 0x2000, 0) != 0) {
+        TEST_FAIL("Pressure", "translation failed");
+        return;
+    }
+    run_block();
+    if (state.host.x[0] != 300 || state.host.x[3] != 900 || state.host.x[6] != 1500 ||
+        state.host.x[9] != 2100 || state.host.x[12] != 1200 || state.host.x[13] != 3600 ||
+        state.host.x[14] != 4800 || state.host.x[15] != 1200 || state.host.x[1] != 100 ||
+        state.host.pc != 0x2020) {
+        TEST_FAIL("Pressure", "wrong register state");
+        return;
+    }
+    TEST_PASS("Pressure");
+}
+
+/* Occurrences of a 32-bit displacement in the emitted block */
+static int count_refs(uint32_t slot)
+{
+    int refs = 0;
+    size_t off;
+
+    for (off = 0; off + 4 <= exec_size; off++) {
+        uint32_t v;
+        memcpy(&v, exec_mem + off, 4);
+        refs += (v == slot);
+    }
+    return refs;
+}
+
+static void test_vector_cached(void)
+{
+    /* add v0.4s, v0.4s, v1.4s three times */
+    static const uint32_t code[] = { 0x4EA18400, 0x4EA18400, 0x4EA18400 };
+    int lane, refs0, refs1;
+
+    TEST_START("Guest vector register cached across the block");
+    memset(&state, 0, sizeof(state));
+    for (lane = 0; lane < 4; lane++) {
+        state.host.v[0].u32[lane] = 100u * (uint32_t)lane;
+        state.host.v[1].u32[lane] = (uint32_t)lane + 1;
+    }
+    if (emit_arm64_block(code, 3, 0x1800, 0) != 0) {
+        TEST_FAIL("Cached vector register", "translation failed");
+        return;
+    }
+    refs0 = count_refs((uint32_t)ra_spill_slot(RA_CLASS_VEC, 0));
+    refs1 = count_refs((uint32_t)ra_spill_slot(RA_CLASS_VEC, 1));
+    run_block();
+    for (lane = 0; lane < 4; lane++) {
+        if (state.host.v[0].u32[lane] != 100u * (uint32_t)lane + 3u * ((uint32_t)lane + 1) ||
+            state.host.v[1].u32[lane] != (uint32_t)lane + 1) {
+            TEST_FAIL("Cached vector register", "wrong result");
+            return;
+        }
+    }
+    if (refs0 != 2 || refs1 != 1) {
+        TEST_FAIL("Cached vector register", "expected one load and one store of v0, one load of v1");
+        return;
+    }
+    TEST_PASS("Cached vector register");
+}
+
+static void test_vector_pressure(void)
+{
+    static const uint32_t code[] = {
+        0x6E221C20,     /* eor v0.16b, v1.16b, v2.16b */
+        0x6E251C83,     /* eor v3.16b, v4.16b, v5.16b */
+        0x4EA38406,     /* add v6.4s, v0.4s, v3.4s */
+        0x6E251C27,     /* eor v7.16b, v1.16b, v5.16b */
+    };
+    uint32_t v[8][4];
+    int r, lane;
+
+    TEST_START("Spilled vector registers under pressure");
+    memset(&state, 0, sizeof(state));
+    for (r = 1; r <= 5; r++) {
+        for (lane = 0; lane < 4; lane++) {
+            state.host.v[r].u32[lane] = (uint32_t)(r * 0x01010101) << lane;
+        }
+    }
+    for (lane = 0; lane < 4; lane++) {
+        for (r = 1; r <= 5; r++) {
+            v[r][lane] = state.host.v[r].u32[lane];
+        }
+        v[0][lane] = v[1][lane] ^ v[2][lane];
+        v[3][lane] = v[4][lane] ^ v[5][lane];
+        v[6][lane] = v[0][lane] + v[3][lane];
+        v[7][lane] = v[1][lane] ^ v[5][lane];
+    }
+    if (emit_arm64_block(code, 4, 0x2800, 0) != 0) {
+        TEST_FAIL("Vector pressure", "translation failed");
+        return;
+    }
+    run_block();
+    for (r = 0; r < 8; r++) {
+        if (memcmp(state.host.v[r].u32, v[r], 16) != 0) {
+            TEST_FAIL("Vector pressure", "wrong register state");
+            return;
+        }
+    }
+    TEST_PASS("Vector pressure");
+}
+
+static void svc_helper(ThreadState *st)
+{
+    st->host.x[0] = st->host.x[8] * 10;
+}
+
+/* Scales v0 and clobbers the XMM registers holding guest vectors */
+static void svc_vec_helper(ThreadState *st)
+{
+    int lane;
+
+    for (lane = 0; lane < 4; lane++) {
+        st->host.v[0].u32[lane] *= 10;
+    }
+    __asm__ volatile("pxor %%xmm12, %%xmm12\n\tpxor %%xmm13, %%xmm13\n\t"
+                     "pxor %%xmm14, %%xmm14\n\tpxor %%xmm15, %%xmm15"
+                     ::: "xmm12", "xmm13", "xmm14", "xmm15");
+}
+
+static void test_vector_sync_around_call(void)
+{
+    static const uint32_t code[] = {
+        0x4EA18420,     /* add v0.4s, v1.4s, v1.4s */
+        0xD4000001,     /* svc #0 */
+        0x4EA18402,     /* add v2.4s, v0.4s, v1.4s */
+    };
+    int lane;
+
+    TEST_START("Cached vector registers synced around helper calls");
+    memset(&state, 0, sizeof(state));
+    for (lane = 0; lane < 4; lane++) {
+        state.host.v[1].u32[lane] = (uint32_t)lane + 7;
+    }
+    if (emit_arm64_block(code, 3, 0x3800, (uint64_t)(uintptr_t)svc_vec_helper) != 0) {
+        TEST_FAIL("Vector call sync", "translation failed");
+        return;
+    }
+    run_block();
+    for (lane = 0; lane < 4; lane++) {
+        uint32_t v1 = (uint32_t)lane + 7;
+        if (state.host.v[0].u32[lane] != 20 * v1 || state.host.v[1].u32[lane] != v1 ||
+            state.host.v[2].u32[lane] != 21 * v1) {
+            TEST_FAIL("Vector call sync", "helper saw or left stale registers");
+            return;
+        }
+    }
+    TEST_PASS("Vector call sync");
+}
+
+static void test_sync_around_call(void)
+{
+    static const uint32_t code[] = {
+        0x91000428,     /* add x8, x1, #1 */
+        0xD4000001,     /* svc #0 */
+        0x91000402,     /* add x2, x0, #1 */
+    };
+
+    TEST_START("Cached registers synced around helper calls");
+    memset(&state, 0, sizeof(state));
+    state.host.x[0] = 7;
+    state.host.x[1] = 4;
+    if (emit_arm64_block(code, 3, 0x3000, (uint64_t)(uintptr_t)svc_helper) != 0) {
+        TEST_FAIL("Call sync", "translation failed");
+        return;
+    }
+    run_block();
+    if (state.host.x[8] != 5 || state.host.x[0] != 50 || state.host.x[2] != 51) {
+        TEST_FAIL("Call sync", "helper saw or left stale registers");
+        return;
+    }
+    TEST_PASS("Call sync");
+}
+
+int main(void)
+{
+    printf("=================================================\n");
+    printf("Register Allocator Test\n");
+    printf("=================================================\n");
+
+    exec_mem = mmap(NULL, 4096, PROT_READ | PROT_WRITE | PROT_EXEC,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (exec_mem == MAP_FAILED) {
+        perror("mmap");
+        return 1;
+    }
+
+    test_spill_furthest();
+    test_value_pins_register();
+    test_single_load_store();
+    test_pressure();
+    test_sync_around_call();
+    test_vector_class();
+    test_vector_cached();
+    test_vector_pressure();
+    test_vector_sync_around_call();
+
+    munmap(exec_mem, 4096);
+
+    printf("\n=================================================\n");
+    printf("Results: %d passed, %d failed\n", tests_passed, tests_failed);
+    printf("=================================================\n");
+
+    return tests_failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,228 @@
+/*=============================================================================
+ * Sampling Profiler Test
+ *=============================================================================
+ *
+ * Checks the host-range index (in-order appends, out-of-order inserts,
+ * replacement and unmapping), deterministic attribution through
+ * rosetta_sampler_record(), and a live SIGPROF run over a spinning block
+ * whose samples must land on its guest pc in the folded output.
+ *
+ * Build: gcc -std=gnu11 -pthread -o test_sampler test_sampler.c \
+ *            rosetta_sampler.c rosetta_refactored_signal.c \
+ *            rosetta_refactored_exception.c rosetta_elf_loader.c
+ *
+ *=============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include "rosetta_sampler.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST_START(name) \
+    printf("\n--- Test: %s ---\n", name)
+
+#define TEST_PASS(name) \
+    do { \
+        tests_passed++; \
+        printf("✅ PASS: %s\n", name); \
+    } while(0)
+
+#define TEST_FAIL(name, reason) \
+    do { \
+        tests_failed++; \
+        printf("❌ FAIL: %s - %s\n", name, reason); \
+    } while(0)
+
+static uint8_t *exec_mem;
+
+/* ============================================================================
+ * Tests
+ * ============================================================================ */
+
+static void test_code_map(void)
+{
+    const char *name = "Host-range index";
+    rosetta_sampler_range_t r;
+    int i;
+
+    TEST_START(name);
+    rosetta_sampler_unmap_all();
+
+    /* Appends in code cache order, then one block below them all */
+    for (i = 0; i < 2000; i++) {
+        rosetta_sampler_map_block(0x100000 + (uint64_t)i * 0x40, 0x30,
+                                  0x400000 + (uint64_t)i * 0x10, NULL);
+    }
+    rosetta_sampler_map_block(0x80000, 0x20, 0x3FF000, NULL);
+
+    if (!rosetta_sampler_lookup(0x100000, &r) || r.guest_pc != 0x400000 ||
+        !rosetta_sampler_lookup(0x100000 + 1999 * 0x40 + 0x2F, &r) ||
+        r.guest_pc != 0x400000 + 1999 * 0x10 ||
+        !rosetta_sampler_lookup(0x8001F, &r) || r.guest_pc != 0x3FF000) {
+        TEST_FAIL(name, "mapped pc not found");
+        return;
+    }
+    if (rosetta_sampler_lookup(0x100030, NULL) ||          /* gap between blocks */
+        rosetta_sampler_lookup(0x80020, NULL) ||
+        rosetta_sampler_lookup(0x7FFFF, NULL) ||
+        rosetta_sampler_lookup(0x100000 + 2000 * 0x40, NULL)) {
+        TEST_FAIL(name, "unmapped pc found");
+        return;
+    }
+
+    /* Retranslation into the same host address replaces the entry */
+    rosetta_sampler_map_block(0x100040, 0x30, 0x500000, NULL);
+    if (!rosetta_sampler_lookup(0x100050, &r) || r.guest_pc != 0x500000 ||
+        !rosetta_sampler_lookup(0x100080, &r) || r.guest_pc != 0x400020) {
+        TEST_FAIL(name, "replacement broke the index");
+        return;
+    }
+
+    rosetta_sampler_unmap_all();
+    if (rosetta_sampler_lookup(0x100000, NULL)) {
+        TEST_FAIL(name, "unmap_all left blocks");
+        return;
+    }
+    TEST_PASS(name);
+}
+
+static void test_record(void)
+{
+    const char *name = "Sample attribution";
+    rosetta_sampler_stats_t st;
+    char *text = NULL;
+    size_t len = 0;
+    FILE *f;
+    int i;
+
+    TEST_START(name);
+    rosetta_sampler_reset();
+    rosetta_sampler_map_block(0x200000, 0x100, 0x401000, NULL);
+    rosetta_sampler_map_block(0x200100, 0x80, 0x401200, NULL);
+
+    for (i = 0; i < 7; i++) {
+        rosetta_sampler_record(0x200010 + (uint64_t)i);
+    }
+    for (i = 0; i < 3; i++) {
+        rosetta_sampler_record(0x200170);
+    }
+    rosetta_sampler_record(0x12345);
+
+    rosetta_sampler_get_stats(&st);
+    if (st.samples != 11 || st.in_cache != 10 || st.outside != 1 || st.dropped != 0) {
+        TEST_FAIL(name, "wrong totals");
+        return;
+    }
+
+    f = open_memstream(&text, &len);
+    if (rosetta_sampler_write_folded(f, NULL) != 3) {
+        fclose(f);
+        free(text);
+        TEST_FAIL(name, "wrong number of folded lines");
+        return;
+    }
+    fclose(f);
+    printf("%s", text);
+    if (!strstr(text, "guest;[unknown];0x401000 7\n") ||
+        !strstr(text, "guest;[unknown];0x401200 3\n") || !strstr(text, "rosetta 1\n")) {
+        free(text);
+        TEST_FAIL(name, "wrong folded output");
+        return;
+    }
+    free(text);
+    rosetta_sampler_unmap_all();
+    TEST_PASS(name);
+}
+
+#if defined(__x86_64__)
+static void test_live_sampling(void)
+{
+    const char *name = "SIGPROF samples land on the running block";
+    /* mov rax, rdi; 1: dec rax; jnz 1b; ret */
+    static const uint8_t spin[] = { 0x48, 0x89, 0xF8, 0x48, 0xFF, 0xC8, 0x75, 0xFB, 0xC3 };
+    static char strtab[] = "\0spin_loop";
+    static elf64_sym_t syms[2];
+    rosetta_elf_binary_t bin;
+    rosetta_sampler_stats_t st;
+    char *text = NULL;
+    size_t len = 0;
+    FILE *f;
+
+    TEST_START(name);
+    memcpy(exec_mem, spin, sizeof(spin));
+    rosetta_sampler_reset();
+    rosetta_sampler_map_block((uint64_t)(uintptr_t)exec_mem, sizeof(spin), 0x401000, NULL);
+
+    if (rosetta_sampler_start(1000) != 0) {
+        TEST_FAIL(name, "could not start the sampler");
+        return;
+    }
+    ((void (*)(uint64_t))exec_mem)(800000000ULL);
+    rosetta_sampler_stop();
+
+    rosetta_sampler_get_stats(&st);
+    printf("  samples=%llu in_cache=%llu outside=%llu\n",
+           (unsigned long long)st.samples, (unsigned long long)st.in_cache,
+           (unsigned long long)st.outside);
+    if (st.samples < 20 || st.in_cache * 10 < st.samples * 9) {
+        TEST_FAIL(name, "samples not attributed to the block");
+        return;
+    }
+
+    memset(&bin, 0, sizeof(bin));
+    syms[1].st_name = 1;
+    syms[1].st_info = STT_FUNC;
+    syms[1].st_value = 0x401000;
+    syms[1].st_size = 0x20;
+    bin.symtab = syms;
+    bin.symtab_count = 2;
+    bin.strtab = strtab;
+    bin.strtab_size = sizeof(strtab);
+
+    f = open_memstream(&text, &len);
+    rosetta_sampler_write_folded(f, &bin);
+    fclose(f);
+    if (!strstr(text, "guest;spin_loop;0x401000 ")) {
+        printf("%s", text);
+        free(text);
+        TEST_FAIL(name, "folded output missing the symbolized block");
+        return;
+    }
+    free(text);
+    rosetta_sampler_unmap_all();
+    TEST_PASS(name);
+}
+#endif
+
+int main(void)
+{
+    printf("=================================================\n");
+    printf("Sampling Profiler Test\n");
+    printf("=================================================\n");
+
+    exec_mem = mmap(NULL, 4096, PROT_READ | PROT_WRITE | PROT_EXEC,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (exec_mem == MAP_FAILED) {
+        perror("mmap");
+        return 1;
+    }
+
+    test_code_map();
+    test_record();
+#if defined(__x86_64__)
+    test_live_sampling();
+#endif
+
+    munmap(exec_mem, 4096);
+
+    printf("\n=================================================\n");
+    printf("Results: %d passed, %d failed\n", tests_passed, tests_failed);
+    printf("=================================================\n");
+
+    return tests_failed > 0 ? 1 : 0;
+}
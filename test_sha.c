@@ -0,0 +1,642 @@
+/*=============================================================================
+ * SHA-1/SHA-256 Translation Test
+ *=============================================================================
+ *
+ * Checks the host SHA steps against FIPS 180-4 with each feature set, and
+ * that translated ARM64 SHA-1 and SHA-256 block loops hash correctly on
+ * SHA-NI. The SHA-256 loop must come out at two SHA256RNDS2 per four
+ * guest rounds, with the SHA256H/SHA256H2 pairs sharing their rounds.
+ *
+ * Build: gcc -std=gnu11 -o test_sha test_sha.c rosetta_sha.c rosetta_pmull.c \
+ *            rosetta_aes.c rosetta_crc32.c rosetta_ir_opt.c rosetta_ir.c \
+ *            rosetta_ir_from_x86.c rosetta_ir_from_arm64.c rosetta_ir_to_arm64.c \
+ *            rosetta_ir_to_x86.c rosetta_ir_to_x86_crypto.c rosetta_regalloc.c \
+ *            rosetta_emit_x86.c rosetta_arm64_emit.c rosetta_insn_cache.c \
+ *            rosetta_translate_mxcsr.c -pthread
+ *
+ *=============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include "rosetta_sha.h"
+#include "rosetta_ir_opt.h"
+#include "rosetta_ir_to_x86.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST_START(name) \
+    printf("\n--- Test: %s ---\n", name)
+
+#define TEST_PASS(name) \
+    do { \
+        tests_passed++; \
+        printf("✅ PASS: %s\n", name); \
+    } while(0)
+
+#define TEST_FAIL(name, reason) \
+    do { \
+        tests_failed++; \
+        printf("❌ FAIL: %s - %s\n", name, reason); \
+    } while(0)
+
+#define EXEC_SIZE       (256 * 1024)
+#define GUEST_BASE      0x10000
+#define MAX_CODE        160
+
+static ir_block_t blk;
+static ir_opt_stats_t stats;
+static uint8_t *exec_mem;
+static ThreadState state;
+
+/* Translated blocks by guest instruction index */
+static uint8_t *block_at[MAX_CODE];
+static size_t exec_used;
+static int rnds2_count, arm_h_count, steps_merged, split_pairs;
+
+static const uint32_t k256[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+static const uint32_t h256[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+static const uint32_t h1[5] = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0 };
+static uint32_t k1[4][4] = {
+    { 0x5a827999, 0x5a827999, 0x5a827999, 0x5a827999 },
+    { 0x6ed9eba1, 0x6ed9eba1, 0x6ed9eba1, 0x6ed9eba1 },
+    { 0x8f1bbcdc, 0x8f1bbcdc, 0x8f1bbcdc, 0x8f1bbcdc },
+    { 0xca62c1d6, 0xca62c1d6, 0xca62c1d6, 0xca62c1d6 }
+};
+
+/* FIPS 180-4 examples: "abc" in one block, the 448-bit message in two */
+static const char msg_short[] = "abc";
+static const char msg_long[] = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+static const uint32_t sha256_short[8] = {
+    0xba7816bf, 0x8f01cfea, 0x414140de, 0x5dae2223, 0xb00361a3, 0x96177a9c, 0xb410ff61, 0xf20015ad
+};
+static const uint32_t sha256_long[8] = {
+    0x248d6a61, 0xd20638b8, 0xe5c02693, 0x0c3e6039, 0xa33ce459, 0x64ff2167, 0xf6ecedd4, 0x19db06c1
+};
+static const uint32_t sha1_short[5] = { 0xa9993e36, 0x4706816a, 0xba3e2571, 0x7850c26c, 0x9cd0d89d };
+static const uint32_t sha1_long[5] = { 0x84983e44, 0x1c3bd26e, 0xbaae4aa1, 0xf95129e5, 0xe54670f1 };
+
+static uint8_t padded[128];
+
+/* ============================================================================
+ * Guest Programs
+ * ============================================================================ */
+
+static uint32_t a64_3reg(uint32_t base, int rd, int rn, int rm)
+{
+    return base | ((uint32_t)rm << 16) | ((uint32_t)rn << 5) | (uint32_t)rd;
+}
+
+/* LDR Qt, [Xn, #off] */
+static uint32_t a64_ldr_q(int rt, int rn, int off)
+{
+    return 0x3DC00000u | ((uint32_t)(off / 16) << 10) | ((uint32_t)rn << 5) | (uint32_t)rt;
+}
+
+#define A64_SHA1C       0x5E000000u
+#define A64_SHA1P       0x5E001000u
+#define A64_SHA1M       0x5E002000u
+#define A64_SHA1SU0     0x5E003000u
+#define A64_SHA256H     0x5E004000u
+#define A64_SHA256H2    0x5E005000u
+#define A64_SHA256SU1   0x5E006000u
+#define A64_SHA1H       0x5E280800u
+#define A64_SHA1SU1     0x5E281800u
+#define A64_SHA256SU0   0x5E282800u
+#define A64_ORR16       0x4EA01C00u     /* ORR Vd.16B, with Vn = Vm a move */
+#define A64_ADD4S       0x4EA08400u
+#define A64_REV32       0x6E200800u
+
+/* Block count in X2 at the end of each loop: add x0, x0, #64; subs; b.ne */
+static int a64_loop_tail(uint32_t *code, int n, int start)
+{
+    code[n++] = 0x91000000u | (64u << 10);                     /* add x0, x0, #64 */
+    code[n++] = 0xF1000442u;                                    /* subs x2, x2, #1 */
+    code[n] = 0x54000001u | (((uint32_t)(start - n) & 0x7FFFF) << 5);   /* b.ne */
+    return n + 1;
+}
+
+/*
+ * One SHA-256 block per iteration: X0 = data, X1 = K table, X2 = blocks,
+ * state in V0 (abcd) and V1 (efgh)
+ */
+static int sha256_program(uint32_t *code)
+{
+    int n = 0, g, i;
+
+    for (i = 0; i < 4; i++) {
+        code[n++] = a64_ldr_q(4 + i, 0, 16 * i);
+    }
+    for (i = 0; i < 4; i++) {
+        code[n++] = a64_3reg(A64_REV32, 4 + i, 4 + i, 0);
+    }
+    code[n++] = a64_3reg(A64_ORR16, 16, 0, 0);
+    code[n++] = a64_3reg(A64_ORR16, 17, 1, 1);
+    for (g = 0; g < 16; g++) {
+        int m = 4 + g % 4;
+
+        code[n++] = a64_ldr_q(20, 1, 16 * g);
+        code[n++] = a64_3reg(A64_ADD4S, 20, 20, m);
+        if (g < 12) {
+            code[n++] = a64_3reg(A64_SHA256SU0, m, 4 + (g + 1) % 4, 0);
+        }
+        code[n++] = a64_3reg(A64_ORR16, 2, 0, 0);
+        code[n++] = a64_3reg(A64_SHA256H, 0, 1, 20);
+        code[n++] = a64_3reg(A64_SHA256H2, 1, 2, 20);
+        if (g < 12) {
+            code[n++] = a64_3reg(A64_SHA256SU1, m, 4 + (g + 2) % 4, 4 + (g + 3) % 4);
+        }
+    }
+    code[n++] = a64_3reg(A64_ADD4S, 0, 0, 16);
+    code[n++] = a64_3reg(A64_ADD4S, 1, 1, 17);
+    return a64_loop_tail(code, n, 0);
+}
+
+/* SHA-1 the same way: abcd in V0, e in S1, the four K vectors at X1 */
+static int sha1_program(uint32_t *code)
+{
+    static const uint32_t rounds[4] = { A64_SHA1C, A64_SHA1P, A64_SHA1M, A64_SHA1P };
+    int n = 0, g, i, e = 1;
+
+    for (i = 0; i < 4; i++) {
+        code[n++] = a64_ldr_q(4 + i, 0, 16 * i);
+    }
+    for (i = 0; i < 4; i++) {
+        code[n++] = a64_3reg(A64_REV32, 4 + i, 4 + i, 0);
+    }
+    code[n++] = a64_3reg(A64_ORR16, 16, 0, 0);
+    code[n++] = a64_3reg(A64_ORR16, 17, 1, 1);
+    for (g = 0; g < 20; g++) {
+        int m = 4 + g % 4;
+
+        code[n++] = a64_ldr_q(18, 1, 16 * (g / 5));
+        code[n++] = a64_3reg(A64_ADD4S, 18, 18, m);
+        code[n++] = a64_3reg(A64_SHA1H, 4 - e, 0, 0);
+        code[n++] = a64_3reg(rounds[g / 5], 0, e, 18);
+        if (g < 16) {
+            code[n++] = a64_3reg(A64_SHA1SU0, m, 4 + (g + 1) % 4, 4 + (g + 2) % 4);
+            code[n++] = a64_3reg(A64_SHA1SU1, m, 4 + (g + 3) % 4, 0);
+        }
+        e = 4 - e;
+    }
+    code[n++] = a64_3reg(A64_ADD4S, 0, 0, 16);
+    code[n++] = a64_3reg(A64_ADD4S, 1, 1, 17);
+    return a64_loop_tail(code, n, 0);
+}
+
+/* ============================================================================
+ * Helpers
+ * ============================================================================ */
+
+/* FIPS 180-4 padding; returns the number of 64-byte blocks */
+static int pad(const char *msg)
+{
+    size_t len = strlen(msg);
+    int blocks = (int)((len + 8) / 64 + 1);
+
+    memset(padded, 0, sizeof(padded));
+    memcpy(padded, msg, len);
+    padded[len] = 0x80;
+    padded[blocks * 64 - 2] = (uint8_t)((len * 8) >> 8);
+    padded[blocks * 64 - 1] = (uint8_t)(len * 8);
+    return blocks;
+}
+
+static void load_be(uint32_t w[4], const uint8_t *p)
+{
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        w[i] = ((uint32_t)p[4 * i] << 24) | ((uint32_t)p[4 * i + 1] << 16) |
+               ((uint32_t)p[4 * i + 2] << 8) | p[4 * i + 3];
+    }
+}
+
+static void add4(uint32_t *out, const uint32_t *a, const uint32_t *b)
+{
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        out[i] = a[i] + b[i];
+    }
+}
+
+/* The guest program's steps on the host; packed uses the x86-form rounds */
+static void host_sha256(uint32_t h[8], const uint8_t *data, int blocks, int packed)
+{
+    uint32_t m[4][4], wk[4], t[4], abef[4], cdgh[4];
+    int b, g, i;
+
+    for (b = 0; b < blocks; b++) {
+        uint32_t *abcd = &h[0], *efgh = &h[4];
+        uint32_t save[8];
+
+        memcpy(save, h, sizeof(save));
+        for (i = 0; i < 4; i++) {
+            load_be(m[i], data + 64 * b + 16 * i);
+        }
+        rosetta_sha_step(ROS_SHA256_ABEF, abef, abcd, efgh, NULL);
+        rosetta_sha_step(ROS_SHA256_CDGH, cdgh, abcd, efgh, NULL);
+        for (g = 0; g < 16; g++) {
+            add4(wk, m[g % 4], &k256[4 * g]);
+            if (g < 12) {
+                rosetta_sha_step(ROS_SHA256SU0, m[g % 4], m[g % 4], m[(g + 1) % 4], NULL);
+            }
+            if (packed) {
+                rosetta_sha_step(ROS_SHA256_RNDS2, cdgh, cdgh, abef, wk);
+                rosetta_sha_step(ROS_SHA256_RNDS2_HI, abef, abef, cdgh, wk);
+            } else {
+                memcpy(t, abcd, sizeof(t));
+                rosetta_sha_step(ROS_SHA256H, abcd, abcd, efgh, wk);
+                rosetta_sha_step(ROS_SHA256H2, efgh, efgh, t, wk);
+            }
+            if (g < 12) {
+                rosetta_sha_step(ROS_SHA256SU1, m[g % 4], m[g % 4], m[(g + 2) % 4],
+                                 m[(g + 3) % 4]);
+            }
+        }
+        if (packed) {
+            rosetta_sha_step(ROS_SHA256_ABCD, abcd, abef, cdgh, NULL);
+            rosetta_sha_step(ROS_SHA256_EFGH, efgh, abef, cdgh, NULL);
+        }
+        add4(abcd, abcd, &save[0]);
+        add4(efgh, efgh, &save[4]);
+    }
+}
+
+static void host_sha1(uint32_t h[5], const uint8_t *data, int blocks)
+{
+    static const rosetta_sha_op_t rounds[4] = { ROS_SHA1C, ROS_SHA1P, ROS_SHA1M, ROS_SHA1P };
+    uint32_t m[4][4], wk[4], e[4] = { 0 }, next[4];
+    int b, g, i;
+
+    for (b = 0; b < blocks; b++) {
+        uint32_t save[5];
+
+        memcpy(save, h, sizeof(save));
+        for (i = 0; i < 4; i++) {
+            load_be(m[i], data + 64 * b + 16 * i);
+        }
+        e[0] = h[4];
+        for (g = 0; g < 20; g++) {
+            add4(wk, m[g % 4], k1[g / 5]);
+            rosetta_sha_step(ROS_SHA1H, next, h, NULL, NULL);
+            rosetta_sha_step(rounds[g / 5], h, h, e, wk);
+            e[0] = next[0];
+            if (g < 16) {
+                rosetta_sha_step(ROS_SHA1SU0, m[g % 4], m[g % 4], m[(g + 1) % 4],
+                                 m[(g + 2) % 4]);
+                rosetta_sha_step(ROS_SHA1SU1, m[g % 4], m[g % 4], m[(g + 3) % 4], NULL);
+            }
+        }
+        for (i = 0; i < 4; i++) {
+            h[i] += save[i];
+        }
+        h[4] = e[0] + save[4];
+    }
+}
+
+static void reset_blocks(void)
+{
+    memset(block_at, 0, sizeof(block_at));
+    exec_used = 0;
+    rnds2_count = arm_h_count = steps_merged = split_pairs = 0;
+}
+
+static int compile(const uint32_t *code, int n, int idx, uint32_t passes)
+{
+    code_buf_t buf;
+    int i;
+
+    memset(&stats, 0, sizeof(stats));
+    if (ir_arm64_lower_block(&blk, code + idx, GUEST_BASE + 4 * (uint64_t)idx, n - idx) <= 0 ||
+        ir_optimize(&blk, passes, &stats) != 0) {
+        return -1;
+    }
+    /* A block starting at SHA256H or SHA256H2 cannot share the group's rounds */
+    split_pairs += idx > 0 && ((code[idx] & 0xFFE0FC00u) == A64_SHA256H ||
+                               (code[idx] & 0xFFE0FC00u) == A64_SHA256H2);
+    for (i = 0; i < blk.count; i++) {
+        if (blk.insns[i].op != IR_SHA) {
+            continue;
+        }
+        rnds2_count += blk.insns[i].imm == IR_SHA256_RNDS2 || blk.insns[i].imm == IR_SHA256_RNDS2_HI;
+        arm_h_count += blk.insns[i].imm == IR_SHA256H || blk.insns[i].imm == IR_SHA256H2;
+    }
+    steps_merged += (int)stats.sha_steps_merged;
+
+    code_buf_init(&buf, exec_mem + exec_used, EXEC_SIZE - exec_used);
+    if (ir_emit_x86(&blk, &buf) != 0) {
+        return -1;
+    }
+    block_at[idx] = exec_mem + exec_used;
+    exec_used += (buf.offset + 15) & ~(size_t)15;
+    return 0;
+}
+
+/* Run the guest program from its first instruction until it falls off the end */
+static int run_guest(const uint32_t *code, int n)
+{
+    uint64_t pc = GUEST_BASE;
+
+    while (pc != GUEST_BASE + 4 * (uint64_t)n) {
+        int idx = (int)((pc - GUEST_BASE) / 4);
+
+        if (pc < GUEST_BASE || idx >= n) {
+            return -1;
+        }
+        if (!block_at[idx] && compile(code, n, idx, IR_OPT_ALL) != 0) {
+            return -1;
+        }
+        ((void (*)(ThreadState *))block_at[idx])(&state);
+        pc = state.host.pc;
+    }
+    return 0;
+}
+
+/* ============================================================================
+ * Tests
+ * ============================================================================ */
+
+static int check_host(char *why, size_t why_len)
+{
+    static const struct {
+        const char *msg;
+        const uint32_t *sha256;
+        const uint32_t *sha1;
+    } cases[2] = {
+        { msg_short, sha256_short, sha1_short },
+        { msg_long, sha256_long, sha1_long },
+    };
+    uint32_t h[8];
+    int i, packed;
+
+    for (i = 0; i < 2; i++) {
+        int blocks = pad(cases[i].msg);
+
+        for (packed = 0; packed < 2; packed++) {
+            memcpy(h, h256, sizeof(h));
+            host_sha256(h, padded, blocks, packed);
+            if (memcmp(h, cases[i].sha256, sizeof(h)) != 0) {
+                snprintf(why, why_len, "SHA-256 of %d block(s), %s rounds", blocks,
+                         packed ? "SHA256RNDS2" : "SHA256H/H2");
+                return -1;
+            }
+        }
+        memcpy(h, h1, sizeof(h1));
+        host_sha1(h, padded, blocks);
+        if (memcmp(h, cases[i].sha1, sizeof(h1)) != 0) {
+            snprintf(why, why_len, "SHA-1 of %d block(s)", blocks);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* Every step against the scalar implementation on random inputs */
+static int check_agree(uint32_t hw, char *why, size_t why_len)
+{
+    uint32_t in[3][4], got[4], want[4];
+    int iter, op, i;
+
+    srand(45);
+    for (iter = 0; iter < 500; iter++) {
+        for (i = 0; i < 12; i++) {
+            in[i / 4][i % 4] = ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+        }
+        for (op = 0; op < ROS_SHA_OP_COUNT; op++) {
+            rosetta_sha_set_hw(0);
+            rosetta_sha_step((rosetta_sha_op_t)op, want, in[0], in[1], in[2]);
+            rosetta_sha_set_hw(hw);
+            rosetta_sha_step((rosetta_sha_op_t)op, got, in[0], in[1], in[2]);
+            if (memcmp(got, want, sizeof(got)) != 0) {
+                snprintf(why, why_len, "step %d disagrees with scalar", op);
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+static void test_host(uint32_t hw)
+{
+    char name[64];
+    char why[128];
+
+    snprintf(name, sizeof(name), "FIPS 180-4 with %s",
+             (hw & ROS_SHA_HW_SHANI) ? "SHA-NI" : hw ? "SSE2" : "scalar code");
+    TEST_START(name);
+
+    if (rosetta_sha_set_hw(hw) != 0 || rosetta_sha_hw() != hw) {
+        TEST_FAIL(name, "could not select a supported feature set");
+        return;
+    }
+    if ((hw && check_agree(hw, why, sizeof(why)) != 0) || check_host(why, sizeof(why)) != 0) {
+        TEST_FAIL(name, why);
+        return;
+    }
+    TEST_PASS(name);
+}
+
+static void test_translated_sha256(void)
+{
+    const char *name = "Translated SHA-256 loop runs on SHA256RNDS2";
+    uint32_t code[MAX_CODE];
+    int n = sha256_program(code);
+    int i;
+
+    TEST_START(name);
+
+    reset_blocks();
+    for (i = 0; i < 2; i++) {
+        int blocks = pad(i ? msg_long : msg_short);
+
+        memset(&state, 0, sizeof(state));
+        memcpy(state.host.v[0].u32, &h256[0], 16);
+        memcpy(state.host.v[1].u32, &h256[4], 16);
+        state.host.x[0] = (uint64_t)(uintptr_t)padded;
+        state.host.x[1] = (uint64_t)(uintptr_t)k256;
+        state.host.x[2] = (uint64_t)blocks;
+        if (run_guest(code, n) != 0) {
+            TEST_FAIL(name, "block not emitted");
+            return;
+        }
+        if (memcmp(state.host.v[0].u32, &(i ? sha256_long : sha256_short)[0], 16) != 0 ||
+            memcmp(state.host.v[1].u32, &(i ? sha256_long : sha256_short)[4], 16) != 0) {
+            TEST_FAIL(name, "wrong digest");
+            return;
+        }
+        if (state.host.x[2] != 0 || state.host.x[0] != (uint64_t)(uintptr_t)padded + 64 * blocks) {
+            TEST_FAIL(name, "loop registers wrong");
+            return;
+        }
+    }
+    if (rnds2_count != 32 + 2 * split_pairs || arm_h_count != 0 || steps_merged < 32) {
+        char why[96];
+        snprintf(why, sizeof(why), "%d SHA256RNDS2 (%d split pairs), %d SHA256H/H2, %d merged",
+                 rnds2_count, split_pairs, arm_h_count, steps_merged);
+        TEST_FAIL(name, why);
+        return;
+    }
+    TEST_PASS(name);
+}
+
+static void test_translated_sha1(void)
+{
+    const char *name = "Translated SHA-1 loop";
+    uint32_t code[MAX_CODE];
+    int n = sha1_program(code);
+    int i;
+
+    TEST_START(name);
+
+    reset_blocks();
+    for (i = 0; i < 2; i++) {
+        const uint32_t *want = i ? sha1_long : sha1_short;
+        int blocks = pad(i ? msg_long : msg_short);
+
+        memset(&state, 0, sizeof(state));
+        memcpy(state.host.v[0].u32, h1, 16);
+        state.host.v[1].u32[0] = h1[4];
+        state.host.x[0] = (uint64_t)(uintptr_t)padded;
+        state.host.x[1] = (uint64_t)(uintptr_t)k1;
+        state.host.x[2] = (uint64_t)blocks;
+        if (run_guest(code, n) != 0) {
+            TEST_FAIL(name, "block not emitted");
+            return;
+        }
+        if (memcmp(state.host.v[0].u32, want, 16) != 0 || state.host.v[1].u32[0] != want[4]) {
+            TEST_FAIL(name, "wrong digest");
+            return;
+        }
+    }
+    TEST_PASS(name);
+}
+
+static void test_no_shani(void)
+{
+    const char *name = "Blocks with SHA steps need SHA-NI";
+    uint32_t code[MAX_CODE];
+    int n = sha1_program(code);
+
+    TEST_START(name);
+
+    rosetta_sha_set_hw(rosetta_sha_hw_supported() & ROS_SHA_HW_SSE2);
+    reset_blocks();
+    if (compile(code, n, 0, IR_OPT_ALL) != -1) {
+        TEST_FAIL(name, "emitted without SHA-NI");
+        return;
+    }
+    TEST_PASS(name);
+}
+
+static void test_lowering(void)
+{
+    const char *name = "SHA lowering and verification";
+    ir_ref_t a, b, g, s;
+    int i, packs = 0, rounds = 0;
+
+    TEST_START(name);
+
+    /* SHA256H becomes pack, two rounds, unpack */
+    ir_block_init(&blk, 0);
+    if (ir_arm64_lower_insn(&blk, a64_3reg(A64_SHA256H, 0, 1, 2), 0) != 0) {
+        TEST_FAIL(name, "SHA256H not lowered");
+        return;
+    }
+    for (i = 0; i < blk.count; i++) {
+        if (blk.insns[i].op == IR_SHA) {
+            packs += blk.insns[i].imm == IR_SHA256_ABEF || blk.insns[i].imm == IR_SHA256_CDGH;
+            rounds += blk.insns[i].imm == IR_SHA256_RNDS2 || blk.insns[i].imm == IR_SHA256_RNDS2_HI;
+        }
+    }
+    if (packs != 2 || rounds != 2 || blk.insns[blk.count - 1].reg != IR_ARM64_V0) {
+        ir_print(&blk, stdout);
+        TEST_FAIL(name, "SHA256H not lowered to SHA256RNDS2 form");
+        return;
+    }
+
+    /* Third input must be present and a vector */
+    ir_block_init(&blk, 0);
+    a = ir_get_vreg(&blk, IR_ARM64_V0);
+    b = ir_get_vreg(&blk, IR_ARM64_V0 + 1);
+    g = ir_get_reg(&blk, 0);
+    s = ir_sha(&blk, IR_SHA1C, a, b, b);
+    ir_br(&blk, 0);
+    if (ir_verify(&blk) != 0) {
+        TEST_FAIL(name, "valid SHA1C rejected");
+        return;
+    }
+    blk.insns[s].index = g;
+    if (ir_verify(&blk) == 0) {
+        TEST_FAIL(name, "SHA1C with a scalar input verified");
+        return;
+    }
+    blk.insns[s].index = IR_NONE;
+    if (ir_verify(&blk) == 0) {
+        TEST_FAIL(name, "SHA1C without W+K verified");
+        return;
+    }
+    blk.insns[s].imm = IR_SHA1SU1;
+    if (ir_verify(&blk) != 0) {
+        TEST_FAIL(name, "valid SHA1SU1 rejected");
+        return;
+    }
+    TEST_PASS(name);
+}
+
+int main(void)
+{
+    uint32_t supported;
+
+    ir_x86_register_crypto();
+
+    printf("=================================================\n");
+    printf("SHA-1/SHA-256 Translation Test\n");
+    printf("=================================================\n");
+
+    exec_mem = mmap(NULL, EXEC_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (exec_mem == MAP_FAILED) {
+        perror("mmap");
+        return 1;
+    }
+
+    test_lowering();
+    supported = rosetta_sha_hw_supported();
+    test_host(0);
+    if (supported & ROS_SHA_HW_SSE2) {
+        test_host(ROS_SHA_HW_SSE2);
+    }
+    if (supported & ROS_SHA_HW_SHANI) {
+        test_host(supported);
+        test_translated_sha256();
+        test_translated_sha1();
+    } else {
+        printf("\nSHA-NI not available, skipping translated blocks\n");
+    }
+    test_no_shani();
+    rosetta_sha_set_hw(supported);
+
+    munmap(exec_mem, EXEC_SIZE);
+
+    printf("\n=================================================\n");
+    printf("Results: %d passed, %d failed\n", tests_passed, tests_failed);
+    printf("=================================================\n");
+
+    return tests_failed > 0 ? 1 : 0;
+}
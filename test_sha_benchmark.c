@@ -0,0 +1,313 @@
+/* ============================================================================
+ * Rosetta 2 SHA-256 Translation Benchmark
+ * ============================================================================
+ *
+ * Hashes 1 GiB through a translated ARM64 SHA-256 block loop (SHA256H,
+ * SHA256H2, SHA256SU0/SU1) on SHA-NI, with and without ir_opt_sha_fuse()
+ * sharing the rounds of each SHA256H/SHA256H2 pair, and reports the host
+ * step implementations the interpreter path would use for comparison.
+ * Every mode must produce the same digest.
+ *
+ * Build: gcc -std=gnu11 -O2 -o test_sha_benchmark test_sha_benchmark.c \
+ *            rosetta_sha.c rosetta_pmull.c rosetta_aes.c rosetta_crc32.c \
+ *            rosetta_ir_opt.c rosetta_ir.c rosetta_ir_from_x86.c \
+ *            rosetta_ir_from_arm64.c rosetta_ir_to_arm64.c rosetta_ir_to_x86.c \
+ *            rosetta_ir_to_x86_crypto.c rosetta_regalloc.c rosetta_emit_x86.c \
+ *            rosetta_arm64_emit.c rosetta_insn_cache.c \
+ *            rosetta_translate_mxcsr.c -pthread
+ * ============================================================================ */
+
+#include "rosetta_sha.h"
+#include "rosetta_ir_opt.h"
+#include "rosetta_ir_to_x86.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <sys/mman.h>
+
+#define BENCH_BUF_SIZE      (1024 * 1024)
+#define BENCH_TOTAL_BYTES   (1024ULL * 1024 * 1024)
+#define BENCH_HOST_BYTES    (64ULL * 1024 * 1024)
+
+#define EXEC_SIZE           (256 * 1024)
+#define GUEST_BASE          0x10000
+#define MAX_CODE            160
+
+static const uint32_t k256[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+static const uint32_t h256[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+static uint8_t *data;
+static uint8_t *exec_mem;
+static ThreadState state;
+static ir_block_t blk;
+static uint8_t *block_at[MAX_CODE];
+static size_t exec_used;
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* ============================================================================
+ * Guest Program
+ * ============================================================================ */
+
+static uint32_t a64_3reg(uint32_t base, int rd, int rn, int rm)
+{
+    return base | ((uint32_t)rm << 16) | ((uint32_t)rn << 5) | (uint32_t)rd;
+}
+
+static uint32_t a64_ldr_q(int rt, int rn, int off)
+{
+    return 0x3DC00000u | ((uint32_t)(off / 16) << 10) | ((uint32_t)rn << 5) | (uint32_t)rt;
+}
+
+/*
+ * The usual SHA-256 crypto extension loop: X0 = data, X1 = K table,
+ * X2 = blocks, state in V0 (abcd) and V1 (efgh)
+ */
+static int sha256_program(uint32_t *code)
+{
+    int n = 0, g, i;
+
+    for (i = 0; i < 4; i++) {
+        code[n++] = a64_ldr_q(4 + i, 0, 16 * i);
+    }
+    for (i = 0; i < 4; i++) {
+        code[n++] = a64_3reg(0x6E200800u, 4 + i, 4 + i, 0);     /* rev32 */
+    }
+    code[n++] = a64_3reg(0x4EA01C00u, 16, 0, 0);                /* mov v16, v0 */
+    code[n++] = a64_3reg(0x4EA01C00u, 17, 1, 1);
+    for (g = 0; g < 16; g++) {
+        int m = 4 + g % 4;
+
+        code[n++] = a64_ldr_q(20, 1, 16 * g);
+        code[n++] = a64_3reg(0x4EA08400u, 20, 20, m);           /* add .4s */
+        if (g < 12) {
+            code[n++] = a64_3reg(0x5E282800u, m, 4 + (g + 1) % 4, 0);
+        }
+        code[n++] = a64_3reg(0x4EA01C00u, 2, 0, 0);
+        code[n++] = a64_3reg(0x5E004000u, 0, 1, 20);            /* sha256h */
+        code[n++] = a64_3reg(0x5E005000u, 1, 2, 20);            /* sha256h2 */
+        if (g < 12) {
+            code[n++] = a64_3reg(0x5E006000u, m, 4 + (g + 2) % 4, 4 + (g + 3) % 4);
+        }
+    }
+    code[n++] = a64_3reg(0x4EA08400u, 0, 0, 16);
+    code[n++] = a64_3reg(0x4EA08400u, 1, 1, 17);
+    code[n++] = 0x91000000u | (64u << 10);                      /* add x0, x0, #64 */
+    code[n++] = 0xF1000442u;                                    /* subs x2, x2, #1 */
+    code[n] = 0x54000001u | (((uint32_t)-n & 0x7FFFF) << 5);    /* b.ne 0 */
+    return n + 1;
+}
+
+/* ============================================================================
+ * Translation and Dispatch
+ * ============================================================================ */
+
+static int translate(const uint32_t *code, int n, uint32_t passes)
+{
+    int idx = 0;
+
+    memset(block_at, 0, sizeof(block_at));
+    exec_used = 0;
+    while (idx < n) {
+        code_buf_t buf;
+        int lowered = ir_arm64_lower_block(&blk, code + idx, GUEST_BASE + 4 * (uint64_t)idx,
+                                           n - idx);
+
+        if (lowered <= 0 || ir_optimize(&blk, passes, NULL) != 0) {
+            return -1;
+        }
+        code_buf_init(&buf, exec_mem + exec_used, EXEC_SIZE - exec_used);
+        if (ir_emit_x86(&blk, &buf) != 0) {
+            return -1;
+        }
+        block_at[idx] = exec_mem + exec_used;
+        exec_used += (buf.offset + 15) & ~(size_t)15;
+        idx += lowered;
+    }
+    return 0;
+}
+
+/* Blocks start only where translate() started them */
+static void run_guest(int n)
+{
+    uint64_t pc = GUEST_BASE;
+
+    while (pc != GUEST_BASE + 4 * (uint64_t)n) {
+        ((void (*)(ThreadState *))block_at[(pc - GUEST_BASE) / 4])(&state);
+        pc = state.host.pc;
+    }
+}
+
+/* ============================================================================
+ * Host Steps
+ * ============================================================================ */
+
+static void host_sha256(uint32_t h[8], const uint8_t *p, size_t blocks)
+{
+    uint32_t m[4][4], wk[4], t[4], save[8];
+    size_t b;
+    int g, i;
+
+    for (b = 0; b < blocks; b++, p += 64) {
+        memcpy(save, h, sizeof(save));
+        for (i = 0; i < 16; i++) {
+            m[i / 4][i % 4] = ((uint32_t)p[4 * i] << 24) | ((uint32_t)p[4 * i + 1] << 16) |
+                              ((uint32_t)p[4 * i + 2] << 8) | p[4 * i + 3];
+        }
+        for (g = 0; g < 16; g++) {
+            for (i = 0; i < 4; i++) {
+                wk[i] = m[g % 4][i] + k256[4 * g + i];
+            }
+            if (g < 12) {
+                rosetta_sha_step(ROS_SHA256SU0, m[g % 4], m[g % 4], m[(g + 1) % 4], NULL);
+            }
+            memcpy(t, h, sizeof(t));
+            rosetta_sha_step(ROS_SHA256H, &h[0], &h[0], &h[4], wk);
+            rosetta_sha_step(ROS_SHA256H2, &h[4], &h[4], t, wk);
+            if (g < 12) {
+                rosetta_sha_step(ROS_SHA256SU1, m[g % 4], m[g % 4], m[(g + 2) % 4],
+                                 m[(g + 3) % 4]);
+            }
+        }
+        for (i = 0; i < 8; i++) {
+            h[i] += save[i];
+        }
+    }
+}
+
+/* ============================================================================
+ * Benchmarks
+ * ============================================================================ */
+
+static int bench_translated(const char *label, uint32_t passes, uint32_t digest[8])
+{
+    uint32_t code[MAX_CODE];
+    int n = sha256_program(code);
+    uint64_t done;
+    double t0, secs;
+
+    if (translate(code, n, passes) != 0) {
+        printf("%-28s  not translated\n", label);
+        return -1;
+    }
+
+    memset(&state, 0, sizeof(state));
+    memcpy(state.host.v[0].u32, &h256[0], 16);
+    memcpy(state.host.v[1].u32, &h256[4], 16);
+    state.host.x[1] = (uint64_t)(uintptr_t)k256;
+
+    t0 = now_sec();
+    for (done = 0; done < BENCH_TOTAL_BYTES; done += BENCH_BUF_SIZE) {
+        state.host.x[0] = (uint64_t)(uintptr_t)data;
+        state.host.x[2] = BENCH_BUF_SIZE / 64;
+        run_guest(n);
+    }
+    secs = now_sec() - t0;
+
+    memcpy(&digest[0], state.host.v[0].u32, 16);
+    memcpy(&digest[4], state.host.v[1].u32, 16);
+    printf("%-28s  %8.1f MB/s  (%zu bytes of x86)\n", label,
+           BENCH_TOTAL_BYTES / secs / 1e6, exec_used);
+    return 0;
+}
+
+static void bench_host(const char *label, uint32_t hw, uint32_t digest[8])
+{
+    uint64_t done;
+    double t0, secs;
+
+    rosetta_sha_set_hw(hw);
+    memcpy(digest, h256, 32);
+    t0 = now_sec();
+    for (done = 0; done < BENCH_HOST_BYTES; done += BENCH_BUF_SIZE) {
+        host_sha256(digest, data, BENCH_BUF_SIZE / 64);
+    }
+    secs = now_sec() - t0;
+    printf("%-28s  %8.1f MB/s\n", label, BENCH_HOST_BYTES / secs / 1e6);
+}
+
+int main(void)
+{
+    uint32_t supported = rosetta_sha_hw_supported();
+    uint32_t fused[8], unfused[8], ref[8], host[8];
+    size_t i;
+    int status = 0;
+
+    ir_x86_register_crypto();
+
+    printf("=================================================\n");
+    printf("SHA-256 Translation Benchmark\n");
+    printf("=================================================\n");
+
+    data = malloc(BENCH_BUF_SIZE);
+    exec_mem = mmap(NULL, EXEC_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (!data || exec_mem == MAP_FAILED) {
+        perror("alloc");
+        return 1;
+    }
+    srand(45);
+    for (i = 0; i < BENCH_BUF_SIZE; i++) {
+        data[i] = (uint8_t)rand();
+    }
+
+    /* 64 MiB reference digest for the host modes */
+    rosetta_sha_set_hw(0);
+    memcpy(ref, h256, 32);
+    for (i = 0; i < BENCH_HOST_BYTES / BENCH_BUF_SIZE; i++) {
+        host_sha256(ref, data, BENCH_BUF_SIZE / 64);
+    }
+
+    printf("\nTranslated guest loop, %llu MiB:\n", BENCH_TOTAL_BYTES >> 20);
+    if (supported & ROS_SHA_HW_SHANI) {
+        rosetta_sha_set_hw(supported);
+        if (bench_translated("SHA-NI, rounds shared", IR_OPT_ALL, fused) != 0 ||
+            bench_translated("SHA-NI, unfused", IR_OPT_ALL & ~IR_OPT_SHA_FUSE, unfused) != 0) {
+            status = 1;
+        } else if (memcmp(fused, unfused, sizeof(fused)) != 0) {
+            printf("digest mismatch between translated modes\n");
+            status = 1;
+        }
+    } else {
+        printf("SHA-NI not available, guest code would be interpreted\n");
+    }
+
+    printf("\nHost steps (interpreter path), %llu MiB:\n", BENCH_HOST_BYTES >> 20);
+    if (supported & ROS_SHA_HW_SHANI) {
+        bench_host("SHA-NI", supported, host);
+        status |= memcmp(host, ref, sizeof(ref)) != 0;
+    }
+    if (supported & ROS_SHA_HW_SSE2) {
+        bench_host("SSE2 schedule", ROS_SHA_HW_SSE2, host);
+        status |= memcmp(host, ref, sizeof(ref)) != 0;
+    }
+    bench_host("scalar", 0, host);
+    status |= memcmp(host, ref, sizeof(ref)) != 0;
+    rosetta_sha_set_hw(supported);
+
+    if (status) {
+        printf("\nFAILED: implementations disagree\n");
+    }
+
+    munmap(exec_mem, EXEC_SIZE);
+    free(data);
+    return status;
+}
@@ -0,0 +1,1868 @@
+/*=============================================================================
+ * SSE to NEON Lowering Differential Test
+ *=============================================================================
+ *
+ * For every entry in the SSE lowering table, runs the real instruction on
+ * the host and its NEON lowering on a small ARM64 interpreter, from the same
+ * random and edge-case inputs, and compares the XMM registers, GPRs and (for
+ * flag-writing forms) ZF/CF/PF. Register, same-register, [base + disp] and
+ * RIP-relative operand forms are covered, and every imm8 value is swept.
+ * The VEX forms of the same entries and the AVX-only table are run the same
+ * way at both vector lengths, with the upper YMM halves kept in ThreadState.
+ *
+ * The interpreter covers only the encoding classes the lowering emits and
+ * fails on anything else, so a stray encoding shows up as a failure.
+ *
+ * Build: gcc -std=gnu11 -o test_sse_neon test_sse_neon.c test_a64_interp.c \
+ *            rosetta_translate_simd.c rosetta_translate_avx.c rosetta_arm64_emit.c \
+ *            rosetta_x86_decode.c rosetta_insn_cache.c -lm -pthread
+ *
+ *=============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <errno.h>
+#include <setjmp.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include "rosetta_translate_simd.h"
+#include "rosetta_translate_avx.h"
+#include "rosetta_exec_context.h"
+#include "rosetta_arm64_emit.h"
+#include "test_a64_interp.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST_START(name) \
+    printf("\n--- Test: %s ---\n", name)
+
+#define TEST_PASS(name) \
+    do { \
+        tests_passed++; \
+        printf("✅ PASS: %s\n", name); \
+    } while(0)
+
+#define TEST_FAIL(name, reason) \
+    do { \
+        tests_failed++; \
+        printf("❌ FAIL: %s - %s\n", name, reason); \
+    } while(0)
+
+#if defined(__x86_64__)
+
+typedef a64_vreg_t vreg_t;
+
+/* ============================================================================
+ * ARM64 Interpreter Hooks (test_a64_interp.c)
+ * ============================================================================ */
+
+#define NEON_Q_BIT      0x40000000u
+
+static uint64_t lane_u(const vreg_t *v, int size, int i)
+{
+    switch (size) {
+    case 0: return v->b[i];
+    case 1: return v->h[i];
+    case 2: return v->s[i];
+    default: return v->d[i];
+    }
+}
+
+static int64_t lane_s(const vreg_t *v, int size, int i)
+{
+    int sh = 64 - (8 << size);
+    return (int64_t)(lane_u(v, size, i) << sh) >> sh;
+}
+
+static void lane_set(vreg_t *v, int size, int i, uint64_t x)
+{
+    switch (size) {
+    case 0: v->b[i] = (uint8_t)x; break;
+    case 1: v->h[i] = (uint16_t)x; break;
+    case 2: v->s[i] = (uint32_t)x; break;
+    default: v->d[i] = x; break;
+    }
+}
+
+static uint64_t ones(int size)
+{
+    return size == 3 ? ~0ull : (1ull << (8 << size)) - 1;
+}
+
+static uint64_t sat_s(__int128 x, int size)
+{
+    __int128 hi = ((__int128)1 << ((8 << size) - 1)) - 1;
+    __int128 lo = -hi - 1;
+    return (uint64_t)(x > hi ? hi : x < lo ? lo : x) & ones(size);
+}
+
+static uint64_t sat_u(__int128 x, int size)
+{
+    __int128 hi = ((__int128)1 << (8 << size)) - 1;
+    return (uint64_t)(x > hi ? hi : x < 0 ? 0 : x);
+}
+
+static double fp_get(const vreg_t *v, int sz, int i)
+{
+    return sz ? v->df[i] : (double)v->f[i];
+}
+
+static void fp_set(vreg_t *v, int sz, int i, double x)
+{
+    if (sz) {
+        v->df[i] = x;
+    } else {
+        v->f[i] = (float)x;
+    }
+}
+
+/* Single-precision arithmetic must round once, in float */
+static double fp_op(int sz, int op, double a, double b)
+{
+    if (!sz) {
+        float fa = (float)a, fb = (float)b;
+        switch (op) {
+        case 0: return fa + fb;
+        case 1: return fa - fb;
+        case 2: return fa * fb;
+        case 3: return fa / fb;
+        default: return sqrtf(fa);
+        }
+    }
+    switch (op) {
+    case 0: return a + b;
+    case 1: return a - b;
+    case 2: return a * b;
+    case 3: return a / b;
+    default: return sqrt(a);
+    }
+}
+
+static int64_t fcvtzs(double x, int size)
+{
+    double lim = size == 3 ? 9223372036854775808.0 : 2147483648.0;
+
+    if (x != x) {
+        return 0;
+    }
+    if (x >= lim) {
+        return size == 3 ? INT64_MAX : INT32_MAX;
+    }
+    if (x < -lim) {
+        return size == 3 ? INT64_MIN : INT32_MIN;
+    }
+    return (int64_t)x;
+}
+
+static uint64_t shl_lane(uint64_t x, int sh, int size, int sign)
+{
+    int esize = 8 << size;
+
+    if (sh >= 0) {
+        return sh >= esize ? 0 : (x << sh) & ones(size);
+    }
+    sh = -sh;
+    if (sign) {
+        int64_t s = (int64_t)(x << (64 - esize)) >> (64 - esize);
+        return (uint64_t)(sh >= esize ? (s < 0 ? -1 : 0) : s >> sh) & ones(size);
+    }
+    return sh >= esize ? 0 : x >> sh;
+}
+
+static int a64_three_same(a64_t *c, uint32_t w)
+{
+    int q = (w >> 30) & 1, u = (w >> 29) & 1, size = (w >> 22) & 3, opc = (w >> 11) & 31;
+    vreg_t *n = &c->v[(w >> 5) & 31], *m = &c->v[(w >> 16) & 31], *d = &c->v[w & 31];
+    int bytes = q ? 16 : 8;
+    vreg_t r;
+    int i;
+
+    memset(&r, 0, sizeof(r));
+    if (opc == 0x03) {
+        for (i = 0; i < bytes; i++) {
+            uint8_t a = n->b[i], b = m->b[i], x = d->b[i];
+            switch (u << 2 | size) {
+            case 0: r.b[i] = a & b; break;
+            case 1: r.b[i] = a & ~b; break;
+            case 2: r.b[i] = a | b; break;
+            case 3: r.b[i] = a | ~b; break;
+            case 4: r.b[i] = a ^ b; break;
+            case 5: r.b[i] = (x & a) | (~x & b); break;
+            case 6: r.b[i] = (b & a) | (~b & x); break;
+            case 7: r.b[i] = (~b & a) | (b & x); break;
+            }
+        }
+    } else if (opc >= 0x18) {
+        int sz = size & 1, hi = size >> 1;
+        int lanes = bytes >> (2 + sz);
+
+        for (i = 0; i < lanes; i++) {
+            double a = fp_get(n, sz, i), b = fp_get(m, sz, i);
+            uint64_t t;
+
+            switch (opc << 2 | u << 1 | hi) {
+            case 0x1A << 2: fp_set(&r, sz, i, fp_op(sz, 0, a, b)); break;
+            case 0x1A << 2 | 1: fp_set(&r, sz, i, fp_op(sz, 1, a, b)); break;
+            case 0x1A << 2 | 2: {
+                const vreg_t *src = i < lanes / 2 ? n : m;
+                int j = (i % (lanes / 2)) * 2;
+                fp_set(&r, sz, i, fp_op(sz, 0, fp_get(src, sz, j), fp_get(src, sz, j + 1)));
+                break;
+            }
+            case 0x1B << 2 | 2: fp_set(&r, sz, i, fp_op(sz, 2, a, b)); break;
+            case 0x1F << 2 | 2: fp_set(&r, sz, i, fp_op(sz, 3, a, b)); break;
+            case 0x1C << 2: t = a == b; lane_set(&r, 2 + sz, i, t ? ones(2 + sz) : 0); break;
+            case 0x1C << 2 | 2: t = a >= b; lane_set(&r, 2 + sz, i, t ? ones(2 + sz) : 0); break;
+            case 0x1C << 2 | 3: t = a > b; lane_set(&r, 2 + sz, i, t ? ones(2 + sz) : 0); break;
+            default: return -1;
+            }
+        }
+    } else {
+        int lanes = bytes >> size;
+
+        for (i = 0; i < lanes; i++) {
+            uint64_t ua = lane_u(n, size, i), ub = lane_u(m, size, i);
+            int64_t sa = lane_s(n, size, i), sb = lane_s(m, size, i);
+            uint64_t x;
+
+            switch (opc << 1 | u) {
+            case 0x01 << 1: x = sat_s((__int128)sa + sb, size); break;
+            case 0x01 << 1 | 1: x = sat_u((__int128)ua + ub, size); break;
+            case 0x02 << 1 | 1: x = (uint64_t)(((unsigned __int128)ua + ub + 1) >> 1); break;
+            case 0x05 << 1: x = sat_s((__int128)sa - sb, size); break;
+            case 0x05 << 1 | 1: x = sat_u((__int128)ua - ub, size); break;
+            case 0x06 << 1: x = sa > sb ? ones(size) : 0; break;
+            case 0x08 << 1: x = shl_lane(ua, (int8_t)ub, size, 1); break;
+            case 0x08 << 1 | 1: x = shl_lane(ua, (int8_t)ub, size, 0); break;
+            case 0x0C << 1: x = (uint64_t)(sa > sb ? sa : sb); break;
+            case 0x0C << 1 | 1: x = ua > ub ? ua : ub; break;
+            case 0x0D << 1: x = (uint64_t)(sa < sb ? sa : sb); break;
+            case 0x0D << 1 | 1: x = ua < ub ? ua : ub; break;
+            case 0x0E << 1 | 1: x = ua > ub ? ua - ub : ub - ua; break;
+            case 0x10 << 1: x = ua + ub; break;
+            case 0x10 << 1 | 1: x = ua - ub; break;
+            case 0x11 << 1 | 1: x = ua == ub ? ones(size) : 0; break;
+            case 0x13 << 1: x = ua * ub; break;
+            case 0x14 << 1 | 1:
+            case 0x17 << 1: {
+                const vreg_t *src = i < lanes / 2 ? n : m;
+                int j = (i % (lanes / 2)) * 2;
+                uint64_t p = lane_u(src, size, j), p2 = lane_u(src, size, j + 1);
+                x = opc == 0x17 ? p + p2 : (p > p2 ? p : p2);
+                break;
+            }
+            default: return -1;
+            }
+            lane_set(&r, size, i, x & ones(size));
+        }
+    }
+    *d = r;
+    return 0;
+}
+
+static int a64_three_diff(a64_t *c, uint32_t w)
+{
+    int q = (w >> 30) & 1, u = (w >> 29) & 1, size = (w >> 22) & 3, opc = (w >> 12) & 15;
+    vreg_t *n = &c->v[(w >> 5) & 31], *m = &c->v[(w >> 16) & 31];
+    int lanes = 8 >> size, base = q ? lanes : 0;
+    vreg_t r;
+    int i;
+
+    if (opc != 0xC) {
+        return -1;
+    }
+    memset(&r, 0, sizeof(r));
+    for (i = 0; i < lanes; i++) {
+        uint64_t x = u ? lane_u(n, size, base + i) * lane_u(m, size, base + i)
+                       : (uint64_t)(lane_s(n, size, base + i) * lane_s(m, size, base + i));
+        lane_set(&r, size + 1, i, x);
+    }
+    c->v[w & 31] = r;
+    return 0;
+}
+
+/* Narrowing writes the low half (clearing the high half) or, for Q=1, the high half */
+static void narrow_store(vreg_t *d, int q, int size, const uint64_t *x)
+{
+    int lanes = 8 >> size, i;
+
+    if (!q) {
+        memset(d, 0, sizeof(*d));
+    }
+    for (i = 0; i < lanes; i++) {
+        lane_set(d, size, (q ? lanes : 0) + i, x[i]);
+    }
+}
+
+static int a64_two_misc(a64_t *c, uint32_t w)
+{
+    int q = (w >> 30) & 1, u = (w >> 29) & 1, size = (w >> 22) & 3, opc = (w >> 12) & 31;
+    vreg_t *n = &c->v[(w >> 5) & 31], *d = &c->v[w & 31];
+    int bytes = q ? 16 : 8, sz = size & 1, hi = size >> 1;
+    vreg_t r, src = *n;
+    uint64_t x[16];
+    int i;
+
+    memset(&r, 0, sizeof(r));
+    switch (opc << 1 | u) {
+    case 0x00 << 1:
+        for (i = 0; i < (bytes >> size); i++) {
+            int per = 8 >> size;
+            lane_set(&r, size, i, lane_u(&src, size, (i / per) * per + per - 1 - i % per));
+        }
+        break;
+    case 0x02 << 1 | 1:
+        for (i = 0; i < (bytes >> (size + 1)); i++) {
+            lane_set(&r, size + 1, i, lane_u(&src, size, 2 * i) + lane_u(&src, size, 2 * i + 1));
+        }
+        break;
+    case 0x05 << 1 | 1:
+        for (i = 0; i < bytes; i++) {
+            r.b[i] = (uint8_t)~src.b[i];
+        }
+        break;
+    case 0x09 << 1:
+    case 0x0A << 1:
+    case 0x0B << 1:
+    case 0x0B << 1 | 1:
+        for (i = 0; i < (bytes >> size); i++) {
+            int64_t s = lane_s(&src, size, i);
+            uint64_t v;
+            if (opc == 0x09) {
+                v = s == 0 ? ones(size) : 0;
+            } else if (opc == 0x0A) {
+                v = s < 0 ? ones(size) : 0;
+            } else if (u) {
+                v = (uint64_t)-s;
+            } else {
+                v = (uint64_t)(s < 0 ? -s : s);
+            }
+            lane_set(&r, size, i, v & ones(size));
+        }
+        break;
+    case 0x12 << 1:
+    case 0x12 << 1 | 1:
+    case 0x14 << 1:
+    case 0x14 << 1 | 1:
+        for (i = 0; i < (8 >> size); i++) {
+            int64_t s = lane_s(&src, size + 1, i);
+            uint64_t uv = lane_u(&src, size + 1, i);
+            if (opc == 0x12 && !u) {
+                x[i] = uv & ones(size);
+            } else if (opc == 0x12) {
+                x[i] = sat_u(s, size);                  /* SQXTUN */
+            } else if (!u) {
+                x[i] = sat_s(s, size);
+            } else {
+                x[i] = sat_u((__int128)uv, size);
+            }
+        }
+        r = *d;
+        narrow_store(&r, q, size, x);
+        break;
+    case 0x16 << 1:
+        if (!sz) {
+            return -1;
+        }
+        for (i = 0; i < 2; i++) {
+            float f = (float)src.df[i];
+            uint32_t bits;
+            memcpy(&bits, &f, 4);
+            x[i] = bits;
+        }
+        r = *d;
+        narrow_store(&r, q, 2, x);
+        break;
+    case 0x17 << 1:
+        if (!sz) {
+            return -1;
+        }
+        for (i = 0; i < 2; i++) {
+            r.df[i] = (double)src.f[(q ? 2 : 0) + i];
+        }
+        break;
+    default:
+        if (opc < 0x18) {
+            return -1;
+        }
+        for (i = 0; i < (bytes >> (2 + sz)); i++) {
+            double a = fp_get(&src, sz, i), v;
+            switch (opc << 2 | u << 1 | hi) {
+            case 0x18 << 2: v = nearbyint(a); break;
+            case 0x19 << 2: v = floor(a); break;
+            case 0x18 << 2 | 1: v = ceil(a); break;
+            case 0x19 << 2 | 1: v = trunc(a); break;
+            case 0x19 << 2 | 3: v = nearbyint(a); break;
+            case 0x1F << 2 | 3: v = fp_op(sz, 4, a, 0); break;
+            case 0x1B << 2 | 1:
+                lane_set(&r, 2 + sz, i, (uint64_t)fcvtzs(a, 2 + sz) & ones(2 + sz));
+                continue;
+            case 0x1D << 2:
+                v = sz ? (double)(int64_t)src.d[i] : (double)(float)(int32_t)src.s[i];
+                break;
+            default:
+                return -1;
+            }
+            fp_set(&r, sz, i, v);
+        }
+        break;
+    }
+    *d = r;
+    return 0;
+}
+
+static int a64_copy(a64_t *c, uint32_t w)
+{
+    int q = (w >> 30) & 1, op = (w >> 29) & 1;
+    int imm5 = (w >> 16) & 31, imm4 = (w >> 11) & 15;
+    int rn = (w >> 5) & 31, rd = w & 31;
+    int size = __builtin_ctz(imm5), idx = imm5 >> (size + 1);
+    vreg_t r;
+    int i;
+
+    if (size > 3) {
+        return -1;
+    }
+    if (op) {
+        r = c->v[rd];
+        lane_set(&r, size, idx, lane_u(&c->v[rn], size, imm4 >> size));
+        c->v[rd] = r;
+    } else if (imm4 == 0) {
+        uint64_t x = lane_u(&c->v[rn], size, idx);
+        memset(&r, 0, sizeof(r));
+        for (i = 0; i < ((q ? 16 : 8) >> size); i++) {
+            lane_set(&r, size, i, x);
+        }
+        c->v[rd] = r;
+    } else if (imm4 == 1) {
+        uint64_t x = rn == 31 ? 0 : c->x[rn];
+        memset(&r, 0, sizeof(r));
+        for (i = 0; i < ((q ? 16 : 8) >> size); i++) {
+            lane_set(&r, size, i, x);
+        }
+        c->v[rd] = r;
+    } else if (imm4 == 3) {
+        lane_set(&c->v[rd], size, idx, rn == 31 ? 0 : c->x[rn]);
+    } else if (imm4 == 7) {
+        if ((size == 3) != q) {
+            return -1;
+        }
+        if (rd != 31) {
+            c->x[rd] = lane_u(&c->v[rn], size, idx);
+        }
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+static int a64_permute(a64_t *c, uint32_t w)
+{
+    int q = (w >> 30) & 1, size = (w >> 22) & 3, opc = (w >> 12) & 7;
+    vreg_t n = c->v[(w >> 5) & 31], m = c->v[(w >> 16) & 31], r;
+    int lanes = (q ? 16 : 8) >> size, half = lanes / 2, i;
+
+    memset(&r, 0, sizeof(r));
+    for (i = 0; i < lanes; i++) {
+        int j = i / 2, odd = i & 1;
+        uint64_t x;
+        switch (opc) {
+        case 1: case 5: {
+            int k = 2 * i + (opc == 5);
+            x = k < lanes ? lane_u(&n, size, k) : lane_u(&m, size, k - lanes);
+            break;
+        }
+        case 2: case 6:
+            x = lane_u(odd ? &m : &n, size, 2 * j + (opc == 6));
+            break;
+        case 3: case 7:
+            x = lane_u(odd ? &m : &n, size, j + (opc == 7 ? half : 0));
+            break;
+        default:
+            return -1;
+        }
+        lane_set(&r, size, i, x);
+    }
+    c->v[w & 31] = r;
+    return 0;
+}
+
+static int a64_mod_imm(a64_t *c, uint32_t w)
+{
+    int q = (w >> 30) & 1, op = (w >> 29) & 1, cmode = (w >> 12) & 15;
+    uint8_t imm8 = (uint8_t)(((w >> 16) & 7) << 5 | ((w >> 5) & 31));
+    uint64_t x;
+    vreg_t r;
+    int i;
+
+    if (cmode == 14 && !op) {
+        x = 0x0101010101010101ull * imm8;
+    } else if (cmode == 14 && op) {
+        x = 0;
+        for (i = 0; i < 8; i++) {
+            if (imm8 & (1 << i)) {
+                x |= 0xFFull << (8 * i);
+            }
+        }
+    } else if (!(cmode & 9) && !op) {
+        x = 0x0000000100000001ull * ((uint64_t)imm8 << (8 * ((cmode >> 1) & 3)));
+    } else {
+        return -1;
+    }
+    r.d[0] = x;
+    r.d[1] = q ? x : 0;
+    c->v[w & 31] = r;
+    return 0;
+}
+
+static int a64_shift_imm(a64_t *c, uint32_t w)
+{
+    int q = (w >> 30) & 1, u = (w >> 29) & 1, opc = (w >> 11) & 31;
+    int immh = (w >> 19) & 15, immhb = (w >> 16) & 127;
+    int size = 31 - __builtin_clz(immh), esize = 8 << size;
+    vreg_t *n = &c->v[(w >> 5) & 31], *d = &c->v[w & 31];
+    vreg_t r, src = *n;
+    uint64_t x[16];
+    int lanes = (q ? 16 : 8) >> size, i;
+
+    memset(&r, 0, sizeof(r));
+    switch (opc << 1 | u) {
+    case 0x00 << 1:
+    case 0x00 << 1 | 1:
+    case 0x02 << 1 | 1:
+        for (i = 0; i < lanes; i++) {
+            uint64_t v = shl_lane(lane_u(&src, size, i), -(2 * esize - immhb), size, !u);
+            if (opc == 0x02) {
+                v = (v + lane_u(d, size, i)) & ones(size);
+            }
+            lane_set(&r, size, i, v);
+        }
+        break;
+    case 0x0A << 1:
+        for (i = 0; i < lanes; i++) {
+            lane_set(&r, size, i, shl_lane(lane_u(&src, size, i), immhb - esize, size, 0));
+        }
+        break;
+    case 0x10 << 1:
+    case 0x11 << 1:
+        for (i = 0; i < (8 >> size); i++) {
+            uint64_t v = lane_u(&src, size + 1, i);
+            int sh = 2 * esize - immhb;
+            if (opc == 0x11) {
+                v += 1ull << (sh - 1);
+            }
+            x[i] = (v >> sh) & ones(size);
+        }
+        r = *d;
+        narrow_store(&r, q, size, x);
+        break;
+    case 0x14 << 1:
+    case 0x14 << 1 | 1:
+        for (i = 0; i < (8 >> size); i++) {
+            uint64_t v = u ? lane_u(&src, size, (q ? 8 >> size : 0) + i)
+                           : (uint64_t)lane_s(&src, size, (q ? 8 >> size : 0) + i);
+            lane_set(&r, size + 1, i, (v << (immhb - esize)) & ones(size + 1));
+        }
+        break;
+    default:
+        return -1;
+    }
+    *d = r;
+    return 0;
+}
+
+static int a64_fp_scalar(a64_t *c, uint32_t w)
+{
+    int type = (w >> 22) & 3, sz = type & 1;
+    int rm = (w >> 16) & 31, rn = (w >> 5) & 31, rd = w & 31;
+    double a = fp_get(&c->v[rn], sz, 0), b = fp_get(&c->v[rm], sz, 0);
+    vreg_t r;
+
+    if (type > 1) {
+        return -1;
+    }
+    memset(&r, 0, sizeof(r));
+    if ((w & 0xFF200C00u) == 0x1E200800u) {
+        static const int ops[4] = { 2, 3, 0, 1 };
+        int opc = (w >> 12) & 15;
+        if (opc > 3) {
+            return -1;
+        }
+        fp_set(&r, sz, 0, fp_op(sz, ops[opc], a, b));
+    } else if ((w & 0xFF207C00u) == 0x1E204000u) {
+        switch ((w >> 15) & 63) {
+        case 0: r.d[0] = sz ? c->v[rn].d[0] : c->v[rn].s[0]; break;
+        case 3: fp_set(&r, sz, 0, fp_op(sz, 4, a, 0)); break;
+        case 4: if (!sz) return -1; r.f[0] = (float)a; break;
+        case 5: if (sz) return -1; r.df[0] = a; break;
+        default: return -1;
+        }
+    } else if ((w & 0xFF20FC1Fu) == 0x1E202000u) {
+        c->nzcv = a64_fcmp_nzcv(a, b);
+        return 0;
+    } else if ((w & 0xFF200C10u) == 0x1E200400u) {
+        c->nzcv = a64_cond_holds(c->nzcv, (w >> 12) & 15) ? a64_fcmp_nzcv(a, b) : (w & 15);
+        return 0;
+    } else {
+        return -1;
+    }
+    c->v[rd] = r;
+    return 0;
+}
+
+static int a64_fp_int(a64_t *c, uint32_t w)
+{
+    int sf = w >> 31, type = (w >> 22) & 3, rmode = (w >> 19) & 3, opc = (w >> 16) & 7;
+    int rn = (w >> 5) & 31, rd = w & 31;
+    uint64_t src = rn == 31 ? 0 : c->x[rn];
+    vreg_t r;
+
+    memset(&r, 0, sizeof(r));
+    if (rmode != 0 || type > 1) {
+        return -1;
+    }
+    if (opc == 2) {
+        if (type) {
+            r.df[0] = sf ? (double)(int64_t)src : (double)(int32_t)src;
+        } else {
+            r.f[0] = sf ? (float)(int64_t)src : (float)(int32_t)src;
+        }
+        c->v[rd] = r;
+    } else if (opc == 6 && sf == type) {
+        if (rd != 31) {
+            c->x[rd] = sf ? c->v[rn].d[0] : c->v[rn].s[0];
+        }
+    } else if (opc == 7 && sf == type) {
+        r.d[0] = sf ? src : (uint32_t)src;
+        c->v[rd] = r;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+/* NEON and scalar FP data processing */
+static int sse_simd(a64_t *c, uint32_t w)
+{
+    if ((w & 0x9F200400u) == 0x0E200400u) {
+        return a64_three_same(c, w);
+    } else if ((w & 0x9F200C00u) == 0x0E200000u) {
+        return a64_three_diff(c, w);
+    } else if ((w & 0x9F3E0C00u) == 0x0E200800u) {
+        return a64_two_misc(c, w);
+    } else if ((w & 0x9FE08400u) == 0x0E000400u || (w & 0xBFE08400u) == 0x2E000400u) {
+        return a64_copy(c, w);
+    } else if ((w & 0xBF208C00u) == 0x0E000800u) {
+        return a64_permute(c, w);
+    } else if ((w & 0xBFE08400u) == 0x2E000000u) {
+        vreg_t r;
+        uint8_t cat[32];
+        memcpy(cat, &c->v[(w >> 5) & 31], 16);
+        memcpy(cat + 16, &c->v[(w >> 16) & 31], 16);
+        memcpy(&r, cat + ((w >> 11) & 15), 16);
+        c->v[w & 31] = r;
+        return (w & NEON_Q_BIT) ? 0 : -1;
+    } else if ((w & 0xBFE09C00u) == 0x0E000000u) {
+        vreg_t r, x = c->v[(w >> 16) & 31];
+        uint8_t t[64];
+        int k, len = (((w >> 13) & 3) + 1) * 16;
+        for (k = 0; k < len / 16; k++) {
+            memcpy(t + 16 * k, &c->v[(((w >> 5) & 31) + k) & 31], 16);
+        }
+        for (k = 0; k < 16; k++) {
+            r.b[k] = x.b[k] < len ? t[x.b[k]] : 0;
+        }
+        c->v[w & 31] = r;
+        return (w & NEON_Q_BIT) ? 0 : -1;
+    } else if ((w & 0x9FF80400u) == 0x0F000400u) {
+        return a64_mod_imm(c, w);
+    } else if ((w & 0x9F800400u) == 0x0F000400u) {
+        return a64_shift_imm(c, w);
+    } else if ((w & 0x7F200000u) == 0x1E200000u && (w & 0xFC00u) == 0) {
+        return a64_fp_int(c, w);
+    } else if ((w & 0xFF200000u) == 0x1E200000u) {
+        return a64_fp_scalar(c, w);
+    }
+    return -1;
+}
+
+/* ============================================================================
+ * Host Execution
+ * ============================================================================ */
+
+typedef struct {
+    vreg_t xmm[3];
+    uint64_t rcx, rdx, rsi, rflags;
+} host_state_t;
+
+#define HOST_INSN_OFF   26
+#define HOST_PAGES      5
+#define HOST_MEM        (3 * 4096)          /* RSI: middle of the data pages */
+
+static uint8_t *host_page;
+
+static const uint8_t host_prologue[HOST_INSN_OFF] = {
+    0xF3, 0x0F, 0x6F, 0x07,                 /* movdqu xmm0, [rdi] */
+    0xF3, 0x0F, 0x6F, 0x4F, 0x10,           /* movdqu xmm1, [rdi + 16] */
+    0xF3, 0x0F, 0x6F, 0x57, 0x20,           /* movdqu xmm2, [rdi + 32] */
+    0x48, 0x8B, 0x4F, 0x30,                 /* mov rcx, [rdi + 48] */
+    0x48, 0x8B, 0x57, 0x38,                 /* mov rdx, [rdi + 56] */
+    0x48, 0x8B, 0x77, 0x40,                 /* mov rsi, [rdi + 64] */
+};
+
+static const uint8_t host_epilogue[] = {
+    0x9C, 0x58,                             /* pushfq; pop rax */
+    0x48, 0x89, 0x47, 0x48,                 /* mov [rdi + 72], rax */
+    0xF3, 0x0F, 0x7F, 0x07,                 /* movdqu [rdi], xmm0 */
+    0xF3, 0x0F, 0x7F, 0x4F, 0x10,
+    0xF3, 0x0F, 0x7F, 0x57, 0x20,
+    0x48, 0x89, 0x4F, 0x30,                 /* mov [rdi + 48], rcx */
+    0x48, 0x89, 0x57, 0x38,                 /* mov [rdi + 56], rdx */
+    0xC3,
+};
+
+static void host_run(const uint8_t *insn, int len, host_state_t *st)
+{
+    memcpy(host_page, host_prologue, HOST_INSN_OFF);
+    memcpy(host_page + HOST_INSN_OFF, insn, (size_t)len);
+    memcpy(host_page + HOST_INSN_OFF + len, host_epilogue, sizeof(host_epilogue));
+    __builtin___clear_cache((char *)host_page, (char *)host_page + 256);
+    ((void (*)(host_state_t *))host_page)(st);
+}
+
+/* ============================================================================
+ * Cases
+ * ============================================================================ */
+
+enum {
+    FORM_REG,               /* xmm1/rcx, xmm2/rdx */
+    FORM_SAME,              /* xmm1, xmm1 */
+    FORM_BASE,              /* [rsi] */
+    FORM_DISP8_ODD,         /* [rsi + 0x13]: unaligned, ADD */
+    FORM_DISP8,             /* [rsi + 0x20]: scaled offset */
+    FORM_DISP8_NEG,         /* [rsi - 0x10]: SUB */
+    FORM_DISP32,            /* [rsi + 0x1000]: scaled offset */
+    FORM_DISP32_NEG,        /* [rsi - 0x1008]: MOV + ADD */
+    FORM_RIP,               /* [rip + disp32] */
+    FORM_SIB,               /* [rsi + rdx*4 + 0x20]: ADD LSL, scaled offset */
+    FORM_SIB_DISP32,        /* [rsi + rdx*8 - 0x1008]: MOV + ADD + ADD LSL */
+    FORM_SIB_NOBASE,        /* [rdx*2 + 0x40]: no base */
+    FORM_COUNT
+};
+
+static const char *const form_names[FORM_COUNT] = {
+    "reg", "same", "[rsi]", "[rsi+0x13]", "[rsi+0x20]", "[rsi-0x10]",
+    "[rsi+0x1000]", "[rsi-0x1008]", "[rip]", "[rsi+rdx*4+0x20]", "[rsi+rdx*8-0x1008]",
+    "[rdx*2+0x40]"
+};
+
+static const int32_t form_disp[FORM_COUNT] = {
+    0, 0, 0, 0x13, 0x20, -0x10, 0x1000, -0x1008, 0x40, 0x20, -0x1008, 0x40
+};
+
+/* ModR/M, SIB and displacement of a form with ModR/M.reg = reg and register rm */
+static int build_modrm(int form, int reg, int rm, uint8_t *out)
+{
+    int n = 0, mod;
+
+    if (form <= FORM_SAME) {
+        out[n++] = (uint8_t)(3 << 6 | reg << 3 | rm);
+        return n;
+    }
+    if (form == FORM_BASE || form == FORM_RIP || form == FORM_SIB_NOBASE) {
+        mod = 0;
+    } else if (form == FORM_DISP32 || form == FORM_DISP32_NEG || form == FORM_SIB_DISP32) {
+        mod = 2;
+    } else {
+        mod = 1;
+    }
+    if (form >= FORM_SIB) {
+        out[n++] = (uint8_t)(mod << 6 | reg << 3 | 4);
+        out[n++] = (uint8_t)((form == FORM_SIB ? 2 : form == FORM_SIB_DISP32 ? 3 : 1) << 6 |
+                             2 << 3 | (form == FORM_SIB_NOBASE ? 5 : 6));
+    } else {
+        out[n++] = (uint8_t)(mod << 6 | reg << 3 | (form == FORM_RIP ? 5 : 6));
+    }
+    if (mod == 1) {
+        out[n++] = (uint8_t)form_disp[form];
+    } else if (mod == 2 || form == FORM_RIP || form == FORM_SIB_NOBASE) {
+        int32_t disp = form_disp[form];
+        memcpy(out + n, &disp, 4);
+        n += 4;
+    }
+    return n;
+}
+
+/* rsi and rdx placing the operand of a memory form at mem + its displacement */
+static void form_regs(int form, uint8_t *mem, uint64_t *rsi, uint64_t *rdx)
+{
+    uint64_t m = (uint64_t)(uintptr_t)mem;
+
+    *rsi = m;
+    if (form == FORM_SIB) {
+        *rdx = 3;
+        *rsi = m - 3 * 4;
+    } else if (form == FORM_SIB_DISP32) {
+        *rdx = 5;
+        *rsi = m - 5 * 8;
+    } else if (form == FORM_SIB_NOBASE) {
+        *rdx = m / 2;
+    }
+}
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15ull;
+
+static uint64_t rnd(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static const float f_edge[] = {
+    0.0f, -0.0f, 1.0f, -1.0f, 1.5f, 2.5f, -2.5f, 0.5f, -0.5f, 3.75f,
+    2147483648.0f, -2147483648.0f, 2147483520.0f, -2147483904.0f, 1e10f, -1e10f,
+    1e-40f, INFINITY, -INFINITY, NAN, -NAN, 65536.5f, 1e20f, 9.2233720e18f, -9.2233720e18f
+};
+
+static const double d_edge[] = {
+    0.0, -0.0, 1.0, -1.0, 1.5, 2.5, -2.5, 0.5, -0.5, 3.75,
+    2147483647.0, 2147483647.5, 2147483648.0, -2147483648.0, -2147483648.5, -2147483649.0,
+    1e10, -1e10, 1e-310, INFINITY, -INFINITY, NAN, -NAN,
+    9223372036854775807.0, -9223372036854775808.0, 4503599627370497.5
+};
+
+static const uint16_t i_edge[] = {
+    0x0000, 0x0001, 0x007F, 0x0080, 0x00FF, 0x7FFF, 0x8000, 0xFFFF, 0xFF80, 0x8080, 0x7F7F, 0x0100
+};
+
+static void fill_vec(vreg_t *v, int mode)
+{
+    int i;
+
+    switch (mode) {
+    case 0:
+        for (i = 0; i < 2; i++) {
+            v->d[i] = rnd();
+        }
+        break;
+    case 1:
+        for (i = 0; i < 4; i++) {
+            v->f[i] = (rnd() & 1) ? f_edge[rnd() % (sizeof(f_edge) / sizeof(f_edge[0]))]
+                                  : (float)((int64_t)(rnd() % 2001) - 1000) / 8.0f;
+        }
+        break;
+    case 2:
+        for (i = 0; i < 2; i++) {
+            v->df[i] = (rnd() & 1) ? d_edge[rnd() % (sizeof(d_edge) / sizeof(d_edge[0]))]
+                                   : (double)((int64_t)(rnd() % 2001) - 1000) / 8.0;
+        }
+        break;
+    case 3:
+        for (i = 0; i < 16; i++) {
+            v->b[i] = (uint8_t)((int)(rnd() % 7) - 3);
+        }
+        break;
+    default:
+        for (i = 0; i < 8; i++) {
+            v->h[i] = i_edge[rnd() % (sizeof(i_edge) / sizeof(i_edge[0]))];
+        }
+        break;
+    }
+}
+
+static uint64_t fill_gpr(int mode)
+{
+    static const uint64_t edge[] = {
+        0, 1, 2, 7, 8, 15, 16, 31, 32, 63, 64, 65, 255, 256, 0x80000000ull,
+        0xFFFFFFFFull, 0x100000000ull, ~0ull, 0x8000000000000000ull, 0x7FFFFFFFFFFFFFFFull
+    };
+
+    if (mode == 0) {
+        return rnd();
+    }
+    return edge[rnd() % (sizeof(edge) / sizeof(edge[0]))];
+}
+
+/* Legacy encoding of e with the given operands; returns the length */
+static int build_insn(const translate_simd_entry_t *e, int form, int rexw, int imm, uint8_t *out)
+{
+    int n = 0, reg = 1, rm = form == FORM_SAME ? 1 : 2;
+
+    if (e->prefix) {
+        out[n++] = e->prefix;
+    }
+    if (rexw) {
+        out[n++] = 0x48;
+    }
+    out[n++] = 0x0F;
+    if (e->map != 0x0F) {
+        out[n++] = e->map;
+    }
+    out[n++] = e->opcode;
+    if (e->ext != SIMD_EXT_NONE) {
+        reg = e->ext;
+    }
+
+    n += build_modrm(form, reg, rm, out + n);
+    if (e->flags & SIMD_F_IMM8) {
+        out[n++] = (uint8_t)imm;
+    }
+    if (form == FORM_RIP) {
+        /* Target rsi + 0x40: disp is relative to the end of the instruction */
+        int32_t disp = (int32_t)((HOST_MEM + 0x40) - (HOST_INSN_OFF + n));
+        memcpy(out + n - ((e->flags & SIMD_F_IMM8) ? 5 : 4), &disp, 4);
+    }
+    return n;
+}
+
+static int lanes_equal(const vreg_t *a, const vreg_t *b, uint32_t flags)
+{
+    int i;
+
+    if (flags & SIMD_F_FP32) {
+        for (i = 0; i < 4; i++) {
+            if (a->s[i] != b->s[i] && !(a->f[i] != a->f[i] && b->f[i] != b->f[i])) {
+                return 0;
+            }
+        }
+        return 1;
+    }
+    if (flags & SIMD_F_FP64) {
+        for (i = 0; i < 2; i++) {
+            if (a->d[i] != b->d[i] && !(a->df[i] != a->df[i] && b->df[i] != b->df[i])) {
+                return 0;
+            }
+        }
+        return 1;
+    }
+    return memcmp(a, b, sizeof(*a)) == 0;
+}
+
+static void print_vec(const char *tag, const vreg_t *v)
+{
+    printf("      %s %016llx_%016llx\n", tag, (unsigned long long)v->d[1], (unsigned long long)v->d[0]);
+}
+
+/* One case; returns 0 on match, 1 on mismatch, -1 if the lowering declined */
+static int run_case(const translate_simd_entry_t *e, int form, int rexw, int imm, int mode, int verbose)
+{
+    uint8_t bytes[16];
+    uint8_t *mem = host_page + HOST_MEM;
+    uint8_t *win = NULL, before[48], after[48];
+    int len = build_insn(e, form, rexw, imm, bytes);
+    x86_insn_t insn;
+    uint32_t words[128];
+    code_buffer_t cb;
+    host_state_t st;
+    a64_t c;
+    size_t bad;
+    int i, ret, ok;
+
+    memset(&insn, 0, sizeof(insn));
+    if (form <= FORM_SAME && (e->flags & SIMD_F_MEM_ONLY)) {
+        return -1;
+    }
+    if (decode_x86_insn(bytes, &insn) != len || translate_simd_lookup(&insn) != e) {
+        if (verbose) {
+            printf("    decode mismatch: len %d vs %d\n", insn.length, len);
+        }
+        return 1;
+    }
+
+    /* Inputs */
+    memset(&st, 0, sizeof(st));
+    for (i = 0; i < 3; i++) {
+        fill_vec(&st.xmm[i], (e->flags & SIMD_F_FP64) && mode ? 2 : (e->flags & SIMD_F_FP32) && mode ? 1 : mode);
+    }
+    st.rcx = fill_gpr(mode & 1);
+    st.rdx = fill_gpr(mode & 1);
+    /* 16-byte operands must be aligned; keep the displacement, move the base */
+    if (!(e->flags & (SIMD_F_M16 | SIMD_F_M32 | SIMD_F_M64)) && form != FORM_RIP) {
+        mem -= form_disp[form] & 15;
+    }
+    form_regs(form, mem, &st.rsi, &st.rdx);
+    if (form > FORM_SAME) {
+        vreg_t m;
+        fill_vec(&m, (e->flags & SIMD_F_FP64) && mode ? 2 : (e->flags & SIMD_F_FP32) && mode ? 1 : mode);
+        memcpy(mem + form_disp[form], &m, 16);
+        /* Stores land in the operand; a window around it catches stray bytes */
+        win = (form == FORM_RIP ? host_page + HOST_MEM + 0x40 : mem + form_disp[form]) - 16;
+        memcpy(before, win, sizeof(before));
+    }
+
+    /* Lowering */
+    memset(&c, 0, sizeof(c));
+    for (i = 0; i < 32; i++) {
+        c.v[i].d[0] = rnd();
+        c.v[i].d[1] = rnd();
+        c.x[i] = rnd();
+    }
+    for (i = 0; i < 3; i++) {
+        c.v[i] = st.xmm[i];
+    }
+    c.x[1] = st.rcx;
+    c.x[2] = st.rdx;
+    c.x[6] = st.rsi;
+    c.x[31] = 0;
+    c.simd = sse_simd;
+    c.nzcv = (uint32_t)rnd() & 15;
+
+    code_buffer_init_arm64(&cb, (uint8_t *)words, sizeof(words));
+    ret = translate_simd_lower(&cb, &insn, insn.reg, insn.rm,
+                               (uint64_t)(uintptr_t)(host_page + HOST_INSN_OFF));
+    if (ret == -ENOTSUP) {
+        return -1;
+    }
+    if (ret != 0 || cb.error) {
+        if (verbose) {
+            printf("    lowering returned %d\n", ret);
+        }
+        return 1;
+    }
+    bad = a64_run(&c, words, cb.offset / 4);
+    if (bad) {
+        if (verbose) {
+            printf("    interpreter: unhandled word %08x\n", words[bad - 1]);
+        }
+        return 1;
+    }
+    if (win) {
+        memcpy(after, win, sizeof(after));
+        memcpy(win, before, sizeof(before));
+    }
+
+    host_run(bytes, len, &st);
+
+    ok = 1;
+    for (i = 0; i < 3; i++) {
+        ok &= lanes_equal(&st.xmm[i], &c.v[i], e->flags);
+    }
+    ok &= st.rcx == c.x[1] && st.rdx == c.x[2];
+    ok &= !win || memcmp(win, after, sizeof(after)) == 0;
+    if (e->flags & SIMD_F_FLAGS) {
+        uint32_t zf = (st.rflags >> 6) & 1, cf = st.rflags & 1, pf = (st.rflags >> 2) & 1;
+        ok &= zf == ((c.nzcv >> 2) & 1) && cf == !((c.nzcv >> 1) & 1) && pf == (c.nzcv & 1);
+    }
+    if (!ok && verbose) {
+        printf("    %s %s imm=%02x rexw=%d:\n", e->name, form_names[form], imm, rexw);
+        for (i = 0; i < 3; i++) {
+            char tag[16];
+            snprintf(tag, sizeof(tag), "x86 xmm%d", i);
+            print_vec(tag, &st.xmm[i]);
+            snprintf(tag, sizeof(tag), "a64   v%d", i);
+            print_vec(tag, &c.v[i]);
+        }
+        printf("      x86 rcx %016llx rdx %016llx flags %03llx\n", (unsigned long long)st.rcx,
+               (unsigned long long)st.rdx, (unsigned long long)(st.rflags & 0x8D5));
+        printf("      a64  x1 %016llx  x2 %016llx nzcv %x\n", (unsigned long long)c.x[1],
+               (unsigned long long)c.x[2], c.nzcv);
+    }
+    return ok ? 0 : 1;
+}
+
+/* ============================================================================
+ * Tests
+ * ============================================================================ */
+
+static void test_table(void)
+{
+    size_t n, i, j;
+    const translate_simd_entry_t *t = translate_simd_table(&n);
+    char msg[128];
+    int ok = 1;
+
+    TEST_START("Table is ordered and unambiguous");
+    for (i = 0; i < n; i++) {
+        for (j = i + 1; j < n; j++) {
+            if (t[i].map == t[j].map && t[i].opcode == t[j].opcode && t[i].prefix == t[j].prefix &&
+                (t[i].ext == t[j].ext || t[i].ext == SIMD_EXT_NONE || t[j].ext == SIMD_EXT_NONE)) {
+                snprintf(msg, sizeof(msg), "%s and %s overlap", t[i].name, t[j].name);
+                ok = 0;
+            }
+        }
+        if (i && (t[i].map < t[i - 1].map ||
+                  (t[i].map == t[i - 1].map && t[i].opcode < t[i - 1].opcode))) {
+            snprintf(msg, sizeof(msg), "%s out of order", t[i].name);
+            ok = 0;
+        }
+    }
+    if (ok) {
+        printf("  %zu entries\n", n);
+        TEST_PASS("Table is ordered and unambiguous");
+    } else {
+        TEST_FAIL("Table is ordered and unambiguous", msg);
+    }
+}
+
+static void test_lookup(void)
+{
+    /* paddd xmm1, xmm2; vpaddd xmm1, xmm1, xmm2; MMX paddd mm1, mm2; add eax, ebx */
+    static const uint8_t sse[] = { 0x66, 0x0F, 0xFE, 0xCA };
+    static const uint8_t vex[] = { 0xC5, 0xF1, 0xFE, 0xCA };
+    static const uint8_t mmx[] = { 0x0F, 0xFE, 0xCA };
+    static const uint8_t alu[] = { 0x01, 0xD8 };
+    /* psrad xmm2, 3 and pslld xmm2, 3: group 72 by ModR/M.reg */
+    static const uint8_t psrad[] = { 0x66, 0x0F, 0x72, 0xE2, 0x03 };
+    static const uint8_t pslld[] = { 0x66, 0x0F, 0x72, 0xF2, 0x03 };
+    /* movdqu xmm1, [rsp + 8]: SIB */
+    static const uint8_t sib[] = { 0xF3, 0x0F, 0x6F, 0x4C, 0x24, 0x08 };
+    x86_insn_t insn;
+    const translate_simd_entry_t *e;
+    uint32_t words[16];
+    code_buffer_t cb;
+    int ok = 1;
+
+    TEST_START("Lookup by prefix, map, opcode and extension");
+    decode_x86_insn(sse, &insn);
+    e = translate_simd_lookup(&insn);
+    ok &= e && strcmp(e->name, "paddd") == 0;
+    decode_x86_insn(vex, &insn);
+    ok &= translate_simd_lookup(&insn) == NULL;
+    decode_x86_insn(mmx, &insn);
+    ok &= translate_simd_lookup(&insn) == NULL;
+    decode_x86_insn(alu, &insn);
+    ok &= translate_simd_lookup(&insn) == NULL;
+    decode_x86_insn(psrad, &insn);
+    e = translate_simd_lookup(&insn);
+    ok &= e && strcmp(e->name, "psrad") == 0 && insn.length == 5 && insn.imm == 3;
+    decode_x86_insn(pslld, &insn);
+    e = translate_simd_lookup(&insn);
+    ok &= e && strcmp(e->name, "pslld") == 0;
+    decode_x86_insn(sib, &insn);
+    code_buffer_init_arm64(&cb, (uint8_t *)words, sizeof(words));
+    ok &= translate_simd_lower(&cb, &insn, insn.reg, insn.rm, 0) == 0 && cb.offset == 2 * 4;   /* ADD, LDR */
+    decode_x86_insn(alu, &insn);
+    ok &= translate_simd_lower(&cb, &insn, insn.reg, insn.rm, 0) == -ENOENT;
+    if (ok) {
+        TEST_PASS("Lookup by prefix, map, opcode and extension");
+    } else {
+        TEST_FAIL("Lookup by prefix, map, opcode and extension", "wrong entry or status");
+    }
+}
+
+static void test_lengths(void)
+{
+    static const struct {
+        uint8_t bytes[8];
+        const char *name;
+        int words;
+    } cases[] = {
+        { { 0x66, 0x0F, 0xFE, 0xCA }, "paddd", 1 },
+        { { 0x66, 0x0F, 0x38, 0x00, 0xCA }, "pshufb", 3 },
+        { { 0x66, 0x0F, 0x3A, 0x0F, 0xCA, 0x05 }, "palignr", 1 },
+        { { 0x66, 0x0F, 0x60, 0xCA }, "punpcklbw", 1 },
+        { { 0x66, 0x0F, 0xF5, 0xCA }, "pmaddwd", 3 },
+        { { 0x66, 0x0F, 0xE4, 0xCA }, "pmulhuw", 3 },
+        { { 0x66, 0x0F, 0x67, 0xCA }, "packuswb", 2 },
+        { { 0x66, 0x0F, 0x38, 0x10, 0xCA }, "pblendvb", 2 },
+        { { 0x66, 0x0F, 0x38, 0x38, 0xCA }, "pminsb", 1 },
+    };
+    size_t i;
+    int ok = 1;
+
+    TEST_START("Common forms lower to short sequences");
+    for (i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        x86_insn_t insn;
+        uint32_t words[64];
+        code_buffer_t cb;
+
+        decode_x86_insn(cases[i].bytes, &insn);
+        code_buffer_init_arm64(&cb, (uint8_t *)words, sizeof(words));
+        if (translate_simd_lower(&cb, &insn, insn.reg, insn.rm, 0) != 0 ||
+            (int)(cb.offset / 4) != cases[i].words) {
+            printf("  %s: %u words, expected %d\n", cases[i].name, cb.offset / 4, cases[i].words);
+            ok = 0;
+        }
+    }
+    if (ok) {
+        TEST_PASS("Common forms lower to short sequences");
+    } else {
+        TEST_FAIL("Common forms lower to short sequences", "sequence length changed");
+    }
+}
+
+/* Every entry against the host, over operand forms, inputs and imm8 values */
+static void test_differential(void)
+{
+    size_t n, i;
+    const translate_simd_entry_t *t = translate_simd_table(&n);
+    int failed_entries = 0, cases = 0;
+    char msg[128];
+
+    TEST_START("Every table entry matches the host");
+    for (i = 0; i < n; i++) {
+        const translate_simd_entry_t *e = &t[i];
+        int iters = (e->flags & SIMD_F_IMM8) ? 512 : 96;
+        int form, it, bad = 0;
+
+        for (form = 0; form < FORM_COUNT && !bad; form++) {
+            int declined = 0;
+
+            for (it = 0; it < iters && !bad; it++) {
+                int rexw = (e->flags & SIMD_F_REXW) ? it & 1 : 0;
+                int imm = (e->flags & SIMD_F_IMM8) ? it & 0xFF : 0;
+                uint64_t seed = rng_state;
+                int ret = run_case(e, form, rexw, imm, it % 5, 0);
+
+                if (ret < 0) {
+                    declined = 1;
+                    break;
+                }
+                cases++;
+                if (ret) {
+                    rng_state = seed;
+                    run_case(e, form, rexw, imm, it % 5, 1);
+                    bad = 1;
+                }
+            }
+            if (declined && form <= FORM_SAME && !(e->flags & SIMD_F_MEM_ONLY)) {
+                printf("    %s declined a register form\n", e->name);
+                bad = 1;
+            }
+            if (declined && form > FORM_SAME && !(e->flags & SIMD_F_REG_ONLY)) {
+                printf("    %s declined %s\n", e->name, form_names[form]);
+                bad = 1;
+            }
+        }
+        if (bad) {
+            failed_entries++;
+        }
+    }
+    printf("  %d cases over %zu entries\n", cases, n);
+    if (failed_entries == 0) {
+        TEST_PASS("Every table entry matches the host");
+    } else {
+        snprintf(msg, sizeof(msg), "%d entries differ", failed_entries);
+        TEST_FAIL("Every table entry matches the host", msg);
+    }
+}
+
+/* ============================================================================
+ * VEX Forms
+ * ============================================================================
+ *
+ * The VEX lowering runs against the host the same way, with YMM0-3 loaded
+ * and stored whole. On the interpreter side X18 points at an execution
+ * context whose ThreadState holds the upper halves; the lowering is
+ * bracketed by translate_avx_begin_block() and translate_avx_flush() as in
+ * a block, so the cache write-back is part of what is compared.
+ * ============================================================================ */
+
+typedef struct {
+    vreg_t ymm[4][2];           /* [n][0] is bits 127:0 */
+    uint64_t rcx, rdx, rsi, rflags;
+} vex_state_t;
+
+#define VEX_INSN_OFF    40
+
+static const uint8_t vex_prologue[VEX_INSN_OFF] = {
+    0xC5, 0xFE, 0x6F, 0x07,                 /* vmovdqu ymm0, [rdi] */
+    0xC5, 0xFE, 0x6F, 0x4F, 0x20,           /* vmovdqu ymm1, [rdi + 32] */
+    0xC5, 0xFE, 0x6F, 0x57, 0x40,
+    0xC5, 0xFE, 0x6F, 0x5F, 0x60,
+    0x48, 0x8B, 0x8F, 0x80, 0x00, 0x00, 0x00,   /* mov rcx, [rdi + 128] */
+    0x48, 0x8B, 0x97, 0x88, 0x00, 0x00, 0x00,   /* mov rdx, [rdi + 136] */
+    0x48, 0x8B, 0xB7, 0x90, 0x00, 0x00, 0x00,   /* mov rsi, [rdi + 144] */
+};
+
+static const uint8_t vex_epilogue[] = {
+    0x9C, 0x58,                             /* pushfq; pop rax */
+    0x48, 0x89, 0x87, 0x98, 0x00, 0x00, 0x00,   /* mov [rdi + 152], rax */
+    0xC5, 0xFE, 0x7F, 0x07,                 /* vmovdqu [rdi], ymm0 */
+    0xC5, 0xFE, 0x7F, 0x4F, 0x20,
+    0xC5, 0xFE, 0x7F, 0x57, 0x40,
+    0xC5, 0xFE, 0x7F, 0x5F, 0x60,
+    0x48, 0x89, 0x8F, 0x80, 0x00, 0x00, 0x00,   /* mov [rdi + 128], rcx */
+    0x48, 0x89, 0x97, 0x88, 0x00, 0x00, 0x00,   /* mov [rdi + 136], rdx */
+    0xC5, 0xF8, 0x77,                       /* vzeroupper */
+    0xC3,
+};
+
+static sigjmp_buf host_jmp;
+
+static void host_sigill(int sig)
+{
+    (void)sig;
+    siglongjmp(host_jmp, 1);
+}
+
+/* Run prologue, code and epilogue on the host; -1 if the host rejects the code */
+static int host_run_code(const uint8_t *pro, size_t pro_len, const uint8_t *code, size_t len,
+                         const uint8_t *epi, size_t epi_len, void *st)
+{
+    memcpy(host_page, pro, pro_len);
+    memcpy(host_page + pro_len, code, len);
+    memcpy(host_page + pro_len + len, epi, epi_len);
+    __builtin___clear_cache((char *)host_page, (char *)host_page + pro_len + len + epi_len);
+    if (sigsetjmp(host_jmp, 1)) {
+        return -1;
+    }
+    ((void (*)(void *))host_page)(st);
+    return 0;
+}
+
+/* An SSE entry in VEX form, or an AVX-only entry */
+typedef struct {
+    uint8_t prefix, map, opcode, ext;
+    uint8_t w;                  /* VEX.W, or AVX_WIG */
+    uint8_t lengths;            /* AVX_L128 | AVX_L256 */
+    uint32_t flags;             /* SIMD_F_* */
+    int modrm;
+    const char *name;
+} vex_op_t;
+
+static int vex_pp(uint8_t prefix)
+{
+    return prefix == 0x66 ? 1 : prefix == 0xF3 ? 2 : prefix == 0xF2 ? 3 : 0;
+}
+
+/* VEX blends name their mask register in imm8[7:4] */
+static int vex_is4(const vex_op_t *op)
+{
+    return op->map == 0x3A && op->opcode >= 0x4A && op->opcode <= 0x4C;
+}
+
+/* Three-byte VEX encoding of op: reg 1, vvvv 3 (or the group's 1), rm 2 */
+static int build_vex(const vex_op_t *op, int l, int form, int w, int imm, uint8_t *out)
+{
+    int n = 0, reg = 1, v = 3, rm = form == FORM_SAME ? 1 : 2;
+
+    if (op->ext != SIMD_EXT_NONE) {
+        reg = op->ext;
+        v = 1;
+    } else if ((op->flags & SIMD_F_NO_VVVV) ||
+               (form > FORM_SAME && op->map == 0x0F && (op->opcode & 0xFE) == 0x10 &&
+                (op->prefix == 0xF3 || op->prefix == 0xF2))) {
+        v = 0;                                          /* Encodes as 1111; VMOVSS/SD [m] need it */
+    }
+    out[n++] = 0xC4;
+    out[n++] = (uint8_t)(0xE0 | (op->map == 0x38 ? 2 : op->map == 0x3A ? 3 : 1));
+    out[n++] = (uint8_t)(w << 7 | (~v & 15) << 3 | l << 2 | vex_pp(op->prefix));
+    out[n++] = op->opcode;
+    if (!op->modrm) {
+        return n;
+    }
+
+    n += build_modrm(form, reg, rm, out + n);
+    if (op->flags & SIMD_F_IMM8) {
+        out[n++] = (uint8_t)imm;
+    }
+    if (form == FORM_RIP) {
+        int32_t disp = (int32_t)((HOST_MEM + 0x40) - (VEX_INSN_OFF + n));
+        memcpy(out + n - ((op->flags & SIMD_F_IMM8) ? 5 : 4), &disp, 4);
+    }
+    return n;
+}
+
+static ThreadState vex_ts;
+
+/* Interpreter registers for a lowering that reaches ThreadState through X18 */
+static void vex_interp_init(a64_t *c, rosetta_exec_context_t *ectx)
+{
+    int i;
+
+    memset(c, 0, sizeof(*c));
+    for (i = 0; i < 32; i++) {
+        c->v[i].d[0] = rnd();
+        c->v[i].d[1] = rnd();
+        c->x[i] = rnd();
+    }
+    for (i = 0; i < 16; i++) {
+        vex_ts.guest.ymm_hi[i].u64[0] = rnd();
+        vex_ts.guest.ymm_hi[i].u64[1] = rnd();
+    }
+    memset(ectx, 0, sizeof(*ectx));
+    ectx->state = &vex_ts;
+    c->x[18] = (uint64_t)(uintptr_t)ectx;
+    c->x[31] = 0;
+    c->simd = sse_simd;
+    c->nzcv = (uint32_t)rnd() & 15;
+}
+
+/* One case; returns 0 on match, 1 on mismatch, -1 if the lowering declined */
+static int run_vex_case(const vex_op_t *op, int l, int form, int w, int imm, int mode, int verbose)
+{
+    uint8_t bytes[16];
+    uint8_t *mem = host_page + HOST_MEM;
+    uint8_t *win = NULL, before[64], after[64];
+    int len = build_vex(op, l, form, w, imm, bytes);
+    int fm = (op->flags & SIMD_F_FP64) && mode ? 2 : (op->flags & SIMD_F_FP32) && mode ? 1 : mode;
+    rosetta_exec_context_t ectx;
+    translate_avx_state_t avx;
+    vec128_t hi_before[16];
+    vreg_t v_before[16];
+    x86_insn_t insn;
+    uint32_t words[256];
+    code_buffer_t cb;
+    vex_state_t st;
+    a64_t c;
+    size_t bad;
+    int i, ret, ok;
+
+    memset(&insn, 0, sizeof(insn));
+    if (form <= FORM_SAME && (op->flags & SIMD_F_MEM_ONLY)) {
+        return -1;
+    }
+    if (decode_x86_insn(bytes, &insn) != len) {
+        if (verbose) {
+            printf("    decode mismatch: len %d vs %d\n", insn.length, len);
+        }
+        return 1;
+    }
+
+    /* Inputs */
+    memset(&st, 0, sizeof(st));
+    for (i = 0; i < 4; i++) {
+        fill_vec(&st.ymm[i][0], fm);
+        fill_vec(&st.ymm[i][1], fm);
+    }
+    st.rcx = fill_gpr(mode & 1);
+    st.rdx = fill_gpr(mode & 1);
+    /* Aligned moves need 32-byte operands; keep the displacement, move the base */
+    if (form != FORM_RIP) {
+        mem -= form_disp[form] & 31;
+    }
+    form_regs(form, mem, &st.rsi, &st.rdx);
+    if (form > FORM_SAME) {
+        uint8_t *target = form == FORM_RIP ? host_page + HOST_MEM + 0x40 : mem + form_disp[form];
+        vreg_t m[2];
+
+        fill_vec(&m[0], fm);
+        fill_vec(&m[1], fm);
+        memcpy(target, m, 32);
+        win = target - 16;
+        memcpy(before, win, sizeof(before));
+    }
+
+    /* Lowering */
+    vex_interp_init(&c, &ectx);
+    for (i = 0; i < 4; i++) {
+        c.v[i] = st.ymm[i][0];
+        memcpy(&vex_ts.guest.ymm_hi[i], &st.ymm[i][1], 16);
+    }
+    c.x[1] = st.rcx;
+    c.x[2] = st.rdx;
+    c.x[6] = st.rsi;
+    memcpy(hi_before, vex_ts.guest.ymm_hi, sizeof(hi_before));
+    memcpy(v_before, c.v, sizeof(v_before));
+
+    code_buffer_init_arm64(&cb, (uint8_t *)words, sizeof(words));
+    translate_avx_begin_block(&avx);
+    ret = translate_avx_lower(&cb, &avx, &insn, (uint64_t)(uintptr_t)(host_page + VEX_INSN_OFF));
+    if (ret == -ENOTSUP && cb.offset == 0) {
+        return -1;
+    }
+    if (ret != 0 || cb.error) {
+        if (verbose) {
+            printf("    lowering returned %d after %u words\n", ret, cb.offset / 4);
+        }
+        return 1;
+    }
+    translate_avx_flush(&cb, &avx);
+    bad = a64_run(&c, words, cb.offset / 4);
+    if (bad) {
+        if (verbose) {
+            printf("    interpreter: unhandled word %08x\n", words[bad - 1]);
+        }
+        return 1;
+    }
+    if (win) {
+        memcpy(after, win, sizeof(after));
+        memcpy(win, before, sizeof(before));
+    }
+
+    if (host_run_code(vex_prologue, VEX_INSN_OFF, bytes, (size_t)len,
+                      vex_epilogue, sizeof(vex_epilogue), &st) < 0) {
+        if (verbose) {
+            printf("    host rejected %s L%d %s\n", op->name, l, form_names[form]);
+        }
+        return 1;
+    }
+
+    ok = 1;
+    for (i = 0; i < 4; i++) {
+        vreg_t hi;
+
+        memcpy(&hi, &vex_ts.guest.ymm_hi[i], 16);
+        ok &= lanes_equal(&st.ymm[i][0], &c.v[i], op->flags);
+        ok &= lanes_equal(&st.ymm[i][1], &hi, op->flags);
+    }
+    /* VZEROUPPER and VZEROALL also clear what the host does not store */
+    if (!op->modrm) {
+        memset(hi_before, 0, sizeof(hi_before));
+        if (l) {
+            memset(v_before, 0, sizeof(v_before));
+        }
+    }
+    for (i = 4; i < 16; i++) {
+        ok &= memcmp(&vex_ts.guest.ymm_hi[i], &hi_before[i], 16) == 0;
+        ok &= memcmp(&c.v[i], &v_before[i], 16) == 0;
+    }
+    ok &= st.rcx == c.x[1] && st.rdx == c.x[2];
+    ok &= !win || memcmp(win, after, sizeof(after)) == 0;
+    if (op->flags & SIMD_F_FLAGS) {
+        uint32_t zf = (st.rflags >> 6) & 1, cf = st.rflags & 1, pf = (st.rflags >> 2) & 1;
+        ok &= zf == ((c.nzcv >> 2) & 1) && cf == !((c.nzcv >> 1) & 1) && pf == (c.nzcv & 1);
+    }
+    if (!ok && verbose) {
+        printf("    %s L%d %s imm=%02x w=%d:\n", op->name, l, form_names[form], imm, w);
+        for (i = 0; i < 4; i++) {
+            char tag[24];
+            vreg_t hi;
+
+            memcpy(&hi, &vex_ts.guest.ymm_hi[i], 16);
+            snprintf(tag, sizeof(tag), "x86 ymm%d.lo", i);
+            print_vec(tag, &st.ymm[i][0]);
+            snprintf(tag, sizeof(tag), "a64    v%d", i);
+            print_vec(tag, &c.v[i]);
+            snprintf(tag, sizeof(tag), "x86 ymm%d.hi", i);
+            print_vec(tag, &st.ymm[i][1]);
+            snprintf(tag, sizeof(tag), "a64 hi[%d]", i);
+            print_vec(tag, &hi);
+        }
+        printf("      x86 rcx %016llx rdx %016llx flags %03llx\n", (unsigned long long)st.rcx,
+               (unsigned long long)st.rdx, (unsigned long long)(st.rflags & 0x8D5));
+        printf("      a64  x1 %016llx  x2 %016llx nzcv %x\n", (unsigned long long)c.x[1],
+               (unsigned long long)c.x[2], c.nzcv);
+    }
+    return ok ? 0 : 1;
+}
+
+/* Every length, W and operand form of one op; returns the number of failing combinations */
+static int vex_check_op(const vex_op_t *op, int *cases)
+{
+    int iters = (op->flags & SIMD_F_IMM8) && !vex_is4(op) ? 256 : 48;
+    int l, w, form, it, bad = 0;
+
+    for (l = 0; l < 2; l++) {
+        if (!(op->lengths & (1 << l))) {
+            continue;
+        }
+        for (w = 0; w < 2; w++) {
+            if (op->w != AVX_WIG ? w != op->w : w && !(op->flags & SIMD_F_REXW)) {
+                continue;
+            }
+            for (form = 0; form < FORM_COUNT && !bad; form++) {
+                int declined = 0;
+
+                if (!op->modrm && form) {
+                    break;
+                }
+                for (it = 0; it < iters && !bad; it++) {
+                    int imm = vex_is4(op) ? (it & 3) << 4 : (op->flags & SIMD_F_IMM8) ? it & 0xFF : 0;
+                    uint64_t seed = rng_state;
+                    int ret = run_vex_case(op, l, form, w, imm, it % 5, 0);
+
+                    if (ret < 0) {
+                        declined = 1;
+                        break;
+                    }
+                    (*cases)++;
+                    if (ret) {
+                        rng_state = seed;
+                        run_vex_case(op, l, form, w, imm, it % 5, 1);
+                        bad = 1;
+                    }
+                }
+                if (declined && form <= FORM_SAME && !(op->flags & SIMD_F_MEM_ONLY)) {
+                    printf("    %s L%d declined a register form\n", op->name, l);
+                    bad = 1;
+                }
+                if (declined && form > FORM_SAME && !(op->flags & SIMD_F_REG_ONLY)) {
+                    printf("    %s L%d declined %s\n", op->name, l, form_names[form]);
+                    bad = 1;
+                }
+            }
+        }
+    }
+    return bad;
+}
+
+static void test_vex_table(void)
+{
+    size_t n, i;
+    const translate_avx_entry_t *t = translate_avx_table(&n);
+    char msg[128];
+    int ok = 1;
+
+    TEST_START("AVX table is ordered");
+    for (i = 1; i < n; i++) {
+        if (t[i].map < t[i - 1].map || (t[i].map == t[i - 1].map && t[i].opcode < t[i - 1].opcode)) {
+            snprintf(msg, sizeof(msg), "%s out of order", t[i].name);
+            ok = 0;
+        }
+    }
+    if (ok) {
+        printf("  %zu entries\n", n);
+        TEST_PASS("AVX table is ordered");
+    } else {
+        TEST_FAIL("AVX table is ordered", msg);
+    }
+}
+
+/* VEX forms of the SSE table, then the AVX-only table, against the host */
+static void test_vex_differential(void)
+{
+    size_t n, i;
+    const translate_simd_entry_t *t = translate_simd_table(&n);
+    const translate_avx_entry_t *a;
+    int failed_entries = 0, cases = 0, ops = 0;
+    char msg[128];
+
+    TEST_START("Every VEX form matches the host");
+    for (i = 0; i < n; i++) {
+        vex_op_t op = {
+            t[i].prefix, t[i].map, t[i].opcode, t[i].ext, AVX_WIG,
+            (uint8_t)(AVX_L128 | ((t[i].flags & (SIMD_F_YMM | SIMD_F_YMM_WIDEN)) ? AVX_L256 : 0)),
+            t[i].flags, 1, t[i].name
+        };
+
+        if (t[i].flags & SIMD_F_XMM0) {
+            continue;                                   /* VEX blends take a fourth operand */
+        }
+        ops++;
+        failed_entries += vex_check_op(&op, &cases);
+    }
+    a = translate_avx_table(&n);
+    for (i = 0; i < n; i++) {
+        vex_op_t op = {
+            a[i].prefix, a[i].map, a[i].opcode, SIMD_EXT_NONE, a[i].w, a[i].lengths,
+            a[i].flags, !(a[i].map == 0x0F && a[i].opcode == 0x77), a[i].name
+        };
+
+        ops++;
+        failed_entries += vex_check_op(&op, &cases);
+    }
+    printf("  %d cases over %d forms\n", cases, ops);
+    if (failed_entries == 0) {
+        TEST_PASS("Every VEX form matches the host");
+    } else {
+        snprintf(msg, sizeof(msg), "%d forms differ", failed_entries);
+        TEST_FAIL("Every VEX form matches the host", msg);
+    }
+}
+
+/* Register-form VEX encoding, any of YMM0-15 */
+static int vex_rr(uint8_t *out, uint8_t prefix, uint8_t map, uint8_t opcode, int w, int l,
+                  int reg, int v, int rm, int imm)
+{
+    int n = 0;
+
+    out[n++] = 0xC4;
+    out[n++] = (uint8_t)((reg < 8) << 7 | 1 << 6 | (rm < 8) << 5 |
+                         (map == 0x38 ? 2 : map == 0x3A ? 3 : 1));
+    out[n++] = (uint8_t)(w << 7 | (~v & 15) << 3 | l << 2 | vex_pp(prefix));
+    out[n++] = opcode;
+    out[n++] = (uint8_t)(0xC0 | (reg & 7) << 3 | (rm & 7));
+    if (imm >= 0) {
+        out[n++] = (uint8_t)imm;
+    }
+    return n;
+}
+
+/*
+ * A block over all sixteen YMM registers: more upper halves than cache
+ * slots, VEX.128 writes and a VZEROUPPER followed by 256-bit reads of the
+ * zeroed halves, then a flush. The host loads and stores YMM0-15 whole.
+ */
+static void test_vex_sequence(void)
+{
+    static vreg_t host_ymm[16][2];
+    uint8_t pro[16 * 8], epi[16 * 8 + 4], code[512];
+    size_t pro_len = 0, epi_len = 0, len = 0, bad;
+    uint32_t words[4096];
+    rosetta_exec_context_t ectx;
+    translate_avx_state_t avx;
+    code_buffer_t cb;
+    a64_t c;
+    int i, k, it, ok = 1;
+    int n_insns = 0;
+    size_t starts[64];
+
+    TEST_START("VEX block spills and zeroes upper halves");
+    for (i = 0; i < 16; i++) {
+        int32_t disp = 32 * i;
+        uint8_t mv[4] = { 0xC5, (uint8_t)(i < 8 ? 0xFE : 0x7E), 0x6F, (uint8_t)(0x87 | (i & 7) << 3) };
+
+        memcpy(pro + pro_len, mv, 4);
+        memcpy(pro + pro_len + 4, &disp, 4);
+        pro_len += 8;
+        mv[2] = 0x7F;
+        memcpy(epi + epi_len, mv, 4);
+        memcpy(epi + epi_len + 4, &disp, 4);
+        epi_len += 8;
+    }
+    memcpy(epi + epi_len, "\xC5\xF8\x77\xC3", 4);      /* vzeroupper; ret */
+    epi_len += 4;
+
+#define SEQ(...) (starts[n_insns++] = len, len += (size_t)vex_rr(code + len, __VA_ARGS__))
+    for (i = 0; i < 16; i++) {
+        SEQ(0x66, 0x0F, 0xFE, 0, 1, i, i, (i + 5) & 15, -1);     /* vpaddd ymm_i, ymm_i, ymm_i+5 */
+    }
+    SEQ(0x66, 0x0F, 0xEF, 0, 0, 3, 4, 5, -1);                   /* vpxor xmm3, xmm4, xmm5 */
+    starts[n_insns++] = len;
+    memcpy(code + len, "\xC4\xE1\x78\x77", 4);                  /* vzeroupper */
+    len += 4;
+    SEQ(0x66, 0x0F, 0xD4, 0, 1, 8, 9, 3, -1);                   /* vpaddq ymm8, ymm9, ymm3 */
+    SEQ(0x66, 0x3A, 0x18, 0, 1, 12, 8, 7, 1);                   /* vinsertf128 ymm12, ymm8, xmm7, 1 */
+    SEQ(0x66, 0x3A, 0x19, 0, 1, 12, 0, 11, 1);                  /* vextractf128 xmm11, ymm12, 1 */
+    SEQ(0x66, 0x3A, 0x46, 0, 1, 13, 12, 0, 0x21);               /* vperm2i128 ymm13, ymm12, ymm0, 0x21 */
+    SEQ(0x66, 0x3A, 0x00, 1, 1, 14, 0, 13, 0x1B);               /* vpermq ymm14, ymm13, 0x1b */
+    SEQ(0x66, 0x38, 0x36, 0, 1, 15, 1, 14, -1);                 /* vpermd ymm15, ymm1, ymm14 */
+    SEQ(0x66, 0x38, 0x18, 0, 1, 6, 0, 15, -1);                  /* vbroadcastss ymm6, xmm15 */
+    SEQ(0xF3, 0x0F, 0x6F, 0, 1, 7, 0, 15, -1);                  /* vmovdqu ymm7, ymm15 */
+    SEQ(0x66, 0x38, 0x47, 0, 1, 2, 7, 1, -1);                   /* vpsllvd ymm2, ymm7, ymm1 */
+    SEQ(0x66, 0x3A, 0x4A, 0, 1, 5, 6, 7, 2 << 4);               /* vblendvps ymm5, ymm6, ymm7, ymm2 */
+    SEQ(0x66, 0x0F, 0x71, 0, 1, 2, 4, 5, 3);                    /* vpsrlw ymm4, ymm5, 3 */
+    SEQ(0x66, 0x0F, 0xF3, 0, 1, 10, 11, 3, -1);                 /* vpsllq ymm10, ymm11, xmm3 */
+    SEQ(0x66, 0x38, 0x30, 0, 1, 9, 0, 4, -1);                   /* vpmovzxbw ymm9, xmm4 */
+    SEQ(0x66, 0x0F, 0xC6, 0, 1, 0, 1, 2, 0x5);                  /* vshufpd ymm0, ymm1, ymm2, 5 */
+    SEQ(0x00, 0x0F, 0x58, 0, 0, 1, 2, 3, -1);                   /* vaddps xmm1, xmm2, xmm3 */
+#undef SEQ
+
+    for (it = 0; it < 64 && ok; it++) {
+        vex_interp_init(&c, &ectx);
+        for (i = 0; i < 16; i++) {
+            fill_vec(&host_ymm[i][0], it % 5);
+            fill_vec(&host_ymm[i][1], it % 5);
+            c.v[i] = host_ymm[i][0];
+            memcpy(&vex_ts.guest.ymm_hi[i], &host_ymm[i][1], 16);
+        }
+
+        code_buffer_init_arm64(&cb, (uint8_t *)words, sizeof(words));
+        translate_avx_begin_block(&avx);
+        for (k = 0; k < n_insns && ok; k++) {
+            x86_insn_t insn;
+
+            decode_x86_insn(code + starts[k], &insn);
+            if (translate_avx_lower(&cb, &avx, &insn, 0) != 0) {
+                printf("    instruction %d not lowered\n", k);
+                ok = 0;
+            }
+        }
+        translate_avx_flush(&cb, &avx);
+        if (!ok) {
+            break;
+        }
+        bad = a64_run(&c, words, cb.offset / 4);
+        if (bad) {
+            printf("    interpreter: unhandled word %08x\n", words[bad - 1]);
+            ok = 0;
+            break;
+        }
+        if (host_run_code(pro, pro_len, code, len, epi, epi_len, host_ymm) < 0) {
+            printf("    host rejected the block\n");
+            ok = 0;
+            break;
+        }
+        for (i = 0; i < 16; i++) {
+            if (memcmp(&host_ymm[i][0], &c.v[i], 16) != 0 ||
+                memcmp(&host_ymm[i][1], &vex_ts.guest.ymm_hi[i], 16) != 0) {
+                printf("    ymm%d differs\n", i);
+                print_vec("x86 lo", &host_ymm[i][0]);
+                print_vec("a64 lo", &c.v[i]);
+                print_vec("x86 hi", &host_ymm[i][1]);
+                print_vec("a64 hi", (const vreg_t *)&vex_ts.guest.ymm_hi[i]);
+                ok = 0;
+            }
+        }
+    }
+    if (ok) {
+        printf("  %d instructions, %u words\n", n_insns, cb.offset / 4);
+        TEST_PASS("VEX block spills and zeroes upper halves");
+    } else {
+        TEST_FAIL("VEX block spills and zeroes upper halves", "register file differs");
+    }
+}
+
+static void test_vex_status(void)
+{
+    /* vfmadd231ps xmm1, xmm2, xmm3 (FMA3); paddd xmm1, xmm2; vmovdqu ymm1, [rsp + 8] (SIB) */
+    static const uint8_t fma[] = { 0xC4, 0xE2, 0x69, 0xB8, 0xCB };
+    static const uint8_t sse[] = { 0x66, 0x0F, 0xFE, 0xCA };
+    static const uint8_t sib[] = { 0xC5, 0xFE, 0x6F, 0x4C, 0x24, 0x08 };
+    static const uint8_t vzu[] = { 0xC5, 0xF8, 0x77 };
+    translate_avx_state_t avx;
+    x86_insn_t insn;
+    uint32_t words[64];
+    code_buffer_t cb;
+    int ok = 1;
+
+    TEST_START("VEX lowering status and VZEROUPPER cost");
+    code_buffer_init_arm64(&cb, (uint8_t *)words, sizeof(words));
+    translate_avx_begin_block(&avx);
+    decode_x86_insn(fma, &insn);
+    ok &= translate_avx_lower(&cb, &avx, &insn, 0) == -ENOENT;
+    decode_x86_insn(sse, &insn);
+    ok &= translate_avx_lower(&cb, &avx, &insn, 0) == -ENOENT;
+    ok &= cb.offset == 0;
+    decode_x86_insn(sib, &insn);
+    ok &= translate_avx_lower(&cb, &avx, &insn, 0) == 0 && cb.offset > 0;
+
+    /* VZEROUPPER emits nothing; the flush is one MOVI, the X17 load and 16 stores */
+    code_buffer_init_arm64(&cb, (uint8_t *)words, sizeof(words));
+    translate_avx_begin_block(&avx);
+    decode_x86_insn(vzu, &insn);
+    ok &= translate_avx_lower(&cb, &avx, &insn, 0) == 0 && cb.offset == 0;
+    translate_avx_flush(&cb, &avx);
+    ok &= cb.offset == 18 * 4;
+    if (ok) {
+        TEST_PASS("VEX lowering status and VZEROUPPER cost");
+    } else {
+        TEST_FAIL("VEX lowering status and VZEROUPPER cost", "wrong status or length");
+    }
+}
+
+int main(void)
+{
+    printf("=================================================\n");
+    printf("SSE to NEON Lowering Differential Test\n");
+    printf("=================================================\n");
+
+    struct sigaction sa;
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = host_sigill;
+    sa.sa_flags = SA_NODEFER;
+    sigaction(SIGILL, &sa, NULL);
+
+    host_page = mmap(NULL, HOST_PAGES * 4096, PROT_READ | PROT_WRITE | PROT_EXEC,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (host_page == MAP_FAILED) {
+        printf("mmap failed\n");
+        return 1;
+    }
+
+    test_table();
+    test_lookup();
+    test_lengths();
+    test_differential();
+    test_vex_table();
+    test_vex_status();
+    test_vex_differential();
+    test_vex_sequence();
+
+    munmap(host_page, HOST_PAGES * 4096);
+
+    printf("\n=================================================\n");
+    printf("Results: %d passed, %d failed\n", tests_passed, tests_failed);
+    printf("=================================================\n");
+
+    return tests_failed > 0 ? 1 : 0;
+}
+
+#else /* !__x86_64__ */
+
+int main(void)
+{
+    printf("SSE to NEON differential test needs an x86_64 host, skipping\n");
+    return 0;
+}
+
+#endif /* __x86_64__ */
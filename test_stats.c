@@ -0,0 +1,358 @@
+/*=============================================================================
+ * Sharded Statistics Test
+ *=============================================================================
+ *
+ * Records counters from several threads at once and checks that the
+ * aggregated totals are exact, that each thread gets its own cache line
+ * aligned shard, that shards of exited threads are reused, that reset
+ * and the JSON export see every thread, and that the block table and
+ * histograms survive concurrent translation.
+ *
+ * Build: gcc -std=gnu11 -pthread -o test_stats test_stats.c \
+ *            rosetta_refactored_stats.c
+ *
+ * Add -DROSETTA_STATS_DISABLED to check the compiled-out build instead.
+ *
+ *=============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "rosetta_refactored_stats.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST_START(name) \
+    printf("\n--- Test: %s ---\n", name)
+
+#define TEST_PASS(name) \
+    do { \
+        tests_passed++; \
+        printf("✅ PASS: %s\n", name); \
+    } while(0)
+
+#define TEST_FAIL(name, reason) \
+    do { \
+        tests_failed++; \
+        printf("❌ FAIL: %s - %s\n", name, reason); \
+    } while(0)
+
+#define NUM_THREADS     8
+#define ITERATIONS      200000
+
+#ifndef ROSETTA_STATS_DISABLED
+
+static rosetta_stats_shard_t *thread_shard[NUM_THREADS];
+
+static void *record_worker(void *arg)
+{
+    int id = (int)(intptr_t)arg;
+
+    for (int i = 0; i < ITERATIONS; i++) {
+        rosetta_stats_record_alu(ROS_STAT_INSNS_ALU_ADD);
+        rosetta_stats_record_mem(ROS_STAT_INSNS_MEM_LDR);
+        rosetta_stats_record_branch(ROS_STAT_INSNS_BRANCH);
+        if (i & 1) {
+            rosetta_stats_record_cache_hit();
+        } else {
+            rosetta_stats_record_cache_miss();
+        }
+    }
+    rosetta_stats_record_error(ROS_STAT_ERRORS_MEMORY);
+    rosetta_stats_record_local_insn(ROS_STAT_INSNS_SYSTEM);
+
+    thread_shard[id] = rosetta_stats_tls_shard;
+    return NULL;
+}
+
+static void *block_worker(void *arg)
+{
+    uint64_t base = (uint64_t)(intptr_t)arg << 32;
+
+    for (int i = 0; i < 64; i++) {
+        rosetta_stats_record_block(base + (uint64_t)i * 4, 0x1000 + i, 16, 40, 4);
+    }
+    return NULL;
+}
+
+static int run_threads(void *(*fn)(void *))
+{
+    pthread_t threads[NUM_THREADS];
+
+    for (int i = 0; i < NUM_THREADS; i++) {
+        if (pthread_create(&threads[i], NULL, fn, (void *)(intptr_t)i) != 0) {
+            return -1;
+        }
+    }
+    for (int i = 0; i < NUM_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    return 0;
+}
+
+/* ============================================================================
+ * Tests
+ * ============================================================================ */
+
+static void test_concurrent_totals(void)
+{
+    const char *name = "Exact totals across threads";
+    const uint64_t n = (uint64_t)NUM_THREADS * ITERATIONS;
+    rosetta_stats_t st;
+
+    TEST_START(name);
+    rosetta_stats_init();
+
+    if (run_threads(record_worker) != 0) {
+        TEST_FAIL(name, "pthread_create failed");
+        return;
+    }
+
+    rosetta_stats_get(&st);
+    printf("  insns=%llu alu=%llu add=%llu mem=%llu branch=%llu hits=%llu\n",
+           (unsigned long long)st.insns_total, (unsigned long long)st.insns_alu,
+           (unsigned long long)st.insns_alu_add, (unsigned long long)st.insns_mem,
+           (unsigned long long)st.insns_branch, (unsigned long long)st.cache_hits);
+
+    if (st.insns_total != 3 * n || st.insns_alu != n || st.insns_alu_add != n ||
+        st.insns_mem != n || st.insns_mem_ldr != n || st.insns_branch != n ||
+        st.insns_branch_b != 0) {
+        TEST_FAIL(name, "instruction counters lost updates");
+        return;
+    }
+    if (st.cache_lookups != n || st.cache_hits != n / 2 || st.cache_misses != n / 2) {
+        TEST_FAIL(name, "cache counters lost updates");
+        return;
+    }
+    if (st.errors_memory != NUM_THREADS || st.errors_translation != 0) {
+        TEST_FAIL(name, "error counters wrong");
+        return;
+    }
+    TEST_PASS(name);
+}
+
+static void test_shards_separate(void)
+{
+    const char *name = "One aligned shard per thread";
+
+    TEST_START(name);
+
+    for (int i = 0; i < NUM_THREADS; i++) {
+        if (!thread_shard[i] || ((uintptr_t)thread_shard[i] & 63) != 0) {
+            TEST_FAIL(name, "shard missing or not cache line aligned");
+            return;
+        }
+        for (int j = 0; j < i; j++) {
+            if (thread_shard[i] == thread_shard[j]) {
+                TEST_FAIL(name, "threads share a shard");
+                return;
+            }
+        }
+        if (thread_shard[i]->counters[ROS_STAT_INSNS_ALU_ADD] != ITERATIONS) {
+            TEST_FAIL(name, "shard holds another thread's counts");
+            return;
+        }
+    }
+    TEST_PASS(name);
+}
+
+static void test_shards_recycled(void)
+{
+    const char *name = "Shards of exited threads are reused";
+    rosetta_stats_shard_t *first[NUM_THREADS];
+    rosetta_stats_t st;
+
+    TEST_START(name);
+    memcpy(first, thread_shard, sizeof(first));
+
+    if (run_threads(record_worker) != 0) {
+        TEST_FAIL(name, "pthread_create failed");
+        return;
+    }
+
+    for (int i = 0; i < NUM_THREADS; i++) {
+        int found = 0;
+
+        for (int j = 0; j < NUM_THREADS; j++) {
+            found |= thread_shard[i] == first[j];
+        }
+        if (!found) {
+            TEST_FAIL(name, "new thread allocated a fresh shard");
+            return;
+        }
+        for (int j = 0; j < i; j++) {
+            if (thread_shard[i] == thread_shard[j]) {
+                TEST_FAIL(name, "live threads share a shard");
+                return;
+            }
+        }
+    }
+
+    /* Reused shards keep the exited threads' counts */
+    rosetta_stats_get(&st);
+    if (st.insns_alu_add != 2ull * NUM_THREADS * ITERATIONS ||
+        st.errors_memory != 2 * NUM_THREADS) {
+        TEST_FAIL(name, "counts lost on reuse");
+        return;
+    }
+    TEST_PASS(name);
+}
+
+static void test_export_and_reset(void)
+{
+    const char *name = "JSON export and reset";
+    char json[1024];
+    char expect[64];
+    rosetta_stats_t st;
+    uint64_t total, alu, sys;
+
+    TEST_START(name);
+
+    rosetta_stats_export_json(json, sizeof(json));
+    snprintf(expect, sizeof(expect), "\"insns_alu\":%llu,",
+             2ull * NUM_THREADS * ITERATIONS);
+    if (!strstr(json, expect) || !strstr(json, "\"cache_hit_rate\":50.00")) {
+        printf("  %s\n", json);
+        TEST_FAIL(name, "export does not aggregate shards");
+        return;
+    }
+
+    rosetta_stats_get_local(NULL, NULL, NULL, &total, &alu, NULL, NULL, &sys);
+    if (total != 2 * NUM_THREADS || sys != 2 * NUM_THREADS || alu != 0) {
+        TEST_FAIL(name, "local counters wrong");
+        return;
+    }
+
+    rosetta_stats_reset();
+    rosetta_stats_record_insn(ROS_STAT_INSNS_MOV);
+    rosetta_stats_get(&st);
+    if (st.insns_total != 1 || st.insns_mov != 1 || st.insns_alu != 0 ||
+        st.cache_lookups != 0) {
+        TEST_FAIL(name, "reset did not cover all shards");
+        return;
+    }
+
+    rosetta_stats_reset_local();
+    rosetta_stats_get_local(NULL, NULL, NULL, &total, NULL, NULL, NULL, NULL);
+    if (total != 0) {
+        TEST_FAIL(name, "local reset failed");
+        return;
+    }
+    TEST_PASS(name);
+}
+
+static void test_blocks(void)
+{
+    const char *name = "Concurrent block table";
+    uint32_t hist[ROS_STATS_HIST_BUCKETS];
+    rosetta_block_stats_t bs;
+    rosetta_stats_t st;
+
+    TEST_START(name);
+    rosetta_stats_reset();
+
+    if (run_threads(block_worker) != 0) {
+        TEST_FAIL(name, "pthread_create failed");
+        return;
+    }
+
+    rosetta_stats_get(&st);
+    rosetta_stats_get_block_size_histogram(hist, ROS_STATS_HIST_BUCKETS);
+
+    if (st.blocks_translated != NUM_THREADS * 64 ||
+        st.code_size_x86 != NUM_THREADS * 64 * 40 ||
+        st.code_size_peak != st.code_size_total ||
+        rosetta_stats_get_block_count() != NUM_THREADS * 64 ||
+        hist[3] != NUM_THREADS * 64) {
+        TEST_FAIL(name, "block counters wrong");
+        return;
+    }
+    if (rosetta_stats_get_block(NUM_THREADS * 64 - 1, &bs) != 0 ||
+        bs.flags != (ROS_BLOCK_VALID | ROS_BLOCK_CACHED) || bs.x86_size != 40) {
+        TEST_FAIL(name, "block entry not recorded");
+        return;
+    }
+    if (rosetta_stats_get_expansion_ratio() != 2.5) {
+        TEST_FAIL(name, "expansion ratio wrong");
+        return;
+    }
+    TEST_PASS(name);
+}
+
+#else /* ROSETTA_STATS_DISABLED */
+
+static void *record_worker(void *arg)
+{
+    (void)arg;
+    for (int i = 0; i < ITERATIONS; i++) {
+        rosetta_stats_record_alu(ROS_STAT_INSNS_ALU_ADD);
+        rosetta_stats_record_cache_hit();
+        rosetta_stats_record_local_insn(ROS_STAT_INSNS_ALU);
+    }
+    rosetta_stats_record_block(0x1000, 0x2000, 16, 40, 4);
+    return NULL;
+}
+
+static void test_compiled_out(void)
+{
+    const char *name = "Recording compiled out";
+    char json[1024];
+    rosetta_stats_t st;
+    rosetta_stats_t zero;
+    pthread_t thread;
+    uint64_t total;
+
+    TEST_START(name);
+    rosetta_stats_init();
+
+    if (pthread_create(&thread, NULL, record_worker, NULL) != 0) {
+        TEST_FAIL(name, "pthread_create failed");
+        return;
+    }
+    pthread_join(thread, NULL);
+    record_worker(NULL);
+
+    memset(&zero, 0, sizeof(zero));
+    rosetta_stats_get(&st);
+    rosetta_stats_get_local(NULL, NULL, NULL, &total, NULL, NULL, NULL, NULL);
+    if (memcmp(&st, &zero, sizeof(st)) != 0 || total != 0 ||
+        rosetta_stats_get_block_count() != 0) {
+        TEST_FAIL(name, "counters moved");
+        return;
+    }
+    if (rosetta_stats_export_json(json, sizeof(json)) <= 0 ||
+        !strstr(json, "\"insns_alu\":0,")) {
+        printf("  %s\n", json);
+        TEST_FAIL(name, "export does not report zeros");
+        return;
+    }
+    TEST_PASS(name);
+}
+
+#endif /* ROSETTA_STATS_DISABLED */
+
+int main(void)
+{
+    printf("=================================================\n");
+    printf("Sharded Statistics Test\n");
+    printf("=================================================\n");
+
+#ifndef ROSETTA_STATS_DISABLED
+    test_concurrent_totals();
+    test_shards_separate();
+    test_shards_recycled();
+    test_export_and_reset();
+    test_blocks();
+#else
+    test_compiled_out();
+#endif
+
+    printf("\n=================================================\n");
+    printf("Results: %d passed, %d failed\n", tests_passed, tests_failed);
+    printf("=================================================\n");
+
+    return tests_failed > 0 ? 1 : 0;
+}
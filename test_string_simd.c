@@ -0,0 +1,311 @@
+/*=============================================================================
+ * SIMD String Kernel Test
+ *=============================================================================
+ *
+ * Runs every string kernel the host supports against libc over all lengths
+ * up to 300, every source alignment within a vector, and strings that end
+ * right before a PROT_NONE page, so any over-read past the terminator faults.
+ *
+ * Build: gcc -std=gnu11 -o test_string_simd test_string_simd.c \
+ *            rosetta_string_simd.c rosetta_string_simd_x86.c \
+ *            rosetta_string_simd_neon.c
+ *
+ *=============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include "rosetta_string_simd.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST_START(name) \
+    printf("\n--- Test: %s ---\n", name)
+
+#define TEST_PASS(name) \
+    do { \
+        tests_passed++; \
+        printf("✅ PASS: %s\n", name); \
+    } while(0)
+
+#define TEST_FAIL(name, reason) \
+    do { \
+        tests_failed++; \
+        printf("❌ FAIL: %s - %s\n", name, reason); \
+    } while(0)
+
+#define MAX_LEN     300
+#define MAX_ALIGN   32
+#define BUF_SIZE    (MAX_LEN + MAX_ALIGN + 64)
+
+static uint8_t buf_a[BUF_SIZE];
+static uint8_t buf_b[BUF_SIZE];
+static uint8_t buf_c[BUF_SIZE];
+
+static int sign(int v)
+{
+    return (v > 0) - (v < 0);
+}
+
+static void fill_pattern(uint8_t *buf, size_t n, unsigned seed)
+{
+    for (size_t i = 0; i < n; i++) {
+        seed = seed * 1103515245u + 12345u;
+        buf[i] = (uint8_t)(((seed >> 16) % 254) + 1);   /* Never NUL */
+    }
+}
+
+/* ============================================================================
+ * Tests (run once per implementation)
+ * ============================================================================ */
+
+static int check_strlen_strcmp(char *why, size_t why_len)
+{
+    for (size_t align = 0; align < MAX_ALIGN; align++)
+    for (size_t len = 0; len <= MAX_LEN; len++) {
+        char *s = (char *)buf_a + align;
+        char *t = (char *)buf_b + (align * 7) % MAX_ALIGN;
+
+        fill_pattern((uint8_t *)s, len, (unsigned)len);
+        s[len] = '\0';
+        memcpy(t, s, len + 1);
+
+        if (rosetta_strlen_simd(s) != len) {
+            snprintf(why, why_len, "strlen len=%zu align=%zu", len, align);
+            return -1;
+        }
+        if (rosetta_strcmp_simd(s, t) != 0) {
+            snprintf(why, why_len, "strcmp equal len=%zu align=%zu", len, align);
+            return -1;
+        }
+        if (len > 0) {
+            size_t at = (len * 5) / 7;
+            t[at] = (char)(t[at] == (char)0xFF ? 0x01 : t[at] + 1);
+            if (sign(rosetta_strcmp_simd(s, t)) != sign(strcmp(s, t))) {
+                snprintf(why, why_len, "strcmp diff len=%zu at=%zu", len, at);
+                return -1;
+            }
+            t[at] = '\0';
+            if (sign(rosetta_strcmp_simd(s, t)) != sign(strcmp(s, t))) {
+                snprintf(why, why_len, "strcmp prefix len=%zu at=%zu", len, at);
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+static int check_memchr_memcmp(char *why, size_t why_len)
+{
+    for (size_t align = 0; align < MAX_ALIGN; align++)
+    for (size_t len = 0; len <= MAX_LEN; len++) {
+        uint8_t *a = buf_a + align;
+        uint8_t *b = buf_b + (align * 3) % MAX_ALIGN;
+
+        fill_pattern(a, len + 16, (unsigned)(len + align));
+        memcpy(b, a, len);
+
+        /* Needle absent from the range but present just past it */
+        a[len] = 0;
+        if (rosetta_memchr_simd(a, 0, len) != NULL) {
+            snprintf(why, why_len, "memchr absent len=%zu align=%zu", len, align);
+            return -1;
+        }
+        for (size_t at = 0; at < len; at += 1 + at / 4) {
+            uint8_t saved = a[at];
+            a[at] = 0;
+            if (rosetta_memchr_simd(a, 0, len) != a + at) {
+                snprintf(why, why_len, "memchr len=%zu at=%zu", len, at);
+                return -1;
+            }
+            a[at] = saved;
+        }
+
+        b[len] = (uint8_t)(a[len] + 1);
+        if (rosetta_memcmp_simd(a, b, len) != 0) {
+            snprintf(why, why_len, "memcmp equal len=%zu align=%zu", len, align);
+            return -1;
+        }
+        for (size_t at = 0; at < len; at += 1 + at / 4) {
+            uint8_t saved = b[at];
+            b[at] = (uint8_t)(saved ^ 0x80);
+            if (sign(rosetta_memcmp_simd(a, b, len)) != sign(memcmp(a, b, len))) {
+                snprintf(why, why_len, "memcmp len=%zu at=%zu", len, at);
+                return -1;
+            }
+            b[at] = saved;
+        }
+    }
+    return 0;
+}
+
+static int check_memcpy_memset(char *why, size_t why_len)
+{
+    for (size_t align = 0; align < MAX_ALIGN; align++)
+    for (size_t len = 0; len <= MAX_LEN; len++) {
+        size_t doff = (align * 5 + 3) % MAX_ALIGN;
+
+        fill_pattern(buf_a, BUF_SIZE, (unsigned)len);
+        fill_pattern(buf_b, BUF_SIZE, (unsigned)(len + 1));
+        memcpy(buf_c, buf_b, BUF_SIZE);
+        memcpy(buf_c + doff, buf_a + align, len);
+
+        rosetta_memcpy_simd(buf_b + doff, buf_a + align, len);
+        if (memcmp(buf_b, buf_c, BUF_SIZE) != 0) {
+            snprintf(why, why_len, "memcpy len=%zu align=%zu", len, align);
+            return -1;
+        }
+
+        memset(buf_c + doff, 0xA5, len);
+        rosetta_memset_simd(buf_b + doff, 0xA5, len);
+        if (memcmp(buf_b, buf_c, BUF_SIZE) != 0) {
+            snprintf(why, why_len, "memset len=%zu align=%zu", len, align);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int check_memmove(char *why, size_t why_len)
+{
+    static const int shifts[] = { -70, -33, -16, -5, -1, 1, 5, 16, 33, 70 };
+
+    for (size_t si = 0; si < sizeof(shifts) / sizeof(shifts[0]); si++)
+    for (size_t len = 0; len <= MAX_LEN - 70; len++) {
+        uint8_t *src = buf_a + 80;
+        uint8_t *dst = src + shifts[si];
+
+        fill_pattern(buf_a, BUF_SIZE, (unsigned)(len * 11 + si));
+        memcpy(buf_c, buf_a, BUF_SIZE);
+        memmove(buf_c + (dst - buf_a), buf_c + 80, len);
+
+        rosetta_memmove_simd(dst, src, len);
+        if (memcmp(buf_a, buf_c, BUF_SIZE) != 0) {
+            snprintf(why, why_len, "memmove len=%zu shift=%d", len, shifts[si]);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* Terminators and range ends placed on the last bytes before a guard page */
+static int check_page_boundary(uint8_t *page, size_t page_size, char *why, size_t why_len)
+{
+    uint8_t *end = page + page_size;
+
+    for (size_t len = 0; len <= MAX_LEN; len++) {
+        char *s = (char *)end - len - 1;
+        char *t = (char *)buf_a;
+
+        fill_pattern((uint8_t *)s, len, (unsigned)len);
+        s[len] = '\0';
+        memcpy(t, s, len + 1);
+
+        if (rosetta_strlen_simd(s) != len ||
+            rosetta_strcmp_simd(s, t) != 0 || rosetta_strcmp_simd(t, s) != 0) {
+            snprintf(why, why_len, "string ending at page edge len=%zu", len);
+            return -1;
+        }
+
+        uint8_t *r = end - len;
+        fill_pattern(r, len, (unsigned)len + 1);
+        memcpy(buf_b, r, len);
+        if (rosetta_memchr_simd(r, 0, len) != NULL ||
+            rosetta_memcmp_simd(r, buf_b, len) != 0) {
+            snprintf(why, why_len, "range ending at page edge len=%zu", len);
+            return -1;
+        }
+        if (len > 0) {
+            buf_b[len - 1] ^= 0x80;
+            if (sign(rosetta_memcmp_simd(r, buf_b, len)) != sign(memcmp(r, buf_b, len))) {
+                snprintf(why, why_len, "last byte at page edge len=%zu", len);
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+/* ============================================================================
+ * Driver
+ * ============================================================================ */
+
+static void test_impl(rosetta_string_impl_t impl, uint8_t *page, size_t page_size)
+{
+    char name[96];
+    char why[128];
+
+    snprintf(name, sizeof(name), "%s kernels match libc", rosetta_string_simd_name(impl));
+    TEST_START(name);
+
+    if (rosetta_string_simd_select(impl) != 0 || rosetta_string_simd_active() != impl) {
+        TEST_FAIL(name, "select failed for a supported implementation");
+        return;
+    }
+    if (check_strlen_strcmp(why, sizeof(why)) != 0 ||
+        check_memchr_memcmp(why, sizeof(why)) != 0 ||
+        check_memcpy_memset(why, sizeof(why)) != 0 ||
+        check_memmove(why, sizeof(why)) != 0 ||
+        check_page_boundary(page, page_size, why, sizeof(why)) != 0) {
+        TEST_FAIL(name, why);
+        return;
+    }
+    TEST_PASS(name);
+}
+
+static void test_dispatch(void)
+{
+    const char *name = "dispatch picks a supported implementation";
+
+    TEST_START(name);
+    rosetta_string_simd_init();
+    if (!rosetta_string_simd_supported(rosetta_string_simd_active()) ||
+        !rosetta_string_simd_supported(ROS_STRING_SCALAR)) {
+        TEST_FAIL(name, "active or scalar implementation reported unsupported");
+        return;
+    }
+    for (int i = 0; i < ROS_STRING_IMPL_COUNT; i++) {
+        if (!rosetta_string_simd_supported((rosetta_string_impl_t)i) &&
+            rosetta_string_simd_select((rosetta_string_impl_t)i) == 0) {
+            TEST_FAIL(name, "selected an unsupported implementation");
+            return;
+        }
+    }
+    printf("  active: %s\n", rosetta_string_simd_name(rosetta_string_simd_active()));
+    TEST_PASS(name);
+}
+
+int main(void)
+{
+    size_t page_size = 4096;
+    uint8_t *map;
+
+    printf("=================================================\n");
+    printf("SIMD String Kernel Test\n");
+    printf("=================================================\n");
+
+    map = mmap(NULL, page_size * 2, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (map == MAP_FAILED || mprotect(map + page_size, page_size, PROT_NONE) != 0) {
+        perror("mmap");
+        return 1;
+    }
+
+    test_dispatch();
+    for (int i = 0; i < ROS_STRING_IMPL_COUNT; i++) {
+        if (rosetta_string_simd_supported((rosetta_string_impl_t)i)) {
+            test_impl((rosetta_string_impl_t)i, map, page_size);
+        }
+    }
+
+    munmap(map, page_size * 2);
+
+    printf("\n=================================================\n");
+    printf("Results: %d passed, %d failed\n", tests_passed, tests_failed);
+    printf("=================================================\n");
+
+    return tests_failed > 0 ? 1 : 0;
+}
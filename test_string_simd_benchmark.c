@@ -0,0 +1,151 @@
+/* ============================================================================
+ * Rosetta 2 SIMD String Kernel Benchmark
+ * ============================================================================
+ *
+ * Measures throughput of each string kernel for every implementation the
+ * host supports, from single bytes to 1 MiB, alongside libc for reference.
+ * Each size is repeated until roughly the same number of bytes has been
+ * processed, so small sizes report per-call overhead and large sizes
+ * report memory bandwidth.
+ *
+ * Build: gcc -std=gnu11 -O2 -o test_string_simd_benchmark \
+ *            test_string_simd_benchmark.c rosetta_string_simd.c \
+ *            rosetta_string_simd_x86.c rosetta_string_simd_neon.c
+ * ============================================================================ */
+
+#include "rosetta_string_simd.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#define BENCH_MAX_SIZE      (1024 * 1024)
+#define BENCH_TOTAL_BYTES   (64ULL * 1024 * 1024)
+#define BENCH_MIN_ITERS     64
+
+enum { K_STRLEN, K_STRCMP, K_MEMCHR, K_MEMCMP, K_MEMCPY, K_MEMSET, K_COUNT };
+
+static const char *kernel_names[K_COUNT] = {
+    "strlen", "strcmp", "memchr", "memcmp", "memcpy", "memset"
+};
+
+static uint8_t *buf_a;
+static uint8_t *buf_b;
+static volatile uint64_t sink;
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Both buffers hold `size` non-NUL equal bytes followed by a terminator */
+static void prepare(size_t size)
+{
+    memset(buf_a, 'a', size);
+    memset(buf_b, 'a', size);
+    buf_a[size] = '\0';
+    buf_b[size] = '\0';
+}
+
+static uint64_t run_once(int kernel, int use_libc, size_t size)
+{
+    const char *sa = (const char *)buf_a;
+    const char *sb = (const char *)buf_b;
+
+    switch (kernel) {
+    case K_STRLEN:
+        return use_libc ? strlen(sa) : rosetta_strlen_simd(sa);
+    case K_STRCMP:
+        return (uint64_t)(use_libc ? strcmp(sa, sb) : rosetta_strcmp_simd(sa, sb));
+    case K_MEMCHR:
+        return (uintptr_t)(use_libc ? memchr(buf_a, 0, size)
+                                    : rosetta_memchr_simd(buf_a, 0, size));
+    case K_MEMCMP:
+        return (uint64_t)(use_libc ? memcmp(buf_a, buf_b, size)
+                                   : rosetta_memcmp_simd(buf_a, buf_b, size));
+    case K_MEMCPY:
+        return (uintptr_t)(use_libc ? memcpy(buf_b, buf_a, size)
+                                    : rosetta_memcpy_simd(buf_b, buf_a, size));
+    case K_MEMSET:
+        return (uintptr_t)(use_libc ? memset(buf_b, 'a', size)
+                                    : rosetta_memset_simd(buf_b, 'a', size));
+    }
+    return 0;
+}
+
+/* Returns GB/s for `size`-byte calls */
+static double bench(int kernel, int use_libc, size_t size)
+{
+    uint64_t iters = BENCH_TOTAL_BYTES / size;
+    uint64_t acc = 0;
+    double start, elapsed;
+
+    if (iters < BENCH_MIN_ITERS) {
+        iters = BENCH_MIN_ITERS;
+    }
+
+    run_once(kernel, use_libc, size);       /* Warm caches and dispatch */
+    start = now_sec();
+    for (uint64_t i = 0; i < iters; i++) {
+        acc += run_once(kernel, use_libc, size);
+        __asm__ volatile("" ::: "memory");
+    }
+    elapsed = now_sec() - start;
+    sink = acc;
+
+    return elapsed > 0 ? (double)size * (double)iters / elapsed / 1e9 : 0.0;
+}
+
+int main(void)
+{
+    static const size_t sizes[] = {
+        1, 4, 16, 64, 256, 1024, 4096, 16384, 65536, 262144, BENCH_MAX_SIZE
+    };
+    const size_t nsizes = sizeof(sizes) / sizeof(sizes[0]);
+    rosetta_string_impl_t impls[ROS_STRING_IMPL_COUNT];
+    int nimpls = 0;
+
+    buf_a = aligned_alloc(64, BENCH_MAX_SIZE + 64);
+    buf_b = aligned_alloc(64, BENCH_MAX_SIZE + 64);
+    if (!buf_a || !buf_b) {
+        fprintf(stderr, "allocation failed\n");
+        return 1;
+    }
+
+    rosetta_string_simd_init();
+    for (int i = 0; i < ROS_STRING_IMPL_COUNT; i++) {
+        if (rosetta_string_simd_supported((rosetta_string_impl_t)i)) {
+            impls[nimpls++] = (rosetta_string_impl_t)i;
+        }
+    }
+
+    printf("=============================================\n");
+    printf("SIMD String Kernel Benchmark (GB/s)\n");
+    printf("  default: %s\n", rosetta_string_simd_name(rosetta_string_simd_active()));
+    printf("=============================================\n");
+
+    for (int k = 0; k < K_COUNT; k++) {
+        printf("\n%s\n  %8s", kernel_names[k], "size");
+        for (int i = 0; i < nimpls; i++) {
+            printf(" %8s", rosetta_string_simd_name(impls[i]));
+        }
+        printf(" %8s\n", "libc");
+
+        for (size_t s = 0; s < nsizes; s++) {
+            prepare(sizes[s]);
+            printf("  %8zu", sizes[s]);
+            for (int i = 0; i < nimpls; i++) {
+                rosetta_string_simd_select(impls[i]);
+                printf(" %8.2f", bench(k, 0, sizes[s]));
+            }
+            printf(" %8.2f\n", bench(k, 1, sizes[s]));
+        }
+    }
+
+    free(buf_a);
+    free(buf_b);
+    return 0;
+}
@@ -0,0 +1,315 @@
+/*=============================================================================
+ * Syscall Guest Pointer Translation Test
+ *=============================================================================
+ *
+ * Runs syscalls against a guest that lives in its own address space (the
+ * memory manager window) and checks that pointer arguments are translated
+ * and range-checked from the syscall metadata, that read()/write() land
+ * directly in guest memory and that guest registers are preserved.
+ *
+ * Build: gcc -std=gnu11 -o test_syscall_guestmem test_syscall_guestmem.c \
+ *            rosetta_syscalls.c rosetta_syscalls_impl.c rosetta_syscall_uring.c \
+ *            rosetta_syscall_marshal.c rosetta_memmgr.c rosetta_log.c
+ *
+ *=============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/epoll.h>
+#include "rosetta_syscalls.h"
+#include "rosetta_syscall_marshal.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST_START(name) \
+    printf("\n--- Test: %s ---\n", name)
+
+#define TEST_PASS(name) \
+    do { \
+        tests_passed++; \
+        printf("✅ PASS: %s\n", name); \
+    } while(0)
+
+#define TEST_FAIL(name, reason) \
+    do { \
+        tests_failed++; \
+        printf("❌ FAIL: %s - %s\n", name, reason); \
+    } while(0)
+
+static rosetta_memmgr_t *mem;
+static uint64_t guest_data;         /* Guest scratch region */
+
+static int64_t guest_syscall(ThreadState *st, int nr, uint64_t a0, uint64_t a1,
+                             uint64_t a2)
+{
+    st->guest.r[X86_RAX] = (uint64_t)nr;
+    st->guest.r[X86_RDI] = a0;
+    st->guest.r[X86_RSI] = a1;
+    st->guest.r[X86_RDX] = a2;
+    dispatch_syscall_state(st);
+    return (int64_t)st->guest.r[X86_RAX];
+}
+
+static void *host(uint64_t guest_addr)
+{
+    return rosetta_memmgr_guest_to_host(mem, guest_addr);
+}
+
+static void test_read_write_zero_copy(void)
+{
+    ThreadState st;
+    int fds[2];
+    int64_t n;
+
+    TEST_START("read/write into guest memory");
+
+    memset(&st, 0, sizeof(st));
+    if (pipe(fds) < 0) {
+        TEST_FAIL("read/write", "pipe failed");
+        return;
+    }
+
+    strcpy(host(guest_data), "relocated guest");
+    n = guest_syscall(&st, X86_64_SYS_WRITE, fds[1], guest_data, 16);
+    if (n != 16 || st.guest.r[X86_RSI] != guest_data) {
+        TEST_FAIL("read/write", "write failed or clobbered guest RSI");
+        return;
+    }
+
+    n = guest_syscall(&st, X86_64_SYS_READ, fds[0], guest_data + 256, 16);
+    if (n != 16 || strcmp(host(guest_data + 256), "relocated guest") != 0) {
+        TEST_FAIL("read/write", "data did not land in guest memory");
+        return;
+    }
+
+    close(fds[0]);
+    close(fds[1]);
+    TEST_PASS("read/write");
+}
+
+static void test_range_validation(void)
+{
+    ThreadState st;
+    uint64_t end = mem->guest_base + mem->total_size;
+    char host_path[] = "/";
+    int64_t n;
+
+    TEST_START("Whole-range validation");
+
+    memset(&st, 0, sizeof(st));
+
+    /* Buffer straddles the end of guest memory */
+    n = guest_syscall(&st, X86_64_SYS_WRITE, 1, end - 8, 16);
+    if (n != -EFAULT) {
+        TEST_FAIL("range validation", "straddling buffer not rejected");
+        return;
+    }
+
+    /* A host pointer is not a guest address */
+    n = guest_syscall(&st, X86_64_SYS_STAT, (uint64_t)(uintptr_t)host_path,
+                      guest_data, 0);
+    if (n != -EFAULT) {
+        TEST_FAIL("range validation", "host path pointer accepted");
+        return;
+    }
+
+    /* Guest path translates */
+    strcpy(host(guest_data + 512), "/");
+    n = guest_syscall(&st, X86_64_SYS_STAT, guest_data + 512, guest_data, 0);
+    if (n != 0 || ((x86_64_stat_t *)host(guest_data))->st_ino == 0) {
+        TEST_FAIL("range validation", "stat of guest path failed");
+        return;
+    }
+    TEST_PASS("range validation");
+}
+
+static void test_iovec(void)
+{
+    ThreadState st;
+    x86_64_iovec_t *iov = host(guest_data + 1024);
+    int fds[2];
+    int64_t n;
+
+    TEST_START("iovec element translation");
+
+    memset(&st, 0, sizeof(st));
+    if (pipe(fds) < 0) {
+        TEST_FAIL("iovec", "pipe failed");
+        return;
+    }
+
+    memcpy(host(guest_data + 2048), "abc", 3);
+    memcpy(host(guest_data + 3072), "def", 3);
+    iov[0].iov_base = guest_data + 2048;
+    iov[0].iov_len = 3;
+    iov[1].iov_base = guest_data + 3072;
+    iov[1].iov_len = 3;
+
+    n = guest_syscall(&st, X86_64_SYS_WRITEV, fds[1], guest_data + 1024, 2);
+    if (n != 6) {
+        TEST_FAIL("iovec", "writev failed");
+        return;
+    }
+    n = guest_syscall(&st, X86_64_SYS_READ, fds[0], guest_data + 4000, 6);
+    if (n != 6 || memcmp(host(guest_data + 4000), "abcdef", 6) != 0) {
+        TEST_FAIL("iovec", "gathered data wrong");
+        return;
+    }
+
+    /* One element outside guest memory fails the whole call */
+    iov[1].iov_base = mem->guest_base + mem->total_size;
+    n = guest_syscall(&st, X86_64_SYS_WRITEV, fds[1], guest_data + 1024, 2);
+    if (n != -EFAULT) {
+        TEST_FAIL("iovec", "bad element not rejected");
+        return;
+    }
+
+    close(fds[0]);
+    close(fds[1]);
+    TEST_PASS("iovec");
+}
+
+static void test_mmap_in_window(void)
+{
+    ThreadState st;
+    int64_t addr;
+
+    TEST_START("mmap inside guest window");
+
+    memset(&st, 0, sizeof(st));
+    st.guest.r[X86_RAX] = X86_64_SYS_MMAP;
+    st.guest.r[X86_RDI] = 0;
+    st.guest.r[X86_RSI] = 8192;
+    st.guest.r[X86_RDX] = PROT_READ | PROT_WRITE;
+    st.guest.r[X86_R10] = MAP_PRIVATE | MAP_ANONYMOUS;
+    st.guest.r[X86_R8] = (uint64_t)-1;
+    st.guest.r[X86_R9] = 0;
+    dispatch_syscall_state(&st);
+    addr = (int64_t)st.guest.r[X86_RAX];
+
+    if (addr < 0 || rosetta_memmgr_guest_range(mem, (uint64_t)addr, 8192) == NULL) {
+        TEST_FAIL("mmap", "mapping not returned as a guest address");
+        return;
+    }
+    *(uint32_t *)host((uint64_t)addr + 4096) = 0xfeedface;
+
+    if (guest_syscall(&st, X86_64_SYS_MUNMAP, (uint64_t)addr, 8192, 0) != 0) {
+        TEST_FAIL("mmap", "munmap of guest address failed");
+        return;
+    }
+    TEST_PASS("mmap");
+}
+
+static void test_marshalled_handlers(void)
+{
+    ThreadState st;
+    int64_t epfd, n;
+
+    TEST_START("Marshalled handlers in the table");
+
+    memset(&st, 0, sizeof(st));
+
+    /* newfstatat(AT_FDCWD, guest path, guest stat, 0) */
+    strcpy(host(guest_data + 512), "/");
+    memset(host(guest_data), 0, sizeof(x86_64_stat_t));
+    st.guest.r[X86_R10] = 0;
+    n = guest_syscall(&st, X86_64_SYS_NEWFSTATAT, (uint64_t)-100, guest_data + 512, guest_data);
+    if (n != 0 || ((x86_64_stat_t *)host(guest_data))->st_ino == 0) {
+        TEST_FAIL("marshalled", "newfstatat of guest path failed");
+        return;
+    }
+
+    /* epoll_wait with the event array in guest memory, zero timeout */
+    epfd = epoll_create1(0);
+    st.guest.r[X86_R10] = 0;
+    n = guest_syscall(&st, X86_64_SYS_EPOLL_WAIT, (uint64_t)epfd, guest_data, 4);
+    if (epfd < 0 || n != 0) {
+        TEST_FAIL("marshalled", "epoll_wait failed");
+        return;
+    }
+    st.guest.r[X86_R10] = 0;
+    n = guest_syscall(&st, X86_64_SYS_EPOLL_WAIT, (uint64_t)epfd,
+                      mem->guest_base + mem->total_size - 8, 4);
+    if (n != -EFAULT) {
+        TEST_FAIL("marshalled", "epoll_wait event array not range-checked");
+        return;
+    }
+    close((int)epfd);
+
+    /* select(0, NULL, NULL, NULL, guest timeval {0, 0}) */
+    memset(host(guest_data + 256), 0, 16);
+    st.guest.r[X86_R10] = 0;
+    st.guest.r[X86_R8] = guest_data + 256;
+    n = guest_syscall(&st, X86_64_SYS_SELECT, 0, 0, 0);
+    if (n != 0) {
+        TEST_FAIL("marshalled", "select with guest timeout failed");
+        return;
+    }
+    TEST_PASS("marshalled");
+}
+
+static void test_identity_without_memmgr(void)
+{
+    ThreadState st;
+    char buf[8];
+    int fds[2];
+
+    TEST_START("Shared address space passthrough");
+
+    syscall_set_guest_memory(NULL);
+    memset(&st, 0, sizeof(st));
+    if (pipe(fds) < 0) {
+        TEST_FAIL("passthrough", "pipe failed");
+        return;
+    }
+
+    guest_syscall(&st, X86_64_SYS_WRITE, fds[1], (uint64_t)(uintptr_t)"hi", 2);
+    if (guest_syscall(&st, X86_64_SYS_READ, fds[0], (uint64_t)(uintptr_t)buf, 2) != 2 ||
+        memcmp(buf, "hi", 2) != 0) {
+        TEST_FAIL("passthrough", "host pointers not passed unchanged");
+        return;
+    }
+
+    close(fds[0]);
+    close(fds[1]);
+    syscall_set_guest_memory(mem);
+    TEST_PASS("passthrough");
+}
+
+int main(void)
+{
+    printf("=============================================\n");
+    printf("Syscall Guest Pointer Translation Test\n");
+    printf("=============================================\n");
+
+    mem = rosetta_memmgr_create(64 * 1024 * 1024);
+    if (mem == NULL) {
+        return 1;
+    }
+    guest_data = rosetta_memmgr_alloc(mem, 0x10000, 64 * 1024,
+                                      ROSETTA_PROT_READ | ROSETTA_PROT_WRITE, "data");
+    init_syscall_table();
+    syscall_set_guest_memory(mem);
+
+    test_read_write_zero_copy();
+    test_range_validation();
+    test_iovec();
+    test_marshalled_handlers();
+    test_mmap_in_window();
+    test_identity_without_memmgr();
+
+    syscall_set_guest_memory(NULL);
+    rosetta_memmgr_destroy(mem);
+
+    printf("\n=============================================\n");
+    printf("Results: %d passed, %d failed\n", tests_passed, tests_failed);
+    printf("=============================================\n");
+
+    return tests_failed == 0 ? 0 : 1;
+}
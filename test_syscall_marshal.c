@@ -0,0 +1,173 @@
+/*=============================================================================
+ * Syscall Structure Marshalling Test
+ *=============================================================================
+ *
+ * Validates guest <-> host conversion of epoll_event, stat, sigaction and
+ * the per-thread scratch buffers backing the non-identity paths.
+ *
+ * Build: gcc -std=gnu11 -o test_syscall_marshal test_syscall_marshal.c \
+ *            rosetta_syscall_marshal.c
+ *
+ *=============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <signal.h>
+#include "rosetta_syscall_marshal.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST_START(name) \
+    printf("\n--- Test: %s ---\n", name)
+
+#define TEST_PASS(name) \
+    do { \
+        tests_passed++; \
+        printf("✅ PASS: %s\n", name); \
+    } while(0)
+
+#define TEST_FAIL(name, reason) \
+    do { \
+        tests_failed++; \
+        printf("❌ FAIL: %s - %s\n", name, reason); \
+    } while(0)
+
+static void test_guest_layouts(void)
+{
+    TEST_START("x86_64 guest layouts");
+
+    if (sizeof(x86_64_epoll_event_t) != 12 || sizeof(x86_64_stat_t) != 144 ||
+        offsetof(x86_64_stat_t, st_size) != 48 ||
+        offsetof(x86_64_stat_t, st_mtime_sec) != 88 ||
+        sizeof(x86_64_sigaction_t) != 32) {
+        TEST_FAIL("guest layouts", "size or offset mismatch with kernel ABI");
+        return;
+    }
+    TEST_PASS("guest layouts");
+}
+
+static void test_scratch_reuse(void)
+{
+    void *a, *b, *c;
+
+    TEST_START("Per-thread scratch reuse");
+
+    a = rosetta_marshal_scratch(ROSETTA_SCRATCH_EVENTS, 1000);
+    b = rosetta_marshal_scratch(ROSETTA_SCRATCH_EVENTS, 100);
+    c = rosetta_marshal_scratch(ROSETTA_SCRATCH_MISC, 100);
+    if (a == NULL || a != b || c == a) {
+        TEST_FAIL("scratch reuse", "buffer not reused or slots aliased");
+        return;
+    }
+    rosetta_marshal_thread_cleanup();
+    TEST_PASS("scratch reuse");
+}
+
+#ifdef __linux__
+static void test_epoll_conversion(void)
+{
+    x86_64_epoll_event_t guest[2];
+    struct epoll_event host[2];
+    struct epoll_event tmp;
+    struct epoll_event *in;
+
+    TEST_START("epoll_event conversion");
+
+    host[0].events = EPOLLIN;
+    host[0].data.u64 = 0x1122334455667788ULL;
+    host[1].events = EPOLLOUT | EPOLLET;
+    host[1].data.u64 = 42;
+    rosetta_marshal_epoll_events_out(guest, host, 2);
+
+    if (guest[0].events != EPOLLIN || guest[0].data != 0x1122334455667788ULL ||
+        guest[1].events != (EPOLLOUT | EPOLLET) || guest[1].data != 42) {
+        TEST_FAIL("epoll conversion", "packed copy-out wrong");
+        return;
+    }
+
+    in = rosetta_marshal_epoll_event_in(&guest[1], &tmp);
+    if (in == NULL || in->events != (EPOLLOUT | EPOLLET) || in->data.u64 != 42) {
+        TEST_FAIL("epoll conversion", "copy-in wrong");
+        return;
+    }
+    TEST_PASS("epoll conversion");
+}
+#endif
+
+static void test_stat_conversion(void)
+{
+    x86_64_stat_t guest;
+    struct stat host;
+
+    TEST_START("stat conversion");
+
+    memset(&host, 0, sizeof(host));
+    host.st_ino = 1234;
+    host.st_mode = 0100644;
+    host.st_size = 987654321;
+    host.st_mtim.tv_sec = 1700000000;
+    host.st_mtim.tv_nsec = 5;
+    rosetta_marshal_stat_out(&guest, &host);
+
+    if (guest.st_ino != 1234 || guest.st_mode != 0100644 ||
+        guest.st_size != 987654321 || guest.st_mtime_sec != 1700000000 ||
+        guest.st_mtime_nsec != 5) {
+        TEST_FAIL("stat conversion", "field mismatch");
+        return;
+    }
+    TEST_PASS("stat conversion");
+}
+
+static void test_sigaction_roundtrip(void)
+{
+    x86_64_sigaction_t guest, back;
+    struct sigaction host;
+
+    TEST_START("sigaction round trip");
+
+    guest.handler = 0x401000;
+    guest.flags = SA_SIGINFO | SA_RESTART | 0x04000000;   /* SA_RESTORER */
+    guest.restorer = 0x402000;
+    guest.mask = (1ULL << (SIGUSR1 - 1)) | (1ULL << (SIGTERM - 1));
+
+    rosetta_marshal_sigaction_in(&guest, &host);
+    if ((uintptr_t)host.sa_handler != 0x401000 ||
+        !(host.sa_flags & SA_SIGINFO) || (host.sa_flags & 0x04000000) ||
+        sigismember(&host.sa_mask, SIGUSR1) != 1 ||
+        sigismember(&host.sa_mask, SIGINT) != 0) {
+        TEST_FAIL("sigaction round trip", "guest -> host wrong");
+        return;
+    }
+
+    rosetta_marshal_sigaction_out(&back, &host);
+    if (back.handler != guest.handler || back.mask != guest.mask) {
+        TEST_FAIL("sigaction round trip", "host -> guest wrong");
+        return;
+    }
+    TEST_PASS("sigaction round trip");
+}
+
+int main(void)
+{
+    printf("=============================================\n");
+    printf("Syscall Structure Marshalling Test\n");
+    printf("=============================================\n");
+
+    test_guest_layouts();
+    test_scratch_reuse();
+#ifdef __linux__
+    test_epoll_conversion();
+#endif
+    test_stat_conversion();
+    test_sigaction_roundtrip();
+
+    printf("\n=============================================\n");
+    printf("Results: %d passed, %d failed\n", tests_passed, tests_failed);
+    printf("=============================================\n");
+
+    return tests_failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,217 @@
+/*=============================================================================
+ * Trace Ring Test
+ *=============================================================================
+ *
+ * Streams events from several threads to a trace file and decodes it back,
+ * checks that the memory-only mode keeps the most recent events, and
+ * reports the per-event recording cost.
+ *
+ * Build: gcc -std=gnu11 -pthread -o test_trace test_trace.c \
+ *            rosetta_refactored_debug.c
+ *
+ *=============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include "rosetta_refactored_debug.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST_START(name) \
+    printf("\n--- Test: %s ---\n", name)
+
+#define TEST_PASS(name) \
+    do { \
+        tests_passed++; \
+        printf("✅ PASS: %s\n", name); \
+    } while(0)
+
+#define TEST_FAIL(name, reason) \
+    do { \
+        tests_failed++; \
+        printf("❌ FAIL: %s - %s\n", name, reason); \
+    } while(0)
+
+#define THREADS         4
+#define EVENTS          200000
+
+static char trace_path[64];
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/* Guest pc encodes thread and sequence; pace so the writer keeps up */
+static void *producer(void *arg)
+{
+    uint64_t t = (uint64_t)(uintptr_t)arg;
+
+    for (uint64_t i = 0; i < EVENTS; i++) {
+        rosetta_trace_record(ROS_TRACE_BLOCK_ENTRY, (t << 32) | i, 0x1000 + i, (uint32_t)t);
+        if ((i & 1023) == 1023) {
+            usleep(200);
+        }
+    }
+    return NULL;
+}
+
+/* ============================================================================
+ * Tests
+ * ============================================================================ */
+
+static void test_stream_and_decode(void)
+{
+    const char *name = "Multi-thread stream and decode";
+    pthread_t threads[THREADS];
+    uint64_t next[THREADS] = { 0 };
+    char *text = NULL, *line;
+    size_t len = 0;
+    long decoded;
+    FILE *f;
+    int t;
+
+    TEST_START(name);
+    if (rosetta_trace_open(trace_path) != 0) {
+        TEST_FAIL(name, "could not open trace file");
+        return;
+    }
+    for (t = 0; t < THREADS; t++) {
+        pthread_create(&threads[t], NULL, producer, (void *)(uintptr_t)t);
+    }
+    for (t = 0; t < THREADS; t++) {
+        pthread_join(threads[t], NULL);
+    }
+    rosetta_trace_flush();
+    rosetta_trace_cleanup();
+    printf("  dropped=%llu\n", (unsigned long long)rosetta_trace_dropped());
+
+    f = open_memstream(&text, &len);
+    decoded = rosetta_trace_decode(trace_path, f);
+    fclose(f);
+    printf("  decoded=%ld of %d\n", decoded, THREADS * EVENTS);
+    if (decoded + (long)rosetta_trace_dropped() != THREADS * EVENTS || decoded < EVENTS) {
+        free(text);
+        TEST_FAIL(name, "events lost");
+        return;
+    }
+
+    /* Each thread's events appear in order, none duplicated */
+    for (line = text; line && *line; line = strchr(line, '\n') ? strchr(line, '\n') + 1 : NULL) {
+        char *g = strstr(line, "guest=0x");
+        unsigned long long guest = g ? strtoull(g + 8, NULL, 16) : ~0ULL;
+        if ((guest >> 32) >= THREADS ||
+            (guest & 0xFFFFFFFF) < next[guest >> 32]) {
+            free(text);
+            TEST_FAIL(name, "events out of order");
+            return;
+        }
+        next[guest >> 32] = (guest & 0xFFFFFFFF) + 1;
+    }
+    free(text);
+    TEST_PASS(name);
+}
+
+static void test_memory_mode(void)
+{
+    const char *name = "Memory mode keeps the latest events";
+    char dump_path[80], buf[256], first[256] = "", last[256] = "";
+    int saved_stdout, fd;
+    uint64_t i;
+    FILE *f;
+
+    TEST_START(name);
+    rosetta_trace_init();
+    for (i = 0; i < ROS_TRACE_BUFFER_SIZE + 100; i++) {
+        rosetta_trace_record(ROS_TRACE_INSN, 0x400000 + i, 0, 0xD503201F);
+    }
+    rosetta_trace_record(ROS_TRACE_SYSCALL, 0x401234, 0, 60);
+
+    /* Capture the dump */
+    snprintf(dump_path, sizeof(dump_path), "%s.txt", trace_path);
+    fflush(stdout);
+    saved_stdout = dup(1);
+    fd = open(dump_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    dup2(fd, 1);
+    close(fd);
+    rosetta_trace_dump();
+    fflush(stdout);
+    dup2(saved_stdout, 1);
+    close(saved_stdout);
+    rosetta_trace_cleanup();
+
+    f = fopen(dump_path, "r");
+    while (f && fgets(buf, sizeof(buf), f)) {
+        if (buf[0] == '[') {
+            if (!first[0]) {
+                strcpy(first, buf);
+            }
+            strcpy(last, buf);
+        } else if (buf[0] == '=' && strstr(buf, "TRACE BUFFER") &&
+                   !strstr(buf, "(4096 entries)")) {
+            first[0] = 0;
+            break;
+        }
+    }
+    if (f) {
+        fclose(f);
+    }
+    unlink(dump_path);
+    printf("  oldest: %s  newest: %s", first, last);
+
+    if (!strstr(first, "INSN    guest=0x0000000000400065") ||
+        !strstr(last, "SYSCALL guest=0x0000000000401234") || rosetta_trace_dropped() != 0) {
+        TEST_FAIL(name, "wrong events retained");
+        return;
+    }
+    TEST_PASS(name);
+}
+
+static void test_record_cost(void)
+{
+    const char *name = "Recording cost";
+    const uint64_t n = 2000000;
+    uint64_t t0, t1;
+
+    TEST_START(name);
+    rosetta_trace_init();
+    t0 = now_ns();
+    for (uint64_t i = 0; i < n; i++) {
+        rosetta_trace_record(ROS_TRACE_BLOCK_ENTRY, i, i, 0);
+    }
+    t1 = now_ns();
+    rosetta_trace_cleanup();
+
+    printf("  %.1f ns/event\n", (double)(t1 - t0) / (double)n);
+    TEST_PASS(name);
+}
+
+int main(void)
+{
+    printf("=================================================\n");
+    printf("Trace Ring Test\n");
+    printf("=================================================\n");
+
+    snprintf(trace_path, sizeof(trace_path), "/tmp/rosetta-trace-%d.bin", (int)getpid());
+
+    test_stream_and_decode();
+    test_memory_mode();
+    test_record_cost();
+
+    unlink(trace_path);
+
+    printf("\n=================================================\n");
+    printf("Results: %d passed, %d failed\n", tests_passed, tests_failed);
+    printf("=================================================\n");
+
+    return tests_failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,589 @@
+/*=============================================================================
+ * REP String Operation Test
+ *=============================================================================
+ *
+ * Runs MOVS/STOS/CMPS/SCAS through translate_*() and checks memory, RSI,
+ * RDI, RCX and ZF against a one-element-at-a-time reference, over both
+ * directions, every element size and overlapping MOVS ranges, and checks
+ * that operands are translated through, and bounded by, a guest window.
+ * The emitted calls run on test_a64_interp.c: CLD/STD, 64-bit and 0x67
+ * counts, the fault exit, and string ops between VEX and x87 code.
+ *
+ * Build: gcc -std=gnu11 -o test_trans_string test_trans_string.c \
+ *            test_a64_interp.c rosetta_trans_string.c rosetta_string_simd.c \
+ *            rosetta_string_simd_x86.c rosetta_string_simd_neon.c \
+ *            rosetta_translate_special.c rosetta_translate_avx.c \
+ *            rosetta_translate_simd.c rosetta_translate_x87.c rosetta_x87.c \
+ *            rosetta_translate_mxcsr.c rosetta_arm64_emit.c \
+ *            rosetta_x86_decode.c rosetta_insn_cache.c rosetta_vdso.c \
+ *            rosetta_memmgr.c rosetta_syscalls.c rosetta_syscalls_impl.c \
+ *            rosetta_syscall_uring.c rosetta_syscall_marshal.c rosetta_log.c \
+ *            -lm -pthread
+ *
+ *=============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <signal.h>
+#include "rosetta_trans_string.h"
+#include "rosetta_translate_special.h"
+#include "rosetta_translate_avx.h"
+#include "rosetta_translate_x87.h"
+#include "rosetta_exec_context.h"
+#include "rosetta_memmgr.h"
+#include "test_a64_interp.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST_START(name) \
+    printf("\n--- Test: %s ---\n", name)
+
+#define TEST_PASS(name) \
+    do { \
+        tests_passed++; \
+        printf("✅ PASS: %s\n", name); \
+    } while(0)
+
+#define TEST_FAIL(name, reason) \
+    do { \
+        tests_failed++; \
+        printf("❌ FAIL: %s - %s\n", name, reason); \
+    } while(0)
+
+#define ARENA_SIZE 8192
+
+static uint8_t arena[ARENA_SIZE];
+static uint8_t expect[ARENA_SIZE];
+static const int sizes[] = { 1, 2, 4, 8 };
+static const uint32_t counts[] = { 0, 1, 3, 7, 15, 64, 100, 333 };
+
+static void fill_random(uint8_t *buf, size_t n, unsigned seed)
+{
+    srand(seed);
+    for (size_t i = 0; i < n; i++) {
+        buf[i] = (uint8_t)rand();
+    }
+}
+
+static void setup(ThreadState *st, uint8_t *rsi, uint8_t *rdi, uint64_t rax, int df)
+{
+    memset(st, 0, sizeof(*st));
+    st->host.x[0] = rax;
+    st->host.x[6] = (uint64_t)(uintptr_t)rsi;
+    st->host.x[7] = (uint64_t)(uintptr_t)rdi;
+    st->guest.rflags = df ? STRING_RFLAGS_DF : 0;
+}
+
+/* ============================================================================
+ * Tests
+ * ============================================================================ */
+
+static void test_rep_movs(void)
+{
+    const char *name = "REP MOVS matches element-wise copy, overlap and DF";
+    static const int offsets[] = { -520, -64, -9, -8, -3, -1, 0, 1, 3, 8, 9, 64, 520 };
+    char why[128];
+
+    TEST_START(name);
+    for (size_t si = 0; si < 4; si++)
+    for (size_t ci = 0; ci < sizeof(counts) / sizeof(counts[0]); ci++)
+    for (size_t oi = 0; oi < sizeof(offsets) / sizeof(offsets[0]); oi++)
+    for (int df = 0; df < 2; df++) {
+        int size = sizes[si];
+        uint32_t count = counts[ci];
+        int64_t step = df ? -size : size;
+        uint8_t *src = arena + ARENA_SIZE / 2;
+        uint8_t *dst = src + offsets[oi];
+        ThreadState st;
+
+        fill_random(arena, ARENA_SIZE, (unsigned)(si * 131 + ci * 17 + oi));
+        memcpy(expect, arena, ARENA_SIZE);
+        for (uint32_t i = 0; i < count; i++) {
+            memmove(expect + (dst - arena) + step * i,
+                    expect + (src - arena) + step * i, (size_t)size);
+        }
+
+        setup(&st, src, dst, 0, df);
+        translate_movs(&st, NULL, size, true, count);
+
+        if (memcmp(arena, expect, ARENA_SIZE) != 0 ||
+            st.host.x[6] != (uint64_t)(uintptr_t)(src + step * count) ||
+            st.host.x[7] != (uint64_t)(uintptr_t)(dst + step * count) ||
+            st.host.x[1] != 0) {
+            snprintf(why, sizeof(why), "size=%d count=%u offset=%d df=%d",
+                     size, count, offsets[oi], df);
+            TEST_FAIL(name, why);
+            return;
+        }
+    }
+    TEST_PASS(name);
+}
+
+static void test_rep_stos(void)
+{
+    const char *name = "REP STOS fills uniform and mixed patterns";
+    static const uint64_t values[] = { 0, 0x4141414141414141ULL, 0x0123456789ABCDEFULL };
+    char why[128];
+
+    TEST_START(name);
+    for (size_t si = 0; si < 4; si++)
+    for (size_t ci = 0; ci < sizeof(counts) / sizeof(counts[0]); ci++)
+    for (size_t vi = 0; vi < 3; vi++)
+    for (int df = 0; df < 2; df++) {
+        int size = sizes[si];
+        uint32_t count = counts[ci];
+        int64_t step = df ? -size : size;
+        uint8_t *dst = arena + ARENA_SIZE / 2;
+        ThreadState st;
+
+        fill_random(arena, ARENA_SIZE, (unsigned)(si + ci * 7 + vi * 3));
+        memcpy(expect, arena, ARENA_SIZE);
+        for (uint32_t i = 0; i < count; i++) {
+            memcpy(expect + (dst - arena) + step * i, &values[vi], (size_t)size);
+        }
+
+        setup(&st, NULL, dst, values[vi], df);
+        translate_stos(&st, NULL, size, true, count);
+
+        if (memcmp(arena, expect, ARENA_SIZE) != 0 ||
+            st.host.x[7] != (uint64_t)(uintptr_t)(dst + step * count)) {
+            snprintf(why, sizeof(why), "size=%d count=%u value=%zu df=%d",
+                     size, count, vi, df);
+            TEST_FAIL(name, why);
+            return;
+        }
+    }
+    TEST_PASS(name);
+}
+
+static void test_repe_cmpsb(void)
+{
+    const char *name = "REPE CMPSB stops after the first mismatch";
+    uint8_t *a = arena, *b = arena + 1024;
+    ThreadState st;
+
+    TEST_START(name);
+    fill_random(a, 1024, 7);
+    memcpy(b, a, 1024);
+
+    for (uint32_t at = 0; at < 600; at += 37) {
+        b[at] ^= 0x5A;
+        setup(&st, a, b, 0, 0);
+        translate_cmps(&st, NULL, 1, true, 600);
+        b[at] ^= 0x5A;
+        if (st.host.x[6] != (uint64_t)(uintptr_t)(a + at + 1) ||
+            st.host.x[1] != 600 - at - 1 || (st.host.pstate & (1ULL << 30))) {
+            TEST_FAIL(name, "wrong stop position or ZF on mismatch");
+            return;
+        }
+    }
+
+    setup(&st, a, b, 0, 0);
+    translate_cmps(&st, NULL, 1, true, 600);
+    if (st.host.x[6] != (uint64_t)(uintptr_t)(a + 600) || st.host.x[1] != 0 ||
+        !(st.host.pstate & (1ULL << 30))) {
+        TEST_FAIL(name, "equal ranges should run to RCX=0 with ZF set");
+        return;
+    }
+
+    /* RCX above 4G stays 64-bit */
+    b[100] ^= 0x5A;
+    setup(&st, a, b, 0, 0);
+    translate_cmps(&st, NULL, 1, true, 0x100000000ULL + 600);
+    b[100] ^= 0x5A;
+    if (st.host.x[1] != 0x100000000ULL + 600 - 101) {
+        TEST_FAIL(name, "RCX truncated to 32 bits");
+        return;
+    }
+    TEST_PASS(name);
+}
+
+static void test_repne_scas(void)
+{
+    const char *name = "REPNE SCAS finds the first match";
+    uint8_t *buf = arena;
+    ThreadState st;
+
+    TEST_START(name);
+    memset(buf, 0x11, 1024);
+    memset(buf + 696, 0, 8);
+    memset(buf + 896, 0, 8);
+
+    for (int df = 0; df < 2; df++)
+    for (size_t si = 0; si < 4; si++) {
+        int size = sizes[si];
+        uint8_t *start = df ? buf + 1000 - size : buf;
+        uint64_t hit = df ? (uint64_t)(uintptr_t)(buf + 904 - 2 * size)
+                          : (uint64_t)(uintptr_t)(buf + 696 + size);
+
+        setup(&st, NULL, start, 0, df);
+        translate_scas(&st, NULL, size, true, 1000 / size);
+        if (st.host.x[7] != hit || !(st.host.pstate & (1ULL << 30))) {
+            TEST_FAIL(name, df ? "backward scan" : "forward scan");
+            return;
+        }
+    }
+
+    setup(&st, NULL, buf, 0x22, 0);
+    translate_scas(&st, NULL, 1, true, 500);
+    if (st.host.x[7] != (uint64_t)(uintptr_t)(buf + 500) || st.host.x[1] != 0 ||
+        (st.host.pstate & (1ULL << 30))) {
+        TEST_FAIL(name, "no match should exhaust RCX with ZF clear");
+        return;
+    }
+    TEST_PASS(name);
+}
+
+static void test_guest_window(void)
+{
+    const char *name = "Operands go through the guest window";
+    rosetta_memmgr_t *mem = rosetta_memmgr_create(64 * 1024);
+    uint64_t base, end;
+    uint8_t *host;
+    ThreadState st;
+
+    TEST_START(name);
+    if (mem == NULL) {
+        TEST_FAIL(name, "rosetta_memmgr_create failed");
+        return;
+    }
+    base = mem->guest_base;
+    end = base + mem->total_size;
+    host = rosetta_memmgr_guest_to_host(mem, base);
+    memset(host, 0x11, mem->total_size);
+    translate_string_set_guest_memory(mem);
+
+    /* STOSQ at guest addresses lands in the window */
+    memset(&st, 0, sizeof(st));
+    st.host.x[0] = 0x0102030405060708ULL;
+    st.host.x[7] = base + 0x100;
+    if (translate_stos(&st, NULL, 8, true, 40) != 0 ||
+        st.host.x[7] != base + 0x100 + 320 ||
+        memcmp(host + 0x100 + 312, &st.host.x[0], 8) != 0) {
+        TEST_FAIL(name, "STOS not translated");
+        goto out;
+    }
+
+    /* A run leaving the window fails without touching state */
+    st.host.x[6] = base + 0x100;
+    st.host.x[7] = end - 64;
+    if (translate_movs(&st, NULL, 8, true, 9) != -1 || st.host.x[7] != end - 64) {
+        TEST_FAIL(name, "MOVS past the window not rejected");
+        goto out;
+    }
+
+    /* REPNE SCASB with RCX = -1 only needs the bytes up to the match */
+    host[mem->total_size - 2] = 0;
+    st.host.x[0] = 0;
+    st.host.x[7] = end - 200;
+    if (translate_scas(&st, NULL, 1, true, UINT64_MAX) != 0 ||
+        st.host.x[7] != end - 1 || !(st.host.pstate & (1ULL << 30))) {
+        TEST_FAIL(name, "strlen-style scan failed");
+        goto out;
+    }
+    host[mem->total_size - 2] = 0x11;
+    st.host.x[7] = end - 200;
+    if (translate_scas(&st, NULL, 1, true, UINT64_MAX) != -1 || st.host.x[7] != end - 200) {
+        TEST_FAIL(name, "scan off the window not rejected");
+        goto out;
+    }
+    TEST_PASS(name);
+
+out:
+    translate_string_set_guest_memory(NULL);
+    rosetta_memmgr_destroy(mem);
+}
+
+/* ============================================================================
+ * Emitted Calls
+ * ============================================================================ */
+
+static uint64_t emit_stack[256];
+static uint32_t emit_words[4096];
+static ThreadState emit_st;
+static rosetta_exec_context_t emit_ctx;
+
+/* Call the real helper, then clobber what AAPCS64 lets a callee clobber */
+static int string_blr(a64_t *c, uint64_t target)
+{
+    typedef int (*helper_t)(ThreadState *, const uint8_t *, int, bool, uint64_t);
+    int ret = ((helper_t)(uintptr_t)target)((ThreadState *)(uintptr_t)c->x[0],
+                                            (const uint8_t *)(uintptr_t)c->x[1],
+                                            (int)c->x[2], c->x[3] != 0, c->x[4]);
+
+    for (int i = 1; i <= 17; i++) {
+        c->x[i] = 0xDEAD0000u + (uint64_t)i;
+    }
+    for (int i = 0; i < 32; i++) {
+        memset(&c->v[i], 0xC0 + i, sizeof(c->v[i]));
+    }
+    c->nzcv = 0xF;
+    c->x[0] = (uint32_t)ret;
+    c->helper_calls++;
+    return 0;
+}
+
+static void emit_begin(code_buffer_t *cb)
+{
+    memset(cb, 0, sizeof(*cb));
+    cb->buffer = (uint8_t *)emit_words;
+    cb->size = sizeof(emit_words);
+    memset(&emit_st, 0, sizeof(emit_st));
+    emit_ctx.state = &emit_st;
+}
+
+/* Lower one instruction; every string op is emitted at 0x401000 */
+static void emit_x86(code_buffer_t *cb, const uint8_t *bytes)
+{
+    x86_insn_t insn;
+
+    decode_x86_insn(bytes, &insn);
+    if (x86_is_cld(&insn)) {
+        translate_special_cld(cb, &insn);
+    } else if (x86_is_std(&insn)) {
+        translate_special_std(cb, &insn);
+    } else {
+        translate_string_emit(cb, &insn, 0x401000);
+    }
+}
+
+static size_t emit_run(a64_t *c, code_buffer_t *cb)
+{
+    c->x[18] = (uint64_t)(uintptr_t)&emit_ctx;
+    c->sp = (uint64_t)(uintptr_t)&emit_stack[192];
+    c->blr = string_blr;
+    return a64_run(c, emit_words, cb->offset / 4);
+}
+
+static void test_emitted_df(void)
+{
+    const char *name = "STD; REP MOVSB; CLD copies backward";
+    static const uint8_t std_[] = { 0xFD }, cld[] = { 0xFC }, rep_movsb[] = { 0xF3, 0xA4 };
+    uint8_t *src = arena + 64, *dst = arena + 65;
+    code_buffer_t cb;
+    a64_t c;
+
+    TEST_START(name);
+    emit_begin(&cb);
+    emit_x86(&cb, std_);
+    emit_x86(&cb, rep_movsb);
+    emit_x86(&cb, cld);
+
+    /* Overlapping by one: backward moves the block, forward would smear src[0] */
+    for (int i = 0; i < 32; i++) {
+        src[i] = (uint8_t)(i + 1);
+    }
+    memset(&c, 0, sizeof(c));
+    c.x[1] = 16;
+    c.x[6] = (uint64_t)(uintptr_t)(src + 15);
+    c.x[7] = (uint64_t)(uintptr_t)(dst + 15);
+    for (int i = 8; i < 16; i++) {
+        c.x[i] = 0x1000 + (uint64_t)i;
+    }
+    for (int i = 0; i < 16; i++) {
+        memset(&c.v[i], i, sizeof(c.v[i]));
+    }
+    if (emit_run(&c, &cb) != 0 || c.helper_calls != 1) {
+        TEST_FAIL(name, "emitted code did not run");
+        return;
+    }
+    for (int i = 0; i < 16; i++) {
+        if (dst[i] != i + 1) {
+            TEST_FAIL(name, "copy did not run backward");
+            return;
+        }
+    }
+    if (c.x[1] != 0 || c.x[6] != (uint64_t)(uintptr_t)(src - 1) ||
+        c.x[7] != (uint64_t)(uintptr_t)(dst - 1) || (emit_st.guest.rflags & STRING_RFLAGS_DF)) {
+        TEST_FAIL(name, "wrong RCX/RSI/RDI or DF left set");
+        return;
+    }
+    for (int i = 8; i < 16; i++) {
+        if (c.x[i] != 0x1000 + (uint64_t)i) {
+            TEST_FAIL(name, "guest register lost across the call");
+            return;
+        }
+    }
+    for (int i = 0; i < 16; i++) {
+        if (c.v[i].b[0] != i || c.v[i].b[15] != i) {
+            TEST_FAIL(name, "guest XMM lost across the call");
+            return;
+        }
+    }
+    TEST_PASS(name);
+}
+
+static void test_emitted_count(void)
+{
+    const char *name = "Emitted count is RCX, or ECX under 0x67";
+    static const uint8_t addr32_rep_stosb[] = { 0x67, 0xF3, 0xAA }, repe_cmpsb[] = { 0xF3, 0xA6 };
+    uint8_t *a = arena, *b = arena + 1024;
+    code_buffer_t cb;
+    a64_t c;
+
+    TEST_START(name);
+    emit_begin(&cb);
+    emit_x86(&cb, addr32_rep_stosb);
+    memset(a, 0x11, 16);
+    memset(&c, 0, sizeof(c));
+    c.x[0] = 0x77;
+    c.x[1] = 0xFFFFFFFF00000004ULL;
+    c.x[7] = (uint64_t)(uintptr_t)a;
+    if (emit_run(&c, &cb) != 0 || a[3] != 0x77 || a[4] != 0x11 || c.x[1] != 0) {
+        TEST_FAIL(name, "0x67 REP STOSB did not use ECX");
+        return;
+    }
+
+    emit_begin(&cb);
+    emit_x86(&cb, repe_cmpsb);
+    fill_random(a, 64, 3);
+    memcpy(b, a, 64);
+    b[9] ^= 1;
+    memset(&c, 0, sizeof(c));
+    c.x[1] = 0x100000000ULL + 50;
+    c.x[6] = (uint64_t)(uintptr_t)a;
+    c.x[7] = (uint64_t)(uintptr_t)b;
+    if (emit_run(&c, &cb) != 0 || c.x[1] != 0x100000000ULL + 40 || (c.nzcv & 0x4)) {
+        TEST_FAIL(name, "REPE CMPSB truncated RCX or lost ZF");
+        return;
+    }
+    TEST_PASS(name);
+}
+
+static void test_emitted_fault(void)
+{
+    const char *name = "A run off guest memory exits the block with SIGSEGV";
+    static const uint8_t rep_movsq[] = { 0xF3, 0x48, 0xA5 };
+    rosetta_memmgr_t *mem = rosetta_memmgr_create(64 * 1024);
+    uint64_t end;
+    code_buffer_t cb;
+    a64_t c;
+
+    TEST_START(name);
+    if (mem == NULL) {
+        TEST_FAIL(name, "rosetta_memmgr_create failed");
+        return;
+    }
+    end = mem->guest_base + mem->total_size;
+    translate_string_set_guest_memory(mem);
+
+    emit_begin(&cb);
+    emit_x86(&cb, rep_movsq);
+    emit_ret(&cb);
+    memset(&c, 0, sizeof(c));
+    c.x[1] = 9;
+    c.x[6] = mem->guest_base;
+    c.x[7] = end - 64;
+    if (emit_run(&c, &cb) != 0 || !c.returned || emit_st.guest.rip != 0x401000 ||
+        !(emit_st.pending_signals & (1u << (SIGSEGV - 1))) ||
+        c.x[1] != 9 || c.x[7] != end - 64) {
+        TEST_FAIL(name, "fault not reported at the instruction");
+    } else {
+        TEST_PASS(name);
+    }
+
+    translate_string_set_guest_memory(NULL);
+    rosetta_memmgr_destroy(mem);
+}
+
+/*
+ * VEX, string and x87 instructions in the order rosetta_execute_fixed.c
+ * lowers them: the caches in V16-V27 are flushed before each string call,
+ * so YMM0's upper half and the x87 stack come through the helper clobbering
+ * every caller-saved register.
+ */
+static void test_emitted_between_vex_x87(void)
+{
+    const char *name = "String ops between VEX and x87 code";
+    static const uint8_t vmovups[] = { 0xC5, 0xFC, 0x10, 0x03 };     /* vmovups ymm0, [rbx] */
+    static const uint8_t rep_movsb[] = { 0xF3, 0xA4 };
+    static const uint8_t fld[] = { 0xDD, 0x02 };                      /* fld qword [rdx] */
+    static const uint8_t rep_stosb[] = { 0xF3, 0xAA };
+    static const uint8_t fstp[] = { 0xDD, 0x5D, 0x00 };               /* fstp qword [rbp] */
+    const uint8_t *seq[] = { vmovups, rep_movsb, fld, rep_stosb, fstp };
+    uint8_t ymm[32], copy_src[8] = "strings", copy_dst[8] = { 0 };
+    double in = 2.5, out = 0;
+    translate_avx_state_t avx;
+    translate_x87_state_t x87;
+    code_buffer_t cb;
+    a64_t c;
+
+    TEST_START(name);
+    emit_begin(&cb);
+    translate_avx_begin_block(&avx);
+    translate_x87_begin_block(&x87);
+    for (size_t i = 0; i < sizeof(seq) / sizeof(seq[0]); i++) {
+        x86_insn_t insn;
+
+        decode_x86_insn(seq[i], &insn);
+        if (insn.vex_prefix) {
+            translate_x87_flush(&cb, &x87);
+            translate_avx_lower(&cb, &avx, &insn, 0);
+        } else if (x86_is_x87(&insn)) {
+            translate_avx_flush(&cb, &avx);
+            translate_x87_lower(&cb, &x87, &insn, 0);
+        } else {
+            translate_avx_flush(&cb, &avx);
+            translate_x87_flush(&cb, &x87);
+            translate_string_emit(&cb, &insn, 0x401000);
+        }
+    }
+    translate_avx_flush(&cb, &avx);
+    translate_x87_flush(&cb, &x87);
+
+    for (int i = 0; i < 32; i++) {
+        ymm[i] = (uint8_t)(0x40 + i);
+    }
+    memset(&c, 0, sizeof(c));
+    c.x[1] = sizeof(copy_src);
+    c.x[2] = (uint64_t)(uintptr_t)&in;
+    c.x[3] = (uint64_t)(uintptr_t)ymm;
+    c.x[5] = (uint64_t)(uintptr_t)&out;
+    c.x[6] = (uint64_t)(uintptr_t)copy_src;
+    c.x[7] = (uint64_t)(uintptr_t)copy_dst;
+    emit_st.guest.fpu_cw = 0x037F;
+    if (emit_run(&c, &cb) != 0 || c.helper_calls != 2) {
+        TEST_FAIL(name, "emitted code did not run");
+        return;
+    }
+    /* REP STOSB runs with the RCX = 0 that REP MOVSB left */
+    if (memcmp(copy_dst, copy_src, sizeof(copy_src)) != 0 || c.x[1] != 0) {
+        TEST_FAIL(name, "REP MOVSB result");
+        return;
+    }
+    if (memcmp(c.v[0].b, ymm, 16) != 0 || memcmp(&emit_st.guest.ymm_hi[0], ymm + 16, 16) != 0) {
+        TEST_FAIL(name, "YMM0 lost across the string call");
+        return;
+    }
+    if (out != in) {
+        TEST_FAIL(name, "x87 stack lost across the string call");
+        return;
+    }
+    TEST_PASS(name);
+}
+
+int main(void)
+{
+    printf("=================================================\n");
+    printf("REP String Operation Test\n");
+    printf("=================================================\n");
+
+    test_rep_movs();
+    test_rep_stos();
+    test_repe_cmpsb();
+    test_repne_scas();
+    test_guest_window();
+    test_emitted_df();
+    test_emitted_count();
+    test_emitted_fault();
+    test_emitted_between_vex_x87();
+
+    printf("\n=================================================\n");
+    printf("Results: %d passed, %d failed\n", tests_passed, tests_failed);
+    printf("=================================================\n");
+
+    return tests_failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,1204 @@
+/*=============================================================================
+ * x87 Emulation and Lowering Differential Test
+ *=============================================================================
+ *
+ * Runs x87 instructions on the host FPU and through the emulation, from the
+ * same random and edge-case states, and compares the FNSAVE images, memory
+ * and flags:
+ *
+ * - rosetta_x87_exec() in accurate mode, one instruction at a time, bit
+ *   for bit against the host under every precision and rounding control.
+ * - Translated blocks of up to a dozen instructions, run on a small ARM64
+ *   interpreter that calls rosetta_x87_exec() natively at BLR. In accurate
+ *   mode the images must match exactly; in fast mode the host runs with
+ *   53-bit precision and registers are compared as doubles.
+ * - The transcendentals, within a few units in the last place.
+ *
+ * The interpreter covers only the encoding classes the lowering emits and
+ * fails on anything else, so a stray encoding shows up as a failure.
+ *
+ * Build: gcc -std=gnu11 -o test_x87 test_x87.c test_a64_interp.c rosetta_x87.c \
+ *            rosetta_translate_x87.c rosetta_arm64_emit.c \
+ *            rosetta_x86_decode.c rosetta_insn_cache.c \
+ *            rosetta_translate_mxcsr.c -lm -pthread
+ *
+ *=============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include "rosetta_x87.h"
+#include "rosetta_translate_x87.h"
+#include "rosetta_exec_context.h"
+#include "rosetta_arm64_emit.h"
+#include "test_a64_interp.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST_START(name) \
+    printf("\n--- Test: %s ---\n", name)
+
+#define TEST_PASS(name) \
+    do { \
+        tests_passed++; \
+        printf("✅ PASS: %s\n", name); \
+    } while(0)
+
+#define TEST_FAIL(name, reason) \
+    do { \
+        tests_failed++; \
+        printf("❌ FAIL: %s - %s\n", name, reason); \
+    } while(0)
+
+#if defined(__x86_64__)
+
+typedef rosetta_x87_f80_t f80_t;
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15ull;
+
+static uint64_t rnd(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+/* ============================================================================
+ * Host Execution
+ * ============================================================================
+ *
+ * xor eax, eax; push rdx; popfq; frstor [rdi]; <insns>;
+ * mov [rdi + 108], ax; fnsave [rdi]; pushfq; pop rax; ret
+ *
+ * RDI is a 112-byte image, RSI the memory operand area and RCX = 1 the SIB
+ * index, as for the emulation.
+ * ============================================================================ */
+
+#define IMG_SIZE        112
+#define IMG_AX          108
+#define MEM_SIZE        72
+#define MEM_DST         32          /* Stores go to [32, 72), loads come from [0, 32) */
+
+static uint8_t *host_page;
+
+static const uint8_t host_prologue[] = { 0x31, 0xC0, 0x52, 0x9D, 0xDD, 0x27 };
+static const uint8_t host_epilogue[] = { 0x66, 0x89, 0x47, 0x6C, 0xDD, 0x37, 0x9C, 0x58, 0xC3 };
+
+typedef uint64_t (*host_fn_t)(uint8_t *img, uint8_t *mem, uint64_t rflags, uint64_t one);
+
+static uint64_t host_run(const uint8_t *code, size_t len, uint8_t *img, uint8_t *mem, uint64_t rflags)
+{
+    uint8_t *p = host_page;
+
+    memcpy(p, host_prologue, sizeof(host_prologue));
+    p += sizeof(host_prologue);
+    memcpy(p, code, len);
+    p += len;
+    memcpy(p, host_epilogue, sizeof(host_epilogue));
+    __builtin___clear_cache((char *)host_page, (char *)p + sizeof(host_epilogue));
+    return ((host_fn_t)host_page)(img, mem, rflags, 1);
+}
+
+/* ============================================================================
+ * Values
+ * ============================================================================ */
+
+static f80_t f80_of_ld(long double v)
+{
+    f80_t r;
+
+    memcpy(&r.mant, &v, 8);
+    memcpy(&r.sexp, (uint8_t *)&v + 8, 2);
+    return r;
+}
+
+static long double ld_of_f80(f80_t a)
+{
+    long double v = 0;
+
+    memcpy(&v, &a.mant, 8);
+    memcpy((uint8_t *)&v + 8, &a.sexp, 2);
+    return v;
+}
+
+/* Random 80-bit value: zeros, denormals, infinities, NaNs, extremes, integers, ties, unnormals */
+static f80_t rnd_f80(void)
+{
+    f80_t r;
+    int k = (int)(rnd() % 16);
+    int e;
+
+    r.mant = rnd() | 0x8000000000000000ull;
+    switch (k) {
+    case 0:
+        e = 0;
+        r.mant >>= rnd() % 64;
+        if (rnd() & 1) {
+            r.mant = 0;
+        }
+        break;
+    case 1:
+        e = 0x7FFF;
+        if (rnd() & 1) {
+            r.mant = 0x8000000000000000ull;
+        }
+        break;
+    case 2:
+        e = 1 + (int)(rnd() % 80);
+        break;
+    case 3:
+        e = 0x7FFE - (int)(rnd() % 80);
+        break;
+    case 4:
+        e = 16383 + 63 + (int)(rnd() % 3) - 1;
+        break;
+    case 5:
+        e = 16383;
+        r.mant &= 0xFFFFFFFFFFFFF800ull | ((rnd() & 1) ? 0 : 0x7FF);
+        break;
+    case 6:
+        e = 16383 + (int)(rnd() % 20);
+        r.mant &= ~((1ull << (63 - (e - 16383))) - 1);
+        if (rnd() & 1) {
+            r.mant |= 1ull << (62 - (e - 16383));
+        }
+        break;
+    default:
+        e = 16383 + (int)(rnd() % 200) - 100;
+        if (k == 7 && rnd() % 8 == 0) {
+            r.mant &= 0x7FFFFFFFFFFFFFFFull;    /* Unnormal */
+        }
+        break;
+    }
+    r.sexp = (uint16_t)(e | (int)(rnd() & 1) << 15);
+    return r;
+}
+
+/* Random double for fast mode: integers, ties, signed zeros, moderate values, rare specials */
+static double rnd_double(void)
+{
+    switch (rnd() % 10) {
+    case 0:
+        return (double)((int64_t)(rnd() % 2001) - 1000);
+    case 1:
+    case 2:
+        return (double)((int64_t)(rnd() % 2001) - 1000) / 8.0;
+    case 3:
+        return (rnd() & 1) ? -0.0 : 0.0;
+    case 4:
+        switch (rnd() % 4) {
+        case 0: return INFINITY;
+        case 1: return -INFINITY;
+        case 2: return NAN;
+        default: return 1.5;
+        }
+    default:
+        return ((double)(rnd() >> 11) / 9007199254740992.0 * 2.0 - 1.0) * 1e6;
+    }
+}
+
+/* ============================================================================
+ * ARM64 Interpreter Hooks (test_a64_interp.c)
+ * ============================================================================ */
+
+static double dget(const a64_t *c, int r)
+{
+    double d;
+
+    memcpy(&d, &c->v[r].d[0], 8);
+    return d;
+}
+
+static void dset(a64_t *c, int r, double d)
+{
+    memcpy(&c->v[r].d[0], &d, 8);
+    c->v[r].d[1] = 0;
+}
+
+static int64_t fcvtzs(double d, int sf)
+{
+    double lim = sf ? 9223372036854775808.0 : 2147483648.0;
+
+    if (d != d) {
+        return 0;
+    }
+    if (d >= lim) {
+        return sf ? INT64_MAX : INT32_MAX;
+    }
+    if (d < -lim) {
+        return sf ? INT64_MIN : INT32_MIN;
+    }
+    return (int64_t)d;
+}
+
+static int x87_fp(a64_t *c, uint32_t w)
+{
+    int rd = w & 31, rn = (w >> 5) & 31, rm = (w >> 16) & 31;
+    double a = dget(c, rn), b = dget(c, rm);
+    uint64_t bits;
+
+    if ((w & 0x7F20FC00u) == 0x1E200000u) {                       /* FP <-> integer */
+        int sf = w >> 31, type = (w >> 22) & 3, rmode = (w >> 19) & 3, opc = (w >> 16) & 7;
+        if (type != 1) {
+            return -1;
+        }
+        if (rmode == 0 && opc == 2) {
+            dset(c, rd, sf ? (double)(int64_t)a64_xr(c, rn) : (double)(int32_t)a64_xr(c, rn));
+        } else if (rmode == 0 && opc == 7 && sf) {
+            c->v[rd].d[0] = a64_xr(c, rn);
+            c->v[rd].d[1] = 0;
+        } else if (rmode == 3 && opc == 0) {
+            a64_xw(c, sf, rd, (uint64_t)fcvtzs(a, sf));
+        } else {
+            return -1;
+        }
+        return 0;
+    }
+    if ((w & 0xFF207C00u) == 0x1E204000u) {                       /* 1-source */
+        int type = (w >> 22) & 3;
+        float f;
+        switch ((w >> 15) & 63) {
+        case 0: if (type != 1) return -1; c->v[rd].d[0] = c->v[rn].d[0]; c->v[rd].d[1] = 0; return 0;
+        case 1: if (type != 1) return -1; dset(c, rd, fabs(a)); return 0;
+        case 2: if (type != 1) return -1; dset(c, rd, -a); return 0;
+        case 3: if (type != 1) return -1; dset(c, rd, sqrt(a)); return 0;
+        case 4:
+            if (type != 1) return -1;
+            f = (float)a;
+            memset(&c->v[rd], 0, 16);
+            memcpy(&c->v[rd].d[0], &f, 4);
+            return 0;
+        case 5:
+            if (type != 0) return -1;
+            memcpy(&f, &c->v[rn].d[0], 4);
+            dset(c, rd, (double)f);
+            return 0;
+        case 8: if (type != 1) return -1; dset(c, rd, nearbyint(a)); return 0;
+        case 9: if (type != 1) return -1; dset(c, rd, ceil(a)); return 0;
+        case 10: if (type != 1) return -1; dset(c, rd, floor(a)); return 0;
+        case 11: if (type != 1) return -1; dset(c, rd, trunc(a)); return 0;
+        }
+        return -1;
+    }
+    if ((w & 0xFF000000u) != 0x1E000000u || ((w >> 22) & 3) != 1) {
+        return -1;
+    }
+    if ((w & 0xFF20FC17u) == 0x1E202000u) {                       /* FCMP, FCMP #0.0 */
+        c->nzcv = a64_fcmp_nzcv(a, (w & 8) ? 0.0 : b);
+        return 0;
+    }
+    if ((w & 0xFF200C10u) == 0x1E200400u) {                       /* FCCMP */
+        c->nzcv = a64_cond_holds(c->nzcv, (w >> 12) & 15) ? a64_fcmp_nzcv(a, b) : (w & 15);
+        return 0;
+    }
+    if ((w & 0xFF200C00u) == 0x1E200C00u) {                       /* FCSEL */
+        double r = a64_cond_holds(c->nzcv, (w >> 12) & 15) ? a : b;
+        dset(c, rd, r);
+        return 0;
+    }
+    if ((w & 0xFF200C00u) == 0x1E200800u) {                       /* FMUL, FDIV, FADD, FSUB */
+        switch ((w >> 12) & 15) {
+        case 0: dset(c, rd, a * b); return 0;
+        case 1: dset(c, rd, a / b); return 0;
+        case 2: dset(c, rd, a + b); return 0;
+        case 3: dset(c, rd, a - b); return 0;
+        }
+        return -1;
+    }
+    if ((w & 0xFF201FE0u) == 0x1E201000u) {                       /* FMOV Dd, #imm */
+        uint32_t imm = (w >> 13) & 0xFF;
+        uint64_t b6 = (imm >> 6) & 1;
+        bits = (uint64_t)(imm >> 7) << 63 | (b6 ^ 1) << 62 | (b6 ? 0xFFull << 54 : 0) |
+               (uint64_t)((imm >> 4) & 3) << 52 | (uint64_t)(imm & 15) << 48;
+        c->v[rd].d[0] = bits;
+        c->v[rd].d[1] = 0;
+        return 0;
+    }
+    return -1;
+}
+
+/* The helper runs natively; caller-saved registers come back as garbage */
+static int x87_blr(a64_t *c, uint64_t target)
+{
+    int i;
+
+    if (target != (uint64_t)(uintptr_t)rosetta_x87_exec) {
+        return -1;
+    }
+    c->x[0] = rosetta_x87_exec((ThreadState *)(uintptr_t)c->x[0], c->x[1], c->x[2], (uint32_t)c->x[3]);
+    for (i = 1; i <= 18; i++) {
+        c->x[i] = rnd();
+    }
+    for (i = 0; i < 32; i++) {
+        if (i < 8 || i >= 16) {
+            c->v[i].d[0] = rnd();
+        }
+        c->v[i].d[1] = rnd();
+    }
+    c->helper_calls++;
+    return 0;
+}
+
+/* MOVI Dd, #0 and the scalar double-precision forms */
+static int x87_simd(a64_t *c, uint32_t w)
+{
+    if (w == (0x2F00E400u | (w & 31))) {
+        c->v[w & 31].d[0] = c->v[w & 31].d[1] = 0;
+        return 0;
+    }
+    return (w & 0x5F000000u) == 0x1E000000u ? x87_fp(c, w) : -1;
+}
+
+/* ============================================================================
+ * Instruction Forms
+ * ============================================================================ */
+
+enum {
+    M_NONE,
+    M_F32,              /* [8] or [12] */
+    M_F64,              /* [0] */
+    M_I16,              /* [28] */
+    M_I32,              /* [24] */
+    M_I64,              /* [16] */
+    M_F80,              /* [0], accurate mode only */
+    M_DST               /* [32, 64) */
+};
+
+#define T_ARITH     0x01    /* reg field: a random arithmetic op */
+#define T_STI       0x02    /* rm field: a random i within the stack */
+#define T_RC0       0x04    /* Fast mode: only with round to nearest */
+#define T_ACC       0x08    /* Accurate mode only */
+#define T_INT       0x10    /* Integer store: the host may write the indefinite */
+#define T_CMOV      0x20    /* reg field: a random FCMOV condition */
+#define T_SW        0x40    /* Status word store: fast mode keeps no exception flags */
+#define T_CONST     0x80    /* Fast mode: only last, the host keeps 64 bits of the constant */
+
+typedef struct {
+    uint8_t opcode;
+    uint8_t modrm;          /* reg << 3 for memory forms */
+    uint8_t mem;
+    int8_t need;            /* Registers in use beyond ST(i) */
+    int8_t push;            /* Depth change */
+    uint8_t flags;
+} x87_form_t;
+
+static const x87_form_t forms[] = {
+    /* Loads */
+    { 0xD9, 0 << 3, M_F32, 0, 1, 0 },
+    { 0xDD, 0 << 3, M_F64, 0, 1, 0 },
+    { 0xDF, 0 << 3, M_I16, 0, 1, 0 },
+    { 0xDB, 0 << 3, M_I32, 0, 1, 0 },
+    { 0xDF, 5 << 3, M_I64, 0, 1, 0 },
+    { 0xDB, 5 << 3, M_F80, 0, 1, T_ACC },
+
+    /* Arithmetic and compares with memory */
+    { 0xD8, 0, M_F32, 1, 0, T_ARITH | T_RC0 },
+    { 0xDC, 0, M_F64, 1, 0, T_ARITH | T_RC0 },
+    { 0xDA, 0, M_I32, 1, 0, T_ARITH | T_RC0 },
+    { 0xDE, 0, M_I16, 1, 0, T_ARITH | T_RC0 },
+    { 0xD8, 2 << 3, M_F32, 1, 0, 0 },
+    { 0xDC, 3 << 3, M_F64, 1, -1, 0 },
+    { 0xDE, 2 << 3, M_I16, 1, 0, 0 },
+    { 0xDA, 3 << 3, M_I32, 1, -1, 0 },
+
+    /* Stores */
+    { 0xD9, 2 << 3, M_DST, 1, 0, T_RC0 },
+    { 0xD9, 3 << 3, M_DST, 1, -1, T_RC0 },
+    { 0xDD, 2 << 3, M_DST, 1, 0, 0 },
+    { 0xDD, 3 << 3, M_DST, 1, -1, 0 },
+    { 0xDB, 7 << 3, M_DST, 1, -1, T_ACC },
+    { 0xDF, 2 << 3, M_DST, 1, 0, T_INT },
+    { 0xDF, 3 << 3, M_DST, 1, -1, T_INT },
+    { 0xDB, 2 << 3, M_DST, 1, 0, T_INT },
+    { 0xDB, 3 << 3, M_DST, 1, -1, T_INT },
+    { 0xDF, 7 << 3, M_DST, 1, -1, T_INT },
+    { 0xDF, 1 << 3, M_DST, 1, -1, T_INT },
+    { 0xDB, 1 << 3, M_DST, 1, -1, T_INT },
+    { 0xDD, 1 << 3, M_DST, 1, -1, T_INT },
+    { 0xD9, 7 << 3, M_DST, 0, 0, 0 },                           /* FNSTCW */
+    { 0xDD, 7 << 3, M_DST, 0, 0, T_SW },                        /* FNSTSW m16 */
+
+    /* Register forms */
+    { 0xD8, 0xC0, M_NONE, 1, 0, T_ARITH | T_STI | T_RC0 },
+    { 0xDC, 0xC0, M_NONE, 1, 0, T_ARITH | T_STI | T_RC0 },
+    { 0xDE, 0xC0, M_NONE, 1, -1, T_ARITH | T_STI | T_RC0 },
+    { 0xD8, 0xD0, M_NONE, 1, 0, T_STI },                        /* FCOM */
+    { 0xD8, 0xD8, M_NONE, 1, -1, T_STI },                       /* FCOMP */
+    { 0xDD, 0xE0, M_NONE, 1, 0, T_STI },                        /* FUCOM */
+    { 0xDD, 0xE8, M_NONE, 1, -1, T_STI },                       /* FUCOMP */
+    { 0xDE, 0xD9, M_NONE, 2, -2, 0 },                           /* FCOMPP */
+    { 0xDA, 0xE9, M_NONE, 2, -2, 0 },                           /* FUCOMPP */
+    { 0xDB, 0xE8, M_NONE, 1, 0, T_STI },                        /* FUCOMI */
+    { 0xDB, 0xF0, M_NONE, 1, 0, T_STI },                        /* FCOMI */
+    { 0xDF, 0xE8, M_NONE, 1, -1, T_STI },                       /* FUCOMIP */
+    { 0xDF, 0xF0, M_NONE, 1, -1, T_STI },                       /* FCOMIP */
+    { 0xDA, 0xC0, M_NONE, 1, 0, T_STI | T_CMOV },
+    { 0xDB, 0xC0, M_NONE, 1, 0, T_STI | T_CMOV },
+    { 0xD9, 0xC0, M_NONE, 0, 1, T_STI },                        /* FLD ST(i) */
+    { 0xD9, 0xC8, M_NONE, 1, 0, T_STI },                        /* FXCH */
+    { 0xDD, 0xD0, M_NONE, 1, 0, T_STI },                        /* FST ST(i) */
+    { 0xDD, 0xD8, M_NONE, 1, -1, T_STI },                       /* FSTP ST(i) */
+    { 0xD9, 0xE0, M_NONE, 1, 0, 0 },                            /* FCHS */
+    { 0xD9, 0xE1, M_NONE, 1, 0, 0 },                            /* FABS */
+    { 0xD9, 0xE4, M_NONE, 1, 0, 0 },                            /* FTST */
+    { 0xD9, 0xE5, M_NONE, 1, 0, 0 },                            /* FXAM */
+    { 0xD9, 0xE8, M_NONE, 0, 1, 0 },                            /* FLD1 */
+    { 0xD9, 0xE9, M_NONE, 0, 1, T_RC0 | T_CONST },
+    { 0xD9, 0xEA, M_NONE, 0, 1, T_RC0 | T_CONST },
+    { 0xD9, 0xEB, M_NONE, 0, 1, T_RC0 | T_CONST },
+    { 0xD9, 0xEC, M_NONE, 0, 1, T_RC0 | T_CONST },
+    { 0xD9, 0xED, M_NONE, 0, 1, T_RC0 | T_CONST },
+    { 0xD9, 0xEE, M_NONE, 0, 1, 0 },                            /* FLDZ */
+    { 0xD9, 0xF4, M_NONE, 1, 1, T_RC0 },                        /* FXTRACT */
+    { 0xD9, 0xF5, M_NONE, 2, 0, 0 },                            /* FPREM1 */
+    { 0xD9, 0xF8, M_NONE, 2, 0, 0 },                            /* FPREM */
+    { 0xD9, 0xFA, M_NONE, 1, 0, T_RC0 },                        /* FSQRT */
+    { 0xD9, 0xFC, M_NONE, 1, 0, 0 },                            /* FRNDINT */
+    { 0xD9, 0xFD, M_NONE, 2, 0, T_ACC },                        /* FSCALE: beyond a double's range */
+    { 0xD9, 0xD0, M_NONE, 0, 0, 0 },                            /* FNOP */
+    { 0xDB, 0xE2, M_NONE, 0, 0, 0 },                            /* FNCLEX */
+    { 0xDF, 0xE0, M_NONE, 0, 0, 0 },                            /* FNSTSW AX */
+};
+
+#define FORM_COUNT  (sizeof(forms) / sizeof(forms[0]))
+
+static const uint8_t arith_ops[6] = { 0, 1, 4, 5, 6, 7 };
+
+/* Memory operand offset for a kind; each store gets its own slot */
+static int mem_offset(int kind, int *slot)
+{
+    switch (kind) {
+    case M_F32: return (rnd() & 1) ? 8 : 12;
+    case M_F64: return 0;
+    case M_I16: return 28;
+    case M_I32: return 24;
+    case M_I64: return 16;
+    case M_F80: return 0;
+    default: return MEM_DST + 8 * (*slot)++;
+    }
+}
+
+/* Encode opcode, ModR/M and an [RSI + disp8], [RSI + RCX*8 + disp8], [RSI + disp32] or [RSI] operand */
+static int encode_mem(uint8_t *out, uint8_t opcode, int reg, int off)
+{
+    int n = 0;
+
+    out[n++] = opcode;
+    switch (rnd() % 4) {
+    case 0:
+        out[n++] = (uint8_t)(0x44 | reg << 3);
+        out[n++] = 0xCE;
+        out[n++] = (uint8_t)(off - 8);
+        break;
+    case 1:
+        out[n++] = (uint8_t)(0x86 | reg << 3);
+        memcpy(out + n, &off, 4);
+        n += 4;
+        break;
+    case 2:
+        if (off == 0) {
+            out[n++] = (uint8_t)(0x06 | reg << 3);
+            break;
+        }
+        /* Fall through */
+    default:
+        out[n++] = (uint8_t)(0x46 | reg << 3);
+        out[n++] = (uint8_t)off;
+        break;
+    }
+    return n;
+}
+
+/* ============================================================================
+ * Block Differential
+ * ============================================================================ */
+
+typedef struct {
+    uint8_t code[16 * 12];
+    size_t len;
+    uint8_t starts[12];
+    int count;
+    int int_store[12];      /* Offset and size of integer stores, for the indefinite */
+    int int_size[12];
+    int nint;
+    int sw_store[12];       /* Offset of status word stores */
+    int nsw;
+    int nstore;
+} x87_block_t;
+
+/* A random block that keeps the stack within depth registers (fast mode has no stack faults) */
+static void make_block(x87_block_t *blk, int depth, int accurate, int rc)
+{
+    int n = 1 + (int)(rnd() % 12);
+    int tries = 0;
+
+    memset(blk, 0, sizeof(*blk));
+    while (blk->count < n && tries++ < 1000) {
+        const x87_form_t *f = &forms[rnd() % FORM_COUNT];
+        uint8_t *p = blk->code + blk->len;
+        int i = 0, reg, len;
+
+        if ((f->flags & T_ACC) && !accurate) {
+            continue;
+        }
+        if ((f->flags & T_RC0) && !accurate && rc) {
+            continue;
+        }
+        if ((f->flags & T_CONST) && !accurate && blk->count != n - 1) {
+            continue;
+        }
+        if (f->mem == M_DST && blk->nstore == 4) {
+            continue;
+        }
+        if (f->flags & T_STI) {
+            i = (int)(rnd() % 8);
+        }
+        if (depth < f->need || depth < i + ((f->flags & T_STI) != 0) ||
+            depth + f->push > 8 || depth + f->push < 0) {
+            continue;
+        }
+        if (f->mem != M_NONE) {
+            int off = mem_offset(f->mem, &blk->nstore);
+            reg = (f->modrm >> 3) & 7;
+            if (f->flags & T_ARITH) {
+                reg = arith_ops[rnd() % 6];
+            }
+            len = encode_mem(p, f->opcode, reg, off);
+            if (f->flags & T_SW) {
+                blk->sw_store[blk->nsw++] = off;
+            }
+            if (f->flags & T_INT) {
+                blk->int_store[blk->nint] = off;
+                blk->int_size[blk->nint++] = f->opcode == 0xDF && reg != 7 ? 2 :
+                                             f->opcode == 0xDB ? 4 : 8;
+            }
+        } else {
+            uint8_t modrm = f->modrm;
+            if (f->flags & T_ARITH) {
+                modrm = (uint8_t)(0xC0 | arith_ops[rnd() % 6] << 3);
+            }
+            if (f->flags & T_CMOV) {
+                modrm = (uint8_t)(0xC0 | (rnd() % 4) << 3);
+            }
+            p[0] = f->opcode;
+            p[1] = (uint8_t)(modrm | i);
+            len = 2;
+        }
+        blk->starts[blk->count++] = (uint8_t)blk->len;
+        blk->len += (size_t)len;
+        depth += f->push;
+    }
+}
+
+/* Translate a block into *nwords words; returns 0, or -1 on a translation error */
+static int translate_block(const x87_block_t *blk, uint32_t *words, size_t max, size_t *nwords)
+{
+    translate_x87_state_t st;
+    code_buffer_t cb;
+    int i;
+
+    code_buffer_init_arm64(&cb, (uint8_t *)words, (uint32_t)(max * 4));
+    translate_x87_begin_block(&st);
+    for (i = 0; i < blk->count; i++) {
+        x86_insn_t insn;
+        const uint8_t *p = blk->code + blk->starts[i];
+        size_t end = i + 1 < blk->count ? blk->starts[i + 1] : blk->len;
+
+        if (decode_x86_insn(p, &insn) != (int)(end - blk->starts[i])) {
+            return -1;
+        }
+        if (translate_x87_lower(&cb, &st, &insn, 0) != 0) {
+            return -1;
+        }
+    }
+    translate_x87_flush(&cb, &st);
+    *nwords = cb.offset / 4;
+    return cb.error ? -1 : 0;
+}
+
+static ThreadState blk_ts;
+static uint64_t blk_stack[128];
+
+static void print_image(const char *tag, const uint8_t *img)
+{
+    int i;
+    uint16_t cw, sw, tag_word;
+
+    memcpy(&cw, img, 2);
+    memcpy(&sw, img + 4, 2);
+    memcpy(&tag_word, img + 8, 2);
+    printf("    %s cw %04x sw %04x tag %04x\n", tag, cw, sw, tag_word);
+    for (i = 0; i < 8; i++) {
+        uint64_t m;
+        uint16_t se;
+        memcpy(&m, img + 28 + 10 * i, 8);
+        memcpy(&se, img + 36 + 10 * i, 2);
+        printf("      st%d %04x:%016llx\n", i, se, (unsigned long long)m);
+    }
+}
+
+/* ST(i) of an FNSAVE image as a double (fast mode registers) */
+static double image_st(const uint8_t *img, int i)
+{
+    f80_t v;
+
+    memcpy(&v.mant, img + 28 + 10 * i, 8);
+    memcpy(&v.sexp, img + 36 + 10 * i, 2);
+    return (double)ld_of_f80(v);
+}
+
+/* One random block; returns 0 on match, 1 on mismatch, -1 on a translation error */
+static int run_block(int accurate, int verbose)
+{
+    uint8_t img[IMG_SIZE], out[IMG_SIZE], mem[MEM_SIZE], mem2[MEM_SIZE];
+    uint32_t words[4096];
+    rosetta_exec_context_t ectx;
+    x87_block_t blk;
+    a64_t c;
+    size_t nwords, bad_word;
+    int rc = (int)(rnd() % 4), pc = accurate ? (int)(rnd() % 3) + 1 : 2;
+    int depth = (int)(rnd() % 9), top = (int)(rnd() % 8);
+    uint16_t cw = (uint16_t)(0x7F | (pc == 1 ? 0 : pc) << 8 | rc << 10);
+    uint16_t sw = (uint16_t)(top << 11 | (rnd() & 0x4700));
+    uint16_t tag = 0xFFFF;
+    uint64_t rflags = 0x202 | (rnd() & 0x45), host_flags;
+    uint64_t gpr[16];
+    int i, bad = 0;
+
+    make_block(&blk, depth, accurate, rc);
+    if (translate_block(&blk, words, sizeof(words) / 4, &nwords) < 0) {
+        return -1;
+    }
+
+    /* Initial image: ST(0..depth-1) in use */
+    memset(img, 0, sizeof(img));
+    for (i = 0; i < 8; i++) {
+        f80_t v = accurate && (rnd() & 1) ? rnd_f80() : f80_of_ld((long double)rnd_double());
+        if (i < depth) {
+            tag &= (uint16_t)~(3u << (2 * ((top + i) & 7)));
+        }
+        memcpy(img + 28 + 10 * i, &v.mant, 8);
+        memcpy(img + 36 + 10 * i, &v.sexp, 2);
+    }
+    memcpy(img, &cw, 2);
+    memcpy(img + 4, &sw, 2);
+    memcpy(img + 8, &tag, 2);
+
+    for (i = 0; i < MEM_SIZE; i++) {
+        mem[i] = (uint8_t)rnd();
+    }
+    if (!accurate || (rnd() & 1)) {
+        double d = rnd_double();
+        float f0 = (float)rnd_double(), f1 = (float)rnd_double();
+        int64_t i64 = (int64_t)(rnd() % 2000001) - 1000000;
+        int32_t i32 = (int32_t)(rnd() % 200001) - 100000;
+        int16_t i16 = (int16_t)rnd();
+        memcpy(mem, &d, 8);
+        memcpy(mem + 8, &f0, 4);
+        memcpy(mem + 12, &f1, 4);
+        memcpy(mem + 16, &i64, 8);
+        memcpy(mem + 24, &i32, 4);
+        memcpy(mem + 28, &i16, 2);
+    }
+    memcpy(mem2, mem, sizeof(mem));
+
+    /* Emulation: FRSTOR through the helper, the block, FNSAVE through the helper */
+    memset(&blk_ts, 0, sizeof(blk_ts));
+    rosetta_x87_exec(&blk_ts, (uint64_t)(uintptr_t)img, 0, X87_OP(0xDD, 0x20));
+    memset(&c, 0, sizeof(c));
+    for (i = 0; i < 32; i++) {
+        c.x[i] = rnd();
+        c.v[i].d[0] = rnd();
+        c.v[i].d[1] = rnd();
+    }
+    c.x[0] = 0;
+    c.x[1] = 1;
+    c.x[6] = (uint64_t)(uintptr_t)mem2;
+    c.x[31] = 0;
+    memcpy(gpr, c.x, sizeof(gpr));
+    memset(&ectx, 0, sizeof(ectx));
+    ectx.state = &blk_ts;
+    c.x[18] = (uint64_t)(uintptr_t)&ectx;
+    c.sp = (uint64_t)(uintptr_t)&blk_stack[128];
+    c.simd = x87_simd;
+    c.blr = x87_blr;
+    c.nzcv = (uint32_t)(((rflags >> 6) & 1) << 2 | !(rflags & 1) << 1 | ((rflags >> 2) & 1));
+    bad_word = a64_run(&c, words, nwords);
+    memset(out, 0, sizeof(out));
+    rosetta_x87_exec(&blk_ts, (uint64_t)(uintptr_t)out, 0, X87_OP(0xDD, 0x30));
+
+    /* Host */
+    memcpy(img, &cw, 2);
+    host_flags = host_run(blk.code, blk.len, img, mem, rflags);
+
+    if (bad_word) {
+        bad |= 0x100;
+    }
+    if (accurate) {
+        if (memcmp(img, out, 2) || memcmp(img + 4, out + 4, 2) || memcmp(img + 8, out + 8, 2)) {
+            bad |= 1;
+        }
+        if (memcmp(img + 28, out + 28, 80)) {
+            bad |= 2;
+        }
+        if ((c.x[0] & 0xFFFF) != (uint64_t)(img[IMG_AX] | img[IMG_AX + 1] << 8)) {
+            bad |= 0x40;
+        }
+    } else {
+        uint16_t hsw, osw, htag, otag;
+        memcpy(&hsw, img + 4, 2);
+        memcpy(&osw, out + 4, 2);
+        memcpy(&htag, img + 8, 2);
+        memcpy(&otag, out + 8, 2);
+        if ((hsw & 0x7D00) != (osw & 0x7D00)) {
+            bad |= 1;
+        }
+        for (i = 0; i < 8; i++) {
+            int hfull = ((htag >> (2 * i)) & 3) != 3, ofull = ((otag >> (2 * i)) & 3) != 3;
+            if (hfull != ofull) {
+                bad |= 1;
+            }
+        }
+        for (i = 0; i < 8; i++) {
+            int phys = (((hsw >> 11) & 7) + i) & 7;
+            double h = image_st(img, i), o = image_st(out, i);
+            if (((htag >> (2 * phys)) & 3) == 3) {
+                continue;
+            }
+            if (!(h != h && o != o) && memcmp(&h, &o, 8)) {
+                bad |= 2;
+            }
+        }
+        for (i = 0; i < blk.nint; i++) {
+            uint64_t indef = 1ull << (8 * blk.int_size[i] - 1), v = 0;
+            memcpy(&v, mem + blk.int_store[i], (size_t)blk.int_size[i]);
+            if (v == indef) {
+                memcpy(mem2 + blk.int_store[i], mem + blk.int_store[i], (size_t)blk.int_size[i]);
+            }
+        }
+        for (i = 0; i < blk.nsw; i++) {
+            uint16_t h, o;
+            memcpy(&h, mem + blk.sw_store[i], 2);
+            memcpy(&o, mem2 + blk.sw_store[i], 2);
+            if (((h ^ o) & 0x7D00) == 0) {
+                memcpy(mem2 + blk.sw_store[i], &h, 2);
+            }
+        }
+        if ((c.x[0] & 0x7D00) != (uint64_t)((img[IMG_AX] | img[IMG_AX + 1] << 8) & 0x7D00)) {
+            bad |= 0x40;
+        }
+    }
+    if (memcmp(mem, mem2, sizeof(mem))) {
+        bad |= 4;
+    }
+    if ((host_flags & 0x45) != (((c.nzcv >> 2) & 1) << 6 | !((c.nzcv >> 1) & 1) | (c.nzcv & 1) << 2)) {
+        bad |= 8;
+    }
+    for (i = 1; i < 16; i++) {
+        if (c.x[i] != gpr[i]) {
+            bad |= 0x10;
+        }
+    }
+    if (c.x[0] >> 16 || c.sp != (uint64_t)(uintptr_t)&blk_stack[128]) {
+        bad |= 0x20;
+    }
+
+    if (bad && verbose) {
+        printf("  %s block, depth %d, cw %04x, bad %#x%s:", accurate ? "accurate" : "fast", depth, cw, bad,
+               bad_word ? " (unknown word)" : "");
+        for (i = 0; i < (int)blk.len; i++) {
+            printf(" %02x", blk.code[i]);
+        }
+        printf("\n");
+        if (bad_word) {
+            printf("    word %zu: %08x\n", bad_word - 1, words[bad_word - 1]);
+        }
+        print_image("host", img);
+        print_image("emu ", out);
+    }
+    return bad ? 1 : 0;
+}
+
+/* ============================================================================
+ * Tests
+ * ============================================================================ */
+
+/* rosetta_x87_exec() against the host, one instruction at a time */
+static void test_exec_differential(void)
+{
+    static const uint8_t mem_forms[][2] = {
+        { 0xD8, 0xFF }, { 0xDC, 0xFF }, { 0xD9, 0 }, { 0xD9, 2 }, { 0xD9, 3 }, { 0xDD, 0 },
+        { 0xDD, 2 }, { 0xDD, 3 }, { 0xDB, 5 }, { 0xDB, 7 }, { 0xDA, 0xFF }, { 0xDE, 0xFF },
+        { 0xDB, 0 }, { 0xDB, 1 }, { 0xDB, 2 }, { 0xDB, 3 }, { 0xDF, 0 }, { 0xDF, 1 },
+        { 0xDF, 2 }, { 0xDF, 3 }, { 0xDF, 5 }, { 0xDF, 7 }, { 0xDD, 1 }, { 0xDF, 4 },
+        { 0xDF, 6 }, { 0xDD, 7 }, { 0xD9, 7 },
+    };
+    static const uint8_t reg_forms[][2] = {
+        { 0xD8, 0 }, { 0xDC, 0 }, { 0xDE, 0 }, { 0xD9, 0xE0 }, { 0xD9, 0xE1 }, { 0xD9, 0xE4 },
+        { 0xD9, 0xE5 }, { 0xD9, 0xE8 }, { 0xD9, 0xE9 }, { 0xD9, 0xEA }, { 0xD9, 0xEB },
+        { 0xD9, 0xEC }, { 0xD9, 0xED }, { 0xD9, 0xEE }, { 0xD9, 0xF4 }, { 0xD9, 0xF5 },
+        { 0xD9, 0xF6 }, { 0xD9, 0xF7 }, { 0xD9, 0xF8 }, { 0xD9, 0xFA }, { 0xD9, 0xFC },
+        { 0xD9, 0xFD }, { 0xD9, 0xC0 }, { 0xD9, 0xC8 }, { 0xDA, 0xC0 }, { 0xDB, 0xC0 },
+        { 0xDA, 0xE9 }, { 0xDB, 0xE8 }, { 0xDB, 0xF0 }, { 0xDD, 0xC0 }, { 0xDD, 0xD0 },
+        { 0xDD, 0xD8 }, { 0xDD, 0xE0 }, { 0xDD, 0xE8 }, { 0xDE, 0xD9 }, { 0xDF, 0xE8 },
+        { 0xDF, 0xF0 }, { 0xDF, 0xC0 }, { 0xDB, 0xE2 }, { 0xDB, 0xE3 }, { 0xD9, 0xD0 },
+    };
+    const int nmem = (int)(sizeof(mem_forms) / sizeof(mem_forms[0]));
+    const int nreg = (int)(sizeof(reg_forms) / sizeof(reg_forms[0]));
+    static ThreadState ts;
+    int it, fails = 0;
+
+    TEST_START("Accurate exec against the host FPU");
+    rosetta_x87_set_mode(ROSETTA_X87_ACCURATE);
+    for (it = 0; it < 200000; it++) {
+        uint8_t img[IMG_SIZE], img2[IMG_SIZE], mem[32], mem2[32], insn[2];
+        int pcs[3] = { 0, 2, 3 };
+        uint16_t cw = (uint16_t)(0x7F | pcs[rnd() % 3] << 8 | (rnd() % 4) << 10);
+        int top = (int)(rnd() % 8), i, bad = 0;
+        uint16_t tag = 0, sw = (uint16_t)(top << 11 | (rnd() & 0x4700));
+        uint64_t rflags = 0x202 | (rnd() & 0x45), host_flags, nzcv;
+        int opcode, modrm, k;
+
+        memset(img, 0, sizeof(img));
+        for (i = 0; i < 8; i++) {
+            f80_t v = rnd_f80();
+            if (rnd() % 4 == 0) {
+                tag |= (uint16_t)(3u << (2 * i));
+            }
+            memcpy(img + 28 + 10 * i, &v.mant, 8);
+            memcpy(img + 36 + 10 * i, &v.sexp, 2);
+        }
+        memcpy(img, &cw, 2);
+        memcpy(img + 4, &sw, 2);
+        memcpy(img + 8, &tag, 2);
+        for (i = 0; i < 32; i++) {
+            mem[i] = (uint8_t)rnd();
+        }
+
+        k = (int)(rnd() % (uint64_t)(nmem + nreg));
+        if (k < nmem) {
+            f80_t v = rnd_f80();
+            uint16_t ignore = 0;
+            int reg = mem_forms[k][1] == 0xFF ? (int)(rnd() % 8) : mem_forms[k][1];
+
+            opcode = mem_forms[k][0];
+            modrm = reg << 3 | 6;
+            if ((opcode == 0xD8 || (opcode == 0xD9 && reg == 0)) && (rnd() & 1)) {
+                uint32_t b = rosetta_x87_f80_to_f32(v, X87_CW_DEFAULT, &ignore);
+                memcpy(mem, &b, 4);
+            }
+            if ((opcode == 0xDC || (opcode == 0xDD && reg == 0)) && (rnd() & 1)) {
+                uint64_t b = rosetta_x87_f80_to_f64(v, X87_CW_DEFAULT, &ignore);
+                memcpy(mem, &b, 8);
+            }
+            if (opcode == 0xDB && reg == 5) {
+                memcpy(mem, &v.mant, 8);
+                memcpy(mem + 8, &v.sexp, 2);
+            }
+            if (opcode == 0xDF && reg == 4) {
+                for (i = 0; i < 9; i++) {
+                    mem[i] = (uint8_t)((rnd() % 10) | (rnd() % 10) << 4);
+                }
+                mem[9] = (uint8_t)(rnd() & 0x80);
+            }
+            if ((opcode == 0xDA || opcode == 0xDE || opcode == 0xDB || opcode == 0xDF) && (rnd() & 1)) {
+                memset(mem + 2, (mem[1] & 0x80) ? 0xFF : 0, 6);     /* Small integers */
+            }
+        } else {
+            k -= nmem;
+            opcode = reg_forms[k][0];
+            modrm = reg_forms[k][1];
+            if (modrm == 0) {
+                modrm = 0xC0 | (int)(rnd() % 64);
+            } else if ((modrm & 0xC7) == 0xC0 && !(opcode == 0xD9 && modrm >= 0xD0)) {
+                modrm |= (int)(rnd() % 8);
+            }
+            if (opcode == 0xDE && (modrm & 0xF8) == 0xD8) {
+                modrm = 0xD9;
+            }
+        }
+        insn[0] = (uint8_t)opcode;
+        insn[1] = (uint8_t)modrm;
+
+        memcpy(img2, img, sizeof(img));
+        memcpy(mem2, mem, sizeof(mem));
+        host_flags = host_run(insn, 2, img, mem, rflags);
+
+        memset(&ts, 0, sizeof(ts));
+        rosetta_x87_exec(&ts, (uint64_t)(uintptr_t)img2, 0, X87_OP(0xDD, 0x20));
+        nzcv = ((rflags >> 6) & 1) << 30 | (uint64_t)!(rflags & 1) << 29 | ((rflags >> 2) & 1) << 28;
+        nzcv = rosetta_x87_exec(&ts, (uint64_t)(uintptr_t)mem2, nzcv, X87_OP(opcode, modrm));
+        rosetta_x87_exec(&ts, (uint64_t)(uintptr_t)img2, 0, X87_OP(0xDD, 0x30));
+
+        if (memcmp(img, img2, 2) || memcmp(img + 4, img2 + 4, 2) || memcmp(img + 8, img2 + 8, 2)) {
+            bad |= 1;
+        }
+        if (memcmp(img + 28, img2 + 28, 80)) {
+            bad |= 2;
+        }
+        if (memcmp(mem, mem2, sizeof(mem))) {
+            bad |= 4;
+        }
+        if ((opcode == 0xDB || opcode == 0xDF) && modrm >= 0xE8 && modrm < 0xF8) {
+            uint64_t ef = ((nzcv >> 30) & 1) << 6 | !((nzcv >> 29) & 1) | ((nzcv >> 28) & 1) << 2;
+            if ((host_flags & 0x45) != ef) {
+                bad |= 8;
+            }
+        }
+        if (bad && ++fails <= 10) {
+            printf("  %02X %02X: bad %#x\n", opcode, modrm, bad);
+            print_image("host", img);
+            print_image("emu ", img2);
+        }
+    }
+    if (fails == 0) {
+        TEST_PASS("Accurate exec against the host FPU");
+    } else {
+        char msg[64];
+        snprintf(msg, sizeof(msg), "%d of 200000 cases differ", fails);
+        TEST_FAIL("Accurate exec against the host FPU", msg);
+    }
+}
+
+/*
+ * F2XM1, FYL2X, FPTAN, FPATAN, FYL2XP1, FSINCOS, FSIN, FCOS. The host reduces
+ * trigonometric arguments with a 66-bit pi, so allow 2^-52 relative plus
+ * 2^-56 absolute, scaled by the slope of the tangent for FPTAN
+ */
+static void test_transcendental(void)
+{
+    static const uint8_t ops[] = { 0xF0, 0xF1, 0xF2, 0xF3, 0xF9, 0xFB, 0xFE, 0xFF };
+    static ThreadState ts;
+    int it, fails = 0;
+
+    TEST_START("Transcendentals against the host FPU");
+    rosetta_x87_set_mode(ROSETTA_X87_ACCURATE);
+    for (it = 0; it < 20000; it++) {
+        uint8_t img[IMG_SIZE], img2[IMG_SIZE], insn[2];
+        uint16_t cw = X87_CW_DEFAULT, sw = 6 << 11, tag = 0xFFFF & ~(0xF << 12);
+        uint8_t op = ops[rnd() % sizeof(ops)];
+        int i, bad = 0;
+        long double a, b;
+
+        /* ST(0), ST(1) in range for every operation */
+        a = (long double)(rnd() >> 11) / 9007199254740992.0L;
+        b = (long double)(rnd() >> 11) / 9007199254740992.0L * 8 + 0.25L;
+        if (op == 0xF0) {
+            a = a * 2 - 1;
+        } else if (op == 0xF9) {
+            a = a * 0.5L - 0.25L;
+        } else if (op == 0xF1) {
+            a = b;
+            b = (rnd() & 1) ? -a : a;
+        } else if (op != 0xF3) {
+            a = (a * 2 - 1) * 100;
+        }
+        memset(img, 0, sizeof(img));
+        memcpy(img, &cw, 2);
+        memcpy(img + 4, &sw, 2);
+        memcpy(img + 8, &tag, 2);
+        memcpy(img + 28, &a, 10);
+        memcpy(img + 38, &b, 10);
+        memcpy(img2, img, sizeof(img));
+        insn[0] = 0xD9;
+        insn[1] = op;
+        host_run(insn, 2, img, img, 0x202);
+
+        memset(&ts, 0, sizeof(ts));
+        rosetta_x87_exec(&ts, (uint64_t)(uintptr_t)img2, 0, X87_OP(0xDD, 0x20));
+        rosetta_x87_exec(&ts, 0, 0, X87_OP(0xD9, op));
+        rosetta_x87_exec(&ts, (uint64_t)(uintptr_t)img2, 0, X87_OP(0xDD, 0x30));
+
+        if (memcmp(img + 4, img2 + 4, 2) && ((img[5] ^ img2[5]) & 0x38)) {
+            bad = 1;                                    /* TOP */
+        }
+        for (i = 0; i < 2; i++) {
+            long double h, e, slope;
+            memcpy(&h, img + 28 + 10 * i, 10);
+            memcpy(&e, img2 + 28 + 10 * i, 10);
+            slope = op == 0xF2 ? 1 + h * h : 1;
+            if (h != e && fabsl(h - e) > (fabsl(h) * 0x1p-52L + 0x1p-56L) * slope) {
+                bad = 1;
+            }
+        }
+        if (bad && ++fails <= 10) {
+            printf("  D9 %02X: a %.21Lg b %.21Lg\n", op, a, b);
+            print_image("host", img);
+            print_image("emu ", img2);
+        }
+    }
+    if (fails == 0) {
+        TEST_PASS("Transcendentals against the host FPU");
+    } else {
+        TEST_FAIL("Transcendentals against the host FPU", "results out of tolerance");
+    }
+}
+
+static void test_blocks(int accurate)
+{
+    const char *name = accurate ? "Accurate blocks against the host FPU" : "Fast blocks against the host FPU";
+    int it, fails = 0, errors = 0;
+
+    TEST_START(name);
+    rosetta_x87_set_mode(accurate ? ROSETTA_X87_ACCURATE : ROSETTA_X87_FAST);
+    for (it = 0; it < 50000; it++) {
+        int r = run_block(accurate, fails < 5);
+        if (r < 0) {
+            errors++;
+        } else if (r > 0) {
+            fails++;
+        }
+    }
+    if (fails == 0 && errors == 0) {
+        TEST_PASS(name);
+    } else {
+        char msg[80];
+        snprintf(msg, sizeof(msg), "%d of 50000 blocks differ, %d failed to translate", fails, errors);
+        TEST_FAIL(name, msg);
+    }
+}
+
+static int has_word(const uint32_t *w, size_t n, uint32_t mask, uint32_t value)
+{
+    size_t i;
+
+    for (i = 0; i < n; i++) {
+        if ((w[i] & mask) == value) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Lengths, status, and the cost of the stack model */
+static void test_structure(void)
+{
+    static const uint8_t fld_m64[] = { 0xDD, 0x06 };                        /* fld qword [rsi] */
+    static const uint8_t fadd_m64[] = { 0xDC, 0x46, 0x08 };                 /* fadd qword [rsi + 8] */
+    static const uint8_t fstp_m64[] = { 0xDD, 0x5E, 0x10 };                 /* fstp qword [rsi + 16] */
+    static const uint8_t fld1[] = { 0xD9, 0xE8 };
+    static const uint8_t fldz[] = { 0xD9, 0xEE };
+    static const uint8_t fxch[] = { 0xD9, 0xC9 };
+    static const uint8_t fstp_st1[] = { 0xDD, 0xD9 };
+    static const uint8_t fadd_st1[] = { 0xD8, 0xC1 };
+    static const uint8_t fnstsw_ax[] = { 0xDF, 0xE0 };
+    static const uint8_t fldcw[] = { 0xD9, 0x2E };                  /* fldcw [rsi] */
+    static const uint8_t sib_nobase[] = { 0xDD, 0x04, 0xCD, 0x00, 0x10, 0x00, 0x00 };  /* fld [rcx*8 + 0x1000] */
+    static const uint8_t sib_abs[] = { 0xD9, 0x04, 0x25, 0x00, 0x10, 0x00, 0x00 };     /* fld [0x1000] */
+    static const uint8_t nop[] = { 0x90 };
+    translate_x87_state_t st;
+    x86_insn_t insn;
+    uint32_t words[512];
+    code_buffer_t cb;
+    uint32_t before;
+    int ok = 1;
+
+    TEST_START("x87 lowering structure");
+    ok &= decode_x86_insn(fadd_m64, &insn) == 3 && insn.has_modrm;
+    ok &= decode_x86_insn(sib_nobase, &insn) == 7 && insn.sib == 0xCD && insn.disp == 0x1000;
+    ok &= decode_x86_insn(sib_abs, &insn) == 7 && insn.disp == 0x1000;
+    ok &= decode_x86_insn(fxch, &insn) == 2;
+
+    rosetta_x87_set_mode(ROSETTA_X87_FAST);
+    code_buffer_init_arm64(&cb, (uint8_t *)words, sizeof(words));
+    translate_x87_begin_block(&st);
+    decode_x86_insn(nop, &insn);
+    ok &= translate_x87_lower(&cb, &st, &insn, 0) == -ENOENT && cb.offset == 0;
+
+    /* A balanced block writes no TOP or tags, and calls nothing */
+    decode_x86_insn(fld_m64, &insn);
+    ok &= translate_x87_lower(&cb, &st, &insn, 0) == 0;
+    decode_x86_insn(fadd_m64, &insn);
+    ok &= translate_x87_lower(&cb, &st, &insn, 0) == 0;
+    decode_x86_insn(fstp_m64, &insn);
+    ok &= translate_x87_lower(&cb, &st, &insn, 0) == 0;
+    translate_x87_flush(&cb, &st);
+    ok &= !has_word(words, cb.offset / 4, 0xFFC00000u, 0x39000000u);       /* STRB */
+    ok &= !has_word(words, cb.offset / 4, 0xFFFFFC1Fu, 0xD63F0000u);       /* BLR */
+    ok &= cb.offset / 4 <= 12;
+
+    /* FXCH and FSTP ST(1) on cached registers are free */
+    code_buffer_init_arm64(&cb, (uint8_t *)words, sizeof(words));
+    translate_x87_begin_block(&st);
+    decode_x86_insn(fld1, &insn);
+    translate_x87_lower(&cb, &st, &insn, 0);
+    decode_x86_insn(fldz, &insn);
+    translate_x87_lower(&cb, &st, &insn, 0);
+    before = cb.offset;
+    decode_x86_insn(fxch, &insn);
+    ok &= translate_x87_lower(&cb, &st, &insn, 0) == 0 && cb.offset == before;
+    decode_x86_insn(fstp_st1, &insn);
+    ok &= translate_x87_lower(&cb, &st, &insn, 0) == 0 && cb.offset == before;
+
+    /* FLDCW reloads the FPCR rounding mode inline */
+    code_buffer_init_arm64(&cb, (uint8_t *)words, sizeof(words));
+    translate_x87_begin_block(&st);
+    decode_x86_insn(fldcw, &insn);
+    ok &= translate_x87_lower(&cb, &st, &insn, 0) == 0;
+    ok &= has_word(words, cb.offset / 4, 0xFFFFFFE0u, 0xD51B4400u);       /* MSR FPCR */
+    ok &= !has_word(words, cb.offset / 4, 0xFFFFFC1Fu, 0xD63F0000u);
+
+    /* Accurate mode calls the helper, except for FNSTSW AX */
+    rosetta_x87_set_mode(ROSETTA_X87_ACCURATE);
+    code_buffer_init_arm64(&cb, (uint8_t *)words, sizeof(words));
+    translate_x87_begin_block(&st);
+    decode_x86_insn(fnstsw_ax, &insn);
+    ok &= translate_x87_lower(&cb, &st, &insn, 0) == 0;
+    ok &= !has_word(words, cb.offset / 4, 0xFFFFFC1Fu, 0xD63F0000u);
+    decode_x86_insn(fadd_st1, &insn);
+    ok &= translate_x87_lower(&cb, &st, &insn, 0) == 0;
+    ok &= has_word(words, cb.offset / 4, 0xFFFFFC1Fu, 0xD63F0000u);
+    before = cb.offset;
+    translate_x87_flush(&cb, &st);
+    ok &= cb.offset == before;
+
+    if (ok) {
+        TEST_PASS("x87 lowering structure");
+    } else {
+        TEST_FAIL("x87 lowering structure", "wrong length, status or cost");
+    }
+}
+
+int main(void)
+{
+    printf("=================================================\n");
+    printf("x87 Emulation and Lowering Differential Test\n");
+    printf("=================================================\n");
+
+    host_page = mmap(NULL, 4096, PROT_READ | PROT_WRITE | PROT_EXEC,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (host_page == MAP_FAILED) {
+        printf("mmap failed\n");
+        return 1;
+    }
+
+    test_structure();
+    test_exec_differential();
+    test_transcendental();
+    test_blocks(1);
+    test_blocks(0);
+
+    munmap(host_page, 4096);
+
+    printf("\n=================================================\n");
+    printf("Results: %d passed, %d failed\n", tests_passed, tests_failed);
+    printf("=================================================\n");
+
+    return tests_failed > 0 ? 1 : 0;
+}
+
+#else /* !__x86_64__ */
+
+int main(void)
+{
+    printf("x87 differential test needs an x86_64 host, skipping\n");
+    return 0;
+}
+
+#endif /* __x86_64__ */